@@ -0,0 +1,142 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "RenderStats.h"
+#include "StepTimer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Options of the benchmark mode (-bench, -warmup, -headless).
+struct BenchmarkSettings
+{
+    // Number of measured frames. The benchmark mode is off when zero.
+    uint32_t frameCount = 0;
+
+    // Frames rendered before the measurement starts, so that shader compilation,
+    // driver caches and first-use page faults don't show up in the results.
+    uint32_t warmupFrameCount = 60;
+
+    // Run without a window (HeadlessPlatform), on offscreen back buffers.
+    bool headless = false;
+};
+
+// Measures a fixed number of frames and reports their time distribution, the CPU time
+// spent in each named phase and the per-frame render counters.
+// Every method must be called from the thread that runs the frames.
+class Benchmark
+{
+public:
+    Benchmark();
+
+    void Configure(const BenchmarkSettings& settings);
+    const BenchmarkSettings& GetSettings() const { return m_settings; }
+
+    bool IsEnabled() const      { return m_settings.frameCount > 0; }
+    bool IsMeasuring() const    { return IsEnabled() && m_frameIndex >= m_settings.warmupFrameCount && !IsFinished(); }
+    bool IsFinished() const     { return m_frameIndex >= m_settings.warmupFrameCount + m_settings.frameCount; }
+
+    // Counters to report with each frame. RenderStats::EndFrame() must be called
+    // once per frame, before EndFrame().
+    void SetRenderStats(const RenderStats* pRenderStats) { m_pRenderStats = pRenderStats; }
+
+    // Frame boundaries. The frame time is the interval between two EndFrame() calls.
+    void BeginFrame();
+    void EndFrame();
+
+    // Add CPU time to a phase of the current frame. Phases may nest; the name must
+    // outlive the benchmark (a string literal).
+    void AddPhaseTime(const char* name, uint64_t nanoseconds);
+
+    uint32_t GetMeasuredFrameCount() const { return static_cast<uint32_t>(m_frameTimes.size()); }
+    FrameTimeStatistics GetFrameTimeStatistics() const;
+
+    // One row per measured frame: frame time, time of each phase and counters.
+    void WriteCsv(std::ostream& stream) const;
+
+    // Settings and distributions of the frame times, phase times and counters.
+    void WriteJson(std::ostream& stream, const std::string& sampleName, uint32_t sceneScale) const;
+
+    // Short text summary, for the debugger output.
+    std::string FormatSummary() const;
+
+    static uint64_t GetNanoseconds()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    struct Phase
+    {
+        const char* name;
+        uint64_t currentNanoseconds;
+        std::vector<uint64_t> nanoseconds;   // One value per measured frame.
+    };
+
+    // Distribution of a series of durations in nanoseconds.
+    static FrameTimeStatistics Summarize(std::vector<uint64_t> nanoseconds);
+
+    BenchmarkSettings m_settings;
+    const RenderStats* m_pRenderStats;
+    uint32_t m_frameIndex;
+    uint64_t m_frameStart;
+    uint64_t m_lastFrameEnd;
+    uint64_t m_lastRenderStatsFrame;
+
+    std::vector<uint64_t> m_frameTimes;
+    std::vector<Phase> m_phases;
+    std::vector<RenderFrameStats> m_counters;
+};
+
+// Writes text as a quoted JSON string, with its quotes, backslashes and control
+// characters escaped.
+void WriteJsonString(std::ostream& stream, const char* text);
+
+// Adds the time spent between its construction and destruction to a benchmark phase.
+// It doesn't read the clock when the benchmark isn't measuring.
+class BenchmarkPhase
+{
+public:
+    BenchmarkPhase(Benchmark& benchmark, const char* name) :
+        m_benchmark(benchmark),
+        m_name(name),
+        m_begin(benchmark.IsMeasuring() ? Benchmark::GetNanoseconds() : 0)
+    {
+    }
+
+    ~BenchmarkPhase()
+    {
+        if (m_begin != 0)
+        {
+            m_benchmark.AddPhaseTime(m_name, Benchmark::GetNanoseconds() - m_begin);
+        }
+    }
+
+private:
+    BenchmarkPhase(const BenchmarkPhase&) = delete;
+    BenchmarkPhase& operator=(const BenchmarkPhase&) = delete;
+
+    Benchmark& m_benchmark;
+    const char* m_name;
+    uint64_t m_begin;
+};
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+
+// Time the rest of the enclosing block as a benchmark phase.
+#define BENCHMARK_PHASE(benchmark, name) BenchmarkPhase BENCHMARK_CONCAT(benchmarkPhase, __LINE__)(benchmark, name)
@@ -11,18 +11,22 @@
 
 #include "stdafx.h"
 #include "D3D12HelloTransformations.h"
+#include "RhiD3D12.h"
+#include "RhiNull.h"
 
 
 D3D12HelloTransformations::D3D12HelloTransformations(UINT width, UINT height, std::wstring name) :
 DXSample(width, height, name),
-m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
-m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+m_viewport{ 0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f },
+m_scissorRect{ 0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height) },
+m_vertexBufferView(),
+m_indexBufferView(),
 m_constantDataGpuAddr(0),
 m_mappedConstantData(nullptr),
-m_rtvDescriptorSize(0),
 m_frameIndex(0),
 m_fenceValues{},
-m_curRotationAngleRad(0.0f)
+m_curRotationAngleRad(0.0f),
+m_numDrawCalls(0)
 {
     // Initialize the world matrix
     m_worldMatrix = XMMatrixIdentity();
@@ -46,237 +50,70 @@ void D3D12HelloTransformations::OnInit()
 // Load the rendering pipeline dependencies.
 void D3D12HelloTransformations::LoadPipeline()
 {
-    UINT dxgiFactoryFlags = 0;
+    // The null device executes nothing, but keeps the CPU side of every frame
+    // (recording, uploads, fences and presents) identical.
+    m_device = m_useNullDevice ? Rhi::CreateNullDevice() : Rhi::CreateD3D12Device(m_useWarpDevice);
 
-#if defined(_DEBUG)
-    // Enable the debug layer (requires the Graphics Tools "optional feature").
-    // NOTE: Enabling the debug layer after device creation will invalidate the active device.
-    {
-        ComPtr<ID3D12Debug> debugController;
-        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController))))
-        {
-            debugController->EnableDebugLayer();
-
-            // Enable additional debug layers.
-            dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
-        }
-    }
-#endif
+    m_commandQueue = m_device->CreateCommandQueue();
 
-    ComPtr<IDXGIFactory4> factory;
-    ThrowIfFailed(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory)));
-
-    if (m_useWarpDevice)
-    {
-        ComPtr<IDXGIAdapter> warpAdapter;
-        ThrowIfFailed(factory->EnumWarpAdapter(IID_PPV_ARGS(&warpAdapter)));
-
-        ThrowIfFailed(D3D12CreateDevice(
-            warpAdapter.Get(),
-            D3D_FEATURE_LEVEL_11_0,
-            IID_PPV_ARGS(&m_device)
-        ));
-    }
-    else
-    {
-        ComPtr<IDXGIAdapter1> hardwareAdapter;
-        GetHardwareAdapter(factory.Get(), &hardwareAdapter);
-
-        ThrowIfFailed(D3D12CreateDevice(
-            hardwareAdapter.Get(),
-            D3D_FEATURE_LEVEL_11_0,
-            IID_PPV_ARGS(&m_device)
-        ));
-    }
-
-    // Describe and create the command queue.
-    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
-    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-
-    ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
-
-    // Describe and create the swap chain.
-    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
-    swapChainDesc.BufferCount = FrameCount;
-    swapChainDesc.Width = m_width;
-    swapChainDesc.Height = m_height;
-    swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-    swapChainDesc.SampleDesc.Count = 1;
-
-    ComPtr<IDXGISwapChain1> swapChain;
-    ThrowIfFailed(factory->CreateSwapChainForHwnd(
-        m_commandQueue.Get(),        // Swap chain needs the queue so that it can force a flush on it.
-        Win32Application::GetHwnd(),
-        &swapChainDesc,
-        nullptr,
-        nullptr,
-        &swapChain
-    ));
-
-    // This sample does not support fullscreen transitions.
-    ThrowIfFailed(factory->MakeWindowAssociation(Win32Application::GetHwnd(), DXGI_MWA_NO_ALT_ENTER));
-
-    ThrowIfFailed(swapChain.As(&m_swapChain));
+    m_swapChain = m_device->CreateSwapChain(m_commandQueue.get(), GetPlatform()->GetNativeWindow(), m_width, m_height, FrameCount, Rhi::Format::R8G8B8A8Unorm);
     m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 
-    // Create descriptor heaps.
-    {
-        // Describe and create a render target view (RTV) descriptor heap.
-        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-        rtvHeapDesc.NumDescriptors = FrameCount;
-        rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-        rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-        ThrowIfFailed(m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
-
-        // Describe and create a depth stencil view (DSV) descriptor heap.
-        D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-        dsvHeapDesc.NumDescriptors = 1;
-        dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-        dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-        ThrowIfFailed(m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
-
-        m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-    }
-
-    // Create frame resources.
+    // Create the depth stencil buffer.
     {
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
-
-        // Create a RTV and a command allocator for each frame.
-        for (UINT n = 0; n < FrameCount; n++)
-        {
-            ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTargets[n])));
-            m_device->CreateRenderTargetView(m_renderTargets[n].Get(), nullptr, rtvHandle);
-            rtvHandle.Offset(1, m_rtvDescriptorSize);
-
-            ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[n])));
-        }
-    }
-
-    // Create the depth stencil view.
-    {
-        D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilDesc = {};
-        depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
-        depthStencilDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-        depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
-
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_width, m_height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE), // Performance tip: Deny shader resource access to resources that don't need shader resource views.
-            D3D12_RESOURCE_STATE_DEPTH_WRITE,
-            &CD3DX12_CLEAR_VALUE(DXGI_FORMAT_D32_FLOAT, 1.0f, 0), // Performance tip: Tell the runtime at resource creation the desired clear value.
-            IID_PPV_ARGS(&m_depthStencil)
-        ));
-
-        m_device->CreateDepthStencilView(m_depthStencil.Get(), &depthStencilDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+        Rhi::TextureDesc depthStencilDesc = {};
+        depthStencilDesc.width = m_width;
+        depthStencilDesc.height = m_height;
+        depthStencilDesc.format = Rhi::Format::D32Float;
+        depthStencilDesc.usage = Rhi::TextureUsage::DepthStencil;
+        depthStencilDesc.initialState = Rhi::ResourceState::DepthWrite;
+        depthStencilDesc.clearDepth = 1.0f;
+        depthStencilDesc.clearStencil = 0;
+
+        m_depthStencil = m_device->CreateTexture2D(depthStencilDesc);
     }
 }
 
 // Load the sample assets.
 void D3D12HelloTransformations::LoadAssets()
 {
-    D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
-
-    // This is the highest version the sample supports. If CheckFeatureSupport succeeds, the HighestVersion returned will not be greater than this.
-    featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-
-    if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
-    {
-        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
-    }
-
-    // Create a root signature with one constant buffer view.
-    {
-        CD3DX12_ROOT_PARAMETER1 rp[1] = {};
-        rp[0].InitAsConstantBufferView(0, 0);
-
-        // Allow input layout and deny uneccessary access to certain pipeline stages.
-        D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
-            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
-
-        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
-        rootSignatureDesc.Init_1_1(_countof(rp), rp, 0, nullptr, rootSignatureFlags);
-
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> error;
-        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, featureData.HighestVersion, &signature, &error));
-        ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
-    }
+    m_numDrawCalls = 1 + m_sceneScale;
 
     // Create the constant buffer memory and map the resource
     {
-        const D3D12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        size_t cbSize = c_numDrawCalls * FrameCount * sizeof(ConstantBuffer);
+        size_t cbSize = m_numDrawCalls * FrameCount * sizeof(ConstantBuffer);
 
-        const D3D12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(cbSize);
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &uploadHeapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &constantBufferDesc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(m_perFrameConstants.ReleaseAndGetAddressOf())));
-
-        ThrowIfFailed(m_perFrameConstants->Map(0, nullptr, reinterpret_cast<void**>(&m_mappedConstantData)));
+        m_perFrameConstants = m_device->CreateBuffer(cbSize, Rhi::HeapType::Upload, Rhi::ResourceState::GenericRead);
+        m_mappedConstantData = static_cast<ConstantBuffer*>(m_perFrameConstants->Map());
 
         // GPU virtual address of the resource
-        m_constantDataGpuAddr = m_perFrameConstants->GetGPUVirtualAddress();
+        m_constantDataGpuAddr = m_perFrameConstants->GetGpuAddress();
     }
 
     // Create the pipeline state, which includes compiling and loading shaders.
     {
-        ComPtr<ID3DBlob> vertexShader;
-        ComPtr<ID3DBlob> pixelShader;
-
-#if defined(_DEBUG)
-        // Enable better shader debugging with the graphics debugging tools.
-        UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-        UINT compileFlags = 0;
-#endif
-
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
+        Rhi::GraphicsPipelineDesc psoDesc;
+        psoDesc.vertexShader = { GetAssetFullPath(L"shaders.hlsl"), "VSMain", "vs_5_0" };
+        psoDesc.pixelShader = { GetAssetFullPath(L"shaders.hlsl"), "PSMain", "ps_5_0" };
 
         // Define the vertex input layout.
-        D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
+        psoDesc.inputLayout =
         {
-            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-            { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+            { "POSITION", 0, Rhi::Format::R32G32B32Float, 0 },
+            { "COLOR", 0, Rhi::Format::R32G32B32A32Float, 12 }
         };
 
-        // Describe and create the graphics pipeline state object (PSO).
-        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-        psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
-        psoDesc.pRootSignature = m_rootSignature.Get();
-        psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
-        psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
-        psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-        psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-        psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-        psoDesc.SampleMask = UINT_MAX;
-        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-        psoDesc.NumRenderTargets = 1;
-        psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-        psoDesc.SampleDesc.Count = 1;
-        ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
+        // One constant buffer view, with the default rasterizer and depth states.
+        psoDesc.rootConstantBufferCount = 1;
+        psoDesc.renderTargetFormat = Rhi::Format::R8G8B8A8Unorm;
+        psoDesc.depthStencilFormat = Rhi::Format::D32Float;
+        m_pipelineState = m_device->CreateGraphicsPipelineState(psoDesc);
     }
 
-    // Create the command list.
-    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
-
-    // Command lists are created in the recording state, but there is nothing
-    // to record yet. The main loop expects it to be closed, so close it now.
-    ThrowIfFailed(m_commandList->Close());
+    // Create the command list, with a command allocator for each frame.
+    m_commandList = m_device->CreateCommandList(FrameCount);
+    m_commandList->SetStats(&m_renderStats);
+    m_benchmark.SetRenderStats(&m_renderStats);
 
     // Create the vertex and index buffers.
     {
@@ -299,25 +136,16 @@ void D3D12HelloTransformations::LoadAssets()
         // recommended. Every time the GPU needs it, the upload heap will be marshalled 
         // over. Please read up on Default Heap usage. An upload heap is used here for 
         // code simplicity and because there are very few verts to actually transfer.
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&m_vertexBuffer)));
+        m_vertexBuffer = m_device->CreateBuffer(vertexBufferSize, Rhi::HeapType::Upload, Rhi::ResourceState::GenericRead);
 
         // Copy the cube data to the vertex buffer.
-        UINT8* pVertexDataBegin = nullptr;
-        CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-        ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-        memcpy(pVertexDataBegin, cubeVertices, sizeof(cubeVertices));
-        m_vertexBuffer->Unmap(0, nullptr);
+        memcpy(m_vertexBuffer->Map(), cubeVertices, sizeof(cubeVertices));
+        m_vertexBuffer->Unmap();
 
         // Initialize the vertex buffer view.
-        m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-        m_vertexBufferView.StrideInBytes = sizeof(Vertex);
-        m_vertexBufferView.SizeInBytes = vertexBufferSize;
+        m_vertexBufferView.gpuAddress = m_vertexBuffer->GetGpuAddress();
+        m_vertexBufferView.strideInBytes = sizeof(Vertex);
+        m_vertexBufferView.sizeInBytes = vertexBufferSize;
 
         //    3________ 2
         //    /|      /|
@@ -357,37 +185,23 @@ void D3D12HelloTransformations::LoadAssets()
 
         const UINT indexBufferSize = sizeof(indices);
 
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&m_indexBuffer)));
+        m_indexBuffer = m_device->CreateBuffer(indexBufferSize, Rhi::HeapType::Upload, Rhi::ResourceState::GenericRead);
 
-        // Copy the cube data to the vertex buffer.
-        ThrowIfFailed(m_indexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-        memcpy(pVertexDataBegin, indices, sizeof(indices));
-        m_indexBuffer->Unmap(0, nullptr);
+        // Copy the cube data to the index buffer.
+        memcpy(m_indexBuffer->Map(), indices, sizeof(indices));
+        m_indexBuffer->Unmap();
 
-        // Initialize the vertex buffer view.
-        m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
-        m_indexBufferView.Format = DXGI_FORMAT_R16_UINT;
-        m_indexBufferView.SizeInBytes = indexBufferSize;
+        // Initialize the index buffer view.
+        m_indexBufferView.gpuAddress = m_indexBuffer->GetGpuAddress();
+        m_indexBufferView.format = Rhi::Format::R16Uint;
+        m_indexBufferView.sizeInBytes = indexBufferSize;
     }
 
     // Create synchronization objects and wait until assets have been uploaded to the GPU.
     {
-        ThrowIfFailed(m_device->CreateFence(m_fenceValues[m_frameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+        m_fence = m_device->CreateFence(m_fenceValues[m_frameIndex]);
         m_fenceValues[m_frameIndex]++;
 
-        // Create an event handle to use for frame synchronization.
-        m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-        if (m_fenceEvent == nullptr)
-        {
-            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-        }
-
         // Wait for the command list to execute; we are reusing the same command 
         // list in our main loop but for now, we just want to wait for setup to 
         // complete before continuing.
@@ -398,10 +212,13 @@ void D3D12HelloTransformations::LoadAssets()
 // Update frame-based values.
 void D3D12HelloTransformations::OnUpdate()
 {
-    const float rotationSpeed = 0.015f;
+    // Radians per second.
+    const float rotationSpeed = 0.9f;
+
+    m_timer.Tick();
 
     // Update the rotation constant
-    m_curRotationAngleRad += rotationSpeed;
+    m_curRotationAngleRad += rotationSpeed * static_cast<float>(m_timer.GetElapsedSeconds());
     if (m_curRotationAngleRad >= XM_2PI)
     {
         m_curRotationAngleRad -= XM_2PI;
@@ -415,16 +232,33 @@ void D3D12HelloTransformations::OnUpdate()
 void D3D12HelloTransformations::OnRender()
 {
     // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList();
+    {
+        BENCHMARK_PHASE(m_benchmark, "PopulateCommandList");
+        PopulateCommandList();
+    }
 
     // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    {
+        BENCHMARK_PHASE(m_benchmark, "ExecuteCommandList");
+        m_commandQueue->ExecuteCommandList(m_commandList.get());
+    }
 
     // Present the frame.
-    ThrowIfFailed(m_swapChain->Present(1, 0));
+    {
+        BENCHMARK_PHASE(m_benchmark, "Present");
+        m_swapChain->Present(m_syncInterval);
+    }
 
-    MoveToNextFrame();
+    {
+        BENCHMARK_PHASE(m_benchmark, "MoveToNextFrame");
+        MoveToNextFrame();
+    }
+
+    // Close the counters of this frame and periodically print a summary.
+    if (m_renderStats.EndFrame() % c_renderStatsDumpInterval == 0)
+    {
+        OutputDebugStringA(m_renderStats.FormatSummary(c_renderStatsDumpInterval).c_str());
+    }
 }
 
 void D3D12HelloTransformations::OnDestroy()
@@ -432,32 +266,23 @@ void D3D12HelloTransformations::OnDestroy()
     // Ensure that the GPU is no longer referencing resources that are about to be
     // cleaned up by the destructor.
     WaitForGpu();
-
-    CloseHandle(m_fenceEvent);
 }
 
 // Record commands in command list
 void D3D12HelloTransformations::PopulateCommandList()
 {
-    // Command list allocators can only be reset when the associated 
-    // command lists have finished execution on the GPU; apps should use 
-    // fences to determine GPU execution progress.
-    ThrowIfFailed(m_commandAllocators[m_frameIndex]->Reset());
-
-    // However, when ExecuteCommandList() is called on a particular command 
-    // list, that command list can then be reset at any time and must be before 
-    // re-recording.
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
+    // The command allocator of this frame can only be reset because the fence
+    // wait in MoveToNextFrame() guarantees that the GPU has finished with it.
+    m_commandList->Reset(m_frameIndex, m_pipelineState.get());
 
     // Set necessary state.
-    m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-    m_commandList->RSSetViewports(1, &m_viewport);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
+    m_commandList->SetViewport(m_viewport);
+    m_commandList->SetScissorRect(m_scissorRect);
 
     // Index into the available constant buffers based on the number
     // of draw calls. We've allocated enough for a known number of
     // draw calls per frame times the number of back buffers
-    unsigned int constantBufferIndex = c_numDrawCalls * (m_frameIndex % FrameCount);
+    unsigned int constantBufferIndex = m_numDrawCalls * (m_frameIndex % FrameCount);
 
     // Set the per-frame constants
     ConstantBuffer cbParameters = {};
@@ -468,66 +293,71 @@ void D3D12HelloTransformations::PopulateCommandList()
     XMStoreFloat4x4(&cbParameters.projectionMatrix, XMMatrixTranspose(m_projectionMatrix));
 
     // Set the constants for the first draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
     // Bind the constants to the shader
     auto baseGpuAddress = m_constantDataGpuAddr + sizeof(ConstantBuffer) * constantBufferIndex;
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    m_commandList->SetGraphicsRootConstantBuffer(0, baseGpuAddress);
 
     // Indicate that the back buffer will be used as a render target.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    Rhi::Resource* pRenderTarget = m_swapChain->GetBackBuffer(m_frameIndex);
+    m_commandList->ResourceBarrier(pRenderTarget, Rhi::ResourceState::Present, Rhi::ResourceState::RenderTarget);
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
-    CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
-    m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+    m_commandList->SetRenderTarget(pRenderTarget, m_depthStencil.get());
 
     // Clear the render target and depth buffer
     const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-    m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-    m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+    m_commandList->ClearRenderTarget(pRenderTarget, clearColor);
+    m_commandList->ClearDepthStencil(m_depthStencil.get(), Rhi::ClearDepth, 1.0f, 0);
 
     // Set up the input assembler
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-    m_commandList->IASetIndexBuffer(&m_indexBufferView);
+    m_commandList->SetPrimitiveTopology(Rhi::PrimitiveTopology::TriangleList);
+    m_commandList->SetVertexBuffer(0, m_vertexBufferView);
+    m_commandList->SetIndexBuffer(m_indexBufferView);
 
     // Draw the first cube
     m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
     baseGpuAddress += sizeof(ConstantBuffer);
     ++constantBufferIndex;
 
-    // Update the World matrix of the second cube
-    XMMATRIX scaleMatrix = XMMatrixScaling(0.2f, 0.2f, 0.2f);
-    XMMATRIX rotationMatrix = XMMatrixRotationY(-2.0f * m_curRotationAngleRad);
-    XMMATRIX translateMatrix = XMMatrixTranslation(0.0f, 0.0f, -5.0f);
+    // The small cubes are spread evenly along the orbit.
+    const unsigned int orbitingCubeCount = m_numDrawCalls - 1;
+    for (unsigned int i = 0; i < orbitingCubeCount; ++i)
+    {
+        // Update the World matrix of the small cube
+        XMMATRIX scaleMatrix = XMMatrixScaling(0.2f, 0.2f, 0.2f);
+        XMMATRIX rotationMatrix = XMMatrixRotationY(-2.0f * m_curRotationAngleRad + i * XM_2PI / orbitingCubeCount);
+        XMMATRIX translateMatrix = XMMatrixTranslation(0.0f, 0.0f, -5.0f);
 
-    // Update the world variable to reflect the current light
-    XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose((scaleMatrix * translateMatrix) * rotationMatrix));
+        // Update the world variable to reflect the current light
+        XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose((scaleMatrix * translateMatrix) * rotationMatrix));
 
-    // Set the constants for the draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+        // Set the constants for the draw call
+        m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
-    // Bind the constants to the shader
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+        // Bind the constants to the shader
+        m_commandList->SetGraphicsRootConstantBuffer(0, baseGpuAddress);
 
-    // Draw the second cube
-    m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+        // Draw the small cube
+        m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+        baseGpuAddress += sizeof(ConstantBuffer);
+        ++constantBufferIndex;
+    }
 
     // Indicate that the back buffer will now be used to present.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    m_commandList->ResourceBarrier(pRenderTarget, Rhi::ResourceState::RenderTarget, Rhi::ResourceState::Present);
 
-    ThrowIfFailed(m_commandList->Close());
+    m_commandList->Close();
 }
 
 // Wait for pending GPU work to complete.
 void D3D12HelloTransformations::WaitForGpu()
 {
     // Schedule a Signal command in the queue.
-    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_fenceValues[m_frameIndex]));
+    m_commandQueue->Signal(m_fence.get(), m_fenceValues[m_frameIndex]);
 
     // Wait until the fence has been processed.
-    ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-    WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    m_renderStats.TimeFenceWait([this] { m_fence->Wait(m_fenceValues[m_frameIndex]); });
 
     // Increment the fence value for the current frame.
     m_fenceValues[m_frameIndex]++;
@@ -538,7 +368,7 @@ void D3D12HelloTransformations::MoveToNextFrame()
 {
     // Schedule a Signal command in the queue.
     const UINT64 currentFenceValue = m_fenceValues[m_frameIndex];
-    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
+    m_commandQueue->Signal(m_fence.get(), currentFenceValue);
 
     // Update the frame index.
     m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
@@ -546,8 +376,7 @@ void D3D12HelloTransformations::MoveToNextFrame()
     // If the next frame is not ready to be rendered yet, wait until it is ready.
     if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
     {
-        ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+        m_renderStats.TimeFenceWait([this] { m_fence->Wait(m_fenceValues[m_frameIndex]); });
     }
 
     // Set the fence value for the next frame.
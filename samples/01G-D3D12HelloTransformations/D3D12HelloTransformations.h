@@ -12,15 +12,16 @@
 #pragma once
 
 #include "DXSample.h"
+#include "StepTimer.h"
+#include "Rhi.h"
 
 using namespace DirectX;
 
-// Note that while ComPtr is used to manage the lifetime of resources on the CPU,
+// Note that while std::unique_ptr is used to manage the lifetime of RHI objects on the CPU,
 // it has no understanding of the lifetime of resources on the GPU. Apps must account
 // for the GPU lifetime of resources to avoid destroying objects that may still be
 // referenced by the GPU.
 // An example of this can be found in the class method: OnDestroy().
-using Microsoft::WRL::ComPtr;
 
 class D3D12HelloTransformations : public DXSample
 {
@@ -61,42 +62,37 @@ private:
     static_assert((sizeof(ConstantBuffer) % 256) == 0, "Constant Buffer size must be 256-byte aligned");
 
     // Pipeline objects.
-    CD3DX12_VIEWPORT m_viewport;
-    CD3DX12_RECT m_scissorRect;
-    ComPtr<IDXGISwapChain3> m_swapChain;
-    ComPtr<ID3D12Device> m_device;
-    ComPtr<ID3D12Resource> m_renderTargets[FrameCount];
-    ComPtr<ID3D12Resource> m_depthStencil;
-    ComPtr<ID3D12CommandAllocator> m_commandAllocators[FrameCount];
-    ComPtr<ID3D12CommandQueue> m_commandQueue;
-    ComPtr<ID3D12RootSignature> m_rootSignature;
-    ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
-    ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
-    ComPtr<ID3D12PipelineState> m_pipelineState;
-    ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    Rhi::Viewport m_viewport;
+    Rhi::Rect m_scissorRect;
+    std::unique_ptr<Rhi::Device> m_device;
+    std::unique_ptr<Rhi::CommandQueue> m_commandQueue;
+    std::unique_ptr<Rhi::SwapChain> m_swapChain;
+    std::unique_ptr<Rhi::Resource> m_depthStencil;
+    std::unique_ptr<Rhi::PipelineState> m_pipelineState;
+    std::unique_ptr<Rhi::CommandList> m_commandList;    // Counts the recorded commands into m_renderStats.
+    RenderStats m_renderStats;
 
     // App resources.
-    ComPtr<ID3D12Resource> m_vertexBuffer;
-    ComPtr<ID3D12Resource> m_indexBuffer;
-    ComPtr<ID3D12Resource> m_perFrameConstants;
-    D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-    D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
-    D3D12_GPU_VIRTUAL_ADDRESS m_constantDataGpuAddr;
+    std::unique_ptr<Rhi::Resource> m_vertexBuffer;
+    std::unique_ptr<Rhi::Resource> m_indexBuffer;
+    std::unique_ptr<Rhi::Resource> m_perFrameConstants;
+    Rhi::VertexBufferView m_vertexBufferView;
+    Rhi::IndexBufferView m_indexBufferView;
+    UINT64 m_constantDataGpuAddr;
     ConstantBuffer* m_mappedConstantData;
-    UINT m_rtvDescriptorSize;
 
     // Synchronization objects.
     UINT m_frameIndex;
-    HANDLE m_fenceEvent;
-    ComPtr<ID3D12Fence> m_fence;
+    std::unique_ptr<Rhi::Fence> m_fence;
     UINT64 m_fenceValues[FrameCount];
 
     // Scene constants, updated per-frame
+    StepTimer m_timer;
     float m_curRotationAngleRad;
 
-    // In this simple sample, we know that there are two draw calls
-    // and we will update the scene constants for each draw call.
-    static const unsigned int c_numDrawCalls = 2;
+    // The large cube and the small cubes orbiting it (one per unit of scene scale) each
+    // take a draw call, and we will update the scene constants for each draw call.
+    unsigned int m_numDrawCalls;
 
     // These computed values will be loaded into a ConstantBuffer
     // during Render
@@ -104,6 +100,9 @@ private:
     XMMATRIX m_viewMatrix;
     XMMATRIX m_projectionMatrix;
 
+    // Frames between two dumps of the render stats to the debugger output.
+    static const UINT c_renderStatsDumpInterval = 300;
+
     void LoadPipeline();
     void LoadAssets();
     void PopulateCommandList();
@@ -12,23 +12,16 @@
 #pragma once
 
 #include "DXSampleHelper.h"
-#include "Win32Application.h"
+#include "Platform.h"
+#include "Benchmark.h"
 
-class DXSample
+// The Win32Application or the HeadlessPlatform runs the sample, as a PlatformApp.
+class DXSample : public PlatformApp
 {
 public:
     DXSample(UINT width, UINT height, std::wstring name);
     virtual ~DXSample();
 
-    virtual void OnInit() = 0;
-    virtual void OnUpdate() = 0;
-    virtual void OnRender() = 0;
-    virtual void OnDestroy() = 0;
-
-    // Samples override the event handlers to handle specific messages.
-    virtual void OnKeyDown(UINT8 /*key*/)   {}
-    virtual void OnKeyUp(UINT8 /*key*/)     {}
-
     // Accessors.
     UINT GetWidth() const           { return m_width; }
     UINT GetHeight() const          { return m_height; }
@@ -36,6 +29,10 @@ public:
 
     void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
 
+    // Benchmark mode (-bench), in which the platform renders the frames back to back.
+    Benchmark& GetBenchmark() override  { return m_benchmark; }
+    void WriteBenchmarkReport() override;
+
 protected:
     std::wstring GetAssetFullPath(LPCWSTR assetName);
 
@@ -53,6 +50,16 @@ protected:
 
     // Adapter info.
     bool m_useWarpDevice;
+    bool m_useNullDevice;   // Run on the RHI null device, without a GPU.
+
+    // Number of copies of the scene's objects (-scene-scale), to scale the CPU and GPU load.
+    UINT m_sceneScale;
+
+    // Vertical blanks to wait for at each present. The benchmark mode doesn't wait.
+    UINT m_syncInterval;
+
+    // Samples time the phases of their frames with BENCHMARK_PHASE(m_benchmark, ...).
+    Benchmark m_benchmark;
 
 private:
     // Root assets path.
@@ -60,4 +67,7 @@ private:
 
     // Window title.
     std::wstring m_title;
+
+    // The benchmark report is saved to <path>.csv (one row per frame) and <path>.json (summary).
+    std::wstring m_benchmarkReportPath;
 };
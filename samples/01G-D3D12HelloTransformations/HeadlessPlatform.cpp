@@ -0,0 +1,165 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "HeadlessPlatform.h"
+
+#include <chrono>
+#include <thread>
+
+HeadlessPlatform::HeadlessPlatform(const HeadlessPlatformDesc& desc) :
+    m_desc(desc),
+    m_paused(false),
+    m_quitRequested(false),
+    m_frameCount(0),
+    m_blockCount(0)
+{
+}
+
+int HeadlessPlatform::Run(PlatformApp* pApp)
+{
+    using Clock = std::chrono::steady_clock;
+
+    m_frameCount = 0;
+    m_blockCount = 0;
+
+    pApp->SetPlatform(this);
+    pApp->OnInit();
+
+    Benchmark& benchmark = pApp->GetBenchmark();
+    const bool paced = !benchmark.IsEnabled() && m_desc.frameIntervalSeconds > 0.0;
+    const Clock::duration frameInterval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(m_desc.frameIntervalSeconds));
+    Clock::time_point nextFrame = Clock::now();
+
+    for (;;)
+    {
+        // The app is called without the lock, so that its handlers can pause or quit.
+        std::deque<KeyEvent> keyEvents;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            keyEvents.swap(m_keyEvents);
+        }
+        if (!benchmark.IsEnabled())
+        {
+            for (const KeyEvent& keyEvent : keyEvents)
+            {
+                if (keyEvent.down)
+                {
+                    pApp->OnKeyDown(keyEvent.key);
+                }
+                else
+                {
+                    pApp->OnKeyUp(keyEvent.key);
+                }
+            }
+        }
+
+        FrameLoopState state = {};
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            state.quitRequested = m_quitRequested || (m_desc.frameCount > 0 && m_frameCount >= m_desc.frameCount);
+            state.paused = m_paused;
+        }
+        state.benchmarkEnabled = benchmark.IsEnabled();
+        state.benchmarkFinished = benchmark.IsFinished();
+
+        const FrameLoopAction action = ChooseFrameLoopAction(state);
+        if (action == FrameLoopAction::Quit)
+        {
+            break;
+        }
+
+        if (action == FrameLoopAction::Block)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ++m_blockCount;
+            m_wake.wait(lock, [this] { return !m_paused || m_quitRequested || !m_keyEvents.empty(); });
+
+            // The frames missed while paused aren't caught up on.
+            nextFrame = Clock::now();
+            continue;
+        }
+
+        if (paced)
+        {
+            // A late frame moves the next ones back rather than bringing a burst of them.
+            std::this_thread::sleep_until(nextFrame);
+            nextFrame += frameInterval;
+            const Clock::time_point now = Clock::now();
+            if (nextFrame < now)
+            {
+                nextFrame = now;
+            }
+        }
+
+        RunFrame(pApp);
+        ++m_frameCount;
+    }
+
+    pApp->OnDestroy();
+
+    if (benchmark.IsEnabled())
+    {
+        pApp->WriteBenchmarkReport();
+    }
+
+    return 0;
+}
+
+void HeadlessPlatform::SetWindowTitle(const std::wstring& title)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_title = title;
+}
+
+std::wstring HeadlessPlatform::GetWindowTitle() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_title;
+}
+
+void HeadlessPlatform::SetPaused(bool paused)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_paused = paused;
+    }
+    m_wake.notify_all();
+}
+
+void HeadlessPlatform::RequestQuit()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quitRequested = true;
+    }
+    m_wake.notify_all();
+}
+
+void HeadlessPlatform::PostKeyDown(uint8_t key)
+{
+    PostKeyEvent(key, true);
+}
+
+void HeadlessPlatform::PostKeyUp(uint8_t key)
+{
+    PostKeyEvent(key, false);
+}
+
+void HeadlessPlatform::PostKeyEvent(uint8_t key, bool down)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        KeyEvent keyEvent = { key, down };
+        m_keyEvents.push_back(keyEvent);
+    }
+    m_wake.notify_all();
+}
@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "Platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Settings of the loop without a window.
+struct HeadlessPlatformDesc
+{
+    // Frames to render before the loop ends. With 0, it runs until RequestQuit() or the end
+    // of the benchmark.
+    uint32_t frameCount = 0;
+
+    // Interval between the frames, as a display would pace them; with 0, they are rendered
+    // back to back. The benchmark mode always renders them back to back.
+    double frameIntervalSeconds = 1.0 / 60.0;
+};
+
+// Runs an app without a window, for the headless benchmarks and for machines without a
+// display: the swap chain renders to offscreen back buffers, the input comes from
+// PostKeyDown()/PostKeyUp(), and a paused loop sleeps until it's resumed.
+// The app is called from the thread of Run(); the other methods may be called from any
+// thread.
+class HeadlessPlatform : public Platform
+{
+public:
+    explicit HeadlessPlatform(const HeadlessPlatformDesc& desc = HeadlessPlatformDesc());
+
+    int Run(PlatformApp* pApp);
+
+    void* GetNativeWindow() const override  { return nullptr; }
+    void SetWindowTitle(const std::wstring& title) override;
+    void SetPaused(bool paused) override;
+    void RequestQuit() override;
+
+    // The keys are delivered to the app before the next frame, in order, and dropped in the
+    // benchmark mode.
+    void PostKeyDown(uint8_t key);
+    void PostKeyUp(uint8_t key);
+
+    std::wstring GetWindowTitle() const;
+
+    // Frames rendered, and times the loop blocked, since the start of Run().
+    uint32_t GetFrameCount() const          { return m_frameCount; }
+    uint32_t GetBlockCount() const          { return m_blockCount; }
+
+private:
+    struct KeyEvent
+    {
+        uint8_t key;
+        bool down;
+    };
+
+    void PostKeyEvent(uint8_t key, bool down);
+
+    HeadlessPlatformDesc m_desc;
+
+    // Guards the state below, which the loop waits on while it's paused.
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<KeyEvent> m_keyEvents;
+    std::wstring m_title;
+    bool m_paused;
+    bool m_quitRequested;
+
+    std::atomic<uint32_t> m_frameCount;
+    std::atomic<uint32_t> m_blockCount;
+};
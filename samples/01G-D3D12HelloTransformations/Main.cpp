@@ -11,10 +11,28 @@
 
 #include "stdafx.h"
 #include "D3D12HelloTransformations.h"
+#include "HeadlessPlatform.h"
+#include "Win32Application.h"
 
 _Use_decl_annotations_
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 {
     D3D12HelloTransformations sample(1280, 720, L"D3D12 Hello Transformations");
-    return Win32Application::Run(&sample, hInstance, nCmdShow);
+
+    // Parse the command line parameters
+    int argc;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    sample.ParseCommandLineArgs(argv, argc);
+    LocalFree(argv);
+
+    // -headless runs without a window, on offscreen back buffers: at the display rate
+    // until the process is stopped, or back to back until the end of the benchmark.
+    if (sample.GetBenchmark().GetSettings().headless)
+    {
+        HeadlessPlatform platform;
+        return platform.Run(&sample);
+    }
+
+    Win32Application application(hInstance, nCmdShow);
+    return application.Run(&sample);
 }
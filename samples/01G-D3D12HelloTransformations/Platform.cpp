@@ -0,0 +1,48 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Platform.h"
+
+FrameLoopAction ChooseFrameLoopAction(const FrameLoopState& state)
+{
+    if (state.quitRequested)
+    {
+        return FrameLoopAction::Quit;
+    }
+    if (state.benchmarkEnabled)
+    {
+        return state.benchmarkFinished ? FrameLoopAction::Quit : FrameLoopAction::Render;
+    }
+    return (state.minimized || state.paused) ? FrameLoopAction::Block : FrameLoopAction::Render;
+}
+
+// Render one frame, timing the update and the render separately in the benchmark mode.
+void Platform::RunFrame(PlatformApp* pApp)
+{
+    Benchmark& benchmark = pApp->GetBenchmark();
+    if (!benchmark.IsEnabled())
+    {
+        pApp->OnUpdate();
+        pApp->OnRender();
+        return;
+    }
+
+    benchmark.BeginFrame();
+    {
+        BENCHMARK_PHASE(benchmark, "OnUpdate");
+        pApp->OnUpdate();
+    }
+    {
+        BENCHMARK_PHASE(benchmark, "OnRender");
+        pApp->OnRender();
+    }
+    benchmark.EndFrame();
+}
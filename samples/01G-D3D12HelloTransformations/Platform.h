@@ -0,0 +1,95 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "Benchmark.h"
+
+#include <cstdint>
+#include <string>
+
+class Platform;
+
+// What a platform runs: the events and the frames of a sample. DXSample implements it.
+class PlatformApp
+{
+public:
+    PlatformApp() : m_pPlatform(nullptr) {}
+    virtual ~PlatformApp() {}
+
+    virtual void OnInit() = 0;
+    virtual void OnUpdate() = 0;
+    virtual void OnRender() = 0;
+    virtual void OnDestroy() = 0;
+
+    // Apps override the event handlers to handle specific keys.
+    virtual void OnKeyDown(uint8_t /*key*/)     {}
+    virtual void OnKeyUp(uint8_t /*key*/)       {}
+
+    // Benchmark mode, in which the frames are rendered back to back without input, and
+    // the run ends with the benchmark.
+    virtual Benchmark& GetBenchmark() = 0;
+    virtual void WriteBenchmarkReport() = 0;
+
+    // Set by the platform before OnInit().
+    void SetPlatform(Platform* pPlatform)       { m_pPlatform = pPlatform; }
+    Platform* GetPlatform() const               { return m_pPlatform; }
+
+private:
+    Platform* m_pPlatform;
+};
+
+// What the loop of a platform does next.
+enum class FrameLoopAction
+{
+    Render,     // Update and render a frame.
+    Block,      // Wait for an event without using the CPU.
+    Quit
+};
+
+struct FrameLoopState
+{
+    bool quitRequested;
+    bool minimized;
+    bool paused;
+    bool benchmarkEnabled;
+    bool benchmarkFinished;
+};
+
+// The policy of every platform: nothing is rendered while the window is minimized or the
+// loop is paused, and the loop sleeps until that changes. The benchmark mode renders all
+// its frames regardless, then quits.
+FrameLoopAction ChooseFrameLoopAction(const FrameLoopState& state);
+
+// Where the app runs: a window and its message loop, or a loop without a window. Each
+// platform calls the app from the thread that calls Run().
+class Platform
+{
+public:
+    virtual ~Platform() {}
+
+    // Native window to present to (the HWND on Windows), or null when there is none: the
+    // swap chain then renders to offscreen back buffers.
+    virtual void* GetNativeWindow() const = 0;
+
+    virtual void SetWindowTitle(const std::wstring& title) = 0;
+
+    // A paused loop renders nothing and blocks until it's resumed or ends. The benchmark
+    // mode ignores it.
+    virtual void SetPaused(bool paused) = 0;
+
+    // Ends the loop after the current frame.
+    virtual void RequestQuit() = 0;
+
+protected:
+    // Updates and renders a frame of the app, timed by its benchmark when it's enabled.
+    static void RunFrame(PlatformApp* pApp);
+};
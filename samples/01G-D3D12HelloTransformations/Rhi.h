@@ -0,0 +1,373 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RenderStats.h"
+
+// Rendering hardware interface.
+// The subset of a D3D12-style API used by the sample, expressed with portable types so
+// that the frame logic can run on two backends:
+//  - RhiD3D12.h, a thin layer over Direct3D 12;
+//  - RhiNull.h, which executes nothing but reproduces the queue, fence and upload
+//    memory behavior on the CPU, so the frame loop runs (and is timed) without a GPU.
+// Objects are owned through std::unique_ptr and errors are reported with exceptions.
+namespace Rhi
+{
+    enum class Format : uint32_t
+    {
+        Unknown,
+        R8G8B8A8Unorm,
+        R32G32Float,
+        R32G32B32Float,
+        R32G32B32A32Float,
+        R16Uint,
+        R32Uint,
+        D32Float,
+    };
+
+    inline uint32_t GetFormatSize(Format format)
+    {
+        switch (format)
+        {
+        case Format::R8G8B8A8Unorm:     return 4;
+        case Format::R32G32Float:       return 8;
+        case Format::R32G32B32Float:    return 12;
+        case Format::R32G32B32A32Float: return 16;
+        case Format::R16Uint:           return 2;
+        case Format::R32Uint:           return 4;
+        case Format::D32Float:          return 4;
+        default:                        return 0;
+        }
+    }
+
+    enum class HeapType : uint32_t
+    {
+        Default,    // GPU memory, not mappable.
+        Upload,     // CPU-writable memory read by the GPU.
+        Readback,   // GPU-writable memory read by the CPU.
+    };
+
+    enum class ResourceState : uint32_t
+    {
+        Common,
+        Present,
+        RenderTarget,
+        DepthWrite,
+        GenericRead,
+        CopySource,
+        CopyDest,
+    };
+
+    enum class TextureUsage : uint32_t
+    {
+        RenderTarget,
+        DepthStencil,
+    };
+
+    enum class PrimitiveTopology : uint32_t
+    {
+        PointList,
+        LineList,
+        LineStrip,
+        TriangleList,
+        TriangleStrip,
+    };
+
+    enum class CullMode : uint32_t
+    {
+        None,
+        Front,
+        Back,
+    };
+
+    enum class ComparisonFunc : uint32_t
+    {
+        Never,
+        Less,
+        Equal,
+        LessEqual,
+        Greater,
+        NotEqual,
+        GreaterEqual,
+        Always,
+    };
+
+    enum ClearFlags : uint32_t
+    {
+        ClearDepth = 0x1,
+        ClearStencil = 0x2,
+    };
+
+    struct Viewport
+    {
+        float topLeftX;
+        float topLeftY;
+        float width;
+        float height;
+        float minDepth;
+        float maxDepth;
+    };
+
+    struct Rect
+    {
+        int32_t left;
+        int32_t top;
+        int32_t right;
+        int32_t bottom;
+    };
+
+    struct VertexBufferView
+    {
+        uint64_t gpuAddress;
+        uint32_t sizeInBytes;
+        uint32_t strideInBytes;
+    };
+
+    struct IndexBufferView
+    {
+        uint64_t gpuAddress;
+        uint32_t sizeInBytes;
+        Format format;
+    };
+
+    struct TextureDesc
+    {
+        uint32_t width;
+        uint32_t height;
+        Format format;
+        TextureUsage usage;
+        ResourceState initialState;
+
+        // Optimized clear value.
+        float clearColor[4];
+        float clearDepth;
+        uint8_t clearStencil;
+    };
+
+    struct InputElement
+    {
+        const char* semanticName;
+        uint32_t semanticIndex;
+        Format format;
+        uint32_t alignedByteOffset;
+    };
+
+    // HLSL entry point in a source file.
+    struct ShaderDesc
+    {
+        std::wstring fileName;
+        std::string entryPoint;
+        std::string target;
+    };
+
+    struct RasterizerDesc
+    {
+        CullMode cullMode = CullMode::Back;
+        bool frontCounterClockwise = false;
+    };
+
+    struct DepthStencilDesc
+    {
+        bool depthEnable = true;
+        bool depthWrite = true;
+        ComparisonFunc depthFunc = ComparisonFunc::Less;
+    };
+
+    struct GraphicsPipelineDesc
+    {
+        ShaderDesc vertexShader;
+        ShaderDesc pixelShader;
+        std::vector<InputElement> inputLayout;
+
+        // Root constant buffer views bound to registers b0 .. b(count - 1).
+        uint32_t rootConstantBufferCount = 1;
+
+        RasterizerDesc rasterizer;
+        DepthStencilDesc depthStencil;
+        PrimitiveTopology topology = PrimitiveTopology::TriangleList;
+        Format renderTargetFormat = Format::R8G8B8A8Unorm;
+        Format depthStencilFormat = Format::D32Float;
+    };
+
+    class Resource
+    {
+    public:
+        virtual ~Resource() {}
+
+        // Only resources in upload and readback heaps can be mapped. The pointer stays valid until Unmap().
+        virtual void* Map() = 0;
+        virtual void Unmap() = 0;
+
+        virtual uint64_t GetGpuAddress() const = 0;
+        virtual uint64_t GetSize() const = 0;
+    };
+
+    class PipelineState
+    {
+    public:
+        virtual ~PipelineState() {}
+    };
+
+    class Fence
+    {
+    public:
+        virtual ~Fence() {}
+
+        virtual uint64_t GetCompletedValue() const = 0;
+
+        // Block the calling thread until the fence reaches value.
+        virtual void Wait(uint64_t value) = 0;
+    };
+
+    // Command list with its own set of command allocators, one per frame in flight.
+    // Draws, pipeline state changes, root constant buffer binds and barriers are
+    // counted into the RenderStats set with SetStats(), whatever the backend.
+    class CommandList
+    {
+    public:
+        CommandList() : m_pStats(nullptr), m_pPipelineState(nullptr) {}
+        virtual ~CommandList() {}
+
+        void SetStats(RenderStats* pStats) { m_pStats = pStats; }
+
+        // Start recording with the allocator allocatorIndex. The GPU must have finished
+        // the commands previously recorded with that allocator.
+        void Reset(uint32_t allocatorIndex, PipelineState* pInitialState)
+        {
+            m_pPipelineState = nullptr;
+            if (pInitialState != nullptr)
+            {
+                CountPipelineState(pInitialState);
+            }
+            ResetImpl(allocatorIndex, pInitialState);
+        }
+
+        virtual void Close() = 0;
+
+        void SetPipelineState(PipelineState* pPipelineState)
+        {
+            CountPipelineState(pPipelineState);
+            SetPipelineStateImpl(pPipelineState);
+        }
+
+        void SetGraphicsRootConstantBuffer(uint32_t rootIndex, uint64_t gpuAddress)
+        {
+            Count(RenderCounter::RootConstantBufferBinds, 1);
+            SetGraphicsRootConstantBufferImpl(rootIndex, gpuAddress);
+        }
+
+        void ResourceBarrier(Resource* pResource, ResourceState before, ResourceState after)
+        {
+            Count(RenderCounter::ResourceBarriers, 1);
+            ResourceBarrierImpl(pResource, before, after);
+        }
+
+        void DrawInstanced(uint32_t vertexCountPerInstance, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+        {
+            Count(RenderCounter::DrawCalls, 1);
+            Count(RenderCounter::Instances, instanceCount);
+            DrawInstancedImpl(vertexCountPerInstance, instanceCount, startVertex, startInstance);
+        }
+
+        void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+        {
+            Count(RenderCounter::DrawCalls, 1);
+            Count(RenderCounter::Instances, instanceCount);
+            DrawIndexedInstancedImpl(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+        }
+
+        virtual void SetViewport(const Viewport& viewport) = 0;
+        virtual void SetScissorRect(const Rect& rect) = 0;
+        virtual void SetRenderTarget(Resource* pRenderTarget, Resource* pDepthStencil) = 0;
+        virtual void ClearRenderTarget(Resource* pRenderTarget, const float color[4]) = 0;
+        virtual void ClearDepthStencil(Resource* pDepthStencil, uint32_t clearFlags, float depth, uint8_t stencil) = 0;
+        virtual void SetPrimitiveTopology(PrimitiveTopology topology) = 0;
+        virtual void SetVertexBuffer(uint32_t slot, const VertexBufferView& view) = 0;
+        virtual void SetIndexBuffer(const IndexBufferView& view) = 0;
+        virtual void CopyResource(Resource* pDestination, Resource* pSource) = 0;
+
+    protected:
+        virtual void ResetImpl(uint32_t allocatorIndex, PipelineState* pInitialState) = 0;
+        virtual void SetPipelineStateImpl(PipelineState* pPipelineState) = 0;
+        virtual void SetGraphicsRootConstantBufferImpl(uint32_t rootIndex, uint64_t gpuAddress) = 0;
+        virtual void ResourceBarrierImpl(Resource* pResource, ResourceState before, ResourceState after) = 0;
+        virtual void DrawInstancedImpl(uint32_t vertexCountPerInstance, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) = 0;
+        virtual void DrawIndexedInstancedImpl(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) = 0;
+
+    private:
+        void Count(RenderCounter counter, uint64_t value)
+        {
+            if (m_pStats != nullptr)
+            {
+                m_pStats->Add(counter, value);
+            }
+        }
+
+        void CountPipelineState(PipelineState* pPipelineState)
+        {
+            Count(pPipelineState == m_pPipelineState ? RenderCounter::RedundantPipelineStates : RenderCounter::PipelineStateChanges, 1);
+            m_pPipelineState = pPipelineState;
+        }
+
+        RenderStats* m_pStats;
+        PipelineState* m_pPipelineState;
+    };
+
+    class CommandQueue
+    {
+    public:
+        virtual ~CommandQueue() {}
+
+        virtual void ExecuteCommandList(CommandList* pCommandList) = 0;
+
+        // Set the fence to value once the GPU has executed everything submitted before.
+        virtual void Signal(Fence* pFence, uint64_t value) = 0;
+    };
+
+    class SwapChain
+    {
+    public:
+        virtual ~SwapChain() {}
+
+        virtual uint32_t GetCurrentBackBufferIndex() const = 0;
+        virtual Resource* GetBackBuffer(uint32_t index) = 0;
+
+        // syncInterval 0 presents immediately, 1 waits for the next vertical blank.
+        virtual void Present(uint32_t syncInterval) = 0;
+    };
+
+    class Device
+    {
+    public:
+        virtual ~Device() {}
+
+        virtual const char* GetName() const = 0;
+
+        virtual std::unique_ptr<CommandQueue> CreateCommandQueue() = 0;
+
+        // window is the native window handle (HWND on Windows); the null backend ignores it.
+        // Without a window, the back buffers are offscreen textures and Present() only moves
+        // to the next one.
+        virtual std::unique_ptr<SwapChain> CreateSwapChain(CommandQueue* pQueue, void* window, uint32_t width, uint32_t height, uint32_t bufferCount, Format format) = 0;
+
+        virtual std::unique_ptr<Resource> CreateBuffer(uint64_t size, HeapType heapType, ResourceState initialState) = 0;
+        virtual std::unique_ptr<Resource> CreateTexture2D(const TextureDesc& desc) = 0;
+        virtual std::unique_ptr<Fence> CreateFence(uint64_t initialValue) = 0;
+        virtual std::unique_ptr<CommandList> CreateCommandList(uint32_t allocatorCount) = 0;
+        virtual std::unique_ptr<PipelineState> CreateGraphicsPipelineState(const GraphicsPipelineDesc& desc) = 0;
+    };
+}
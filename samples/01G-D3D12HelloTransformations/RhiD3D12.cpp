@@ -0,0 +1,837 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "RhiD3D12.h"
+#include "DXSampleHelper.h"
+
+#include <map>
+
+using Microsoft::WRL::ComPtr;
+
+namespace Rhi
+{
+namespace
+{
+    // Render target and depth stencil views are allocated linearly and never recycled:
+    // the samples create their targets once, at startup.
+    const UINT c_maxRenderTargetViews = 16;
+    const UINT c_maxDepthStencilViews = 8;
+
+    DXGI_FORMAT ToDxgiFormat(Format format)
+    {
+        switch (format)
+        {
+        case Format::R8G8B8A8Unorm:     return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case Format::R32G32Float:       return DXGI_FORMAT_R32G32_FLOAT;
+        case Format::R32G32B32Float:    return DXGI_FORMAT_R32G32B32_FLOAT;
+        case Format::R32G32B32A32Float: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case Format::R16Uint:           return DXGI_FORMAT_R16_UINT;
+        case Format::R32Uint:           return DXGI_FORMAT_R32_UINT;
+        case Format::D32Float:          return DXGI_FORMAT_D32_FLOAT;
+        default:                        return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+    D3D12_RESOURCE_STATES ToD3D12State(ResourceState state)
+    {
+        switch (state)
+        {
+        case ResourceState::Present:        return D3D12_RESOURCE_STATE_PRESENT;
+        case ResourceState::RenderTarget:   return D3D12_RESOURCE_STATE_RENDER_TARGET;
+        case ResourceState::DepthWrite:     return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+        case ResourceState::GenericRead:    return D3D12_RESOURCE_STATE_GENERIC_READ;
+        case ResourceState::CopySource:     return D3D12_RESOURCE_STATE_COPY_SOURCE;
+        case ResourceState::CopyDest:       return D3D12_RESOURCE_STATE_COPY_DEST;
+        default:                            return D3D12_RESOURCE_STATE_COMMON;
+        }
+    }
+
+    D3D12_HEAP_TYPE ToD3D12HeapType(HeapType heapType)
+    {
+        switch (heapType)
+        {
+        case HeapType::Upload:      return D3D12_HEAP_TYPE_UPLOAD;
+        case HeapType::Readback:    return D3D12_HEAP_TYPE_READBACK;
+        default:                    return D3D12_HEAP_TYPE_DEFAULT;
+        }
+    }
+
+    D3D12_PRIMITIVE_TOPOLOGY ToD3D12Topology(PrimitiveTopology topology)
+    {
+        switch (topology)
+        {
+        case PrimitiveTopology::PointList:      return D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+        case PrimitiveTopology::LineList:       return D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+        case PrimitiveTopology::LineStrip:      return D3D_PRIMITIVE_TOPOLOGY_LINESTRIP;
+        case PrimitiveTopology::TriangleStrip:  return D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+        default:                                return D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        }
+    }
+
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE ToD3D12TopologyType(PrimitiveTopology topology)
+    {
+        switch (topology)
+        {
+        case PrimitiveTopology::PointList:  return D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
+        case PrimitiveTopology::LineList:
+        case PrimitiveTopology::LineStrip:  return D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+        default:                            return D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        }
+    }
+
+    D3D12_COMPARISON_FUNC ToD3D12ComparisonFunc(ComparisonFunc func)
+    {
+        // The D3D12 values follow the same order, starting at 1.
+        return static_cast<D3D12_COMPARISON_FUNC>(static_cast<UINT>(func) + D3D12_COMPARISON_FUNC_NEVER);
+    }
+
+    D3D12_CULL_MODE ToD3D12CullMode(CullMode cullMode)
+    {
+        switch (cullMode)
+        {
+        case CullMode::None:    return D3D12_CULL_MODE_NONE;
+        case CullMode::Front:   return D3D12_CULL_MODE_FRONT;
+        default:                return D3D12_CULL_MODE_BACK;
+        }
+    }
+
+    // Helper function for acquiring the first available hardware adapter that supports Direct3D 12.
+    // If no such adapter can be found, *ppAdapter will be set to nullptr.
+    void GetHardwareAdapter(IDXGIFactory1* pFactory, IDXGIAdapter1** ppAdapter)
+    {
+        *ppAdapter = nullptr;
+
+        ComPtr<IDXGIAdapter1> adapter;
+        for (UINT adapterIndex = 0; SUCCEEDED(pFactory->EnumAdapters1(adapterIndex, &adapter)); ++adapterIndex)
+        {
+            DXGI_ADAPTER_DESC1 desc;
+            adapter->GetDesc1(&desc);
+
+            if (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE)
+            {
+                // Don't select the Basic Render Driver adapter.
+                // If you want a software adapter, pass in "/warp" on the command line.
+                continue;
+            }
+
+            // Check to see whether the adapter supports Direct3D 12, but don't create the
+            // actual device yet.
+            if (SUCCEEDED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, _uuidof(ID3D12Device), nullptr)))
+            {
+                break;
+            }
+        }
+
+        *ppAdapter = adapter.Detach();
+    }
+
+    // Linear allocator of CPU descriptors in a non shader-visible heap.
+    class DescriptorAllocator
+    {
+    public:
+        void Initialize(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT capacity)
+        {
+            D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+            heapDesc.NumDescriptors = capacity;
+            heapDesc.Type = type;
+            heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+            ThrowIfFailed(pDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_heap)));
+
+            m_capacity = capacity;
+            m_count = 0;
+            m_descriptorSize = pDevice->GetDescriptorHandleIncrementSize(type);
+        }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE Allocate()
+        {
+            if (m_count == m_capacity)
+            {
+                throw std::runtime_error("Out of descriptors.");
+            }
+            return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_heap->GetCPUDescriptorHandleForHeapStart(), m_count++, m_descriptorSize);
+        }
+
+    private:
+        ComPtr<ID3D12DescriptorHeap> m_heap;
+        UINT m_capacity;
+        UINT m_count;
+        UINT m_descriptorSize;
+    };
+
+    class D3D12Resource : public Resource
+    {
+    public:
+        D3D12Resource(ComPtr<ID3D12Resource> resource, HeapType heapType) :
+            m_renderTargetView(),
+            m_depthStencilView(),
+            m_resource(resource),
+            m_heapType(heapType)
+        {
+        }
+
+        void* Map() override
+        {
+            // Upload memory is never read back on the CPU.
+            const CD3DX12_RANGE readRange(0, 0);
+            void* pData;
+            ThrowIfFailed(m_resource->Map(0, m_heapType == HeapType::Readback ? nullptr : &readRange, &pData));
+            return pData;
+        }
+
+        void Unmap() override
+        {
+            const CD3DX12_RANGE writtenRange(0, 0);
+            m_resource->Unmap(0, m_heapType == HeapType::Readback ? &writtenRange : nullptr);
+        }
+
+        uint64_t GetGpuAddress() const override
+        {
+            return m_resource->GetDesc().Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? m_resource->GetGPUVirtualAddress() : 0;
+        }
+
+        uint64_t GetSize() const override
+        {
+            return m_resource->GetDesc().Width;
+        }
+
+        ID3D12Resource* Get() const { return m_resource.Get(); }
+
+        // Views created by the device, if the resource is a render target or a depth stencil.
+        D3D12_CPU_DESCRIPTOR_HANDLE m_renderTargetView;
+        D3D12_CPU_DESCRIPTOR_HANDLE m_depthStencilView;
+
+    private:
+        ComPtr<ID3D12Resource> m_resource;
+        HeapType m_heapType;
+    };
+
+    class D3D12PipelineState : public PipelineState
+    {
+    public:
+        D3D12PipelineState(ComPtr<ID3D12PipelineState> pipelineState, ComPtr<ID3D12RootSignature> rootSignature) :
+            m_pipelineState(pipelineState),
+            m_rootSignature(rootSignature)
+        {
+        }
+
+        ID3D12PipelineState* Get() const                { return m_pipelineState.Get(); }
+        ID3D12RootSignature* GetRootSignature() const   { return m_rootSignature.Get(); }
+
+    private:
+        ComPtr<ID3D12PipelineState> m_pipelineState;
+        ComPtr<ID3D12RootSignature> m_rootSignature;
+    };
+
+    class D3D12Fence : public Fence
+    {
+    public:
+        D3D12Fence(ID3D12Device* pDevice, uint64_t initialValue)
+        {
+            ThrowIfFailed(pDevice->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+
+            // Create an event handle to use for waits.
+            m_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+            if (m_event == nullptr)
+            {
+                ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+            }
+        }
+
+        ~D3D12Fence()
+        {
+            CloseHandle(m_event);
+        }
+
+        uint64_t GetCompletedValue() const override
+        {
+            return m_fence->GetCompletedValue();
+        }
+
+        void Wait(uint64_t value) override
+        {
+            if (m_fence->GetCompletedValue() < value)
+            {
+                ThrowIfFailed(m_fence->SetEventOnCompletion(value, m_event));
+                WaitForSingleObjectEx(m_event, INFINITE, FALSE);
+            }
+        }
+
+        ID3D12Fence* Get() const { return m_fence.Get(); }
+
+    private:
+        ComPtr<ID3D12Fence> m_fence;
+        HANDLE m_event;
+    };
+
+    class D3D12CommandList : public CommandList
+    {
+    public:
+        D3D12CommandList(ID3D12Device* pDevice, uint32_t allocatorCount) :
+            m_allocators(allocatorCount),
+            m_pRootSignature(nullptr)
+        {
+            for (auto& allocator : m_allocators)
+            {
+                ThrowIfFailed(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+            }
+            ThrowIfFailed(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_allocators[0].Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+
+            // Command lists are created in the recording state, but there is nothing
+            // to record yet. The main loop expects it to be closed, so close it now.
+            ThrowIfFailed(m_commandList->Close());
+        }
+
+        void Close() override
+        {
+            ThrowIfFailed(m_commandList->Close());
+        }
+
+        void SetViewport(const Viewport& viewport) override
+        {
+            const D3D12_VIEWPORT d3d12Viewport = { viewport.topLeftX, viewport.topLeftY, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+            m_commandList->RSSetViewports(1, &d3d12Viewport);
+        }
+
+        void SetScissorRect(const Rect& rect) override
+        {
+            const D3D12_RECT d3d12Rect = { rect.left, rect.top, rect.right, rect.bottom };
+            m_commandList->RSSetScissorRects(1, &d3d12Rect);
+        }
+
+        void SetRenderTarget(Resource* pRenderTarget, Resource* pDepthStencil) override
+        {
+            const D3D12_CPU_DESCRIPTOR_HANDLE* pRtvHandle = pRenderTarget ? &static_cast<D3D12Resource*>(pRenderTarget)->m_renderTargetView : nullptr;
+            const D3D12_CPU_DESCRIPTOR_HANDLE* pDsvHandle = pDepthStencil ? &static_cast<D3D12Resource*>(pDepthStencil)->m_depthStencilView : nullptr;
+            m_commandList->OMSetRenderTargets(pRtvHandle ? 1 : 0, pRtvHandle, FALSE, pDsvHandle);
+        }
+
+        void ClearRenderTarget(Resource* pRenderTarget, const float color[4]) override
+        {
+            m_commandList->ClearRenderTargetView(static_cast<D3D12Resource*>(pRenderTarget)->m_renderTargetView, color, 0, nullptr);
+        }
+
+        void ClearDepthStencil(Resource* pDepthStencil, uint32_t clearFlags, float depth, uint8_t stencil) override
+        {
+            D3D12_CLEAR_FLAGS flags = static_cast<D3D12_CLEAR_FLAGS>(0);
+            if (clearFlags & ClearDepth)
+            {
+                flags |= D3D12_CLEAR_FLAG_DEPTH;
+            }
+            if (clearFlags & ClearStencil)
+            {
+                flags |= D3D12_CLEAR_FLAG_STENCIL;
+            }
+            m_commandList->ClearDepthStencilView(static_cast<D3D12Resource*>(pDepthStencil)->m_depthStencilView, flags, depth, stencil, 0, nullptr);
+        }
+
+        void SetPrimitiveTopology(PrimitiveTopology topology) override
+        {
+            m_commandList->IASetPrimitiveTopology(ToD3D12Topology(topology));
+        }
+
+        void SetVertexBuffer(uint32_t slot, const VertexBufferView& view) override
+        {
+            const D3D12_VERTEX_BUFFER_VIEW d3d12View = { view.gpuAddress, view.sizeInBytes, view.strideInBytes };
+            m_commandList->IASetVertexBuffers(slot, 1, &d3d12View);
+        }
+
+        void SetIndexBuffer(const IndexBufferView& view) override
+        {
+            const D3D12_INDEX_BUFFER_VIEW d3d12View = { view.gpuAddress, view.sizeInBytes, ToDxgiFormat(view.format) };
+            m_commandList->IASetIndexBuffer(&d3d12View);
+        }
+
+        void CopyResource(Resource* pDestination, Resource* pSource) override
+        {
+            m_commandList->CopyResource(static_cast<D3D12Resource*>(pDestination)->Get(), static_cast<D3D12Resource*>(pSource)->Get());
+        }
+
+        ID3D12GraphicsCommandList* Get() const { return m_commandList.Get(); }
+
+    protected:
+        void ResetImpl(uint32_t allocatorIndex, PipelineState* pInitialState) override
+        {
+            // Command list allocators can only be reset when the associated
+            // command lists have finished execution on the GPU; apps should use
+            // fences to determine GPU execution progress.
+            ThrowIfFailed(m_allocators[allocatorIndex]->Reset());
+
+            // However, when ExecuteCommandList() is called on a particular command
+            // list, that command list can then be reset at any time and must be before
+            // re-recording.
+            D3D12PipelineState* pPipelineState = static_cast<D3D12PipelineState*>(pInitialState);
+            ThrowIfFailed(m_commandList->Reset(m_allocators[allocatorIndex].Get(), pPipelineState ? pPipelineState->Get() : nullptr));
+
+            m_pRootSignature = nullptr;
+            if (pPipelineState != nullptr)
+            {
+                SetRootSignature(pPipelineState->GetRootSignature());
+            }
+        }
+
+        void SetPipelineStateImpl(PipelineState* pPipelineState) override
+        {
+            D3D12PipelineState* pD3D12PipelineState = static_cast<D3D12PipelineState*>(pPipelineState);
+            m_commandList->SetPipelineState(pD3D12PipelineState->Get());
+            SetRootSignature(pD3D12PipelineState->GetRootSignature());
+        }
+
+        void SetGraphicsRootConstantBufferImpl(uint32_t rootIndex, uint64_t gpuAddress) override
+        {
+            m_commandList->SetGraphicsRootConstantBufferView(rootIndex, gpuAddress);
+        }
+
+        void ResourceBarrierImpl(Resource* pResource, ResourceState before, ResourceState after) override
+        {
+            const CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(static_cast<D3D12Resource*>(pResource)->Get(), ToD3D12State(before), ToD3D12State(after));
+            m_commandList->ResourceBarrier(1, &barrier);
+        }
+
+        void DrawInstancedImpl(uint32_t vertexCountPerInstance, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) override
+        {
+            m_commandList->DrawInstanced(vertexCountPerInstance, instanceCount, startVertex, startInstance);
+        }
+
+        void DrawIndexedInstancedImpl(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override
+        {
+            m_commandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+        }
+
+    private:
+        // Pipeline states with the same root layout share their root signature, which
+        // then only has to be set (and its bindings invalidated) when it changes.
+        void SetRootSignature(ID3D12RootSignature* pRootSignature)
+        {
+            if (pRootSignature != m_pRootSignature)
+            {
+                m_commandList->SetGraphicsRootSignature(pRootSignature);
+                m_pRootSignature = pRootSignature;
+            }
+        }
+
+        std::vector<ComPtr<ID3D12CommandAllocator>> m_allocators;
+        ComPtr<ID3D12GraphicsCommandList> m_commandList;
+        ID3D12RootSignature* m_pRootSignature;
+    };
+
+    class D3D12CommandQueue : public CommandQueue
+    {
+    public:
+        explicit D3D12CommandQueue(ID3D12Device* pDevice)
+        {
+            // Describe and create the command queue.
+            D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+            queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+            queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+            ThrowIfFailed(pDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
+        }
+
+        void ExecuteCommandList(CommandList* pCommandList) override
+        {
+            ID3D12CommandList* ppCommandLists[] = { static_cast<D3D12CommandList*>(pCommandList)->Get() };
+            m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+        }
+
+        void Signal(Fence* pFence, uint64_t value) override
+        {
+            ThrowIfFailed(m_commandQueue->Signal(static_cast<D3D12Fence*>(pFence)->Get(), value));
+        }
+
+        ID3D12CommandQueue* Get() const { return m_commandQueue.Get(); }
+
+    private:
+        ComPtr<ID3D12CommandQueue> m_commandQueue;
+    };
+
+    class D3D12SwapChain : public SwapChain
+    {
+    public:
+        D3D12SwapChain(ComPtr<IDXGISwapChain3> swapChain, std::vector<std::unique_ptr<D3D12Resource>>&& backBuffers) :
+            m_swapChain(swapChain),
+            m_backBuffers(std::move(backBuffers))
+        {
+        }
+
+        uint32_t GetCurrentBackBufferIndex() const override
+        {
+            return m_swapChain->GetCurrentBackBufferIndex();
+        }
+
+        Resource* GetBackBuffer(uint32_t index) override
+        {
+            return m_backBuffers.at(index).get();
+        }
+
+        void Present(uint32_t syncInterval) override
+        {
+            ThrowIfFailed(m_swapChain->Present(syncInterval, 0));
+        }
+
+    private:
+        ComPtr<IDXGISwapChain3> m_swapChain;
+        std::vector<std::unique_ptr<D3D12Resource>> m_backBuffers;
+    };
+
+    // Back buffers without a window, for the headless platform: they are rendered to in
+    // turn like the ones of a swap chain, and Present() only moves to the next one.
+    class D3D12OffscreenSwapChain : public SwapChain
+    {
+    public:
+        explicit D3D12OffscreenSwapChain(std::vector<std::unique_ptr<D3D12Resource>>&& backBuffers) :
+            m_backBuffers(std::move(backBuffers)),
+            m_currentIndex(0)
+        {
+        }
+
+        uint32_t GetCurrentBackBufferIndex() const override
+        {
+            return m_currentIndex;
+        }
+
+        Resource* GetBackBuffer(uint32_t index) override
+        {
+            return m_backBuffers.at(index).get();
+        }
+
+        void Present(uint32_t /*syncInterval*/) override
+        {
+            m_currentIndex = (m_currentIndex + 1) % static_cast<uint32_t>(m_backBuffers.size());
+        }
+
+    private:
+        std::vector<std::unique_ptr<D3D12Resource>> m_backBuffers;
+        uint32_t m_currentIndex;
+    };
+
+    class D3D12Device : public Device
+    {
+    public:
+        explicit D3D12Device(bool useWarpDevice) :
+            m_rootSignatureVersion(D3D_ROOT_SIGNATURE_VERSION_1_1)
+        {
+            UINT dxgiFactoryFlags = 0;
+
+#if defined(_DEBUG)
+            // Enable the debug layer (requires the Graphics Tools "optional feature").
+            // NOTE: Enabling the debug layer after device creation will invalidate the active device.
+            {
+                ComPtr<ID3D12Debug> debugController;
+                if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController))))
+                {
+                    debugController->EnableDebugLayer();
+
+                    // Enable additional debug layers.
+                    dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
+                }
+            }
+#endif
+
+            ThrowIfFailed(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&m_factory)));
+
+            if (useWarpDevice)
+            {
+                ComPtr<IDXGIAdapter> warpAdapter;
+                ThrowIfFailed(m_factory->EnumWarpAdapter(IID_PPV_ARGS(&warpAdapter)));
+                ThrowIfFailed(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&m_device)));
+            }
+            else
+            {
+                ComPtr<IDXGIAdapter1> hardwareAdapter;
+                GetHardwareAdapter(m_factory.Get(), &hardwareAdapter);
+                ThrowIfFailed(D3D12CreateDevice(hardwareAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&m_device)));
+            }
+
+            // This is the highest version the RHI supports. If CheckFeatureSupport succeeds, the HighestVersion returned will not be greater than this.
+            D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+            featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+            if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+            {
+                m_rootSignatureVersion = featureData.HighestVersion;
+            }
+            else
+            {
+                m_rootSignatureVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+            }
+
+            m_rtvAllocator.Initialize(m_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, c_maxRenderTargetViews);
+            m_dsvAllocator.Initialize(m_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, c_maxDepthStencilViews);
+        }
+
+        const char* GetName() const override
+        {
+            return "D3D12";
+        }
+
+        std::unique_ptr<CommandQueue> CreateCommandQueue() override
+        {
+            return std::unique_ptr<CommandQueue>(new D3D12CommandQueue(m_device.Get()));
+        }
+
+        std::unique_ptr<SwapChain> CreateSwapChain(CommandQueue* pQueue, void* window, uint32_t width, uint32_t height, uint32_t bufferCount, Format format) override
+        {
+            if (!window)
+            {
+                return CreateOffscreenSwapChain(width, height, bufferCount, format);
+            }
+
+            // Describe and create the swap chain.
+            DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+            swapChainDesc.BufferCount = bufferCount;
+            swapChainDesc.Width = width;
+            swapChainDesc.Height = height;
+            swapChainDesc.Format = ToDxgiFormat(format);
+            swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+            swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+            swapChainDesc.SampleDesc.Count = 1;
+
+            const HWND hwnd = static_cast<HWND>(window);
+            ComPtr<IDXGISwapChain1> swapChain1;
+            ThrowIfFailed(m_factory->CreateSwapChainForHwnd(
+                static_cast<D3D12CommandQueue*>(pQueue)->Get(),     // Swap chain needs the queue so that it can force a flush on it.
+                hwnd,
+                &swapChainDesc,
+                nullptr,
+                nullptr,
+                &swapChain1
+            ));
+
+            // The samples do not support fullscreen transitions.
+            ThrowIfFailed(m_factory->MakeWindowAssociation(hwnd, DXGI_MWA_NO_ALT_ENTER));
+
+            ComPtr<IDXGISwapChain3> swapChain;
+            ThrowIfFailed(swapChain1.As(&swapChain));
+
+            // Wrap the back buffers, each with its render target view.
+            std::vector<std::unique_ptr<D3D12Resource>> backBuffers;
+            for (UINT n = 0; n < bufferCount; n++)
+            {
+                ComPtr<ID3D12Resource> backBuffer;
+                ThrowIfFailed(swapChain->GetBuffer(n, IID_PPV_ARGS(&backBuffer)));
+
+                std::unique_ptr<D3D12Resource> resource(new D3D12Resource(backBuffer, HeapType::Default));
+                resource->m_renderTargetView = m_rtvAllocator.Allocate();
+                m_device->CreateRenderTargetView(backBuffer.Get(), nullptr, resource->m_renderTargetView);
+                backBuffers.push_back(std::move(resource));
+            }
+
+            return std::unique_ptr<SwapChain>(new D3D12SwapChain(swapChain, std::move(backBuffers)));
+        }
+
+        std::unique_ptr<Resource> CreateBuffer(uint64_t size, HeapType heapType, ResourceState initialState) override
+        {
+            const CD3DX12_HEAP_PROPERTIES heapProperties(ToD3D12HeapType(heapType));
+            const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+            ComPtr<ID3D12Resource> buffer;
+            ThrowIfFailed(m_device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &bufferDesc,
+                ToD3D12State(initialState),
+                nullptr,
+                IID_PPV_ARGS(&buffer)));
+
+            return std::unique_ptr<Resource>(new D3D12Resource(buffer, heapType));
+        }
+
+        std::unique_ptr<Resource> CreateTexture2D(const TextureDesc& desc) override
+        {
+            const DXGI_FORMAT format = ToDxgiFormat(desc.format);
+            const bool isDepthStencil = desc.usage == TextureUsage::DepthStencil;
+
+            // Performance tip: Deny shader resource access to resources that don't need shader resource views.
+            const D3D12_RESOURCE_FLAGS flags = isDepthStencil ?
+                D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE :
+                D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+            // Performance tip: Tell the runtime at resource creation the desired clear value.
+            const CD3DX12_CLEAR_VALUE clearValue = isDepthStencil ?
+                CD3DX12_CLEAR_VALUE(format, desc.clearDepth, desc.clearStencil) :
+                CD3DX12_CLEAR_VALUE(format, desc.clearColor);
+
+            const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+            const CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(format, desc.width, desc.height, 1, 1, 1, 0, flags);
+
+            ComPtr<ID3D12Resource> texture;
+            ThrowIfFailed(m_device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &textureDesc,
+                ToD3D12State(desc.initialState),
+                &clearValue,
+                IID_PPV_ARGS(&texture)));
+
+            std::unique_ptr<D3D12Resource> resource(new D3D12Resource(texture, HeapType::Default));
+            if (isDepthStencil)
+            {
+                D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilDesc = {};
+                depthStencilDesc.Format = format;
+                depthStencilDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+                depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
+
+                resource->m_depthStencilView = m_dsvAllocator.Allocate();
+                m_device->CreateDepthStencilView(texture.Get(), &depthStencilDesc, resource->m_depthStencilView);
+            }
+            else
+            {
+                resource->m_renderTargetView = m_rtvAllocator.Allocate();
+                m_device->CreateRenderTargetView(texture.Get(), nullptr, resource->m_renderTargetView);
+            }
+            return std::move(resource);
+        }
+
+        std::unique_ptr<Fence> CreateFence(uint64_t initialValue) override
+        {
+            return std::unique_ptr<Fence>(new D3D12Fence(m_device.Get(), initialValue));
+        }
+
+        std::unique_ptr<CommandList> CreateCommandList(uint32_t allocatorCount) override
+        {
+            return std::unique_ptr<CommandList>(new D3D12CommandList(m_device.Get(), allocatorCount));
+        }
+
+        std::unique_ptr<PipelineState> CreateGraphicsPipelineState(const GraphicsPipelineDesc& desc) override
+        {
+            ComPtr<ID3DBlob> vertexShader = CompileShader(desc.vertexShader);
+            ComPtr<ID3DBlob> pixelShader = CompileShader(desc.pixelShader);
+            ComPtr<ID3D12RootSignature> rootSignature = GetRootSignature(desc.rootConstantBufferCount);
+
+            // Define the vertex input layout.
+            std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs;
+            for (const InputElement& element : desc.inputLayout)
+            {
+                const D3D12_INPUT_ELEMENT_DESC elementDesc = { element.semanticName, element.semanticIndex, ToDxgiFormat(element.format), 0, element.alignedByteOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+                inputElementDescs.push_back(elementDesc);
+            }
+
+            CD3DX12_RASTERIZER_DESC rasterizerDesc(D3D12_DEFAULT);
+            rasterizerDesc.CullMode = ToD3D12CullMode(desc.rasterizer.cullMode);
+            rasterizerDesc.FrontCounterClockwise = desc.rasterizer.frontCounterClockwise;
+
+            CD3DX12_DEPTH_STENCIL_DESC depthStencilDesc(D3D12_DEFAULT);
+            depthStencilDesc.DepthEnable = desc.depthStencil.depthEnable;
+            depthStencilDesc.DepthWriteMask = desc.depthStencil.depthWrite ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
+            depthStencilDesc.DepthFunc = ToD3D12ComparisonFunc(desc.depthStencil.depthFunc);
+
+            // Describe and create the graphics pipeline state object (PSO).
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+            psoDesc.InputLayout = { inputElementDescs.data(), static_cast<UINT>(inputElementDescs.size()) };
+            psoDesc.pRootSignature = rootSignature.Get();
+            psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
+            psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
+            psoDesc.RasterizerState = rasterizerDesc;
+            psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+            psoDesc.DepthStencilState = depthStencilDesc;
+            psoDesc.DSVFormat = ToDxgiFormat(desc.depthStencilFormat);
+            psoDesc.SampleMask = UINT_MAX;
+            psoDesc.PrimitiveTopologyType = ToD3D12TopologyType(desc.topology);
+            psoDesc.NumRenderTargets = desc.renderTargetFormat != Format::Unknown ? 1 : 0;
+            psoDesc.RTVFormats[0] = ToDxgiFormat(desc.renderTargetFormat);
+            psoDesc.SampleDesc.Count = 1;
+
+            ComPtr<ID3D12PipelineState> pipelineState;
+            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
+
+            return std::unique_ptr<PipelineState>(new D3D12PipelineState(pipelineState, rootSignature));
+        }
+
+    private:
+        // The back buffers start in the present state, as the ones of a swap chain do. They have
+        // no optimized clear value, since the clear color is up to the sample.
+        std::unique_ptr<SwapChain> CreateOffscreenSwapChain(uint32_t width, uint32_t height, uint32_t bufferCount, Format format)
+        {
+            const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+            const CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+                ToDxgiFormat(format), width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+            std::vector<std::unique_ptr<D3D12Resource>> backBuffers;
+            for (UINT n = 0; n < bufferCount; n++)
+            {
+                ComPtr<ID3D12Resource> backBuffer;
+                ThrowIfFailed(m_device->CreateCommittedResource(
+                    &heapProperties,
+                    D3D12_HEAP_FLAG_NONE,
+                    &textureDesc,
+                    D3D12_RESOURCE_STATE_PRESENT,
+                    nullptr,
+                    IID_PPV_ARGS(&backBuffer)));
+
+                std::unique_ptr<D3D12Resource> resource(new D3D12Resource(backBuffer, HeapType::Default));
+                resource->m_renderTargetView = m_rtvAllocator.Allocate();
+                m_device->CreateRenderTargetView(backBuffer.Get(), nullptr, resource->m_renderTargetView);
+                backBuffers.push_back(std::move(resource));
+            }
+
+            return std::unique_ptr<SwapChain>(new D3D12OffscreenSwapChain(std::move(backBuffers)));
+        }
+
+        static ComPtr<ID3DBlob> CompileShader(const ShaderDesc& shader)
+        {
+#if defined(_DEBUG)
+            // Enable better shader debugging with the graphics debugging tools.
+            UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+            UINT compileFlags = 0;
+#endif
+
+            ComPtr<ID3DBlob> blob;
+            ThrowIfFailed(D3DCompileFromFile(shader.fileName.c_str(), nullptr, nullptr, shader.entryPoint.c_str(), shader.target.c_str(), compileFlags, 0, &blob, nullptr));
+            return blob;
+        }
+
+        // Root signature with rootConstantBufferCount constant buffer views, created on first use.
+        ComPtr<ID3D12RootSignature> GetRootSignature(uint32_t rootConstantBufferCount)
+        {
+            ComPtr<ID3D12RootSignature>& rootSignature = m_rootSignatures[rootConstantBufferCount];
+            if (rootSignature)
+            {
+                return rootSignature;
+            }
+
+            std::vector<CD3DX12_ROOT_PARAMETER1> rootParameters(rootConstantBufferCount);
+            for (uint32_t i = 0; i < rootConstantBufferCount; ++i)
+            {
+                rootParameters[i].InitAsConstantBufferView(i, 0);
+            }
+
+            // Allow input layout and deny uneccessary access to certain pipeline stages.
+            const D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
+                D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+                D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+                D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+                D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+            CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
+            rootSignatureDesc.Init_1_1(rootConstantBufferCount, rootParameters.data(), 0, nullptr, rootSignatureFlags);
+
+            ComPtr<ID3DBlob> signature;
+            ComPtr<ID3DBlob> error;
+            ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, m_rootSignatureVersion, &signature, &error));
+            ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
+            return rootSignature;
+        }
+
+        ComPtr<IDXGIFactory4> m_factory;
+        ComPtr<ID3D12Device> m_device;
+        D3D_ROOT_SIGNATURE_VERSION m_rootSignatureVersion;
+        DescriptorAllocator m_rtvAllocator;
+        DescriptorAllocator m_dsvAllocator;
+        std::map<uint32_t, ComPtr<ID3D12RootSignature>> m_rootSignatures;
+    };
+}
+
+std::unique_ptr<Device> CreateD3D12Device(bool useWarpDevice)
+{
+    return std::unique_ptr<Device>(new D3D12Device(useWarpDevice));
+}
+}
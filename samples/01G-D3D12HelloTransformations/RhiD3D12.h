@@ -0,0 +1,21 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "Rhi.h"
+
+namespace Rhi
+{
+    // Device on the first hardware adapter that supports Direct3D 12, or on the WARP
+    // software adapter. In debug builds the D3D12 debug layer is enabled when available.
+    std::unique_ptr<Device> CreateD3D12Device(bool useWarpDevice);
+}
@@ -0,0 +1,728 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "RhiNull.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace Rhi
+{
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Fake GPU virtual addresses are handed out from here, 64KB aligned like D3D12 placements.
+    const uint64_t c_gpuAddressBase = 0x100000000ull;
+    const uint64_t c_resourceAlignment = 65536;
+
+    void Validate(bool condition, const char* message)
+    {
+        if (!condition)
+        {
+            throw std::logic_error(message);
+        }
+    }
+
+    class NullResource : public Resource
+    {
+    public:
+        NullResource(uint64_t size, HeapType heapType, ResourceState initialState, uint64_t gpuAddress, bool isBuffer) :
+            m_size(size),
+            m_heapType(heapType),
+            m_gpuAddress(gpuAddress),
+            m_isBuffer(isBuffer),
+            m_mapCount(0),
+            m_state(initialState)
+        {
+            // Only buffers have contents: nothing ever reads the texels of a texture.
+            if (isBuffer)
+            {
+                m_memory.reset(new uint8_t[static_cast<size_t>(size)]());
+            }
+        }
+
+        void* Map() override
+        {
+            Validate(m_heapType != HeapType::Default && m_isBuffer, "Only buffers in upload and readback heaps can be mapped.");
+            ++m_mapCount;
+            return m_memory.get();
+        }
+
+        void Unmap() override
+        {
+            Validate(m_mapCount > 0, "Unmap() without a matching Map().");
+            --m_mapCount;
+        }
+
+        uint64_t GetGpuAddress() const override { return m_gpuAddress; }
+        uint64_t GetSize() const override       { return m_size; }
+
+        bool IsBuffer() const       { return m_isBuffer; }
+        uint8_t* GetMemory() const  { return m_memory.get(); }
+
+        // State on the queue timeline: after creation, only the queue thread touches it.
+        ResourceState GetState() const          { return m_state; }
+        void SetState(ResourceState state)      { m_state = state; }
+
+    private:
+        uint64_t m_size;
+        HeapType m_heapType;
+        uint64_t m_gpuAddress;
+        bool m_isBuffer;
+        uint32_t m_mapCount;
+        ResourceState m_state;
+        std::unique_ptr<uint8_t[]> m_memory;
+    };
+
+    class NullPipelineState : public PipelineState
+    {
+    public:
+        explicit NullPipelineState(const GraphicsPipelineDesc& desc) :
+            m_rootConstantBufferCount(desc.rootConstantBufferCount)
+        {
+        }
+
+        uint32_t GetRootConstantBufferCount() const { return m_rootConstantBufferCount; }
+
+    private:
+        uint32_t m_rootConstantBufferCount;
+    };
+
+    class NullFence : public Fence
+    {
+    public:
+        explicit NullFence(uint64_t initialValue) :
+            m_value(initialValue)
+        {
+        }
+
+        uint64_t GetCompletedValue() const override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_value;
+        }
+
+        void Wait(uint64_t value) override
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&] { return m_value >= value; });
+        }
+
+        // Notify under the lock: a waiter that returns may destroy the fence at once.
+        void Set(uint64_t value)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_value = value;
+            m_condition.notify_all();
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        uint64_t m_value;
+    };
+
+    // Commands that have an effect on the queue timeline. State setters are only
+    // validated while recording.
+    enum class CommandType
+    {
+        Barrier,
+        RequireState,   // The resource must be in state "before" when the command executes.
+        Copy,
+        Draw,
+    };
+
+    struct Command
+    {
+        CommandType type;
+        NullResource* pResource;
+        NullResource* pSource;
+        ResourceState before;
+        ResourceState after;
+    };
+
+    // Number of the last command list executed by a queue, shared with the command
+    // lists so that they can check their allocators even after the queue is gone.
+    struct QueueProgress
+    {
+        std::atomic<uint64_t> completedSubmission;
+    };
+
+    class NullCommandList : public CommandList
+    {
+    public:
+        explicit NullCommandList(uint32_t allocatorCount) :
+            m_allocators(allocatorCount),
+            m_allocatorIndex(0),
+            m_recording(false),
+            m_pPipelineState(nullptr),
+            m_pRenderTarget(nullptr),
+            m_pDepthStencil(nullptr),
+            m_viewport(),
+            m_scissorRect(),
+            m_topology(PrimitiveTopology::TriangleList),
+            m_vertexBuffer(),
+            m_indexBuffer()
+        {
+        }
+
+        void Close() override
+        {
+            Validate(m_recording, "Close() on a command list that isn't recording.");
+            m_recording = false;
+        }
+
+        void SetViewport(const Viewport& viewport) override
+        {
+            CheckRecording();
+            m_viewport = viewport;
+        }
+
+        void SetScissorRect(const Rect& rect) override
+        {
+            CheckRecording();
+            m_scissorRect = rect;
+        }
+
+        void SetRenderTarget(Resource* pRenderTarget, Resource* pDepthStencil) override
+        {
+            CheckRecording();
+            m_pRenderTarget = static_cast<NullResource*>(pRenderTarget);
+            m_pDepthStencil = static_cast<NullResource*>(pDepthStencil);
+            if (m_pRenderTarget != nullptr)
+            {
+                Record(CommandType::RequireState, m_pRenderTarget, nullptr, ResourceState::RenderTarget);
+            }
+            if (m_pDepthStencil != nullptr)
+            {
+                Record(CommandType::RequireState, m_pDepthStencil, nullptr, ResourceState::DepthWrite);
+            }
+        }
+
+        void ClearRenderTarget(Resource* pRenderTarget, const float /*color*/[4]) override
+        {
+            CheckRecording();
+            Record(CommandType::RequireState, static_cast<NullResource*>(pRenderTarget), nullptr, ResourceState::RenderTarget);
+        }
+
+        void ClearDepthStencil(Resource* pDepthStencil, uint32_t /*clearFlags*/, float /*depth*/, uint8_t /*stencil*/) override
+        {
+            CheckRecording();
+            Record(CommandType::RequireState, static_cast<NullResource*>(pDepthStencil), nullptr, ResourceState::DepthWrite);
+        }
+
+        void SetPrimitiveTopology(PrimitiveTopology topology) override
+        {
+            CheckRecording();
+            m_topology = topology;
+        }
+
+        void SetVertexBuffer(uint32_t slot, const VertexBufferView& view) override
+        {
+            CheckRecording();
+            Validate(slot == 0, "Only vertex buffer slot 0 is supported.");
+            m_vertexBuffer = view;
+        }
+
+        void SetIndexBuffer(const IndexBufferView& view) override
+        {
+            CheckRecording();
+            Validate(view.format == Format::R16Uint || view.format == Format::R32Uint, "Index buffers must be R16Uint or R32Uint.");
+            m_indexBuffer = view;
+        }
+
+        void CopyResource(Resource* pDestination, Resource* pSource) override
+        {
+            CheckRecording();
+            Validate(pDestination->GetSize() == pSource->GetSize(), "CopyResource() between resources of different sizes.");
+            Record(CommandType::Copy, static_cast<NullResource*>(pDestination), static_cast<NullResource*>(pSource), ResourceState::CopyDest);
+        }
+
+        bool IsRecording() const                        { return m_recording; }
+        const std::vector<Command>& GetCommands() const { return m_commands; }
+
+        // The commands recorded with the current allocator are in flight until the
+        // queue completes the submission.
+        void OnExecute(const std::shared_ptr<QueueProgress>& progress, uint64_t submission)
+        {
+            m_allocators[m_allocatorIndex].progress = progress;
+            m_allocators[m_allocatorIndex].submission = submission;
+        }
+
+    protected:
+        void ResetImpl(uint32_t allocatorIndex, PipelineState* pInitialState) override
+        {
+            Validate(!m_recording, "Reset() on a command list that is still recording.");
+            Validate(allocatorIndex < m_allocators.size(), "Command allocator index out of range.");
+
+            const AllocatorUse& use = m_allocators[allocatorIndex];
+            Validate(!use.progress || use.progress->completedSubmission.load(std::memory_order_acquire) >= use.submission,
+                "Command allocator reset while the GPU may still be executing its commands.");
+
+            m_allocatorIndex = allocatorIndex;
+            m_recording = true;
+            m_commands.clear();
+            m_pPipelineState = static_cast<NullPipelineState*>(pInitialState);
+            m_pRenderTarget = nullptr;
+            m_pDepthStencil = nullptr;
+            m_vertexBuffer = VertexBufferView();
+            m_indexBuffer = IndexBufferView();
+        }
+
+        void SetPipelineStateImpl(PipelineState* pPipelineState) override
+        {
+            CheckRecording();
+            Validate(pPipelineState != nullptr, "SetPipelineState() with a null pipeline state.");
+            m_pPipelineState = static_cast<NullPipelineState*>(pPipelineState);
+        }
+
+        void SetGraphicsRootConstantBufferImpl(uint32_t rootIndex, uint64_t gpuAddress) override
+        {
+            CheckRecording();
+            Validate(m_pPipelineState != nullptr && rootIndex < m_pPipelineState->GetRootConstantBufferCount(),
+                "Root constant buffer index out of the range of the pipeline state.");
+            Validate(gpuAddress != 0, "Root constant buffer bound to a null GPU address.");
+        }
+
+        void ResourceBarrierImpl(Resource* pResource, ResourceState before, ResourceState after) override
+        {
+            CheckRecording();
+            Validate(before != after, "Resource barrier between identical states.");
+            Record(CommandType::Barrier, static_cast<NullResource*>(pResource), nullptr, before, after);
+        }
+
+        void DrawInstancedImpl(uint32_t /*vertexCountPerInstance*/, uint32_t /*instanceCount*/, uint32_t /*startVertex*/, uint32_t /*startInstance*/) override
+        {
+            CheckDraw();
+            Record(CommandType::Draw, nullptr, nullptr, ResourceState::Common);
+        }
+
+        void DrawIndexedInstancedImpl(uint32_t /*indexCountPerInstance*/, uint32_t /*instanceCount*/, uint32_t /*startIndex*/, int32_t /*baseVertex*/, uint32_t /*startInstance*/) override
+        {
+            CheckDraw();
+            Validate(m_indexBuffer.gpuAddress != 0, "Indexed draw without an index buffer.");
+            Record(CommandType::Draw, nullptr, nullptr, ResourceState::Common);
+        }
+
+    private:
+        struct AllocatorUse
+        {
+            std::shared_ptr<QueueProgress> progress;
+            uint64_t submission;
+        };
+
+        void CheckRecording() const
+        {
+            Validate(m_recording, "Command recorded into a closed command list.");
+        }
+
+        void CheckDraw() const
+        {
+            CheckRecording();
+            Validate(m_pPipelineState != nullptr, "Draw without a pipeline state.");
+            Validate(m_pRenderTarget != nullptr || m_pDepthStencil != nullptr, "Draw without a render target.");
+            Validate(m_viewport.width > 0.0f && m_viewport.height > 0.0f, "Draw without a viewport.");
+        }
+
+        void Record(CommandType type, NullResource* pResource, NullResource* pSource, ResourceState before, ResourceState after = ResourceState::Common)
+        {
+            const Command command = { type, pResource, pSource, before, after };
+            m_commands.push_back(command);
+        }
+
+        std::vector<AllocatorUse> m_allocators;
+        uint32_t m_allocatorIndex;
+        bool m_recording;
+        std::vector<Command> m_commands;
+
+        // Current state, to validate the commands as they are recorded.
+        NullPipelineState* m_pPipelineState;
+        NullResource* m_pRenderTarget;
+        NullResource* m_pDepthStencil;
+        Viewport m_viewport;
+        Rect m_scissorRect;
+        PrimitiveTopology m_topology;
+        VertexBufferView m_vertexBuffer;
+        IndexBufferView m_indexBuffer;
+    };
+
+    // Queue whose "GPU" is a worker thread.
+    // The worker keeps a simulated GPU clock: a command list starts when both the previous
+    // work is done and the submission latency has passed, and ends after the duration of
+    // its draws. The worker sleeps until that time, so fences are signaled (and presents
+    // retired) when a GPU with that throughput would have reached them. Simulated times
+    // are only as precise as the sleeps of the OS.
+    class NullQueue : public CommandQueue
+    {
+    public:
+        explicit NullQueue(const NullDeviceDesc& desc) :
+            m_desc(desc),
+            m_progress(std::make_shared<QueueProgress>()),
+            m_submissionCount(0),
+            m_pendingPresents(0),
+            m_exit(false),
+            m_epoch(Clock::now())
+        {
+            m_progress->completedSubmission.store(0, std::memory_order_relaxed);
+            m_thread = std::thread(&NullQueue::Run, this);
+        }
+
+        ~NullQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exit = true;
+            }
+            m_condition.notify_all();
+            m_thread.join();
+        }
+
+        void ExecuteCommandList(CommandList* pCommandList) override
+        {
+            NullCommandList* pList = static_cast<NullCommandList*>(pCommandList);
+            Validate(!pList->IsRecording(), "ExecuteCommandList() with a command list that is still recording.");
+
+            Packet packet = {};
+            packet.type = PacketType::Execute;
+            packet.commands = pList->GetCommands();
+            packet.submitTime = Clock::now();
+
+            uint64_t submission;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                RethrowError();
+                submission = ++m_submissionCount;
+                packet.submission = submission;
+                m_packets.push_back(std::move(packet));
+            }
+            pList->OnExecute(m_progress, submission);
+            m_condition.notify_one();
+        }
+
+        void Signal(Fence* pFence, uint64_t value) override
+        {
+            Packet packet = {};
+            packet.type = PacketType::Signal;
+            packet.pFence = static_cast<NullFence*>(pFence);
+            packet.value = value;
+            Push(std::move(packet));
+        }
+
+        // Queue a present, first waiting while maxFrameLatency presents are pending.
+        void Present(NullResource* pBackBuffer, uint32_t syncInterval)
+        {
+            Packet packet = {};
+            packet.type = PacketType::Present;
+            packet.pResource = pBackBuffer;
+            packet.value = syncInterval;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_presentCondition.wait(lock, [this] { return m_pendingPresents < m_desc.maxFrameLatency; });
+                ++m_pendingPresents;
+            }
+            Push(std::move(packet));
+        }
+
+    private:
+        enum class PacketType
+        {
+            Execute,
+            Signal,
+            Present,
+        };
+
+        struct Packet
+        {
+            PacketType type;
+            std::vector<Command> commands;
+            Clock::time_point submitTime;
+            uint64_t submission;
+            NullFence* pFence;
+            NullResource* pResource;
+            uint64_t value;
+        };
+
+        void Push(Packet&& packet)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                RethrowError();
+                m_packets.push_back(std::move(packet));
+            }
+            m_condition.notify_one();
+        }
+
+        // Report on the calling thread the first error found by the worker. m_mutex must be held.
+        void RethrowError()
+        {
+            if (m_error)
+            {
+                std::exception_ptr error = m_error;
+                m_error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        void Run()
+        {
+            Clock::time_point gpuTime = Clock::now();
+            for (;;)
+            {
+                Packet packet;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_condition.wait(lock, [this] { return m_exit || !m_packets.empty(); });
+                    if (m_packets.empty())
+                    {
+                        return;
+                    }
+                    packet = std::move(m_packets.front());
+                    m_packets.pop_front();
+                }
+
+                try
+                {
+                    Process(packet, gpuTime);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!m_error)
+                    {
+                        m_error = std::current_exception();
+                    }
+                }
+
+                if (packet.type == PacketType::Execute)
+                {
+                    m_progress->completedSubmission.store(packet.submission, std::memory_order_release);
+                }
+                else if (packet.type == PacketType::Present)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        --m_pendingPresents;
+                    }
+                    m_presentCondition.notify_all();
+                }
+            }
+        }
+
+        void Process(const Packet& packet, Clock::time_point& gpuTime)
+        {
+            switch (packet.type)
+            {
+            case PacketType::Execute:
+            {
+                gpuTime = (std::max)(gpuTime, packet.submitTime + m_desc.submitLatency);
+
+                uint32_t drawCount = 0;
+                for (const Command& command : packet.commands)
+                {
+                    Execute(command, drawCount);
+                }
+
+                gpuTime += drawCount * m_desc.drawDuration;
+                std::this_thread::sleep_until(gpuTime);
+                break;
+            }
+
+            case PacketType::Signal:
+                packet.pFence->Set(packet.value);
+                break;
+
+            case PacketType::Present:
+            {
+                const ResourceState state = packet.pResource->GetState();
+                Validate(state == ResourceState::Present || state == ResourceState::Common, "Back buffer presented while not in the present state.");
+
+                // Retire the present on the syncInterval-th vertical blank after the rendering.
+                if (packet.value > 0 && m_desc.refreshInterval.count() > 0)
+                {
+                    const auto blank = (gpuTime - m_epoch) / m_desc.refreshInterval + static_cast<int64_t>(packet.value);
+                    gpuTime = (std::max)(gpuTime, m_epoch + blank * m_desc.refreshInterval);
+                    std::this_thread::sleep_until(gpuTime);
+                }
+                break;
+            }
+            }
+        }
+
+        static void Execute(const Command& command, uint32_t& drawCount)
+        {
+            switch (command.type)
+            {
+            case CommandType::Barrier:
+                Validate(command.pResource->GetState() == command.before, "Resource barrier from a state the resource isn't in.");
+                command.pResource->SetState(command.after);
+                break;
+
+            case CommandType::RequireState:
+                Validate(command.pResource->GetState() == command.before, "Resource used in the wrong state.");
+                break;
+
+            case CommandType::Copy:
+            {
+                // Buffers in the common state are implicitly promoted by copies.
+                const ResourceState destinationState = command.pResource->GetState();
+                const ResourceState sourceState = command.pSource->GetState();
+                Validate(destinationState == ResourceState::CopyDest || (destinationState == ResourceState::Common && command.pResource->IsBuffer()),
+                    "Copy destination isn't in the copy destination state.");
+                Validate(sourceState == ResourceState::CopySource || sourceState == ResourceState::GenericRead || (sourceState == ResourceState::Common && command.pSource->IsBuffer()),
+                    "Copy source isn't in a copy source state.");
+
+                if (command.pResource->IsBuffer() && command.pSource->IsBuffer())
+                {
+                    memcpy(command.pResource->GetMemory(), command.pSource->GetMemory(), static_cast<size_t>(command.pSource->GetSize()));
+                }
+                break;
+            }
+
+            case CommandType::Draw:
+                ++drawCount;
+                break;
+            }
+        }
+
+        NullDeviceDesc m_desc;
+        std::shared_ptr<QueueProgress> m_progress;
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::condition_variable m_presentCondition;
+        std::deque<Packet> m_packets;
+        uint64_t m_submissionCount;
+        uint32_t m_pendingPresents;
+        bool m_exit;
+        std::exception_ptr m_error;
+
+        Clock::time_point m_epoch;      // Time of the first vertical blank.
+        std::thread m_thread;
+    };
+
+    class NullSwapChain : public SwapChain
+    {
+    public:
+        NullSwapChain(NullQueue* pQueue, uint32_t width, uint32_t height, uint32_t bufferCount, Format format) :
+            m_pQueue(pQueue),
+            m_backBufferIndex(0)
+        {
+            for (uint32_t i = 0; i < bufferCount; ++i)
+            {
+                const uint64_t size = static_cast<uint64_t>(width) * height * GetFormatSize(format);
+                m_backBuffers.emplace_back(new NullResource(size, HeapType::Default, ResourceState::Present, 0, false));
+            }
+        }
+
+        uint32_t GetCurrentBackBufferIndex() const override
+        {
+            return m_backBufferIndex;
+        }
+
+        Resource* GetBackBuffer(uint32_t index) override
+        {
+            return m_backBuffers.at(index).get();
+        }
+
+        void Present(uint32_t syncInterval) override
+        {
+            m_pQueue->Present(m_backBuffers[m_backBufferIndex].get(), syncInterval);
+            m_backBufferIndex = (m_backBufferIndex + 1) % static_cast<uint32_t>(m_backBuffers.size());
+        }
+
+    private:
+        NullQueue* m_pQueue;
+        std::vector<std::unique_ptr<NullResource>> m_backBuffers;
+        uint32_t m_backBufferIndex;
+    };
+
+    class NullDevice : public Device
+    {
+    public:
+        explicit NullDevice(const NullDeviceDesc& desc) :
+            m_desc(desc),
+            m_nextGpuAddress(c_gpuAddressBase)
+        {
+        }
+
+        const char* GetName() const override
+        {
+            return "Null";
+        }
+
+        std::unique_ptr<CommandQueue> CreateCommandQueue() override
+        {
+            return std::unique_ptr<CommandQueue>(new NullQueue(m_desc));
+        }
+
+        std::unique_ptr<SwapChain> CreateSwapChain(CommandQueue* pQueue, void* /*window*/, uint32_t width, uint32_t height, uint32_t bufferCount, Format format) override
+        {
+            Validate(bufferCount >= 2, "Flip model swap chains need at least two buffers.");
+            return std::unique_ptr<SwapChain>(new NullSwapChain(static_cast<NullQueue*>(pQueue), width, height, bufferCount, format));
+        }
+
+        std::unique_ptr<Resource> CreateBuffer(uint64_t size, HeapType heapType, ResourceState initialState) override
+        {
+            Validate(size > 0, "Buffers can't be empty.");
+            Validate(heapType != HeapType::Upload || initialState == ResourceState::GenericRead, "Upload heap resources must start in the generic read state.");
+            Validate(heapType != HeapType::Readback || initialState == ResourceState::CopyDest, "Readback heap resources must start in the copy destination state.");
+
+            const uint64_t gpuAddress = m_nextGpuAddress.fetch_add((size + c_resourceAlignment - 1) / c_resourceAlignment * c_resourceAlignment);
+            return std::unique_ptr<Resource>(new NullResource(size, heapType, initialState, gpuAddress, true));
+        }
+
+        std::unique_ptr<Resource> CreateTexture2D(const TextureDesc& desc) override
+        {
+            Validate(desc.width > 0 && desc.height > 0, "Textures can't be empty.");
+            Validate((desc.usage == TextureUsage::DepthStencil) == (desc.format == Format::D32Float), "Depth stencil textures need a depth format.");
+
+            // Like D3D12, textures have no GPU virtual address.
+            const uint64_t size = static_cast<uint64_t>(desc.width) * desc.height * GetFormatSize(desc.format);
+            return std::unique_ptr<Resource>(new NullResource(size, HeapType::Default, desc.initialState, 0, false));
+        }
+
+        std::unique_ptr<Fence> CreateFence(uint64_t initialValue) override
+        {
+            return std::unique_ptr<Fence>(new NullFence(initialValue));
+        }
+
+        std::unique_ptr<CommandList> CreateCommandList(uint32_t allocatorCount) override
+        {
+            Validate(allocatorCount > 0, "Command lists need at least one allocator.");
+            return std::unique_ptr<CommandList>(new NullCommandList(allocatorCount));
+        }
+
+        std::unique_ptr<PipelineState> CreateGraphicsPipelineState(const GraphicsPipelineDesc& desc) override
+        {
+            Validate(!desc.vertexShader.entryPoint.empty(), "Graphics pipeline states need a vertex shader.");
+            return std::unique_ptr<PipelineState>(new NullPipelineState(desc));
+        }
+
+    private:
+        NullDeviceDesc m_desc;
+        std::atomic<uint64_t> m_nextGpuAddress;
+    };
+}
+
+std::unique_ptr<Device> CreateNullDevice(const NullDeviceDesc& desc)
+{
+    return std::unique_ptr<Device>(new NullDevice(desc));
+}
+}
@@ -0,0 +1,47 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "Rhi.h"
+
+#include <chrono>
+
+namespace Rhi
+{
+    // Timing of the simulated GPU of the null device.
+    struct NullDeviceDesc
+    {
+        // Delay between the submission of a command list and the start of its execution.
+        std::chrono::nanoseconds submitLatency = std::chrono::microseconds(500);
+
+        // Execution time of each draw.
+        std::chrono::nanoseconds drawDuration = std::chrono::microseconds(20);
+
+        // Interval between two vertical blanks, for presents with a non-zero sync interval.
+        std::chrono::nanoseconds refreshInterval = std::chrono::microseconds(16667);
+
+        // Number of presents that can be queued before Present() blocks, as with DXGI.
+        uint32_t maxFrameLatency = 3;
+    };
+
+    // Device without a GPU.
+    // Each queue runs on a worker thread that executes command lists after the simulated
+    // latency: draws only take time, copies between buffers are real memcpys, and fences
+    // are signaled once the preceding work has "completed". Buffers in upload and readback
+    // heaps are backed by host memory, so the CPU side of a frame does the same work as
+    // with a real device.
+    // Misuse that the D3D12 debug layer would report (resetting an allocator still in use,
+    // barriers from the wrong state, drawing without a pipeline state...) throws
+    // std::logic_error. Errors found while the queue executes are rethrown by the next
+    // call to the queue.
+    std::unique_ptr<Device> CreateNullDevice(const NullDeviceDesc& desc = NullDeviceDesc());
+}
@@ -0,0 +1,299 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "HeadlessPlatform.h"
+#include "RhiNull.h"
+#include "TestCheck.h"
+
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Renders with the null device the way HelloTransformations does: a frame per back
+    // buffer, with a fence value per frame in flight.
+    class TestApp : public PlatformApp
+    {
+    public:
+        static const uint32_t FrameCount = 2;
+
+        TestApp() :
+            m_frameIndex(0),
+            m_initCount(0),
+            m_destroyCount(0),
+            m_updateCount(0),
+            m_renderCount(0),
+            m_reportCount(0),
+            m_offscreen(false)
+        {
+            for (auto& fenceValue : m_fenceValues)
+            {
+                fenceValue = 1;
+            }
+        }
+
+        void OnInit() override
+        {
+            ++m_initCount;
+
+            Rhi::NullDeviceDesc desc;
+            desc.refreshInterval = std::chrono::milliseconds(1);
+            m_device = Rhi::CreateNullDevice(desc);
+            m_commandQueue = m_device->CreateCommandQueue();
+
+            m_offscreen = GetPlatform()->GetNativeWindow() == nullptr;
+            m_swapChain = m_device->CreateSwapChain(m_commandQueue.get(), GetPlatform()->GetNativeWindow(), 64, 64, FrameCount, Rhi::Format::R8G8B8A8Unorm);
+            m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+            Rhi::GraphicsPipelineDesc psoDesc;
+            psoDesc.vertexShader = { L"shaders.hlsl", "VSMain", "vs_5_0" };
+            psoDesc.pixelShader = { L"shaders.hlsl", "PSMain", "ps_5_0" };
+            m_pipelineState = m_device->CreateGraphicsPipelineState(psoDesc);
+            m_commandList = m_device->CreateCommandList(FrameCount);
+            m_fence = m_device->CreateFence(0);
+        }
+
+        void OnUpdate() override
+        {
+            ++m_updateCount;
+            GetPlatform()->SetWindowTitle(L"frame " + std::to_wstring(m_updateCount));
+        }
+
+        void OnRender() override
+        {
+            ++m_renderCount;
+
+            m_commandList->Reset(m_frameIndex, m_pipelineState.get());
+            Rhi::Resource* pRenderTarget = m_swapChain->GetBackBuffer(m_frameIndex);
+            m_commandList->ResourceBarrier(pRenderTarget, Rhi::ResourceState::Present, Rhi::ResourceState::RenderTarget);
+            m_commandList->SetRenderTarget(pRenderTarget, nullptr);
+            const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+            m_commandList->ClearRenderTarget(pRenderTarget, clearColor);
+            m_commandList->ResourceBarrier(pRenderTarget, Rhi::ResourceState::RenderTarget, Rhi::ResourceState::Present);
+            m_commandList->Close();
+
+            m_commandQueue->ExecuteCommandList(m_commandList.get());
+            m_swapChain->Present(0);
+
+            const uint64_t currentFenceValue = m_fenceValues[m_frameIndex];
+            m_commandQueue->Signal(m_fence.get(), currentFenceValue);
+            m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+            if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
+            {
+                m_fence->Wait(m_fenceValues[m_frameIndex]);
+            }
+            m_fenceValues[m_frameIndex] = currentFenceValue + 1;
+        }
+
+        void OnDestroy() override
+        {
+            ++m_destroyCount;
+
+            // Wait for the GPU to be done with all the resources.
+            const uint64_t fenceValue = m_fenceValues[m_frameIndex] + 1;
+            m_commandQueue->Signal(m_fence.get(), fenceValue);
+            m_fence->Wait(fenceValue);
+        }
+
+        void OnKeyDown(uint8_t key) override
+        {
+            m_keys.push_back(key);
+            if (key == 'P')
+            {
+                GetPlatform()->SetPaused(true);
+            }
+            else if (key == 'Q')
+            {
+                GetPlatform()->RequestQuit();
+            }
+        }
+
+        void OnKeyUp(uint8_t key) override
+        {
+            m_keys.push_back(-static_cast<int>(key));
+        }
+
+        Benchmark& GetBenchmark() override      { return m_benchmark; }
+        void WriteBenchmarkReport() override    { ++m_reportCount; }
+
+        std::unique_ptr<Rhi::Device> m_device;
+        std::unique_ptr<Rhi::CommandQueue> m_commandQueue;
+        std::unique_ptr<Rhi::SwapChain> m_swapChain;
+        std::unique_ptr<Rhi::CommandList> m_commandList;
+        std::unique_ptr<Rhi::PipelineState> m_pipelineState;
+        std::unique_ptr<Rhi::Fence> m_fence;
+        uint64_t m_fenceValues[FrameCount];
+        uint32_t m_frameIndex;
+
+        Benchmark m_benchmark;
+        uint32_t m_initCount;
+        uint32_t m_destroyCount;
+        uint32_t m_updateCount;
+        uint32_t m_renderCount;
+        uint32_t m_reportCount;
+        std::vector<int> m_keys;
+        bool m_offscreen;
+    };
+
+    double SecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Polls until the condition holds; the test fails if it doesn't within 10 seconds.
+    void WaitUntil(const std::function<bool()>& condition)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        while (!condition())
+        {
+            CHECK(SecondsSince(start) < 10.0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void TestFrameLoopPolicy()
+    {
+        for (uint32_t mask = 0; mask < 32; ++mask)
+        {
+            const FrameLoopState state = { (mask & 1) != 0, (mask & 2) != 0, (mask & 4) != 0, (mask & 8) != 0, (mask & 16) != 0 };
+            FrameLoopAction expected;
+            if (state.quitRequested)
+            {
+                expected = FrameLoopAction::Quit;
+            }
+            else if (state.benchmarkEnabled)
+            {
+                expected = state.benchmarkFinished ? FrameLoopAction::Quit : FrameLoopAction::Render;
+            }
+            else
+            {
+                expected = (state.minimized || state.paused) ? FrameLoopAction::Block : FrameLoopAction::Render;
+            }
+            CHECK(ChooseFrameLoopAction(state) == expected);
+        }
+    }
+
+    void TestFixedFrameCount()
+    {
+        HeadlessPlatformDesc desc;
+        desc.frameCount = 30;
+        desc.frameIntervalSeconds = 0.0;
+        HeadlessPlatform platform(desc);
+        TestApp app;
+
+        CHECK(platform.Run(&app) == 0);
+        CHECK(app.m_initCount == 1 && app.m_destroyCount == 1 && app.m_reportCount == 0);
+        CHECK(app.m_updateCount == 30 && app.m_renderCount == 30);
+        CHECK(app.m_offscreen);
+        CHECK(platform.GetFrameCount() == 30 && platform.GetBlockCount() == 0);
+        CHECK(platform.GetWindowTitle() == L"frame 30");
+    }
+
+    void TestFramePacing()
+    {
+        HeadlessPlatformDesc desc;
+        desc.frameCount = 20;
+        desc.frameIntervalSeconds = 0.005;
+        HeadlessPlatform platform(desc);
+        TestApp app;
+
+        const auto start = std::chrono::steady_clock::now();
+        platform.Run(&app);
+        CHECK(SecondsSince(start) >= 19 * 0.005);
+    }
+
+    // Keys are delivered in order, a paused loop renders nothing and only wakes up for
+    // events, and another thread can resume and end it.
+    void TestPauseAndQuit()
+    {
+        HeadlessPlatform platform;
+        TestApp app;
+
+        std::thread controller([&]
+        {
+            WaitUntil([&] { return platform.GetFrameCount() >= 5; });
+            platform.PostKeyDown('A');
+            platform.PostKeyUp('A');
+            platform.PostKeyDown('P');
+
+            WaitUntil([&] { return platform.GetBlockCount() == 1; });
+            const uint32_t pausedFrameCount = platform.GetFrameCount();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            CHECK(platform.GetFrameCount() == pausedFrameCount);
+
+            // A key wakes the loop up, which handles it and blocks again.
+            platform.PostKeyDown('B');
+            WaitUntil([&] { return platform.GetBlockCount() == 2; });
+            CHECK(platform.GetFrameCount() == pausedFrameCount);
+
+            platform.SetPaused(false);
+            WaitUntil([&] { return platform.GetFrameCount() >= pausedFrameCount + 5; });
+            platform.RequestQuit();
+        });
+
+        platform.Run(&app);
+        controller.join();
+
+        CHECK((app.m_keys == std::vector<int>{ 'A', -'A', 'P', 'B' }));
+        CHECK(platform.GetBlockCount() == 2);
+        CHECK(app.m_destroyCount == 1);
+    }
+
+    void TestQuitFromKeyHandler()
+    {
+        HeadlessPlatformDesc desc;
+        desc.frameIntervalSeconds = 0.0;
+        HeadlessPlatform platform(desc);
+        TestApp app;
+
+        platform.PostKeyDown('Q');
+        platform.Run(&app);
+        CHECK(app.m_renderCount == 0 && app.m_destroyCount == 1);
+    }
+
+    // The benchmark renders back to back, ignores the keys and the pause, and ends with its report.
+    void TestBenchmark()
+    {
+        HeadlessPlatformDesc desc;
+        desc.frameIntervalSeconds = 0.1;
+        HeadlessPlatform platform(desc);
+        TestApp app;
+
+        BenchmarkSettings settings;
+        settings.frameCount = 40;
+        settings.warmupFrameCount = 5;
+        settings.headless = true;
+        app.m_benchmark.Configure(settings);
+
+        platform.PostKeyDown('P');
+        platform.SetPaused(true);
+
+        const auto start = std::chrono::steady_clock::now();
+        platform.Run(&app);
+        CHECK(SecondsSince(start) < 45 * 0.1);
+        CHECK(app.m_renderCount == 45 && app.m_keys.empty() && app.m_reportCount == 1);
+        CHECK(platform.GetBlockCount() == 0);
+        CHECK(app.m_benchmark.GetMeasuredFrameCount() == 40);
+    }
+}
+
+int main()
+{
+    TestFrameLoopPolicy();
+    TestFixedFrameCount();
+    TestFramePacing();
+    TestPauseAndQuit();
+    TestQuitFromKeyHandler();
+    TestBenchmark();
+    return 0;
+}
@@ -0,0 +1,118 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "RenderStats.h"
+#include "TestCheck.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Counters added by several recording threads all land in the frame they were added to.
+    void TestConcurrentAdd()
+    {
+        RenderStats stats;
+        const uint32_t threadCount = 4;
+        const uint32_t drawsPerThread = 100000;
+
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&]
+            {
+                for (uint32_t i = 0; i < drawsPerThread; ++i)
+                {
+                    stats.Add(RenderCounter::DrawCalls);
+                    stats.Add(RenderCounter::Instances, 3);
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        CHECK(stats.EndFrame() == 1);
+        const RenderFrameStats& frame = stats.GetLastFrame();
+        CHECK(frame[RenderCounter::DrawCalls] == threadCount * drawsPerThread);
+        CHECK(frame[RenderCounter::Instances] == 3ull * threadCount * drawsPerThread);
+        CHECK(frame[RenderCounter::ResourceBarriers] == 0);
+
+        // The counters start again from zero in the next frame.
+        stats.EndFrame();
+        CHECK(stats.GetLastFrame()[RenderCounter::DrawCalls] == 0);
+    }
+
+    void TestUploadAndFenceWaitHelpers()
+    {
+        RenderStats stats;
+
+        char source[256] = "upload";
+        char destination[256] = {};
+        stats.CopyToUploadMemory(destination, source, sizeof(source));
+        CHECK(std::string(destination) == "upload");
+
+        stats.TimeFenceWait([] { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+
+        stats.EndFrame();
+        const RenderFrameStats& frame = stats.GetLastFrame();
+        CHECK(frame[RenderCounter::UploadBytes] == sizeof(source));
+        CHECK(frame[RenderCounter::FenceWaits] == 1);
+        CHECK(frame[RenderCounter::FenceWaitNanoseconds] >= 2000000);
+    }
+
+    // The summary covers the most recent frames, even after the history wrapped around.
+    void TestSummary()
+    {
+        RenderStats stats;
+        CHECK(stats.GetSummary(10).frameCount == 0);
+        CHECK(stats.GetLastFrame()[RenderCounter::DrawCalls] == 0);
+
+        const uint32_t frameCount = RenderStats::HistorySize + 100;
+        for (uint32_t f = 1; f <= frameCount; ++f)
+        {
+            stats.Add(RenderCounter::DrawCalls, f);
+            stats.EndFrame();
+        }
+
+        const RenderStatsSummary last = stats.GetSummary(4);
+        const size_t draws = static_cast<size_t>(RenderCounter::DrawCalls);
+        CHECK(last.frameCount == 4);
+        CHECK(last.minimum[draws] == frameCount - 3);
+        CHECK(last.maximum[draws] == frameCount);
+        CHECK(last.mean[draws] == frameCount - 1.5);
+
+        const RenderStatsSummary all = stats.GetSummary(UINT32_MAX);
+        CHECK(all.frameCount == RenderStats::HistorySize);
+        CHECK(all.minimum[draws] == frameCount - RenderStats::HistorySize + 1);
+
+        const std::string text = stats.FormatSummary(4);
+        CHECK(text.find("over 4 frames") != std::string::npos);
+        for (uint32_t i = 0; i < RenderStats::CounterCount; ++i)
+        {
+            if (static_cast<RenderCounter>(i) != RenderCounter::FenceWaitNanoseconds)
+            {
+                CHECK(text.find(RenderStats::GetCounterName(static_cast<RenderCounter>(i))) != std::string::npos);
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestConcurrentAdd();
+    TestUploadAndFenceWaitHelpers();
+    TestSummary();
+    return 0;
+}
@@ -0,0 +1,193 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "RhiNull.h"
+#include "TestCheck.h"
+
+#include <cstring>
+
+using namespace Rhi;
+
+namespace
+{
+    GraphicsPipelineDesc GetPipelineDesc()
+    {
+        GraphicsPipelineDesc desc;
+        desc.vertexShader = { L"shaders.hlsl", "VSMain", "vs_5_0" };
+        desc.pixelShader = { L"shaders.hlsl", "PSMain", "ps_5_0" };
+        return desc;
+    }
+
+    // Upload -> default -> readback, as real copies executed by the queue.
+    void TestCopies()
+    {
+        std::unique_ptr<Device> device = CreateNullDevice();
+        std::unique_ptr<CommandQueue> queue = device->CreateCommandQueue();
+        std::unique_ptr<CommandList> commandList = device->CreateCommandList(1);
+        std::unique_ptr<Fence> fence = device->CreateFence(0);
+
+        std::unique_ptr<Resource> upload = device->CreateBuffer(4096, HeapType::Upload, ResourceState::GenericRead);
+        std::unique_ptr<Resource> buffer = device->CreateBuffer(4096, HeapType::Default, ResourceState::CopyDest);
+        std::unique_ptr<Resource> readback = device->CreateBuffer(4096, HeapType::Readback, ResourceState::CopyDest);
+        CHECK(upload->GetGpuAddress() != 0 && upload->GetGpuAddress() != buffer->GetGpuAddress());
+        CHECK_THROWS(buffer->Map());
+
+        uint8_t* pUpload = static_cast<uint8_t*>(upload->Map());
+        for (uint32_t i = 0; i < 4096; ++i)
+        {
+            pUpload[i] = static_cast<uint8_t>(i * 7);
+        }
+        upload->Unmap();
+
+        commandList->Reset(0, nullptr);
+        commandList->CopyResource(buffer.get(), upload.get());
+        commandList->ResourceBarrier(buffer.get(), ResourceState::CopyDest, ResourceState::CopySource);
+        commandList->CopyResource(readback.get(), buffer.get());
+        commandList->Close();
+        queue->ExecuteCommandList(commandList.get());
+        queue->Signal(fence.get(), 1);
+        fence->Wait(1);
+        CHECK(fence->GetCompletedValue() == 1);
+
+        const uint8_t* pReadback = static_cast<const uint8_t*>(readback->Map());
+        for (uint32_t i = 0; i < 4096; ++i)
+        {
+            CHECK(pReadback[i] == static_cast<uint8_t>(i * 7));
+        }
+        readback->Unmap();
+    }
+
+    // Frames recorded as 01G records them, with two frames in flight, counted into RenderStats.
+    void TestFrames()
+    {
+        NullDeviceDesc desc;
+        desc.refreshInterval = std::chrono::milliseconds(1);
+        std::unique_ptr<Device> device = CreateNullDevice(desc);
+        std::unique_ptr<CommandQueue> queue = device->CreateCommandQueue();
+        std::unique_ptr<SwapChain> swapChain = device->CreateSwapChain(queue.get(), nullptr, 64, 64, 2, Format::R8G8B8A8Unorm);
+        std::unique_ptr<CommandList> commandList = device->CreateCommandList(2);
+        std::unique_ptr<Fence> fence = device->CreateFence(0);
+        std::unique_ptr<PipelineState> pipelineState = device->CreateGraphicsPipelineState(GetPipelineDesc());
+
+        TextureDesc depthDesc = {};
+        depthDesc.width = 64;
+        depthDesc.height = 64;
+        depthDesc.format = Format::D32Float;
+        depthDesc.usage = TextureUsage::DepthStencil;
+        depthDesc.initialState = ResourceState::DepthWrite;
+        depthDesc.clearDepth = 1.0f;
+        std::unique_ptr<Resource> depthStencil = device->CreateTexture2D(depthDesc);
+
+        std::unique_ptr<Resource> geometry = device->CreateBuffer(4096, HeapType::Upload, ResourceState::GenericRead);
+
+        RenderStats stats;
+        commandList->SetStats(&stats);
+
+        const uint32_t frameCount = 20;
+        const uint32_t drawsPerFrame = 10;
+        uint64_t fenceValues[2] = { 1, 1 };
+        uint32_t frameIndex = swapChain->GetCurrentBackBufferIndex();
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            commandList->Reset(frameIndex, pipelineState.get());
+            commandList->SetViewport({ 0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f });
+            commandList->SetScissorRect({ 0, 0, 64, 64 });
+
+            Resource* pBackBuffer = swapChain->GetBackBuffer(frameIndex);
+            commandList->ResourceBarrier(pBackBuffer, ResourceState::Present, ResourceState::RenderTarget);
+            commandList->SetRenderTarget(pBackBuffer, depthStencil.get());
+            const float clearColor[4] = {};
+            commandList->ClearRenderTarget(pBackBuffer, clearColor);
+            commandList->ClearDepthStencil(depthStencil.get(), ClearDepth, 1.0f, 0);
+            commandList->SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+            commandList->SetVertexBuffer(0, { geometry->GetGpuAddress(), 1024, 28 });
+            commandList->SetIndexBuffer({ geometry->GetGpuAddress() + 1024, 72, Format::R16Uint });
+            for (uint32_t draw = 0; draw < drawsPerFrame; ++draw)
+            {
+                commandList->SetGraphicsRootConstantBuffer(0, geometry->GetGpuAddress() + 2048);
+                commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+            }
+            commandList->ResourceBarrier(pBackBuffer, ResourceState::RenderTarget, ResourceState::Present);
+            commandList->Close();
+
+            queue->ExecuteCommandList(commandList.get());
+            swapChain->Present(1);
+
+            const uint64_t currentFenceValue = fenceValues[frameIndex];
+            queue->Signal(fence.get(), currentFenceValue);
+            frameIndex = swapChain->GetCurrentBackBufferIndex();
+            if (fence->GetCompletedValue() < fenceValues[frameIndex])
+            {
+                stats.TimeFenceWait([&] { fence->Wait(fenceValues[frameIndex]); });
+            }
+            fenceValues[frameIndex] = currentFenceValue + 1;
+            stats.EndFrame();
+        }
+
+        const RenderStatsSummary summary = stats.GetSummary(frameCount);
+        CHECK(summary.frameCount == frameCount);
+        CHECK(summary.minimum[static_cast<size_t>(RenderCounter::DrawCalls)] == drawsPerFrame);
+        CHECK(summary.maximum[static_cast<size_t>(RenderCounter::ResourceBarriers)] == 2);
+        CHECK(summary.maximum[static_cast<size_t>(RenderCounter::PipelineStateChanges)] == 1);
+        CHECK(summary.maximum[static_cast<size_t>(RenderCounter::RootConstantBufferBinds)] == drawsPerFrame);
+
+        queue->Signal(fence.get(), 1000);
+        fence->Wait(1000);
+    }
+
+    // Misuse is reported as the D3D12 debug layer would, at recording or at execution.
+    void TestValidation()
+    {
+        NullDeviceDesc desc;
+        desc.submitLatency = std::chrono::milliseconds(100);
+        std::unique_ptr<Device> device = CreateNullDevice(desc);
+        std::unique_ptr<CommandQueue> queue = device->CreateCommandQueue();
+        std::unique_ptr<SwapChain> swapChain = device->CreateSwapChain(queue.get(), nullptr, 64, 64, 2, Format::R8G8B8A8Unorm);
+        std::unique_ptr<CommandList> commandList = device->CreateCommandList(1);
+        std::unique_ptr<Fence> fence = device->CreateFence(0);
+        std::unique_ptr<PipelineState> pipelineState = device->CreateGraphicsPipelineState(GetPipelineDesc());
+
+        CHECK_THROWS(device->CreateGraphicsPipelineState(GraphicsPipelineDesc()));
+        CHECK_THROWS(device->CreateBuffer(256, HeapType::Upload, ResourceState::CopyDest));
+
+        // Draws need a render target and a viewport.
+        commandList->Reset(0, pipelineState.get());
+        CHECK_THROWS(commandList->DrawInstanced(3, 1, 0, 0));
+        commandList->Close();
+
+        // The allocator of a command list the queue hasn't executed yet can't be reset.
+        queue->ExecuteCommandList(commandList.get());
+        CHECK_THROWS(commandList->Reset(0, pipelineState.get()));
+        queue->Signal(fence.get(), 1);
+        fence->Wait(1);
+
+        // A barrier from the wrong state is found by the queue and reported by one of its next calls.
+        commandList->Reset(0, pipelineState.get());
+        commandList->ResourceBarrier(swapChain->GetBackBuffer(0), ResourceState::RenderTarget, ResourceState::Present);
+        commandList->Close();
+        queue->ExecuteCommandList(commandList.get());
+        auto signalAndWait = [&]
+        {
+            queue->Signal(fence.get(), 2);
+            fence->Wait(2);
+            queue->Signal(fence.get(), 3);
+        };
+        CHECK_THROWS(signalAndWait());
+    }
+}
+
+int main()
+{
+    TestCopies();
+    TestFrames();
+    TestValidation();
+    return 0;
+}
@@ -0,0 +1,161 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "StepTimer.h"
+#include "TestCheck.h"
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    bool Near(double value, double expected, double tolerance)
+    {
+        return std::fabs(value - expected) <= tolerance;
+    }
+
+    // 60 Hz frames with a 50 ms hitch every 100 frames, and a 250 ms one at the end.
+    void TestVariableTimeStep()
+    {
+        uint64_t now = 0;
+        StepTimer timer([&] { return now; });
+
+        uint32_t updates = 0;
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            now += (i % 100 == 0) ? 50000000 : 16666667;
+            timer.Tick([&] { ++updates; });
+        }
+        CHECK(updates == 1000);
+        CHECK(timer.GetFrameCount() == 1000);
+        CHECK(timer.GetFramesPerSecond() > 55 && timer.GetFramesPerSecond() < 61);
+
+        const FrameTimeStatistics recent = timer.GetFrameTimes().GetRecentStatistics();
+        CHECK(recent.frameCount == 1000);
+        CHECK(Near(recent.minMs, 16.6666, 0.001));
+        CHECK(Near(recent.p50Ms, 16.6666, 0.001));
+        CHECK(Near(recent.p99Ms, 16.6666, 0.001));
+        CHECK(Near(recent.maxMs, 50.0, 0.001));
+        CHECK(Near(recent.meanMs, 17.0, 0.001));
+
+        // The histogram keeps every frame, within its 1/32 relative error.
+        const FrameTimeStatistics histogram = timer.GetFrameTimes().GetHistogramStatistics();
+        CHECK(histogram.frameCount == 1000);
+        CHECK(Near(histogram.p50Ms, 16.6666, 16.6666 / 32));
+        CHECK(Near(histogram.meanMs, 17.0, 0.001));
+        CHECK(Near(histogram.maxMs, 50.0, 0.001));
+
+        // A long frame is recorded as it was, but the simulation only advances by 100 ms.
+        const uint64_t totalTicks = timer.GetTotalTicks();
+        now += 250000000;
+        timer.Tick();
+        CHECK(timer.GetTotalTicks() - totalTicks == StepTimer::TicksPerSecond / 10);
+        CHECK(Near(timer.GetFrameTimes().GetRecentStatistics().maxMs, 250.0, 0.001));
+    }
+
+    // 240 Hz updates on 20 Hz frames, capped at 4 updates per frame.
+    void TestFixedTimeStepCatchUpLimit()
+    {
+        uint64_t now = 0;
+        StepTimer timer([&] { return now; });
+        timer.SetFixedTimeStep(true);
+        timer.SetTargetElapsedSeconds(1.0 / 240);
+        timer.SetMaxUpdatesPerTick(4);
+
+        uint32_t updates = 0;
+        for (uint32_t i = 0; i < 10; ++i)
+        {
+            now += 50000000;
+            timer.Tick([&] { ++updates; });
+        }
+        CHECK(updates == 40);
+
+        // The time that couldn't be caught up with is dropped, in whole steps.
+        const uint64_t step = StepTimer::SecondsToTicks(1.0 / 240);
+        const uint64_t elapsed = 10 * StepTimer::TicksPerSecond / 20;
+        CHECK(timer.GetDroppedTicks() % step == 0);
+        CHECK(timer.GetTotalTicks() + timer.GetDroppedTicks() <= elapsed);
+        CHECK(timer.GetTotalTicks() + timer.GetDroppedTicks() + step > elapsed);
+    }
+
+    void TestHistogramBuckets()
+    {
+        for (uint32_t i = 0; i < FrameTimeRecorder::BucketCount; ++i)
+        {
+            const uint64_t highest = FrameTimeRecorder::GetBucketHighestValue(i);
+            CHECK(FrameTimeRecorder::GetBucketIndex(highest) == i);
+            if (i + 1 < FrameTimeRecorder::BucketCount)
+            {
+                CHECK(FrameTimeRecorder::GetBucketIndex(highest + 1) == i + 1);
+            }
+        }
+    }
+
+    void TestRecentFramesWrapAround()
+    {
+        FrameTimeRecorder recorder;
+        for (uint64_t i = 1; i <= 3000; ++i)
+        {
+            recorder.Record(i);
+        }
+
+        std::vector<uint64_t> ticks;
+        recorder.GetRecentFrameTimes(ticks);
+        CHECK(ticks.size() == FrameTimeRecorder::RingSize);
+        CHECK(ticks.front() == 3000 - FrameTimeRecorder::RingSize + 1);
+        CHECK(ticks.back() == 3000);
+
+        recorder.GetRecentFrameTimes(ticks, 10);
+        CHECK(ticks.size() == 10 && ticks.front() == 2991);
+
+        recorder.Reset();
+        CHECK(recorder.GetFrameCount() == 0);
+        CHECK(recorder.GetHistogramStatistics().frameCount == 0);
+        CHECK(recorder.GetRecentStatistics().frameCount == 0);
+    }
+
+    // The statistics are read by another thread while the timer ticks.
+    void TestConcurrentReader()
+    {
+        StepTimer timer;
+        std::atomic<bool> stop(false);
+        std::thread reader([&]
+        {
+            while (!stop.load())
+            {
+                const FrameTimeStatistics stats = timer.GetFrameTimes().GetRecentStatistics();
+                CHECK(stats.frameCount <= FrameTimeRecorder::RingSize);
+                CHECK(stats.minMs <= stats.maxMs);
+            }
+        });
+
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            timer.Tick();
+        }
+        stop.store(true);
+        reader.join();
+
+        CHECK(timer.GetFrameTimes().GetFrameCount() == 100000);
+    }
+}
+
+int main()
+{
+    TestVariableTimeStep();
+    TestFixedTimeStepCatchUpLimit();
+    TestHistogramBuckets();
+    TestRecentFramesWrapAround();
+    TestConcurrentReader();
+    return 0;
+}
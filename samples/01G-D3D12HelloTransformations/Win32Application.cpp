@@ -12,22 +12,28 @@
 #include "stdafx.h"
 #include "Win32Application.h"
 
-HWND Win32Application::m_hwnd = nullptr;
+Win32Application::Win32Application(HINSTANCE hInstance, int nCmdShow) :
+    m_hInstance(hInstance),
+    m_nCmdShow(nCmdShow),
+    m_hwnd(nullptr),
+    m_pSample(nullptr),
+    m_minimized(false),
+    m_paused(false),
+    m_quitRequested(false)
+{
+}
 
-int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
+int Win32Application::Run(DXSample* pSample)
 {
-    // Parse the command line parameters
-    int argc;
-    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
-    pSample->ParseCommandLineArgs(argv, argc);
-    LocalFree(argv);
+    m_pSample = pSample;
+    pSample->SetPlatform(this);
 
     // Initialize the window class.
     WNDCLASSEX windowClass = { 0 };
     windowClass.cbSize = sizeof(WNDCLASSEX);
     windowClass.style = CS_HREDRAW | CS_VREDRAW;
     windowClass.lpfnWndProc = WindowProc;
-    windowClass.hInstance = hInstance;
+    windowClass.hInstance = m_hInstance;
     windowClass.hCursor = LoadCursor(NULL, IDC_ARROW);
     windowClass.lpszClassName = L"DXSampleClass";
     RegisterClassEx(&windowClass);
@@ -46,15 +52,16 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
         windowRect.bottom - windowRect.top,
         nullptr,        // We have no parent window.
         nullptr,        // We aren't using menus.
-        hInstance,
-        pSample);
+        m_hInstance,
+        this);
 
     // Initialize the sample. OnInit is defined in each child-implementation of DXSample.
     pSample->OnInit();
 
-    ShowWindow(m_hwnd, nCmdShow);
+    ShowWindow(m_hwnd, m_nCmdShow);
 
     // Main sample loop.
+    Benchmark& benchmark = pSample->GetBenchmark();
     MSG msg = {};
     while (msg.message != WM_QUIT)
     {
@@ -63,57 +70,118 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
         {
             TranslateMessage(&msg);
             DispatchMessage(&msg);
+            continue;
+        }
+
+        FrameLoopState state = {};
+        state.quitRequested = m_quitRequested;
+        state.minimized = m_minimized;
+        state.paused = m_paused;
+        state.benchmarkEnabled = benchmark.IsEnabled();
+        state.benchmarkFinished = benchmark.IsFinished();
+
+        switch (ChooseFrameLoopAction(state))
+        {
+        case FrameLoopAction::Render:
+            RunFrame(pSample);
+            break;
+
+        case FrameLoopAction::Block:
+            // Sleep until the next message rather than spin on an empty queue.
+            WaitMessage();
+            break;
+
+        case FrameLoopAction::Quit:
+            // WM_DESTROY posts the WM_QUIT that ends the loop.
+            if (m_hwnd)
+            {
+                DestroyWindow(m_hwnd);
+            }
+            break;
         }
     }
 
     pSample->OnDestroy();
 
+    if (benchmark.IsEnabled())
+    {
+        pSample->WriteBenchmarkReport();
+    }
+
     // Return this part of the WM_QUIT message to Windows.
     return static_cast<char>(msg.wParam);
 }
 
+void Win32Application::SetWindowTitle(const std::wstring& title)
+{
+    SetWindowText(m_hwnd, title.c_str());
+}
+
+void Win32Application::SetPaused(bool paused)
+{
+    m_paused = paused;
+}
+
+void Win32Application::RequestQuit()
+{
+    m_quitRequested = true;
+}
+
 // Main message handler for the sample.
 LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
-    DXSample* pSample = reinterpret_cast<DXSample*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    Win32Application* pApplication = reinterpret_cast<Win32Application*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    DXSample* pSample = pApplication ? pApplication->m_pSample : nullptr;
 
     switch (message)
     {
     case WM_CREATE:
         {
-            // Save the DXSample* passed in to CreateWindow.
+            // Save the Win32Application* passed in to CreateWindow.
             LPCREATESTRUCT pCreateStruct = reinterpret_cast<LPCREATESTRUCT>(lParam);
             SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pCreateStruct->lpCreateParams));
         }
         return 0;
 
-    case WM_KEYDOWN:
-        if (pSample)
+    case WM_SIZE:
+        if (pApplication)
         {
-            pSample->OnKeyDown(static_cast<UINT8>(wParam));
+            pApplication->m_minimized = (wParam == SIZE_MINIMIZED);
         }
         return 0;
 
-    case WM_KEYUP:
-        if (pSample)
+    // The benchmark mode ignores the input, so that every run draws the same frames.
+    case WM_KEYDOWN:
+        if (pSample && !pSample->GetBenchmark().IsEnabled())
         {
-            pSample->OnKeyUp(static_cast<UINT8>(wParam));
+            if (wParam == VK_PAUSE)
+            {
+                pApplication->SetPaused(!pApplication->m_paused);
+            }
+            else
+            {
+                pSample->OnKeyDown(static_cast<UINT8>(wParam));
+            }
         }
         return 0;
 
-    case WM_PAINT:
-        if (pSample)
+    case WM_KEYUP:
+        if (pSample && !pSample->GetBenchmark().IsEnabled() && wParam != VK_PAUSE)
         {
-            pSample->OnUpdate();
-            pSample->OnRender();
+            pSample->OnKeyUp(static_cast<UINT8>(wParam));
         }
         return 0;
 
     case WM_DESTROY:
+        if (pApplication)
+        {
+            pApplication->m_hwnd = nullptr;
+        }
         PostQuitMessage(0);
         return 0;
     }
 
-    // Handle any messages the switch statement didn't.
+    // Handle any messages the switch statement didn't. The frames are rendered from the
+    // main loop, so DefWindowProc validates the window on WM_PAINT.
     return DefWindowProc(hWnd, message, wParam, lParam);
 }
@@ -15,15 +15,31 @@
 
 class DXSample;
 
-class Win32Application
+// The window of a sample and its message loop. Frames are rendered whenever the message
+// queue is empty, and not at all while the window is minimized or the sample is paused
+// (the Pause key), when the loop waits for the next message instead.
+class Win32Application : public Platform
 {
 public:
-    static int Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow);
-    static HWND GetHwnd() { return m_hwnd; }
+    Win32Application(HINSTANCE hInstance, int nCmdShow);
+
+    int Run(DXSample* pSample);
+    HWND GetHwnd() const { return m_hwnd; }
+
+    void* GetNativeWindow() const override { return m_hwnd; }
+    void SetWindowTitle(const std::wstring& title) override;
+    void SetPaused(bool paused) override;
+    void RequestQuit() override;
 
 protected:
     static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
 private:
-    static HWND m_hwnd;
+    HINSTANCE m_hInstance;
+    int m_nCmdShow;
+    HWND m_hwnd;
+    DXSample* m_pSample;
+    bool m_minimized;
+    bool m_paused;
+    bool m_quitRequested;
 };
@@ -17,12 +17,17 @@ D3D12HelloLighting::D3D12HelloLighting(UINT width, UINT height, std::wstring nam
 DXSample(width, height, name),
 m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
 m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+m_commandList(m_renderStats),
 m_constantDataGpuAddr(0),
 m_mappedConstantData(nullptr),
 m_rtvDescriptorSize(0),
 m_frameIndex(0),
 m_fenceValues{},
-m_curRotationAngleRad(0.0f)
+m_curRotationAngleRad(0.0f),
+m_numDrawCalls(0),
+m_lightBuffers{},
+m_clusterRangeBuffers{},
+m_lightIndexBuffers{}
 {
     // Initialize the world matrix
     m_worldMatrix = XMMatrixIdentity();
@@ -51,6 +56,9 @@ void D3D12HelloLighting::OnInit()
 {
 	LoadPipeline();
 	LoadAssets();
+	CreateClusteredLights();
+
+	m_benchmark.SetRenderStats(&m_renderStats);
 }
 
 // Load the rendering pipeline dependencies.
@@ -199,10 +207,15 @@ void D3D12HelloLighting::LoadAssets()
         featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
     }
 
-    // Create a root signature with one constant buffer view.
+    // Create a root signature with one constant buffer view, and a shader resource view for
+    // each buffer of the clustered lighting: the lights, the light range of each cluster
+    // and the light index list.
     {
-        CD3DX12_ROOT_PARAMETER1 rp[1] = {};
+        CD3DX12_ROOT_PARAMETER1 rp[4] = {};
         rp[0].InitAsConstantBufferView(0, 0);
+        rp[1].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
+        rp[2].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
+        rp[3].InitAsShaderResourceView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
 
         // Allow input layout and deny uneccessary access to certain pipeline stages.
         D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
@@ -223,7 +236,8 @@ void D3D12HelloLighting::LoadAssets()
     // Create the constant buffer memory and map the resource
     {
         const D3D12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        size_t cbSize = c_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
+        m_numDrawCalls = m_sceneScale + 2;
+        size_t cbSize = m_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
 
         const D3D12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(cbSize);
         ThrowIfFailed(m_device->CreateCommittedResource(
@@ -305,7 +319,7 @@ void D3D12HelloLighting::LoadAssets()
     }
 
     // Create the command list.
-    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
 
     // Command lists are created in the recording state, but there is nothing
     // to record yet. The main loop expects it to be closed, so close it now.
@@ -447,13 +461,141 @@ void D3D12HelloLighting::LoadAssets()
     }
 }
 
+// Place the clustered lights on random orbits around the cubes, and set up the cluster grid
+// of the view.
+void D3D12HelloLighting::CreateClusteredLights()
+{
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, m_projectionMatrix);
+
+    ClusterGridDesc grid;
+    grid.width = m_width;
+    grid.height = m_height;
+    grid.tileSize = c_clusterTileSize;
+    grid.sliceCount = c_clusterSliceCount;
+    grid.nearZ = 1.0f;
+    grid.farZ = 100.0f;
+    grid.projectionScaleX = projection._11;
+    grid.projectionScaleY = projection._22;
+    m_lightBinner.SetGrid(grid);
+
+    auto random = [](float minimum, float maximum)
+    {
+        return minimum + (maximum - minimum) * (static_cast<float>(rand()) / RAND_MAX);
+    };
+
+    // The orbits cover the grid of cubes, and the lights get dimmer as there are more of
+    // them so that the cubes don't saturate.
+    const float maxOrbitRadius = 5.0f + 3.0f * GetCubeGridWidth();
+    const float intensity = m_lightCount > 64 ? 64.0f / m_lightCount : 1.0f;
+
+    m_clusteredLights.resize(m_lightCount);
+    m_lightOrbits.resize(m_lightCount);
+    m_lightBounds.resize(m_lightCount);
+    for (UINT i = 0; i < m_lightCount; ++i)
+    {
+        LightOrbit& orbit = m_lightOrbits[i];
+        orbit.radius = random(2.0f, maxOrbitRadius);
+        orbit.height = random(-1.5f, 2.5f);
+        orbit.angle = random(0.0f, XM_2PI);
+        orbit.angularSpeed = random(-1.0f, 1.0f);
+
+        // One light in four is a spot light aimed at the center of the scene, with a cone
+        // fading out between 20 and 30 degrees.
+        const bool isSpotLight = i % 4 == 3;
+        ClusteredLight& light = m_clusteredLights[i];
+        light.range = isSpotLight ? random(4.0f, 7.0f) : random(1.5f, 3.0f);
+        light.color = XMFLOAT3(random(0.2f, 1.0f) * intensity, random(0.2f, 1.0f) * intensity, random(0.2f, 1.0f) * intensity);
+        light.spotCosOuter = isSpotLight ? 0.866f : -2.0f;
+        light.spotCosInner = isSpotLight ? 0.940f : -1.0f;
+        light.direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+    }
+}
+
+// Move the clustered lights along their orbits and bin them into the clusters of the view.
+void D3D12HelloLighting::UpdateClusteredLights()
+{
+    const float time = static_cast<float>(m_timer.GetTotalSeconds());
+
+    for (UINT i = 0; i < m_lightCount; ++i)
+    {
+        const LightOrbit& orbit = m_lightOrbits[i];
+        ClusteredLight& light = m_clusteredLights[i];
+
+        float sine, cosine;
+        XMScalarSinCos(&sine, &cosine, orbit.angle + orbit.angularSpeed * time);
+        const XMVECTOR position = XMVectorSet(orbit.radius * cosine, orbit.height, orbit.radius * sine, 1.0f);
+        const XMVECTOR direction = XMVector3Normalize(XMVectorSet(-orbit.radius * cosine, -orbit.height, -orbit.radius * sine, 0.0f));
+        XMStoreFloat3(&light.position, position);
+        XMStoreFloat3(&light.direction, direction);
+
+        // The binning works in view space.
+        XMFLOAT3 viewPosition;
+        XMFLOAT3 viewDirection;
+        XMStoreFloat3(&viewPosition, XMVector3TransformCoord(position, m_viewMatrix));
+        XMStoreFloat3(&viewDirection, XMVector3TransformNormal(direction, m_viewMatrix));
+        const float center[3] = { viewPosition.x, viewPosition.y, viewPosition.z };
+        const float axis[3] = { viewDirection.x, viewDirection.y, viewDirection.z };
+
+        m_lightBounds[i] = light.spotCosOuter > -1.0f ?
+            GetSpotLightBounds(center, axis, light.range, light.spotCosOuter) :
+            GetPointLightBounds(center, light.range);
+    }
+
+    BENCHMARK_PHASE(m_benchmark, "LightBinning");
+    m_lightBinner.Bin(m_lightBounds.data(), m_lightCount);
+}
+
+// Side of the square grid of the cube copies (-scene-scale) behind the first cube.
+UINT D3D12HelloLighting::GetCubeGridWidth() const
+{
+    UINT gridWidth = 1;
+    while (gridWidth * gridWidth < m_sceneScale - 1)
+    {
+        ++gridWidth;
+    }
+    return gridWidth;
+}
+
+// Copy data to an upload buffer of the current frame. The buffer is replaced by a larger one
+// when the data doesn't fit; the GPU is done with it since MoveToNextFrame() waited for the
+// last frame that used it.
+void D3D12HelloLighting::UpdateUploadBuffer(UploadBuffer& buffer, const void* pData, UINT64 size)
+{
+    if (buffer.resource == nullptr || size > buffer.size)
+    {
+        // Grow geometrically, so that a slowly growing light index list doesn't reallocate
+        // every frame. Empty lists still get a buffer to bind.
+        const UINT64 newSize = (std::max)((std::max)(size, 2 * buffer.size), static_cast<UINT64>(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT));
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(newSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(buffer.resource.ReleaseAndGetAddressOf())));
+
+        CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
+        ThrowIfFailed(buffer.resource->Map(0, &readRange, &buffer.pMappedData));
+        buffer.size = newSize;
+    }
+
+    if (size > 0)
+    {
+        m_renderStats.CopyToUploadMemory(buffer.pMappedData, pData, static_cast<size_t>(size));
+    }
+}
+
 // Update frame-based values.
 void D3D12HelloLighting::OnUpdate()
 {
-    const float rotationSpeed = 0.015f;
+    // Radians per second.
+    const float rotationSpeed = 0.9f;
+
+    m_timer.Tick();
 
     // Update the rotation constant
-    m_curRotationAngleRad += rotationSpeed;
+    m_curRotationAngleRad += rotationSpeed * static_cast<float>(m_timer.GetElapsedSeconds());
     if (m_curRotationAngleRad >= XM_2PI)
     {
         m_curRotationAngleRad -= XM_2PI;
@@ -468,22 +610,48 @@ void D3D12HelloLighting::OnUpdate()
     // Rotate the second light around the origin
     XMMATRIX rotate = XMMatrixRotationY(-2.0f * m_curRotationAngleRad);
     m_lightDirs[1] = XMVector3Transform(m_lightDirs[1], rotate);
+
+    UpdateClusteredLights();
 }
 
 // Render the scene.
 void D3D12HelloLighting::OnRender()
 {
     // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList();
+    {
+        BENCHMARK_PHASE(m_benchmark, "PopulateCommandList");
+        PopulateCommandList();
+    }
 
     // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    {
+        BENCHMARK_PHASE(m_benchmark, "ExecuteCommandLists");
+        ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+        m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    }
 
     // Present the frame.
-    ThrowIfFailed(m_swapChain->Present(1, 0));
+    {
+        BENCHMARK_PHASE(m_benchmark, "Present");
+        ThrowIfFailed(m_swapChain->Present(m_syncInterval, 0));
+    }
+
+    {
+        BENCHMARK_PHASE(m_benchmark, "MoveToNextFrame");
+        MoveToNextFrame();
+    }
+
+    // Close the counters of this frame and periodically print a summary.
+    if (m_renderStats.EndFrame() % c_renderStatsDumpInterval == 0)
+    {
+        OutputDebugStringA(m_renderStats.FormatSummary(c_renderStatsDumpInterval).c_str());
 
-    MoveToNextFrame();
+        const LightBinningStats& binning = m_lightBinner.GetStats();
+        char text[192];
+        sprintf_s(text, "Light binning: %u lights, %u visible, %zu indices, at most %u per cluster, %.3f ms on %u threads\n",
+            binning.lightCount, binning.visibleLightCount, binning.indexCount, binning.maxClusterLightCount, binning.binSeconds * 1000.0, binning.threadCount);
+        OutputDebugStringA(text);
+    }
 }
 
 void D3D12HelloLighting::OnDestroy()
@@ -515,7 +683,7 @@ void D3D12HelloLighting::PopulateCommandList()
     // Index into the available constant buffers based on the number
     // of draw calls. We've allocated enough for a known number of
     // draw calls per frame times the number of back buffers
-    unsigned int constantBufferIndex = c_numDrawCalls * (m_frameIndex % FrameCount);
+    unsigned int constantBufferIndex = m_numDrawCalls * (m_frameIndex % FrameCount);
 
     // Set the per-frame constants
     ConstantBuffer cbParameters = {};
@@ -530,14 +698,26 @@ void D3D12HelloLighting::PopulateCommandList()
     XMStoreFloat4(&cbParameters.lightColors[0], m_lightColors[0]);
     XMStoreFloat4(&cbParameters.lightColors[1], m_lightColors[1]);
     XMStoreFloat4(&cbParameters.outputColor, m_outputColor);
+    cbParameters.clusterGrid = XMUINT4(c_clusterTileSize, m_lightBinner.GetTileCountX(), m_lightBinner.GetTileCountY(), c_clusterSliceCount);
+    cbParameters.clusterDepth = XMFLOAT4(m_lightBinner.GetSliceScale(), m_lightBinner.GetSliceBias(), 0.0f, 0.0f);
 
     // Set the constants for the first draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
     // Bind the constants to the shader
     auto baseGpuAddress = m_constantDataGpuAddr + sizeof(PaddedConstantBuffer) * constantBufferIndex;
     m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
 
+    // Upload the clustered lights binned by OnUpdate() and bind them to the pixel shader
+    const std::vector<uint32_t>& clusterRanges = m_lightBinner.GetClusterRanges();
+    const std::vector<uint32_t>& lightIndices = m_lightBinner.GetLightIndices();
+    UpdateUploadBuffer(m_lightBuffers[m_frameIndex], m_clusteredLights.data(), m_clusteredLights.size() * sizeof(ClusteredLight));
+    UpdateUploadBuffer(m_clusterRangeBuffers[m_frameIndex], clusterRanges.data(), clusterRanges.size() * sizeof(uint32_t));
+    UpdateUploadBuffer(m_lightIndexBuffers[m_frameIndex], lightIndices.data(), lightIndices.size() * sizeof(uint32_t));
+    m_commandList->SetGraphicsRootShaderResourceView(1, m_lightBuffers[m_frameIndex].resource->GetGPUVirtualAddress());
+    m_commandList->SetGraphicsRootShaderResourceView(2, m_clusterRangeBuffers[m_frameIndex].resource->GetGPUVirtualAddress());
+    m_commandList->SetGraphicsRootShaderResourceView(3, m_lightIndexBuffers[m_frameIndex].resource->GetGPUVirtualAddress());
+
     // Indicate that the back buffer will be used as a render target.
     m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
@@ -561,6 +741,25 @@ void D3D12HelloLighting::PopulateCommandList()
     baseGpuAddress += sizeof(PaddedConstantBuffer);
     ++constantBufferIndex;
 
+    // Draw the extra copies of the cube (-scene-scale) on a grid behind the first one
+    const UINT gridWidth = GetCubeGridWidth();
+    for (UINT copy = 1; copy < m_sceneScale; ++copy)
+    {
+        const float x = 3.0f * ((copy - 1) % gridWidth) - 1.5f * (gridWidth - 1);
+        const float z = 3.0f * (1 + (copy - 1) / gridWidth);
+        XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(m_worldMatrix * XMMatrixTranslation(x, 0.0f, z)));
+
+        // Set the constants for the draw call
+        m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+
+        // Bind the constants to the shader
+        m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+
+        m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+        baseGpuAddress += sizeof(PaddedConstantBuffer);
+        ++constantBufferIndex;
+    }
+
     // Render each light
     m_commandList->SetPipelineState(m_solidColorPipelineState.Get());
 
@@ -575,7 +774,7 @@ void D3D12HelloLighting::PopulateCommandList()
         cbParameters.outputColor = cbParameters.lightColors[m];
 
         // Set the constants for the draw call
-        memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+        m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
         // Bind the constants to the shader
         m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
@@ -600,7 +799,7 @@ void D3D12HelloLighting::WaitForGpu()
 
     // Wait until the fence has been processed.
     ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-    WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
 
     // Increment the fence value for the current frame.
     m_fenceValues[m_frameIndex]++;
@@ -620,7 +819,7 @@ void D3D12HelloLighting::MoveToNextFrame()
     if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
     {
         ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+        m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
     }
 
     // Set the fence value for the next frame.
@@ -12,6 +12,9 @@
 #pragma once
 
 #include "DXSample.h"
+#include "StepTimer.h"
+#include "StatsCommandList.h"
+#include "LightBinner.h"
 
 using namespace DirectX;
 
@@ -59,12 +62,14 @@ private:
         XMFLOAT4 lightDirs[2];         // 32 bytes
         XMFLOAT4 lightColors[2];       // 32 bytes
         XMFLOAT4 outputColor;          // 16 bytes
+        XMUINT4 clusterGrid;           // 16 bytes: tile size in pixels, tile columns, tile rows, depth slices
+        XMFLOAT4 clusterDepth;         // 16 bytes: slice = log(view depth) * x + y
     };
 
     // We'll allocate space for several of these and they will need to be padded for alignment.
-    static_assert(sizeof(ConstantBuffer) == 272, "Checking the size here.");
+    static_assert(sizeof(ConstantBuffer) == 304, "Checking the size here.");
 
-    // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT < 272 < 2 * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+    // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT < 304 < 2 * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
     // Create a union with the correct size and enough room for one ConstantBuffer
     union PaddedConstantBuffer
     {
@@ -75,6 +80,38 @@ private:
     // Check the exact size of the PaddedConstantBuffer to make sure it will align properly
     static_assert(sizeof(PaddedConstantBuffer) == 2 * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, "PaddedConstantBuffer is not aligned properly");
 
+    // Point or spot light of the clustered forward pass, laid out as ClusteredLight in
+    // shaders.hlsl. Positions and directions are in world space.
+    struct ClusteredLight
+    {
+        XMFLOAT3 position;
+        float range;
+        XMFLOAT3 color;
+        float spotCosOuter;            // -2 for point lights, so that the cone doesn't attenuate them.
+        XMFLOAT3 direction;
+        float spotCosInner;            // -1 for point lights.
+    };
+
+    static_assert(sizeof(ClusteredLight) == 48, "ClusteredLight doesn't match the HLSL structure.");
+
+    // Orbit of a clustered light around the Y-axis.
+    struct LightOrbit
+    {
+        float radius;
+        float height;
+        float angle;
+        float angularSpeed;            // Radians per second.
+    };
+
+    // Persistently mapped upload buffer, read by the shaders through a root SRV. There is one
+    // per frame, so a buffer can be replaced by a larger one once its frame has completed.
+    struct UploadBuffer
+    {
+        ComPtr<ID3D12Resource> resource;
+        void* pMappedData;
+        UINT64 size;
+    };
+
     // Pipeline objects.
     CD3DX12_VIEWPORT m_viewport;
     CD3DX12_RECT m_scissorRect;
@@ -89,7 +126,8 @@ private:
     ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
     ComPtr<ID3D12PipelineState>  m_lambertPipelineState;
     ComPtr<ID3D12PipelineState>  m_solidColorPipelineState;
-    ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    RenderStats m_renderStats;
+    StatsCommandList m_commandList;     // Counts the recorded commands into m_renderStats.
 
     // App resources.
     ComPtr<ID3D12Resource> m_vertexBuffer;
@@ -108,11 +146,12 @@ private:
     UINT64 m_fenceValues[FrameCount];
 
     // Scene constants, updated per-frame
+    StepTimer m_timer;
     float m_curRotationAngleRad;
 
-    // In this simple sample, we know that there are three draw calls
-    // and we will update the scene constants for each draw call.
-    static const unsigned int c_numDrawCalls = 3;
+    // There is a draw call for each lit cube (one per unit of scene scale) and for each
+    // light, and we will update the scene constants for each draw call.
+    unsigned int m_numDrawCalls;
 
     // These computed values will be loaded into a ConstantBuffer
     // during Render
@@ -123,8 +162,28 @@ private:
     XMVECTOR m_lightColors[2];
     XMVECTOR m_outputColor;
 
+    // Clustered point and spot lights (-lights), binned on the CPU every frame.
+    LightBinner m_lightBinner;
+    std::vector<ClusteredLight> m_clusteredLights;
+    std::vector<LightOrbit> m_lightOrbits;
+    std::vector<LightBounds> m_lightBounds;
+    UploadBuffer m_lightBuffers[FrameCount];
+    UploadBuffer m_clusterRangeBuffers[FrameCount];
+    UploadBuffer m_lightIndexBuffers[FrameCount];
+
+    // Cluster grid of the lighting: 64x64 pixel tiles and 24 depth slices from 1 to the far plane.
+    static const UINT c_clusterTileSize = 64;
+    static const UINT c_clusterSliceCount = 24;
+
+    // Frames between two dumps of the render stats to the debugger output.
+    static const UINT c_renderStatsDumpInterval = 300;
+
     void LoadPipeline();
     void LoadAssets();
+    void CreateClusteredLights();
+    void UpdateClusteredLights();
+    UINT GetCubeGridWidth() const;
+    void UpdateUploadBuffer(UploadBuffer& buffer, const void* pData, UINT64 size);
     void PopulateCommandList();
     void MoveToNextFrame();
     void WaitForGpu();
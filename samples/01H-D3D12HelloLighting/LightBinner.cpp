@@ -0,0 +1,431 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "LightBinner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_BINNER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // The slices are widened by this fraction of their depth, so that pixels the shader
+    // puts in the neighboring slice because of rounding still find their lights.
+    const float c_sliceDepthMargin = 1e-3f;
+
+#if defined(LIGHT_BINNER_SSE)
+    // Lowest and highest set bits of a four-lane comparison mask.
+    const uint8_t c_firstLane[16] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+    const uint8_t c_lastLane[16] = { 0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3 };
+#endif
+
+    uint32_t GetTile(float pixel, uint32_t tileSize, uint32_t tileCount)
+    {
+        if (!(pixel > 0.0f))
+        {
+            return 0;
+        }
+        const float tile = pixel / static_cast<float>(tileSize);
+        return tile >= static_cast<float>(tileCount - 1) ? tileCount - 1 : static_cast<uint32_t>(tile);
+    }
+
+    // Distance from x to the interval [lo, hi].
+    float GetDistance(float x, float lo, float hi)
+    {
+        return (std::max)(lo - x, 0.0f) + (std::max)(x - hi, 0.0f);
+    }
+}
+
+LightBounds GetPointLightBounds(const float viewPosition[3], float range)
+{
+    LightBounds bounds = { { viewPosition[0], viewPosition[1], viewPosition[2] }, range };
+    return bounds;
+}
+
+LightBounds GetSpotLightBounds(const float viewPosition[3], const float viewDirection[3], float range, float cosOuterAngle)
+{
+    // A wide cone is bounded by the circle of its cap. A narrow one is bounded by the
+    // sphere through its apex and the rim of the cap.
+    float offset;
+    float radius;
+    if (cosOuterAngle < 0.70710678f)
+    {
+        const float sinOuterAngle = std::sqrt((std::max)(0.0f, 1.0f - cosOuterAngle * cosOuterAngle));
+        offset = range * (std::max)(cosOuterAngle, 0.0f);
+        radius = cosOuterAngle > 0.0f ? range * sinOuterAngle : range;
+    }
+    else
+    {
+        offset = range / (2.0f * cosOuterAngle);
+        radius = offset;
+    }
+
+    LightBounds bounds =
+    {
+        {
+            viewPosition[0] + viewDirection[0] * offset,
+            viewPosition[1] + viewDirection[1] * offset,
+            viewPosition[2] + viewDirection[2] * offset
+        },
+        radius
+    };
+    return bounds;
+}
+
+LightBinner::LightBinner(unsigned int threadCount) :
+    m_tileCountX(0),
+    m_tileCountY(0),
+    m_rowStride(0),
+    m_sliceScale(0.0f),
+    m_sliceBias(0.0f),
+    m_stats(),
+    m_workerPool(threadCount)
+{
+    m_stats.threadCount = m_workerPool.GetThreadCount();
+}
+
+void LightBinner::SetGrid(const ClusterGridDesc& grid)
+{
+    if (grid.width == 0 || grid.height == 0 || grid.tileSize == 0 || grid.sliceCount == 0 ||
+        !(grid.nearZ > 0.0f) || !(grid.farZ > grid.nearZ) ||
+        !(grid.projectionScaleX > 0.0f) || !(grid.projectionScaleY > 0.0f))
+    {
+        throw std::runtime_error("LightBinner: invalid cluster grid");
+    }
+
+    m_grid = grid;
+    m_tileCountX = (grid.width + grid.tileSize - 1) / grid.tileSize;
+    m_tileCountY = (grid.height + grid.tileSize - 1) / grid.tileSize;
+    m_rowStride = (m_tileCountX + 3) & ~3u;
+
+    const float logDepthRatio = std::log(grid.farZ / grid.nearZ);
+    m_sliceScale = grid.sliceCount / logDepthRatio;
+    m_sliceBias = -(grid.sliceCount * std::log(grid.nearZ)) / logDepthRatio;
+
+    m_minX.assign(grid.sliceCount * m_rowStride, 0.0f);
+    m_maxX.assign(grid.sliceCount * m_rowStride, 0.0f);
+    m_minY.resize(grid.sliceCount * m_tileCountY);
+    m_maxY.resize(grid.sliceCount * m_tileCountY);
+    m_minZ.resize(grid.sliceCount);
+    m_maxZ.resize(grid.sliceCount);
+
+    for (uint32_t slice = 0; slice < grid.sliceCount; ++slice)
+    {
+        // Pixels nearer than nearZ are in the first slice, and none is beyond farZ.
+        const float sliceNear = slice == 0 ? 0.0f :
+            grid.nearZ * std::pow(grid.farZ / grid.nearZ, static_cast<float>(slice) / grid.sliceCount);
+        const float sliceFar = slice + 1 == grid.sliceCount ? grid.farZ :
+            grid.nearZ * std::pow(grid.farZ / grid.nearZ, static_cast<float>(slice + 1) / grid.sliceCount);
+        const float zNear = sliceNear * (1.0f - c_sliceDepthMargin);
+        const float zFar = sliceFar * (1.0f + c_sliceDepthMargin);
+        m_minZ[slice] = zNear;
+        m_maxZ[slice] = zFar;
+
+        // The AABB of a tile's frustum between two depths: a side of the frustum reaches
+        // its outermost point at the far depth, unless it crosses the view axis.
+        for (uint32_t x = 0; x < m_tileCountX; ++x)
+        {
+            const float left = 2.0f * (x * grid.tileSize) / grid.width - 1.0f;
+            const float right = 2.0f * (std::min)((x + 1) * grid.tileSize, grid.width) / grid.width - 1.0f;
+            m_minX[slice * m_rowStride + x] = left * (left < 0.0f ? zFar : zNear) / grid.projectionScaleX;
+            m_maxX[slice * m_rowStride + x] = right * (right > 0.0f ? zFar : zNear) / grid.projectionScaleX;
+        }
+        for (uint32_t y = 0; y < m_tileCountY; ++y)
+        {
+            const float top = 1.0f - 2.0f * (y * grid.tileSize) / grid.height;
+            const float bottom = 1.0f - 2.0f * (std::min)((y + 1) * grid.tileSize, grid.height) / grid.height;
+            m_minY[slice * m_tileCountY + y] = bottom * (bottom < 0.0f ? zFar : zNear) / grid.projectionScaleY;
+            m_maxY[slice * m_tileCountY + y] = top * (top > 0.0f ? zFar : zNear) / grid.projectionScaleY;
+        }
+    }
+
+    m_slices.resize(grid.sliceCount);
+    m_clusterRanges.assign(2 * GetClusterCount(), 0);
+    m_lightIndices.clear();
+}
+
+uint32_t LightBinner::GetSlice(float z) const
+{
+    const float slice = std::floor(std::log(z) * m_sliceScale + m_sliceBias);
+    if (!(slice > 0.0f))
+    {
+        return 0;
+    }
+    return slice >= static_cast<float>(m_grid.sliceCount - 1) ? m_grid.sliceCount - 1 : static_cast<uint32_t>(slice);
+}
+
+void LightBinner::Bin(const LightBounds* pLights, uint32_t lightCount)
+{
+    if (m_slices.empty())
+    {
+        throw std::runtime_error("LightBinner: SetGrid() must be called before Bin()");
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (Slice& slice : m_slices)
+    {
+        slice.lights.clear();
+    }
+    m_footprints.resize(lightCount);
+
+    // Find the tiles and slices covered by each light. The tiles are bounded by the
+    // projection of the box around the sphere; a sphere that reaches the camera plane
+    // may cover the whole screen.
+    uint32_t visibleLightCount = 0;
+    const float width = static_cast<float>(m_grid.width);
+    const float height = static_cast<float>(m_grid.height);
+    for (uint32_t i = 0; i < lightCount; ++i)
+    {
+        const LightBounds& light = pLights[i];
+        const float zNear = light.center[2] - light.radius;
+        const float zFar = light.center[2] + light.radius;
+        if (!(zFar > 0.0f) || zNear >= m_grid.farZ)
+        {
+            continue;
+        }
+
+        LightFootprint& footprint = m_footprints[i];
+        if (zNear <= m_grid.nearZ * 1e-3f)
+        {
+            footprint.firstTileX = 0;
+            footprint.lastTileX = m_tileCountX - 1;
+            footprint.firstTileY = 0;
+            footprint.lastTileY = m_tileCountY - 1;
+        }
+        else
+        {
+            const float left = light.center[0] - light.radius;
+            const float right = light.center[0] + light.radius;
+            const float bottom = light.center[1] - light.radius;
+            const float top = light.center[1] + light.radius;
+            const float minX = m_grid.projectionScaleX * (std::min)(left / zNear, left / zFar);
+            const float maxX = m_grid.projectionScaleX * (std::max)(right / zNear, right / zFar);
+            const float minY = m_grid.projectionScaleY * (std::min)(bottom / zNear, bottom / zFar);
+            const float maxY = m_grid.projectionScaleY * (std::max)(top / zNear, top / zFar);
+            if (minX > 1.0f || maxX < -1.0f || minY > 1.0f || maxY < -1.0f)
+            {
+                continue;
+            }
+
+            footprint.firstTileX = GetTile((minX + 1.0f) * 0.5f * width, m_grid.tileSize, m_tileCountX);
+            footprint.lastTileX = GetTile((maxX + 1.0f) * 0.5f * width, m_grid.tileSize, m_tileCountX);
+            footprint.firstTileY = GetTile((1.0f - maxY) * 0.5f * height, m_grid.tileSize, m_tileCountY);
+            footprint.lastTileY = GetTile((1.0f - minY) * 0.5f * height, m_grid.tileSize, m_tileCountY);
+        }
+
+        const uint32_t firstSlice = zNear > 0.0f ? GetSlice(zNear * (1.0f - c_sliceDepthMargin)) : 0;
+        const uint32_t lastSlice = GetSlice(zFar * (1.0f + c_sliceDepthMargin));
+        for (uint32_t slice = firstSlice; slice <= lastSlice; ++slice)
+        {
+            m_slices[slice].lights.push_back(i);
+        }
+        ++visibleLightCount;
+    }
+
+    m_workerPool.Run(m_grid.sliceCount, [this, pLights](uint32_t slice) { CountSlice(slice, pLights); });
+
+    // Place the slices one after the other in the index list, so that each thread can
+    // write the lists of the slices it picks.
+    uint32_t indexCount = 0;
+    uint32_t maxClusterLightCount = 0;
+    for (Slice& slice : m_slices)
+    {
+        slice.indexOffset = indexCount;
+        indexCount += slice.lightIndexCount;
+        maxClusterLightCount = (std::max)(maxClusterLightCount, slice.maxClusterLightCount);
+    }
+    m_lightIndices.resize(indexCount);
+
+    m_workerPool.Run(m_grid.sliceCount, [this](uint32_t slice) { FillSlice(slice); });
+
+    m_stats.lightCount = lightCount;
+    m_stats.visibleLightCount = visibleLightCount;
+    m_stats.indexCount = indexCount;
+    m_stats.maxClusterLightCount = maxClusterLightCount;
+    m_stats.binSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Visitor>
+void LightBinner::ForEachOverlap(uint32_t sliceIndex, const LightBounds* pLights, Visitor&& visit) const
+{
+    const Slice& slice = m_slices[sliceIndex];
+    const float* pMinX = &m_minX[sliceIndex * m_rowStride];
+    const float* pMaxX = &m_maxX[sliceIndex * m_rowStride];
+    const float* pMinY = &m_minY[sliceIndex * m_tileCountY];
+    const float* pMaxY = &m_maxY[sliceIndex * m_tileCountY];
+
+    for (uint32_t light : slice.lights)
+    {
+        const LightBounds& bounds = pLights[light];
+        const LightFootprint& footprint = m_footprints[light];
+
+        // The squared distance to an AABB is the sum of the squared distances along each
+        // axis; z is the same for the whole slice and y for a whole row.
+        const float dz = GetDistance(bounds.center[2], m_minZ[sliceIndex], m_maxZ[sliceIndex]);
+        const float sliceRadiusSq = bounds.radius * bounds.radius - dz * dz;
+        if (sliceRadiusSq < 0.0f)
+        {
+            continue;
+        }
+
+        for (uint32_t y = footprint.firstTileY; y <= footprint.lastTileY; ++y)
+        {
+            const float dy = GetDistance(bounds.center[1], pMinY[y], pMaxY[y]);
+            const float rowRadiusSq = sliceRadiusSq - dy * dy;
+            if (rowRadiusSq < 0.0f)
+            {
+                continue;
+            }
+
+            // The x bounds grow from left to right, so the clusters of a row that overlap
+            // the sphere are contiguous and the scan stops at the end of the run.
+            uint32_t firstTile = 0;
+            uint32_t lastTile = 0;
+            bool found = false;
+#if defined(LIGHT_BINNER_SSE)
+            const __m128 centerX = _mm_set1_ps(bounds.center[0]);
+            const __m128 radiusSq = _mm_set1_ps(rowRadiusSq);
+            const __m128 zero = _mm_setzero_ps();
+
+            // Rows are padded to a multiple of four columns; lanes outside the footprint
+            // are masked out.
+            for (uint32_t x = footprint.firstTileX & ~3u; x <= footprint.lastTileX; x += 4)
+            {
+                const __m128 below = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(pMinX + x), centerX), zero);
+                const __m128 above = _mm_max_ps(_mm_sub_ps(centerX, _mm_loadu_ps(pMaxX + x)), zero);
+                const __m128 dx = _mm_add_ps(below, above);
+                int mask = _mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dx, dx), radiusSq));
+
+                const uint32_t firstLane = footprint.firstTileX > x ? footprint.firstTileX - x : 0;
+                const uint32_t lastLane = (std::min)(footprint.lastTileX - x, 3u);
+                mask &= ((2 << lastLane) - 1) & ~((1 << firstLane) - 1);
+                if (mask != 0)
+                {
+                    if (!found)
+                    {
+                        firstTile = x + c_firstLane[mask];
+                        found = true;
+                    }
+                    lastTile = x + c_lastLane[mask];
+                }
+                else if (found)
+                {
+                    break;
+                }
+            }
+#else
+            for (uint32_t x = footprint.firstTileX; x <= footprint.lastTileX; ++x)
+            {
+                const float dx = GetDistance(bounds.center[0], pMinX[x], pMaxX[x]);
+                if (dx * dx <= rowRadiusSq)
+                {
+                    if (!found)
+                    {
+                        firstTile = x;
+                        found = true;
+                    }
+                    lastTile = x;
+                }
+                else if (found)
+                {
+                    break;
+                }
+            }
+#endif
+            if (found)
+            {
+                const uint32_t rowBase = y * m_tileCountX;
+                visit(rowBase + firstTile, rowBase + lastTile, light);
+            }
+        }
+    }
+}
+
+void LightBinner::CountSlice(uint32_t sliceIndex, const LightBounds* pLights)
+{
+    // The lights of the runs are counted in a difference array, so that a run costs the
+    // same whatever its length. The unsigned arithmetic wraps around for the negative
+    // differences.
+    Slice& slice = m_slices[sliceIndex];
+    const uint32_t clusterCount = m_tileCountX * m_tileCountY;
+    const uint32_t tileCountX = m_tileCountX;
+
+    slice.firstLight.assign(clusterCount + 1, 0);
+    slice.firstRun.assign(m_tileCountY + 1, 0);
+    slice.runs.clear();
+    uint32_t* pFirstLight = slice.firstLight.data();
+    uint32_t* pFirstRun = slice.firstRun.data();
+    ForEachOverlap(sliceIndex, pLights, [&slice, pFirstLight, pFirstRun, tileCountX](uint32_t firstCluster, uint32_t lastCluster, uint32_t light)
+    {
+        ++pFirstLight[firstCluster];
+        --pFirstLight[lastCluster + 1];
+        ++pFirstRun[firstCluster / tileCountX + 1];
+        slice.runs.push_back({ firstCluster, lastCluster, light });
+    });
+
+    uint32_t count = 0;
+    uint32_t offset = 0;
+    slice.maxClusterLightCount = 0;
+    for (uint32_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        count += pFirstLight[cluster];
+        slice.maxClusterLightCount = (std::max)(slice.maxClusterLightCount, count);
+        pFirstLight[cluster] = offset;
+        offset += count;
+    }
+    pFirstLight[clusterCount] = offset;
+    slice.lightIndexCount = offset;
+}
+
+void LightBinner::FillSlice(uint32_t sliceIndex)
+{
+    Slice& slice = m_slices[sliceIndex];
+    const uint32_t clusterCount = m_tileCountX * m_tileCountY;
+
+    uint32_t* pFirstLight = slice.firstLight.data();
+    uint32_t* pRanges = &m_clusterRanges[2 * sliceIndex * clusterCount];
+    for (uint32_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        pRanges[2 * cluster] = slice.indexOffset + pFirstLight[cluster];
+        pRanges[2 * cluster + 1] = pFirstLight[cluster + 1] - pFirstLight[cluster];
+    }
+
+    // The runs were found light by light; group them by tile row, keeping the order of
+    // the lights, so that the writes stay within the lists of one row at a time instead
+    // of being scattered over the whole slice.
+    uint32_t* pFirstRun = slice.firstRun.data();
+    for (uint32_t y = 0; y < m_tileCountY; ++y)
+    {
+        pFirstRun[y + 1] += pFirstRun[y];
+    }
+    slice.rowRuns.resize(slice.runs.size());
+    for (const ClusterRun& run : slice.runs)
+    {
+        slice.rowRuns[pFirstRun[run.firstCluster / m_tileCountX]++] = run;
+    }
+
+    // Storing a light advances the offset of its cluster.
+    uint32_t* pLightIndices = m_lightIndices.data() + slice.indexOffset;
+    for (const ClusterRun& run : slice.rowRuns)
+    {
+        for (uint32_t cluster = run.firstCluster; cluster <= run.lastCluster; ++cluster)
+        {
+            pLightIndices[pFirstLight[cluster]++] = run.light;
+        }
+    }
+}
@@ -0,0 +1,165 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "WorkerPool.h"
+
+// Froxel grid of the clustered forward lighting: screen tiles of tileSize pixels, times
+// sliceCount depth slices distributed logarithmically between nearZ and farZ.
+// Depths are in left-handed view space (+z looks into the screen). The first slice
+// starts at the camera and the last one ends at farZ.
+struct ClusterGridDesc
+{
+    uint32_t width = 0;             // Render target size in pixels.
+    uint32_t height = 0;
+    uint32_t tileSize = 64;
+    uint32_t sliceCount = 24;
+    float nearZ = 1.0f;
+    float farZ = 100.0f;
+
+    // _11 and _22 of the perspective projection matrix.
+    float projectionScaleX = 1.0f;
+    float projectionScaleY = 1.0f;
+};
+
+// View-space bounding sphere of the volume lit by a light.
+struct LightBounds
+{
+    float center[3];
+    float radius;
+};
+
+LightBounds GetPointLightBounds(const float viewPosition[3], float range);
+
+// Smallest sphere around the cone of a spot light; the direction must be normalized.
+LightBounds GetSpotLightBounds(const float viewPosition[3], const float viewDirection[3], float range, float cosOuterAngle);
+
+struct LightBinningStats
+{
+    uint32_t lightCount;
+    uint32_t visibleLightCount;         // Lights that touch at least one slice of the view frustum.
+    size_t indexCount;                  // Size of the light index list.
+    uint32_t maxClusterLightCount;
+    double binSeconds;
+    unsigned int threadCount;
+};
+
+// Assigns lights to the clusters of a ClusterGridDesc.
+// Each depth slice is binned by one of the worker threads: the bounding sphere of every
+// light overlapping the slice is tested against the view-space AABBs of the clusters of
+// the tile rows it projects to, four clusters at a time with SSE. The clusters of a tile
+// column share their x bounds and those of a tile row their y bounds, so a test only
+// costs a few instructions per cluster, and the clusters of a row that overlap a light
+// are contiguous.
+// The threads are started once and reused by every Bin() call; the buffers keep their
+// capacity between calls, so binning a similar set of lights doesn't allocate.
+class LightBinner
+{
+public:
+    // A threadCount of zero uses std::thread::hardware_concurrency().
+    explicit LightBinner(unsigned int threadCount = 0);
+
+    void SetGrid(const ClusterGridDesc& grid);
+    const ClusterGridDesc& GetGrid() const { return m_grid; }
+
+    uint32_t GetTileCountX() const      { return m_tileCountX; }
+    uint32_t GetTileCountY() const      { return m_tileCountY; }
+    uint32_t GetClusterCount() const    { return m_tileCountX * m_tileCountY * m_grid.sliceCount; }
+
+    // The slice of a view-space depth z is floor(log(z) * scale + bias), clamped to the
+    // grid. Shaders must use the same formula.
+    float GetSliceScale() const         { return m_sliceScale; }
+    float GetSliceBias() const          { return m_sliceBias; }
+
+    // Bins the lights. The index of a light in the lists is its index in the array.
+    void Bin(const LightBounds* pLights, uint32_t lightCount);
+
+    // Two values per cluster, the offset of its first light in GetLightIndices() and its
+    // light count. Cluster (x, y, slice) is at index (slice * tileCountY + y) * tileCountX + x;
+    // tile row 0 is at the top of the screen. The lights of a cluster are sorted.
+    const std::vector<uint32_t>& GetClusterRanges() const   { return m_clusterRanges; }
+    const std::vector<uint32_t>& GetLightIndices() const    { return m_lightIndices; }
+
+    const LightBinningStats& GetStats() const { return m_stats; }
+
+private:
+    LightBinner(const LightBinner&) = delete;
+    LightBinner& operator=(const LightBinner&) = delete;
+
+    // Tiles covered by a light, computed before the slices are binned.
+    struct LightFootprint
+    {
+        uint32_t firstTileX;
+        uint32_t lastTileX;
+        uint32_t firstTileY;
+        uint32_t lastTileY;
+    };
+
+    // Clusters of a tile row overlapped by a light.
+    struct ClusterRun
+    {
+        uint32_t firstCluster;
+        uint32_t lastCluster;
+        uint32_t light;
+    };
+
+    // Per-slice work buffers.
+    struct Slice
+    {
+        std::vector<uint32_t> lights;               // Lights whose bounds overlap the slice.
+        std::vector<ClusterRun> runs;               // In the order of the lights.
+        std::vector<ClusterRun> rowRuns;            // Grouped by tile row.
+        std::vector<uint32_t> firstRun;             // Offset of each tile row in rowRuns.
+        std::vector<uint32_t> firstLight;           // Offset of each cluster in the slice's lists, plus the total.
+        uint32_t lightIndexCount;
+        uint32_t maxClusterLightCount;
+        uint32_t indexOffset;                       // Offset of the slice in m_lightIndices.
+    };
+
+    uint32_t GetSlice(float z) const;
+
+    // Calls visit(firstCluster, lastCluster, light) for each run of clusters of a tile row
+    // that a light overlaps, with the indices of the clusters in the slice.
+    template <typename Visitor>
+    void ForEachOverlap(uint32_t slice, const LightBounds* pLights, Visitor&& visit) const;
+
+    void CountSlice(uint32_t slice, const LightBounds* pLights);
+    void FillSlice(uint32_t slice);
+
+    ClusterGridDesc m_grid;
+    uint32_t m_tileCountX;
+    uint32_t m_tileCountY;
+    uint32_t m_rowStride;       // Tile columns rounded up to a multiple of four.
+    float m_sliceScale;
+    float m_sliceBias;
+
+    // View-space bounds of the clusters: x bounds per slice and tile column, y bounds per
+    // slice and tile row, and z bounds per slice.
+    std::vector<float> m_minX;
+    std::vector<float> m_maxX;
+    std::vector<float> m_minY;
+    std::vector<float> m_maxY;
+    std::vector<float> m_minZ;
+    std::vector<float> m_maxZ;
+
+    std::vector<LightFootprint> m_footprints;
+    std::vector<Slice> m_slices;
+    std::vector<uint32_t> m_clusterRanges;
+    std::vector<uint32_t> m_lightIndices;
+    LightBinningStats m_stats;
+
+    WorkerPool m_workerPool;
+};
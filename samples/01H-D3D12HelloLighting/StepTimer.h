@@ -0,0 +1,443 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+// Summary of a set of frame times, in milliseconds.
+struct FrameTimeStatistics
+{
+    uint64_t frameCount;
+    double meanMs;
+    double minMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+// Records the duration of each frame.
+// Only the thread that calls Record() and Reset() (the one ticking the StepTimer) writes;
+// any other thread can read the statistics at the same time without taking a lock.
+class FrameTimeRecorder
+{
+public:
+    // Number of recent frames kept for the windowed statistics. Must be a power of two.
+    static const uint32_t RingSize = 1024;
+
+    // The histogram covers 1 us to ~71 minutes with 2^SubBucketBits linear buckets
+    // per power of two, which keeps the relative error of a percentile under 1/32.
+    static const uint32_t SubBucketBits = 5;
+    static const uint32_t SubBucketCount = 1u << SubBucketBits;
+    static const uint32_t BucketCount = (32 - SubBucketBits + 1) * SubBucketCount;
+
+    // Frame times are recorded in the canonical StepTimer format (10,000,000 ticks per second).
+    static const uint64_t TicksPerMicrosecond = 10;
+
+    FrameTimeRecorder() :
+        m_writeIndex(0),
+        m_totalTicks(0),
+        m_minTicks(UINT64_MAX),
+        m_maxTicks(0)
+    {
+        for (auto& slot : m_ring)
+        {
+            slot.store(0, std::memory_order_relaxed);
+        }
+        for (auto& count : m_counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Record(uint64_t ticks)
+    {
+        const uint64_t index = m_writeIndex.load(std::memory_order_relaxed);
+        m_ring[index & (RingSize - 1)].store(ticks, std::memory_order_relaxed);
+
+        // There is a single writer, so plain load/store pairs are enough: no locked instructions.
+        std::atomic<uint32_t>& count = m_counts[GetBucketIndex(ticks / TicksPerMicrosecond)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_totalTicks.store(m_totalTicks.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+        m_minTicks.store((std::min)(m_minTicks.load(std::memory_order_relaxed), ticks), std::memory_order_relaxed);
+        m_maxTicks.store((std::max)(m_maxTicks.load(std::memory_order_relaxed), ticks), std::memory_order_relaxed);
+
+        // Publish the new frame.
+        m_writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    void Reset()
+    {
+        for (auto& count : m_counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        m_totalTicks.store(0, std::memory_order_relaxed);
+        m_minTicks.store(UINT64_MAX, std::memory_order_relaxed);
+        m_maxTicks.store(0, std::memory_order_relaxed);
+        m_writeIndex.store(0, std::memory_order_release);
+    }
+
+    uint64_t GetFrameCount() const { return m_writeIndex.load(std::memory_order_acquire); }
+
+    // Copy the most recent frame times (oldest first), in ticks.
+    void GetRecentFrameTimes(std::vector<uint64_t>& ticks, uint32_t maxFrames = RingSize) const
+    {
+        const uint64_t end = m_writeIndex.load(std::memory_order_acquire);
+        const uint64_t count = (std::min<uint64_t>)((std::min<uint64_t>)(end, maxFrames), RingSize);
+
+        ticks.resize(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            ticks[static_cast<size_t>(i)] = m_ring[(end - count + i) & (RingSize - 1)].load(std::memory_order_relaxed);
+        }
+
+        // Slots the writer may have overwritten while they were copied are dropped.
+        const uint64_t newEnd = m_writeIndex.load(std::memory_order_acquire);
+        const uint64_t overwritten = (std::min<uint64_t>)(count, newEnd - end);
+        ticks.erase(ticks.begin(), ticks.begin() + static_cast<size_t>(overwritten));
+    }
+
+    // Exact statistics of the most recent frames.
+    FrameTimeStatistics GetRecentStatistics(uint32_t maxFrames = RingSize) const
+    {
+        std::vector<uint64_t> ticks;
+        GetRecentFrameTimes(ticks, maxFrames);
+
+        FrameTimeStatistics stats = {};
+        stats.frameCount = ticks.size();
+        if (ticks.empty())
+        {
+            return stats;
+        }
+
+        uint64_t total = 0;
+        for (uint64_t t : ticks)
+        {
+            total += t;
+        }
+        std::sort(ticks.begin(), ticks.end());
+
+        auto percentile = [&ticks](double p)
+        {
+            const size_t rank = static_cast<size_t>(p * (ticks.size() - 1) + 0.5);
+            return TicksToMilliseconds(ticks[rank]);
+        };
+
+        stats.meanMs = TicksToMilliseconds(total) / ticks.size();
+        stats.minMs = TicksToMilliseconds(ticks.front());
+        stats.p50Ms = percentile(0.50);
+        stats.p95Ms = percentile(0.95);
+        stats.p99Ms = percentile(0.99);
+        stats.maxMs = TicksToMilliseconds(ticks.back());
+        return stats;
+    }
+
+    // Statistics of every frame recorded since the last Reset(), from the histogram.
+    FrameTimeStatistics GetHistogramStatistics() const
+    {
+        uint32_t counts[BucketCount];
+        uint64_t frameCount = 0;
+        for (uint32_t i = 0; i < BucketCount; ++i)
+        {
+            counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            frameCount += counts[i];
+        }
+
+        FrameTimeStatistics stats = {};
+        stats.frameCount = frameCount;
+        if (frameCount == 0)
+        {
+            return stats;
+        }
+
+        auto percentile = [&](double p)
+        {
+            const uint64_t rank = (std::max<uint64_t>)(1, static_cast<uint64_t>(p * frameCount + 0.5));
+            uint64_t seen = 0;
+            for (uint32_t i = 0; i < BucketCount; ++i)
+            {
+                seen += counts[i];
+                if (seen >= rank)
+                {
+                    return GetBucketHighestValue(i) / 1000.0;
+                }
+            }
+            return GetBucketHighestValue(BucketCount - 1) / 1000.0;
+        };
+
+        stats.meanMs = TicksToMilliseconds(m_totalTicks.load(std::memory_order_relaxed)) / frameCount;
+        stats.minMs = TicksToMilliseconds(m_minTicks.load(std::memory_order_relaxed));
+        stats.p50Ms = (std::min)(percentile(0.50), TicksToMilliseconds(m_maxTicks.load(std::memory_order_relaxed)));
+        stats.p95Ms = (std::min)(percentile(0.95), TicksToMilliseconds(m_maxTicks.load(std::memory_order_relaxed)));
+        stats.p99Ms = (std::min)(percentile(0.99), TicksToMilliseconds(m_maxTicks.load(std::memory_order_relaxed)));
+        stats.maxMs = TicksToMilliseconds(m_maxTicks.load(std::memory_order_relaxed));
+        return stats;
+    }
+
+    // Histogram layout: values below SubBucketCount microseconds have their own bucket,
+    // every following power of two is split in SubBucketCount buckets of equal width.
+    static uint32_t GetBucketIndex(uint64_t microseconds)
+    {
+        const uint64_t value = (std::min<uint64_t>)(microseconds, UINT32_MAX);
+        if (value < SubBucketCount)
+        {
+            return static_cast<uint32_t>(value);
+        }
+
+        uint32_t exponent = 0;
+        while ((value >> (exponent + 1)) != 0)
+        {
+            ++exponent;
+        }
+
+        const uint32_t shift = exponent - SubBucketBits;
+        return (shift + 1) * SubBucketCount + static_cast<uint32_t>((value >> shift) - SubBucketCount);
+    }
+
+    // Highest value, in microseconds, that falls in the given bucket.
+    static uint64_t GetBucketHighestValue(uint32_t index)
+    {
+        const uint32_t bucket = index / SubBucketCount;
+        const uint32_t subBucket = index % SubBucketCount;
+        if (bucket == 0)
+        {
+            return subBucket;
+        }
+
+        const uint32_t shift = bucket - 1;
+        return ((static_cast<uint64_t>(SubBucketCount + subBucket) + 1) << shift) - 1;
+    }
+
+    static double TicksToMilliseconds(uint64_t ticks) { return static_cast<double>(ticks) / (TicksPerMicrosecond * 1000); }
+
+private:
+    std::atomic<uint64_t> m_ring[RingSize];
+    std::atomic<uint32_t> m_counts[BucketCount];
+    std::atomic<uint64_t> m_writeIndex;
+    std::atomic<uint64_t> m_totalTicks;
+    std::atomic<uint64_t> m_minTicks;
+    std::atomic<uint64_t> m_maxTicks;
+};
+
+// Helper class for animation and simulation timing.
+class StepTimer
+{
+public:
+    // Returns a monotonic time in nanoseconds. Tests can provide their own clock
+    // to drive the timer deterministically.
+    typedef std::function<uint64_t()> ClockFunction;
+
+    explicit StepTimer(ClockFunction clock = ClockFunction()) :
+        m_clock(clock ? clock : ClockFunction(&GetSteadyClockNanoseconds)),
+        m_elapsedTicks(0),
+        m_totalTicks(0),
+        m_leftOverTicks(0),
+        m_frameCount(0),
+        m_framesPerSecond(0),
+        m_framesThisSecond(0),
+        m_secondCounter(0),
+        m_isFixedTimeStep(false),
+        m_targetElapsedTicks(TicksPerSecond / 60),
+        m_maxUpdatesPerTick(5),
+        m_droppedTicks(0)
+    {
+        m_lastTime = m_clock();
+
+        // Initialize max delta to 1/10 of a second.
+        m_maxDelta = NanosecondsPerSecond / 10;
+    }
+
+    // Get elapsed time since the previous Update call.
+    uint64_t GetElapsedTicks() const                    { return m_elapsedTicks; }
+    double GetElapsedSeconds() const                    { return TicksToSeconds(m_elapsedTicks); }
+
+    // Get total time since the start of the program.
+    uint64_t GetTotalTicks() const                      { return m_totalTicks; }
+    double GetTotalSeconds() const                      { return TicksToSeconds(m_totalTicks); }
+
+    // Get total number of updates since start of the program.
+    uint32_t GetFrameCount() const                      { return m_frameCount; }
+
+    // Get the current framerate.
+    uint32_t GetFramesPerSecond() const                 { return m_framesPerSecond; }
+
+    // Get the duration of the recent frames (time between two Tick calls).
+    const FrameTimeRecorder& GetFrameTimes() const      { return m_frameTimes; }
+
+    // Set whether to use fixed or variable timestep mode.
+    void SetFixedTimeStep(bool isFixedTimestep)         { m_isFixedTimeStep = isFixedTimestep; }
+
+    // Set how often to call Update when in fixed timestep mode.
+    void SetTargetElapsedTicks(uint64_t targetElapsed)  { m_targetElapsedTicks = targetElapsed; }
+    void SetTargetElapsedSeconds(double targetElapsed)  { m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
+
+    // Limit the number of catch-up updates a single Tick can run in fixed timestep mode.
+    // If updates are slower than the target elapsed time, the simulation falls behind
+    // instead of spending ever more time catching up (the "spiral of death").
+    void SetMaxUpdatesPerTick(uint32_t maxUpdates)      { m_maxUpdatesPerTick = (std::max)(1u, maxUpdates); }
+
+    // Simulation time discarded because of the catch-up limit.
+    uint64_t GetDroppedTicks() const                    { return m_droppedTicks; }
+
+    // Integer format represents time using 10,000,000 ticks per second.
+    static const uint64_t TicksPerSecond = 10000000;
+    static const uint64_t NanosecondsPerSecond = 1000000000;
+
+    static double TicksToSeconds(uint64_t ticks)        { return static_cast<double>(ticks) / TicksPerSecond; }
+    static uint64_t SecondsToTicks(double seconds)      { return static_cast<uint64_t>(seconds * TicksPerSecond); }
+
+    // After an intentional timing discontinuity (for instance a blocking IO operation)
+    // call this to avoid having the fixed timestep logic attempt a set of catch-up
+    // Update calls.
+
+    void ResetElapsedTime()
+    {
+        m_lastTime = m_clock();
+
+        m_leftOverTicks = 0;
+        m_framesPerSecond = 0;
+        m_framesThisSecond = 0;
+        m_secondCounter = 0;
+    }
+
+    // Update timer state, calling the specified Update function the appropriate number of times.
+    template<typename TUpdate>
+    void Tick(const TUpdate& update)
+    {
+        // Query the current time.
+        const uint64_t currentTime = m_clock();
+
+        uint64_t timeDelta = currentTime - m_lastTime;
+
+        m_lastTime = currentTime;
+        m_secondCounter += timeDelta;
+
+        // Keep the real frame time for the statistics, before any clamping.
+        m_frameTimes.Record(timeDelta / (NanosecondsPerSecond / TicksPerSecond));
+
+        // Clamp excessively large time deltas (e.g. after paused in the debugger).
+        if (timeDelta > m_maxDelta)
+        {
+            timeDelta = m_maxDelta;
+        }
+
+        // Convert from nanoseconds to the canonical tick format. This cannot overflow due to the previous clamp.
+        timeDelta /= NanosecondsPerSecond / TicksPerSecond;
+
+        uint32_t lastFrameCount = m_frameCount;
+
+        if (m_isFixedTimeStep)
+        {
+            // Fixed timestep update logic
+
+            // If the app is running very close to the target elapsed time (within 1/4 of a millisecond) just clamp
+            // the clock to exactly match the target value. This prevents tiny and irrelevant errors
+            // from accumulating over time. Without this clamping, a game that requested a 60 fps
+            // fixed update, running with vsync enabled on a 59.94 NTSC display, would eventually
+            // accumulate enough tiny errors that it would drop a frame. It is better to just round
+            // small deviations down to zero to leave things running smoothly.
+
+            if (std::llabs(static_cast<long long>(timeDelta - m_targetElapsedTicks)) < static_cast<long long>(TicksPerSecond / 4000))
+            {
+                timeDelta = m_targetElapsedTicks;
+            }
+
+            m_leftOverTicks += timeDelta;
+
+            uint32_t updates = 0;
+            while (m_leftOverTicks >= m_targetElapsedTicks && updates < m_maxUpdatesPerTick)
+            {
+                m_elapsedTicks = m_targetElapsedTicks;
+                m_totalTicks += m_targetElapsedTicks;
+                m_leftOverTicks -= m_targetElapsedTicks;
+                m_frameCount++;
+                updates++;
+
+                update();
+            }
+
+            // Give up on the time we could not catch up with, but keep the fraction of a step.
+            if (m_leftOverTicks >= m_targetElapsedTicks)
+            {
+                const uint64_t remainder = m_leftOverTicks % m_targetElapsedTicks;
+                m_droppedTicks += m_leftOverTicks - remainder;
+                m_leftOverTicks = remainder;
+            }
+        }
+        else
+        {
+            // Variable timestep update logic.
+            m_elapsedTicks = timeDelta;
+            m_totalTicks += timeDelta;
+            m_leftOverTicks = 0;
+            m_frameCount++;
+
+            update();
+        }
+
+        // Track the current framerate.
+        if (m_frameCount != lastFrameCount)
+        {
+            m_framesThisSecond++;
+        }
+
+        if (m_secondCounter >= NanosecondsPerSecond)
+        {
+            m_framesPerSecond = m_framesThisSecond;
+            m_framesThisSecond = 0;
+            m_secondCounter %= NanosecondsPerSecond;
+        }
+    }
+
+    void Tick()
+    {
+        Tick([] {});
+    }
+
+private:
+    // Uses QueryPerformanceCounter on Windows and clock_gettime(CLOCK_MONOTONIC) on Linux.
+    static uint64_t GetSteadyClockNanoseconds()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Source timing data, in nanoseconds.
+    ClockFunction m_clock;
+    uint64_t m_lastTime;
+    uint64_t m_maxDelta;
+
+    // Derived timing data uses a canonical tick format.
+    uint64_t m_elapsedTicks;
+    uint64_t m_totalTicks;
+    uint64_t m_leftOverTicks;
+
+    // Members for tracking the framerate.
+    uint32_t m_frameCount;
+    uint32_t m_framesPerSecond;
+    uint32_t m_framesThisSecond;
+    uint64_t m_secondCounter;
+    FrameTimeRecorder m_frameTimes;
+
+    // Members for configuring fixed timestep mode.
+    bool m_isFixedTimeStep;
+    uint64_t m_targetElapsedTicks;
+    uint32_t m_maxUpdatesPerTick;
+    uint64_t m_droppedTicks;
+};
@@ -0,0 +1,170 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "LightBinner.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    ClusterGridDesc GetGrid()
+    {
+        const float fieldOfView = 0.785398f;
+
+        ClusterGridDesc grid;
+        grid.width = 1920;
+        grid.height = 1080;
+        grid.tileSize = 64;
+        grid.sliceCount = 24;
+        grid.nearZ = 1.0f;
+        grid.farZ = 100.0f;
+        grid.projectionScaleY = 1.0f / std::tan(fieldOfView / 2.0f);
+        grid.projectionScaleX = grid.projectionScaleY * 1080.0f / 1920.0f;
+        return grid;
+    }
+
+    // Point lights in front of the camera, a quarter of them turned into spot lights.
+    std::vector<LightBounds> GetLights(uint32_t count, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<LightBounds> lights(count);
+        for (auto& light : lights)
+        {
+            const float z = 2.0f + 58.0f * unit(random);
+            const float position[3] = { (unit(random) * 2.0f - 1.0f) * z * 0.8f, (unit(random) * 2.0f - 1.0f) * z * 0.5f, z };
+            const float range = 0.5f + unit(random);
+            if (unit(random) < 0.25f)
+            {
+                float direction[3] = { unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f };
+                const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+                for (float& d : direction)
+                {
+                    d /= length;
+                }
+                light = GetSpotLightBounds(position, direction, range * 2.0f, std::cos(0.2f + 1.3f * unit(random)));
+            }
+            else
+            {
+                light = GetPointLightBounds(position, range);
+            }
+        }
+        return lights;
+    }
+
+    void TestBinBeforeSetGrid()
+    {
+        LightBinner binner(1);
+        const LightBounds light = { { 0.0f, 0.0f, 5.0f }, 1.0f };
+        CHECK_THROWS(binner.Bin(&light, 1));
+    }
+
+    // Every point of the view frustum lit by a light is in a cluster whose list holds the
+    // light, and the lists are sorted.
+    void TestCoverage()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        const ClusterGridDesc grid = GetGrid();
+        const std::vector<LightBounds> lights = GetLights(2000, random);
+        const uint32_t lightCount = static_cast<uint32_t>(lights.size());
+
+        LightBinner binner(4);
+        binner.SetGrid(grid);
+        CHECK(binner.GetTileCountX() == 30 && binner.GetTileCountY() == 17);
+        binner.Bin(lights.data(), lightCount);
+
+        const std::vector<uint32_t>& ranges = binner.GetClusterRanges();
+        const std::vector<uint32_t>& indices = binner.GetLightIndices();
+        CHECK(ranges.size() == 2 * binner.GetClusterCount());
+        CHECK(binner.GetStats().indexCount == indices.size());
+        CHECK(binner.GetStats().visibleLightCount > 0 && binner.GetStats().visibleLightCount <= lightCount);
+
+        uint32_t maxClusterLightCount = 0;
+        for (uint32_t cluster = 0; cluster < binner.GetClusterCount(); ++cluster)
+        {
+            const auto first = indices.begin() + ranges[2 * cluster];
+            CHECK(ranges[2 * cluster] + ranges[2 * cluster + 1] <= indices.size());
+            CHECK(std::is_sorted(first, first + ranges[2 * cluster + 1]));
+            maxClusterLightCount = (std::max)(maxClusterLightCount, ranges[2 * cluster + 1]);
+        }
+        CHECK(binner.GetStats().maxClusterLightCount == maxClusterLightCount);
+
+        uint32_t litPointCount = 0;
+        for (uint32_t i = 0; i < 20000; ++i)
+        {
+            const float pixelX = unit(random) * grid.width;
+            const float pixelY = unit(random) * grid.height;
+            const float z = (i % 10 == 0) ? 0.02f + unit(random) : 0.02f + 99.9f * unit(random);
+            const float x = (pixelX / grid.width * 2.0f - 1.0f) * z / grid.projectionScaleX;
+            const float y = (1.0f - pixelY / grid.height * 2.0f) * z / grid.projectionScaleY;
+
+            const int slice = static_cast<int>(std::floor(std::log(z) * binner.GetSliceScale() + binner.GetSliceBias()));
+            const uint32_t clampedSlice = static_cast<uint32_t>((std::max)(0, (std::min)(slice, static_cast<int>(grid.sliceCount) - 1)));
+            const uint32_t tileX = static_cast<uint32_t>(pixelX) / grid.tileSize;
+            const uint32_t tileY = static_cast<uint32_t>(pixelY) / grid.tileSize;
+            const uint32_t cluster = (clampedSlice * binner.GetTileCountY() + tileY) * binner.GetTileCountX() + tileX;
+            const auto first = indices.begin() + ranges[2 * cluster];
+            const auto last = first + ranges[2 * cluster + 1];
+
+            for (uint32_t l = 0; l < lightCount; ++l)
+            {
+                const LightBounds& light = lights[l];
+                const float dx = x - light.center[0];
+                const float dy = y - light.center[1];
+                const float dz = z - light.center[2];
+                if (dx * dx + dy * dy + dz * dz <= light.radius * light.radius)
+                {
+                    ++litPointCount;
+                    CHECK(std::binary_search(first, last, l));
+                }
+            }
+        }
+        CHECK(litPointCount > 1000);
+    }
+
+    // The lists don't depend on the number of threads, nor on the previous calls.
+    void TestThreadCounts()
+    {
+        std::mt19937 random(2);
+        const std::vector<LightBounds> lights = GetLights(500, random);
+        const std::vector<LightBounds> otherLights = GetLights(3000, random);
+
+        LightBinner reference(1);
+        reference.SetGrid(GetGrid());
+        reference.Bin(lights.data(), static_cast<uint32_t>(lights.size()));
+
+        LightBinner binner(8);
+        CHECK(binner.GetStats().threadCount == 8);
+        binner.SetGrid(GetGrid());
+        binner.Bin(otherLights.data(), static_cast<uint32_t>(otherLights.size()));
+        binner.Bin(lights.data(), static_cast<uint32_t>(lights.size()));
+
+        CHECK(binner.GetClusterRanges() == reference.GetClusterRanges());
+        CHECK(binner.GetLightIndices() == reference.GetLightIndices());
+
+        binner.Bin(nullptr, 0);
+        CHECK(binner.GetLightIndices().empty() && binner.GetStats().maxClusterLightCount == 0);
+    }
+}
+
+int main()
+{
+    TestBinBeforeSetGrid();
+    TestCoverage();
+    TestThreadCounts();
+    return 0;
+}
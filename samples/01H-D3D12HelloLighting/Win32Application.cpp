@@ -52,7 +52,12 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
     // Initialize the sample. OnInit is defined in each child-implementation of DXSample.
     pSample->OnInit();
 
-    ShowWindow(m_hwnd, nCmdShow);
+    // A headless benchmark keeps the window hidden; the swap chain still needs it.
+    Benchmark& benchmark = pSample->GetBenchmark();
+    if (!benchmark.GetSettings().headless)
+    {
+        ShowWindow(m_hwnd, nCmdShow);
+    }
 
     // Main sample loop.
     MSG msg = {};
@@ -64,10 +69,24 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
+        else if (benchmark.IsEnabled() && !benchmark.IsFinished())
+        {
+            // Benchmark frames are rendered back to back rather than on WM_PAINT.
+            RenderBenchmarkFrame(pSample);
+            if (benchmark.IsFinished())
+            {
+                DestroyWindow(m_hwnd);
+            }
+        }
     }
 
     pSample->OnDestroy();
 
+    if (benchmark.IsEnabled())
+    {
+        pSample->WriteBenchmarkReport();
+    }
+
     // Return this part of the WM_QUIT message to Windows.
     return static_cast<char>(msg.wParam);
 }
@@ -87,27 +106,30 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
         }
         return 0;
 
+    // The benchmark mode ignores the input and renders from the main loop, so that
+    // every run draws the same frames.
     case WM_KEYDOWN:
-        if (pSample)
+        if (pSample && !pSample->GetBenchmark().IsEnabled())
         {
             pSample->OnKeyDown(static_cast<UINT8>(wParam));
         }
         return 0;
 
     case WM_KEYUP:
-        if (pSample)
+        if (pSample && !pSample->GetBenchmark().IsEnabled())
         {
             pSample->OnKeyUp(static_cast<UINT8>(wParam));
         }
         return 0;
 
     case WM_PAINT:
-        if (pSample)
+        if (pSample && !pSample->GetBenchmark().IsEnabled())
         {
             pSample->OnUpdate();
             pSample->OnRender();
+            return 0;
         }
-        return 0;
+        break;
 
     case WM_DESTROY:
         PostQuitMessage(0);
@@ -117,3 +139,19 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
     // Handle any messages the switch statement didn't.
     return DefWindowProc(hWnd, message, wParam, lParam);
 }
+
+// Render one frame of the benchmark, timing the update and the render separately.
+void Win32Application::RenderBenchmarkFrame(DXSample* pSample)
+{
+    Benchmark& benchmark = pSample->GetBenchmark();
+    benchmark.BeginFrame();
+    {
+        BENCHMARK_PHASE(benchmark, "OnUpdate");
+        pSample->OnUpdate();
+    }
+    {
+        BENCHMARK_PHASE(benchmark, "OnRender");
+        pSample->OnRender();
+    }
+    benchmark.EndFrame();
+}
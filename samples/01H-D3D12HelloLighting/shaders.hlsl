@@ -17,8 +17,28 @@ cbuffer Constants : register( b0 )
 	float4   lightDir[ 2 ];
 	float4   lightColor[ 2 ];
 	float4   outputColor;
+	uint4    clusterGrid;     // Tile size in pixels, tile columns, tile rows, depth slices
+	float4   clusterDepth;    // Slice = log( view depth ) * x + y
 };
 
+
+//--------------------------------------------------------------------------------------
+// Clustered point and spot lights
+//--------------------------------------------------------------------------------------
+struct ClusteredLight
+{
+    float3 position;
+    float  range;
+    float3 color;
+    float  spotCosOuter;    // -2 for point lights
+    float3 direction;
+    float  spotCosInner;    // -1 for point lights
+};
+
+StructuredBuffer<ClusteredLight> clusteredLights : register( t0 );
+StructuredBuffer<uint2> clusterRanges : register( t1 );     // First index and light count of each cluster
+StructuredBuffer<uint> lightIndices : register( t2 );
+
  
 //--------------------------------------------------------------------------------------
 struct VS_INPUT
@@ -31,6 +51,8 @@ struct PS_INPUT
 {
     float4 Pos : SV_POSITION;
 	float3 Normal : NORMAL;
+	float3 WorldPos : TEXCOORD0;
+	float  ViewDepth : TEXCOORD1;
 };
 
 
@@ -42,7 +64,9 @@ PS_INPUT TriangleVS( VS_INPUT input )
 {
     PS_INPUT output = ( PS_INPUT )0;
     output.Pos = mul( input.Pos, mWorld );
+    output.WorldPos = output.Pos.xyz;
     output.Pos = mul( output.Pos, mView );
+    output.ViewDepth = output.Pos.z;
     output.Pos = mul( output.Pos, mProjection );
     output.Normal = mul( input.Normal, ( ( float3x3 ) mWorld ) );
     
@@ -52,7 +76,8 @@ PS_INPUT TriangleVS( VS_INPUT input )
 
 //--------------------------------------------------------------------------------------
 // Name: LambertPS
-// Desc: Pixel shader applying Lambertian lighting from two lights
+// Desc: Pixel shader applying Lambertian lighting from two directional lights and
+//       from the point and spot lights of the pixel's cluster
 //--------------------------------------------------------------------------------------
 float4 LambertPS( PS_INPUT input ) : SV_Target
 {
@@ -63,6 +88,27 @@ float4 LambertPS( PS_INPUT input ) : SV_Target
     {
         finalColor += saturate( dot( ( float3 ) lightDir[ i ], input.Normal ) * lightColor[ i ] );
     }
+
+    // Find the cluster of the pixel: its screen tile and its logarithmic depth slice
+    uint2 tile = uint2( input.Pos.xy ) / clusterGrid.x;
+    float slice = clamp( floor( log( input.ViewDepth ) * clusterDepth.x + clusterDepth.y ), 0.0, ( float )( clusterGrid.w - 1 ) );
+    uint2 range = clusterRanges[ ( ( uint )slice * clusterGrid.z + tile.y ) * clusterGrid.y + tile.x ];
+
+    // The lights fade out quadratically up to their range, and spot lights across the
+    // edge of their cone
+    for( uint j = 0; j < range.y; j++ )
+    {
+        ClusteredLight light = clusteredLights[ lightIndices[ range.x + j ] ];
+        float3 toLight = light.position - input.WorldPos;
+        float lightDistance = length( toLight );
+        float3 L = toLight / max( lightDistance, 1e-4 );
+
+        float attenuation = saturate( 1 - lightDistance / light.range );
+        attenuation *= attenuation;
+        attenuation *= smoothstep( light.spotCosOuter, light.spotCosInner, dot( -L, light.direction ) );
+
+        finalColor.rgb += saturate( dot( L, input.Normal ) ) * light.color * attenuation;
+    }
     finalColor.a = 1;
     return finalColor;
 }
@@ -11,18 +11,21 @@
 
 #include "stdafx.h"
 #include "D3D12Blending.h"
+#include "TransientResources.h"
 
 
 D3D12Blending::D3D12Blending(UINT width, UINT height, std::wstring name) :
     DXSample(width, height, name),
     m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
     m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+    m_commandList(m_renderStats),
     m_constantDataGpuAddr(0),
     m_mappedConstantData(nullptr),
     m_rtvDescriptorSize(0),
     m_frameIndex(0),
     m_fenceValues{},
-    m_curRotationAngleRad(0.0f)
+    m_curRotationAngleRad(0.0f),
+    m_numDrawCalls(0)
 {
     // Initialize the world matrix
     m_worldMatrix = XMMatrixIdentity();
@@ -44,6 +47,9 @@ void D3D12Blending::OnInit()
 {
     LoadPipeline();
     LoadAssets();
+    UpdateWindowText();
+
+    m_benchmark.SetRenderStats(&m_renderStats);
 }
 
 // Load the rendering pipeline dependencies.
@@ -128,8 +134,9 @@ void D3D12Blending::LoadPipeline()
     // Create descriptor heaps.
     {
         // Describe and create a render target view (RTV) descriptor heap.
+        // The back buffers are followed by the two OIT targets.
         D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-        rtvHeapDesc.NumDescriptors = FrameCount;
+        rtvHeapDesc.NumDescriptors = FrameCount + 2;
         rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
         rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
         ThrowIfFailed(m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
@@ -141,6 +148,13 @@ void D3D12Blending::LoadPipeline()
         dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
         ThrowIfFailed(m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
 
+        // Describe and create a shader resource view (SRV) heap for the OIT targets.
+        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
+        srvHeapDesc.NumDescriptors = 2;
+        srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+        ThrowIfFailed(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvHeap)));
+
         m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     }
 
@@ -177,6 +191,69 @@ void D3D12Blending::LoadPipeline()
 
         m_device->CreateDepthStencilView(m_depthStencil.Get(), &depthStencilDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
     }
+
+    // Create the targets of the weighted blended OIT: the accumulation of the weighted,
+    // premultiplied colors and of the weights, and the revealage (the product of 1 - alpha).
+    {
+        const float clearAccumulation[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const float clearRevealage[] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        const DXGI_FORMAT formats[] = { c_oitAccumulationFormat, c_oitRevealageFormat };
+        const float* clearColors[] = { clearAccumulation, clearRevealage };
+        ComPtr<ID3D12Resource>* targets[] = { &m_oitAccumulation, &m_oitRevealage };
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), FrameCount, m_rtvDescriptorSize);
+        CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(m_srvHeap->GetCPUDescriptorHandleForHeapStart());
+        const UINT srvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        for (UINT i = 0; i < _countof(targets); ++i)
+        {
+            ThrowIfFailed(m_device->CreateCommittedResource(
+                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+                D3D12_HEAP_FLAG_NONE,
+                &CD3DX12_RESOURCE_DESC::Tex2D(formats[i], m_width, m_height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET),
+                D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                &CD3DX12_CLEAR_VALUE(formats[i], clearColors[i]),
+                IID_PPV_ARGS(targets[i]->ReleaseAndGetAddressOf())
+            ));
+
+            m_device->CreateRenderTargetView(targets[i]->Get(), nullptr, rtvHandle);
+            rtvHandle.Offset(1, m_rtvDescriptorSize);
+
+            m_device->CreateShaderResourceView(targets[i]->Get(), nullptr, srvHandle);
+            srvHandle.Offset(1, srvDescriptorSize);
+        }
+    }
+
+    // Report the memory that placing the depth buffer and the OIT targets in an aliased
+    // heap would save. All three are live during the transparent pass, so in this frame
+    // the heap would be as large as the committed resources, and they stay committed.
+    {
+        enum { OpaquePass, TransparentPass, CompositePass, PassCount };
+
+        TransientResourcePlanner planner;
+        for (UINT pass = 0; pass < PassCount; ++pass)
+        {
+            planner.AddPass();
+        }
+
+        ID3D12Resource* transients[] = { m_depthStencil.Get(), m_oitAccumulation.Get(), m_oitRevealage.Get() };
+        UINT resources[_countof(transients)] = {};
+        for (UINT i = 0; i < _countof(transients); ++i)
+        {
+            const D3D12_RESOURCE_DESC desc = transients[i]->GetDesc();
+            const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &desc);
+            resources[i] = planner.AddResource(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+        }
+
+        planner.UseResource(OpaquePass, resources[0]);
+        planner.UseResource(TransparentPass, resources[0]);
+        planner.UseResource(TransparentPass, resources[1]);
+        planner.UseResource(TransparentPass, resources[2]);
+        planner.UseResource(CompositePass, resources[1]);
+        planner.UseResource(CompositePass, resources[2]);
+
+        planner.Plan();
+        OutputDebugStringA(planner.FormatStats().c_str());
+    }
 }
 
 // Load the sample assets.
@@ -192,10 +269,15 @@ void D3D12Blending::LoadAssets()
         featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
     }
 
-    // Create a root signature with one constant buffer view.
+    // Create a root signature with one constant buffer view, and a table with the
+    // SRVs of the OIT targets for the composite pass.
     {
-        CD3DX12_ROOT_PARAMETER1 rp[1] = {};
+        CD3DX12_DESCRIPTOR_RANGE1 ranges[1] = {};
+        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+        CD3DX12_ROOT_PARAMETER1 rp[2] = {};
         rp[0].InitAsConstantBufferView(0, 0);
+        rp[1].InitAsDescriptorTable(_countof(ranges), ranges, D3D12_SHADER_VISIBILITY_PIXEL);
 
         // Allow input layout and deny uneccessary access to certain pipeline stages.
         D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
@@ -216,7 +298,8 @@ void D3D12Blending::LoadAssets()
     // Create the constant buffer memory and map the resource
     {
         const D3D12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        size_t cbSize = c_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
+        m_numDrawCalls = 1 + 2 * m_sceneScale;
+        size_t cbSize = m_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
 
         const D3D12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(cbSize);
         ThrowIfFailed(m_device->CreateCommittedResource(
@@ -238,6 +321,9 @@ void D3D12Blending::LoadAssets()
         ComPtr<ID3DBlob> vertexShader;
         ComPtr<ID3DBlob> pixelShader;
         ComPtr<ID3DBlob> solidColorPS;
+        ComPtr<ID3DBlob> weightedBlendPS;
+        ComPtr<ID3DBlob> compositeVS;
+        ComPtr<ID3DBlob> compositePS;
 
 #if defined(_DEBUG)
         // Enable better shader debugging with the graphics debugging tools.
@@ -249,6 +335,9 @@ void D3D12Blending::LoadAssets()
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "SolidColorPS", "ps_5_0", compileFlags, 0, &solidColorPS, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "WeightedBlendPS", "ps_5_0", compileFlags, 0, &weightedBlendPS, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "CompositeVS", "vs_5_0", compileFlags, 0, &compositeVS, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "CompositePS", "ps_5_0", compileFlags, 0, &compositePS, nullptr));
 
         // Define the vertex input layout.
         D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
@@ -301,10 +390,77 @@ void D3D12Blending::LoadAssets()
             psoDesc.SampleDesc.Count = 1;
             ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_blendingPipelineState)));
         }
+
+        // Create the Pipeline State Object for accumulating transparent objects into the OIT targets
+        {
+            // The weighted colors and weights add up, and the revealage is multiplied by 1 - alpha.
+            CD3DX12_BLEND_DESC blendDesc(D3D12_DEFAULT);
+            blendDesc.IndependentBlendEnable = TRUE;
+            blendDesc.RenderTarget[0].BlendEnable = TRUE;
+            blendDesc.RenderTarget[0].SrcBlend = D3D12_BLEND_ONE;
+            blendDesc.RenderTarget[0].DestBlend = D3D12_BLEND_ONE;
+            blendDesc.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ONE;
+            blendDesc.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_ONE;
+            blendDesc.RenderTarget[1].BlendEnable = TRUE;
+            blendDesc.RenderTarget[1].SrcBlend = D3D12_BLEND_ZERO;
+            blendDesc.RenderTarget[1].DestBlend = D3D12_BLEND_INV_SRC_COLOR;
+            blendDesc.RenderTarget[1].SrcBlendAlpha = D3D12_BLEND_ZERO;
+            blendDesc.RenderTarget[1].DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+
+            // Transparent objects are hidden by the opaque ones, but not by each other.
+            CD3DX12_DEPTH_STENCIL_DESC depthStencilDesc(D3D12_DEFAULT);
+            depthStencilDesc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+            psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+            psoDesc.pRootSignature = m_rootSignature.Get();
+            psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
+            psoDesc.PS = CD3DX12_SHADER_BYTECODE(weightedBlendPS.Get());
+            psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            psoDesc.BlendState = blendDesc;
+            psoDesc.DepthStencilState = depthStencilDesc;
+            psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+            psoDesc.SampleMask = UINT_MAX;
+            psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            psoDesc.NumRenderTargets = 2;
+            psoDesc.RTVFormats[0] = c_oitAccumulationFormat;
+            psoDesc.RTVFormats[1] = c_oitRevealageFormat;
+            psoDesc.SampleDesc.Count = 1;
+            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_oitAccumulationPipelineState)));
+        }
+
+        // Create the Pipeline State Object for compositing the OIT targets over the back buffer
+        {
+            // The average color covers 1 - revealage of the opaque objects.
+            CD3DX12_BLEND_DESC blendDesc(D3D12_DEFAULT);
+            blendDesc.RenderTarget[0].BlendEnable = TRUE;
+            blendDesc.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+            blendDesc.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+
+            CD3DX12_DEPTH_STENCIL_DESC depthStencilDesc(D3D12_DEFAULT);
+            depthStencilDesc.DepthEnable = FALSE;
+            depthStencilDesc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+
+            // A full-screen triangle generated from the vertex IDs, without input layout.
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+            psoDesc.pRootSignature = m_rootSignature.Get();
+            psoDesc.VS = CD3DX12_SHADER_BYTECODE(compositeVS.Get());
+            psoDesc.PS = CD3DX12_SHADER_BYTECODE(compositePS.Get());
+            psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            psoDesc.BlendState = blendDesc;
+            psoDesc.DepthStencilState = depthStencilDesc;
+            psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+            psoDesc.SampleMask = UINT_MAX;
+            psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            psoDesc.NumRenderTargets = 1;
+            psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+            psoDesc.SampleDesc.Count = 1;
+            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_oitCompositePipelineState)));
+        }
     }
 
     // Create the command list.
-    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
 
     // Command lists are created in the recording state, but there is nothing
     // to record yet. The main loop expects it to be closed, so close it now.
@@ -408,6 +564,21 @@ void D3D12Blending::LoadAssets()
         m_indexBufferView.SizeInBytes = indexBufferSize;
     }
 
+    // Place the transparent quads. They alternate left and right, and fill the same depth
+    // range whatever their number.
+    {
+        const UINT quadCount = 2 * m_sceneScale;
+        m_quadWorldMatrices.resize(quadCount);
+        for (UINT m = 0; m < quadCount; ++m)
+        {
+            XMMATRIX scaleMatrix = XMMatrixScaling(2.0f, 2.0f, 2.0f);
+            XMMATRIX rotationMatrix = XMMatrixRotationX(-XM_PIDIV2);
+            const float depth = 2.0f * m / (quadCount - 1);
+            XMMATRIX translateMatrix = XMMatrixTranslation((-1.0f + ((m % 2) * 2)), 1.0f, (-3.0f - depth));
+            XMStoreFloat4x4(&m_quadWorldMatrices[m], rotationMatrix * (scaleMatrix * translateMatrix));
+        }
+    }
+
     // Create synchronization objects and wait until assets have been uploaded to the GPU.
     {
         ThrowIfFailed(m_device->CreateFence(m_fenceValues[m_frameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
@@ -430,10 +601,13 @@ void D3D12Blending::LoadAssets()
 // Update frame-based values.
 void D3D12Blending::OnUpdate()
 {
-    const float rotationSpeed = 0.015f;
+    // Radians per second.
+    const float rotationSpeed = 0.9f;
+
+    m_timer.Tick();
 
     // Update the rotation constant
-    m_curRotationAngleRad += rotationSpeed;
+    m_curRotationAngleRad += rotationSpeed * static_cast<float>(m_timer.GetElapsedSeconds());
     if (m_curRotationAngleRad >= XM_2PI)
     {
         m_curRotationAngleRad -= XM_2PI;
@@ -441,22 +615,51 @@ void D3D12Blending::OnUpdate()
 
     // Rotate the cube around the Y-axis
     m_worldMatrix = XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixRotationY(m_curRotationAngleRad);
+
+    // Sorted blending draws the quads from back to front. They are sorted by the depth
+    // of the origin of their world matrices: the quads all have the same orientation,
+    // so it is at the same distance from the center of each of them.
+    if (m_transparencyMode == TransparencyMode::SortedBlending)
+    {
+        BENCHMARK_PHASE(m_benchmark, "SortTransparentQuads");
+        XMFLOAT4X4 viewMatrix;
+        XMStoreFloat4x4(&viewMatrix, m_viewMatrix);
+        m_depthSorter.Sort(&m_quadWorldMatrices[0]._41, sizeof(XMFLOAT4X4), static_cast<uint32_t>(m_quadWorldMatrices.size()), &viewMatrix.m[0][0], DepthOrder::BackToFront);
+    }
 }
 
 // Render the scene.
 void D3D12Blending::OnRender()
 {
     // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList();
+    {
+        BENCHMARK_PHASE(m_benchmark, "PopulateCommandList");
+        PopulateCommandList();
+    }
 
     // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    {
+        BENCHMARK_PHASE(m_benchmark, "ExecuteCommandLists");
+        ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+        m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    }
 
     // Present the frame.
-    ThrowIfFailed(m_swapChain->Present(1, 0));
+    {
+        BENCHMARK_PHASE(m_benchmark, "Present");
+        ThrowIfFailed(m_swapChain->Present(m_syncInterval, 0));
+    }
 
-    MoveToNextFrame();
+    {
+        BENCHMARK_PHASE(m_benchmark, "MoveToNextFrame");
+        MoveToNextFrame();
+    }
+
+    // Close the counters of this frame and periodically print a summary.
+    if (m_renderStats.EndFrame() % c_renderStatsDumpInterval == 0)
+    {
+        OutputDebugStringA(m_renderStats.FormatSummary(c_renderStatsDumpInterval).c_str());
+    }
 }
 
 void D3D12Blending::OnDestroy()
@@ -468,6 +671,23 @@ void D3D12Blending::OnDestroy()
     CloseHandle(m_fenceEvent);
 }
 
+void D3D12Blending::OnKeyDown(UINT8 key)
+{
+    // Switch between sorted alpha blending and weighted blended OIT.
+    if (key == 'O')
+    {
+        m_transparencyMode = (m_transparencyMode == TransparencyMode::WeightedBlended) ?
+            TransparencyMode::SortedBlending : TransparencyMode::WeightedBlended;
+        UpdateWindowText();
+    }
+}
+
+void D3D12Blending::UpdateWindowText()
+{
+    SetCustomWindowText((m_transparencyMode == TransparencyMode::WeightedBlended) ?
+        L"weighted blended OIT (O to switch)" : L"sorted blending (O to switch)");
+}
+
 void D3D12Blending::PopulateCommandList()
 {
     // Command list allocators can only be reset when the associated 
@@ -488,7 +708,7 @@ void D3D12Blending::PopulateCommandList()
     // Index into the available constant buffers based on the number
     // of draw calls. We've allocated enough for a known number of
     // draw calls per frame times the number of back buffers
-    unsigned int constantBufferIndex = c_numDrawCalls * (m_frameIndex % FrameCount);
+    unsigned int constantBufferIndex = m_numDrawCalls * (m_frameIndex % FrameCount);
 
     // Set the per-frame constants
     ConstantBuffer cbParameters = {};
@@ -499,7 +719,7 @@ void D3D12Blending::PopulateCommandList()
     XMStoreFloat4x4(&cbParameters.projectionMatrix, XMMatrixTranspose(m_projectionMatrix));
 
     // Set the constants for the first draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
     // Bind the constants to the shader
     auto baseGpuAddress = m_constantDataGpuAddr + sizeof(PaddedConstantBuffer) * constantBufferIndex;
@@ -527,24 +747,45 @@ void D3D12Blending::PopulateCommandList()
     baseGpuAddress += sizeof(PaddedConstantBuffer);
     ++constantBufferIndex;
 
-    // Draw the quads
-    m_commandList->SetPipelineState(m_blendingPipelineState.Get());
+    // Draw the quads, either blended over the back buffer from back to front, or
+    // accumulated into the OIT targets in any order.
+    const bool weightedBlended = (m_transparencyMode == TransparencyMode::WeightedBlended);
+    if (weightedBlended)
+    {
+        D3D12_RESOURCE_BARRIER barriers[] =
+        {
+            CD3DX12_RESOURCE_BARRIER::Transition(m_oitAccumulation.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
+            CD3DX12_RESOURCE_BARRIER::Transition(m_oitRevealage.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET)
+        };
+        m_commandList->ResourceBarrier(_countof(barriers), barriers);
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE oitRtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), FrameCount, m_rtvDescriptorSize);
+        const float clearAccumulation[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const float clearRevealage[] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        m_commandList->ClearRenderTargetView(oitRtvHandle, clearAccumulation, 0, nullptr);
+        m_commandList->ClearRenderTargetView(CD3DX12_CPU_DESCRIPTOR_HANDLE(oitRtvHandle, 1, m_rtvDescriptorSize), clearRevealage, 0, nullptr);
 
-    for (int m = 0; m < 2; ++m)
+        // The two RTVs are contiguous in the heap.
+        m_commandList->OMSetRenderTargets(2, &oitRtvHandle, TRUE, &dsvHandle);
+        m_commandList->SetPipelineState(m_oitAccumulationPipelineState.Get());
+    }
+    else
     {
-        // Compute the World matrix of the quads
-        XMMATRIX scaleMatrix = XMMatrixScaling(2.0f, 2.0f, 2.0f);
-        XMMATRIX rotationMatrix = XMMatrixRotationX(-XM_PIDIV2);
-        // Translation to order quads in decreasing order from the camera. 
-        // Set OffsetZ = (-5.0f + (m * 2)) to draw quads in reverse order.
-        XMMATRIX translateMatrix = XMMatrixTranslation((-1.0f + (m * 2)), 1.0f, (-3.0f - (m * 2)));
+        m_commandList->SetPipelineState(m_blendingPipelineState.Get());
+    }
+
+    const uint32_t* pDrawOrder = weightedBlended ? nullptr : m_depthSorter.GetDrawOrder();
+    const UINT quadCount = static_cast<UINT>(m_quadWorldMatrices.size());
+    for (UINT i = 0; i < quadCount; ++i)
+    {
+        const UINT m = pDrawOrder ? pDrawOrder[i] : i;
 
         // Update world matrix and output color.
-        XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(rotationMatrix * (scaleMatrix * translateMatrix)));
-        cbParameters.outputColor = (m == 0) ? XMFLOAT4(1.0f, 0.0f, 0.0f, 0.4f) : XMFLOAT4(1.0f, 1.0f, 1.0f, 0.3f);
+        XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(XMLoadFloat4x4(&m_quadWorldMatrices[m])));
+        cbParameters.outputColor = (m % 2 == 0) ? XMFLOAT4(1.0f, 0.0f, 0.0f, 0.4f) : XMFLOAT4(1.0f, 1.0f, 1.0f, 0.3f);
 
         // Set the constants for the draw call
-        memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+        m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
         // Bind the constants to the shader
         m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
@@ -555,12 +796,37 @@ void D3D12Blending::PopulateCommandList()
         ++constantBufferIndex;
     }
 
+    if (weightedBlended)
+    {
+        CompositeWeightedBlendedTransparency(rtvHandle);
+    }
+
     // Indicate that the back buffer will now be used to present.
     m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 
     ThrowIfFailed(m_commandList->Close());
 }
 
+// Resolve the OIT targets over the back buffer with a full-screen triangle.
+void D3D12Blending::CompositeWeightedBlendedTransparency(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle)
+{
+    D3D12_RESOURCE_BARRIER barriers[] =
+    {
+        CD3DX12_RESOURCE_BARRIER::Transition(m_oitAccumulation.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_oitRevealage.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+    };
+    m_commandList->ResourceBarrier(_countof(barriers), barriers);
+
+    m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+    m_commandList->SetPipelineState(m_oitCompositePipelineState.Get());
+
+    ID3D12DescriptorHeap* ppHeaps[] = { m_srvHeap.Get() };
+    m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+    m_commandList->SetGraphicsRootDescriptorTable(1, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
+
+    m_commandList->DrawInstanced(3, 1, 0, 0);
+}
+
 // Wait for pending GPU work to complete.
 void D3D12Blending::WaitForGpu()
 {
@@ -569,7 +835,7 @@ void D3D12Blending::WaitForGpu()
 
     // Wait until the fence has been processed.
     ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-    WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
 
     // Increment the fence value for the current frame.
     m_fenceValues[m_frameIndex]++;
@@ -589,7 +855,7 @@ void D3D12Blending::MoveToNextFrame()
     if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
     {
         ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+        m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
     }
 
     // Set the fence value for the next frame.
@@ -12,6 +12,9 @@
 #pragma once
 
 #include "DXSample.h"
+#include "StepTimer.h"
+#include "StatsCommandList.h"
+#include "DepthSorter.h"
 
 using namespace DirectX;
 
@@ -32,6 +35,8 @@ public:
     virtual void OnRender();
     virtual void OnDestroy();
 
+    virtual void OnKeyDown(UINT8 key);
+
 private:
     // In this sample we overload the meaning of FrameCount to mean both the maximum
     // number of frames that will be queued to the GPU at a time, as well as the number
@@ -85,9 +90,13 @@ private:
     ComPtr<ID3D12RootSignature> m_rootSignature;
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
+    ComPtr<ID3D12DescriptorHeap> m_srvHeap;
     ComPtr<ID3D12PipelineState>  m_blendingPipelineState;
     ComPtr<ID3D12PipelineState>  m_defaultPipelineState;
-    ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    ComPtr<ID3D12PipelineState>  m_oitAccumulationPipelineState;
+    ComPtr<ID3D12PipelineState>  m_oitCompositePipelineState;
+    RenderStats m_renderStats;
+    StatsCommandList m_commandList;     // Counts the recorded commands into m_renderStats.
 
     // App resources.
     ComPtr<ID3D12Resource> m_vertexBuffer;
@@ -99,6 +108,13 @@ private:
     PaddedConstantBuffer* m_mappedConstantData;
     UINT m_rtvDescriptorSize;
 
+    // Weighted blended OIT targets. Their RTVs follow those of the back buffers, and
+    // they are in the pixel shader resource state outside of the transparent pass.
+    static const DXGI_FORMAT c_oitAccumulationFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    static const DXGI_FORMAT c_oitRevealageFormat = DXGI_FORMAT_R16_FLOAT;
+    ComPtr<ID3D12Resource> m_oitAccumulation;
+    ComPtr<ID3D12Resource> m_oitRevealage;
+
     // Synchronization objects.
     UINT m_frameIndex;
     HANDLE m_fenceEvent;
@@ -106,11 +122,12 @@ private:
     UINT64 m_fenceValues[FrameCount];
 
     // Scene constants, updated per-frame
+    StepTimer m_timer;
     float m_curRotationAngleRad;
 
-    // In this simple sample, we know that there are two draw calls
-    // and we will update the scene constants for each draw call.
-    static const unsigned int c_numDrawCalls = 3;
+    // There is a draw call for the cube and for each of the transparent quads (two per
+    // unit of scene scale), and we will update the scene constants for each draw call.
+    unsigned int m_numDrawCalls;
 
     // These computed values will be loaded into a ConstantBuffer
     // during Render
@@ -119,9 +136,18 @@ private:
     XMMATRIX m_projectionMatrix;
     XMVECTOR m_outputColor;
 
+    // World matrices of the transparent quads, and their draw order for sorted blending.
+    std::vector<XMFLOAT4X4> m_quadWorldMatrices;
+    DepthSorter m_depthSorter;
+
+    // Frames between two dumps of the render stats to the debugger output.
+    static const UINT c_renderStatsDumpInterval = 300;
+
     void LoadPipeline();
     void LoadAssets();
     void PopulateCommandList();
+    void CompositeWeightedBlendedTransparency(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle);
+    void UpdateWindowText();
     void MoveToNextFrame();
     void WaitForGpu();
 };
\ No newline at end of file
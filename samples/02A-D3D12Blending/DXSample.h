@@ -13,6 +13,18 @@
 
 #include "DXSampleHelper.h"
 #include "Win32Application.h"
+#include "Benchmark.h"
+
+// How the transparent quads are composited.
+enum class TransparencyMode
+{
+    // Alpha blending in draw order: the quads are sorted back to front each frame.
+    SortedBlending,
+
+    // Weighted blended order-independent transparency (McGuire and Bavoil, 2013): an
+    // accumulation and a revealage target, resolved by a composite pass.
+    WeightedBlended
+};
 
 class DXSample
 {
@@ -36,6 +48,10 @@ public:
 
     void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
 
+    // Benchmark mode (-bench), in which Win32Application renders the frames back to back.
+    Benchmark& GetBenchmark()       { return m_benchmark; }
+    void WriteBenchmarkReport();
+
 protected:
     std::wstring GetAssetFullPath(LPCWSTR assetName);
 
@@ -54,10 +70,26 @@ protected:
     // Adapter info.
     bool m_useWarpDevice;
 
+    // Number of copies of the scene's objects (-scene-scale), to scale the CPU and GPU load.
+    UINT m_sceneScale;
+
+    // Transparency mode of the quads: sorted alpha blending, or weighted blended
+    // order-independent transparency (-oit). The O key switches between the two.
+    TransparencyMode m_transparencyMode;
+
+    // Vertical blanks to wait for at each present. The benchmark mode doesn't wait.
+    UINT m_syncInterval;
+
+    // Samples time the phases of their frames with BENCHMARK_PHASE(m_benchmark, ...).
+    Benchmark m_benchmark;
+
 private:
     // Root assets path.
     std::wstring m_assetsPath;
 
     // Window title.
     std::wstring m_title;
+
+    // The benchmark report is saved to <path>.csv (one row per frame) and <path>.json (summary).
+    std::wstring m_benchmarkReportPath;
 };
@@ -0,0 +1,270 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DepthSorter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEPTH_SORTER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Smallest block given to a thread: below this, waking the threads up costs more
+    // than the sort.
+    const uint32_t c_minBlockSize = 32 * 1024;
+
+    const float* GetPosition(const float* pPositions, size_t stride, uint32_t index)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + stride * index);
+    }
+
+    // Adds the histograms kept per lane into the first one.
+    void MergeLaneHistograms(uint32_t (*pLanes)[256], uint32_t* pHistogram)
+    {
+        for (uint32_t bucket = 0; bucket < 256; ++bucket)
+        {
+            pHistogram[bucket] += pLanes[0][bucket] + pLanes[1][bucket] + pLanes[2][bucket] + pLanes[3][bucket];
+        }
+    }
+}
+
+DepthSorter::DepthSorter(unsigned int threadCount) :
+    m_result(0),
+    m_blockCount(0),
+    m_stats(),
+    m_workerPool(threadCount)
+{
+    m_stats.threadCount = m_workerPool.GetThreadCount();
+}
+
+uint32_t DepthSorter::GetSortKey(float viewDepth, DepthOrder order)
+{
+    // Positive floats order like their bits once the sign bit is set; negative ones
+    // order in reverse, so all their bits are flipped.
+    uint32_t bits;
+    std::memcpy(&bits, &viewDepth, sizeof(bits));
+    const uint32_t key = bits ^ ((bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+    return order == DepthOrder::BackToFront ? ~key : key;
+}
+
+void DepthSorter::Sort(const float* pPositions, size_t stride, uint32_t count, const float viewMatrix[16], DepthOrder order)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    m_stats.count = count;
+    m_stats.radixPassCount = 0;
+    m_result = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        m_keys[i].resize(count);
+        m_values[i].resize(count);
+    }
+
+    const uint32_t threadCount = m_workerPool.GetThreadCount();
+    m_blockCount = (std::max)(1u, (std::min)(threadCount, count / c_minBlockSize));
+    m_stats.blockCount = m_blockCount;
+    m_histograms.assign(static_cast<size_t>(m_blockCount) * DigitCount * BucketCount, 0);
+
+    m_workerPool.Run(m_blockCount, [&](uint32_t block) { ComputeKeys(block, pPositions, stride, viewMatrix, order); });
+
+    // A digit that is the same for every key doesn't change the order: its pass is
+    // skipped. The total counts don't depend on the order of the keys, so the
+    // histograms of the original blocks tell.
+    bool skipDigit[DigitCount] = {};
+    for (uint32_t digit = 0; digit < DigitCount; ++digit)
+    {
+        for (uint32_t bucket = 0; bucket < BucketCount && !skipDigit[digit]; ++bucket)
+        {
+            uint32_t total = 0;
+            for (uint32_t block = 0; block < m_blockCount; ++block)
+            {
+                total += m_histograms[(static_cast<size_t>(block) * DigitCount + digit) * BucketCount + bucket];
+            }
+            skipDigit[digit] = (total == count);
+        }
+    }
+
+    for (uint32_t digit = 0; digit < DigitCount; ++digit)
+    {
+        if (skipDigit[digit] || count == 0)
+        {
+            continue;
+        }
+
+        // After the first pass, the blocks hold other keys than those ComputeKeys()
+        // counted; a single block holds all of them whatever their order.
+        if (m_stats.radixPassCount > 0 && m_blockCount > 1)
+        {
+            m_workerPool.Run(m_blockCount, [&](uint32_t block) { CountDigit(block, digit); });
+        }
+
+        // The keys of a bucket go after those of the previous buckets, and those of a
+        // block after those of the same bucket in the previous blocks.
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < BucketCount; ++bucket)
+        {
+            for (uint32_t block = 0; block < m_blockCount; ++block)
+            {
+                uint32_t& counter = m_histograms[(static_cast<size_t>(block) * DigitCount + digit) * BucketCount + bucket];
+                const uint32_t bucketCount = counter;
+                counter = offset;
+                offset += bucketCount;
+            }
+        }
+
+        m_workerPool.Run(m_blockCount, [&](uint32_t block) { Scatter(block, digit); });
+        m_result ^= 1;
+        ++m_stats.radixPassCount;
+    }
+
+    m_stats.sortSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t DepthSorter::GetBlockBegin(uint32_t block) const
+{
+    return static_cast<uint32_t>(static_cast<uint64_t>(m_stats.count) * block / m_blockCount);
+}
+
+void DepthSorter::ComputeKeys(uint32_t block, const float* pPositions, size_t stride, const float viewMatrix[16], DepthOrder order)
+{
+    const uint32_t begin = GetBlockBegin(block);
+    const uint32_t end = GetBlockBegin(block + 1);
+    uint32_t* pKeys = m_keys[0].data();
+    uint32_t* pValues = m_values[0].data();
+    uint32_t* pHistograms = &m_histograms[static_cast<size_t>(block) * DigitCount * BucketCount];
+
+    // Four histograms per digit, one per SSE lane.
+    uint32_t laneHistograms[DigitCount][4][BucketCount] = {};
+
+    uint32_t i = begin;
+#if defined(DEPTH_SORTER_SSE)
+    // View-space depth: the dot product of the position with the third column.
+    const __m128 column0 = _mm_set1_ps(viewMatrix[2]);
+    const __m128 column1 = _mm_set1_ps(viewMatrix[6]);
+    const __m128 column2 = _mm_set1_ps(viewMatrix[10]);
+    const __m128 column3 = _mm_set1_ps(viewMatrix[14]);
+    const __m128i signBit = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i complement = _mm_set1_epi32(order == DepthOrder::BackToFront ? -1 : 0);
+    const __m128i digitMask = _mm_set1_epi32(BucketCount - 1);
+    const __m128i laneIndices = _mm_set_epi32(3, 2, 1, 0);
+
+    for (; i + 4 <= end; i += 4)
+    {
+        const float* p0 = GetPosition(pPositions, stride, i);
+        const float* p1 = GetPosition(pPositions, stride, i + 1);
+        const float* p2 = GetPosition(pPositions, stride, i + 2);
+        const float* p3 = GetPosition(pPositions, stride, i + 3);
+        const __m128 x = _mm_set_ps(p3[0], p2[0], p1[0], p0[0]);
+        const __m128 y = _mm_set_ps(p3[1], p2[1], p1[1], p0[1]);
+        const __m128 z = _mm_set_ps(p3[2], p2[2], p1[2], p0[2]);
+        // Summed in the same order as the scalar path, so that both give the same keys.
+        const __m128 depth = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, column0), _mm_mul_ps(y, column1)), _mm_mul_ps(z, column2)), column3);
+
+        // Same remapping as GetSortKey(): the arithmetic shift spreads the sign bit.
+        const __m128i bits = _mm_castps_si128(depth);
+        const __m128i flip = _mm_or_si128(_mm_srai_epi32(bits, 31), signBit);
+        const __m128i keys = _mm_xor_si128(_mm_xor_si128(bits, flip), complement);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pKeys + i), keys);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pValues + i), _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)), laneIndices));
+
+        alignas(16) uint32_t digits[DigitCount][4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits[0]), _mm_and_si128(keys, digitMask));
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits[1]), _mm_and_si128(_mm_srli_epi32(keys, 8), digitMask));
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits[2]), _mm_and_si128(_mm_srli_epi32(keys, 16), digitMask));
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits[3]), _mm_srli_epi32(keys, 24));
+        for (uint32_t digit = 0; digit < DigitCount; ++digit)
+        {
+            ++laneHistograms[digit][0][digits[digit][0]];
+            ++laneHistograms[digit][1][digits[digit][1]];
+            ++laneHistograms[digit][2][digits[digit][2]];
+            ++laneHistograms[digit][3][digits[digit][3]];
+        }
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        const float* p = GetPosition(pPositions, stride, i);
+        const float depth = p[0] * viewMatrix[2] + p[1] * viewMatrix[6] + p[2] * viewMatrix[10] + viewMatrix[14];
+        const uint32_t key = GetSortKey(depth, order);
+        pKeys[i] = key;
+        pValues[i] = i;
+        for (uint32_t digit = 0; digit < DigitCount; ++digit)
+        {
+            ++laneHistograms[digit][0][(key >> (digit * RadixBits)) & (BucketCount - 1)];
+        }
+    }
+
+    for (uint32_t digit = 0; digit < DigitCount; ++digit)
+    {
+        MergeLaneHistograms(laneHistograms[digit], pHistograms + digit * BucketCount);
+    }
+}
+
+void DepthSorter::CountDigit(uint32_t block, uint32_t digit)
+{
+    const uint32_t begin = GetBlockBegin(block);
+    const uint32_t end = GetBlockBegin(block + 1);
+    const uint32_t* pKeys = m_keys[m_result].data();
+    const uint32_t shift = digit * RadixBits;
+
+    uint32_t laneHistograms[4][BucketCount] = {};
+
+    uint32_t i = begin;
+#if defined(DEPTH_SORTER_SSE)
+    const __m128i digitMask = _mm_set1_epi32(BucketCount - 1);
+    const __m128i shiftCount = _mm_cvtsi32_si128(static_cast<int>(shift));
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pKeys + i));
+        alignas(16) uint32_t digits[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits), _mm_and_si128(_mm_srl_epi32(keys, shiftCount), digitMask));
+        ++laneHistograms[0][digits[0]];
+        ++laneHistograms[1][digits[1]];
+        ++laneHistograms[2][digits[2]];
+        ++laneHistograms[3][digits[3]];
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        ++laneHistograms[0][(pKeys[i] >> shift) & (BucketCount - 1)];
+    }
+
+    uint32_t* pHistogram = &m_histograms[(static_cast<size_t>(block) * DigitCount + digit) * BucketCount];
+    std::fill(pHistogram, pHistogram + BucketCount, 0u);
+    MergeLaneHistograms(laneHistograms, pHistogram);
+}
+
+void DepthSorter::Scatter(uint32_t block, uint32_t digit)
+{
+    const uint32_t begin = GetBlockBegin(block);
+    const uint32_t end = GetBlockBegin(block + 1);
+    const uint32_t* pKeys = m_keys[m_result].data();
+    const uint32_t* pValues = m_values[m_result].data();
+    uint32_t* pSortedKeys = m_keys[m_result ^ 1].data();
+    uint32_t* pSortedValues = m_values[m_result ^ 1].data();
+    uint32_t* pOffsets = &m_histograms[(static_cast<size_t>(block) * DigitCount + digit) * BucketCount];
+    const uint32_t shift = digit * RadixBits;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const uint32_t key = pKeys[i];
+        const uint32_t destination = pOffsets[(key >> shift) & (BucketCount - 1)]++;
+        pSortedKeys[destination] = key;
+        pSortedValues[destination] = pValues[i];
+    }
+}
@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "WorkerPool.h"
+
+enum class DepthOrder
+{
+    BackToFront,        // Farthest first, for alpha blending.
+    FrontToBack         // Nearest first, for early depth rejection of opaque draws.
+};
+
+struct DepthSortStats
+{
+    uint32_t count;
+    uint32_t radixPassCount;        // Out of four; a pass is skipped when every key has the same digit.
+    uint32_t blockCount;            // Blocks sorted in parallel.
+    double sortSeconds;
+    unsigned int threadCount;
+};
+
+// Orders instances by view-space depth, each frame.
+// The depth of each instance is computed from its world-space position and the view
+// matrix, and turned into a 32-bit key whose unsigned order is the requested depth order.
+// The keys are sorted by a least significant digit radix sort, 8 bits per pass: the
+// digits are extracted four keys at a time with SSE, into four histograms so that equal
+// consecutive digits don't wait for each other. Large arrays are split in blocks that are
+// histogrammed and scattered by the worker threads; the sort is stable, so instances at
+// the same depth keep their order.
+// The threads are started once, and the buffers keep their capacity between calls.
+class DepthSorter
+{
+public:
+    // A threadCount of zero uses std::thread::hardware_concurrency().
+    explicit DepthSorter(unsigned int threadCount = 0);
+
+    // Sorts count instances. Their world-space positions are three floats every stride
+    // bytes from pPositions, such as the translations of their world matrices; the view
+    // matrix is in the DirectXMath layout (row vectors).
+    void Sort(const float* pPositions, size_t stride, uint32_t count, const float viewMatrix[16], DepthOrder order);
+
+    // Instance indices in draw order, after Sort().
+    const uint32_t* GetDrawOrder() const    { return m_values[m_result].data(); }
+    uint32_t GetCount() const               { return m_stats.count; }
+
+    const DepthSortStats& GetStats() const  { return m_stats; }
+
+    // Key of a depth: its float bits, remapped so that the unsigned order of the keys is
+    // the order of the depths (negative depths included), and complemented back to front.
+    static uint32_t GetSortKey(float viewDepth, DepthOrder order);
+
+private:
+    DepthSorter(const DepthSorter&) = delete;
+    DepthSorter& operator=(const DepthSorter&) = delete;
+
+    static const uint32_t RadixBits = 8;
+    static const uint32_t BucketCount = 1 << RadixBits;
+    static const uint32_t DigitCount = 32 / RadixBits;
+
+    // Computes the keys of a block, and the histograms of its four digits.
+    void ComputeKeys(uint32_t block, const float* pPositions, size_t stride, const float viewMatrix[16], DepthOrder order);
+
+    // Histogram of one digit of a block of the current keys.
+    void CountDigit(uint32_t block, uint32_t digit);
+
+    // Moves a block of the current keys and values to their place in the other buffers.
+    void Scatter(uint32_t block, uint32_t digit);
+
+    uint32_t GetBlockBegin(uint32_t block) const;
+
+    // Double-buffered keys and instance indices; m_result is the buffer holding the order.
+    std::vector<uint32_t> m_keys[2];
+    std::vector<uint32_t> m_values[2];
+    uint32_t m_result;
+
+    // BucketCount counters per digit and block; Scatter() turns those of the digit it
+    // sorts into the output offsets of the block.
+    std::vector<uint32_t> m_histograms;
+    uint32_t m_blockCount;
+    DepthSortStats m_stats;
+
+    WorkerPool m_workerPool;
+};
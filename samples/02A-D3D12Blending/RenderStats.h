@@ -0,0 +1,209 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+enum class RenderCounter : uint32_t
+{
+    DrawCalls,
+    Instances,
+    PipelineStateChanges,
+    RedundantPipelineStates,    // SetPipelineState calls with the PSO that was already set.
+    RootConstantBufferBinds,
+    ResourceBarriers,
+    UploadBytes,                // Bytes copied into mapped upload heap memory.
+    FenceWaits,
+    FenceWaitNanoseconds,
+    Count
+};
+
+// Value of every counter for one frame.
+struct RenderFrameStats
+{
+    uint64_t counters[static_cast<size_t>(RenderCounter::Count)];
+
+    uint64_t operator[](RenderCounter counter) const { return counters[static_cast<size_t>(counter)]; }
+};
+
+// Minimum, mean and maximum of the counters over a range of frames.
+struct RenderStatsSummary
+{
+    uint32_t frameCount;
+    uint64_t minimum[static_cast<size_t>(RenderCounter::Count)];
+    uint64_t maximum[static_cast<size_t>(RenderCounter::Count)];
+    double mean[static_cast<size_t>(RenderCounter::Count)];
+};
+
+// Per-frame rendering counters.
+// Add() can be called from any thread: every counter is a separate atomic, kept on its
+// own cache line, so recording threads never lock or contend on a shared line.
+// EndFrame() and the history accessors must be called from a single thread, usually
+// the one that presents.
+class RenderStats
+{
+public:
+    static const uint32_t CounterCount = static_cast<uint32_t>(RenderCounter::Count);
+
+    // Number of closed frames kept for GetSummary().
+    static const uint32_t HistorySize = 512;
+
+    RenderStats() :
+        m_frameCount(0)
+    {
+        for (auto& counter : m_counters)
+        {
+            counter.value.store(0, std::memory_order_relaxed);
+        }
+        memset(m_history, 0, sizeof(m_history));
+    }
+
+    void Add(RenderCounter counter, uint64_t value = 1)
+    {
+        m_counters[static_cast<size_t>(counter)].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // memcpy into upload heap memory, counting the bytes written.
+    void CopyToUploadMemory(void* pDestination, const void* pSource, size_t size)
+    {
+        memcpy(pDestination, pSource, size);
+        Add(RenderCounter::UploadBytes, size);
+    }
+
+    // Run wait() (a blocking wait on a fence) and count it with its duration.
+    template<typename TWait>
+    void TimeFenceWait(const TWait& wait)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        wait();
+        const auto duration = std::chrono::steady_clock::now() - start;
+
+        Add(RenderCounter::FenceWaits);
+        Add(RenderCounter::FenceWaitNanoseconds, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    }
+
+    // Close the current frame: its counters are moved to the history and reset to zero.
+    // Returns the number of frames closed so far.
+    uint64_t EndFrame()
+    {
+        RenderFrameStats& frame = m_history[m_frameCount % HistorySize];
+        for (uint32_t i = 0; i < CounterCount; ++i)
+        {
+            frame.counters[i] = m_counters[i].value.exchange(0, std::memory_order_relaxed);
+        }
+        return ++m_frameCount;
+    }
+
+    uint64_t GetFrameCount() const { return m_frameCount; }
+
+    const RenderFrameStats& GetLastFrame() const
+    {
+        static const RenderFrameStats empty = {};
+        return m_frameCount > 0 ? m_history[(m_frameCount - 1) % HistorySize] : empty;
+    }
+
+    // Summary of the last frameCount closed frames (at most HistorySize).
+    RenderStatsSummary GetSummary(uint32_t frameCount) const
+    {
+        RenderStatsSummary summary = {};
+        summary.frameCount = static_cast<uint32_t>((std::min<uint64_t>)((std::min)(frameCount, static_cast<uint32_t>(HistorySize)), m_frameCount));
+        if (summary.frameCount == 0)
+        {
+            return summary;
+        }
+
+        double totals[CounterCount] = {};
+        for (uint32_t i = 0; i < CounterCount; ++i)
+        {
+            summary.minimum[i] = UINT64_MAX;
+        }
+
+        for (uint32_t f = 0; f < summary.frameCount; ++f)
+        {
+            const RenderFrameStats& frame = m_history[(m_frameCount - 1 - f) % HistorySize];
+            for (uint32_t i = 0; i < CounterCount; ++i)
+            {
+                summary.minimum[i] = (std::min)(summary.minimum[i], frame.counters[i]);
+                summary.maximum[i] = (std::max)(summary.maximum[i], frame.counters[i]);
+                totals[i] += static_cast<double>(frame.counters[i]);
+            }
+        }
+
+        for (uint32_t i = 0; i < CounterCount; ++i)
+        {
+            summary.mean[i] = totals[i] / summary.frameCount;
+        }
+        return summary;
+    }
+
+    // Text dump of GetSummary(), one counter per line.
+    std::string FormatSummary(uint32_t frameCount) const
+    {
+        const RenderStatsSummary summary = GetSummary(frameCount);
+
+        char line[160];
+        snprintf(line, sizeof(line), "Render stats over %u frames (min / mean / max per frame):\n", summary.frameCount);
+        std::string text = line;
+
+        for (uint32_t i = 0; i < CounterCount; ++i)
+        {
+            if (static_cast<RenderCounter>(i) == RenderCounter::FenceWaitNanoseconds)
+            {
+                snprintf(line, sizeof(line), "  %-26s %10.3f / %10.3f / %10.3f ms\n", "Fence wait time",
+                    summary.minimum[i] / 1e6, summary.mean[i] / 1e6, summary.maximum[i] / 1e6);
+            }
+            else
+            {
+                snprintf(line, sizeof(line), "  %-26s %10llu / %10.2f / %10llu\n", GetCounterName(static_cast<RenderCounter>(i)),
+                    static_cast<unsigned long long>(summary.minimum[i]), summary.mean[i], static_cast<unsigned long long>(summary.maximum[i]));
+            }
+            text += line;
+        }
+        return text;
+    }
+
+    static const char* GetCounterName(RenderCounter counter)
+    {
+        static const char* const names[] =
+        {
+            "Draw calls",
+            "Instances",
+            "PSO changes",
+            "Redundant PSO sets",
+            "Root CBV binds",
+            "Resource barriers",
+            "Upload bytes",
+            "Fence waits",
+            "Fence wait time (ns)",
+        };
+        static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(RenderCounter::Count), "Missing counter names.");
+
+        return names[static_cast<size_t>(counter)];
+    }
+
+private:
+    struct PaddedCounter
+    {
+        std::atomic<uint64_t> value;
+        uint8_t padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    PaddedCounter m_counters[CounterCount];
+    RenderFrameStats m_history[HistorySize];
+    uint64_t m_frameCount;
+};
@@ -0,0 +1,151 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DepthSorter.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Matrix
+    {
+        float m[16];
+    };
+
+    // World matrices translated to random positions, a tenth of them at the same place.
+    std::vector<Matrix> GetWorldMatrices(uint32_t count)
+    {
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+
+        std::vector<Matrix> matrices(count);
+        for (auto& matrix : matrices)
+        {
+            std::fill(matrix.m, matrix.m + 16, 0.0f);
+            matrix.m[0] = matrix.m[5] = matrix.m[10] = matrix.m[15] = 1.0f;
+            matrix.m[12] = position(random);
+            matrix.m[13] = position(random);
+            matrix.m[14] = position(random);
+        }
+        for (uint32_t i = 0; i < count / 10; ++i)
+        {
+            Matrix& matrix = matrices[i * 7 % count];
+            matrix.m[12] = matrix.m[13] = matrix.m[14] = 1.5f;
+        }
+        return matrices;
+    }
+
+    // A rotated and translated camera, in the DirectXMath layout.
+    void GetViewMatrix(float view[16])
+    {
+        const float yaw = 0.7f;
+        const float pitch = 0.3f;
+        const float matrix[16] =
+        {
+            std::cos(yaw), 0.0f, -std::sin(yaw), 0.0f,
+            std::sin(yaw) * std::sin(pitch), std::cos(pitch), std::cos(yaw) * std::sin(pitch), 0.0f,
+            std::sin(yaw) * std::cos(pitch), -std::sin(pitch), std::cos(yaw) * std::cos(pitch), 0.0f,
+            3.0f, -2.0f, 5.0f, 1.0f
+        };
+        std::copy(matrix, matrix + 16, view);
+    }
+
+    // The draw order is the one of a stable sort of the depths.
+    void CheckOrder(const DepthSorter& sorter, const std::vector<Matrix>& world, const float view[16], DepthOrder order)
+    {
+        const uint32_t count = static_cast<uint32_t>(world.size());
+        CHECK(sorter.GetCount() == count);
+
+        std::vector<float> depths(count);
+        std::vector<uint32_t> expected(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float* p = &world[i].m[12];
+            depths[i] = p[0] * view[2] + p[1] * view[6] + p[2] * view[10] + view[14];
+            expected[i] = i;
+        }
+        std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b)
+        {
+            return order == DepthOrder::BackToFront ? depths[a] > depths[b] : depths[a] < depths[b];
+        });
+
+        CHECK(std::equal(expected.begin(), expected.end(), sorter.GetDrawOrder()));
+    }
+
+    void TestSortKeys()
+    {
+        const float depths[] = { -1e30f, -5.0f, -0.5f, -0.0f, 0.0f, 1e-30f, 0.5f, 5.0f, 1e30f };
+        for (size_t i = 0; i + 1 < sizeof(depths) / sizeof(depths[0]); ++i)
+        {
+            CHECK(DepthSorter::GetSortKey(depths[i], DepthOrder::FrontToBack) <= DepthSorter::GetSortKey(depths[i + 1], DepthOrder::FrontToBack));
+            CHECK(DepthSorter::GetSortKey(depths[i], DepthOrder::BackToFront) >= DepthSorter::GetSortKey(depths[i + 1], DepthOrder::BackToFront));
+        }
+    }
+
+    // Small and large arrays, in one block or split among the worker threads.
+    void TestSort()
+    {
+        float view[16];
+        GetViewMatrix(view);
+
+        for (unsigned int threadCount : { 1u, 4u })
+        {
+            DepthSorter sorter(threadCount);
+            CHECK(sorter.GetStats().threadCount == threadCount);
+
+            for (uint32_t count : { 0u, 1u, 1000u, 300000u })
+            {
+                const std::vector<Matrix> world = GetWorldMatrices(count);
+                const float* pPositions = count > 0 ? &world[0].m[12] : nullptr;
+                for (DepthOrder order : { DepthOrder::BackToFront, DepthOrder::FrontToBack })
+                {
+                    sorter.Sort(pPositions, sizeof(Matrix), count, view, order);
+                    CheckOrder(sorter, world, view, order);
+                }
+                CHECK(sorter.GetStats().blockCount == (count == 300000 ? threadCount : 1));
+            }
+        }
+    }
+
+    // A digit shared by every key isn't sorted.
+    void TestSkippedPasses()
+    {
+        const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+        std::vector<Matrix> world = GetWorldMatrices(64);
+        for (auto& matrix : world)
+        {
+            matrix.m[14] = 2.0f;
+        }
+
+        DepthSorter sorter(1);
+        sorter.Sort(&world[0].m[12], sizeof(Matrix), 64, identity, DepthOrder::BackToFront);
+        CHECK(sorter.GetStats().radixPassCount == 0);
+        CheckOrder(sorter, world, identity, DepthOrder::BackToFront);
+
+        world[5].m[14] = 3.0f;
+        sorter.Sort(&world[0].m[12], sizeof(Matrix), 64, identity, DepthOrder::BackToFront);
+        CHECK(sorter.GetStats().radixPassCount > 0 && sorter.GetStats().radixPassCount < 4);
+        CHECK(sorter.GetDrawOrder()[0] == 5);
+        CheckOrder(sorter, world, identity, DepthOrder::BackToFront);
+    }
+}
+
+int main()
+{
+    TestSortKeys();
+    TestSort();
+    TestSkippedPasses();
+    return 0;
+}
@@ -0,0 +1,272 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TransientResources.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const uint64_t c_megabyte = 1024 * 1024;
+    const uint64_t c_placementAlignment = 64 * 1024;
+
+    // Checks what every plan must hold: the resources that live at the same time don't
+    // share memory, every placement is aligned and inside the heap, the heap is no
+    // smaller than the peak live size, and each resource placed over others takes their
+    // memory over with one barrier at its first pass.
+    void CheckPlan(const TransientResourcePlanner& planner, const std::vector<uint64_t>& sizes, const std::vector<uint64_t>& alignments)
+    {
+        const uint32_t count = planner.GetResourceCount();
+        CHECK(planner.GetPeakLiveSize() <= planner.GetHeapSize());
+        CHECK(planner.GetSavedBytes() == (std::max)(planner.GetHeapSize(), planner.GetUnaliasedSize()) - planner.GetHeapSize());
+
+        std::vector<uint32_t> expectedBarriers;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            CHECK(planner.GetOffset(i) % alignments[i] == 0);
+            CHECK(planner.GetOffset(i) + sizes[i] <= planner.GetHeapSize());
+
+            uint32_t sharing = 0;
+            uint32_t previous = TransientResourcePlanner::AnyResource;
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                const bool liveTogether = planner.GetFirstPass(i) <= planner.GetLastPass(j) && planner.GetFirstPass(j) <= planner.GetLastPass(i);
+                const bool sameMemory = planner.GetOffset(i) < planner.GetOffset(j) + sizes[j] && planner.GetOffset(j) < planner.GetOffset(i) + sizes[i];
+                if (j != i && sameMemory)
+                {
+                    CHECK(!liveTogether);
+                    ++sharing;
+                    previous = j;
+                }
+            }
+
+            if (sharing > 0)
+            {
+                bool found = false;
+                for (const TransientResourcePlanner::AliasingBarrier& barrier : planner.GetAliasingBarriers())
+                {
+                    if (barrier.resourceAfter == i)
+                    {
+                        CHECK(!found);
+                        found = true;
+                        CHECK(barrier.pass == planner.GetFirstPass(i));
+                        CHECK(barrier.resourceBefore == (sharing == 1 ? previous : TransientResourcePlanner::AnyResource));
+                    }
+                }
+                CHECK(found);
+                expectedBarriers.push_back(i);
+            }
+        }
+        CHECK(planner.GetAliasingBarriers().size() == expectedBarriers.size());
+
+        const std::vector<TransientResourcePlanner::AliasingBarrier>& barriers = planner.GetAliasingBarriers();
+        for (size_t i = 1; i < barriers.size(); ++i)
+        {
+            CHECK(barriers[i - 1].pass <= barriers[i].pass);
+        }
+    }
+
+    // Shadow, scene, two bloom passes and tonemapping. The shadow map is free once the
+    // scene is drawn, so the bloom targets take its memory over, and the heap comes down
+    // to the peak live size of the scene pass.
+    void TestPostProcessChain()
+    {
+        enum { ShadowPass, ScenePass, BloomDownPass, BloomUpPass, TonemapPass, PassCount };
+
+        TransientResourcePlanner planner;
+        for (uint32_t pass = 0; pass < PassCount; ++pass)
+        {
+            CHECK(planner.AddPass() == pass);
+        }
+
+        const std::vector<uint64_t> sizes = { 16 * c_megabyte, 16 * c_megabyte, 8 * c_megabyte, 8 * c_megabyte, 8 * c_megabyte };
+        const std::vector<uint64_t> alignments(sizes.size(), c_placementAlignment);
+        const uint32_t shadowMap = planner.AddResource(sizes[0], alignments[0]);
+        const uint32_t sceneColor = planner.AddResource(sizes[1], alignments[1]);
+        const uint32_t depth = planner.AddResource(sizes[2], alignments[2]);
+        const uint32_t bloomA = planner.AddResource(sizes[3], alignments[3]);
+        const uint32_t bloomB = planner.AddResource(sizes[4], alignments[4]);
+
+        planner.UseResource(ShadowPass, shadowMap);
+        planner.UseResource(ScenePass, shadowMap);
+        planner.UseResource(ScenePass, sceneColor);
+        planner.UseResource(ScenePass, depth);
+        planner.UseResource(BloomDownPass, sceneColor);
+        planner.UseResource(BloomDownPass, bloomA);
+        planner.UseResource(BloomUpPass, bloomA);
+        planner.UseResource(BloomUpPass, bloomB);
+        planner.UseResource(TonemapPass, bloomB);
+        planner.UseResource(TonemapPass, sceneColor);
+        planner.Plan();
+
+        CheckPlan(planner, sizes, alignments);
+        CHECK(planner.GetFirstPass(sceneColor) == ScenePass && planner.GetLastPass(sceneColor) == TonemapPass);
+        CHECK(planner.GetUnaliasedSize() == 56 * c_megabyte);
+        CHECK(planner.GetPeakLiveSize() == 40 * c_megabyte);
+        CHECK(planner.GetHeapSize() == 40 * c_megabyte);
+        CHECK(planner.GetSavedBytes() == 16 * c_megabyte);
+
+        CHECK(planner.GetOffset(shadowMap) == 0);
+        CHECK(planner.GetOffset(bloomA) == 0);
+        CHECK(planner.GetOffset(bloomB) == 8 * c_megabyte);
+
+        // The bloom targets take the shadow map over, which takes both back in the next frame.
+        const std::vector<TransientResourcePlanner::AliasingBarrier>& barriers = planner.GetAliasingBarriers();
+        CHECK(barriers.size() == 3);
+        CHECK(barriers[0].pass == ShadowPass && barriers[0].resourceBefore == TransientResourcePlanner::AnyResource && barriers[0].resourceAfter == shadowMap);
+        CHECK(barriers[1].pass == BloomDownPass && barriers[1].resourceBefore == shadowMap && barriers[1].resourceAfter == bloomA);
+        CHECK(barriers[2].pass == BloomUpPass && barriers[2].resourceBefore == shadowMap && barriers[2].resourceAfter == bloomB);
+
+        CHECK(!planner.FormatStats().empty());
+    }
+
+    // The frame of 02A: the depth buffer and both OIT targets are live during the
+    // transparent pass, so nothing can be aliased.
+    void TestBlendingFrame()
+    {
+        enum { OpaquePass, TransparentPass, CompositePass, PassCount };
+
+        TransientResourcePlanner planner;
+        for (uint32_t pass = 0; pass < PassCount; ++pass)
+        {
+            planner.AddPass();
+        }
+
+        const std::vector<uint64_t> sizes = { 2 * c_megabyte, 4 * c_megabyte, c_megabyte };
+        const std::vector<uint64_t> alignments(sizes.size(), c_placementAlignment);
+        const uint32_t depth = planner.AddResource(sizes[0], alignments[0]);
+        const uint32_t accumulation = planner.AddResource(sizes[1], alignments[1]);
+        const uint32_t revealage = planner.AddResource(sizes[2], alignments[2]);
+
+        planner.UseResource(OpaquePass, depth);
+        planner.UseResource(TransparentPass, depth);
+        planner.UseResource(TransparentPass, accumulation);
+        planner.UseResource(TransparentPass, revealage);
+        planner.UseResource(CompositePass, accumulation);
+        planner.UseResource(CompositePass, revealage);
+        planner.Plan();
+
+        CheckPlan(planner, sizes, alignments);
+        CHECK(planner.GetHeapSize() == 7 * c_megabyte);
+        CHECK(planner.GetPeakLiveSize() == 7 * c_megabyte);
+        CHECK(planner.GetSavedBytes() == 0);
+        CHECK(planner.GetAliasingBarriers().empty());
+    }
+
+    // Placements are rounded up to the alignment of each resource.
+    void TestAlignment()
+    {
+        TransientResourcePlanner planner;
+        const uint32_t pass = planner.AddPass();
+        const std::vector<uint64_t> sizes = { 1000, 3000, 100 };
+        const std::vector<uint64_t> alignments = { 256, 4096, 65536 };
+        for (size_t i = 0; i < sizes.size(); ++i)
+        {
+            planner.UseResource(pass, planner.AddResource(sizes[i], alignments[i]));
+        }
+        planner.Plan();
+
+        CheckPlan(planner, sizes, alignments);
+        CHECK(planner.GetOffset(1) == 0);
+        CHECK(planner.GetOffset(0) == 3072);
+        CHECK(planner.GetOffset(2) == 65536);
+        CHECK(planner.GetHeapSize() == 65536 + 100);
+        CHECK(planner.GetPeakLiveSize() == 4100);
+
+        // The padding makes the heap larger than separate allocations.
+        CHECK(planner.GetUnaliasedSize() == 4100);
+        CHECK(planner.GetSavedBytes() == 0);
+    }
+
+    // Random graphs, with resources of a few sizes and alignments used by runs of passes.
+    void TestRandomGraphs()
+    {
+        std::mt19937 random(11);
+        uint64_t totalHeap = 0;
+        uint64_t totalPeak = 0;
+
+        for (int graph = 0; graph < 1000; ++graph)
+        {
+            TransientResourcePlanner planner;
+            const uint32_t passCount = 1 + random() % 12;
+            for (uint32_t pass = 0; pass < passCount; ++pass)
+            {
+                planner.AddPass();
+            }
+
+            const uint32_t resourceCount = 1 + random() % 16;
+            std::vector<uint64_t> sizes(resourceCount), alignments(resourceCount);
+            for (uint32_t i = 0; i < resourceCount; ++i)
+            {
+                alignments[i] = uint64_t(1) << (8 + random() % 9);
+                sizes[i] = 1 + random() % (4 * c_megabyte);
+
+                const uint32_t resource = planner.AddResource(sizes[i], alignments[i]);
+                const uint32_t first = random() % passCount;
+                const uint32_t last = first + random() % (passCount - first);
+                for (uint32_t pass = first; pass <= last; pass += 1 + random() % 2)
+                {
+                    planner.UseResource(pass, resource);
+                }
+                planner.UseResource(last, resource);
+            }
+            planner.Plan();
+
+            CheckPlan(planner, sizes, alignments);
+            totalHeap += planner.GetHeapSize();
+            totalPeak += planner.GetPeakLiveSize();
+
+            // Planning again gives the same plan.
+            const uint64_t heapSize = planner.GetHeapSize();
+            const size_t barrierCount = planner.GetAliasingBarriers().size();
+            planner.Plan();
+            CHECK(planner.GetHeapSize() == heapSize);
+            CHECK(planner.GetAliasingBarriers().size() == barrierCount);
+        }
+
+        // The greedy placement stays close to the lower bound.
+        CHECK(totalHeap < totalPeak + totalPeak / 4);
+    }
+
+    void TestInvalidInput()
+    {
+        TransientResourcePlanner planner;
+        CHECK_THROWS(planner.AddResource(0, 256));
+        CHECK_THROWS(planner.AddResource(1024, 0));
+        CHECK_THROWS(planner.AddResource(1024, 384));
+
+        const uint32_t resource = planner.AddResource(1024, 256);
+        CHECK_THROWS(planner.UseResource(0, resource));
+
+        const uint32_t pass = planner.AddPass();
+        CHECK_THROWS(planner.UseResource(pass, resource + 1));
+        CHECK_THROWS(planner.UseResource(pass + 1, resource));
+
+        // Every resource must be used by a pass.
+        CHECK_THROWS(planner.Plan());
+        planner.UseResource(pass, resource);
+        planner.Plan();
+        CHECK(planner.GetHeapSize() == 1024);
+    }
+}
+
+int main()
+{
+    TestPostProcessChain();
+    TestBlendingFrame();
+    TestAlignment();
+    TestRandomGraphs();
+    TestInvalidInput();
+    return 0;
+}
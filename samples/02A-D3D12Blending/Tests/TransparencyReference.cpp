@@ -0,0 +1,301 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TransparencyReference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    // Twice the signed area of (a, b, p): positive when p is right of a->b, y down.
+    float EdgeFunction(const TransparentVertex& a, const TransparentVertex& b, float x, float y)
+    {
+        return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+    }
+
+    // Top-left fill rule, for an edge of a triangle with a positive area.
+    bool IsTopLeftEdge(const TransparentVertex& a, const TransparentVertex& b)
+    {
+        return (a.y == b.y && b.x > a.x) || b.y < a.y;
+    }
+}
+
+float GetOitWeight(float viewDepth, float alpha)
+{
+    const float z = std::fabs(viewDepth);
+    const float nearTerm = z / 5.0f;
+    const float farTerm = z / 200.0f;
+    const float farTerm2 = farTerm * farTerm;
+    const float weight = 10.0f / (1e-5f + nearTerm * nearTerm + farTerm2 * farTerm2 * farTerm2);
+    return alpha * (std::min)((std::max)(weight, 1e-2f), 3e3f);
+}
+
+TransparencyReference::TransparencyReference(uint32_t width, uint32_t height) :
+    m_width(width),
+    m_height(height),
+    m_fragmentCount(0)
+{
+    if (width == 0 || height == 0)
+    {
+        throw std::runtime_error("TransparencyReference: the image must not be empty");
+    }
+    m_image.resize(3 * static_cast<size_t>(width) * height);
+}
+
+template <typename Visitor>
+void TransparencyReference::Rasterize(const TransparentQuad& quad, Visitor&& visit) const
+{
+    // Two triangles sharing the 0-2 diagonal; the fill rule gives its pixels to one of them.
+    static const int c_triangles[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+    for (const auto& triangle : c_triangles)
+    {
+        TransparentVertex v0 = quad.vertices[triangle[0]];
+        TransparentVertex v1 = quad.vertices[triangle[1]];
+        TransparentVertex v2 = quad.vertices[triangle[2]];
+        float area = EdgeFunction(v0, v1, v2.x, v2.y);
+        if (area == 0.0f)
+        {
+            continue;
+        }
+        if (area < 0.0f)
+        {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        const bool topLeft0 = IsTopLeftEdge(v1, v2);
+        const bool topLeft1 = IsTopLeftEdge(v2, v0);
+        const bool topLeft2 = IsTopLeftEdge(v0, v1);
+        const float inverseDepth0 = 1.0f / v0.viewDepth;
+        const float inverseDepth1 = 1.0f / v1.viewDepth;
+        const float inverseDepth2 = 1.0f / v2.viewDepth;
+
+        // Pixels whose centers are inside the bounding box, clamped to the image.
+        const float minX = (std::min)({ v0.x, v1.x, v2.x });
+        const float maxX = (std::max)({ v0.x, v1.x, v2.x });
+        const float minY = (std::min)({ v0.y, v1.y, v2.y });
+        const float maxY = (std::max)({ v0.y, v1.y, v2.y });
+        const int firstX = (std::max)(static_cast<int>(std::ceil(minX - 0.5f)), 0);
+        const int lastX = (std::min)(static_cast<int>(std::floor(maxX - 0.5f)), static_cast<int>(m_width) - 1);
+        const int firstY = (std::max)(static_cast<int>(std::ceil(minY - 0.5f)), 0);
+        const int lastY = (std::min)(static_cast<int>(std::floor(maxY - 0.5f)), static_cast<int>(m_height) - 1);
+
+        for (int y = firstY; y <= lastY; ++y)
+        {
+            const float centerY = y + 0.5f;
+            for (int x = firstX; x <= lastX; ++x)
+            {
+                const float centerX = x + 0.5f;
+                const float e0 = EdgeFunction(v1, v2, centerX, centerY);
+                const float e1 = EdgeFunction(v2, v0, centerX, centerY);
+                const float e2 = EdgeFunction(v0, v1, centerX, centerY);
+                if ((e0 > 0.0f || (e0 == 0.0f && topLeft0)) &&
+                    (e1 > 0.0f || (e1 == 0.0f && topLeft1)) &&
+                    (e2 > 0.0f || (e2 == 0.0f && topLeft2)))
+                {
+                    // 1 / depth is linear in screen space.
+                    const float inverseDepth = (e0 * inverseDepth0 + e1 * inverseDepth1 + e2 * inverseDepth2) / area;
+                    visit(static_cast<size_t>(y) * m_width + x, 1.0f / inverseDepth);
+                }
+            }
+        }
+    }
+}
+
+void TransparencyReference::Render(Mode mode, const TransparentQuad* pQuads, uint32_t quadCount, const float background[3])
+{
+    for (uint32_t i = 0; i < quadCount; ++i)
+    {
+        for (const TransparentVertex& vertex : pQuads[i].vertices)
+        {
+            if (!(vertex.viewDepth > 0.0f))
+            {
+                throw std::runtime_error("TransparencyReference: the quads must be in front of the camera");
+            }
+        }
+    }
+
+    const size_t pixelCount = static_cast<size_t>(m_width) * m_height;
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        std::copy(background, background + 3, &m_image[3 * pixel]);
+    }
+    m_fragmentCount = 0;
+
+    switch (mode)
+    {
+    case Mode::SortedBlending:
+        RenderSorted(pQuads, quadCount);
+        break;
+    case Mode::WeightedBlended:
+        RenderWeightedBlended(pQuads, quadCount);
+        break;
+    case Mode::PerPixelSorted:
+        RenderPerPixelSorted(pQuads, quadCount);
+        break;
+    }
+}
+
+void TransparencyReference::RenderSorted(const TransparentQuad* pQuads, uint32_t quadCount)
+{
+    for (uint32_t i = 0; i < quadCount; ++i)
+    {
+        const float* color = pQuads[i].color;
+        const float alpha = color[3];
+        Rasterize(pQuads[i], [&](size_t pixel, float)
+        {
+            float* destination = &m_image[3 * pixel];
+            for (int c = 0; c < 3; ++c)
+            {
+                destination[c] = color[c] * alpha + destination[c] * (1.0f - alpha);
+            }
+            ++m_fragmentCount;
+        });
+    }
+}
+
+void TransparencyReference::RenderWeightedBlended(const TransparentQuad* pQuads, uint32_t quadCount)
+{
+    // The same blend equations as the accumulation pass of the sample: the
+    // accumulation target adds, and the revealage target multiplies by (1 - alpha).
+    const size_t pixelCount = static_cast<size_t>(m_width) * m_height;
+    m_accumulation.assign(4 * pixelCount, 0.0f);
+    m_revealage.assign(pixelCount, 1.0f);
+
+    for (uint32_t i = 0; i < quadCount; ++i)
+    {
+        const float* color = pQuads[i].color;
+        const float alpha = color[3];
+        Rasterize(pQuads[i], [&](size_t pixel, float viewDepth)
+        {
+            const float weight = GetOitWeight(viewDepth, alpha);
+            float* accumulation = &m_accumulation[4 * pixel];
+            accumulation[0] += color[0] * alpha * weight;
+            accumulation[1] += color[1] * alpha * weight;
+            accumulation[2] += color[2] * alpha * weight;
+            accumulation[3] += alpha * weight;
+            m_revealage[pixel] *= 1.0f - alpha;
+            ++m_fragmentCount;
+        });
+    }
+
+    // Composite: the weighted average color covers (1 - revealage) of the background.
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        const float revealage = m_revealage[pixel];
+        if (revealage == 1.0f)
+        {
+            continue;
+        }
+        const float* accumulation = &m_accumulation[4 * pixel];
+        const float totalWeight = (std::max)(accumulation[3], 1e-5f);
+        float* destination = &m_image[3 * pixel];
+        for (int c = 0; c < 3; ++c)
+        {
+            destination[c] = accumulation[c] / totalWeight * (1.0f - revealage) + destination[c] * revealage;
+        }
+    }
+}
+
+void TransparencyReference::RenderPerPixelSorted(const TransparentQuad* pQuads, uint32_t quadCount)
+{
+    // Count the fragments of each pixel, then store them in one array grouped by pixel.
+    const size_t pixelCount = static_cast<size_t>(m_width) * m_height;
+    m_firstFragment.assign(pixelCount + 1, 0);
+    for (uint32_t i = 0; i < quadCount; ++i)
+    {
+        Rasterize(pQuads[i], [&](size_t pixel, float) { ++m_firstFragment[pixel + 1]; });
+    }
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        m_firstFragment[pixel + 1] += m_firstFragment[pixel];
+    }
+    m_fragmentCount = m_firstFragment[pixelCount];
+
+    m_fragments.resize(static_cast<size_t>(m_fragmentCount));
+    for (uint32_t i = 0; i < quadCount; ++i)
+    {
+        Rasterize(pQuads[i], [&](size_t pixel, float viewDepth)
+        {
+            Fragment& fragment = m_fragments[m_firstFragment[pixel]++];
+            fragment.viewDepth = viewDepth;
+            fragment.quad = i;
+        });
+    }
+
+    // The fill pass moved each offset to the start of the next pixel.
+    for (size_t pixel = pixelCount; pixel > 0; --pixel)
+    {
+        m_firstFragment[pixel] = m_firstFragment[pixel - 1];
+    }
+    m_firstFragment[0] = 0;
+
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        Fragment* first = m_fragments.data() + m_firstFragment[pixel];
+        Fragment* last = m_fragments.data() + m_firstFragment[pixel + 1];
+
+        // Back to front; coplanar fragments keep the draw order.
+        std::sort(first, last, [](const Fragment& a, const Fragment& b)
+        {
+            return a.viewDepth > b.viewDepth || (a.viewDepth == b.viewDepth && a.quad < b.quad);
+        });
+
+        float* destination = &m_image[3 * pixel];
+        for (const Fragment* fragment = first; fragment != last; ++fragment)
+        {
+            const float* color = pQuads[fragment->quad].color;
+            for (int c = 0; c < 3; ++c)
+            {
+                destination[c] = color[c] * color[3] + destination[c] * (1.0f - color[3]);
+            }
+        }
+    }
+}
+
+void TransparencyReference::SortBackToFront(std::vector<TransparentQuad>& quads)
+{
+    auto meanDepth = [](const TransparentQuad& quad)
+    {
+        return quad.vertices[0].viewDepth + quad.vertices[1].viewDepth + quad.vertices[2].viewDepth + quad.vertices[3].viewDepth;
+    };
+    std::stable_sort(quads.begin(), quads.end(), [&](const TransparentQuad& a, const TransparentQuad& b)
+    {
+        return meanDepth(a) > meanDepth(b);
+    });
+}
+
+TransparencyReference::ImageError TransparencyReference::Compare(const std::vector<float>& image, const std::vector<float>& reference)
+{
+    if (image.size() != reference.size() || image.empty())
+    {
+        throw std::runtime_error("TransparencyReference: the images must have the same size");
+    }
+
+    double absoluteSum = 0.0;
+    double squareSum = 0.0;
+    float maxAbsolute = 0.0f;
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        const float difference = std::fabs(image[i] - reference[i]);
+        absoluteSum += difference;
+        squareSum += static_cast<double>(difference) * difference;
+        maxAbsolute = (std::max)(maxAbsolute, difference);
+    }
+
+    ImageError error;
+    error.meanAbsolute = absoluteSum / image.size();
+    error.rootMeanSquare = std::sqrt(squareSum / image.size());
+    error.maxAbsolute = maxAbsolute;
+    return error;
+}
@@ -0,0 +1,115 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Screen-space vertex: pixel coordinates, y down, and the view-space depth.
+struct TransparentVertex
+{
+    float x;
+    float y;
+    float viewDepth;
+};
+
+// Planar convex quad of a single color; alpha is not premultiplied.
+struct TransparentQuad
+{
+    TransparentVertex vertices[4];
+    float color[4];
+};
+
+// Weight of a fragment in the weighted blended mode (equation 7 of the paper, for
+// depths up to a few hundred units). WeightedBlendPS in shaders.hlsl must match it.
+float GetOitWeight(float viewDepth, float alpha);
+
+// Headless CPU renderer of transparent quads over a background color, for comparing
+// the accuracy of the transparency modes of the sample without a GPU.
+// Quads are rasterized with the D3D conventions (pixel centers at half-integers,
+// top-left fill rule) and the depth is interpolated perspective-correctly.
+// There is no depth test: every quad is in front of the background.
+class TransparencyReference
+{
+public:
+    // How the transparent surfaces are composited.
+    enum class Mode
+    {
+        // Alpha blending in draw order: correct when the draws are sorted back to front
+        // and don't intersect.
+        SortedBlending,
+
+        // Weighted blended order-independent transparency (McGuire and Bavoil, 2013): an
+        // accumulation and a revealage target, resolved by a composite pass. The result
+        // doesn't depend on the draw order.
+        WeightedBlended,
+
+        // Every fragment of a pixel sorted by depth before blending: the exact result,
+        // which the other modes are measured against.
+        PerPixelSorted
+    };
+
+    TransparencyReference(uint32_t width, uint32_t height);
+
+    // Renders the quads in array order; only PerPixelSorted and WeightedBlended are
+    // independent of the order.
+    void Render(Mode mode, const TransparentQuad* pQuads, uint32_t quadCount, const float background[3]);
+
+    uint32_t GetWidth() const           { return m_width; }
+    uint32_t GetHeight() const          { return m_height; }
+
+    // RGB of each pixel, row by row.
+    const std::vector<float>& GetImage() const { return m_image; }
+
+    // Fragments produced by the last Render() call.
+    uint64_t GetFragmentCount() const   { return m_fragmentCount; }
+
+    // Sorts the quads back to front by their mean view depth, as the CPU sort of a
+    // sorted blending renderer would.
+    static void SortBackToFront(std::vector<TransparentQuad>& quads);
+
+    struct ImageError
+    {
+        double meanAbsolute;        // Over every channel of every pixel.
+        double rootMeanSquare;
+        float maxAbsolute;
+    };
+
+    // Both images must have the same size.
+    static ImageError Compare(const std::vector<float>& image, const std::vector<float>& reference);
+
+private:
+    // Calls visit(pixelIndex, viewDepth) for each pixel covered by a quad.
+    template <typename Visitor>
+    void Rasterize(const TransparentQuad& quad, Visitor&& visit) const;
+
+    void RenderSorted(const TransparentQuad* pQuads, uint32_t quadCount);
+    void RenderWeightedBlended(const TransparentQuad* pQuads, uint32_t quadCount);
+    void RenderPerPixelSorted(const TransparentQuad* pQuads, uint32_t quadCount);
+
+    struct Fragment
+    {
+        float viewDepth;
+        uint32_t quad;
+    };
+
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<float> m_image;
+    uint64_t m_fragmentCount;
+
+    // Work buffers, kept between calls.
+    std::vector<float> m_accumulation;          // Weighted premultiplied RGB and alpha.
+    std::vector<float> m_revealage;
+    std::vector<uint32_t> m_firstFragment;      // Offset of each pixel's fragments, plus the total.
+    std::vector<Fragment> m_fragments;
+};
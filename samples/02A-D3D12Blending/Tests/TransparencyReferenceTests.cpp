@@ -0,0 +1,152 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TransparencyReference.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    typedef TransparencyReference::Mode Mode;
+
+    const float c_background[3] = { 0.33f, 0.33f, 0.33f };
+
+    TransparentQuad GetQuad(const TransparentVertex (&vertices)[4], float alpha)
+    {
+        TransparentQuad quad = {};
+        for (int i = 0; i < 4; ++i)
+        {
+            quad.vertices[i] = vertices[i];
+        }
+        quad.color[0] = quad.color[1] = quad.color[2] = 1.0f;
+        quad.color[3] = alpha;
+        return quad;
+    }
+
+    // Each pixel is covered once by a quad over the whole image, and once by two quads
+    // sharing an edge.
+    void TestFillRule()
+    {
+        TransparencyReference reference(16, 16);
+
+        const TransparentQuad full = GetQuad({ { 0, 0, 1 }, { 16, 0, 1 }, { 16, 16, 1 }, { 0, 16, 1 } }, 0.5f);
+        reference.Render(Mode::SortedBlending, &full, 1, c_background);
+        CHECK(reference.GetFragmentCount() == 256);
+
+        const TransparentQuad halves[2] =
+        {
+            GetQuad({ { 0, 0, 1 }, { 8.3f, 0, 1 }, { 8.3f, 16, 1 }, { 0, 16, 1 } }, 0.5f),
+            GetQuad({ { 8.3f, 0, 1 }, { 16, 0, 1 }, { 16, 16, 1 }, { 8.3f, 16, 1 } }, 0.5f)
+        };
+        reference.Render(Mode::SortedBlending, halves, 2, c_background);
+        CHECK(reference.GetFragmentCount() == 256);
+        for (float value : reference.GetImage())
+        {
+            CHECK(std::fabs(value - (0.5f + 0.5f * c_background[0])) < 1e-5f);
+        }
+
+        CHECK_THROWS(TransparencyReference(0, 16));
+    }
+
+    // With a single layer, every mode gives the same image.
+    void TestSingleLayer()
+    {
+        TransparencyReference reference(16, 16);
+        const TransparentQuad quad = GetQuad({ { 3.3f, 2.1f, 1 }, { 12.7f, 4.5f, 2 }, { 10.2f, 13.9f, 3 }, { 1.5f, 9.9f, 2 } }, 0.5f);
+
+        reference.Render(Mode::PerPixelSorted, &quad, 1, c_background);
+        const std::vector<float> exact = reference.GetImage();
+        for (Mode mode : { Mode::SortedBlending, Mode::WeightedBlended })
+        {
+            reference.Render(mode, &quad, 1, c_background);
+            CHECK(TransparencyReference::Compare(reference.GetImage(), exact).maxAbsolute < 1e-5f);
+        }
+    }
+
+    // Overlapping quads at random depths: sorting the draws makes blending much closer to
+    // the exact image, and the weighted blended image doesn't depend on the draw order.
+    void TestModes()
+    {
+        const uint32_t width = 320;
+        const uint32_t height = 180;
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<TransparentQuad> quads(1000);
+        for (auto& quad : quads)
+        {
+            const float x = unit(random) * width;
+            const float y = unit(random) * height;
+            const float size = 5.0f + unit(random) * 20.0f;
+            const float z = 5.0f + unit(random) * 45.0f;
+            const float tilt = (unit(random) - 0.5f) * 0.5f * z;
+            const float angle = unit(random) * 6.283f;
+            const float c = std::cos(angle) * size;
+            const float s = std::sin(angle) * size;
+            quad.vertices[0] = { x - c, y - s, z - tilt };
+            quad.vertices[1] = { x + s, y - c, z };
+            quad.vertices[2] = { x + c, y + s, z + tilt };
+            quad.vertices[3] = { x - s, y + c, z };
+            for (int i = 0; i < 3; ++i)
+            {
+                quad.color[i] = unit(random);
+            }
+            quad.color[3] = 0.2f + 0.5f * unit(random);
+        }
+
+        TransparencyReference reference(width, height);
+        reference.Render(Mode::PerPixelSorted, quads.data(), 1000, c_background);
+        const std::vector<float> exact = reference.GetImage();
+        CHECK(reference.GetFragmentCount() > 2 * width * height);
+
+        reference.Render(Mode::SortedBlending, quads.data(), 1000, c_background);
+        const TransparencyReference::ImageError unsortedError = TransparencyReference::Compare(reference.GetImage(), exact);
+
+        std::vector<TransparentQuad> sortedQuads = quads;
+        TransparencyReference::SortBackToFront(sortedQuads);
+        reference.Render(Mode::SortedBlending, sortedQuads.data(), 1000, c_background);
+        const TransparencyReference::ImageError sortedError = TransparencyReference::Compare(reference.GetImage(), exact);
+        CHECK(sortedError.meanAbsolute < 0.25 * unsortedError.meanAbsolute);
+
+        reference.Render(Mode::WeightedBlended, quads.data(), 1000, c_background);
+        const std::vector<float> weighted = reference.GetImage();
+        CHECK(TransparencyReference::Compare(weighted, exact).meanAbsolute < unsortedError.meanAbsolute);
+        reference.Render(Mode::WeightedBlended, sortedQuads.data(), 1000, c_background);
+        CHECK(TransparencyReference::Compare(reference.GetImage(), weighted).maxAbsolute < 1e-4f);
+    }
+
+    // The weight favors near fragments and stays in the range of the shader's clamp.
+    void TestOitWeight()
+    {
+        float previous = GetOitWeight(0.0f, 1.0f);
+        CHECK(previous == 3e3f);
+        for (float z = 1.0f; z < 1000.0f; z *= 1.5f)
+        {
+            const float weight = GetOitWeight(z, 1.0f);
+            CHECK(weight <= previous && weight >= 1e-2f);
+            CHECK(GetOitWeight(-z, 1.0f) == weight);
+            CHECK(std::fabs(GetOitWeight(z, 0.25f) - 0.25f * weight) <= 1e-6f * weight);
+            previous = weight;
+        }
+    }
+}
+
+int main()
+{
+    TestFillRule();
+    TestSingleLayer();
+    TestModes();
+    TestOitWeight();
+    return 0;
+}
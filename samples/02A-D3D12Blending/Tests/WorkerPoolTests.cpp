@@ -0,0 +1,90 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "WorkerPool.h"
+#include "TestCheck.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Every item runs exactly once, job after job, whatever the number of threads.
+    void TestRunsEveryItem()
+    {
+        for (unsigned int threadCount : { 1u, 2u, 4u, 8u })
+        {
+            WorkerPool pool(threadCount);
+            CHECK(pool.GetThreadCount() == threadCount);
+
+            for (uint32_t count : { 0u, 1u, 3u, 100u, 10000u })
+            {
+                std::vector<std::atomic<uint32_t>> runs(count);
+                for (auto& run : runs)
+                {
+                    run = 0;
+                }
+                pool.Run(count, [&](uint32_t i) { ++runs[i]; });
+                for (auto& run : runs)
+                {
+                    CHECK(run == 1);
+                }
+            }
+        }
+
+        WorkerPool defaultPool;
+        CHECK(defaultPool.GetThreadCount() >= 1);
+    }
+
+    // The first exception is rethrown by Run(), the remaining items are skipped, and the
+    // pool still runs the next job.
+    void TestException()
+    {
+        WorkerPool pool(4);
+        std::atomic<uint32_t> runCount(0);
+        std::atomic<bool> thrown(false);
+        CHECK_THROWS(pool.Run(100000, [&](uint32_t i)
+        {
+            ++runCount;
+            if (i == 10)
+            {
+                thrown = true;
+                throw std::runtime_error("item 10");
+            }
+
+            // The items after it take long enough for the pool to see the exception
+            // before they run out, however the threads are scheduled.
+            if (i > 10)
+            {
+                while (!thrown)
+                {
+                    std::this_thread::yield();
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }));
+        CHECK(runCount < 1000);
+
+        runCount = 0;
+        pool.Run(1000, [&](uint32_t) { ++runCount; });
+        CHECK(runCount == 1000);
+    }
+}
+
+int main()
+{
+    TestRunsEveryItem();
+    TestException();
+    return 0;
+}
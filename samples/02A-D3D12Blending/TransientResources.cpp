@@ -0,0 +1,188 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Only the C++ standard library is used here, so stdafx.h isn't included.
+#include "TransientResources.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TransientResourcePlanner::TransientResourcePlanner() :
+    m_passCount(0),
+    m_heapSize(0),
+    m_unaliasedSize(0),
+    m_peakLiveSize(0)
+{
+}
+
+uint32_t TransientResourcePlanner::AddResource(uint64_t size, uint64_t alignment)
+{
+    if (size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::runtime_error("TransientResourcePlanner: the resources must not be empty, and their alignment must be a power of two");
+    }
+
+    m_resources.push_back(Resource{ size, alignment, 0, NoPass, NoPass });
+    return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t TransientResourcePlanner::AddPass()
+{
+    return m_passCount++;
+}
+
+void TransientResourcePlanner::UseResource(uint32_t pass, uint32_t resource)
+{
+    if (pass >= m_passCount || resource >= m_resources.size())
+    {
+        throw std::runtime_error("TransientResourcePlanner: unknown pass or resource");
+    }
+
+    Resource& r = m_resources[resource];
+    r.firstPass = (r.firstPass == NoPass) ? pass : (std::min)(r.firstPass, pass);
+    r.lastPass = (r.lastPass == NoPass) ? pass : (std::max)(r.lastPass, pass);
+}
+
+void TransientResourcePlanner::Plan()
+{
+    m_heapSize = 0;
+    m_unaliasedSize = 0;
+    m_peakLiveSize = 0;
+    m_aliasingBarriers.clear();
+
+    const uint32_t resourceCount = GetResourceCount();
+    for (uint32_t i = 0; i < resourceCount; ++i)
+    {
+        if (m_resources[i].firstPass == NoPass)
+        {
+            throw std::runtime_error("TransientResourcePlanner: a resource isn't used by any pass");
+        }
+        m_unaliasedSize += m_resources[i].size;
+    }
+
+    for (uint32_t pass = 0; pass < m_passCount; ++pass)
+    {
+        uint64_t liveSize = 0;
+        for (const Resource& r : m_resources)
+        {
+            liveSize += (r.firstPass <= pass && pass <= r.lastPass) ? r.size : 0;
+        }
+        m_peakLiveSize = (std::max)(m_peakLiveSize, liveSize);
+    }
+
+    // Greedy by size: the largest resources are placed first, each at the lowest offset
+    // where it doesn't overlap the placed resources that live at the same time.
+    std::vector<uint32_t> order(resourceCount);
+    for (uint32_t i = 0; i < resourceCount; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+    {
+        const Resource& ra = m_resources[a];
+        const Resource& rb = m_resources[b];
+        if (ra.size != rb.size)
+        {
+            return ra.size > rb.size;
+        }
+        return ra.firstPass != rb.firstPass ? ra.firstPass < rb.firstPass : a < b;
+    });
+
+    std::vector<std::pair<uint64_t, uint64_t>> occupied;
+    for (uint32_t placed = 0; placed < resourceCount; ++placed)
+    {
+        Resource& r = m_resources[order[placed]];
+
+        occupied.clear();
+        for (uint32_t i = 0; i < placed; ++i)
+        {
+            if (AreLifetimesOverlapping(order[i], order[placed]))
+            {
+                const Resource& other = m_resources[order[i]];
+                occupied.push_back(std::make_pair(other.offset, other.offset + other.size));
+            }
+        }
+        std::sort(occupied.begin(), occupied.end());
+
+        uint64_t offset = 0;
+        for (const auto& range : occupied)
+        {
+            if (offset + r.size <= range.first)
+            {
+                break;
+            }
+            if (range.second > offset)
+            {
+                offset = AlignUp(range.second, r.alignment);
+            }
+        }
+        r.offset = offset;
+        m_heapSize = (std::max)(m_heapSize, offset + r.size);
+    }
+
+    // The resources that overlap in memory never live at the same time: each takes the
+    // memory over from the others at its first pass.
+    for (uint32_t i = 0; i < resourceCount; ++i)
+    {
+        uint32_t previousCount = 0;
+        uint32_t previous = AnyResource;
+        for (uint32_t j = 0; j < resourceCount; ++j)
+        {
+            if (j != i && AreRangesOverlapping(i, j))
+            {
+                ++previousCount;
+                previous = j;
+            }
+        }
+        if (previousCount > 0)
+        {
+            m_aliasingBarriers.push_back(AliasingBarrier{ m_resources[i].firstPass, previousCount == 1 ? previous : AnyResource, i });
+        }
+    }
+    std::stable_sort(m_aliasingBarriers.begin(), m_aliasingBarriers.end(), [](const AliasingBarrier& a, const AliasingBarrier& b)
+    {
+        return a.pass < b.pass;
+    });
+}
+
+std::string TransientResourcePlanner::FormatStats() const
+{
+    char text[256];
+    snprintf(text, sizeof(text), "Transient resources: %u in a %llu KB heap (peak live %llu KB, %llu KB unaliased, %llu KB saved), %u aliasing barriers\n",
+        GetResourceCount(), static_cast<unsigned long long>(m_heapSize / 1024), static_cast<unsigned long long>(m_peakLiveSize / 1024),
+        static_cast<unsigned long long>(m_unaliasedSize / 1024), static_cast<unsigned long long>(GetSavedBytes() / 1024),
+        static_cast<unsigned int>(m_aliasingBarriers.size()));
+    return text;
+}
+
+bool TransientResourcePlanner::AreLifetimesOverlapping(uint32_t a, uint32_t b) const
+{
+    const Resource& ra = m_resources[a];
+    const Resource& rb = m_resources[b];
+    return ra.firstPass <= rb.lastPass && rb.firstPass <= ra.lastPass;
+}
+
+bool TransientResourcePlanner::AreRangesOverlapping(uint32_t a, uint32_t b) const
+{
+    const Resource& ra = m_resources[a];
+    const Resource& rb = m_resources[b];
+    return ra.offset < rb.offset + rb.size && rb.offset < ra.offset + ra.size;
+}
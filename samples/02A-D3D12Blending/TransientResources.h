@@ -0,0 +1,91 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Places the transient resources of a frame in one heap, from the passes that use them.
+// A resource lives from the first pass that uses it to the last one, and the resources
+// whose lifetimes don't overlap can share memory.
+// Memory that changes hands needs an aliasing barrier at the first pass of the resource
+// that takes it over, and that resource must be fully written (cleared, discarded or
+// copied to) before it's read. The frames repeat, so the resources of the last passes
+// hand their memory back to those of the first passes of the next frame.
+class TransientResourcePlanner
+{
+public:
+    static const uint32_t AnyResource = 0xffffffff;
+
+    struct AliasingBarrier
+    {
+        uint32_t pass;
+        uint32_t resourceBefore;    // AnyResource when several resources gave it memory.
+        uint32_t resourceAfter;
+    };
+
+    TransientResourcePlanner();
+
+    // The resources and the passes are numbered in the order they are added. The
+    // alignment must be a power of two.
+    uint32_t AddResource(uint64_t size, uint64_t alignment);
+    uint32_t AddPass();
+    void UseResource(uint32_t pass, uint32_t resource);
+
+    // Computes the lifetimes and the places of the resources, and the aliasing barriers.
+    // Every resource must be used by a pass.
+    void Plan();
+
+    uint32_t GetResourceCount() const                   { return static_cast<uint32_t>(m_resources.size()); }
+    uint32_t GetPassCount() const                       { return m_passCount; }
+    uint64_t GetOffset(uint32_t resource) const         { return m_resources[resource].offset; }
+    uint32_t GetFirstPass(uint32_t resource) const      { return m_resources[resource].firstPass; }
+    uint32_t GetLastPass(uint32_t resource) const       { return m_resources[resource].lastPass; }
+
+    // Size of the heap, against the sum of the sizes of the resources, which separate
+    // allocations would take. The padding of the placements can make the heap larger,
+    // in which case nothing is saved. The peak live size is the most memory in use by a
+    // pass, which no placement can go under.
+    uint64_t GetHeapSize() const                        { return m_heapSize; }
+    uint64_t GetUnaliasedSize() const                   { return m_unaliasedSize; }
+    uint64_t GetSavedBytes() const                      { return m_heapSize < m_unaliasedSize ? m_unaliasedSize - m_heapSize : 0; }
+    uint64_t GetPeakLiveSize() const                    { return m_peakLiveSize; }
+
+    // One line with the sizes above, for the debug output.
+    std::string FormatStats() const;
+
+    // Sorted by pass.
+    const std::vector<AliasingBarrier>& GetAliasingBarriers() const { return m_aliasingBarriers; }
+
+private:
+    static const uint32_t NoPass = 0xffffffff;
+
+    struct Resource
+    {
+        uint64_t size;
+        uint64_t alignment;
+        uint64_t offset;
+        uint32_t firstPass;
+        uint32_t lastPass;
+    };
+
+    bool AreLifetimesOverlapping(uint32_t a, uint32_t b) const;
+    bool AreRangesOverlapping(uint32_t a, uint32_t b) const;
+
+    std::vector<Resource> m_resources;
+    uint32_t m_passCount;
+    uint64_t m_heapSize;
+    uint64_t m_unaliasedSize;
+    uint64_t m_peakLiveSize;
+    std::vector<AliasingBarrier> m_aliasingBarriers;
+};
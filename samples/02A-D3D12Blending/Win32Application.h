@@ -25,5 +25,7 @@ protected:
     static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
 private:
+    static void RenderBenchmarkFrame(DXSample* pSample);
+
     static HWND m_hwnd;
 };
@@ -0,0 +1,137 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <utility>
+
+WorkerPool::WorkerPool(unsigned int threadCount) :
+    m_generation(0),
+    m_busyWorkers(0),
+    m_stopping(false),
+    m_pJob(nullptr),
+    m_jobSize(0),
+    m_nextItem(0)
+{
+    if (threadCount == 0)
+    {
+        threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+    }
+
+    // The calling thread is one of the workers.
+    m_workers.reserve(threadCount - 1);
+    for (unsigned int i = 1; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&WorkerPool::WorkerThread, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workReady.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::Run(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+    if (m_workers.empty() || count <= 1)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pJob = &func;
+        m_jobSize = count;
+        m_nextItem = 0;
+        m_error = nullptr;
+        m_busyWorkers = static_cast<uint32_t>(m_workers.size());
+        ++m_generation;
+    }
+    m_workReady.notify_all();
+
+    RunItems();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+        m_pJob = nullptr;
+        std::swap(error, m_error);
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::RunItems()
+{
+    try
+    {
+        for (uint32_t i = m_nextItem++; i < m_jobSize; i = m_nextItem++)
+        {
+            (*m_pJob)(i);
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error)
+        {
+            m_error = std::current_exception();
+        }
+
+        // The other threads stop after their current item.
+        m_nextItem = m_jobSize;
+    }
+}
+
+void WorkerPool::WorkerThread()
+{
+    uint64_t generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workReady.wait(lock, [&] { return m_stopping || m_generation != generation; });
+            if (m_stopping)
+            {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        RunItems();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busyWorkers == 0)
+            {
+                m_workDone.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads started once and woken up for each Run() call, which hands out the items of a
+// job to them and to the calling thread. Run() must be called from one thread at a time.
+class WorkerPool
+{
+public:
+    // A threadCount of zero uses std::thread::hardware_concurrency(). The thread calling
+    // Run() is one of the threadCount threads.
+    explicit WorkerPool(unsigned int threadCount = 0);
+    ~WorkerPool();
+
+    unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_workers.size() + 1); }
+
+    // Runs func(0) ... func(count - 1) on the worker threads and the calling thread, and
+    // rethrows the first exception thrown by func.
+    void Run(uint32_t count, const std::function<void(uint32_t)>& func);
+
+private:
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void RunItems();
+    void WorkerThread();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workReady;
+    std::condition_variable m_workDone;
+    uint64_t m_generation;
+    uint32_t m_busyWorkers;
+    bool m_stopping;
+    const std::function<void(uint32_t)>* m_pJob;
+    uint32_t m_jobSize;
+    std::atomic<uint32_t> m_nextItem;
+    std::exception_ptr m_error;
+};
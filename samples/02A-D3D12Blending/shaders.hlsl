@@ -20,11 +20,16 @@ cbuffer ConstantBuffer : register(b0)
 	float4 outputColor;
 }
 
+// Weighted blended OIT targets, read by the composite pass
+Texture2D<float4> oitAccumulation : register(t0);
+Texture2D<float> oitRevealage : register(t1);
+
 //--------------------------------------------------------------------------------------
 struct PSInput
 {
 	float4 position : SV_POSITION;
 	float4 color : COLOR;
+	float viewDepth : TEXCOORD0;
 };
 
 
@@ -36,6 +41,7 @@ PSInput VSMain(float4 position : POSITION, float4 color : COLOR)
 	PSInput output = (PSInput) 0;
 	output.position = mul(position, World);
 	output.position = mul(output.position, View);
+	output.viewDepth = output.position.z;
 	output.position = mul(output.position, Projection);
 	output.color = color;
     
@@ -59,4 +65,72 @@ float4 PSMain(PSInput input) : SV_TARGET
 float4 SolidColorPS(PSInput input) : SV_Target
 {
 	return outputColor;
+}
+
+//--------------------------------------------------------------------------------------
+// Name: OitWeight
+// Desc: Weight of a transparent fragment in the weighted blended OIT (equation 7 of
+//       McGuire and Bavoil); GetOitWeight() in Tests/TransparencyReference.cpp matches it
+//--------------------------------------------------------------------------------------
+float OitWeight(float viewDepth, float alpha)
+{
+	float z = abs(viewDepth);
+	return alpha * clamp(10.0f / (1e-5f + pow(z / 5.0f, 2.0f) + pow(z / 200.0f, 6.0f)), 1e-2f, 3e3f);
+}
+
+struct OitOutput
+{
+	float4 accumulation : SV_Target0;
+	float revealage : SV_Target1;
+};
+
+//--------------------------------------------------------------------------------------
+// Name: WeightedBlendPS
+// Desc: Accumulates the weighted, premultiplied solid color, and the alpha that the
+//       revealage target is multiplied by
+//--------------------------------------------------------------------------------------
+OitOutput WeightedBlendPS(PSInput input)
+{
+	OitOutput output;
+	float weight = OitWeight(input.viewDepth, outputColor.a);
+	output.accumulation = float4(outputColor.rgb * outputColor.a, outputColor.a) * weight;
+	output.revealage = outputColor.a;
+	return output;
+}
+
+//--------------------------------------------------------------------------------------
+// Name: CompositeVS
+// Desc: Full-screen triangle generated from the vertex IDs 0, 1 and 2
+//--------------------------------------------------------------------------------------
+float4 CompositeVS(uint vertexId : SV_VertexID) : SV_POSITION
+{
+	float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+	return float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+}
+
+//--------------------------------------------------------------------------------------
+// Name: CompositePS
+// Desc: Weighted average color of the transparent fragments, with the coverage
+//       1 - revealage as alpha
+//--------------------------------------------------------------------------------------
+float4 CompositePS(float4 position : SV_POSITION) : SV_Target
+{
+	int3 pixel = int3(position.xy, 0);
+	float revealage = oitRevealage.Load(pixel);
+	if (revealage == 1.0f)
+	{
+		// No transparent fragment
+		discard;
+	}
+
+	float4 accumulation = oitAccumulation.Load(pixel);
+
+	// Keep the average finite when the 16-bit accumulation overflows.
+	if (isinf(max(abs(accumulation.r), max(abs(accumulation.g), abs(accumulation.b)))))
+	{
+		accumulation.rgb = accumulation.aaa;
+	}
+
+	float3 averageColor = accumulation.rgb / max(accumulation.a, 1e-5f);
+	return float4(averageColor, 1.0f - revealage);
 }
\ No newline at end of file
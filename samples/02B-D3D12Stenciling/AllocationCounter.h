@@ -0,0 +1,32 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Debug hook that counts the heap allocations of each thread, to check that the
+// steady-state frames don't make any.
+// The debug builds replace the global operator new and delete to count the calls;
+// malloc() and the other CRT functions called directly aren't seen. Define
+// ALLOCATION_COUNTER_DISABLED to keep the default operators.
+#if defined(_DEBUG) && !defined(ALLOCATION_COUNTER_DISABLED)
+#define ALLOCATION_COUNTER_ENABLED 1
+#endif
+
+namespace AllocationCounter
+{
+    // False when the operators aren't replaced; the counts then stay at 0.
+    bool IsEnabled();
+
+    // Calls to operator new made by the calling thread since it started.
+    uint64_t GetThreadAllocationCount();
+}
@@ -0,0 +1,274 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    // Fixed notation, independent of the stream's formatting flags.
+    void WriteNumber(std::ostream& stream, double value)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.4f", value);
+        stream << text;
+    }
+
+    void WriteStatistics(std::ostream& stream, const FrameTimeStatistics& stats)
+    {
+        stream << "{\"mean\":";
+        WriteNumber(stream, stats.meanMs);
+        stream << ",\"min\":";
+        WriteNumber(stream, stats.minMs);
+        stream << ",\"p50\":";
+        WriteNumber(stream, stats.p50Ms);
+        stream << ",\"p95\":";
+        WriteNumber(stream, stats.p95Ms);
+        stream << ",\"p99\":";
+        WriteNumber(stream, stats.p99Ms);
+        stream << ",\"max\":";
+        WriteNumber(stream, stats.maxMs);
+        stream << '}';
+    }
+}
+
+void WriteJsonString(std::ostream& stream, const char* text)
+{
+    stream << '"';
+    for (const char* c = text; *c != '\0'; ++c)
+    {
+        const unsigned char ch = static_cast<unsigned char>(*c);
+        if (ch == '"' || ch == '\\')
+        {
+            stream << '\\' << *c;
+        }
+        else if (ch < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+            stream << escaped;
+        }
+        else
+        {
+            stream << *c;
+        }
+    }
+    stream << '"';
+}
+
+Benchmark::Benchmark() :
+    m_pRenderStats(nullptr),
+    m_frameIndex(0),
+    m_frameStart(0),
+    m_lastFrameEnd(0),
+    m_lastRenderStatsFrame(0)
+{
+}
+
+void Benchmark::Configure(const BenchmarkSettings& settings)
+{
+    m_settings = settings;
+    m_frameIndex = 0;
+    m_frameTimes.clear();
+    m_phases.clear();
+    m_counters.clear();
+
+    // Nothing is allocated while the frames are measured.
+    m_frameTimes.reserve(settings.frameCount);
+    m_counters.reserve(settings.frameCount);
+}
+
+void Benchmark::BeginFrame()
+{
+    m_frameStart = GetNanoseconds();
+}
+
+void Benchmark::EndFrame()
+{
+    const uint64_t now = GetNanoseconds();
+
+    if (IsMeasuring())
+    {
+        // The first measured frame has no previous one when there is no warm-up.
+        m_frameTimes.push_back(now - (m_lastFrameEnd != 0 ? m_lastFrameEnd : m_frameStart));
+
+        for (Phase& phase : m_phases)
+        {
+            phase.nanoseconds.push_back(phase.currentNanoseconds);
+            phase.currentNanoseconds = 0;
+        }
+
+        RenderFrameStats counters = {};
+        if (m_pRenderStats != nullptr && m_pRenderStats->GetFrameCount() != m_lastRenderStatsFrame)
+        {
+            counters = m_pRenderStats->GetLastFrame();
+        }
+        m_counters.push_back(counters);
+    }
+
+    if (m_pRenderStats != nullptr)
+    {
+        m_lastRenderStatsFrame = m_pRenderStats->GetFrameCount();
+    }
+    m_lastFrameEnd = now;
+    ++m_frameIndex;
+}
+
+void Benchmark::AddPhaseTime(const char* name, uint64_t nanoseconds)
+{
+    // There are only a few phases, and they are almost always found on the first
+    // comparison of the name pointers.
+    for (Phase& phase : m_phases)
+    {
+        if (phase.name == name || strcmp(phase.name, name) == 0)
+        {
+            phase.currentNanoseconds += nanoseconds;
+            return;
+        }
+    }
+
+    // Frames measured before the phase first ran spent no time in it.
+    Phase phase = { name, nanoseconds, std::vector<uint64_t>(m_frameTimes.size(), 0) };
+    phase.nanoseconds.reserve(m_settings.frameCount);
+    m_phases.push_back(std::move(phase));
+}
+
+FrameTimeStatistics Benchmark::GetFrameTimeStatistics() const
+{
+    return Summarize(m_frameTimes);
+}
+
+FrameTimeStatistics Benchmark::Summarize(std::vector<uint64_t> nanoseconds)
+{
+    FrameTimeStatistics stats = {};
+    stats.frameCount = nanoseconds.size();
+    if (nanoseconds.empty())
+    {
+        return stats;
+    }
+
+    double total = 0.0;
+    for (uint64_t value : nanoseconds)
+    {
+        total += static_cast<double>(value);
+    }
+    std::sort(nanoseconds.begin(), nanoseconds.end());
+
+    auto percentile = [&nanoseconds](double p)
+    {
+        const size_t rank = static_cast<size_t>(p * (nanoseconds.size() - 1) + 0.5);
+        return nanoseconds[rank] / 1e6;
+    };
+
+    stats.meanMs = total / nanoseconds.size() / 1e6;
+    stats.minMs = nanoseconds.front() / 1e6;
+    stats.p50Ms = percentile(0.50);
+    stats.p95Ms = percentile(0.95);
+    stats.p99Ms = percentile(0.99);
+    stats.maxMs = nanoseconds.back() / 1e6;
+    return stats;
+}
+
+void Benchmark::WriteCsv(std::ostream& stream) const
+{
+    stream << "frame,frame_ms";
+    for (const Phase& phase : m_phases)
+    {
+        stream << ',' << phase.name << "_ms";
+    }
+    for (uint32_t i = 0; i < RenderStats::CounterCount; ++i)
+    {
+        stream << ',' << RenderStats::GetCounterName(static_cast<RenderCounter>(i));
+    }
+    stream << '\n';
+
+    for (size_t frame = 0; frame < m_frameTimes.size(); ++frame)
+    {
+        stream << frame << ',';
+        WriteNumber(stream, m_frameTimes[frame] / 1e6);
+        for (const Phase& phase : m_phases)
+        {
+            stream << ',';
+            WriteNumber(stream, phase.nanoseconds[frame] / 1e6);
+        }
+        for (uint32_t i = 0; i < RenderStats::CounterCount; ++i)
+        {
+            stream << ',' << m_counters[frame].counters[i];
+        }
+        stream << '\n';
+    }
+}
+
+void Benchmark::WriteJson(std::ostream& stream, const std::string& sampleName, uint32_t sceneScale) const
+{
+    stream << "{\n\"sample\":";
+    WriteJsonString(stream, sampleName.c_str());
+    stream << ",\n\"frames\":" << m_frameTimes.size();
+    stream << ",\n\"warmupFrames\":" << m_settings.warmupFrameCount;
+    stream << ",\n\"headless\":" << (m_settings.headless ? "true" : "false");
+    stream << ",\n\"sceneScale\":" << sceneScale;
+
+    stream << ",\n\"frameTimeMs\":";
+    WriteStatistics(stream, GetFrameTimeStatistics());
+
+    // CPU time spent in each phase per frame.
+    stream << ",\n\"phasesMs\":{";
+    for (size_t i = 0; i < m_phases.size(); ++i)
+    {
+        stream << (i == 0 ? "\n" : ",\n");
+        WriteJsonString(stream, m_phases[i].name);
+        stream << ':';
+        WriteStatistics(stream, Summarize(m_phases[i].nanoseconds));
+    }
+    stream << "\n}";
+
+    stream << ",\n\"counters\":{";
+    for (uint32_t i = 0; i < RenderStats::CounterCount; ++i)
+    {
+        uint64_t minimum = m_counters.empty() ? 0 : UINT64_MAX;
+        uint64_t maximum = 0;
+        uint64_t total = 0;
+        for (const RenderFrameStats& frame : m_counters)
+        {
+            minimum = (std::min)(minimum, frame.counters[i]);
+            maximum = (std::max)(maximum, frame.counters[i]);
+            total += frame.counters[i];
+        }
+
+        stream << (i == 0 ? "\n" : ",\n");
+        WriteJsonString(stream, RenderStats::GetCounterName(static_cast<RenderCounter>(i)));
+        stream << ":{\"min\":" << minimum << ",\"mean\":";
+        WriteNumber(stream, m_counters.empty() ? 0.0 : static_cast<double>(total) / m_counters.size());
+        stream << ",\"max\":" << maximum << ",\"total\":" << total << '}';
+    }
+    stream << "\n}\n}\n";
+}
+
+std::string Benchmark::FormatSummary() const
+{
+    const FrameTimeStatistics stats = GetFrameTimeStatistics();
+
+    char line[160];
+    snprintf(line, sizeof(line), "Benchmark: %llu frames, frame time mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        static_cast<unsigned long long>(stats.frameCount), stats.meanMs, stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.maxMs);
+    std::string text = line;
+
+    for (const Phase& phase : m_phases)
+    {
+        const FrameTimeStatistics phaseStats = Summarize(phase.nanoseconds);
+        snprintf(line, sizeof(line), "  %-26s mean %.3f ms, p95 %.3f ms\n", phase.name, phaseStats.meanMs, phaseStats.p95Ms);
+        text += line;
+    }
+    return text;
+}
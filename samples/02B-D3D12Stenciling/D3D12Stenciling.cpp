@@ -12,17 +12,103 @@
 #include "stdafx.h"
 #include "D3D12Stenciling.h"
 
+namespace
+{
+    // Corners of the mirror (vertices 38-41).
+    const float c_mirrorCorners[4][3] =
+    {
+        { -2.5f, 0.0f, 0.0f },
+        { -2.5f, 4.0f, 0.0f },
+        { 2.5f, 4.0f, 0.0f },
+        { 2.5f, 0.0f, 0.0f }
+    };
+
+    // Bounding spheres of the geometry, for culling.
+    const float c_cubeBoundingRadius = 1.7320508f;
+    const ShadowSphere c_floorBounds = { { 2.0f, 0.0f, -5.0f }, 7.45f };
+    const ShadowSphere c_wallBounds = { { 2.0f, 3.0f, 0.0f }, 6.3f };
+
+    // Depth range of the camera, also spanned by the depth buckets of the draws.
+    const float c_nearPlane = 0.01f;
+    const float c_farPlane = 100.0f;
+
+    // Every draw uses the single vertex and index buffer of the sample.
+    const uint32_t c_sceneGeometry = 0;
+
+    // Sets the state the draw queue asks for on the command list.
+    class CommandListDrawSink
+    {
+    public:
+        CommandListDrawSink(StatsCommandList& commandList, ID3D12PipelineState* const* ppPipelineStates,
+            const D3D12_VERTEX_BUFFER_VIEW& vertexBufferView, const D3D12_INDEX_BUFFER_VIEW& indexBufferView) :
+            m_commandList(commandList),
+            m_ppPipelineStates(ppPipelineStates),
+            m_vertexBufferView(vertexBufferView),
+            m_indexBufferView(indexBufferView)
+        {
+        }
+
+        void SetPipeline(uint32_t pipeline)
+        {
+            m_commandList->SetPipelineState(m_ppPipelineStates[pipeline]);
+        }
+
+        // The binding of the shadow passes is their cascade index.
+        void SetBinding(uint32_t binding)
+        {
+            m_commandList->SetGraphicsRoot32BitConstant(2, binding, 0);
+        }
+
+        void SetGeometry(uint32_t)
+        {
+            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+            m_commandList->IASetIndexBuffer(&m_indexBufferView);
+        }
+
+        void SetConstantBuffer(uint64_t gpuAddress)
+        {
+            m_commandList->SetGraphicsRootConstantBufferView(0, gpuAddress);
+        }
+
+        void Draw(const DrawPacket& packet)
+        {
+            m_commandList->DrawIndexedInstanced(packet.indexCount, 1, packet.startIndex, packet.baseVertex, 0);
+        }
+
+    private:
+        StatsCommandList& m_commandList;
+        ID3D12PipelineState* const* m_ppPipelineStates;
+        const D3D12_VERTEX_BUFFER_VIEW& m_vertexBufferView;
+        const D3D12_INDEX_BUFFER_VIEW& m_indexBufferView;
+    };
+}
 
 D3D12Stenciling::D3D12Stenciling(UINT width, UINT height, std::wstring name) :
     DXSample(width, height, name),
     m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
     m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+    m_commandList(m_renderStats),
+    m_pipelineStates{},
+    m_frameArena(FrameCount, c_frameArenaSize),
+    m_drawQueue(m_frameArena),
     m_constantDataGpuAddr(0),
     m_mappedConstantData(nullptr),
+    m_mappedFrameConstants(nullptr),
+    m_mappedPassConstants(nullptr),
     m_rtvDescriptorSize(0),
+    m_dsvDescriptorSize(0),
+    m_srvDescriptorSize(0),
+    m_sceneViewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
+    m_sceneScissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+    m_shadowViewport(0.0f, 0.0f, static_cast<float>(c_shadowMapResolution), static_cast<float>(c_shadowMapResolution)),
+    m_shadowScissorRect(0, 0, static_cast<LONG>(c_shadowMapResolution), static_cast<LONG>(c_shadowMapResolution)),
     m_frameIndex(0),
     m_fenceValues{},
-    m_curRotationAngleRad(0.0f)
+    m_curRotationAngleRad(0.0f),
+    m_numConstantBuffers(0),
+    m_mirrorVisible(false),
+    m_frameStartAllocationCount(0)
 {
     // Initialize the world matrix of the cube
     m_cubeWorldMatrix = XMMatrixIdentity();
@@ -34,7 +120,8 @@ D3D12Stenciling::D3D12Stenciling(UINT width, UINT height, std::wstring name) :
     m_viewMatrix = XMMatrixLookAtLH(c_eye, c_at, c_up);
 
     // Initialize the projection matrix
-    m_projectionMatrix = XMMatrixPerspectiveFovLH(XM_PIDIV4, width / (FLOAT)height, 0.01f, 100.0f);
+    m_projectionMatrix = XMMatrixPerspectiveFovLH(XM_PIDIV4, width / (FLOAT)height, c_nearPlane, c_farPlane);
+    m_reflectedProjectionMatrix = m_projectionMatrix;
 
     // Initialize the lighting parameters
     m_lightDir = XMVectorSet(-0.577f, 0.577f, -0.577f, 0.0f);
@@ -42,12 +129,24 @@ D3D12Stenciling::D3D12Stenciling(UINT width, UINT height, std::wstring name) :
 
     // Initialize the mesh output color
     m_outputColor = XMVectorSet(0, 0, 0, 0);
+
+    // Fit the shadow cascades to the part of the view frustum that holds the scene.
+    ShadowCascadeDesc shadowDesc;
+    shadowDesc.resolution = c_shadowMapResolution;
+    shadowDesc.shadowDistance = 30.0f;
+    m_shadowCascades.SetDesc(shadowDesc);
 }
 
 void D3D12Stenciling::OnInit()
 {
+    // Only profile when a trace has been requested on the command line.
+    Profiler::SetEnabled(!m_tracePath.empty());
+    Profiler::SetThreadName("Main thread");
+
     LoadPipeline();
     LoadAssets();
+
+    m_benchmark.SetRenderStats(&m_renderStats);
 }
 
 // Load the rendering pipeline dependencies.
@@ -103,6 +202,9 @@ void D3D12Stenciling::LoadPipeline()
 
     ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
 
+    // Time the passes recorded in the command list on the GPU.
+    m_gpuProfiler.Initialize(m_device.Get(), m_commandQueue.Get(), FrameCount, c_maxGpuProfileScopes, "GPU (direct queue)");
+
     // Describe and create the swap chain.
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
     swapChainDesc.BufferCount = FrameCount;
@@ -131,21 +233,33 @@ void D3D12Stenciling::LoadPipeline()
 
     // Create descriptor heaps.
     {
-        // Describe and create a render target view (RTV) descriptor heap.
+        // Describe and create a render target view (RTV) descriptor heap: the back buffers,
+        // then the scene target.
         D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-        rtvHeapDesc.NumDescriptors = FrameCount;
+        rtvHeapDesc.NumDescriptors = FrameCount + 1;
         rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
         rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
         ThrowIfFailed(m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
 
-        // Describe and create a depth stencil view (DSV) descriptor heap.
+        // Describe and create a depth stencil view (DSV) descriptor heap: the depth-stencil
+        // buffer, the cascades of the shadow map and the static shadow cache.
         D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-        dsvHeapDesc.NumDescriptors = 1;
+        dsvHeapDesc.NumDescriptors = 2 + ShadowCascades::MaxCascadeCount;
         dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
         dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
         ThrowIfFailed(m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
 
+        // Describe and create a shader resource view (SRV) heap for the shadow map and the
+        // scene target.
+        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
+        srvHeapDesc.NumDescriptors = 2;
+        srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+        ThrowIfFailed(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvHeap)));
+
         m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        m_dsvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+        m_srvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
     }
 
     // Create frame resources.
@@ -180,6 +294,78 @@ void D3D12Stenciling::LoadPipeline()
         depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
         m_device->CreateDepthStencilView(m_depthStencil.Get(), &depthStencilDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
     }
+
+    // Create the scene target, and its views. It has the size of the back buffers, and the
+    // scene is drawn in its top-left corner at the scale of the dynamic resolution, like in
+    // the depth-stencil buffer.
+    {
+        const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, m_width, m_height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET),
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+            &CD3DX12_CLEAR_VALUE(DXGI_FORMAT_R8G8B8A8_UNORM, clearColor),
+            IID_PPV_ARGS(&m_sceneColor)
+        ));
+
+        m_device->CreateRenderTargetView(m_sceneColor.Get(), nullptr, CD3DX12_CPU_DESCRIPTOR_HANDLE(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), FrameCount, m_rtvDescriptorSize));
+        m_device->CreateShaderResourceView(m_sceneColor.Get(), nullptr, CD3DX12_CPU_DESCRIPTOR_HANDLE(m_srvHeap->GetCPUDescriptorHandleForHeapStart(), 1, m_srvDescriptorSize));
+    }
+
+    CreateShadowMap();
+}
+
+// Create the cascades of the shadow map, the cache of the static casters and their views.
+void D3D12Stenciling::CreateShadowMap()
+{
+    const UINT cascadeCount = ShadowCascades::MaxCascadeCount;
+
+    // The cascades are sampled by the shaders between two shadow passes.
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_TYPELESS, c_shadowMapResolution, c_shadowMapResolution, cascadeCount, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+        &CD3DX12_CLEAR_VALUE(DXGI_FORMAT_D32_FLOAT, 1.0f, 0),
+        IID_PPV_ARGS(&m_shadowMap)
+    ));
+
+    // The cache is only ever copied to the cached cascade.
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_TYPELESS, c_shadowMapResolution, c_shadowMapResolution, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE),
+        D3D12_RESOURCE_STATE_COPY_SOURCE,
+        &CD3DX12_CLEAR_VALUE(DXGI_FORMAT_D32_FLOAT, 1.0f, 0),
+        IID_PPV_ARGS(&m_staticShadowCache)
+    ));
+
+    // One DSV per cascade, after the one of the depth-stencil buffer.
+    CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), 1, m_dsvDescriptorSize);
+    for (UINT i = 0; i < cascadeCount; ++i)
+    {
+        D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+        dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+        dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+        dsvDesc.Texture2DArray.FirstArraySlice = i;
+        dsvDesc.Texture2DArray.ArraySize = 1;
+        m_device->CreateDepthStencilView(m_shadowMap.Get(), &dsvDesc, dsvHandle);
+        dsvHandle.Offset(1, m_dsvDescriptorSize);
+    }
+
+    D3D12_DEPTH_STENCIL_VIEW_DESC cacheDsvDesc = {};
+    cacheDsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+    cacheDsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+    m_device->CreateDepthStencilView(m_staticShadowCache.Get(), &cacheDsvDesc, dsvHandle);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Texture2DArray.MipLevels = 1;
+    srvDesc.Texture2DArray.ArraySize = cascadeCount;
+    m_device->CreateShaderResourceView(m_shadowMap.Get(), &srvDesc, m_srvHeap->GetCPUDescriptorHandleForHeapStart());
 }
 
 // Load the sample assets.
@@ -195,10 +381,33 @@ void D3D12Stenciling::LoadAssets()
         featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
     }
 
-    // Create a root signature with one constant buffer view.
+    // Create a root signature with the constant buffer views of the objects, the frame and
+    // the pass, the cascade index of the shadow pass and the shadow map.
     {
-        CD3DX12_ROOT_PARAMETER1 rp[1] = {};
+        CD3DX12_DESCRIPTOR_RANGE1 ranges[1] = {};
+        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+        CD3DX12_ROOT_PARAMETER1 rp[5] = {};
         rp[0].InitAsConstantBufferView(0, 0);
+        rp[1].InitAsConstantBufferView(1, 0);
+        rp[2].InitAsConstants(1, 2, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        rp[3].InitAsDescriptorTable(_countof(ranges), ranges, D3D12_SHADER_VISIBILITY_PIXEL);
+        rp[4].InitAsConstantBufferView(3, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+
+        // Percentage-closer filtering of the shadow map; outside of it, everything is lit.
+        CD3DX12_STATIC_SAMPLER_DESC shadowSampler(
+            0,
+            D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT,
+            D3D12_TEXTURE_ADDRESS_MODE_BORDER,
+            D3D12_TEXTURE_ADDRESS_MODE_BORDER,
+            D3D12_TEXTURE_ADDRESS_MODE_BORDER,
+            0.0f,
+            1,
+            D3D12_COMPARISON_FUNC_LESS_EQUAL,
+            D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE,
+            0.0f,
+            0.0f,
+            D3D12_SHADER_VISIBILITY_PIXEL);
 
         // Allow input layout and deny uneccessary access to certain pipeline stages.
         D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
@@ -208,7 +417,7 @@ void D3D12Stenciling::LoadAssets()
             D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
-        rootSignatureDesc.Init_1_1(_countof(rp), rp, 0, nullptr, rootSignatureFlags);
+        rootSignatureDesc.Init_1_1(_countof(rp), rp, 1, &shadowSampler, rootSignatureFlags);
 
         ComPtr<ID3DBlob> signature;
         ComPtr<ID3DBlob> error;
@@ -216,10 +425,86 @@ void D3D12Stenciling::LoadAssets()
         ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
     }
 
+    // Create the root signature of the upscale pass, with the size of the drawn part of the
+    // scene target and the scene target.
+    {
+        CD3DX12_DESCRIPTOR_RANGE1 ranges[1] = {};
+        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+        CD3DX12_ROOT_PARAMETER1 rp[2] = {};
+        rp[0].InitAsConstants(4, 4, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+        rp[1].InitAsDescriptorTable(_countof(ranges), ranges, D3D12_SHADER_VISIBILITY_PIXEL);
+
+        CD3DX12_STATIC_SAMPLER_DESC linearSampler(
+            1,
+            D3D12_FILTER_MIN_MAG_MIP_LINEAR,
+            D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            0.0f,
+            1,
+            D3D12_COMPARISON_FUNC_ALWAYS,
+            D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK,
+            0.0f,
+            0.0f,
+            D3D12_SHADER_VISIBILITY_PIXEL);
+
+        // The triangle is made by the vertex shader, without an input layout.
+        D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
+        rootSignatureDesc.Init_1_1(_countof(rp), rp, 1, &linearSampler, rootSignatureFlags);
+
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> error;
+        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, featureData.HighestVersion, &signature, &error));
+        ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_upscaleRootSignature)));
+    }
+
+    // List the shadow casters: the cubes, which are placed by UpdateShadowCascades(), then
+    // the floor and the wall, which never move.
+    {
+        ShadowCaster cube = {};
+        XMStoreFloat4(&cube.outputColor, m_outputColor);
+        cube.indexCount = 36;
+        const ShadowSphere cubeBounds = { { 0.0f, 0.0f, 0.0f }, c_cubeBoundingRadius };
+        for (UINT copy = 0; copy < m_sceneScale; ++copy)
+        {
+            m_shadowCasters.push_back(cube);
+            m_shadowCasterBounds.push_back(cubeBounds);
+        }
+
+        ShadowCaster floor = {};
+        XMStoreFloat4x4(&floor.worldMatrix, XMMatrixIdentity());
+        floor.outputColor = XMFLOAT4(1.0f, 0.9f, 0.7f, 1.0f);
+        floor.indexCount = 6;
+        floor.startIndex = 36;
+        floor.baseVertex = 24;
+        floor.isStatic = true;
+        m_shadowCasters.push_back(floor);
+        m_shadowCasterBounds.push_back(c_floorBounds);
+
+        ShadowCaster wall = floor;
+        wall.outputColor = XMFLOAT4(0.6f, 0.3f, 0.0f, 1.0f);
+        wall.indexCount = 18;
+        wall.startIndex = 42;
+        wall.baseVertex = 28;
+        m_shadowCasters.push_back(wall);
+        m_shadowCasterBounds.push_back(c_wallBounds);
+
+        // Culling can keep any number of casters, so the list is sized for all of them
+        // rather than growing in the frame.
+        m_visibleShadowCasters.reserve(m_shadowCasters.size());
+    }
+
     // Create the constant buffer memory and map the resource
     {
         const D3D12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        size_t cbSize = c_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
+        m_numConstantBuffers = static_cast<unsigned int>(m_shadowCasters.size()) + 1;
+        size_t cbSize = m_numConstantBuffers * FrameCount * sizeof(PaddedDrawConstants);
 
         const D3D12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(cbSize);
         ThrowIfFailed(m_device->CreateCommittedResource(
@@ -234,6 +519,28 @@ void D3D12Stenciling::LoadAssets()
 
         // GPU virtual address of the resource
         m_constantDataGpuAddr = m_perFrameConstants->GetGPUVirtualAddress();
+
+        const D3D12_RESOURCE_DESC frameConstantsDesc = CD3DX12_RESOURCE_DESC::Buffer(FrameCount * sizeof(PaddedFrameConstants));
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &uploadHeapProperties,
+            D3D12_HEAP_FLAG_NONE,
+            &frameConstantsDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(m_frameConstants.ReleaseAndGetAddressOf())));
+
+        ThrowIfFailed(m_frameConstants->Map(0, nullptr, reinterpret_cast<void**>(&m_mappedFrameConstants)));
+
+        const D3D12_RESOURCE_DESC passConstantsDesc = CD3DX12_RESOURCE_DESC::Buffer(FrameCount * PassCameraCount * sizeof(PaddedPassConstants));
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &uploadHeapProperties,
+            D3D12_HEAP_FLAG_NONE,
+            &passConstantsDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(m_passConstants.ReleaseAndGetAddressOf())));
+
+        ThrowIfFailed(m_passConstants->Map(0, nullptr, reinterpret_cast<void**>(&m_mappedPassConstants)));
     }
 
     // Create the pipeline state objects, which includes compiling and loading shaders.
@@ -241,6 +548,10 @@ void D3D12Stenciling::LoadAssets()
         ComPtr<ID3DBlob> triangleVS;
         ComPtr<ID3DBlob> lambertPS;
         ComPtr<ID3DBlob> solidColorPS;
+        ComPtr<ID3DBlob> shadowedColorPS;
+        ComPtr<ID3DBlob> shadowVS;
+        ComPtr<ID3DBlob> upscaleVS;
+        ComPtr<ID3DBlob> upscalePS;
 
 #if defined(_DEBUG)
         // Enable better shader debugging with the graphics debugging tools.
@@ -252,6 +563,10 @@ void D3D12Stenciling::LoadAssets()
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "TriangleVS", "vs_5_0", compileFlags, 0, &triangleVS, nullptr));
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "LambertPS", "ps_5_0", compileFlags, 0, &lambertPS, nullptr));
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "SolidColorPS", "ps_5_0", compileFlags, 0, &solidColorPS, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "ShadowedColorPS", "ps_5_0", compileFlags, 0, &shadowedColorPS, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "ShadowVS", "vs_5_0", compileFlags, 0, &shadowVS, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "UpscaleVS", "vs_5_0", compileFlags, 0, &upscaleVS, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "UpscalePS", "ps_5_0", compileFlags, 0, &upscalePS, nullptr));
 
 
         // Define the vertex input layout.
@@ -284,13 +599,13 @@ void D3D12Stenciling::LoadAssets()
             ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_lambertPipelineState)));
 
             //
-            // Create the Pipeline State Object for drawing objects with a solid color
+            // Create the Pipeline State Object for drawing objects with a solid color, darkened in the shadows
             //
-            psoDesc.PS = CD3DX12_SHADER_BYTECODE(solidColorPS.Get());
+            psoDesc.PS = CD3DX12_SHADER_BYTECODE(shadowedColorPS.Get());
             ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_solidColorPipelineState)));
 
             //
-            // Create the Pipeline State Object for drawing transparent objects
+            // Create the Pipeline State Object for drawing transparent objects (the mirror)
             //
             // Use alpha blending
             CD3DX12_BLEND_DESC blendDesc(D3D12_DEFAULT);
@@ -299,7 +614,17 @@ void D3D12Stenciling::LoadAssets()
             blendDesc.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
             blendDesc.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD; // set by the default state, so you can omit it.
 
+            // The reflections are drawn with an oblique projection, so their depth can't be compared
+            // with the mirror's: draw it over the pixels where the stencil buffer marked it visible.
+            CD3DX12_DEPTH_STENCIL_DESC mirrorDepthDesc(D3D12_DEFAULT);
+            mirrorDepthDesc.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+            mirrorDepthDesc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+            mirrorDepthDesc.StencilEnable = TRUE;
+            mirrorDepthDesc.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL;
+
+            psoDesc.PS = CD3DX12_SHADER_BYTECODE(solidColorPS.Get());
             psoDesc.BlendState = blendDesc;
+            psoDesc.DepthStencilState = mirrorDepthDesc;
             ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_blendingPipelineState)));
 
             //
@@ -350,31 +675,61 @@ void D3D12Stenciling::LoadAssets()
             //
             // PSO for drawing reflected, NON-illuminated objects (using the stencil buffer as a mask)
             //
-            psoDesc.PS = CD3DX12_SHADER_BYTECODE(solidColorPS.Get());
+            psoDesc.PS = CD3DX12_SHADER_BYTECODE(shadowedColorPS.Get());
             ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_reflectedSolidColorPipelineState)));
 
             //
-            // PSO for drawing transparent objects projected on other surfaces like shadows.
+            // PSO for drawing the shadow casters into the cascades of the shadow map (depth only)
             //
-            // Use alpha blending
-            blendDesc.RenderTarget[0].BlendEnable = TRUE;
-
-            // Both depth and stencil tests are used. To prevent double blending:
-            // A pixel on the front face of a primitive will pass the stencil test if the value
-            // of the corresponding texel of the stencil buffer is EQUAL to the stencil reference value.
-            // The texel value is INCRemented if the pixel also passes the depth test.
-            depthdDesc.FrontFace.StencilPassOp = D3D12_STENCIL_OP_INCR;
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPsoDesc = {};
+            shadowPsoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+            shadowPsoDesc.pRootSignature = m_rootSignature.Get();
+            shadowPsoDesc.VS = CD3DX12_SHADER_BYTECODE(shadowVS.Get());
+            shadowPsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            // The slope-scaled bias keeps the surfaces at grazing angles from shadowing themselves,
+            // and the casters between the light and the near plane of a cascade are clamped to it.
+            shadowPsoDesc.RasterizerState.SlopeScaledDepthBias = 2.0f;
+            shadowPsoDesc.RasterizerState.DepthClipEnable = FALSE;
+            shadowPsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+            shadowPsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+            shadowPsoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+            shadowPsoDesc.SampleMask = UINT_MAX;
+            shadowPsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            shadowPsoDesc.NumRenderTargets = 0;
+            shadowPsoDesc.SampleDesc.Count = 1;
+            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&shadowPsoDesc, IID_PPV_ARGS(&m_shadowPipelineState)));
 
-            psoDesc.PS = CD3DX12_SHADER_BYTECODE(solidColorPS.Get());
-            psoDesc.BlendState = blendDesc;
-            psoDesc.DepthStencilState = depthdDesc;
-            psoDesc.RasterizerState.FrontCounterClockwise = FALSE; // <-- irrelevant!
-            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_projectedPipelineState)));
+            //
+            // PSO of the upscale pass, from the scene target to the back buffer
+            //
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC upscalePsoDesc = {};
+            upscalePsoDesc.pRootSignature = m_upscaleRootSignature.Get();
+            upscalePsoDesc.VS = CD3DX12_SHADER_BYTECODE(upscaleVS.Get());
+            upscalePsoDesc.PS = CD3DX12_SHADER_BYTECODE(upscalePS.Get());
+            upscalePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            upscalePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+            upscalePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+            upscalePsoDesc.DepthStencilState.DepthEnable = FALSE;
+            upscalePsoDesc.SampleMask = UINT_MAX;
+            upscalePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            upscalePsoDesc.NumRenderTargets = 1;
+            upscalePsoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+            upscalePsoDesc.SampleDesc.Count = 1;
+            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&upscalePsoDesc, IID_PPV_ARGS(&m_upscalePipelineState)));
         }
+
+        // The draw packets refer to the PSOs by id.
+        m_pipelineStates[ShadowPipeline] = m_shadowPipelineState.Get();
+        m_pipelineStates[LambertPipeline] = m_lambertPipelineState.Get();
+        m_pipelineStates[SolidColorPipeline] = m_solidColorPipelineState.Get();
+        m_pipelineStates[StencilPipeline] = m_stencilPipelineState.Get();
+        m_pipelineStates[ReflectedLambertianPipeline] = m_reflectedLambertianPipelineState.Get();
+        m_pipelineStates[ReflectedSolidColorPipeline] = m_reflectedSolidColorPipelineState.Get();
+        m_pipelineStates[BlendingPipeline] = m_blendingPipelineState.Get();
     }
 
     // Create the command list.
-    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
 
     // Command lists are created in the recording state, but there is nothing
     // to record yet. The main loop expects it to be closed, so close it now.
@@ -561,10 +916,19 @@ void D3D12Stenciling::LoadAssets()
 // Update frame-based values.
 void D3D12Stenciling::OnUpdate()
 {
-    const float rotationSpeed = 0.015f;
+    PROFILE_SCOPE("OnUpdate");
+
+    // From here to the end of PopulateCommandList(), the frame is built in the arena.
+    m_frameArena.BeginFrame();
+    m_frameStartAllocationCount = AllocationCounter::GetThreadAllocationCount();
+
+    // Radians per second.
+    const float rotationSpeed = 0.9f;
+
+    m_timer.Tick();
 
     // Update the rotation constant
-    m_curRotationAngleRad += rotationSpeed;
+    m_curRotationAngleRad += rotationSpeed * static_cast<float>(m_timer.GetElapsedSeconds());
     if (m_curRotationAngleRad >= XM_2PI)
     {
         m_curRotationAngleRad -= XM_2PI;
@@ -572,22 +936,140 @@ void D3D12Stenciling::OnUpdate()
 
     // Rotate the cube around the Y-axis, and translate it over the floor, and in front of the wall
     m_cubeWorldMatrix = XMMatrixRotationY(m_curRotationAngleRad) * XMMatrixTranslation(0.0f, 2.0f, -6.0f);
+
+    {
+        BENCHMARK_PHASE(m_benchmark, "ShadowCascades");
+        UpdateShadowCascades();
+    }
+
+    UpdateMirror();
+}
+
+// Pick the scale of the scene from the GPU time of the frame read back last, and fit the
+// viewport and the scissor rectangles of the scene passes to it. The benchmark renders
+// every frame at the same scale, so that its runs measure the same work.
+void D3D12Stenciling::UpdateSceneResolution()
+{
+    const float scale = m_benchmark.IsEnabled() ? m_resolutionController.GetScale() : m_resolutionController.Update(m_gpuProfiler.GetFrameMilliseconds());
+    const UINT sceneWidth = DynamicResolutionController::ScaleSize(m_width, scale);
+    const UINT sceneHeight = DynamicResolutionController::ScaleSize(m_height, scale);
+    m_sceneViewport = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(sceneWidth), static_cast<float>(sceneHeight));
+    m_sceneScissorRect = CD3DX12_RECT(0, 0, static_cast<LONG>(sceneWidth), static_cast<LONG>(sceneHeight));
+
+    // The mirror rectangle is in back buffer pixels; the scaled one covers all the pixels
+    // it overlaps.
+    const float scaleX = static_cast<float>(sceneWidth) / m_width;
+    const float scaleY = static_cast<float>(sceneHeight) / m_height;
+    m_sceneMirrorScissorRect = CD3DX12_RECT(
+        static_cast<LONG>(floorf(m_mirrorScissorRect.left * scaleX)),
+        static_cast<LONG>(floorf(m_mirrorScissorRect.top * scaleY)),
+        static_cast<LONG>(ceilf(m_mirrorScissorRect.right * scaleX)),
+        static_cast<LONG>(ceilf(m_mirrorScissorRect.bottom * scaleY)));
+}
+
+// Fit the scissor rectangle, the culling frustum and the projection of the mirror passes
+// to what the camera can see through the mirror.
+void D3D12Stenciling::UpdateMirror()
+{
+    PROFILE_SCOPE("UpdateMirror");
+
+    XMFLOAT4X4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, m_viewMatrix * m_projectionMatrix);
+
+    MirrorScissorRect rect;
+    m_mirrorVisible = GetMirrorScissorRect(&viewProjection.m[0][0], c_mirrorCorners, _countof(c_mirrorCorners), m_width, m_height, &rect);
+    m_mirrorScissorRect = CD3DX12_RECT(rect.left, rect.top, rect.right, rect.bottom);
+
+    const XMMATRIX cameraToWorld = XMMatrixInverse(nullptr, m_viewMatrix);
+    float eye[3];
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(eye), cameraToWorld.r[3]);
+    m_mirrorVisible = m_mirrorVisible && m_mirrorFrustum.Build(eye, c_mirrorCorners, _countof(c_mirrorCorners));
+
+    // Move the near plane of the reflected objects to the mirror, so that whatever is
+    // reflected from behind it is clipped instead of showing up in front of it.
+    if (m_mirrorVisible)
+    {
+        const float* worldPlane = m_mirrorFrustum.GetMirrorPlane();
+        XMFLOAT4 viewPlane;
+        XMStoreFloat4(&viewPlane, XMPlaneTransform(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(worldPlane)), XMMatrixTranspose(cameraToWorld)));
+
+        XMFLOAT4X4 reflectedProjection;
+        XMStoreFloat4x4(&reflectedProjection, m_projectionMatrix);
+        m_mirrorVisible = MakeObliqueProjection(&reflectedProjection.m[0][0], &viewPlane.x);
+        m_reflectedProjectionMatrix = XMLoadFloat4x4(&reflectedProjection);
+    }
+}
+
+// Move the cube casters and fit the shadow cascades to the camera.
+void D3D12Stenciling::UpdateShadowCascades()
+{
+    PROFILE_SCOPE("UpdateShadowCascades");
+
+    for (UINT copy = 0; copy < m_sceneScale; ++copy)
+    {
+        const XMMATRIX world = m_cubeWorldMatrix * GetCubeCopyOffset(copy);
+        XMStoreFloat4x4(&m_shadowCasters[copy].worldMatrix, world);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(m_shadowCasterBounds[copy].center), world.r[3]);
+    }
+
+    // The rows of the inverse view matrix are the axes and the position of the camera.
+    const XMMATRIX cameraToWorld = XMMatrixInverse(nullptr, m_viewMatrix);
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, m_projectionMatrix);
+
+    ShadowCamera camera;
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(camera.right), cameraToWorld.r[0]);
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(camera.up), cameraToWorld.r[1]);
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(camera.forward), cameraToWorld.r[2]);
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(camera.position), cameraToWorld.r[3]);
+    camera.tanHalfFovX = 1.0f / projection._11;
+    camera.tanHalfFovY = 1.0f / projection._22;
+    camera.nearZ = -projection._43 / projection._33;
+
+    XMFLOAT3 lightDir;
+    XMStoreFloat3(&lightDir, m_lightDir);
+    const float lightDirection[3] = { lightDir.x, lightDir.y, lightDir.z };
+
+    const ShadowSphere sceneBounds = ShadowCascades::GetBoundingSphere(m_shadowCasterBounds.data(), static_cast<uint32_t>(m_shadowCasterBounds.size()));
+    m_shadowCascades.Update(camera, lightDirection, sceneBounds);
 }
 
 // Render the scene.
 void D3D12Stenciling::OnRender()
 {
+    PROFILE_SCOPE("OnRender");
+
     // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList();
+    {
+        BENCHMARK_PHASE(m_benchmark, "PopulateCommandList");
+        PopulateCommandList();
+    }
 
     // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    {
+        PROFILE_SCOPE("ExecuteCommandLists");
+        BENCHMARK_PHASE(m_benchmark, "ExecuteCommandLists");
+        ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+        m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    }
 
     // Present the frame.
-    ThrowIfFailed(m_swapChain->Present(1, 0));
+    {
+        PROFILE_SCOPE("Present");
+        BENCHMARK_PHASE(m_benchmark, "Present");
+        ThrowIfFailed(m_swapChain->Present(m_syncInterval, 0));
+    }
+
+    {
+        BENCHMARK_PHASE(m_benchmark, "MoveToNextFrame");
+        MoveToNextFrame();
+    }
 
-    MoveToNextFrame();
+    // Close the counters of this frame and periodically print a summary.
+    if (m_renderStats.EndFrame() % c_renderStatsDumpInterval == 0)
+    {
+        OutputDebugStringA(m_renderStats.FormatSummary(c_renderStatsDumpInterval).c_str());
+    }
 }
 
 void D3D12Stenciling::OnDestroy()
@@ -597,10 +1079,18 @@ void D3D12Stenciling::OnDestroy()
     WaitForGpu();
 
     CloseHandle(m_fenceEvent);
+
+    if (!m_tracePath.empty())
+    {
+        std::ofstream traceFile(m_tracePath, std::ios::binary);
+        Profiler::WriteChromeTrace(traceFile);
+    }
 }
 
 void D3D12Stenciling::PopulateCommandList()
 {
+    PROFILE_SCOPE("PopulateCommandList");
+
     // Command list allocators can only be reset when the associated 
     // command lists have finished execution on the GPU; apps should use 
     // fences to determine GPU execution progress.
@@ -608,210 +1098,422 @@ void D3D12Stenciling::PopulateCommandList()
 
     // However, when ExecuteCommandList() is called on a particular command 
     // list, that command list can then be reset at any time and must be before 
-    // re-recording.
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_lambertPipelineState.Get()));
+    // re-recording. The pipeline states are set by the draw queue.
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), nullptr));
+    m_drawQueue.Clear();
+
+    // The GPU is done with the previous frame that used this index, so its timings can be
+    // collected, and the resolution of the scene picked from its GPU time.
+    m_gpuProfiler.BeginFrame(m_frameIndex, m_commandList.Get());
+    UpdateSceneResolution();
 
     // Set necessary state.
     m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-    m_commandList->RSSetViewports(1, &m_viewport);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
 
     // Index into the available constant buffers based on the number
-    // of draw calls. We've allocated enough for a known number of
-    // draw calls per frame times the number of back buffers
-    unsigned int constantBufferIndex = c_numDrawCalls * (m_frameIndex % FrameCount);
+    // of objects. We've allocated enough for a known number of
+    // objects per frame times the number of back buffers.
+    // The shadow casters come first, then the mirror.
+    unsigned int constantBufferIndex = m_numConstantBuffers * (m_frameIndex % FrameCount);
+    const D3D12_GPU_VIRTUAL_ADDRESS objectGpuAddress = m_constantDataGpuAddr + sizeof(PaddedDrawConstants) * constantBufferIndex;
+    const UINT casterCount = static_cast<UINT>(m_shadowCasters.size());
+    const D3D12_GPU_VIRTUAL_ADDRESS mirrorGpuAddress = objectGpuAddress + sizeof(PaddedDrawConstants) * casterCount;
+
+    // Set the constants of the objects, shared by the shadow, scene and reflection draws.
+    {
+        // Shaders compiled with default row-major matrices
+        DrawConstants drawConstants = {};
+        for (const ShadowCaster& caster : m_shadowCasters)
+        {
+            XMStoreFloat4x4(&drawConstants.worldMatrix, XMMatrixTranspose(XMLoadFloat4x4(&caster.worldMatrix)));
+            drawConstants.outputColor = caster.outputColor;
+            m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &drawConstants, sizeof(DrawConstants));
+            ++constantBufferIndex;
+        }
 
-    // Set the per-frame constants
-    ConstantBuffer cbParameters = {};
+        XMStoreFloat4x4(&drawConstants.worldMatrix, XMMatrixIdentity());
+        drawConstants.outputColor = XMFLOAT4(0.5f, 1.0f, 1.0f, 0.15f);
+        m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &drawConstants, sizeof(DrawConstants));
+    }
 
-    // Shaders compiled with default row-major matrices
-    XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(m_cubeWorldMatrix));
-    XMStoreFloat4x4(&cbParameters.viewMatrix, XMMatrixTranspose(m_viewMatrix));
-    XMStoreFloat4x4(&cbParameters.projectionMatrix, XMMatrixTranspose(m_projectionMatrix));
+    // Set the per-frame constants: the lighting, and the cascades of the shadow map.
+    {
+        FrameConstants frameConstants = {};
+        const UINT cascadeCount = m_shadowCascades.GetCascadeCount();
+        float depthBias[ShadowCascades::MaxCascadeCount] = {};
+        for (UINT i = 0; i < cascadeCount; ++i)
+        {
+            const ShadowCascade& cascade = m_shadowCascades.GetCascade(i);
+            XMMATRIX viewProjection = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(cascade.viewProjection));
+            XMStoreFloat4x4(&frameConstants.cascadeViewProjection[i], XMMatrixTranspose(viewProjection));
 
-    XMStoreFloat4(&cbParameters.lightDir, m_lightDir);
-    XMStoreFloat4(&cbParameters.lightColor, m_lightColor);
-    XMStoreFloat4(&cbParameters.outputColor, m_outputColor);
+            // Offset the receivers by a texel and a half toward the light, in depth units.
+            depthBias[i] = 1.5f * cascade.texelSize / (cascade.farZ - cascade.nearZ);
+        }
+        frameConstants.cascadeDepthBias = XMFLOAT4(depthBias);
+        frameConstants.shadowParams = XMFLOAT4(static_cast<float>(cascadeCount), 1.0f / c_shadowMapResolution, 0.0f, 0.0f);
+        XMStoreFloat4(&frameConstants.lightDir, m_lightDir);
+        XMStoreFloat4(&frameConstants.lightColor, m_lightColor);
+        m_renderStats.CopyToUploadMemory(&m_mappedFrameConstants[m_frameIndex], &frameConstants, sizeof(FrameConstants));
+        m_commandList->SetGraphicsRootConstantBufferView(1, m_frameConstants->GetGPUVirtualAddress() + sizeof(PaddedFrameConstants) * m_frameIndex);
+    }
 
-    // Set the constants for the first draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    // Reflection with respect to the mirror, used by the reflected objects
+    XMVECTOR mirrorPlane = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f); // xy-plane
+    XMMATRIX R = XMMatrixReflect(mirrorPlane);
 
-    // Bind the constants to the shader
-    auto baseGpuAddress = m_constantDataGpuAddr + sizeof(PaddedConstantBuffer) * constantBufferIndex;
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    // Set the cameras of the passes. The reflected objects are clipped at the mirror plane
+    // by the oblique projection.
+    D3D12_GPU_VIRTUAL_ADDRESS passGpuAddresses[PassCameraCount];
+    {
+        PassConstants passConstants = {};
+        XMStoreFloat4x4(&passConstants.viewMatrix, XMMatrixTranspose(m_viewMatrix));
+        for (UINT camera = 0; camera < PassCameraCount; ++camera)
+        {
+            const bool isReflected = (camera == ReflectedCamera);
+            XMStoreFloat4x4(&passConstants.projectionMatrix, XMMatrixTranspose(isReflected ? m_reflectedProjectionMatrix : m_projectionMatrix));
+            XMStoreFloat4x4(&passConstants.reflectionMatrix, XMMatrixTranspose(isReflected ? R : XMMatrixIdentity()));
 
-    // Indicate that the back buffer will be used as a render target.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+            const UINT passIndex = m_frameIndex * PassCameraCount + camera;
+            m_renderStats.CopyToUploadMemory(&m_mappedPassConstants[passIndex], &passConstants, sizeof(PassConstants));
+            passGpuAddresses[camera] = m_passConstants->GetGPUVirtualAddress() + sizeof(PaddedPassConstants) * passIndex;
+        }
+    }
 
-    // Set render target and depth buffer in OM stage
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
-    CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
-    m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+    // Queue the draws of every pass, so that each pass is sorted by pipeline state and
+    // then front to back.
+    {
+        QueueShadowCasters(objectGpuAddress);
+
+        // The Lambert lit cubes
+        QueueCubeCopies(ScenePass, LambertPipeline, XMMatrixIdentity(), objectGpuAddress, nullptr);
+
+        // Floor and wall
+        const UINT floor = m_sceneScale;
+        const UINT wall = m_sceneScale + 1;
+        const XMVECTOR floorCenter = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(c_floorBounds.center));
+        QueueDraw(ScenePass, SolidColorPipeline, GetViewDepth(floorCenter), objectGpuAddress + sizeof(PaddedDrawConstants) * floor,
+            m_shadowCasters[floor].indexCount, m_shadowCasters[floor].startIndex, m_shadowCasters[floor].baseVertex);
+        QueueDraw(ScenePass, SolidColorPipeline, GetViewDepth(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(c_wallBounds.center))), objectGpuAddress + sizeof(PaddedDrawConstants) * wall,
+            m_shadowCasters[wall].indexCount, m_shadowCasters[wall].startIndex, m_shadowCasters[wall].baseVertex);
+
+        // The mirror passes are skipped when it's out of view.
+        if (m_mirrorVisible)
+        {
+            // Mark the mirror on the stencil buffer
+            const float mirrorViewDepth = GetViewDepth(XMVectorSet(0.0f, 2.0f, 0.0f, 1.0f));
+            QueueDraw(MirrorStencilPass, StencilPipeline, mirrorViewDepth, mirrorGpuAddress, 6, 60, 38);
+
+            // The reflected, lit cubes that can be seen in the mirror
+            QueueCubeCopies(ReflectionPass, ReflectedLambertianPipeline, R, objectGpuAddress, &m_mirrorFrustum);
+
+            // The reflected floor, if it can be seen in the mirror
+            const XMVECTOR reflectedFloorCenter = XMVector3Transform(floorCenter, R);
+            float reflectedCenter[3];
+            XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(reflectedCenter), reflectedFloorCenter);
+            if (m_mirrorFrustum.Intersects(reflectedCenter, c_floorBounds.radius))
+            {
+                QueueDraw(ReflectionPass, ReflectedSolidColorPipeline, GetViewDepth(reflectedFloorCenter), objectGpuAddress + sizeof(PaddedDrawConstants) * floor,
+                    m_shadowCasters[floor].indexCount, m_shadowCasters[floor].startIndex, m_shadowCasters[floor].baseVertex);
+            }
+
+            // The transparent mirror
+            QueueDraw(MirrorPass, BlendingPipeline, mirrorViewDepth, mirrorGpuAddress, 6, 60, 38);
+        }
 
-    // Clear the render target and depth buffer
-    const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
-    m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-    m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+        m_drawQueue.Sort();
+    }
 
-    // Set up the input assembler
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-    m_commandList->IASetIndexBuffer(&m_indexBufferView);
+    DrawShadowMap();
 
-    // Draw the Lambert lit cube
-    m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
-    baseGpuAddress += sizeof(PaddedConstantBuffer);
-    ++constantBufferIndex;
+    // The scene samples the shadow map.
+    ID3D12DescriptorHeap* ppHeaps[] = { m_srvHeap.Get() };
+    m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+    m_commandList->SetGraphicsRootDescriptorTable(3, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
+    m_commandList->RSSetViewports(1, &m_sceneViewport);
+    m_commandList->RSSetScissorRects(1, &m_sceneScissorRect);
 
-    // Set PSO for opaque objects
-    m_commandList->SetPipelineState(m_solidColorPipelineState.Get());
+    // Indicate that the scene target will be used as a render target.
+    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_sceneColor.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
-    // Draw Floor and Wall
-    for (int m = 0; m < 2; ++m)
-    {
-        // Update world matrix and output color
-        XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixIdentity());
-        cbParameters.outputColor = m ? XMFLOAT4(0.6f, 0.3f, 0.0f, 1.0f) : XMFLOAT4(1.0f, 0.9f, 0.7f, 1.0f);
+    // Set render target and depth buffer in OM stage
+    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), FrameCount, m_rtvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+    m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
 
-        // Set the constants for the draw call
-        memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    CommandListDrawSink drawSink(m_commandList, m_pipelineStates, m_vertexBufferView, m_indexBufferView);
 
-        // Bind the constants to the shader
-        m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    {
+        PROFILE_GPU_SCOPE(m_gpuProfiler, m_commandList.Get(), "Scene");
 
-        if (m)
-            m_commandList->DrawIndexedInstanced(18, 1, 42, 28, 0); // Wall
-        else
-            m_commandList->DrawIndexedInstanced(6, 1, 36, 24, 0);  // Floor
+        // Clear the part of the render target and depth buffer that is drawn
+        const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 1, &m_sceneScissorRect);
+        m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 1, &m_sceneScissorRect);
 
-        baseGpuAddress += sizeof(PaddedConstantBuffer);
-        ++constantBufferIndex;
+        // Draw the cubes, then the floor and the wall
+        m_commandList->SetGraphicsRootConstantBufferView(4, passGpuAddresses[SceneCamera]);
+        m_drawQueue.Submit(ScenePass, drawSink);
     }
 
-    // Set PSO for drawing on the stencil buffer
-    m_commandList->SetPipelineState(m_stencilPipelineState.Get());
+    // The mirror passes are restricted to the pixels covered by the mirror.
+    if (m_mirrorVisible)
+    {
+        m_commandList->RSSetScissorRects(1, &m_sceneMirrorScissorRect);
+
+        {
+            PROFILE_GPU_SCOPE(m_gpuProfiler, m_commandList.Get(), "Mirror stencil");
 
-    // Set the stencil ref. value to 1
-    m_commandList->OMSetStencilRef(1);
+            // Set the stencil ref. value to 1
+            m_commandList->OMSetStencilRef(1);
 
-    // Draw on the stencil buffer to mark the mirror
-    // We can re-use the constant buffer already bound to the pipeline
-    m_commandList->DrawIndexedInstanced(6, 1, 60, 38, 0);
-    baseGpuAddress += sizeof(PaddedConstantBuffer);
-    ++constantBufferIndex;
+            // Draw on the stencil buffer to mark the mirror
+            m_drawQueue.Submit(MirrorStencilPass, drawSink);
+        }
 
-    // Set PSO for reflected, lit objects (the cube)
-    m_commandList->SetPipelineState(m_reflectedLambertianPipelineState.Get());
+        {
+            PROFILE_GPU_SCOPE(m_gpuProfiler, m_commandList.Get(), "Reflections");
+            m_commandList->SetGraphicsRootConstantBufferView(4, passGpuAddresses[ReflectedCamera]);
+            m_drawQueue.Submit(ReflectionPass, drawSink);
+        }
 
-    // Update the world matrix of the cube to reflect it with respect to the mirror
-    XMVECTOR mirrorPlane = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f); // xy-plane
-    XMMATRIX R = XMMatrixReflect(mirrorPlane);
-    XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(m_cubeWorldMatrix * R));
+        {
+            PROFILE_GPU_SCOPE(m_gpuProfiler, m_commandList.Get(), "Mirror");
+            m_commandList->SetGraphicsRootConstantBufferView(4, passGpuAddresses[SceneCamera]);
+            m_drawQueue.Submit(MirrorPass, drawSink);
+        }
 
-    // Set the constants for the draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+        m_commandList->RSSetScissorRects(1, &m_sceneScissorRect);
+    }
 
-    // Bind the constants to the shader
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    // Stretch the scene over the back buffer.
+    {
+        PROFILE_GPU_SCOPE(m_gpuProfiler, m_commandList.Get(), "Upscale");
 
-    // Draw the reflected, lit cube
-    m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
-    baseGpuAddress += sizeof(PaddedConstantBuffer);
-    ++constantBufferIndex;
+        // Indicate that the scene target will be sampled, and that the back buffer will be
+        // used as a render target.
+        const D3D12_RESOURCE_BARRIER barriers[] =
+        {
+            CD3DX12_RESOURCE_BARRIER::Transition(m_sceneColor.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+            CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET)
+        };
+        m_commandList->ResourceBarrier(_countof(barriers), barriers);
 
-    // Set PSO for reflected, non-illuminated objects (floor and shadow)
-    m_commandList->SetPipelineState(m_reflectedSolidColorPipelineState.Get());
+        CD3DX12_CPU_DESCRIPTOR_HANDLE backBufferRtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
+        m_commandList->OMSetRenderTargets(1, &backBufferRtvHandle, FALSE, nullptr);
+        m_commandList->RSSetViewports(1, &m_viewport);
+        m_commandList->RSSetScissorRects(1, &m_scissorRect);
 
-    // Update world matrix and output color of the floor to reflect it with respect to the mirror
-    XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(XMMatrixIdentity() * R));
-    cbParameters.outputColor = XMFLOAT4(1.0f, 0.9f, 0.7f, 1.0f);
+        // The filter stays within the drawn part of the scene target.
+        const float sceneWidth = m_sceneViewport.Width;
+        const float sceneHeight = m_sceneViewport.Height;
+        const float upscaleConstants[] =
+        {
+            sceneWidth / m_width, sceneHeight / m_height,
+            (sceneWidth - 0.5f) / m_width, (sceneHeight - 0.5f) / m_height
+        };
+        m_commandList->SetPipelineState(m_upscalePipelineState.Get());
+        m_commandList->SetGraphicsRootSignature(m_upscaleRootSignature.Get());
+        m_commandList->SetGraphicsRoot32BitConstants(0, _countof(upscaleConstants), upscaleConstants, 0);
+        m_commandList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(m_srvHeap->GetGPUDescriptorHandleForHeapStart(), 1, m_srvDescriptorSize));
+        m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        m_commandList->DrawInstanced(3, 1, 0, 0);
+    }
 
-    // Set the constants for the draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    // Indicate that the back buffer will now be used to present.
+    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 
-    // Bind the constants to the shader
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    // Resolve this frame's timestamp queries; they are read back when the frame index comes around again.
+    m_gpuProfiler.EndFrame(m_commandList.Get());
 
-    // Draw the reflected floor
-    m_commandList->DrawIndexedInstanced(6, 1, 36, 24, 0);
-    baseGpuAddress += sizeof(PaddedConstantBuffer);
-    ++constantBufferIndex;
+    ThrowIfFailed(m_commandList->Close());
 
-    // Set PSO for transparent object projected on other surfaces (planar shadow of the cube)
-    m_commandList->SetPipelineState(m_projectedPipelineState.Get());
+    CheckFrameAllocations();
+}
 
-    // Reset stencil ref. value to 0
-    m_commandList->OMSetStencilRef(0);
+// Past the first frames, building a frame must not reach the heap, other than for the
+// frame arena to grow to the largest frame. Only the debug builds count the allocations.
+void D3D12Stenciling::CheckFrameAllocations() const
+{
+    if (!AllocationCounter::IsEnabled() || m_renderStats.GetFrameCount() < c_allocationCheckWarmupFrames)
+    {
+        return;
+    }
 
-    // Update world matrix and output color to project the cube onto the floor with respect to 
-    // the light source, and raise it a little to prevent z-fighting.
-    XMVECTOR shadowPlane = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f); // xz-plane
-    XMMATRIX S = XMMatrixShadow(shadowPlane, m_lightDir);
-    XMMATRIX shadowOffsetY = XMMatrixTranslation(0.0f, 0.003f, 0.0f);
-    XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(m_cubeWorldMatrix * S * shadowOffsetY));
-    cbParameters.outputColor = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.2f);
+    const uint64_t allocationCount = AllocationCounter::GetThreadAllocationCount() - m_frameStartAllocationCount;
+    if (allocationCount > m_frameArena.GetFrameHeapAllocationCount())
+    {
+        throw std::runtime_error("D3D12Stenciling: a steady-state frame allocated from the heap");
+    }
+}
+
+// Queue the shadow casters that overlap each cascade, and the static ones of the cached
+// cascade when it must be redrawn. The constants of each shadow caster are at
+// casterGpuAddress, in the order of m_shadowCasters.
+void D3D12Stenciling::QueueShadowCasters(D3D12_GPU_VIRTUAL_ADDRESS casterGpuAddress)
+{
+    const UINT cascadeCount = m_shadowCascades.GetCascadeCount();
+    const UINT cachedCascade = cascadeCount - 1;
+    const bool hasCachedCascade = m_shadowCascades.IsCached(cachedCascade);
+    const uint32_t casterCount = static_cast<uint32_t>(m_shadowCasters.size());
 
-    // Set the constants for the draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    auto queueCaster = [&](UINT pass, UINT cascade, uint32_t index)
+    {
+        const ShadowCaster& caster = m_shadowCasters[index];
+        DrawPacket packet;
+        packet.sortKey = DrawQueue::MakeSortKey(pass, ShadowPipeline, cascade, c_sceneGeometry, 0);
+        packet.constantBuffer = casterGpuAddress + sizeof(PaddedDrawConstants) * index;
+        packet.indexCount = caster.indexCount;
+        packet.startIndex = caster.startIndex;
+        packet.baseVertex = caster.baseVertex;
+        m_drawQueue.Add(packet);
+    };
+
+    if (hasCachedCascade && m_shadowCascades.GetCascade(cachedCascade).needsRender)
+    {
+        m_visibleShadowCasters.clear();
+        m_shadowCascades.CullCasters(cachedCascade, m_shadowCasterBounds.data(), casterCount, m_visibleShadowCasters);
+        for (uint32_t index : m_visibleShadowCasters)
+        {
+            if (m_shadowCasters[index].isStatic)
+            {
+                queueCaster(ShadowCachePass, cachedCascade, index);
+            }
+        }
+    }
 
-    // Bind the constants to the shader
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    // Only draw the casters that overlap the cascade; the static ones are already in the cached one.
+    for (UINT i = 0; i < cascadeCount; ++i)
+    {
+        const bool isCached = m_shadowCascades.IsCached(i);
+        m_visibleShadowCasters.clear();
+        m_shadowCascades.CullCasters(i, m_shadowCasterBounds.data(), casterCount, m_visibleShadowCasters);
+        for (uint32_t index : m_visibleShadowCasters)
+        {
+            if (!(isCached && m_shadowCasters[index].isStatic))
+            {
+                queueCaster(ShadowCascadePass + i, i, index);
+            }
+        }
+    }
+}
 
-    // Draw the shadow of the cube
-    m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
-    baseGpuAddress += sizeof(PaddedConstantBuffer);
-    ++constantBufferIndex;
+// Draw the cascades of the shadow map from the queued shadow passes.
+void D3D12Stenciling::DrawShadowMap()
+{
+    PROFILE_GPU_SCOPE(m_gpuProfiler, m_commandList.Get(), "Shadow maps");
 
-    // Set stencil ref. value to 1
-    m_commandList->OMSetStencilRef(1);
+    const UINT cascadeCount = m_shadowCascades.GetCascadeCount();
+    const UINT cachedCascade = cascadeCount - 1;
+    const bool hasCachedCascade = m_shadowCascades.IsCached(cachedCascade);
+    CommandListDrawSink drawSink(m_commandList, m_pipelineStates, m_vertexBufferView, m_indexBufferView);
 
-    // Update world matrix and output color to draw the shadow of the cube
-    // reflected into the mirror.
-    XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(m_cubeWorldMatrix * S * shadowOffsetY * R));
-    cbParameters.outputColor = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.2f);
+    m_commandList->RSSetViewports(1, &m_shadowViewport);
+    m_commandList->RSSetScissorRects(1, &m_shadowScissorRect);
 
-    // Set the constants for the draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    CD3DX12_CPU_DESCRIPTOR_HANDLE cascadeDsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), 1, m_dsvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE cacheDsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), 1 + ShadowCascades::MaxCascadeCount, m_dsvDescriptorSize);
 
-    // Bind the constants to the shader
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    // Redraw the static casters of the cached cascade when its fit or the light changed.
+    if (hasCachedCascade && m_shadowCascades.GetCascade(cachedCascade).needsRender)
+    {
+        m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_staticShadowCache.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+        m_commandList->OMSetRenderTargets(0, nullptr, FALSE, &cacheDsvHandle);
+        m_commandList->ClearDepthStencilView(cacheDsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        m_drawQueue.Submit(ShadowCachePass, drawSink);
+        m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_staticShadowCache.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+    }
 
-    // Draw the shadow of the cube reflected into the mirror
-    m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
-    baseGpuAddress += sizeof(PaddedConstantBuffer);
-    ++constantBufferIndex;
+    // Start the cached cascade from the static casters, instead of clearing it.
+    if (hasCachedCascade)
+    {
+        m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_shadowMap.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+        const CD3DX12_TEXTURE_COPY_LOCATION dst(m_shadowMap.Get(), cachedCascade);
+        const CD3DX12_TEXTURE_COPY_LOCATION src(m_staticShadowCache.Get(), 0);
+        m_commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_shadowMap.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+    }
+    else
+    {
+        m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_shadowMap.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+    }
 
-    // Set PSO for transparent objects (mirror)
-    m_commandList->SetPipelineState(m_blendingPipelineState.Get());
+    for (UINT i = 0; i < cascadeCount; ++i)
+    {
+        m_commandList->OMSetRenderTargets(0, nullptr, FALSE, &cascadeDsvHandle);
+        if (!m_shadowCascades.IsCached(i))
+        {
+            m_commandList->ClearDepthStencilView(cascadeDsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        }
+        m_drawQueue.Submit(ShadowCascadePass + i, drawSink);
 
-    // Update world matrix and output color.
-    XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixIdentity());
-    cbParameters.outputColor = XMFLOAT4(0.5f, 1.0f, 1.0f, 0.15f);
+        cascadeDsvHandle.Offset(1, m_dsvDescriptorSize);
+    }
 
-    // Set the constants for the draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_shadowMap.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+}
 
-    // Bind the constants to the shader
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+// Translation of a copy of the cube (-scene-scale): the copies are lined up on both
+// sides of the original one, which is copy zero.
+XMMATRIX D3D12Stenciling::GetCubeCopyOffset(UINT copy) const
+{
+    const float side = (copy % 2) ? 1.0f : -1.0f;
+    return XMMatrixTranslation(side * 3.0f * ((copy + 1) / 2), 0.0f, 0.0f);
+}
 
-    // Draw the mirror
-    m_commandList->DrawIndexedInstanced(6, 1, 60, 38, 0);
+// Depth of a world-space position from the camera.
+float D3D12Stenciling::GetViewDepth(FXMVECTOR position) const
+{
+    return XMVectorGetZ(XMVector3Transform(position, m_viewMatrix));
+}
 
-    // Indicate that the back buffer will now be used to present.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+// Queue a draw with the constants of its object. The blended mirror pass is sorted back
+// to front, the others front to back.
+void D3D12Stenciling::QueueDraw(UINT pass, UINT pipeline, float viewDepth, D3D12_GPU_VIRTUAL_ADDRESS constants, UINT indexCount, UINT startIndex, INT baseVertex)
+{
+    const DrawDepthOrder order = (pass == MirrorPass) ? DrawDepthOrder::BackToFront : DrawDepthOrder::FrontToBack;
+    DrawPacket packet;
+    packet.sortKey = DrawQueue::MakeSortKey(pass, pipeline, DrawQueue::AnyBinding, c_sceneGeometry,
+        DrawQueue::GetDepthBucket(viewDepth, c_nearPlane, c_farPlane, order));
+    packet.constantBuffer = constants;
+    packet.indexCount = indexCount;
+    packet.startIndex = startIndex;
+    packet.baseVertex = baseVertex;
+    m_drawQueue.Add(packet);
+}
 
-    ThrowIfFailed(m_commandList->Close());
+// Queue the copies of the cube (-scene-scale), the first shadow casters, seen through
+// the transform of the pass. The copies outside of the culling frustum, if any, are skipped.
+void D3D12Stenciling::QueueCubeCopies(UINT pass, UINT pipeline, FXMMATRIX transform, D3D12_GPU_VIRTUAL_ADDRESS objectGpuAddress, const MirrorFrustum* pCullingFrustum)
+{
+    for (UINT copy = 0; copy < m_sceneScale; ++copy)
+    {
+        const ShadowCaster& cube = m_shadowCasters[copy];
+        const XMMATRIX world = XMLoadFloat4x4(&cube.worldMatrix) * transform;
+        if (pCullingFrustum != nullptr)
+        {
+            float center[3];
+            XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(center), world.r[3]);
+            if (!pCullingFrustum->Intersects(center, c_cubeBoundingRadius))
+            {
+                continue;
+            }
+        }
+        QueueDraw(pass, pipeline, GetViewDepth(world.r[3]), objectGpuAddress + sizeof(PaddedDrawConstants) * copy, cube.indexCount, cube.startIndex, cube.baseVertex);
+    }
 }
 
 // Wait for pending GPU work to complete.
 void D3D12Stenciling::WaitForGpu()
 {
+    PROFILE_SCOPE("WaitForGpu");
+
     // Schedule a Signal command in the queue.
     ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_fenceValues[m_frameIndex]));
 
     // Wait until the fence has been processed.
     ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-    WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
 
     // Increment the fence value for the current frame.
     m_fenceValues[m_frameIndex]++;
@@ -820,6 +1522,8 @@ void D3D12Stenciling::WaitForGpu()
 // Prepare to render the next frame.
 void D3D12Stenciling::MoveToNextFrame()
 {
+    PROFILE_SCOPE("MoveToNextFrame");
+
     // Schedule a Signal command in the queue.
     const UINT64 currentFenceValue = m_fenceValues[m_frameIndex];
     ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
@@ -831,7 +1535,7 @@ void D3D12Stenciling::MoveToNextFrame()
     if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
     {
         ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+        m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
     }
 
     // Set the fence value for the next frame.
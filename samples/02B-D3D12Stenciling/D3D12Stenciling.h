@@ -12,6 +12,15 @@
 #pragma once
 
 #include "DXSample.h"
+#include "StepTimer.h"
+#include "StatsCommandList.h"
+#include "GpuProfiler.h"
+#include "DynamicResolution.h"
+#include "ShadowCascades.h"
+#include "MirrorClipping.h"
+#include "DrawQueue.h"
+#include "FrameArena.h"
+#include "AllocationCounter.h"
 
 using namespace DirectX;
 
@@ -50,30 +59,106 @@ private:
         XMFLOAT3 normal;
     };
 
-    // Constant buffer
-    struct ConstantBuffer
+    // The constants are split by how often they change, and bound at different root
+    // parameters: per object (b0), per frame (b1) and per camera pass (b3).
+
+    // Constants of an object, shared by all its draws: into the shadow map, in the scene
+    // and in the mirror.
+    struct DrawConstants
     {
         XMFLOAT4X4 worldMatrix;        // 64 bytes
-        XMFLOAT4X4 viewMatrix;         // 64 bytes
-        XMFLOAT4X4 projectionMatrix;   // 64 bytes
-        XMFLOAT4 lightDir;             // 16 bytes
-        XMFLOAT4 lightColor;           // 16 bytes
         XMFLOAT4 outputColor;          // 16 bytes
     };
+    static_assert(sizeof(DrawConstants) == 80, "DrawConstants must match the cbuffer of shaders.hlsl");
+
+    // Each object is bound at its own 256-byte aligned address, but only its 80 bytes
+    // are written.
+    union PaddedDrawConstants
+    {
+        DrawConstants constants;
+        uint8_t bytes[D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT];
+    };
+    static_assert(sizeof(PaddedDrawConstants) == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, "PaddedDrawConstants is not aligned properly");
+
+    // Lighting and cascades of the shadow map, bound once per frame.
+    struct FrameConstants
+    {
+        XMFLOAT4X4 cascadeViewProjection[ShadowCascades::MaxCascadeCount];  // 256 bytes
+        XMFLOAT4 cascadeDepthBias;      // 16 bytes: one value per cascade.
+        XMFLOAT4 shadowParams;          // 16 bytes: cascade count, texel size in uv.
+        XMFLOAT4 lightDir;              // 16 bytes
+        XMFLOAT4 lightColor;            // 16 bytes
+    };
+    static_assert(sizeof(FrameConstants) == 320, "FrameConstants must match the cbuffer of shaders.hlsl");
 
-    // We'll allocate space for several of these and they will need to be padded for alignment.
-    static_assert(sizeof(ConstantBuffer) == 240, "Checking the size here.");
+    union PaddedFrameConstants
+    {
+        FrameConstants constants;
+        uint8_t bytes[2 * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT];
+    };
+    static_assert(sizeof(PaddedFrameConstants) % D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT == 0, "PaddedFrameConstants is not aligned properly");
+
+    // Camera of the passes drawn in the scene, or in the mirror.
+    struct PassConstants
+    {
+        XMFLOAT4X4 viewMatrix;          // 64 bytes
+        XMFLOAT4X4 projectionMatrix;    // 64 bytes
+        XMFLOAT4X4 reflectionMatrix;    // 64 bytes: reflection through the mirror, or identity.
+    };
+    static_assert(sizeof(PassConstants) == 192, "PassConstants must match the cbuffer of shaders.hlsl");
 
-    // 240 < D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
-    // Create a union with the correct size and enough room for one ConstantBuffer
-    union PaddedConstantBuffer
+    union PaddedPassConstants
     {
-        ConstantBuffer constants;
+        PassConstants constants;
         uint8_t bytes[D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT];
     };
+    static_assert(sizeof(PaddedPassConstants) == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, "PaddedPassConstants is not aligned properly");
+
+    enum PassCamera : uint32_t
+    {
+        SceneCamera,
+        ReflectedCamera,
+        PassCameraCount
+    };
 
-    // Check the exact size of the PaddedConstantBuffer to make sure it will align properly
-    static_assert(sizeof(PaddedConstantBuffer) == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, "PaddedConstantBuffer is not aligned properly");
+    // Geometry drawn into the shadow map. The static casters are only drawn into the
+    // cached cascade when it's invalidated.
+    struct ShadowCaster
+    {
+        XMFLOAT4X4 worldMatrix;
+        XMFLOAT4 outputColor;           // Of its solid color draws.
+        UINT indexCount;
+        UINT startIndex;
+        INT baseVertex;
+        bool isStatic;
+    };
+
+    // Pipeline states of the draw packets, by their id in the sort keys.
+    enum PipelineId : uint32_t
+    {
+        ShadowPipeline,
+        LambertPipeline,
+        SolidColorPipeline,
+        StencilPipeline,
+        ReflectedLambertianPipeline,
+        ReflectedSolidColorPipeline,
+        BlendingPipeline,
+        PipelineCount
+    };
+
+    // Passes of the draw packets, in the order they are recorded. There is one shadow
+    // pass per cascade; their binding is the cascade index.
+    enum DrawPass : uint32_t
+    {
+        ShadowCachePass,
+        ShadowCascadePass,
+        ScenePass = ShadowCascadePass + ShadowCascades::MaxCascadeCount,
+        MirrorStencilPass,
+        ReflectionPass,
+        MirrorPass,
+        DrawPassCount
+    };
+    static_assert(DrawPassCount <= DrawQueue::MaxPassCount, "Too many passes for the sort keys.");
 
     // Pipeline objects.
     CD3DX12_VIEWPORT m_viewport;
@@ -87,14 +172,30 @@ private:
     ComPtr<ID3D12RootSignature> m_rootSignature;
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
+    ComPtr<ID3D12DescriptorHeap> m_srvHeap;
     ComPtr<ID3D12PipelineState> m_lambertPipelineState;
     ComPtr<ID3D12PipelineState> m_solidColorPipelineState;
     ComPtr<ID3D12PipelineState> m_blendingPipelineState;
     ComPtr<ID3D12PipelineState> m_stencilPipelineState;
     ComPtr<ID3D12PipelineState> m_reflectedLambertianPipelineState;
     ComPtr<ID3D12PipelineState> m_reflectedSolidColorPipelineState;
-    ComPtr<ID3D12PipelineState> m_projectedPipelineState;
-    ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    ComPtr<ID3D12PipelineState> m_shadowPipelineState;
+    ComPtr<ID3D12RootSignature> m_upscaleRootSignature;
+    ComPtr<ID3D12PipelineState> m_upscalePipelineState;
+    ID3D12PipelineState* m_pipelineStates[PipelineCount];
+    RenderStats m_renderStats;
+    StatsCommandList m_commandList;     // Counts the recorded commands into m_renderStats.
+
+    // Transient CPU allocations of the frames being built, such as the draw packets.
+    static const size_t c_frameArenaSize = 64 * 1024;
+    FrameArena m_frameArena;
+
+    // Draws of the frame, sorted per pass to minimize the state changes.
+    DrawQueue m_drawQueue;
+
+    // Profiling: one GPU scope per pass.
+    static const UINT c_maxGpuProfileScopes = 8;
+    GpuProfiler m_gpuProfiler;
 
     // App resources.
     ComPtr<ID3D12Resource> m_vertexBuffer;
@@ -103,8 +204,37 @@ private:
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
     D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
     D3D12_GPU_VIRTUAL_ADDRESS m_constantDataGpuAddr;
-    PaddedConstantBuffer* m_mappedConstantData;
+    PaddedDrawConstants* m_mappedConstantData;
+    ComPtr<ID3D12Resource> m_frameConstants;
+    PaddedFrameConstants* m_mappedFrameConstants;
+    ComPtr<ID3D12Resource> m_passConstants;
+    PaddedPassConstants* m_mappedPassConstants;
     UINT m_rtvDescriptorSize;
+    UINT m_dsvDescriptorSize;
+    UINT m_srvDescriptorSize;
+
+    // Dynamic resolution: the scene passes draw in the top-left corner of m_sceneColor and
+    // of the depth-stencil buffer, at the scale picked from the GPU time of the frames, and
+    // the upscale pass stretches it over the back buffer. m_viewport and m_scissorRect
+    // cover the back buffer.
+    ComPtr<ID3D12Resource> m_sceneColor;
+    DynamicResolutionController m_resolutionController;
+    CD3DX12_VIEWPORT m_sceneViewport;
+    CD3DX12_RECT m_sceneScissorRect;
+    CD3DX12_RECT m_sceneMirrorScissorRect;
+
+    // Shadow map: one slice per cascade, and a copy of the static casters of the cached
+    // cascade. The DSV of each slice follows the one of the depth-stencil buffer in
+    // m_dsvHeap, then comes the one of the cache.
+    static const UINT c_shadowMapResolution = 2048;
+    ComPtr<ID3D12Resource> m_shadowMap;
+    ComPtr<ID3D12Resource> m_staticShadowCache;
+    CD3DX12_VIEWPORT m_shadowViewport;
+    CD3DX12_RECT m_shadowScissorRect;
+    ShadowCascades m_shadowCascades;
+    std::vector<ShadowCaster> m_shadowCasters;
+    std::vector<ShadowSphere> m_shadowCasterBounds;
+    std::vector<uint32_t> m_visibleShadowCasters;
 
     // Synchronization objects.
     UINT m_frameIndex;
@@ -113,12 +243,21 @@ private:
     UINT64 m_fenceValues[FrameCount];
 
     // Scene constants, updated per-frame
+    StepTimer m_timer;
     float m_curRotationAngleRad;
 
-    // In this sample we have nine draw calls.
-    static const unsigned int c_numDrawCalls = 9;
+    // In this sample each object has one constant buffer per frame: the shadow casters
+    // (the cubes, the floor and the wall), then the mirror.
+    unsigned int m_numConstantBuffers;
+
+    // Mirror passes: drawn when the mirror is in view, within its scissor rectangle, for the
+    // reflected objects in its frustum, with the near plane on the mirror.
+    bool m_mirrorVisible;
+    CD3DX12_RECT m_mirrorScissorRect;      // In back buffer pixels.
+    MirrorFrustum m_mirrorFrustum;
+    XMMATRIX m_reflectedProjectionMatrix;
 
-    // These computed values will be loaded into a ConstantBuffer
+    // These computed values will be loaded into the constant buffers
     // during Render
     XMMATRIX m_cubeWorldMatrix;
     XMMATRIX m_viewMatrix;
@@ -127,9 +266,28 @@ private:
     XMVECTOR m_lightColor;
     XMVECTOR m_outputColor;
 
+    // Frames between two dumps of the render stats to the debugger output.
+    static const UINT c_renderStatsDumpInterval = 300;
+
+    // Heap allocations counted when the frame started, and the frames built before the
+    // allocations are checked, so that the containers kept across frames reach their size.
+    uint64_t m_frameStartAllocationCount;
+    static const UINT c_allocationCheckWarmupFrames = 8;
+
     void LoadPipeline();
     void LoadAssets();
+    void CreateShadowMap();
+    void UpdateShadowCascades();
+    void QueueShadowCasters(D3D12_GPU_VIRTUAL_ADDRESS casterGpuAddress);
+    void DrawShadowMap();
+    void UpdateMirror();
+    void UpdateSceneResolution();
     void PopulateCommandList();
+    XMMATRIX GetCubeCopyOffset(UINT copy) const;
+    void QueueDraw(UINT pass, UINT pipeline, float viewDepth, D3D12_GPU_VIRTUAL_ADDRESS constants, UINT indexCount, UINT startIndex, INT baseVertex);
+    void QueueCubeCopies(UINT pass, UINT pipeline, FXMMATRIX transform, D3D12_GPU_VIRTUAL_ADDRESS objectGpuAddress, const MirrorFrustum* pCullingFrustum);
+    float GetViewDepth(FXMVECTOR position) const;
+    void CheckFrameAllocations() const;
     void MoveToNextFrame();
     void WaitForGpu();
 };
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 #include "stdafx.h"
 #include "DXSample.h"
+#include <fstream>
 
 using namespace Microsoft::WRL;
 
@@ -18,7 +19,10 @@ DXSample::DXSample(UINT width, UINT height, std::wstring name) :
     m_width(width),
     m_height(height),
     m_title(name),
-    m_useWarpDevice(false)
+    m_useWarpDevice(false),
+    m_sceneScale(1),
+    m_syncInterval(1),
+    m_benchmarkReportPath(L"benchmark")
 {
     WCHAR assetsPath[512];
     GetAssetsPath(assetsPath, _countof(assetsPath));
@@ -116,6 +120,8 @@ void DXSample::SetCustomWindowText(LPCWSTR text)
 _Use_decl_annotations_
 void DXSample::ParseCommandLineArgs(WCHAR* argv[], int argc)
 {
+    BenchmarkSettings benchmarkSettings;
+
     for (int i = 1; i < argc; ++i)
     {
         if (_wcsnicmp(argv[i], L"-warp", wcslen(argv[i])) == 0 || 
@@ -124,5 +130,67 @@ void DXSample::ParseCommandLineArgs(WCHAR* argv[], int argc)
             m_useWarpDevice = true;
             m_title = m_title + L" (WARP)";
         }
+        else if ((_wcsnicmp(argv[i], L"-trace", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/trace", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            m_tracePath = argv[++i];
+        }
+        else if ((_wcsnicmp(argv[i], L"-bench", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/bench", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            benchmarkSettings.frameCount = static_cast<uint32_t>(_wtoi(argv[++i]));
+        }
+        else if ((_wcsnicmp(argv[i], L"-bench-report", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/bench-report", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            m_benchmarkReportPath = argv[++i];
+        }
+        else if ((_wcsnicmp(argv[i], L"-warmup", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/warmup", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            benchmarkSettings.warmupFrameCount = static_cast<uint32_t>(_wtoi(argv[++i]));
+        }
+        else if (_wcsnicmp(argv[i], L"-headless", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/headless", wcslen(argv[i])) == 0)
+        {
+            benchmarkSettings.headless = true;
+        }
+        else if ((_wcsnicmp(argv[i], L"-scene-scale", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/scene-scale", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            m_sceneScale = static_cast<UINT>((std::max)(1, _wtoi(argv[++i])));
+        }
     }
+
+    // Benchmark frames are presented as fast as possible, so that the results measure
+    // the sample rather than the refresh rate of the display.
+    m_benchmark.Configure(benchmarkSettings);
+    if (m_benchmark.IsEnabled())
+    {
+        m_syncInterval = 0;
+    }
+}
+
+// Save the benchmark results and print their summary to the debugger output.
+void DXSample::WriteBenchmarkReport()
+{
+    // Sample titles are plain ASCII.
+    std::string sampleName;
+    for (WCHAR c : m_title)
+    {
+        sampleName += static_cast<char>(c);
+    }
+
+    std::ofstream csvFile(m_benchmarkReportPath + L".csv", std::ios::binary);
+    m_benchmark.WriteCsv(csvFile);
+
+    std::ofstream jsonFile(m_benchmarkReportPath + L".json", std::ios::binary);
+    m_benchmark.WriteJson(jsonFile, sampleName, m_sceneScale);
+
+    if (!csvFile || !jsonFile)
+    {
+        throw std::runtime_error("Failed to write the benchmark report.");
+    }
+
+    OutputDebugStringA(m_benchmark.FormatSummary().c_str());
 }
\ No newline at end of file
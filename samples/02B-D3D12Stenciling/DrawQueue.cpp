@@ -0,0 +1,128 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DrawQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+DrawQueue::DrawQueue(FrameArena& arena) :
+    m_pArena(&arena),
+    m_packets(FrameAllocator<DrawPacket>(arena)),
+    m_sortedPackets(FrameAllocator<DrawPacket>(arena)),
+    m_passBegin{},
+    m_isSorted(false),
+    m_hasState(false),
+    m_hasBinding(false),
+    m_pipeline(0),
+    m_binding(0),
+    m_geometry(0),
+    m_constantBuffer(0),
+    m_stats{}
+{
+}
+
+void DrawQueue::Clear()
+{
+    // Start with room for as many packets as the previous frame.
+    const size_t previousCount = m_packets.size();
+    m_packets = FrameVector<DrawPacket>(FrameAllocator<DrawPacket>(*m_pArena));
+    m_packets.reserve(previousCount);
+    m_sortedPackets = FrameVector<DrawPacket>(FrameAllocator<DrawPacket>(*m_pArena));
+    std::fill(std::begin(m_passBegin), std::end(m_passBegin), 0);
+    m_isSorted = false;
+    InvalidateState();
+    m_stats = DrawQueueStats{};
+}
+
+void DrawQueue::Add(const DrawPacket& packet)
+{
+    if (m_packets.size() >= MaxPacketCount)
+    {
+        throw std::runtime_error("DrawQueue: too many packets in the frame");
+    }
+    m_packets.push_back(packet);
+    m_packets.back().sortKey = (packet.sortKey & ~static_cast<uint64_t>(MaxPacketCount - 1)) | (m_packets.size() - 1);
+    m_isSorted = false;
+}
+
+void DrawQueue::Sort()
+{
+    // Group the packets by pass, then sort each pass: the keys end with the order in
+    // which the packets were added, so they are unique and keep that order.
+    uint32_t passCounts[MaxPassCount] = {};
+    for (const DrawPacket& packet : m_packets)
+    {
+        ++passCounts[GetPass(packet.sortKey)];
+    }
+    m_passBegin[0] = 0;
+    for (uint32_t pass = 0; pass < MaxPassCount; ++pass)
+    {
+        m_passBegin[pass + 1] = m_passBegin[pass] + passCounts[pass];
+    }
+
+    uint32_t passEnd[MaxPassCount];
+    std::copy(m_passBegin, m_passBegin + MaxPassCount, passEnd);
+    m_sortedPackets.resize(m_packets.size());
+    for (const DrawPacket& packet : m_packets)
+    {
+        m_sortedPackets[passEnd[GetPass(packet.sortKey)]++] = packet;
+    }
+
+    for (uint32_t pass = 0; pass < MaxPassCount; ++pass)
+    {
+        std::sort(m_sortedPackets.begin() + m_passBegin[pass], m_sortedPackets.begin() + m_passBegin[pass + 1],
+            [](const DrawPacket& a, const DrawPacket& b) { return a.sortKey < b.sortKey; });
+    }
+    m_isSorted = true;
+}
+
+uint32_t DrawQueue::GetCount(uint32_t pass) const
+{
+    if (!m_isSorted || pass >= MaxPassCount)
+    {
+        return 0;
+    }
+    return m_passBegin[pass + 1] - m_passBegin[pass];
+}
+
+uint64_t DrawQueue::MakeSortKey(uint32_t pass, uint32_t pipeline, uint32_t binding, uint32_t geometry, uint32_t depthBucket)
+{
+    if (pass >= MaxPassCount || pipeline >= MaxPipelineCount || binding > AnyBinding ||
+        geometry >= MaxGeometryCount || depthBucket >= (1u << DepthBits))
+    {
+        throw std::runtime_error("DrawQueue: a field of the sort key is out of range");
+    }
+    return (static_cast<uint64_t>(pass) << PassShift) |
+        (static_cast<uint64_t>(pipeline) << PipelineShift) |
+        (static_cast<uint64_t>(binding) << BindingShift) |
+        (static_cast<uint64_t>(geometry) << GeometryShift) |
+        (static_cast<uint64_t>(depthBucket) << DepthShift);
+}
+
+uint32_t DrawQueue::GetDepthBucket(float viewDepth, float nearZ, float farZ, DrawDepthOrder order)
+{
+    if (!(nearZ > 0.0f && farZ > nearZ))
+    {
+        throw std::runtime_error("DrawQueue: the depth range must be positive and not empty");
+    }
+
+    // Depths outside of the range, or NaN, go to the first or the last bucket.
+    const float maxBucket = static_cast<float>((1u << DepthBits) - 1);
+    float t = 0.0f;
+    if (viewDepth > nearZ)
+    {
+        t = std::log(viewDepth / nearZ) / std::log(farZ / nearZ);
+    }
+    const uint32_t bucket = static_cast<uint32_t>((std::min)(t, 1.0f) * maxBucket + 0.5f);
+    return order == DrawDepthOrder::FrontToBack ? bucket : static_cast<uint32_t>(maxBucket) - bucket;
+}
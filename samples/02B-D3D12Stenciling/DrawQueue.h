@@ -0,0 +1,200 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "FrameArena.h"
+
+enum class DrawDepthOrder
+{
+    FrontToBack,        // Nearest first, for early depth rejection of opaque draws.
+    BackToFront         // Farthest first, for alpha blending.
+};
+
+// One indexed draw, with the state it needs encoded in its sort key.
+struct DrawPacket
+{
+    uint64_t sortKey;           // From DrawQueue::MakeSortKey().
+    uint64_t constantBuffer;    // GPU address of the per-draw constants.
+    uint32_t indexCount;
+    uint32_t startIndex;
+    int32_t baseVertex;
+};
+
+struct DrawQueueStats
+{
+    uint32_t drawCount;
+    uint32_t pipelineChanges;
+    uint32_t bindingChanges;
+    uint32_t geometryChanges;
+    uint32_t constantBufferChanges;
+    uint32_t filteredCalls;     // State changes skipped because the state was already set.
+};
+
+// Draw packets of a frame, sorted by a 64-bit key per pass and submitted with the
+// redundant state changes filtered out.
+// From the most significant bits, a key holds the pass, the pipeline state, the root
+// binding (root arguments shared by a group of draws, such as a cascade index), the
+// geometry (vertex and index buffers) and a depth bucket, so that sorting the keys
+// groups the draws of a pass by pipeline state first, and orders them by depth last.
+// The passes are submitted one at a time, in the order of the caller, which records
+// what changes between them (render targets, stencil reference...).
+// The ids are the caller's: Submit() hands them to a sink, which sets the matching state.
+// The packets are allocated from the arena of the frame, so queuing a frame doesn't
+// reach the heap once the arena has grown to it.
+class DrawQueue
+{
+public:
+    static const uint32_t PassBits = 4;
+    static const uint32_t PipelineBits = 8;
+    static const uint32_t BindingBits = 8;
+    static const uint32_t GeometryBits = 8;
+    static const uint32_t DepthBits = 16;
+
+    static const uint32_t MaxPassCount = 1 << PassBits;
+    static const uint32_t MaxPipelineCount = 1 << PipelineBits;
+    static const uint32_t MaxGeometryCount = 1 << GeometryBits;
+
+    // Binding of the draws that don't read the per-group root arguments: they keep
+    // whatever is bound.
+    static const uint32_t AnyBinding = (1 << BindingBits) - 1;
+
+    // The most packets a frame can hold.
+    static const uint32_t MaxPacketCount = 1 << 20;
+
+    explicit DrawQueue(FrameArena& arena);
+
+    // Starts a new frame: removes the packets, and forgets the state set on the
+    // command list, which is recorded from scratch. Call it after the arena started
+    // the frame; the packets of the previous one are left in their own buffer.
+    void Clear();
+
+    void Add(const DrawPacket& packet);
+
+    // Forgets the state set on the command list, when it was changed behind the queue.
+    void InvalidateState()      { m_hasState = false; m_hasBinding = false; }
+
+    // Sorts the packets of each pass by key, keeping the order in which equal keys were added.
+    void Sort();
+
+    // Calls, for each packet of the pass in key order:
+    //   sink.SetPipeline(id), sink.SetBinding(id), sink.SetGeometry(id) and
+    //   sink.SetConstantBuffer(address) when the state differs from the current one,
+    //   then sink.Draw(packet).
+    // The state carries over from one pass to the next.
+    template <typename Sink>
+    void Submit(uint32_t pass, Sink& sink);
+
+    uint32_t GetCount() const               { return static_cast<uint32_t>(m_packets.size()); }
+    uint32_t GetCount(uint32_t pass) const;
+
+    // Totals of the Submit() calls since the last Clear().
+    const DrawQueueStats& GetStats() const  { return m_stats; }
+
+    static uint64_t MakeSortKey(uint32_t pass, uint32_t pipeline, uint32_t binding, uint32_t geometry, uint32_t depthBucket);
+
+    // Bucket of a view-space depth, spread logarithmically from nearZ to farZ so that
+    // the near draws, which occlude the most, are the best ordered.
+    static uint32_t GetDepthBucket(float viewDepth, float nearZ, float farZ, DrawDepthOrder order);
+
+    static uint32_t GetPass(uint64_t sortKey)       { return static_cast<uint32_t>(sortKey >> PassShift); }
+    static uint32_t GetPipeline(uint64_t sortKey)   { return static_cast<uint32_t>(sortKey >> PipelineShift) & (MaxPipelineCount - 1); }
+    static uint32_t GetBinding(uint64_t sortKey)    { return static_cast<uint32_t>(sortKey >> BindingShift) & AnyBinding; }
+    static uint32_t GetGeometry(uint64_t sortKey)   { return static_cast<uint32_t>(sortKey >> GeometryShift) & (MaxGeometryCount - 1); }
+    static uint32_t GetDepth(uint64_t sortKey)      { return static_cast<uint32_t>(sortKey >> DepthShift) & ((1 << DepthBits) - 1); }
+
+private:
+    // The low 20 bits hold the order in which the packets were added, so that sorting
+    // keeps it for equal keys without std::stable_sort, which allocates a buffer.
+    static const uint32_t PassShift = 64 - PassBits;
+    static const uint32_t PipelineShift = PassShift - PipelineBits;
+    static const uint32_t BindingShift = PipelineShift - BindingBits;
+    static const uint32_t GeometryShift = BindingShift - GeometryBits;
+    static const uint32_t DepthShift = GeometryShift - DepthBits;
+    static_assert((1u << DepthShift) == MaxPacketCount, "The order of the packets must fit below the depth.");
+
+    FrameArena* m_pArena;
+    FrameVector<DrawPacket> m_packets;          // In the order they were added.
+    FrameVector<DrawPacket> m_sortedPackets;
+    uint32_t m_passBegin[MaxPassCount + 1];     // Range of each pass in m_sortedPackets.
+    bool m_isSorted;
+
+    // State set by the last Submit() call; the binding is only known once a draw needed one.
+    bool m_hasState;
+    bool m_hasBinding;
+    uint32_t m_pipeline;
+    uint32_t m_binding;
+    uint32_t m_geometry;
+    uint64_t m_constantBuffer;
+
+    DrawQueueStats m_stats;
+};
+
+template <typename Sink>
+void DrawQueue::Submit(uint32_t pass, Sink& sink)
+{
+    if (!m_isSorted)
+    {
+        throw std::runtime_error("DrawQueue: the packets must be sorted before they are submitted");
+    }
+    if (pass >= MaxPassCount)
+    {
+        throw std::runtime_error("DrawQueue: invalid pass");
+    }
+
+    for (uint32_t i = m_passBegin[pass]; i < m_passBegin[pass + 1]; ++i)
+    {
+        const DrawPacket& packet = m_sortedPackets[i];
+        const uint32_t pipeline = GetPipeline(packet.sortKey);
+        const uint32_t binding = GetBinding(packet.sortKey);
+        const uint32_t geometry = GetGeometry(packet.sortKey);
+
+        // Out of the four state changes a draw could need, count those that are skipped.
+        uint32_t changeCount = 0;
+        if (!m_hasState || pipeline != m_pipeline)
+        {
+            sink.SetPipeline(pipeline);
+            m_pipeline = pipeline;
+            ++m_stats.pipelineChanges;
+            ++changeCount;
+        }
+        if (binding != AnyBinding && (!m_hasBinding || binding != m_binding))
+        {
+            sink.SetBinding(binding);
+            m_binding = binding;
+            m_hasBinding = true;
+            ++m_stats.bindingChanges;
+            ++changeCount;
+        }
+        if (!m_hasState || geometry != m_geometry)
+        {
+            sink.SetGeometry(geometry);
+            m_geometry = geometry;
+            ++m_stats.geometryChanges;
+            ++changeCount;
+        }
+        if (!m_hasState || packet.constantBuffer != m_constantBuffer)
+        {
+            sink.SetConstantBuffer(packet.constantBuffer);
+            m_constantBuffer = packet.constantBuffer;
+            ++m_stats.constantBufferChanges;
+            ++changeCount;
+        }
+        m_hasState = true;
+        m_stats.filteredCalls += (binding == AnyBinding ? 3 : 4) - changeCount;
+
+        sink.Draw(packet);
+        ++m_stats.drawCount;
+    }
+}
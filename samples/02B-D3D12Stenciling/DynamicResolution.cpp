@@ -0,0 +1,72 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+DynamicResolutionController::DynamicResolutionController(const DynamicResolutionDesc& desc) :
+    m_desc(desc)
+{
+    if (!(desc.targetMilliseconds > 0.0f) || !(desc.minScale > 0.0f) || desc.minScale > desc.maxScale ||
+        !(desc.maxIncrease >= 0.0f) || !(desc.maxDecrease >= 0.0f) || desc.maxDecrease >= 1.0f)
+    {
+        throw std::runtime_error("DynamicResolutionController: invalid settings");
+    }
+    Reset();
+}
+
+float DynamicResolutionController::Update(float gpuMilliseconds)
+{
+    if (!(gpuMilliseconds > 0.0f))
+    {
+        // No measure (a frame without timestamps, or a disjoint clock): keep the scale.
+        return m_scale;
+    }
+
+    // The GPU time grows about as the pixel count, so the log of their ratios are about
+    // proportional, whatever the cost of a pixel.
+    float error = std::log(m_desc.targetMilliseconds / gpuMilliseconds);
+    if (std::fabs(gpuMilliseconds - m_desc.targetMilliseconds) <= m_desc.deadband * m_desc.targetMilliseconds)
+    {
+        error = 0.0f;
+    }
+
+    float step = m_desc.proportionalGain * (error - m_previousError) +
+        m_desc.integralGain * error +
+        m_desc.derivativeGain * (error - 2.0f * m_previousError + m_secondPreviousError);
+    step = (std::min)(step, std::log(1.0f + m_desc.maxIncrease));
+    step = (std::max)(step, std::log(1.0f - m_desc.maxDecrease));
+
+    const float minLogPixelFraction = 2.0f * std::log(m_desc.minScale / m_desc.maxScale);
+    m_logPixelFraction = (std::min)((std::max)(m_logPixelFraction + step, minLogPixelFraction), 0.0f);
+    m_secondPreviousError = m_previousError;
+    m_previousError = error;
+
+    m_scale = m_desc.maxScale * std::exp(0.5f * m_logPixelFraction);
+    return m_scale;
+}
+
+void DynamicResolutionController::Reset()
+{
+    m_scale = m_desc.maxScale;
+    m_logPixelFraction = 0.0f;
+    m_previousError = 0.0f;
+    m_secondPreviousError = 0.0f;
+}
+
+uint32_t DynamicResolutionController::ScaleSize(uint32_t size, float scale)
+{
+    const uint32_t scaled = static_cast<uint32_t>(static_cast<float>(size) * scale + 0.5f);
+    return (std::max)(scaled, 1u);
+}
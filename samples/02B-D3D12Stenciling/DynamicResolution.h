@@ -0,0 +1,72 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Settings of the dynamic resolution.
+struct DynamicResolutionDesc
+{
+    // GPU time of a frame to aim at: the frame budget, less some headroom for the
+    // frames that cost more than the ones before them.
+    float targetMilliseconds = 14.0f;
+
+    // Range of the scale of the width and the height of the render target.
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+
+    // Gains of the controller, on the log of the ratio of the target time to the measured
+    // time and the log of the pixel count. The frame times come back a few frames late,
+    // which the integral gain must stay well under 0.6 for.
+    float proportionalGain = 0.1f;
+    float integralGain = 0.2f;
+    float derivativeGain = 0.0f;
+
+    // Frame times within this fraction of the target don't change the scale, so that the
+    // noise of the measures doesn't either.
+    float deadband = 0.03f;
+
+    // Largest changes of the pixel count in a frame, as fractions of it: the scale drops
+    // quickly when over budget, and comes back slowly.
+    float maxIncrease = 0.05f;
+    float maxDecrease = 0.25f;
+};
+
+// Picks the scale of the resolution of each frame from the measured GPU time of the
+// frames, with a PID controller in velocity form: each measure moves the scale, which
+// stays within its range without the integral winding up. The controller has no other
+// state than the scale and the last errors, so the same frame times always give the
+// same scales.
+class DynamicResolutionController
+{
+public:
+    explicit DynamicResolutionController(const DynamicResolutionDesc& desc = DynamicResolutionDesc());
+
+    // Takes the GPU time of a frame, and returns the scale of the next frames.
+    float Update(float gpuMilliseconds);
+
+    // Back to the largest scale, with no history.
+    void Reset();
+
+    const DynamicResolutionDesc& GetDesc() const    { return m_desc; }
+    float GetScale() const                          { return m_scale; }
+
+    // Size of the render target at the scale, at least a pixel.
+    static uint32_t ScaleSize(uint32_t size, float scale);
+
+private:
+    DynamicResolutionDesc m_desc;
+    float m_scale;
+    float m_logPixelFraction;   // Of the pixel count at the largest scale, so <= 0.
+    float m_previousError;
+    float m_secondPreviousError;
+};
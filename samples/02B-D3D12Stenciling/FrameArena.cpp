@@ -0,0 +1,144 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Smallest overflow block, so that a frame that overflows by many small
+    // allocations doesn't take one block for each.
+    const size_t c_minOverflowBlockSize = 64 * 1024;
+}
+
+FrameArena::FrameArena(uint32_t frameCount, size_t initialBytesPerFrame) :
+    m_current(0),
+    m_highWaterMark(0),
+    m_totalHeapAllocationCount(0)
+{
+    if (frameCount == 0)
+    {
+        throw std::runtime_error("FrameArena: there must be at least one frame");
+    }
+
+    m_frames.resize(frameCount, Frame{});
+    for (Frame& frame : m_frames)
+    {
+        if (initialBytesPerFrame > 0)
+        {
+            frame.pBuffer = static_cast<uint8_t*>(AllocateFromHeap(initialBytesPerFrame));
+            frame.capacity = initialBytesPerFrame;
+        }
+        frame.pCursor = frame.pBuffer;
+        frame.pEnd = frame.pBuffer + frame.capacity;
+    }
+    m_frames[m_current].heapAllocationCount = 0;
+}
+
+FrameArena::~FrameArena()
+{
+    for (Frame& frame : m_frames)
+    {
+        FreeOverflow(frame);
+        ::operator delete(frame.pBuffer);
+    }
+}
+
+void FrameArena::BeginFrame()
+{
+    m_current = (m_current + 1) % static_cast<uint32_t>(m_frames.size());
+    Frame& frame = m_frames[m_current];
+    frame.heapAllocationCount = 0;
+    FreeOverflow(frame);
+
+    // Regrow the buffer to hold the largest frame seen in any buffer, with some room
+    // so that a frame slightly larger than that doesn't overflow again.
+    if (frame.capacity < m_highWaterMark)
+    {
+        ::operator delete(frame.pBuffer);
+        frame.pBuffer = nullptr;
+        frame.capacity = 0;
+
+        const size_t capacity = m_highWaterMark + m_highWaterMark / 4;
+        frame.pBuffer = static_cast<uint8_t*>(AllocateFromHeap(capacity));
+        frame.capacity = capacity;
+    }
+
+    frame.pCursor = frame.pBuffer;
+    frame.pEnd = frame.pBuffer + frame.capacity;
+    frame.bytesAllocated = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::runtime_error("FrameArena: the alignment must be a power of two");
+    }
+
+    Frame& frame = m_frames[m_current];
+    if (frame.pCursor != nullptr)
+    {
+        const uintptr_t cursor = reinterpret_cast<uintptr_t>(frame.pCursor);
+        const size_t padding = static_cast<size_t>((0 - cursor) & (alignment - 1));
+        const size_t available = static_cast<size_t>(frame.pEnd - frame.pCursor);
+        if (padding <= available && size <= available - padding)
+        {
+            uint8_t* pAllocation = frame.pCursor + padding;
+            frame.pCursor = pAllocation + size;
+            frame.bytesAllocated += padding + size;
+            m_highWaterMark = (std::max)(m_highWaterMark, frame.bytesAllocated);
+            return pAllocation;
+        }
+    }
+    return AllocateOverflow(frame, size, alignment);
+}
+
+void* FrameArena::AllocateOverflow(Frame& frame, size_t size, size_t alignment)
+{
+    // The block holds its header, the allocation and its worst alignment padding.
+    const size_t headerSize = sizeof(OverflowBlock);
+    if (size > (std::numeric_limits<size_t>::max)() - headerSize - alignment)
+    {
+        throw std::bad_alloc();
+    }
+    const size_t blockSize = (std::max)({ headerSize + alignment + size, frame.capacity, c_minOverflowBlockSize });
+
+    OverflowBlock* pBlock = static_cast<OverflowBlock*>(AllocateFromHeap(blockSize));
+    pBlock->pNext = frame.pOverflow;
+    pBlock->capacity = blockSize;
+    frame.pOverflow = pBlock;
+
+    // The rest of the buffer is given up: allocations never go back to it.
+    frame.pCursor = reinterpret_cast<uint8_t*>(pBlock) + headerSize;
+    frame.pEnd = reinterpret_cast<uint8_t*>(pBlock) + blockSize;
+    return Allocate(size, alignment);
+}
+
+void* FrameArena::AllocateFromHeap(size_t size)
+{
+    void* pMemory = ::operator new(size);
+    ++m_frames[m_current].heapAllocationCount;
+    ++m_totalHeapAllocationCount;
+    return pMemory;
+}
+
+void FrameArena::FreeOverflow(Frame& frame)
+{
+    while (frame.pOverflow != nullptr)
+    {
+        OverflowBlock* pNext = frame.pOverflow->pNext;
+        ::operator delete(frame.pOverflow);
+        frame.pOverflow = pNext;
+    }
+}
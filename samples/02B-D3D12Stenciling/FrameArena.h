@@ -0,0 +1,133 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for the temporaries of a frame: draw lists, barrier lists, sorted
+// indices... Allocating moves a pointer, and freeing does nothing: the whole buffer of
+// a frame is reset at once, when the frame comes around again.
+// There is one buffer per frame in flight, so what was allocated in a frame stays
+// valid while the next frameCount - 1 frames are built.
+// A frame that doesn't fit in its buffer takes overflow blocks from the heap; the
+// buffer is then regrown to hold all of it the next time it's reset. Once every buffer
+// holds the largest frame, building a frame no longer reaches the heap.
+// Not thread-safe: a frame is built by one thread at a time.
+class FrameArena
+{
+public:
+    FrameArena(uint32_t frameCount, size_t initialBytesPerFrame);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Starts a frame: switches to the next buffer and frees what it held.
+    void BeginFrame();
+
+    // The alignment must be a power of two. Never returns nullptr.
+    void* Allocate(size_t size, size_t alignment);
+
+    uint32_t GetFrameCount() const          { return static_cast<uint32_t>(m_frames.size()); }
+    size_t GetBytesAllocated() const        { return m_frames[m_current].bytesAllocated; }
+    size_t GetCapacity() const              { return m_frames[m_current].capacity; }
+    size_t GetHighWaterMark() const         { return m_highWaterMark; }
+
+    // Heap allocations made by the arena in the current frame: overflow blocks, and the
+    // buffer regrown by BeginFrame().
+    uint32_t GetFrameHeapAllocationCount() const    { return m_frames[m_current].heapAllocationCount; }
+
+    // Heap allocations made by the arena since it was created.
+    uint64_t GetTotalHeapAllocationCount() const    { return m_totalHeapAllocationCount; }
+
+private:
+    // Overflow blocks are chained through a header at their start.
+    struct OverflowBlock
+    {
+        OverflowBlock* pNext;
+        size_t capacity;
+    };
+
+    struct Frame
+    {
+        uint8_t* pBuffer;
+        size_t capacity;
+        uint8_t* pCursor;               // In the buffer, or the first overflow block.
+        uint8_t* pEnd;
+        OverflowBlock* pOverflow;       // Most recent first.
+        size_t bytesAllocated;          // Including the alignment padding.
+        uint32_t heapAllocationCount;
+    };
+
+    void* AllocateOverflow(Frame& frame, size_t size, size_t alignment);
+    void* AllocateFromHeap(size_t size);
+    static void FreeOverflow(Frame& frame);
+
+    std::vector<Frame> m_frames;
+    uint32_t m_current;
+    size_t m_highWaterMark;             // Largest frame, in bytes.
+    uint64_t m_totalHeapAllocationCount;
+};
+
+// STL allocator that allocates from a FrameArena. A container using it must not outlive
+// the frameCount frames that follow the one it was filled in; deallocate() does nothing,
+// so it's also fine to let it go without clearing it.
+template <typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    explicit FrameAllocator(FrameArena& arena) noexcept : m_pArena(&arena) {}
+
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other) noexcept : m_pArena(other.GetArena()) {}
+
+    T* allocate(size_t count)
+    {
+        if (count > (std::numeric_limits<size_t>::max)() / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(m_pArena->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    FrameArena* GetArena() const noexcept   { return m_pArena; }
+
+private:
+    FrameArena* m_pArena;
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) noexcept
+{
+    return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) noexcept
+{
+    return !(a == b);
+}
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
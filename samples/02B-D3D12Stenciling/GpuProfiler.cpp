@@ -0,0 +1,174 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "GpuProfiler.h"
+#include "DXSampleHelper.h"
+
+namespace
+{
+    // Number of frames between two calibrations of the GPU clock against the CPU clock,
+    // to keep the drift between the two timelines small during long captures.
+    const UINT c_calibrationInterval = 120;
+}
+
+GpuProfiler::GpuProfiler() :
+    m_frameMilliseconds(0.0f),
+    m_frameIndex(0),
+    m_maxScopesPerFrame(0),
+    m_track(0),
+    m_gpuFrequency(1),
+    m_gpuCalibration(0),
+    m_cpuCalibrationNanoseconds(0),
+    m_calibrationCounter(0)
+{
+}
+
+void GpuProfiler::Initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT frameCount, UINT maxScopesPerFrame, const char* trackName)
+{
+    m_commandQueue = pCommandQueue;
+    m_maxScopesPerFrame = maxScopesPerFrame;
+    m_scopeNames.resize(frameCount);
+    m_frameTimed.assign(frameCount, false);
+    m_track = Profiler::CreateTrack(trackName);
+
+    // Two timestamps (begin and end) per scope, for every frame in flight, then two per
+    // frame in flight for the whole frame.
+    const UINT queryCount = 2 * (maxScopesPerFrame + 1) * frameCount;
+
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+    queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryHeapDesc.Count = queryCount;
+    ThrowIfFailed(pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap)));
+
+    ThrowIfFailed(pDevice->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(queryCount * sizeof(UINT64)),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&m_readbackBuffer)));
+
+    ThrowIfFailed(pCommandQueue->GetTimestampFrequency(&m_gpuFrequency));
+    Calibrate();
+}
+
+void GpuProfiler::BeginFrame(UINT frameIndex, ID3D12GraphicsCommandList* pCommandList)
+{
+    m_frameIndex = frameIndex;
+    std::vector<const char*>& names = m_scopeNames[frameIndex];
+
+    if (m_calibrationCounter++ % c_calibrationInterval == 0)
+    {
+        Calibrate();
+    }
+
+    const UINT frameQuery = GetFrameQuery(frameIndex);
+    if (m_frameTimed[frameIndex])
+    {
+        const CD3DX12_RANGE readRange(frameQuery * sizeof(UINT64), (frameQuery + 2) * sizeof(UINT64));
+        const CD3DX12_RANGE writtenRange(0, 0);
+
+        UINT8* pData;
+        ThrowIfFailed(m_readbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+        const UINT64* pTimestamps = reinterpret_cast<const UINT64*>(pData + readRange.Begin);
+        const UINT64 ticks = (pTimestamps[1] > pTimestamps[0]) ? pTimestamps[1] - pTimestamps[0] : 0;
+        m_readbackBuffer->Unmap(0, &writtenRange);
+
+        m_frameMilliseconds = static_cast<float>(static_cast<double>(ticks) * 1000.0 / static_cast<double>(m_gpuFrequency));
+    }
+    pCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameQuery);
+    m_frameTimed[frameIndex] = true;
+
+    if (!names.empty())
+    {
+        // The GPU has finished this frame, so its resolved timestamps can be read without waiting.
+        const UINT firstQuery = 2 * m_maxScopesPerFrame * frameIndex;
+        const CD3DX12_RANGE readRange(firstQuery * sizeof(UINT64), (firstQuery + 2 * names.size()) * sizeof(UINT64));
+        const CD3DX12_RANGE writtenRange(0, 0);
+
+        UINT8* pData;
+        ThrowIfFailed(m_readbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+        const UINT64* pTimestamps = reinterpret_cast<const UINT64*>(pData + readRange.Begin);
+
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            Profiler::RecordTrackEvent(m_track, names[i], GpuTicksToNanoseconds(pTimestamps[2 * i]), GpuTicksToNanoseconds(pTimestamps[2 * i + 1]));
+        }
+
+        m_readbackBuffer->Unmap(0, &writtenRange);
+        names.clear();
+    }
+}
+
+UINT GpuProfiler::BeginScope(ID3D12GraphicsCommandList* pCommandList, const char* name)
+{
+    std::vector<const char*>& names = m_scopeNames[m_frameIndex];
+    if (!Profiler::IsEnabled() || names.size() >= m_maxScopesPerFrame)
+    {
+        return InvalidScope;
+    }
+
+    const UINT scope = static_cast<UINT>(names.size());
+    names.push_back(name);
+
+    pCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * (m_maxScopesPerFrame * m_frameIndex + scope));
+    return scope;
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList* pCommandList, UINT scope)
+{
+    if (scope != InvalidScope)
+    {
+        pCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * (m_maxScopesPerFrame * m_frameIndex + scope) + 1);
+    }
+}
+
+void GpuProfiler::EndFrame(ID3D12GraphicsCommandList* pCommandList)
+{
+    const UINT frameQuery = GetFrameQuery(m_frameIndex);
+    pCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameQuery + 1);
+    pCommandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameQuery, 2, m_readbackBuffer.Get(), frameQuery * sizeof(UINT64));
+
+    const UINT scopeCount = static_cast<UINT>(m_scopeNames[m_frameIndex].size());
+    if (scopeCount > 0)
+    {
+        const UINT firstQuery = 2 * m_maxScopesPerFrame * m_frameIndex;
+        pCommandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, 2 * scopeCount, m_readbackBuffer.Get(), firstQuery * sizeof(UINT64));
+    }
+}
+
+// Take a GPU timestamp and the matching QueryPerformanceCounter value. std::chrono::steady_clock
+// is also built on QueryPerformanceCounter, so the result is in the Profiler's nanosecond domain.
+void GpuProfiler::Calibrate()
+{
+    UINT64 cpuTimestamp;
+    ThrowIfFailed(m_commandQueue->GetClockCalibration(&m_gpuCalibration, &cpuTimestamp));
+
+    LARGE_INTEGER cpuFrequency;
+    QueryPerformanceFrequency(&cpuFrequency);
+    const UINT64 frequency = static_cast<UINT64>(cpuFrequency.QuadPart);
+
+    m_cpuCalibrationNanoseconds = (cpuTimestamp / frequency) * 1000000000 + (cpuTimestamp % frequency) * 1000000000 / frequency;
+}
+
+UINT GpuProfiler::GetFrameQuery(UINT frameIndex) const
+{
+    return 2 * (m_maxScopesPerFrame * static_cast<UINT>(m_scopeNames.size()) + frameIndex);
+}
+
+UINT64 GpuProfiler::GpuTicksToNanoseconds(UINT64 gpuTimestamp) const
+{
+    // Timestamps of queued frames can be older than the calibration.
+    const INT64 ticks = static_cast<INT64>(gpuTimestamp - m_gpuCalibration);
+    const double nanoseconds = static_cast<double>(ticks) * 1000000000.0 / static_cast<double>(m_gpuFrequency);
+    return m_cpuCalibrationNanoseconds + static_cast<INT64>(nanoseconds);
+}
@@ -0,0 +1,97 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "Profiler.h"
+
+// Measures the GPU time of command list ranges with timestamp queries.
+// Each frame in flight resolves its queries into its own part of a readback buffer,
+// which is only read once the fence of that frame has been reached, so reading the
+// results never stalls. The measured ranges are added to a Profiler track, converted
+// to the CPU timeline.
+// The GPU time of the whole frame is always measured, even when the Profiler is disabled,
+// and comes back FrameCount frames later, like the scopes.
+class GpuProfiler
+{
+public:
+    static const UINT InvalidScope = 0xffffffff;
+
+    GpuProfiler();
+
+    void Initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT frameCount, UINT maxScopesPerFrame, const char* trackName);
+
+    // Call first thing in the command list of a frame, once the GPU has finished the
+    // previous frame that used frameIndex.
+    void BeginFrame(UINT frameIndex, ID3D12GraphicsCommandList* pCommandList);
+
+    // Scopes are ignored when the Profiler is disabled or the frame already has maxScopesPerFrame scopes.
+    UINT BeginScope(ID3D12GraphicsCommandList* pCommandList, const char* name);
+    void EndScope(ID3D12GraphicsCommandList* pCommandList, UINT scope);
+
+    // Resolve the queries of the frame. Must be the last profiler call recorded in the frame.
+    void EndFrame(ID3D12GraphicsCommandList* pCommandList);
+
+    // GPU time of the frame read back by the last BeginFrame(), in milliseconds, or 0
+    // when there is none yet.
+    float GetFrameMilliseconds() const  { return m_frameMilliseconds; }
+
+private:
+    void Calibrate();
+    UINT GetFrameQuery(UINT frameIndex) const;      // First of the two queries of the whole frame.
+    UINT64 GpuTicksToNanoseconds(UINT64 gpuTimestamp) const;
+
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_queryHeap;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_readbackBuffer;
+    std::vector<std::vector<const char*>> m_scopeNames;    // Names of the scopes of each frame in flight.
+    std::vector<bool> m_frameTimed;                         // Whether each frame in flight measured its time.
+    float m_frameMilliseconds;
+    UINT m_frameIndex;
+    UINT m_maxScopesPerFrame;
+    uint32_t m_track;
+
+    // Clock calibration: a GPU timestamp and the CPU time, in nanoseconds, when it was taken.
+    UINT64 m_gpuFrequency;
+    UINT64 m_gpuCalibration;
+    UINT64 m_cpuCalibrationNanoseconds;
+    UINT m_calibrationCounter;
+};
+
+// Measures the GPU time of the commands recorded during its lifetime.
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* pCommandList, const char* name) :
+        m_profiler(profiler),
+        m_pCommandList(pCommandList),
+        m_scope(profiler.BeginScope(pCommandList, name))
+    {
+    }
+
+    ~GpuProfileScope()
+    {
+        m_profiler.EndScope(m_pCommandList, m_scope);
+    }
+
+private:
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+    GpuProfiler& m_profiler;
+    ID3D12GraphicsCommandList* m_pCommandList;
+    UINT m_scope;
+};
+
+// Profile the rest of the enclosing block on both the CPU and the GPU timelines.
+#define PROFILE_GPU_SCOPE(profiler, commandList, name) \
+    PROFILE_SCOPE(name); \
+    GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(profiler, commandList, name)
@@ -0,0 +1,231 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MirrorClipping.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    float Dot(const float a[3], const float b[3])
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    float PlaneDistance(const float plane[4], const float point[3])
+    {
+        return Dot(plane, point) + plane[3];
+    }
+
+    // Plane through a point; its normal is normalized, and flipped to put inside on the positive side.
+    void SetPlane(float plane[4], const float normal[3], const float point[3], const float inside[3])
+    {
+        const float length = std::sqrt(Dot(normal, normal));
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            plane[axis] = normal[axis] / length;
+        }
+        plane[3] = -Dot(plane, point);
+        if (PlaneDistance(plane, inside) < 0.0f)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                plane[i] = -plane[i];
+            }
+        }
+    }
+}
+
+bool GetMirrorScissorRect(const float viewProjection[16], const float (*pCorners)[3], uint32_t cornerCount,
+    uint32_t width, uint32_t height, MirrorScissorRect* pRect)
+{
+    // Clip the polygon against the near plane (z >= 0), so that w is positive; the other
+    // planes are applied by clamping the bounds to the viewport.
+    const uint32_t maxVertexCount = 2 * MirrorFrustum::MaxCornerCount;
+    if (cornerCount < 3 || cornerCount > MirrorFrustum::MaxCornerCount)
+    {
+        return false;
+    }
+
+    float clip[MirrorFrustum::MaxCornerCount][4];
+    for (uint32_t i = 0; i < cornerCount; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            clip[i][c] = pCorners[i][0] * viewProjection[c] + pCorners[i][1] * viewProjection[4 + c] +
+                pCorners[i][2] * viewProjection[8 + c] + viewProjection[12 + c];
+        }
+    }
+
+    float clipped[maxVertexCount][4];
+    uint32_t clippedCount = 0;
+    for (uint32_t i = 0; i < cornerCount; ++i)
+    {
+        const float* a = clip[i];
+        const float* b = clip[(i + 1) % cornerCount];
+        if (a[2] >= 0.0f)
+        {
+            std::copy(a, a + 4, clipped[clippedCount++]);
+        }
+        if ((a[2] >= 0.0f) != (b[2] >= 0.0f))
+        {
+            const float t = a[2] / (a[2] - b[2]);
+            for (int c = 0; c < 4; ++c)
+            {
+                clipped[clippedCount][c] = a[c] + (b[c] - a[c]) * t;
+            }
+            ++clippedCount;
+        }
+    }
+
+    float minX = static_cast<float>(width);
+    float minY = static_cast<float>(height);
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+    for (uint32_t i = 0; i < clippedCount; ++i)
+    {
+        const float w = clipped[i][3];
+        if (!(w > 0.0f))
+        {
+            continue;
+        }
+        const float x = (clipped[i][0] / w * 0.5f + 0.5f) * width;
+        const float y = (0.5f - clipped[i][1] / w * 0.5f) * height;
+        minX = (std::min)(minX, x);
+        minY = (std::min)(minY, y);
+        maxX = (std::max)(maxX, x);
+        maxY = (std::max)(maxY, y);
+    }
+
+    // Round outward, and clamp to the viewport.
+    pRect->left = static_cast<int32_t>(std::floor((std::max)(minX, 0.0f)));
+    pRect->top = static_cast<int32_t>(std::floor((std::max)(minY, 0.0f)));
+    pRect->right = static_cast<int32_t>(std::ceil((std::min)(maxX, static_cast<float>(width))));
+    pRect->bottom = static_cast<int32_t>(std::ceil((std::min)(maxY, static_cast<float>(height))));
+    return pRect->left < pRect->right && pRect->top < pRect->bottom;
+}
+
+MirrorFrustum::MirrorFrustum() :
+    m_planes{},
+    m_planeCount(0)
+{
+}
+
+bool MirrorFrustum::Build(const float eye[3], const float (*pCorners)[3], uint32_t cornerCount)
+{
+    m_planeCount = 0;
+    if (cornerCount < 3 || cornerCount > MaxCornerCount)
+    {
+        return false;
+    }
+
+    // Newell's normal, which is robust to nearly collinear corners.
+    float normal[3] = {};
+    float centroid[3] = {};
+    for (uint32_t i = 0; i < cornerCount; ++i)
+    {
+        const float* a = pCorners[i];
+        const float* b = pCorners[(i + 1) % cornerCount];
+        normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+        normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+        normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            centroid[axis] += a[axis] / cornerCount;
+        }
+    }
+    if (Dot(normal, normal) == 0.0f)
+    {
+        return false;
+    }
+
+    // The mirror plane faces away from the eye.
+    SetPlane(m_planes[0], normal, centroid, eye);
+    const float eyeDistance = PlaneDistance(m_planes[0], eye);
+    if (std::fabs(eyeDistance) < 1e-6f)
+    {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        m_planes[0][i] = -m_planes[0][i];
+    }
+
+    // A plane through the eye and each edge, facing the center of the mirror.
+    for (uint32_t i = 0; i < cornerCount; ++i)
+    {
+        const float* a = pCorners[i];
+        const float* b = pCorners[(i + 1) % cornerCount];
+        const float toA[3] = { a[0] - eye[0], a[1] - eye[1], a[2] - eye[2] };
+        const float toB[3] = { b[0] - eye[0], b[1] - eye[1], b[2] - eye[2] };
+        const float edgeNormal[3] =
+        {
+            toA[1] * toB[2] - toA[2] * toB[1],
+            toA[2] * toB[0] - toA[0] * toB[2],
+            toA[0] * toB[1] - toA[1] * toB[0]
+        };
+        if (Dot(edgeNormal, edgeNormal) == 0.0f)
+        {
+            // The eye is in line with the edge: the other planes bound the frustum.
+            std::fill(m_planes[1 + i], m_planes[1 + i] + 4, 0.0f);
+            continue;
+        }
+        SetPlane(m_planes[1 + i], edgeNormal, eye, centroid);
+    }
+    m_planeCount = 1 + cornerCount;
+    return true;
+}
+
+bool MirrorFrustum::Intersects(const float center[3], float radius) const
+{
+    if (m_planeCount == 0)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < m_planeCount; ++i)
+    {
+        if (PlaneDistance(m_planes[i], center) < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MakeObliqueProjection(float projection[16], const float viewPlane[4])
+{
+    // The view-space point behind the corner of the far plane opposite the new near plane
+    // (Lengyel): it keeps its clip-space position, so the far plane still goes through it.
+    // In clip space it is (sign(a), sign(b), 1, 1); the projection of a left-handed
+    // perspective matrix puts z in column 3 and w = view z.
+    const float q[4] =
+    {
+        ((viewPlane[0] > 0.0f ? 1.0f : viewPlane[0] < 0.0f ? -1.0f : 0.0f) - projection[8]) / projection[0],
+        ((viewPlane[1] > 0.0f ? 1.0f : viewPlane[1] < 0.0f ? -1.0f : 0.0f) - projection[9]) / projection[5],
+        1.0f,
+        (1.0f - projection[10]) / projection[14]
+    };
+
+    // The clip-space z of a point is its distance to the plane, scaled so that z == w at q.
+    const float distance = viewPlane[0] * q[0] + viewPlane[1] * q[1] + viewPlane[2] * q[2] + viewPlane[3] * q[3];
+    if (!(distance > 0.0f))
+    {
+        return false;
+    }
+
+    const float scale = 1.0f / distance;
+    projection[2] = viewPlane[0] * scale;
+    projection[6] = viewPlane[1] * scale;
+    projection[10] = viewPlane[2] * scale;
+    projection[14] = viewPlane[3] * scale;
+    return true;
+}
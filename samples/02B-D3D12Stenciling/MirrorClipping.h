@@ -0,0 +1,64 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Helpers restricting the reflection pass of a planar mirror to what the mirror can show.
+// A mirror is a convex polygon of world-space corners; each mirror of a scene gets its own
+// scissor rectangle, frustum and projection. Matrices are in the DirectXMath layout (row
+// vectors), and planes are (a, b, c, d) with a point p inside when a*x + b*y + c*z + d >= 0.
+
+// Pixel rectangle, right and bottom excluded.
+struct MirrorScissorRect
+{
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+// Bounds of the pixels covered by the mirror, clipped to the viewport. Returns false when
+// the mirror is entirely outside the view frustum, or behind the camera.
+bool GetMirrorScissorRect(const float viewProjection[16], const float (*pCorners)[3], uint32_t cornerCount,
+    uint32_t width, uint32_t height, MirrorScissorRect* pRect);
+
+// Volume in which the reflected objects can be seen through a mirror: the pyramid from the
+// eye through the edges of the mirror, beyond the mirror plane.
+class MirrorFrustum
+{
+public:
+    static const uint32_t MaxCornerCount = 8;
+
+    MirrorFrustum();
+
+    // Returns false when the eye is in the mirror plane, or the mirror has too many corners
+    // or no area. The mirror can be seen from both sides.
+    bool Build(const float eye[3], const float (*pCorners)[3], uint32_t cornerCount);
+
+    // Whether a world-space sphere of the reflected scene may be visible in the mirror.
+    bool Intersects(const float center[3], float radius) const;
+
+    // Mirror plane, facing away from the eye: the reflected scene is on its positive side.
+    const float* GetMirrorPlane() const { return m_planes[0]; }
+
+private:
+    float m_planes[MaxCornerCount + 1][4];      // The mirror plane, then one per edge.
+    uint32_t m_planeCount;
+};
+
+// Replaces the near plane of a left-handed perspective projection with a view-space plane,
+// so that everything on its negative side is clipped. The far plane is tilted as little as
+// possible so that the view frustum still fits between the two. The plane must face away
+// from the eye (d < 0). Returns false, and leaves the matrix unchanged, when the view
+// frustum is entirely on the negative side of the plane.
+bool MakeObliqueProjection(float projection[16], const float viewPlane[4]);
@@ -0,0 +1,267 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Profiler.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Profiler::s_enabled(false);
+
+namespace
+{
+    // Ring of events written by a single thread at a time and read by the exporter.
+    // Fields are relaxed atomics so that a slot overwritten during an export is a
+    // well-defined (and discarded) read instead of a data race.
+    struct EventBuffer
+    {
+        struct Slot
+        {
+            std::atomic<const char*> name;
+            std::atomic<uint64_t> beginTimestamp;
+            std::atomic<uint64_t> endTimestamp;
+        };
+
+        EventBuffer(uint32_t id, const std::string& bufferName, bool nanoseconds) :
+            trackId(id),
+            name(bufferName),
+            usesNanoseconds(nanoseconds),
+            slots(new Slot[Profiler::EventCapacity]),
+            writeIndex(0)
+        {
+        }
+
+        void Record(const char* eventName, uint64_t beginTimestamp, uint64_t endTimestamp)
+        {
+            const uint64_t index = writeIndex.load(std::memory_order_relaxed);
+            Slot& slot = slots[index & (Profiler::EventCapacity - 1)];
+            slot.name.store(eventName, std::memory_order_relaxed);
+            slot.beginTimestamp.store(beginTimestamp, std::memory_order_relaxed);
+            slot.endTimestamp.store(endTimestamp, std::memory_order_relaxed);
+            writeIndex.store(index + 1, std::memory_order_release);
+        }
+
+        uint32_t trackId;
+        std::string name;
+        bool usesNanoseconds;   // Tracks use GetNanoseconds(), threads GetTimestamp().
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<uint64_t> writeIndex;
+    };
+
+    struct ExportedEvent
+    {
+        const char* name;
+        uint64_t beginTimestamp;
+        uint64_t endTimestamp;
+    };
+
+    // Pair of readings of the two clocks, used to convert timestamps to nanoseconds.
+    struct ClockCalibration
+    {
+        uint64_t timestamp;
+        uint64_t nanoseconds;
+
+        static ClockCalibration Now()
+        {
+            ClockCalibration calibration;
+            calibration.timestamp = Profiler::GetTimestamp();
+            calibration.nanoseconds = Profiler::GetNanoseconds();
+            return calibration;
+        }
+    };
+
+    const ClockCalibration s_startCalibration = ClockCalibration::Now();
+
+    // Buffers are never freed, so the events of threads that have exited can still be exported.
+    std::mutex s_buffersMutex;
+    std::deque<std::unique_ptr<EventBuffer>> s_buffers;
+
+    thread_local EventBuffer* t_threadBuffer = nullptr;
+
+    // Buffers of threads that haven't been named are called "Thread <id>".
+    EventBuffer* CreateBuffer(const char* name, bool usesNanoseconds)
+    {
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+        const uint32_t id = static_cast<uint32_t>(s_buffers.size());
+        s_buffers.emplace_back(new EventBuffer(id, name != nullptr ? std::string(name) : "Thread " + std::to_string(id), usesNanoseconds));
+        return s_buffers.back().get();
+    }
+
+    EventBuffer* GetThreadBuffer()
+    {
+        if (t_threadBuffer == nullptr)
+        {
+            t_threadBuffer = CreateBuffer(nullptr, false);
+        }
+        return t_threadBuffer;
+    }
+
+    // Copy the events still held by a buffer, dropping the ones overwritten while copying.
+    void CopyEvents(const EventBuffer& buffer, std::vector<ExportedEvent>& events)
+    {
+        const uint64_t end = buffer.writeIndex.load(std::memory_order_acquire);
+        const uint64_t count = (std::min<uint64_t>)(end, Profiler::EventCapacity);
+
+        events.resize(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            const EventBuffer::Slot& slot = buffer.slots[(end - count + i) & (Profiler::EventCapacity - 1)];
+            ExportedEvent& event = events[static_cast<size_t>(i)];
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.beginTimestamp = slot.beginTimestamp.load(std::memory_order_relaxed);
+            event.endTimestamp = slot.endTimestamp.load(std::memory_order_relaxed);
+        }
+
+        const uint64_t newEnd = buffer.writeIndex.load(std::memory_order_acquire);
+        const uint64_t overwritten = (std::min<uint64_t>)(count, newEnd - end);
+        events.erase(events.begin(), events.begin() + static_cast<size_t>(overwritten));
+    }
+
+    // Chrome trace timestamps are in microseconds.
+    void WriteMicroseconds(std::ostream& stream, uint64_t nanoseconds)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%llu.%03u",
+            static_cast<unsigned long long>(nanoseconds / 1000), static_cast<unsigned int>(nanoseconds % 1000));
+        stream << text;
+    }
+
+    void WriteTraceEvent(std::ostream& stream, const ExportedEvent& event, char phase, uint32_t trackId, uint64_t nanoseconds)
+    {
+        stream << ",\n{\"name\":";
+        WriteJsonString(stream, event.name);
+        stream << ",\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":" << trackId << ",\"ts\":";
+        WriteMicroseconds(stream, nanoseconds);
+        stream << '}';
+    }
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    EventBuffer* buffer = GetThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    buffer->name = name;
+}
+
+void Profiler::RecordEvent(const char* name, uint64_t beginTimestamp, uint64_t endTimestamp)
+{
+    GetThreadBuffer()->Record(name, beginTimestamp, endTimestamp);
+}
+
+uint32_t Profiler::CreateTrack(const char* name)
+{
+    return CreateBuffer(name, true)->trackId;
+}
+
+void Profiler::RecordTrackEvent(uint32_t track, const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds)
+{
+    EventBuffer* buffer;
+    {
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+        buffer = s_buffers[track].get();
+    }
+    buffer->Record(name, beginNanoseconds, endNanoseconds);
+}
+
+void Profiler::WriteChromeTrace(std::ostream& stream)
+{
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+    // The rate of the timestamps is measured over the whole run.
+    const ClockCalibration endCalibration = ClockCalibration::Now();
+    const double nanosecondsPerTick = endCalibration.timestamp != s_startCalibration.timestamp ?
+        static_cast<double>(endCalibration.nanoseconds - s_startCalibration.nanoseconds) / (endCalibration.timestamp - s_startCalibration.timestamp) : 1.0;
+
+    std::vector<std::vector<ExportedEvent>> events(s_buffers.size());
+    uint64_t firstTimestamp = UINT64_MAX;
+    for (size_t i = 0; i < s_buffers.size(); ++i)
+    {
+        CopyEvents(*s_buffers[i], events[i]);
+        for (ExportedEvent& event : events[i])
+        {
+            if (!s_buffers[i]->usesNanoseconds)
+            {
+                const double begin = (static_cast<int64_t>(event.beginTimestamp - s_startCalibration.timestamp)) * nanosecondsPerTick;
+                const double end = (static_cast<int64_t>(event.endTimestamp - s_startCalibration.timestamp)) * nanosecondsPerTick;
+                event.beginTimestamp = s_startCalibration.nanoseconds + static_cast<int64_t>(begin);
+                event.endTimestamp = s_startCalibration.nanoseconds + static_cast<int64_t>(end);
+            }
+            firstTimestamp = (std::min)(firstTimestamp, event.beginTimestamp);
+        }
+    }
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    for (size_t i = 0; i < s_buffers.size(); ++i)
+    {
+        stream << (first ? "\n" : ",\n");
+        first = false;
+
+        // Metadata event naming the track.
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << s_buffers[i]->trackId << ",\"args\":{\"name\":";
+        WriteJsonString(stream, s_buffers[i]->name.c_str());
+        stream << "}}";
+
+        // Begin and end events, in the order of their times. The scopes of a track nest,
+        // except for the rounding of the timestamp conversion, which the clamp to the end
+        // of the enclosing scope undoes.
+        std::vector<ExportedEvent>& trackEvents = events[i];
+        std::sort(trackEvents.begin(), trackEvents.end(), [](const ExportedEvent& a, const ExportedEvent& b)
+        {
+            return a.beginTimestamp != b.beginTimestamp ? a.beginTimestamp < b.beginTimestamp : a.endTimestamp > b.endTimestamp;
+        });
+
+        std::vector<const ExportedEvent*> openEvents;
+        for (ExportedEvent& event : trackEvents)
+        {
+            while (!openEvents.empty() && openEvents.back()->endTimestamp <= event.beginTimestamp)
+            {
+                WriteTraceEvent(stream, *openEvents.back(), 'E', s_buffers[i]->trackId, openEvents.back()->endTimestamp - firstTimestamp);
+                openEvents.pop_back();
+            }
+            event.endTimestamp = (std::max)(event.endTimestamp, event.beginTimestamp);
+            if (!openEvents.empty())
+            {
+                event.endTimestamp = (std::min)(event.endTimestamp, openEvents.back()->endTimestamp);
+            }
+            WriteTraceEvent(stream, event, 'B', s_buffers[i]->trackId, event.beginTimestamp - firstTimestamp);
+            openEvents.push_back(&event);
+        }
+        while (!openEvents.empty())
+        {
+            WriteTraceEvent(stream, *openEvents.back(), 'E', s_buffers[i]->trackId, openEvents.back()->endTimestamp - firstTimestamp);
+            openEvents.pop_back();
+        }
+    }
+
+    stream << "\n]}\n";
+}
+
+bool Profiler::SaveChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    WriteChromeTrace(file);
+    return static_cast<bool>(file);
+}
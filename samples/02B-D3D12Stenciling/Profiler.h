@@ -0,0 +1,113 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_USE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_TSC 1
+#endif
+
+// Lightweight CPU profiler.
+// Every thread records its scopes into its own ring buffer, so recording never takes a
+// lock; only registering a new thread or track and exporting do. Events are kept until
+// they are overwritten by newer ones, and can be exported at any time in the Chrome
+// trace event format (chrome://tracing, https://ui.perfetto.dev).
+// Events of other timelines, like the GPU queue, are recorded into named tracks.
+class Profiler
+{
+public:
+    // Number of events kept per thread or track. Must be a power of two.
+    static const uint32_t EventCapacity = 1u << 16;
+
+    static void SetEnabled(bool enabled)    { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool IsEnabled()                 { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Timestamp of the scopes. On x86/x64 this is the (invariant) time-stamp counter, which is
+    // about twice as cheap to read as the OS clock; elsewhere it is GetNanoseconds().
+    // Timestamps are converted to nanoseconds when the trace is exported.
+    static uint64_t GetTimestamp()
+    {
+#if defined(PROFILER_USE_TSC)
+        return __rdtsc();
+#else
+        return GetNanoseconds();
+#endif
+    }
+
+    // Monotonic time in nanoseconds, in the domain of std::chrono::steady_clock.
+    static uint64_t GetNanoseconds()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Name shown for the calling thread in the trace. The string is copied.
+    static void SetThreadName(const char* name);
+
+    // Record an event on the calling thread, with times from GetTimestamp().
+    // The name must outlive the profiler (a string literal).
+    static void RecordEvent(const char* name, uint64_t beginTimestamp, uint64_t endTimestamp);
+
+    // Create a timeline that is not tied to a thread. A track must be written by one thread at a time,
+    // and recording into it takes a short lock, so it is meant for a few events per frame.
+    // Track events are timed with GetNanoseconds(), which other clocks are easily calibrated against.
+    static uint32_t CreateTrack(const char* name);
+    static void RecordTrackEvent(uint32_t track, const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds);
+
+    // Export every event still in the buffers as Chrome trace event JSON.
+    static void WriteChromeTrace(std::ostream& stream);
+    static bool SaveChromeTrace(const std::string& path);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+// Records the time spent between its construction and destruction.
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) :
+        m_name(name),
+        m_beginTimestamp(Profiler::IsEnabled() ? Profiler::GetTimestamp() : 0)
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (m_beginTimestamp != 0)
+        {
+            Profiler::RecordEvent(m_name, m_beginTimestamp, Profiler::GetTimestamp());
+        }
+    }
+
+private:
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    const char* m_name;
+    uint64_t m_beginTimestamp;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+// Profile the rest of the enclosing block.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
@@ -0,0 +1,245 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    float Dot(const float a[3], const float b[3])
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void Cross(const float a[3], const float b[3], float result[3])
+    {
+        result[0] = a[1] * b[2] - a[2] * b[1];
+        result[1] = a[2] * b[0] - a[0] * b[2];
+        result[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    void Normalize(float v[3])
+    {
+        const float length = std::sqrt(Dot(v, v));
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+ShadowCascades::ShadowCascades() :
+    m_cascades{},
+    m_lightRight{},
+    m_lightUp{},
+    m_lightForward{},
+    m_cacheValid(false),
+    m_cachedLightDirection{}
+{
+}
+
+void ShadowCascades::SetDesc(const ShadowCascadeDesc& desc)
+{
+    if (desc.cascadeCount == 0 || desc.cascadeCount > MaxCascadeCount || desc.resolution < 2 ||
+        !(desc.splitLambda >= 0.0f && desc.splitLambda <= 1.0f) || !(desc.shadowDistance > 0.0f) ||
+        !(desc.cachedCascadePadding >= 0.0f))
+    {
+        throw std::runtime_error("ShadowCascades: invalid settings");
+    }
+
+    m_desc = desc;
+    m_cacheValid = false;
+}
+
+void ShadowCascades::Update(const ShadowCamera& camera, const float lightDirection[3], const ShadowSphere& sceneBounds)
+{
+    if (!(camera.nearZ > 0.0f && camera.nearZ < m_desc.shadowDistance))
+    {
+        throw std::runtime_error("ShadowCascades: the near plane must be between zero and the shadow distance");
+    }
+
+    // The light looks along the opposite of its direction. The basis only depends on the
+    // light, so the camera never rotates the texel grid.
+    float light[3] = { lightDirection[0], lightDirection[1], lightDirection[2] };
+    Normalize(light);
+    if (light[0] != m_cachedLightDirection[0] || light[1] != m_cachedLightDirection[1] || light[2] != m_cachedLightDirection[2])
+    {
+        m_cacheValid = false;
+    }
+
+    m_lightForward[0] = -light[0];
+    m_lightForward[1] = -light[1];
+    m_lightForward[2] = -light[2];
+    const float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+    const float worldForward[3] = { 0.0f, 0.0f, 1.0f };
+    Cross(std::fabs(m_lightForward[1]) < 0.99f ? worldUp : worldForward, m_lightForward, m_lightRight);
+    Normalize(m_lightRight);
+    Cross(m_lightForward, m_lightRight, m_lightUp);
+
+    const float sceneNearZ = Dot(m_lightForward, sceneBounds.center) - sceneBounds.radius;
+
+    float splits[MaxCascadeCount + 1];
+    ComputeSplits(m_desc.cascadeCount, camera.nearZ, m_desc.shadowDistance, m_desc.splitLambda, splits);
+
+    for (uint32_t i = 0; i < m_desc.cascadeCount; ++i)
+    {
+        ShadowCascade& cascade = m_cascades[i];
+
+        float centerZ;
+        float radius;
+        GetFrustumSliceSphere(camera.tanHalfFovX, camera.tanHalfFovY, splits[i], splits[i + 1], &centerZ, &radius);
+
+        float center[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            center[axis] = camera.position[axis] + camera.forward[axis] * centerZ;
+        }
+        const float lightX = Dot(m_lightRight, center);
+        const float lightY = Dot(m_lightUp, center);
+        const float lightZ = Dot(m_lightForward, center);
+
+        cascade.splitNear = splits[i];
+        cascade.splitFar = splits[i + 1];
+
+        if (IsCached(i))
+        {
+            // Keep the cached cascade while the padded sphere it was fitted to still
+            // contains the frustum slice and the scene.
+            if (m_cacheValid)
+            {
+                const float dx = lightX - cascade.centerX;
+                const float dy = lightY - cascade.centerY;
+                const float dz = lightZ - (cascade.farZ - cascade.radius);
+                if (std::sqrt(dx * dx + dy * dy + dz * dz) + radius <= cascade.radius && sceneNearZ >= cascade.nearZ)
+                {
+                    cascade.needsRender = false;
+                    continue;
+                }
+            }
+            radius *= 1.0f + m_desc.cachedCascadePadding;
+        }
+
+        // Move the center by whole texels, so that the texels keep their place in the world.
+        // The center moves by up to half a texel, which the radius makes room for.
+        radius *= static_cast<float>(m_desc.resolution) / (m_desc.resolution - 1);
+        const float texelSize = 2.0f * radius / m_desc.resolution;
+        cascade.centerX = std::floor(lightX / texelSize + 0.5f) * texelSize;
+        cascade.centerY = std::floor(lightY / texelSize + 0.5f) * texelSize;
+        cascade.radius = radius;
+        cascade.texelSize = texelSize;
+
+        // The casters between the light and the slice must be in front of the near plane.
+        cascade.farZ = lightZ + radius;
+        cascade.nearZ = (std::min)(lightZ - radius, sceneNearZ);
+        cascade.needsRender = true;
+
+        const float depthRange = cascade.farZ - cascade.nearZ;
+        float* m = cascade.viewProjection;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            m[axis * 4 + 0] = m_lightRight[axis] / radius;
+            m[axis * 4 + 1] = m_lightUp[axis] / radius;
+            m[axis * 4 + 2] = m_lightForward[axis] / depthRange;
+            m[axis * 4 + 3] = 0.0f;
+        }
+        m[12] = -cascade.centerX / radius;
+        m[13] = -cascade.centerY / radius;
+        m[14] = -cascade.nearZ / depthRange;
+        m[15] = 1.0f;
+    }
+
+    m_cacheValid = true;
+    m_cachedLightDirection[0] = light[0];
+    m_cachedLightDirection[1] = light[1];
+    m_cachedLightDirection[2] = light[2];
+}
+
+void ShadowCascades::CullCasters(uint32_t cascade, const ShadowSphere* pCasters, uint32_t casterCount, std::vector<uint32_t>& visible) const
+{
+    const ShadowCascade& bounds = m_cascades[cascade];
+    for (uint32_t i = 0; i < casterCount; ++i)
+    {
+        const ShadowSphere& caster = pCasters[i];
+        const float extent = bounds.radius + caster.radius;
+        const float z = Dot(m_lightForward, caster.center);
+        if (std::fabs(Dot(m_lightRight, caster.center) - bounds.centerX) <= extent &&
+            std::fabs(Dot(m_lightUp, caster.center) - bounds.centerY) <= extent &&
+            z - caster.radius <= bounds.farZ && z + caster.radius >= bounds.nearZ)
+        {
+            visible.push_back(i);
+        }
+    }
+}
+
+void ShadowCascades::ComputeSplits(uint32_t cascadeCount, float nearZ, float farZ, float lambda, float* splits)
+{
+    splits[0] = nearZ;
+    for (uint32_t i = 1; i < cascadeCount; ++i)
+    {
+        const float t = static_cast<float>(i) / cascadeCount;
+        const float logSplit = nearZ * std::pow(farZ / nearZ, t);
+        const float uniformSplit = nearZ + (farZ - nearZ) * t;
+        splits[i] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+    }
+    splits[cascadeCount] = farZ;
+}
+
+void ShadowCascades::GetFrustumSliceSphere(float tanHalfFovX, float tanHalfFovY, float nearZ, float farZ, float* pCenterZ, float* pRadius)
+{
+    // The center is as far from the near corners as from the far corners, unless that
+    // puts it beyond the far plane: the sphere around the far rectangle then holds the
+    // near one as well.
+    const float slope = tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY;
+    const float centerZ = 0.5f * (nearZ + farZ) * (1.0f + slope);
+    if (centerZ >= farZ)
+    {
+        *pCenterZ = farZ;
+        *pRadius = farZ * std::sqrt(slope);
+    }
+    else
+    {
+        *pCenterZ = centerZ;
+        *pRadius = std::sqrt(farZ * farZ * slope + (farZ - centerZ) * (farZ - centerZ));
+    }
+}
+
+ShadowSphere ShadowCascades::GetBoundingSphere(const ShadowSphere* pSpheres, uint32_t count)
+{
+    ShadowSphere bounds = {};
+    if (count == 0)
+    {
+        return bounds;
+    }
+
+    // Center of the bounding box of the spheres.
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float lo = pSpheres[0].center[axis] - pSpheres[0].radius;
+        float hi = pSpheres[0].center[axis] + pSpheres[0].radius;
+        for (uint32_t i = 1; i < count; ++i)
+        {
+            lo = (std::min)(lo, pSpheres[i].center[axis] - pSpheres[i].radius);
+            hi = (std::max)(hi, pSpheres[i].center[axis] + pSpheres[i].radius);
+        }
+        bounds.center[axis] = 0.5f * (lo + hi);
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float dx = pSpheres[i].center[0] - bounds.center[0];
+        const float dy = pSpheres[i].center[1] - bounds.center[1];
+        const float dz = pSpheres[i].center[2] - bounds.center[2];
+        bounds.radius = (std::max)(bounds.radius, std::sqrt(dx * dx + dy * dy + dz * dz) + pSpheres[i].radius);
+    }
+    return bounds;
+}
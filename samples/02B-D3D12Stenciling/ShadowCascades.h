@@ -0,0 +1,134 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Settings of the cascaded shadow map of a directional light.
+struct ShadowCascadeDesc
+{
+    uint32_t cascadeCount = 4;          // At most ShadowCascades::MaxCascadeCount.
+    uint32_t resolution = 2048;         // Width and height of each cascade in texels.
+
+    // Blend between uniform (0) and logarithmic (1) split distances.
+    float splitLambda = 0.6f;
+
+    // View-space depth covered by the last cascade.
+    float shadowDistance = 40.0f;
+
+    // The last cascade only draws the static casters when its matrix or the static
+    // content changes, and the cached depth is reused by the following frames. Its
+    // bounding sphere is enlarged by this fraction so that the camera can move a little
+    // without invalidating it.
+    bool cacheLastCascade = true;
+    float cachedCascadePadding = 0.25f;
+};
+
+// World-space bounding sphere.
+struct ShadowSphere
+{
+    float center[3];
+    float radius;
+};
+
+// Camera whose frustum the cascades cover. The axes must be orthonormal, and form a
+// left-handed basis (forward looks into the screen).
+struct ShadowCamera
+{
+    float position[3];
+    float right[3];
+    float up[3];
+    float forward[3];
+    float tanHalfFovX;
+    float tanHalfFovY;
+    float nearZ;
+};
+
+struct ShadowCascade
+{
+    // World to clip space of the light, for row vectors (the DirectXMath layout).
+    // x and y map to [-1, 1] across the cascade, and depth to [0, 1].
+    float viewProjection[16];
+
+    // View-space depth range of the camera frustum slice covered by the cascade.
+    float splitNear;
+    float splitFar;
+
+    // Light-space bounding box of the cascade: the texel-snapped center and radius of
+    // the bounding sphere of the frustum slice, and the depth range.
+    float centerX;
+    float centerY;
+    float radius;
+    float nearZ;
+    float farZ;
+
+    // World-space size of a texel.
+    float texelSize;
+
+    // False when the cascade is cached, and its depth from a previous frame is still valid.
+    bool needsRender;
+};
+
+// Fits the cascades of a directional light shadow map to the camera frustum.
+// Each cascade is fitted to the bounding sphere of its slice of the frustum, whose size
+// doesn't depend on the orientation of the camera, and its center is snapped to whole
+// texels in light space: the texels of a cascade don't move relative to the world while
+// the camera moves or turns, so the shadow edges don't shimmer.
+class ShadowCascades
+{
+public:
+    static const uint32_t MaxCascadeCount = 4;
+
+    ShadowCascades();
+
+    // Throws std::runtime_error when the settings are out of range.
+    void SetDesc(const ShadowCascadeDesc& desc);
+    const ShadowCascadeDesc& GetDesc() const { return m_desc; }
+
+    // Fits the cascades. The light direction points toward the light; the scene bounds
+    // must contain every caster, so that the casters in front of the frustum slices are
+    // inside the depth range of the cascades.
+    void Update(const ShadowCamera& camera, const float lightDirection[3], const ShadowSphere& sceneBounds);
+
+    // Forces the cached cascade to be redrawn, after the static casters changed.
+    void InvalidateCache() { m_cacheValid = false; }
+
+    uint32_t GetCascadeCount() const                { return m_desc.cascadeCount; }
+    const ShadowCascade& GetCascade(uint32_t index) const { return m_cascades[index]; }
+    bool IsCached(uint32_t index) const             { return m_desc.cacheLastCascade && index + 1 == m_desc.cascadeCount; }
+
+    // Appends to visible the indices of the spheres that overlap a cascade.
+    void CullCasters(uint32_t cascade, const ShadowSphere* pCasters, uint32_t casterCount, std::vector<uint32_t>& visible) const;
+
+    // Split distances of the practical split scheme: splits[0] is nearZ and
+    // splits[cascadeCount] is farZ.
+    static void ComputeSplits(uint32_t cascadeCount, float nearZ, float farZ, float lambda, float* splits);
+
+    // Smallest sphere around the part of a symmetric view frustum between two depths.
+    // The center is on the view axis, at the returned view-space depth.
+    static void GetFrustumSliceSphere(float tanHalfFovX, float tanHalfFovY, float nearZ, float farZ, float* pCenterZ, float* pRadius);
+
+    static ShadowSphere GetBoundingSphere(const ShadowSphere* pSpheres, uint32_t count);
+
+private:
+    ShadowCascadeDesc m_desc;
+    ShadowCascade m_cascades[MaxCascadeCount];
+
+    // Light-space basis.
+    float m_lightRight[3];
+    float m_lightUp[3];
+    float m_lightForward[3];
+
+    bool m_cacheValid;
+    float m_cachedLightDirection[3];
+};
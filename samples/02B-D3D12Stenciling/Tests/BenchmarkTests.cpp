@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Benchmark.h"
+#include "TestCheck.h"
+#include "TestJson.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+    std::string ToJsonString(const char* text)
+    {
+        std::ostringstream stream;
+        WriteJsonString(stream, text);
+        return stream.str();
+    }
+
+    // The profiler writes its trace with the same helper, so this covers the escaping of
+    // both the benchmark results and the Chrome trace.
+    void TestJsonString()
+    {
+        CHECK(ToJsonString("") == "\"\"");
+        CHECK(ToJsonString("Update") == "\"Update\"");
+        CHECK(ToJsonString("a\"b\\c") == "\"a\\\"b\\\\c\"");
+        CHECK(ToJsonString("line\nnext\ttab") == "\"line\\u000anext\\u0009tab\"");
+        CHECK(ToJsonString("\x1f") == "\"\\u001f\"");
+
+        // Every ASCII character and UTF-8 text read back as they were written.
+        std::string text;
+        for (int c = 1; c < 128; ++c)
+        {
+            text += static_cast<char>(c);
+        }
+        text += "\xc3\xa9t\xc3\xa9";
+        TestJsonValue value;
+        CHECK(ParseTestJson(ToJsonString(text.c_str()), value));
+        CHECK(value.type == TestJsonValue::String && value.string == text);
+    }
+
+    void TestJsonResults()
+    {
+        BenchmarkSettings settings;
+        settings.frameCount = 5;
+        settings.warmupFrameCount = 1;
+        Benchmark benchmark;
+        benchmark.Configure(settings);
+
+        RenderStats stats;
+        benchmark.SetRenderStats(&stats);
+        while (!benchmark.IsFinished())
+        {
+            benchmark.BeginFrame();
+            benchmark.AddPhaseTime("Render \"scene\"\\mirror\n", 1000000);
+            benchmark.AddPhaseTime("Update", 500000);
+            stats.Add(RenderCounter::DrawCalls, 3);
+            stats.EndFrame();
+            benchmark.EndFrame();
+        }
+
+        std::ostringstream stream;
+        benchmark.WriteJson(stream, "02B \"Stenciling\"", 2);
+        TestJsonValue root;
+        CHECK(ParseTestJson(stream.str(), root));
+        CHECK(root.type == TestJsonValue::Object);
+        CHECK(root.Find("sample") != nullptr && root.Find("sample")->string == "02B \"Stenciling\"");
+        CHECK(root.Find("frames") != nullptr && root.Find("frames")->number == 5);
+        CHECK(root.Find("headless") != nullptr && root.Find("headless")->type == TestJsonValue::Bool);
+
+        const TestJsonValue* phases = root.Find("phasesMs");
+        CHECK(phases != nullptr && phases->members.size() == 2);
+        const TestJsonValue* render = phases->Find("Render \"scene\"\\mirror\n");
+        CHECK(render != nullptr && render->Find("p50") != nullptr && render->Find("p50")->number == 1.0);
+
+        const TestJsonValue* counters = root.Find("counters");
+        CHECK(counters != nullptr && counters->members.size() == RenderStats::CounterCount);
+        const TestJsonValue* drawCalls = counters->Find(RenderStats::GetCounterName(RenderCounter::DrawCalls));
+        CHECK(drawCalls != nullptr && drawCalls->Find("total") != nullptr && drawCalls->Find("total")->number == 15);
+    }
+}
+
+int main()
+{
+    TestJsonString();
+    TestJsonResults();
+    return 0;
+}
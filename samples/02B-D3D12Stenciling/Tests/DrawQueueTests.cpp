@@ -0,0 +1,200 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DrawQueue.h"
+#include "TestCheck.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Records the calls of Submit(), and checks that the draws come in key order.
+    struct RecordingSink
+    {
+        RecordingSink() :
+            pipelineCount(0),
+            bindingCount(0),
+            geometryCount(0),
+            constantBufferCount(0),
+            pass(0),
+            lastKey(0)
+        {
+        }
+
+        void SetPipeline(uint32_t)          { ++pipelineCount; }
+        void SetBinding(uint32_t)           { ++bindingCount; }
+        void SetGeometry(uint32_t)          { ++geometryCount; }
+        void SetConstantBuffer(uint64_t)    { ++constantBufferCount; }
+
+        void Draw(const DrawPacket& packet)
+        {
+            CHECK(DrawQueue::GetPass(packet.sortKey) == pass);
+            CHECK(draws.empty() || DrawQueue::GetPass(lastKey) != pass || packet.sortKey > lastKey);
+            lastKey = packet.sortKey;
+            draws.push_back(packet);
+        }
+
+        uint32_t pipelineCount;
+        uint32_t bindingCount;
+        uint32_t geometryCount;
+        uint32_t constantBufferCount;
+        uint32_t pass;
+        uint64_t lastKey;
+        std::vector<DrawPacket> draws;
+    };
+
+    void TestSortKeys()
+    {
+        const uint64_t key = DrawQueue::MakeSortKey(3, 200, 17, 99, 12345);
+        CHECK(DrawQueue::GetPass(key) == 3 && DrawQueue::GetPipeline(key) == 200);
+        CHECK(DrawQueue::GetBinding(key) == 17 && DrawQueue::GetGeometry(key) == 99);
+        CHECK(DrawQueue::GetDepth(key) == 12345);
+
+        // The pass matters most, then the pipeline, the binding, the geometry and the depth.
+        CHECK(DrawQueue::MakeSortKey(1, 0, 0, 0, 0) > DrawQueue::MakeSortKey(0, 255, 255, 255, 65535));
+        CHECK(DrawQueue::MakeSortKey(0, 1, 0, 0, 0) > DrawQueue::MakeSortKey(0, 0, 255, 255, 65535));
+        CHECK(DrawQueue::MakeSortKey(0, 0, 1, 0, 0) > DrawQueue::MakeSortKey(0, 0, 0, 255, 65535));
+        CHECK(DrawQueue::MakeSortKey(0, 0, 0, 1, 0) > DrawQueue::MakeSortKey(0, 0, 0, 0, 65535));
+
+        CHECK_THROWS(DrawQueue::MakeSortKey(DrawQueue::MaxPassCount, 0, 0, 0, 0));
+        CHECK_THROWS(DrawQueue::MakeSortKey(0, DrawQueue::MaxPipelineCount, 0, 0, 0));
+        CHECK_THROWS(DrawQueue::MakeSortKey(0, 0, 0, DrawQueue::MaxGeometryCount, 0));
+        CHECK_THROWS(DrawQueue::MakeSortKey(0, 0, 0, 0, 1 << DrawQueue::DepthBits));
+    }
+
+    void TestDepthBuckets()
+    {
+        CHECK(DrawQueue::GetDepthBucket(0.1f, 0.1f, 100.0f, DrawDepthOrder::FrontToBack) == 0);
+        CHECK(DrawQueue::GetDepthBucket(0.01f, 0.1f, 100.0f, DrawDepthOrder::FrontToBack) == 0);
+        CHECK(DrawQueue::GetDepthBucket(100.0f, 0.1f, 100.0f, DrawDepthOrder::FrontToBack) == 65535);
+        CHECK(DrawQueue::GetDepthBucket(1e9f, 0.1f, 100.0f, DrawDepthOrder::BackToFront) == 0);
+        CHECK(DrawQueue::GetDepthBucket(1.0f, 0.1f, 100.0f, DrawDepthOrder::FrontToBack) < DrawQueue::GetDepthBucket(1.01f, 0.1f, 100.0f, DrawDepthOrder::FrontToBack));
+        CHECK(DrawQueue::GetDepthBucket(1.0f, 0.1f, 100.0f, DrawDepthOrder::BackToFront) > DrawQueue::GetDepthBucket(1.01f, 0.1f, 100.0f, DrawDepthOrder::BackToFront));
+        CHECK_THROWS(DrawQueue::GetDepthBucket(1.0f, 0.0f, 100.0f, DrawDepthOrder::FrontToBack));
+        CHECK_THROWS(DrawQueue::GetDepthBucket(1.0f, 10.0f, 10.0f, DrawDepthOrder::FrontToBack));
+    }
+
+    // Random draws in four passes: each pass is submitted in key order, and the calls the
+    // sink receives plus the filtered ones are the four state changes of every draw.
+    void TestSubmit()
+    {
+        const uint32_t drawCount = 20000;
+        const uint32_t passCount = 4;
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> depth(0.1f, 500.0f);
+
+        FrameArena arena(2, 64 * 1024);
+        DrawQueue queue(arena);
+        for (uint32_t frame = 0; frame < 5; ++frame)
+        {
+            arena.BeginFrame();
+            queue.Clear();
+            for (uint32_t i = 0; i < drawCount; ++i)
+            {
+                DrawPacket packet = {};
+                packet.sortKey = DrawQueue::MakeSortKey(i * passCount / drawCount, random() % 16, random() % 4, random() % 32,
+                    DrawQueue::GetDepthBucket(depth(random), 0.1f, 1000.0f, DrawDepthOrder::FrontToBack));
+                packet.constantBuffer = 0x10000 + 256ull * (i / 4);
+                packet.indexCount = 36;
+                packet.startIndex = i;
+                queue.Add(packet);
+            }
+            RecordingSink sink;
+            CHECK_THROWS(queue.Submit(0, sink));
+            queue.Sort();
+            CHECK(queue.GetCount() == drawCount);
+
+            for (uint32_t pass = 0; pass < passCount; ++pass)
+            {
+                CHECK(queue.GetCount(pass) == drawCount / passCount);
+                sink.pass = pass;
+                queue.Submit(pass, sink);
+            }
+            CHECK(sink.draws.size() == drawCount);
+
+            std::vector<bool> drawn(drawCount, false);
+            for (const DrawPacket& packet : sink.draws)
+            {
+                CHECK(!drawn[packet.startIndex]);
+                drawn[packet.startIndex] = true;
+            }
+
+            const DrawQueueStats& stats = queue.GetStats();
+            CHECK(stats.drawCount == drawCount);
+            CHECK(stats.pipelineChanges == sink.pipelineCount && stats.bindingChanges == sink.bindingCount);
+            CHECK(stats.geometryChanges == sink.geometryCount && stats.constantBufferChanges == sink.constantBufferCount);
+            CHECK(stats.filteredCalls + sink.pipelineCount + sink.bindingCount + sink.geometryCount + sink.constantBufferCount == 4 * drawCount);
+
+            // Sorting groups the pipelines: at most one change per pipeline and pass.
+            CHECK(sink.pipelineCount <= 16 * passCount);
+
+            // Once both buffers of the arena were regrown to hold a frame, queuing one
+            // doesn't reach the heap.
+            CHECK(frame < 4 || arena.GetFrameHeapAllocationCount() == 0);
+        }
+    }
+
+    // Equal keys keep their order, draws that take any binding keep the current one, and
+    // the state carries over from one pass to the next.
+    void TestStateFiltering()
+    {
+        FrameArena arena(2, 4096);
+        DrawQueue queue(arena);
+        arena.BeginFrame();
+        queue.Clear();
+
+        for (uint32_t i = 0; i < 10; ++i)
+        {
+            DrawPacket packet = {};
+            packet.sortKey = DrawQueue::MakeSortKey(1, 2, DrawQueue::AnyBinding, 0, 5);
+            packet.startIndex = i;
+            packet.constantBuffer = 7;
+            queue.Add(packet);
+        }
+        DrawPacket first = {};
+        first.sortKey = DrawQueue::MakeSortKey(0, 1, 3, 0, 0);
+        first.startIndex = 100;
+        first.constantBuffer = 7;
+        queue.Add(first);
+        queue.Sort();
+
+        RecordingSink sink;
+        queue.Submit(0, sink);
+        sink.pass = 1;
+        queue.Submit(1, sink);
+
+        CHECK(sink.draws.size() == 11 && sink.draws[0].startIndex == 100);
+        for (uint32_t i = 0; i < 10; ++i)
+        {
+            CHECK(sink.draws[i + 1].startIndex == i);
+        }
+        CHECK(sink.pipelineCount == 2 && sink.bindingCount == 1);
+        CHECK(sink.geometryCount == 1 && sink.constantBufferCount == 1);
+
+        // After InvalidateState(), everything is set again.
+        queue.InvalidateState();
+        sink.pass = 0;
+        queue.Submit(0, sink);
+        CHECK(sink.pipelineCount == 3 && sink.bindingCount == 2);
+        CHECK(sink.geometryCount == 2 && sink.constantBufferCount == 2);
+        CHECK_THROWS(queue.Submit(DrawQueue::MaxPassCount, sink));
+    }
+}
+
+int main()
+{
+    TestSortKeys();
+    TestDepthBuckets();
+    TestSubmit();
+    TestStateFiltering();
+    return 0;
+}
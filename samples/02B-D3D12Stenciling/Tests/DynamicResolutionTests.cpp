@@ -0,0 +1,248 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DynamicResolution.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // GPU time of the frames: a fixed part and a part per pixel, with a multiplicative
+    // noise. The measures come back two frames late, as from the GpuProfiler.
+    struct FrameTrace
+    {
+        float fixedMilliseconds;
+        float fullResolutionMilliseconds;
+        float noise;
+        uint32_t seed;
+        std::vector<std::pair<uint32_t, float>> loadSteps;  // Frame, new fullResolutionMilliseconds.
+        uint32_t spikeFrame;
+        float spike;
+    };
+
+    FrameTrace MakeTrace(float fixedMilliseconds, float fullResolutionMilliseconds, float noise, uint32_t seed)
+    {
+        FrameTrace trace = { fixedMilliseconds, fullResolutionMilliseconds, noise, seed, {}, 0xffffffff, 1.0f };
+        return trace;
+    }
+
+    struct FrameResults
+    {
+        std::vector<float> scales;
+        std::vector<float> milliseconds;
+    };
+
+    FrameResults Run(const FrameTrace& trace, uint32_t frameCount, const DynamicResolutionDesc& desc = DynamicResolutionDesc())
+    {
+        DynamicResolutionController controller(desc);
+        std::mt19937 random(trace.seed);
+        std::uniform_real_distribution<float> noise(-trace.noise, trace.noise);
+        std::deque<float> inFlight;
+        float fullResolutionMilliseconds = trace.fullResolutionMilliseconds;
+
+        FrameResults results;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            for (const auto& step : trace.loadSteps)
+            {
+                fullResolutionMilliseconds = (step.first == frame) ? step.second : fullResolutionMilliseconds;
+            }
+
+            const float scale = controller.GetScale();
+            float milliseconds = (trace.fixedMilliseconds + fullResolutionMilliseconds * scale * scale) * (1.0f + noise(random));
+            milliseconds *= (frame == trace.spikeFrame) ? trace.spike : 1.0f;
+            results.scales.push_back(scale);
+            results.milliseconds.push_back(milliseconds);
+
+            inFlight.push_back(milliseconds);
+            if (inFlight.size() > 2)
+            {
+                controller.Update(inFlight.front());
+                inFlight.pop_front();
+            }
+        }
+        return results;
+    }
+
+    float Mean(const std::vector<float>& values, size_t first, size_t last)
+    {
+        float sum = 0.0f;
+        for (size_t i = first; i < last; ++i)
+        {
+            sum += values[i];
+        }
+        return sum / (last - first);
+    }
+
+    float StandardDeviation(const std::vector<float>& values, size_t first, size_t last)
+    {
+        const float mean = Mean(values, first, last);
+        float sum = 0.0f;
+        for (size_t i = first; i < last; ++i)
+        {
+            sum += (values[i] - mean) * (values[i] - mean);
+        }
+        return std::sqrt(sum / (last - first));
+    }
+
+    // Frames from first until the mean of each 10 frames stays within tolerance of the
+    // target, or -1.
+    int GetSettlingFrameCount(const std::vector<float>& milliseconds, size_t first, size_t last, float target, float tolerance)
+    {
+        for (size_t i = first; i + 10 <= last; ++i)
+        {
+            bool settled = true;
+            for (size_t j = i; j + 10 <= last && settled; j += 10)
+            {
+                settled = std::fabs(Mean(milliseconds, j, j + 10) / target - 1.0f) <= tolerance;
+            }
+            if (settled)
+            {
+                return static_cast<int>(i - first);
+            }
+        }
+        return -1;
+    }
+
+    const float c_target = DynamicResolutionDesc().targetMilliseconds;
+
+    void TestLightLoad()
+    {
+        const FrameResults results = Run(MakeTrace(1.0f, 5.0f, 0.05f, 1), 600);
+        for (float scale : results.scales)
+        {
+            CHECK(scale == 1.0f);
+        }
+    }
+
+    // Heavier loads converge to the target and stay there.
+    void TestConvergence()
+    {
+        const float loads[] = { 18.0f, 24.0f, 40.0f };
+        for (float load : loads)
+        {
+            const FrameResults results = Run(MakeTrace(2.0f, load, 0.05f, 2), 900);
+            const int settlingFrameCount = GetSettlingFrameCount(results.milliseconds, 0, 900, c_target, 0.05f);
+            CHECK(settlingFrameCount >= 0 && settlingFrameCount < 120);
+            CHECK(std::fabs(Mean(results.milliseconds, 300, 900) / c_target - 1.0f) < 0.03f);
+            CHECK(StandardDeviation(results.scales, 300, 900) < 0.02f);
+            for (float scale : results.scales)
+            {
+                CHECK(scale >= 0.5f && scale <= 1.0f);
+            }
+        }
+    }
+
+    // Pinned at the smallest scale while out of range, without winding up.
+    void TestOverload()
+    {
+        FrameTrace trace = MakeTrace(2.0f, 200.0f, 0.0f, 3);
+        trace.loadSteps.push_back(std::make_pair(400u, 8.0f));
+        const FrameResults results = Run(trace, 800);
+        CHECK(results.scales[399] == 0.5f);
+
+        const auto recovered = std::find(results.scales.begin() + 400, results.scales.end(), 1.0f);
+        CHECK(recovered != results.scales.end() && recovered - (results.scales.begin() + 400) < 60);
+    }
+
+    void TestLoadSteps()
+    {
+        FrameTrace trace = MakeTrace(2.0f, 20.0f, 0.03f, 4);
+        trace.loadSteps.push_back(std::make_pair(300u, 35.0f));
+        trace.loadSteps.push_back(std::make_pair(600u, 22.0f));
+        const FrameResults results = Run(trace, 900);
+
+        const int settlingUp = GetSettlingFrameCount(results.milliseconds, 300, 600, c_target, 0.05f);
+        const int settlingDown = GetSettlingFrameCount(results.milliseconds, 600, 900, c_target, 0.05f);
+        CHECK(settlingUp >= 0 && settlingUp < 60);
+        CHECK(settlingDown >= 0 && settlingDown < 120);
+        CHECK(*std::min_element(results.milliseconds.begin() + 310, results.milliseconds.begin() + 600) > 0.75f * c_target);
+    }
+
+    // A single slow frame makes a limited dip.
+    void TestSpike()
+    {
+        FrameTrace trace = MakeTrace(2.0f, 20.0f, 0.0f, 5);
+        trace.spikeFrame = 400;
+        trace.spike = 3.0f;
+        const FrameResults results = Run(trace, 700);
+        CHECK(results.scales[399] - *std::min_element(results.scales.begin() + 400, results.scales.end()) < 0.12f);
+        CHECK(std::fabs(results.milliseconds[699] / c_target - 1.0f) <= 0.031f);
+    }
+
+    void TestNoise()
+    {
+        const FrameResults results = Run(MakeTrace(2.0f, 24.0f, 0.15f, 6), 2000);
+        float largestStep = 0.0f;
+        for (size_t i = 301; i < 2000; ++i)
+        {
+            largestStep = (std::max)(largestStep, std::fabs(results.scales[i] - results.scales[i - 1]));
+        }
+        CHECK(StandardDeviation(results.scales, 300, 2000) < 0.04f && largestStep < 0.05f);
+    }
+
+    // Gains beyond the stability limit of the late measures oscillate, and the defaults
+    // are well under it.
+    void TestStabilityLimit()
+    {
+        DynamicResolutionDesc unstable;
+        unstable.integralGain = 0.9f;
+        unstable.maxIncrease = 1.0f;
+        unstable.maxDecrease = 0.9f;
+        const FrameResults unstableResults = Run(MakeTrace(2.0f, 24.0f, 0.0f, 7), 600, unstable);
+        const FrameResults results = Run(MakeTrace(2.0f, 24.0f, 0.0f, 7), 600);
+        CHECK(StandardDeviation(unstableResults.scales, 300, 600) > 10.0f * StandardDeviation(results.scales, 300, 600) + 0.01f);
+    }
+
+    void TestDeterminism()
+    {
+        const FrameResults first = Run(MakeTrace(2.0f, 30.0f, 0.1f, 8), 500);
+        const FrameResults second = Run(MakeTrace(2.0f, 30.0f, 0.1f, 8), 500);
+        CHECK(first.scales == second.scales);
+    }
+
+    void TestSettings()
+    {
+        DynamicResolutionController controller;
+        CHECK(controller.Update(0.0f) == 1.0f && controller.Update(-1.0f) == 1.0f);
+        controller.Update(100.0f);
+        CHECK(controller.GetScale() < 1.0f);
+        controller.Reset();
+        CHECK(controller.GetScale() == 1.0f);
+
+        CHECK(DynamicResolutionController::ScaleSize(1280, 0.5f) == 640);
+        CHECK(DynamicResolutionController::ScaleSize(3, 0.1f) == 1);
+
+        DynamicResolutionDesc desc;
+        desc.minScale = 2.0f;
+        CHECK_THROWS(DynamicResolutionController invalid(desc));
+    }
+}
+
+int main()
+{
+    TestLightLoad();
+    TestConvergence();
+    TestOverload();
+    TestLoadSteps();
+    TestSpike();
+    TestNoise();
+    TestStabilityLimit();
+    TestDeterminism();
+    TestSettings();
+    return 0;
+}
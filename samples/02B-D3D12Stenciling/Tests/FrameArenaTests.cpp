@@ -0,0 +1,157 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "AllocationCounter.h"
+#include "FrameArena.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <random>
+
+namespace
+{
+    // Alignment, overflow blocks, the regrown buffers, and the memory of the previous
+    // frame staying valid while the next one is built.
+    void TestAllocate()
+    {
+        FrameArena arena(2, 256);
+        arena.BeginFrame();
+        CHECK(arena.GetFrameCount() == 2 && arena.GetCapacity() == 256);
+
+        void* pFirst = arena.Allocate(3, 1);
+        void* pAligned = arena.Allocate(8, 64);
+        CHECK(reinterpret_cast<uintptr_t>(pAligned) % 64 == 0 && pFirst != pAligned);
+        std::memset(pAligned, 0xAB, 8);
+
+        // A frame larger than the buffer takes an overflow block.
+        const uint32_t heapAllocationCount = arena.GetFrameHeapAllocationCount();
+        std::memset(arena.Allocate(1000, 16), 1, 1000);
+        CHECK(arena.GetFrameHeapAllocationCount() == heapAllocationCount + 1);
+        CHECK(arena.GetHighWaterMark() >= 1000 && arena.GetHighWaterMark() == arena.GetBytesAllocated());
+
+        uint8_t* pKept = static_cast<uint8_t*>(arena.Allocate(16, 16));
+        std::memset(pKept, 7, 16);
+
+        // The other buffer is regrown to the largest frame when its frame starts.
+        arena.BeginFrame();
+        CHECK(arena.GetFrameHeapAllocationCount() == 1 && arena.GetCapacity() >= 1024);
+        arena.Allocate(1100, 16);
+        CHECK(arena.GetFrameHeapAllocationCount() == 1);
+        CHECK(pKept[0] == 7 && pKept[15] == 7);
+
+        // Back to the first buffer: its overflow block is freed, and it's regrown.
+        arena.BeginFrame();
+        CHECK(arena.GetFrameHeapAllocationCount() == 1 && arena.GetBytesAllocated() == 0);
+        for (int frame = 0; frame < 10; ++frame)
+        {
+            arena.BeginFrame();
+            arena.Allocate(1100, 16);
+            CHECK(arena.GetFrameHeapAllocationCount() == 0);
+        }
+        CHECK(arena.GetTotalHeapAllocationCount() == 2 + 1 + 2);
+    }
+
+    void TestErrors()
+    {
+        CHECK_THROWS(FrameArena(0, 16));
+
+        FrameArena arena(1, 64);
+        CHECK_THROWS(arena.Allocate(4, 0));
+        CHECK_THROWS(arena.Allocate(4, 3));
+
+        // An arena without an initial buffer starts in an overflow block.
+        FrameArena empty(1, 0);
+        empty.BeginFrame();
+        CHECK(empty.Allocate(10, 8) != nullptr && empty.GetFrameHeapAllocationCount() == 1);
+    }
+
+    // Node containers, copies and rebinding.
+    void TestAllocator()
+    {
+        FrameArena arena(2, 4096);
+        arena.BeginFrame();
+
+        typedef FrameAllocator<std::pair<const int, int>> MapAllocator;
+        std::map<int, int, std::less<int>, MapAllocator> squares{ MapAllocator(arena) };
+        for (int i = 0; i < 100; ++i)
+        {
+            squares[i] = i * i;
+        }
+        CHECK(squares.at(9) == 81 && squares.size() == 100);
+
+        FrameVector<int> values{ FrameAllocator<int>(arena) };
+        FrameVector<int> copy{ FrameAllocator<int>(arena) };
+        values.assign(50, 3);
+        copy = values;
+        CHECK(copy.size() == 50 && copy.get_allocator() == values.get_allocator());
+
+        FrameAllocator<double> rebound(values.get_allocator());
+        CHECK(rebound == values.get_allocator() && rebound.GetArena() == &arena);
+
+        FrameArena otherArena(1, 64);
+        CHECK(FrameAllocator<int>(otherArena) != values.get_allocator());
+    }
+
+    // The transient lists of a frame, built without reserving, stop reaching the heap once
+    // every buffer has held a frame; the same lists on the default allocator don't.
+    void TestSteadyState()
+    {
+        CHECK(AllocationCounter::IsEnabled());
+
+        FrameArena arena(2, 1024);
+        std::minstd_rand random(1);
+        for (int frame = 0; frame < 20; ++frame)
+        {
+            const uint64_t allocationCount = AllocationCounter::GetThreadAllocationCount();
+            arena.BeginFrame();
+
+            for (int pass = 0; pass < 4; ++pass)
+            {
+                FrameVector<uint64_t> keys{ FrameAllocator<uint64_t>(arena) };
+                for (uint32_t i = 0; i < 1000; ++i)
+                {
+                    keys.push_back(random());
+                }
+                FrameVector<uint32_t> order{ FrameAllocator<uint32_t>(arena) };
+                order.resize(keys.size());
+                std::iota(order.begin(), order.end(), 0u);
+                std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+                CHECK(std::is_sorted(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; }));
+            }
+
+            const uint64_t frameAllocationCount = AllocationCounter::GetThreadAllocationCount() - allocationCount;
+            CHECK(frameAllocationCount == arena.GetFrameHeapAllocationCount());
+            CHECK(frame < 4 || frameAllocationCount == 0);
+        }
+
+        const uint64_t allocationCount = AllocationCounter::GetThreadAllocationCount();
+        {
+            std::vector<uint64_t> keys;
+            for (uint32_t i = 0; i < 1000; ++i)
+            {
+                keys.push_back(random());
+            }
+        }
+        CHECK(AllocationCounter::GetThreadAllocationCount() > allocationCount);
+    }
+}
+
+int main()
+{
+    TestAllocate();
+    TestErrors();
+    TestAllocator();
+    TestSteadyState();
+    return 0;
+}
@@ -0,0 +1,220 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MirrorClipping.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // The mirror of the sample, in the z = 0 plane.
+    const float c_mirrorCorners[4][3] =
+    {
+        { -2.5f, 0.0f, 0.0f },
+        { -2.5f, 4.0f, 0.0f },
+        { 2.5f, 4.0f, 0.0f },
+        { 2.5f, 0.0f, 0.0f }
+    };
+
+    const float c_nearZ = 0.1f;
+    const float c_farZ = 100.0f;
+
+    // Left-handed perspective projection with a 90 degree vertical field of view, in the
+    // layout of XMMatrixPerspectiveFovLH.
+    void GetProjection(float aspectRatio, float projection[16])
+    {
+        memset(projection, 0, 16 * sizeof(float));
+        projection[0] = 1.0f / aspectRatio;
+        projection[5] = 1.0f;
+        projection[10] = c_farZ / (c_farZ - c_nearZ);
+        projection[11] = 1.0f;
+        projection[14] = -c_nearZ * c_farZ / (c_farZ - c_nearZ);
+    }
+
+    // Camera at the eye, looking down +z, times the projection.
+    void GetViewProjection(const float eye[3], float aspectRatio, float viewProjection[16])
+    {
+        GetProjection(aspectRatio, viewProjection);
+        for (int c = 0; c < 4; ++c)
+        {
+            viewProjection[12 + c] -= eye[0] * viewProjection[c] + eye[1] * viewProjection[4 + c] + eye[2] * viewProjection[8 + c];
+        }
+    }
+
+    void Transform(const float matrix[16], const float point[3], float clip[4])
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            clip[c] = point[0] * matrix[c] + point[1] * matrix[4 + c] + point[2] * matrix[8 + c] + matrix[12 + c];
+        }
+    }
+
+    float GetDepth(const float projection[16], const float viewPoint[3])
+    {
+        float clip[4];
+        Transform(projection, viewPoint, clip);
+        return clip[2] / clip[3];
+    }
+
+    // The rectangle is rounded outward, so it may have an extra pixel on each side when the
+    // bounds of the mirror fall on pixel edges.
+    bool IsRect(const MirrorScissorRect& rect, int32_t left, int32_t top, int32_t right, int32_t bottom)
+    {
+        return rect.left <= left && rect.left >= left - 1 && rect.top <= top && rect.top >= top - 1 &&
+            rect.right >= right && rect.right <= right + 1 && rect.bottom >= bottom && rect.bottom <= bottom + 1;
+    }
+
+    void TestScissorRect()
+    {
+        // Ten units in front of the middle of the mirror, it covers a quarter of the width
+        // and a fifth of the height of a square view.
+        const float eye[3] = { 0.0f, 2.0f, -10.0f };
+        float viewProjection[16];
+        GetViewProjection(eye, 1.0f, viewProjection);
+        MirrorScissorRect rect;
+        CHECK(GetMirrorScissorRect(viewProjection, c_mirrorCorners, 4, 800, 800, &rect));
+        CHECK(IsRect(rect, 300, 320, 500, 480));
+
+        // A wide view only shrinks its width.
+        GetViewProjection(eye, 2.0f, viewProjection);
+        CHECK(GetMirrorScissorRect(viewProjection, c_mirrorCorners, 4, 1600, 800, &rect));
+        CHECK(IsRect(rect, 700, 320, 900, 480));
+
+        // Partly out of the view, the rectangle is clamped to the viewport.
+        const float leftEye[3] = { 10.0f, 2.0f, -10.0f };
+        GetViewProjection(leftEye, 1.0f, viewProjection);
+        CHECK(GetMirrorScissorRect(viewProjection, c_mirrorCorners, 4, 800, 800, &rect));
+        CHECK(IsRect(rect, 0, 320, 100, 480));
+
+        // Close to the mirror, the corners are beyond the sides of the view: all of it.
+        const float closeEye[3] = { 0.0f, 2.0f, -1.0f };
+        GetViewProjection(closeEye, 1.0f, viewProjection);
+        CHECK(GetMirrorScissorRect(viewProjection, c_mirrorCorners, 4, 800, 800, &rect));
+        CHECK(IsRect(rect, 0, 0, 800, 800));
+
+        // Out of the view to the side, and behind the camera.
+        const float farLeftEye[3] = { 30.0f, 2.0f, -10.0f };
+        GetViewProjection(farLeftEye, 1.0f, viewProjection);
+        CHECK(!GetMirrorScissorRect(viewProjection, c_mirrorCorners, 4, 800, 800, &rect));
+        const float behindEye[3] = { 0.0f, 2.0f, 10.0f };
+        GetViewProjection(behindEye, 1.0f, viewProjection);
+        CHECK(!GetMirrorScissorRect(viewProjection, c_mirrorCorners, 4, 800, 800, &rect));
+
+        CHECK(!GetMirrorScissorRect(viewProjection, c_mirrorCorners, 2, 800, 800, &rect));
+    }
+
+    void TestFrustum()
+    {
+        const float eye[3] = { 0.0f, 2.0f, -10.0f };
+        MirrorFrustum frustum;
+        CHECK(frustum.Build(eye, c_mirrorCorners, 4));
+
+        // The mirror plane faces away from the eye.
+        const float* plane = frustum.GetMirrorPlane();
+        CHECK(std::fabs(plane[2] - 1.0f) < 1e-6f && std::fabs(plane[3]) < 1e-6f);
+
+        // The reflected scene is seen beyond the mirror, through its edges: at five units
+        // past the mirror, the pyramid is 7.5 units wide and 6 units high.
+        const float beyond[3] = { 0.0f, 2.0f, 5.0f };
+        CHECK(frustum.Intersects(beyond, 0.5f));
+        const float nearEdge[3] = { 4.0f, 2.0f, 5.0f };
+        CHECK(frustum.Intersects(nearEdge, 0.5f));
+        CHECK(!frustum.Intersects(nearEdge, 0.1f));
+        const float aside[3] = { 20.0f, 2.0f, 5.0f };
+        CHECK(!frustum.Intersects(aside, 1.0f));
+        const float above[3] = { 0.0f, 12.0f, 5.0f };
+        CHECK(!frustum.Intersects(above, 1.0f));
+
+        // Objects behind the mirror plane, between the mirror and the eye, are culled unless
+        // they reach through it.
+        const float behind[3] = { 0.0f, 2.0f, -5.0f };
+        CHECK(!frustum.Intersects(behind, 1.0f));
+        const float straddling[3] = { 0.0f, 2.0f, -0.5f };
+        CHECK(frustum.Intersects(straddling, 1.0f));
+        const float behindEye[3] = { 0.0f, 2.0f, -20.0f };
+        CHECK(!frustum.Intersects(behindEye, 5.0f));
+
+        // The mirror can be seen from the other side.
+        const float backEye[3] = { 0.0f, 2.0f, 10.0f };
+        CHECK(frustum.Build(backEye, c_mirrorCorners, 4));
+        CHECK(frustum.Intersects(behind, 1.0f));
+        CHECK(!frustum.Intersects(beyond, 1.0f));
+
+        // In the mirror plane, or a degenerate mirror: nothing is visible.
+        const float inPlane[3] = { 5.0f, 2.0f, 0.0f };
+        CHECK(!frustum.Build(inPlane, c_mirrorCorners, 4));
+        CHECK(!frustum.Intersects(beyond, 100.0f));
+        const float line[3][3] = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 2.0f, 0.0f, 0.0f } };
+        CHECK(!frustum.Build(eye, line, 3));
+    }
+
+    void TestObliqueProjection()
+    {
+        // The mirror plane in the view space of a camera ten units in front of it, and the
+        // same plane seen at an angle.
+        const float c_planes[2][4] =
+        {
+            { 0.0f, 0.0f, 1.0f, -10.0f },
+            { 0.6f, 0.0f, 0.8f, -8.0f },
+        };
+        for (const float* viewPlane : c_planes)
+        {
+            float projection[16];
+            GetProjection(1.0f, projection);
+            CHECK(MakeObliqueProjection(projection, viewPlane));
+
+            // Points of the plane in the view map to depth 0, the ones beyond it to (0, 1]
+            // up to the far plane, and the ones in front of it are clipped.
+            for (float x = -4.0f; x <= 4.0f; x += 2.0f)
+            {
+                for (float y = -4.0f; y <= 4.0f; y += 2.0f)
+                {
+                    const float z = -(viewPlane[0] * x + viewPlane[1] * y + viewPlane[3]) / viewPlane[2];
+                    const float onPlane[3] = { x, y, z };
+                    CHECK(std::fabs(GetDepth(projection, onPlane)) < 1e-5f);
+
+                    const float beyond[3] = { x, y, z + 1.0f };
+                    const float depthBeyond = GetDepth(projection, beyond);
+                    CHECK(depthBeyond > 0.0f && depthBeyond <= 1.0f);
+
+                    const float inFront[3] = { x, y, z - 1.0f };
+                    CHECK(GetDepth(projection, inFront) < 0.0f);
+                }
+            }
+
+            // The far plane is tilted, but the corners of the view frustum still fit.
+            for (int corner = 0; corner < 4; ++corner)
+            {
+                const float farCorner[3] = { corner & 1 ? c_farZ : -c_farZ, corner & 2 ? c_farZ : -c_farZ, c_farZ };
+                CHECK(GetDepth(projection, farCorner) <= 1.0f + 1e-5f);
+            }
+        }
+
+        // Beyond the far plane, all of the view is clipped: the projection is left as it was.
+        float projection[16];
+        float expected[16];
+        GetProjection(1.0f, projection);
+        GetProjection(1.0f, expected);
+        const float pastFar[4] = { 0.0f, 0.0f, 1.0f, -2.0f * c_farZ };
+        CHECK(!MakeObliqueProjection(projection, pastFar));
+        CHECK(memcmp(projection, expected, sizeof(projection)) == 0);
+    }
+}
+
+int main()
+{
+    TestScissorRect();
+    TestFrustum();
+    TestObliqueProjection();
+    return 0;
+}
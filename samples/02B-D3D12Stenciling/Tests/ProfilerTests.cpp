@@ -0,0 +1,290 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Profiler.h"
+#include "TestCheck.h"
+#include "TestJson.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct TraceEvent
+    {
+        std::string name;
+        char phase;
+        double microseconds;
+    };
+
+    // The begin and end events of each track of a trace, by track name.
+    typedef std::map<std::string, std::vector<TraceEvent>> Trace;
+
+    // Reads a trace written by Profiler::WriteChromeTrace(), and checks that the begin and
+    // end events of every track are balanced: each end closes the last scope begun, and
+    // none comes before its begin.
+    Trace ReadTrace()
+    {
+        std::ostringstream stream;
+        Profiler::WriteChromeTrace(stream);
+        TestJsonValue root;
+        CHECK(ParseTestJson(stream.str(), root));
+        const TestJsonValue* traceEvents = root.Find("traceEvents");
+        CHECK(traceEvents != nullptr && traceEvents->type == TestJsonValue::Array);
+
+        std::map<double, std::string> trackNames;
+        std::map<double, std::vector<TraceEvent>> tracks;
+        for (const TestJsonValue& event : traceEvents->elements)
+        {
+            const TestJsonValue* name = event.Find("name");
+            const TestJsonValue* phase = event.Find("ph");
+            const TestJsonValue* tid = event.Find("tid");
+            CHECK(name != nullptr && phase != nullptr && tid != nullptr && phase->string.size() == 1);
+            if (phase->string == "M")
+            {
+                CHECK(name->string == "thread_name");
+                trackNames[tid->number] = event.Find("args")->Find("name")->string;
+            }
+            else
+            {
+                CHECK(phase->string == "B" || phase->string == "E");
+                tracks[tid->number].push_back(TraceEvent{ name->string, phase->string[0], event.Find("ts")->number });
+            }
+        }
+
+        Trace trace;
+        for (const auto& track : tracks)
+        {
+            CHECK(trackNames.count(track.first) == 1);
+            std::vector<const TraceEvent*> openEvents;
+            double lastMicroseconds = 0.0;
+            for (const TraceEvent& event : track.second)
+            {
+                CHECK(event.microseconds >= lastMicroseconds);
+                lastMicroseconds = event.microseconds;
+                if (event.phase == 'B')
+                {
+                    openEvents.push_back(&event);
+                }
+                else
+                {
+                    CHECK(!openEvents.empty() && openEvents.back()->name == event.name);
+                    openEvents.pop_back();
+                }
+            }
+            CHECK(openEvents.empty());
+            trace[trackNames[track.first]] = track.second;
+        }
+        return trace;
+    }
+
+    size_t CountScopes(const Trace& trace, const std::string& trackName, const char* name = nullptr)
+    {
+        const auto track = trace.find(trackName);
+        if (track == trace.end())
+        {
+            return 0;
+        }
+        return static_cast<size_t>(std::count_if(track->second.begin(), track->second.end(), [name](const TraceEvent& event)
+        {
+            return event.phase == 'B' && (name == nullptr || event.name == name);
+        }));
+    }
+
+    void SpinFor(std::chrono::microseconds duration)
+    {
+        const auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end)
+        {
+        }
+    }
+
+    // The scopes recorded while the profiler is disabled cost a flag check and are dropped.
+    void TestDisabled()
+    {
+        std::thread thread([]
+        {
+            Profiler::SetThreadName("Disabled");
+            for (int i = 0; i < 10; ++i)
+            {
+                PROFILE_SCOPE("Dropped");
+            }
+        });
+        thread.join();
+        CHECK(CountScopes(ReadTrace(), "Disabled") == 0);
+    }
+
+    void TestNesting()
+    {
+        std::thread thread([]
+        {
+            Profiler::SetThreadName("Nesting \"quoted\"");
+            PROFILE_SCOPE("Frame");
+            SpinFor(std::chrono::microseconds(20));
+            for (int i = 0; i < 2; ++i)
+            {
+                PROFILE_SCOPE("Pass");
+                SpinFor(std::chrono::microseconds(20));
+            }
+            SpinFor(std::chrono::microseconds(20));
+        });
+        thread.join();
+
+        const Trace trace = ReadTrace();
+        const auto track = trace.find("Nesting \"quoted\"");
+        CHECK(track != trace.end());
+        std::string sequence;
+        for (const TraceEvent& event : track->second)
+        {
+            sequence += std::string(1, event.phase) + event.name + ' ';
+        }
+        CHECK(sequence == "BFrame BPass EPass BPass EPass EFrame ");
+
+        // The rate of the timestamps is measured since the start of the test, which is short.
+        CHECK(track->second.back().microseconds - track->second.front().microseconds >= 60.0);
+    }
+
+    // The ring keeps the last EventCapacity events of a thread.
+    void TestRingWrap()
+    {
+        std::thread thread([]
+        {
+            Profiler::SetThreadName("Wrap");
+            for (int i = 0; i < 100; ++i)
+            {
+                const uint64_t timestamp = Profiler::GetTimestamp();
+                Profiler::RecordEvent("Overwritten", timestamp, timestamp);
+            }
+            for (uint32_t i = 0; i < Profiler::EventCapacity; ++i)
+            {
+                const uint64_t timestamp = Profiler::GetTimestamp();
+                Profiler::RecordEvent("Kept", timestamp, timestamp);
+            }
+        });
+        thread.join();
+
+        const Trace trace = ReadTrace();
+        CHECK(CountScopes(trace, "Wrap") == Profiler::EventCapacity);
+        CHECK(CountScopes(trace, "Wrap", "Kept") == Profiler::EventCapacity);
+    }
+
+    // Tracks take events in nanoseconds from another timeline, like the GPU queue.
+    void TestTracks()
+    {
+        const uint32_t track = Profiler::CreateTrack("GPU");
+        const uint64_t start = Profiler::GetNanoseconds();
+        Profiler::RecordTrackEvent(track, "Frame", start, start + 3000000);
+        Profiler::RecordTrackEvent(track, "Shadows", start + 100000, start + 1000000);
+        Profiler::RecordTrackEvent(track, "Mirror", start + 1000000, start + 2000000);
+
+        const Trace trace = ReadTrace();
+        CHECK(CountScopes(trace, "GPU") == 3);
+        const std::vector<TraceEvent>& events = trace.find("GPU")->second;
+        CHECK(events.size() == 6 && events[1].name == "Shadows" && events[3].name == "Mirror");
+        CHECK(events[2].microseconds - events[1].microseconds == 900.0);
+        CHECK(events[5].microseconds - events[0].microseconds == 3000.0);
+    }
+
+    // Threads record while the trace is exported: every export is a balanced trace, with
+    // the events that a ring overwrote during the export dropped.
+    void TestConcurrentWriters()
+    {
+        const uint32_t writerCount = 4;
+        const uint32_t framesPerWriter = 20000;
+        const char* const writerNames[] = { "Writer 0", "Writer 1", "Writer 2", "Writer 3" };
+
+        std::atomic<uint32_t> runningWriters(writerCount + 1);
+        std::vector<std::thread> writers;
+        for (uint32_t i = 0; i < writerCount; ++i)
+        {
+            writers.emplace_back([&, i]
+            {
+                Profiler::SetThreadName(writerNames[i]);
+                for (uint32_t frame = 0; frame < framesPerWriter; ++frame)
+                {
+                    PROFILE_SCOPE("Frame");
+                    PROFILE_SCOPE("Record");
+                }
+                --runningWriters;
+            });
+        }
+        writers.emplace_back([&]
+        {
+            Profiler::SetThreadName("Wrapping writer");
+            for (uint32_t i = 0; i < 4 * Profiler::EventCapacity; ++i)
+            {
+                PROFILE_SCOPE("Job");
+            }
+            --runningWriters;
+        });
+
+        uint32_t exportCount = 0;
+        while (runningWriters > 0 || exportCount == 0)
+        {
+            const Trace trace = ReadTrace();
+            CHECK(CountScopes(trace, "Wrapping writer") <= Profiler::EventCapacity);
+            ++exportCount;
+        }
+        for (std::thread& writer : writers)
+        {
+            writer.join();
+        }
+
+        const Trace trace = ReadTrace();
+        for (uint32_t i = 0; i < writerCount; ++i)
+        {
+            CHECK(CountScopes(trace, writerNames[i], "Frame") == framesPerWriter);
+            CHECK(CountScopes(trace, writerNames[i], "Record") == framesPerWriter);
+        }
+        CHECK(CountScopes(trace, "Wrapping writer") == Profiler::EventCapacity);
+    }
+
+    // A scope must cost less than 50 ns, most of which is the two reads of the clock. The
+    // best of several runs is kept, so that the other processes of the machine don't count.
+    void TestOverhead()
+    {
+        const uint32_t scopeCount = 200000;
+        double bestNanoseconds = 1e9;
+        for (int run = 0; run < 20; ++run)
+        {
+            const uint64_t start = Profiler::GetNanoseconds();
+            for (uint32_t i = 0; i < scopeCount; ++i)
+            {
+                PROFILE_SCOPE("Overhead");
+            }
+            bestNanoseconds = (std::min)(bestNanoseconds, static_cast<double>(Profiler::GetNanoseconds() - start) / scopeCount);
+        }
+        std::printf("Profiler scope overhead: %.1f ns\n", bestNanoseconds);
+#if !defined(_DEBUG)
+        CHECK(bestNanoseconds < 50.0);
+#endif
+    }
+}
+
+int main()
+{
+    TestDisabled();
+
+    Profiler::SetEnabled(true);
+    TestNesting();
+    TestRingWrap();
+    TestTracks();
+    TestConcurrentWriters();
+    TestOverhead();
+    return 0;
+}
@@ -0,0 +1,170 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ShadowCascades.h"
+#include "TestCheck.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The constants of D3D12Stenciling.h are written into constant buffers that shaders.hlsl
+// reads with the HLSL packing rules. This test packs the cbuffers of shaders.hlsl and
+// checks them against the layout of the C++ structures: the offsets of the members
+// commented there, and the size that the static_asserts of D3D12Stenciling.h pin.
+
+namespace
+{
+    struct CBufferMember
+    {
+        std::string name;
+        uint32_t offset;
+    };
+
+    struct CBuffer
+    {
+        std::string shaderRegister;
+        std::vector<CBufferMember> members;
+        uint32_t size;
+    };
+
+    // Size of a type, and the number of 16-byte registers it takes when it's an array
+    // element (array elements each start a register).
+    bool GetTypeSize(const std::string& type, uint32_t& size)
+    {
+        static const std::map<std::string, uint32_t> c_sizes =
+        {
+            { "float", 4 }, { "float2", 8 }, { "float3", 12 }, { "float4", 16 },
+            { "uint", 4 }, { "uint2", 8 }, { "uint3", 12 }, { "uint4", 16 },
+            { "int", 4 }, { "float4x4", 64 }
+        };
+        const auto it = c_sizes.find(type);
+        if (it == c_sizes.end())
+        {
+            return false;
+        }
+        size = it->second;
+        return true;
+    }
+
+    // Packs the members of the cbuffers of an HLSL file: a member doesn't straddle a
+    // 16-byte boundary, and arrays and matrices start at one.
+    std::map<std::string, CBuffer> ParseCBuffers(const std::string& path)
+    {
+        std::ifstream file(path);
+        CHECK(file.good());
+        std::stringstream text;
+        text << file.rdbuf();
+
+        std::map<std::string, CBuffer> cbuffers;
+        std::string source = text.str();
+        size_t position = 0;
+        while ((position = source.find("cbuffer ", position)) != std::string::npos)
+        {
+            std::istringstream header(source.substr(position, source.find('{', position) - position));
+            std::string keyword, name, colon, shaderRegister;
+            header >> keyword >> name >> colon >> shaderRegister;
+            CBuffer& cbuffer = cbuffers[name];
+            cbuffer.shaderRegister = shaderRegister.substr(shaderRegister.find('(') + 1, shaderRegister.find(')') - shaderRegister.find('(') - 1);
+
+            const size_t bodyBegin = source.find('{', position) + 1;
+            const size_t bodyEnd = source.find('}', bodyBegin);
+            std::istringstream body(source.substr(bodyBegin, bodyEnd - bodyBegin));
+            uint32_t offset = 0;
+            std::string line;
+            while (std::getline(body, line))
+            {
+                line = line.substr(0, line.find("//"));
+                std::istringstream declaration(line);
+                std::string type, member;
+                if (!(declaration >> type >> member))
+                {
+                    continue;
+                }
+                member = member.substr(0, member.find(';'));
+
+                uint32_t size = 0;
+                CHECK(GetTypeSize(type, size));
+                uint32_t elementCount = 1;
+                const size_t bracket = member.find('[');
+                if (bracket != std::string::npos)
+                {
+                    elementCount = static_cast<uint32_t>(std::stoul(member.substr(bracket + 1)));
+                    member = member.substr(0, bracket);
+                }
+
+                const bool startsRegister = elementCount > 1 || size > 16 || (offset % 16) + size > 16;
+                if (startsRegister)
+                {
+                    offset = (offset + 15) / 16 * 16;
+                }
+                cbuffer.members.push_back({ member, offset });
+
+                // Every element but the last takes whole registers.
+                offset += (elementCount - 1) * ((size + 15) / 16 * 16) + size;
+            }
+            cbuffer.size = offset;
+            position = bodyEnd;
+        }
+        return cbuffers;
+    }
+
+    void CheckMembers(const CBuffer& cbuffer, const std::vector<CBufferMember>& expected)
+    {
+        CHECK(cbuffer.members.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            CHECK(cbuffer.members[i].name == expected[i].name);
+            CHECK(cbuffer.members[i].offset == expected[i].offset);
+        }
+    }
+
+    void TestPacking()
+    {
+        // The rules the parser follows, on the example of the upscale constants.
+        const std::map<std::string, CBuffer> cbuffers = ParseCBuffers("shaders.hlsl");
+        const CBuffer& upscale = cbuffers.at("UpscaleConstants");
+        CHECK(upscale.shaderRegister == "b4" && upscale.size == 16);
+        CheckMembers(upscale, { { "sceneUvScale", 0 }, { "sceneUvMax", 8 } });
+    }
+
+    // The per-object, per-frame and per-pass constants are bound at b0, b1 and b3, and
+    // their members are where D3D12Stenciling.h writes them.
+    void TestSplitConstants()
+    {
+        const std::map<std::string, CBuffer> cbuffers = ParseCBuffers("shaders.hlsl");
+
+        const CBuffer& draw = cbuffers.at("DrawConstants");
+        CHECK(draw.shaderRegister == "b0" && draw.size == 80);
+        CheckMembers(draw, { { "mWorld", 0 }, { "outputColor", 64 } });
+
+        const CBuffer& frame = cbuffers.at("FrameConstants");
+        CHECK(frame.shaderRegister == "b1" && frame.size == 64 * ShadowCascades::MaxCascadeCount + 64);
+        CheckMembers(frame, { { "cascadeViewProjection", 0 }, { "cascadeDepthBias", 256 }, { "shadowParams", 272 }, { "lightDir", 288 }, { "lightColor", 304 } });
+        CHECK(frame.size <= 2 * 256);
+
+        const CBuffer& pass = cbuffers.at("PassConstants");
+        CHECK(pass.shaderRegister == "b3" && pass.size == 192);
+        CheckMembers(pass, { { "mView", 0 }, { "mProjection", 64 }, { "mReflection", 128 } });
+
+        const CBuffer& shadowPass = cbuffers.at("ShadowPassConstants");
+        CHECK(shadowPass.shaderRegister == "b2" && shadowPass.size == 4);
+    }
+}
+
+int main()
+{
+    TestPacking();
+    TestSplitConstants();
+    return 0;
+}
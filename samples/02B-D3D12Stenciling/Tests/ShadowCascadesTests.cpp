@@ -0,0 +1,292 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ShadowCascades.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const float c_lightDirection[3] = { -0.3f, 1.0f, -0.5f };
+    const ShadowSphere c_sceneBounds = { { 0.0f, 0.0f, 0.0f }, 40.0f };
+
+    // Camera at a place, turned around the vertical axis by a yaw angle.
+    ShadowCamera GetCamera(float x, float y, float z, float yaw)
+    {
+        ShadowCamera camera;
+        camera.position[0] = x;
+        camera.position[1] = y;
+        camera.position[2] = z;
+        camera.right[0] = std::cos(yaw);
+        camera.right[1] = 0.0f;
+        camera.right[2] = -std::sin(yaw);
+        camera.up[0] = 0.0f;
+        camera.up[1] = 1.0f;
+        camera.up[2] = 0.0f;
+        camera.forward[0] = std::sin(yaw);
+        camera.forward[1] = 0.0f;
+        camera.forward[2] = std::cos(yaw);
+        camera.tanHalfFovX = std::tan(0.5f * 1.2f) * 16.0f / 9.0f;
+        camera.tanHalfFovY = std::tan(0.5f * 1.2f);
+        camera.nearZ = 0.1f;
+        return camera;
+    }
+
+    void Transform(const float matrix[16], const float point[3], float result[3])
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            result[c] = point[0] * matrix[c] + point[1] * matrix[4 + c] + point[2] * matrix[8 + c] + matrix[12 + c];
+        }
+    }
+
+    // Distance to the closest whole number.
+    float GetFraction(float value)
+    {
+        return std::fabs(value - std::floor(value + 0.5f));
+    }
+
+    void TestSplits()
+    {
+        const float lambdas[] = { 0.0f, 0.3f, 0.6f, 1.0f };
+        for (uint32_t count = 1; count <= ShadowCascades::MaxCascadeCount; ++count)
+        {
+            for (float lambda : lambdas)
+            {
+                float splits[ShadowCascades::MaxCascadeCount + 1];
+                ShadowCascades::ComputeSplits(count, 0.1f, 40.0f, lambda, splits);
+                CHECK(splits[0] == 0.1f && splits[count] == 40.0f);
+                for (uint32_t i = 1; i <= count; ++i)
+                {
+                    CHECK(splits[i] > splits[i - 1]);
+                }
+            }
+        }
+
+        // Uniform and logarithmic ends of the blend.
+        float splits[5];
+        ShadowCascades::ComputeSplits(4, 1.0f, 81.0f, 0.0f, splits);
+        CHECK(std::fabs(splits[1] - 21.0f) < 1e-4f && std::fabs(splits[2] - 41.0f) < 1e-4f && std::fabs(splits[3] - 61.0f) < 1e-4f);
+        ShadowCascades::ComputeSplits(4, 1.0f, 81.0f, 1.0f, splits);
+        CHECK(std::fabs(splits[1] - 3.0f) < 1e-4f && std::fabs(splits[2] - 9.0f) < 1e-4f && std::fabs(splits[3] - 27.0f) < 1e-3f);
+    }
+
+    // The sphere of a slice holds its corners, and is as small as the slice allows.
+    void TestSliceSphere()
+    {
+        const ShadowCamera camera = GetCamera(0.0f, 0.0f, 0.0f, 0.0f);
+        const float ranges[][2] = { { 0.1f, 1.0f }, { 1.0f, 5.0f }, { 5.0f, 40.0f }, { 0.1f, 40.0f } };
+        for (const auto& range : ranges)
+        {
+            float centerZ;
+            float radius;
+            ShadowCascades::GetFrustumSliceSphere(camera.tanHalfFovX, camera.tanHalfFovY, range[0], range[1], &centerZ, &radius);
+            CHECK(centerZ >= range[0] && centerZ <= range[1]);
+
+            float farthest = 0.0f;
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                const float z = corner & 4 ? range[1] : range[0];
+                const float x = (corner & 1 ? 1.0f : -1.0f) * camera.tanHalfFovX * z;
+                const float y = (corner & 2 ? 1.0f : -1.0f) * camera.tanHalfFovY * z;
+                farthest = (std::max)(farthest, std::sqrt(x * x + y * y + (z - centerZ) * (z - centerZ)));
+            }
+            CHECK(farthest <= radius * 1.0001f);
+            CHECK(farthest >= radius * 0.9999f);
+        }
+    }
+
+    // Turning the camera in place, or moving it a little, keeps the size of the cascades,
+    // moves them by whole texels, and keeps their slices of the frustum inside them.
+    void TestStability()
+    {
+        ShadowCascadeDesc desc;
+        desc.cacheLastCascade = false;
+        ShadowCascades cascades;
+        cascades.SetDesc(desc);
+
+        // A world point, whose place in the texels of each cascade must not change.
+        const float point[3] = { 1.3f, 0.7f, 2.9f };
+        float radii[ShadowCascades::MaxCascadeCount] = {};
+        float texelPhases[ShadowCascades::MaxCascadeCount][2] = {};
+
+        for (int step = 0; step < 64; ++step)
+        {
+            const float offset = 0.013f * (step % 8);
+            const ShadowCamera camera = GetCamera(offset, 2.0f, -10.0f + offset, 0.1f * step);
+            cascades.Update(camera, c_lightDirection, c_sceneBounds);
+
+            for (uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+            {
+                const ShadowCascade& cascade = cascades.GetCascade(i);
+                CHECK(GetFraction(cascade.centerX / cascade.texelSize) < 1e-3f);
+                CHECK(GetFraction(cascade.centerY / cascade.texelSize) < 1e-3f);
+                CHECK(std::fabs(cascade.texelSize * desc.resolution - 2.0f * cascade.radius) < 1e-4f);
+
+                float clip[3];
+                Transform(cascade.viewProjection, point, clip);
+                const float texelX = (clip[0] + 1.0f) * 0.5f * desc.resolution;
+                const float texelY = (clip[1] + 1.0f) * 0.5f * desc.resolution;
+                if (step == 0)
+                {
+                    radii[i] = cascade.radius;
+                    texelPhases[i][0] = texelX - std::floor(texelX);
+                    texelPhases[i][1] = texelY - std::floor(texelY);
+                }
+                CHECK(cascade.radius == radii[i]);
+                CHECK(GetFraction(texelX - texelPhases[i][0]) < 2e-2f);
+                CHECK(GetFraction(texelY - texelPhases[i][1]) < 2e-2f);
+
+                // The corners of the slice are in the cascade.
+                for (int corner = 0; corner < 8; ++corner)
+                {
+                    const float z = corner & 4 ? cascade.splitFar : cascade.splitNear;
+                    const float x = (corner & 1 ? 1.0f : -1.0f) * camera.tanHalfFovX * z;
+                    const float y = (corner & 2 ? 1.0f : -1.0f) * camera.tanHalfFovY * z;
+                    float world[3];
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        world[axis] = camera.position[axis] + camera.right[axis] * x + camera.up[axis] * y + camera.forward[axis] * z;
+                    }
+                    Transform(cascade.viewProjection, world, clip);
+                    CHECK(std::fabs(clip[0]) <= 1.0f && std::fabs(clip[1]) <= 1.0f);
+                    CHECK(clip[2] >= 0.0f && clip[2] <= 1.0f);
+                }
+            }
+        }
+    }
+
+    void TestCachedCascade()
+    {
+        ShadowCascades cascades;
+        cascades.SetDesc(ShadowCascadeDesc());
+        const uint32_t last = cascades.GetCascadeCount() - 1;
+        CHECK(cascades.IsCached(last) && !cascades.IsCached(0));
+
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 0.0f), c_lightDirection, c_sceneBounds);
+        CHECK(cascades.GetCascade(last).needsRender);
+        float matrix[16];
+        memcpy(matrix, cascades.GetCascade(last).viewProjection, sizeof(matrix));
+
+        // Nothing moves: the cached cascade is reused, and the others are drawn again.
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 0.0f), c_lightDirection, c_sceneBounds);
+        CHECK(!cascades.GetCascade(last).needsRender);
+        CHECK(memcmp(matrix, cascades.GetCascade(last).viewProjection, sizeof(matrix)) == 0);
+        for (uint32_t i = 0; i < last; ++i)
+        {
+            CHECK(cascades.GetCascade(i).needsRender);
+        }
+
+        // Within the padding of its sphere, the camera can move a little.
+        cascades.Update(GetCamera(0.5f, 2.0f, -10.0f, 0.0f), c_lightDirection, c_sceneBounds);
+        CHECK(!cascades.GetCascade(last).needsRender);
+        CHECK(memcmp(matrix, cascades.GetCascade(last).viewProjection, sizeof(matrix)) == 0);
+
+        // Turning around, changing the light, growing the scene or invalidating redraws it.
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 3.0f), c_lightDirection, c_sceneBounds);
+        CHECK(cascades.GetCascade(last).needsRender);
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 3.0f), c_lightDirection, c_sceneBounds);
+        CHECK(!cascades.GetCascade(last).needsRender);
+
+        const float otherLight[3] = { 0.3f, 1.0f, -0.5f };
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 3.0f), otherLight, c_sceneBounds);
+        CHECK(cascades.GetCascade(last).needsRender);
+
+        const ShadowSphere largerScene = { { 0.0f, 0.0f, 0.0f }, 400.0f };
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 3.0f), otherLight, largerScene);
+        CHECK(cascades.GetCascade(last).needsRender);
+
+        cascades.InvalidateCache();
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 3.0f), otherLight, largerScene);
+        CHECK(cascades.GetCascade(last).needsRender);
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 3.0f), otherLight, largerScene);
+        CHECK(!cascades.GetCascade(last).needsRender);
+
+        // Without the cache, every cascade is drawn every frame.
+        ShadowCascadeDesc desc;
+        desc.cacheLastCascade = false;
+        cascades.SetDesc(desc);
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 0.0f), c_lightDirection, c_sceneBounds);
+        cascades.Update(GetCamera(0.0f, 2.0f, -10.0f, 0.0f), c_lightDirection, c_sceneBounds);
+        CHECK(!cascades.IsCached(last) && cascades.GetCascade(last).needsRender);
+    }
+
+    // Casters are kept when they overlap a cascade, or lie between it and the light.
+    void TestCulling()
+    {
+        ShadowCascadeDesc desc;
+        desc.cacheLastCascade = false;
+        ShadowCascades cascades;
+        cascades.SetDesc(desc);
+        const float light[3] = { 0.0f, 1.0f, 0.0f };
+        cascades.Update(GetCamera(0.0f, 2.0f, 0.0f, 0.0f), light, c_sceneBounds);
+
+        const ShadowCascade& first = cascades.GetCascade(0);
+        const float sliceZ = 0.5f * (first.splitNear + first.splitFar);
+        const ShadowSphere casters[] =
+        {
+            { { 0.0f, 2.0f, sliceZ }, 0.1f },           // In the first slice.
+            { { 0.0f, 30.0f, sliceZ }, 0.5f },          // Above it, toward the light.
+            { { 0.0f, -30.0f, sliceZ }, 0.5f },         // Under it, away from the light.
+            { { 30.0f, 2.0f, sliceZ }, 0.5f },          // To the side.
+            { { 0.0f, 2.0f, 35.0f }, 0.5f },            // In the last slice only.
+        };
+
+        std::vector<uint32_t> visible;
+        cascades.CullCasters(0, casters, 5, visible);
+        CHECK((visible == std::vector<uint32_t>{ 0, 1 }));
+
+        visible.clear();
+        cascades.CullCasters(cascades.GetCascadeCount() - 1, casters, 5, visible);
+        CHECK(std::find(visible.begin(), visible.end(), 4u) != visible.end());
+
+        const ShadowSphere bounds = ShadowCascades::GetBoundingSphere(casters, 5);
+        for (const ShadowSphere& caster : casters)
+        {
+            const float dx = caster.center[0] - bounds.center[0];
+            const float dy = caster.center[1] - bounds.center[1];
+            const float dz = caster.center[2] - bounds.center[2];
+            CHECK(std::sqrt(dx * dx + dy * dy + dz * dz) + caster.radius <= bounds.radius * 1.0001f);
+        }
+    }
+
+    void TestSettings()
+    {
+        ShadowCascades cascades;
+        ShadowCascadeDesc desc;
+        desc.cascadeCount = ShadowCascades::MaxCascadeCount + 1;
+        CHECK_THROWS(cascades.SetDesc(desc));
+        desc = ShadowCascadeDesc();
+        desc.splitLambda = 1.5f;
+        CHECK_THROWS(cascades.SetDesc(desc));
+
+        desc = ShadowCascadeDesc();
+        cascades.SetDesc(desc);
+        ShadowCamera camera = GetCamera(0.0f, 0.0f, 0.0f, 0.0f);
+        camera.nearZ = desc.shadowDistance;
+        CHECK_THROWS(cascades.Update(camera, c_lightDirection, c_sceneBounds));
+    }
+}
+
+int main()
+{
+    TestSplits();
+    TestSliceSphere();
+    TestStability();
+    TestCachedCascade();
+    TestCulling();
+    TestSettings();
+    return 0;
+}
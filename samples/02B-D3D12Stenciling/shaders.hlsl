@@ -9,16 +9,36 @@
 //--------------------------------------------------------------------------------------
 // Constant Buffer Variables
 //--------------------------------------------------------------------------------------
-cbuffer Constants : register(b0)
+cbuffer DrawConstants : register(b0)
 {
 	float4x4 mWorld;
-	float4x4 mView;
-	float4x4 mProjection;
+	float4 outputColor;
+};
+
+cbuffer FrameConstants : register(b1)
+{
+	float4x4 cascadeViewProjection[4];
+	float4 cascadeDepthBias;
+	float4 shadowParams;	// x: cascade count, y: size of a texel in uv.
 	float4 lightDir;
 	float4 lightColor;
-	float4 outputColor;
 };
 
+cbuffer ShadowPassConstants : register(b2)
+{
+	uint cascadeIndex;
+};
+
+cbuffer PassConstants : register(b3)
+{
+	float4x4 mView;
+	float4x4 mProjection;
+	float4x4 mReflection;	// Reflection through the mirror, or identity.
+};
+
+Texture2DArray<float> shadowMap : register(t0);
+SamplerComparisonState shadowSampler : register(s0);
+
  
 //--------------------------------------------------------------------------------------
 struct VS_INPUT
@@ -31,6 +51,7 @@ struct PS_INPUT
 {
 	float4 Pos : SV_POSITION;
 	float3 Normal : NORMAL;
+	float3 ShadowPos : TEXCOORD0;	// Unreflected world position.
 };
 
 
@@ -41,15 +62,62 @@ struct PS_INPUT
 PS_INPUT TriangleVS(VS_INPUT input)
 {
 	PS_INPUT output = (PS_INPUT) 0;
-	output.Pos = mul(input.Pos, mWorld);
+	float4 worldPos = mul(input.Pos, mWorld);
+	output.Pos = mul(worldPos, mReflection);
 	output.Pos = mul(output.Pos, mView);
 	output.Pos = mul(output.Pos, mProjection);
-	output.Normal = mul(input.Normal, ((float3x3) mWorld));
+	output.Normal = mul(mul(input.Normal, ((float3x3) mWorld)), ((float3x3) mReflection));
+
+	output.ShadowPos = worldPos.xyz;
     
 	return output;
 }
 
 
+//--------------------------------------------------------------------------------------
+// Name: ShadowVS
+// Desc: Vertex shader of the shadow casters, for the cascade being rendered
+//--------------------------------------------------------------------------------------
+float4 ShadowVS(VS_INPUT input) : SV_POSITION
+{
+	return mul(mul(input.Pos, mWorld), cascadeViewProjection[cascadeIndex]);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Name: ShadowVisibility
+// Desc: Fraction of the light reaching a world position, filtered over 3x3 texels of
+//       the first cascade that contains it
+//--------------------------------------------------------------------------------------
+float ShadowVisibility(float3 worldPos)
+{
+	for (uint i = 0; i < (uint) shadowParams.x; ++i)
+	{
+		float4 shadowPos = mul(float4(worldPos, 1), cascadeViewProjection[i]);
+		float2 uv = shadowPos.xy * float2(0.5, -0.5) + 0.5;
+
+		// Leave room for the filter footprint.
+		float margin = 2 * shadowParams.y;
+		if (all(uv > margin) && all(uv < 1 - margin) && shadowPos.z < 1)
+		{
+			float depth = shadowPos.z - cascadeDepthBias[i];
+			float visibility = 0;
+			[unroll]
+			for (int y = -1; y <= 1; ++y)
+			{
+				[unroll]
+				for (int x = -1; x <= 1; ++x)
+				{
+					visibility += shadowMap.SampleCmpLevelZero(shadowSampler, float3(uv, i), depth, int2(x, y));
+				}
+			}
+			return visibility / 9;
+		}
+	}
+	return 1;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Name: LambertPS
 // Desc: Pixel shader applying Lambertian lighting from two lights
@@ -59,7 +127,7 @@ float4 LambertPS(PS_INPUT input) : SV_Target
 	float4 finalColor = 0;
     
     //do NdotL lighting for one lights
-	finalColor += saturate(dot((float3) lightDir, input.Normal) * lightColor);
+	finalColor += saturate(dot((float3) lightDir, input.Normal) * lightColor) * ShadowVisibility(input.ShadowPos);
 	
 	finalColor.a = 1;
 	return finalColor;
@@ -73,4 +141,57 @@ float4 LambertPS(PS_INPUT input) : SV_Target
 float4 SolidColorPS(PS_INPUT input) : SV_Target
 {
 	return outputColor;
-}
\ No newline at end of file
+}
+
+
+//--------------------------------------------------------------------------------------
+// Name: ShadowedColorPS
+// Desc: Pixel shader applying solid color, darkened where the light is occluded
+//--------------------------------------------------------------------------------------
+float4 ShadowedColorPS(PS_INPUT input) : SV_Target
+{
+	return float4(outputColor.rgb * lerp(0.8, 1.0, ShadowVisibility(input.ShadowPos)), outputColor.a);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Dynamic resolution: the scene is drawn in the top-left corner of its target, then
+// stretched over the back buffer
+//--------------------------------------------------------------------------------------
+cbuffer UpscaleConstants : register(b4)
+{
+	float2 sceneUvScale;	// Size of the drawn part of the scene target, in uv.
+	float2 sceneUvMax;		// Last texel centers of the drawn part, so that the filter doesn't read past it.
+};
+
+Texture2D<float4> sceneColor : register(t1);
+SamplerState linearSampler : register(s1);
+
+struct UPSCALE_PS_INPUT
+{
+	float4 Pos : SV_POSITION;
+	float2 Uv : TEXCOORD0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Name: UpscaleVS
+// Desc: Vertex shader of a triangle that covers the screen
+//--------------------------------------------------------------------------------------
+UPSCALE_PS_INPUT UpscaleVS(uint vertexId : SV_VertexID)
+{
+	UPSCALE_PS_INPUT output;
+	output.Uv = float2((vertexId << 1) & 2, vertexId & 2);
+	output.Pos = float4(output.Uv * float2(2, -2) + float2(-1, 1), 0, 1);
+	return output;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Name: UpscalePS
+// Desc: Pixel shader stretching the drawn part of the scene target, filtered bilinearly
+//--------------------------------------------------------------------------------------
+float4 UpscalePS(UPSCALE_PS_INPUT input) : SV_Target
+{
+	return sceneColor.SampleLevel(linearSampler, min(input.Uv * sceneUvScale, sceneUvMax), 0);
+}
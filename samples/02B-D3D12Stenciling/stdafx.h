@@ -27,6 +27,7 @@
 #include <DirectXMath.h>
 #include "d3dx12.h"
 
+#include <fstream>
 #include <string>
 #include <vector>
 #include <wrl.h>
@@ -0,0 +1,160 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "D3D12CopyQueue.h"
+#include "DXSampleHelper.h"
+
+D3D12CopyQueue::D3D12CopyQueue() :
+    m_isRecording(false),
+    m_fenceEvent(nullptr),
+    m_lastSubmittedFenceValue(0),
+    m_pStagingData(nullptr),
+    m_stagingSize(0)
+{
+}
+
+D3D12CopyQueue::~D3D12CopyQueue()
+{
+    Shutdown();
+}
+
+void D3D12CopyQueue::Initialize(ID3D12Device* pDevice, UINT64 stagingSize)
+{
+    m_device = pDevice;
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    ThrowIfFailed(pDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
+    NAME_D3D12_OBJECT(m_commandQueue);
+
+    ThrowIfFailed(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_recordingAllocator)));
+    ThrowIfFailed(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_recordingAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    m_isRecording = true;
+
+    ThrowIfFailed(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+    m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (m_fenceEvent == nullptr)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    // The staging buffer stays mapped: the CPU only writes to it, and the Uploader
+    // never overwrites what a batch in flight still copies from.
+    ThrowIfFailed(pDevice->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(stagingSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_stagingBuffer)));
+    NAME_D3D12_OBJECT(m_stagingBuffer);
+
+    CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
+    ThrowIfFailed(m_stagingBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pStagingData)));
+    m_stagingSize = stagingSize;
+}
+
+void D3D12CopyQueue::Shutdown()
+{
+    if (m_fenceEvent == nullptr)
+    {
+        return;
+    }
+
+    WaitForFence(m_lastSubmittedFenceValue);
+    CloseHandle(m_fenceEvent);
+    m_fenceEvent = nullptr;
+
+    m_stagingBuffer->Unmap(0, nullptr);
+    m_pStagingData = nullptr;
+    m_stagingBuffer.Reset();
+    m_pendingAllocators.clear();
+}
+
+void D3D12CopyQueue::MakeQueueWait(ID3D12CommandQueue* pCommandQueue, UINT64 fenceValue)
+{
+    ThrowIfFailed(pCommandQueue->Wait(m_fence.Get(), fenceValue));
+}
+
+void D3D12CopyQueue::CopyBuffer(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size)
+{
+    BeginRecording();
+    m_commandList->CopyBufferRegion(static_cast<ID3D12Resource*>(pDestination), destinationOffset, m_stagingBuffer.Get(), stagingOffset, size);
+}
+
+void D3D12CopyQueue::CopyTexture(void* pDestination, uint32_t subresource, uint64_t stagingOffset, const StagingFootprint& footprint)
+{
+    BeginRecording();
+
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedFootprint = {};
+    placedFootprint.Offset = stagingOffset;
+    placedFootprint.Footprint = CD3DX12_SUBRESOURCE_FOOTPRINT(static_cast<DXGI_FORMAT>(footprint.format), footprint.width, footprint.height, 1, footprint.rowPitch);
+
+    const CD3DX12_TEXTURE_COPY_LOCATION destination(static_cast<ID3D12Resource*>(pDestination), subresource);
+    const CD3DX12_TEXTURE_COPY_LOCATION source(m_stagingBuffer.Get(), placedFootprint);
+    m_commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+}
+
+void D3D12CopyQueue::Submit(uint64_t fenceValue)
+{
+    if (!m_isRecording || fenceValue <= m_lastSubmittedFenceValue)
+    {
+        throw std::runtime_error("D3D12CopyQueue: nothing to submit, or the fence value didn't grow");
+    }
+
+    ThrowIfFailed(m_commandList->Close());
+    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+
+    m_pendingAllocators.push_back(PendingAllocator{ fenceValue, m_recordingAllocator });
+    m_recordingAllocator.Reset();
+    m_isRecording = false;
+    m_lastSubmittedFenceValue = fenceValue;
+}
+
+uint64_t D3D12CopyQueue::GetCompletedFenceValue()
+{
+    return m_fence->GetCompletedValue();
+}
+
+void D3D12CopyQueue::WaitForFence(uint64_t fenceValue)
+{
+    if (m_fence->GetCompletedValue() < fenceValue)
+    {
+        ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    }
+}
+
+void D3D12CopyQueue::BeginRecording()
+{
+    if (m_isRecording)
+    {
+        return;
+    }
+
+    // Reuse the allocator of the oldest batch if it's done, or make a new one.
+    if (!m_pendingAllocators.empty() && m_pendingAllocators.front().fenceValue <= m_fence->GetCompletedValue())
+    {
+        m_recordingAllocator = m_pendingAllocators.front().allocator;
+        m_pendingAllocators.pop_front();
+        ThrowIfFailed(m_recordingAllocator->Reset());
+    }
+    else
+    {
+        ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_recordingAllocator)));
+    }
+    ThrowIfFailed(m_commandList->Reset(m_recordingAllocator.Get(), nullptr));
+    m_isRecording = true;
+}
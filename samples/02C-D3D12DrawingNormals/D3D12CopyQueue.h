@@ -0,0 +1,71 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "Uploader.h"
+
+// A D3D12 copy queue with its own fence, and a persistently mapped staging buffer in
+// an upload heap, for the Uploader.
+// The copy queue only writes to resources in the COMMON state. Buffers decay back to
+// it once the batch is done, and are then implicitly promoted by the queue that reads
+// them, so they need no barriers.
+class D3D12CopyQueue : public CopyQueue
+{
+public:
+    D3D12CopyQueue();
+    virtual ~D3D12CopyQueue();
+
+    void Initialize(ID3D12Device* pDevice, UINT64 stagingSize);
+
+    // Waits until the copy queue is idle, and releases it.
+    void Shutdown();
+
+    // Makes pCommandQueue wait, on the GPU, until the batch of fenceValue is done.
+    void MakeQueueWait(ID3D12CommandQueue* pCommandQueue, UINT64 fenceValue);
+
+    virtual uint8_t* GetStagingData()           { return m_pStagingData; }
+    virtual uint64_t GetStagingSize() const     { return m_stagingSize; }
+
+    // The destinations are ID3D12Resource pointers.
+    virtual void CopyBuffer(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size);
+    virtual void CopyTexture(void* pDestination, uint32_t subresource, uint64_t stagingOffset, const StagingFootprint& footprint);
+
+    virtual void Submit(uint64_t fenceValue);
+    virtual uint64_t GetCompletedFenceValue();
+    virtual void WaitForFence(uint64_t fenceValue);
+
+private:
+    // Opens the command list on a free allocator, if it isn't recording yet.
+    void BeginRecording();
+
+    // The allocators of the submitted batches are reused once their fence value is reached.
+    struct PendingAllocator
+    {
+        UINT64 fenceValue;
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+    };
+
+    Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_recordingAllocator;
+    std::deque<PendingAllocator> m_pendingAllocators;
+    bool m_isRecording;
+
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+    HANDLE m_fenceEvent;
+    UINT64 m_lastSubmittedFenceValue;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_stagingBuffer;
+    uint8_t* m_pStagingData;
+    UINT64 m_stagingSize;
+};
@@ -17,6 +17,7 @@ D3D12DrawingNormals::D3D12DrawingNormals(UINT width, UINT height, std::wstring n
     DXSample(width, height, name),
     m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
     m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+    m_commandList(m_renderStats),
     m_constantDataGpuAddr(0),
     m_mappedConstantData(nullptr),
     m_rtvDescriptorSize(0),
@@ -24,11 +25,13 @@ D3D12DrawingNormals::D3D12DrawingNormals(UINT width, UINT height, std::wstring n
     m_fenceValues{},
     m_fenceEvent(nullptr),
     m_curRotationAngleRad(0.0f),
+    m_numDrawCalls(0),
     m_indexBufferView{},
     m_vertexBufferView{}
 {
     // Initialize the world matrix
     m_worldMatrix = XMMatrixIdentity();
+    m_meshMatrix = XMMatrixIdentity();
 
     // Initialize the view matrix
     static const XMVECTORF32 c_eye = { 0.0f, 3.0f, -10.0f, 0.0f };
@@ -51,6 +54,8 @@ void D3D12DrawingNormals::OnInit()
 {
     LoadPipeline();
     LoadAssets();
+
+    m_benchmark.SetRenderStats(&m_renderStats);
 }
 
 // Load the rendering pipeline dependencies.
@@ -106,6 +111,10 @@ void D3D12DrawingNormals::LoadPipeline()
 
     ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
 
+    // Create the copy queue that uploads the static data, and its staging buffer.
+    m_copyQueue.Initialize(m_device.Get(), c_stagingBufferSize);
+    m_uploader.Initialize(&m_copyQueue);
+
     // Describe and create the swap chain.
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
     swapChainDesc.BufferCount = FrameCount;
@@ -222,7 +231,8 @@ void D3D12DrawingNormals::LoadAssets()
     // Create the constant buffer memory and map the resource
     {
         const D3D12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        size_t cbSize = c_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
+        m_numDrawCalls = 2 * m_sceneScale;
+        size_t cbSize = m_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
 
         const D3D12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(cbSize);
         ThrowIfFailed(m_device->CreateCommittedResource(
@@ -297,7 +307,7 @@ void D3D12DrawingNormals::LoadAssets()
     }
 
     // Create the command list.
-    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
 
     // Command lists are created in the recording state, but there is nothing
     // to record yet. The main loop expects it to be closed, so close it now.
@@ -305,27 +315,29 @@ void D3D12DrawingNormals::LoadAssets()
 
     // Create the vertex and index buffers.
     {
-        // Define the geometry for a sphere.
-        ComputeSphere(sphereVertices, sphereIndices, 5, 20);
+        // Define the geometry for a sphere, or load the mesh passed on the command line.
+        if (m_meshPath.empty())
+        {
+            ComputeSphere(sphereVertices, sphereIndices, 5, 20);
+        }
+        else
+        {
+            LoadMesh(m_meshPath, sphereVertices, sphereIndices, 5);
+        }
 
-        // Note: using upload heaps to transfer static data like vert buffers is not 
-        // recommended. Every time the GPU needs it, the upload heap will be marshalled 
-        // over. Please read up on Default Heap usage. An upload heap is used here for 
-        // code simplicity and because there are very few verts to actually transfer.
+        // The buffers live in default heaps, in the COMMON state that the copy queue
+        // writes to. The copies are batched and submitted without waiting for them:
+        // the first frames wait on the GPU instead.
         ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
             D3D12_HEAP_FLAG_NONE,
             &CD3DX12_RESOURCE_DESC::Buffer(sphereVertices.size() * sizeof(Vertex)),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&m_vertexBuffer)));
 
         // Copy the sphere data to the vertex buffer.
-        UINT8* pVertexDataBegin = nullptr;
-        CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-        ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-        memcpy(pVertexDataBegin, sphereVertices.data(), sphereVertices.size() * sizeof(Vertex));
-        m_vertexBuffer->Unmap(0, nullptr);
+        m_uploader.UploadBuffer(m_vertexBuffer.Get(), 0, sphereVertices.data(), sphereVertices.size() * sizeof(Vertex));
 
         // Initialize the vertex buffer view.
         m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
@@ -333,22 +345,22 @@ void D3D12DrawingNormals::LoadAssets()
         m_vertexBufferView.SizeInBytes = (UINT)sphereVertices.size() * sizeof(Vertex);
 
         ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
             D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(sphereIndices.size() * sizeof(UINT16)),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
+            &CD3DX12_RESOURCE_DESC::Buffer(sphereIndices.size() * sizeof(UINT32)),
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&m_indexBuffer)));
 
-        // Copy the sphere data to the index buffer.
-        ThrowIfFailed(m_indexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-        memcpy(pVertexDataBegin, sphereIndices.data(), sphereIndices.size() * sizeof(UINT16));
-        m_indexBuffer->Unmap(0, nullptr);
+        // Copy the sphere data to the index buffer. Batches complete in order, so the
+        // geometry is ready once the last upload is.
+        m_geometryUpload = m_uploader.UploadBuffer(m_indexBuffer.Get(), 0, sphereIndices.data(), sphereIndices.size() * sizeof(UINT32));
+        m_uploader.Flush();
 
         // Initialize the vertex buffer view.
         m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
-        m_indexBufferView.Format = DXGI_FORMAT_R16_UINT;
-        m_indexBufferView.SizeInBytes = (UINT)sphereIndices.size() * sizeof(UINT16);
+        m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+        m_indexBufferView.SizeInBytes = (UINT)sphereIndices.size() * sizeof(UINT32);
     }
 
     // Create synchronization objects and wait until assets have been uploaded to the GPU.
@@ -365,7 +377,8 @@ void D3D12DrawingNormals::LoadAssets()
 
         // Wait for the command list to execute; we are reusing the same command 
         // list in our main loop but for now, we just want to wait for setup to 
-        // complete before continuing.
+        // complete before continuing. The geometry uploads are on the copy queue,
+        // so this doesn't wait for them.
         WaitForGpu();
     }
 }
@@ -373,33 +386,58 @@ void D3D12DrawingNormals::LoadAssets()
 // Update frame-based values.
 void D3D12DrawingNormals::OnUpdate()
 {
-    const float rotationSpeed = 0.010f;
+    // Radians per second.
+    const float rotationSpeed = 0.6f;
+
+    m_timer.Tick();
 
     // Update the rotation constant
-    m_curRotationAngleRad += rotationSpeed;
+    m_curRotationAngleRad += rotationSpeed * static_cast<float>(m_timer.GetElapsedSeconds());
     if (m_curRotationAngleRad >= XM_2PI)
     {
         m_curRotationAngleRad -= XM_2PI;
     }
 
-    // Rotate the cube around the Y-axis
-    m_worldMatrix = XMMatrixRotationY(m_curRotationAngleRad);
+    // Rotate the mesh around the Y-axis
+    m_worldMatrix = m_meshMatrix * XMMatrixRotationY(m_curRotationAngleRad);
 }
 
 // Render the scene.
 void D3D12DrawingNormals::OnRender()
 {
     // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList();
+    {
+        BENCHMARK_PHASE(m_benchmark, "PopulateCommandList");
+        PopulateCommandList();
+    }
 
-    // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    // Execute the command list, once the geometry it draws has been uploaded.
+    {
+        BENCHMARK_PHASE(m_benchmark, "ExecuteCommandLists");
+        if (!m_geometryUpload.IsReady())
+        {
+            m_copyQueue.MakeQueueWait(m_commandQueue.Get(), m_geometryUpload.GetFenceValue());
+        }
+        ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+        m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    }
 
     // Present the frame.
-    ThrowIfFailed(m_swapChain->Present(1, 0));
+    {
+        BENCHMARK_PHASE(m_benchmark, "Present");
+        ThrowIfFailed(m_swapChain->Present(m_syncInterval, 0));
+    }
+
+    {
+        BENCHMARK_PHASE(m_benchmark, "MoveToNextFrame");
+        MoveToNextFrame();
+    }
 
-    MoveToNextFrame();
+    // Close the counters of this frame and periodically print a summary.
+    if (m_renderStats.EndFrame() % c_renderStatsDumpInterval == 0)
+    {
+        OutputDebugStringA(m_renderStats.FormatSummary(c_renderStatsDumpInterval).c_str());
+    }
 }
 
 void D3D12DrawingNormals::OnDestroy()
@@ -407,6 +445,7 @@ void D3D12DrawingNormals::OnDestroy()
     // Ensure that the GPU is no longer referencing resources that are about to be
     // cleaned up by the destructor.
     WaitForGpu();
+    m_copyQueue.Shutdown();
 
     CloseHandle(m_fenceEvent);
 }
@@ -431,7 +470,7 @@ void D3D12DrawingNormals::PopulateCommandList()
     // Index into the available constant buffers based on the number
     // of draw calls. We've allocated enough for a known number of
     // draw calls per frame times the number of back buffers
-    unsigned int constantBufferIndex = c_numDrawCalls * (m_frameIndex % FrameCount);
+    unsigned int constantBufferIndex = m_numDrawCalls * (m_frameIndex % FrameCount);
 
     // Bind the constants to the shader
     auto baseGpuAddress = m_constantDataGpuAddr + sizeof(PaddedConstantBuffer) * constantBufferIndex;
@@ -468,13 +507,25 @@ void D3D12DrawingNormals::PopulateCommandList()
     XMStoreFloat4(&cbParameters.outputColor, m_outputColor);
 
     // Set the constants for the first draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
     // Draw the Lambert lit sphere
     m_commandList->DrawIndexedInstanced((UINT)sphereIndices.size(), 1, 0, 0, 0);
     baseGpuAddress += sizeof(PaddedConstantBuffer);
     ++constantBufferIndex;
 
+    // Draw the extra copies of the sphere (-scene-scale), lined up on both sides of the first one.
+    for (UINT copy = 1; copy < m_sceneScale; ++copy)
+    {
+        XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(m_worldMatrix * GetCopyOffset(copy)));
+        m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+        m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+
+        m_commandList->DrawIndexedInstanced((UINT)sphereIndices.size(), 1, 0, 0, 0);
+        baseGpuAddress += sizeof(PaddedConstantBuffer);
+        ++constantBufferIndex;
+    }
+
     // Set the PSO for drawing normals with a solid color
     m_commandList->SetPipelineState(m_normalsPipelineState.Get());
 
@@ -482,15 +533,21 @@ void D3D12DrawingNormals::PopulateCommandList()
     m_outputColor = XMVectorSet(1, 1, 0, 0);
     XMStoreFloat4(&cbParameters.outputColor, m_outputColor);
 
-    // Set the constants for the second draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
+    for (UINT copy = 0; copy < m_sceneScale; ++copy)
+    {
+        XMStoreFloat4x4(&cbParameters.worldMatrix, XMMatrixTranspose(m_worldMatrix * GetCopyOffset(copy)));
 
-    // Bind the constants to the shader
-    baseGpuAddress = m_constantDataGpuAddr + sizeof(PaddedConstantBuffer) * constantBufferIndex;
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+        // Set the constants for the draw call
+        m_renderStats.CopyToUploadMemory(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
 
-    // Draw the normals of the sphere with the help of the GS.
-    m_commandList->DrawIndexedInstanced((UINT)sphereIndices.size(), 1, 0, 0, 0);
+        // Bind the constants to the shader
+        baseGpuAddress = m_constantDataGpuAddr + sizeof(PaddedConstantBuffer) * constantBufferIndex;
+        m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+
+        // Draw the normals of the sphere with the help of the GS.
+        m_commandList->DrawIndexedInstanced((UINT)sphereIndices.size(), 1, 0, 0, 0);
+        ++constantBufferIndex;
+    }
 
     // Indicate that the back buffer will now be used to present.
     m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
@@ -506,7 +563,7 @@ void D3D12DrawingNormals::WaitForGpu()
 
     // Wait until the fence has been processed.
     ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-    WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
 
     // Increment the fence value for the current frame.
     m_fenceValues[m_frameIndex]++;
@@ -526,14 +583,22 @@ void D3D12DrawingNormals::MoveToNextFrame()
     if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
     {
         ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+        m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
     }
 
     // Set the fence value for the next frame.
     m_fenceValues[m_frameIndex] = currentFenceValue + 1;
 }
 
-void D3D12DrawingNormals::ComputeSphere(std::vector<Vertex>& vertices, std::vector<UINT16>& indices, FLOAT diameter, UINT16 tessellation)
+// Translation of a copy of the sphere (-scene-scale). The first copy is the original
+// one, the others alternate on its right and left.
+XMMATRIX D3D12DrawingNormals::GetCopyOffset(UINT copy)
+{
+    const float side = (copy % 2) ? 1.0f : -1.0f;
+    return XMMatrixTranslation(side * 6.0f * ((copy + 1) / 2), 0.0f, 0.0f);
+}
+
+void D3D12DrawingNormals::ComputeSphere(std::vector<Vertex>& vertices, std::vector<UINT32>& indices, FLOAT diameter, UINT16 tessellation)
 {
     vertices.clear();
     indices.clear();
@@ -616,4 +681,31 @@ void D3D12DrawingNormals::ComputeSphere(std::vector<Vertex>& vertices, std::vect
             indices.push_back(i * stride + nextJ);
         }
     }
+}
+
+// Load an OBJ or glTF file, and compute a matrix that centers the mesh at the origin
+// and scales it to fit in a sphere with the specified diameter.
+void D3D12DrawingNormals::LoadMesh(const std::wstring& path, std::vector<Vertex>& vertices, std::vector<UINT32>& indices, FLOAT diameter)
+{
+    MeshImporter importer;
+    MeshData mesh;
+    importer.LoadFromFile(path, mesh);
+
+    vertices = ConvertVertices<Vertex>(mesh);
+    indices.swap(mesh.indices);
+
+    XMVECTOR boundsMin = XMVectorSet(mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2], 0);
+    XMVECTOR boundsMax = XMVectorSet(mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2], 0);
+    XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+    FLOAT extent = XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin)));
+    FLOAT scale = extent > 0.0f ? diameter / extent : 1.0f;
+
+    m_meshMatrix = XMMatrixTranslationFromVector(XMVectorNegate(center)) * XMMatrixScaling(scale, scale, scale);
+
+    // Show how fast the file was parsed.
+    const MeshImportStats& stats = importer.GetStats();
+    wchar_t text[128];
+    swprintf_s(text, L"%zu vertices, %zu triangles, %.1f MB/s on %u threads",
+        vertices.size(), indices.size() / 3, stats.GetMegabytesPerSecond(), stats.threadCount);
+    SetCustomWindowText(text);
 }
\ No newline at end of file
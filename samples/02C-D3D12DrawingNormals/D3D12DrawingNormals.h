@@ -12,6 +12,10 @@
 #pragma once
 
 #include "DXSample.h"
+#include "MeshImporter.h"
+#include "StepTimer.h"
+#include "StatsCommandList.h"
+#include "D3D12CopyQueue.h"
 
 using namespace DirectX;
 
@@ -89,7 +93,15 @@ private:
     ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
     ComPtr<ID3D12PipelineState>  m_lambertPipelineState;
     ComPtr<ID3D12PipelineState>  m_normalsPipelineState;
-    ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    RenderStats m_renderStats;
+    StatsCommandList m_commandList;     // Counts the recorded commands into m_renderStats.
+
+    // Static geometry is uploaded into default heaps through the copy queue, which the
+    // direct queue waits on until the upload is done.
+    static const UINT64 c_stagingBufferSize = 4 * 1024 * 1024;
+    D3D12CopyQueue m_copyQueue;
+    Uploader m_uploader;
+    UploadFuture m_geometryUpload;
 
     // App resources.
     ComPtr<ID3D12Resource> m_vertexBuffer;
@@ -108,30 +120,37 @@ private:
     UINT64 m_fenceValues[FrameCount];
 
     // Scene constants, updated per-frame
+    StepTimer m_timer;
     float m_curRotationAngleRad;
 
-    // In this simple sample, we know that there are three draw calls
-    // and we will update the scene constants for each draw call.
-    static const unsigned int c_numDrawCalls = 2;
+    // The sphere and its normals take a draw call each, for every copy of the sphere
+    // (-scene-scale), and we will update the scene constants for each draw call.
+    unsigned int m_numDrawCalls;
 
     // These computed values will be loaded into a ConstantBuffer
     // during Render
     XMMATRIX m_worldMatrix;
+    XMMATRIX m_meshMatrix;
     XMMATRIX m_viewMatrix;
     XMMATRIX m_projectionMatrix;
     XMVECTOR m_lightDir;
     XMVECTOR m_lightColor;
     XMVECTOR m_outputColor;
 
+    // Frames between two dumps of the render stats to the debugger output.
+    static const UINT c_renderStatsDumpInterval = 300;
+
     void LoadPipeline();
     void LoadAssets();
     void PopulateCommandList();
     void MoveToNextFrame();
     void WaitForGpu();
+    static XMMATRIX GetCopyOffset(UINT copy);
 
-    // Sphere vertices and indices
+    // Sphere (or imported mesh) vertices and indices
     std::vector<Vertex> sphereVertices;
-    std::vector<UINT16> sphereIndices;
+    std::vector<UINT32> sphereIndices;
 
-    void ComputeSphere(std::vector<Vertex>& vertices, std::vector<UINT16>& indices, FLOAT diameter, UINT16 tessellation);
+    void ComputeSphere(std::vector<Vertex>& vertices, std::vector<UINT32>& indices, FLOAT diameter, UINT16 tessellation);
+    void LoadMesh(const std::wstring& path, std::vector<Vertex>& vertices, std::vector<UINT32>& indices, FLOAT diameter);
 };
\ No newline at end of file
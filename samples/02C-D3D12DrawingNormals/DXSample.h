@@ -13,6 +13,7 @@
 
 #include "DXSampleHelper.h"
 #include "Win32Application.h"
+#include "Benchmark.h"
 
 class DXSample
 {
@@ -36,6 +37,10 @@ public:
 
     void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
 
+    // Benchmark mode (-bench), in which Win32Application renders the frames back to back.
+    Benchmark& GetBenchmark()       { return m_benchmark; }
+    void WriteBenchmarkReport();
+
 protected:
     std::wstring GetAssetFullPath(LPCWSTR assetName);
 
@@ -54,10 +59,25 @@ protected:
     // Adapter info.
     bool m_useWarpDevice;
 
+    // Optional mesh (OBJ or glTF) to draw instead of the built-in geometry.
+    std::wstring m_meshPath;
+
+    // Number of copies of the scene's objects (-scene-scale), to scale the CPU and GPU load.
+    UINT m_sceneScale;
+
+    // Vertical blanks to wait for at each present. The benchmark mode doesn't wait.
+    UINT m_syncInterval;
+
+    // Samples time the phases of their frames with BENCHMARK_PHASE(m_benchmark, ...).
+    Benchmark m_benchmark;
+
 private:
     // Root assets path.
     std::wstring m_assetsPath;
 
     // Window title.
     std::wstring m_title;
+
+    // The benchmark report is saved to <path>.csv (one row per frame) and <path>.json (summary).
+    std::wstring m_benchmarkReportPath;
 };
@@ -0,0 +1,1584 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+    // Files smaller than this are parsed by a single thread.
+    const size_t c_minObjChunkSize = 1 << 20;
+
+    //
+    // Threading helpers
+    //
+
+    // Calls func(i) for i in [0, count) on up to threadCount threads.
+    // The first exception thrown by a worker is rethrown on the calling thread.
+    template<typename Func>
+    void ParallelFor(size_t count, unsigned int threadCount, const Func& func)
+    {
+        const size_t workers = std::min<size_t>(threadCount, count);
+        if (workers <= 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                func(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        std::exception_ptr error;
+        std::atomic<bool> failed(false);
+
+        auto worker = [&]()
+        {
+            try
+            {
+                for (size_t i = next++; i < count && !failed; i = next++)
+                {
+                    func(i);
+                }
+            }
+            catch (...)
+            {
+                if (!failed.exchange(true))
+                {
+                    error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (size_t t = 1; t < workers; ++t)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::vector<uint8_t> ReadWholeFile(std::ifstream& file)
+    {
+        if (!file)
+        {
+            throw std::runtime_error("MeshImporter: unable to open the file");
+        }
+
+        file.seekg(0, std::ios::end);
+        const std::streamoff size = file.tellg();
+        file.seekg(0, std::ios::beg);
+
+        std::vector<uint8_t> data(static_cast<size_t>(size));
+        if (size > 0 && !file.read(reinterpret_cast<char*>(data.data()), size))
+        {
+            throw std::runtime_error("MeshImporter: unable to read the file");
+        }
+
+        return data;
+    }
+
+    template<typename Char>
+    std::basic_string<Char> GetExtension(const std::basic_string<Char>& path)
+    {
+        const size_t dot = path.find_last_of(Char('.'));
+        std::basic_string<Char> ext = (dot == std::basic_string<Char>::npos) ? std::basic_string<Char>() : path.substr(dot + 1);
+        for (auto& c : ext)
+        {
+            if (c >= Char('A') && c <= Char('Z'))
+            {
+                c = static_cast<Char>(c - Char('A') + Char('a'));
+            }
+        }
+        return ext;
+    }
+
+    template<typename Char>
+    std::basic_string<Char> GetDirectory(const std::basic_string<Char>& path)
+    {
+        const size_t slash = path.find_last_of(std::basic_string<Char>(1, Char('/')) + Char('\\'));
+        return (slash == std::basic_string<Char>::npos) ? std::basic_string<Char>() : path.substr(0, slash + 1);
+    }
+
+    //
+    // Number parsing
+    //
+
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline void SkipSpaces(const char*& p, const char* end)
+    {
+        while (p < end && IsSpace(*p))
+        {
+            ++p;
+        }
+    }
+
+    // Locale-independent and much faster than strtod for the short decimal numbers found in OBJ files.
+    bool ParseNumber(const char*& p, const char* end, double& value)
+    {
+        static const double c_powersOf10[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const char* s = p;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+'))
+        {
+            negative = (*s == '-');
+            ++s;
+        }
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        bool any = false;
+
+        for (; s < end && *s >= '0' && *s <= '9'; ++s, any = true)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa) ++digits;
+            }
+            else
+            {
+                ++exponent;
+            }
+        }
+
+        if (s < end && *s == '.')
+        {
+            for (++s; s < end && *s >= '0' && *s <= '9'; ++s, any = true)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*s - '0');
+                    if (mantissa) ++digits;
+                    --exponent;
+                }
+            }
+        }
+
+        if (!any)
+        {
+            return false;
+        }
+
+        if (s < end && (*s == 'e' || *s == 'E'))
+        {
+            const char* e = s + 1;
+            bool negativeExponent = false;
+            if (e < end && (*e == '-' || *e == '+'))
+            {
+                negativeExponent = (*e == '-');
+                ++e;
+            }
+
+            if (e < end && *e >= '0' && *e <= '9')
+            {
+                int explicitExponent = 0;
+                for (; e < end && *e >= '0' && *e <= '9'; ++e)
+                {
+                    explicitExponent = std::min(explicitExponent * 10 + (*e - '0'), 1000);
+                }
+                exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                s = e;
+            }
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0)
+        {
+            result = (exponent >= -22) ? result / c_powersOf10[-exponent] : result * std::pow(10.0, exponent);
+        }
+        else if (exponent > 0)
+        {
+            result = (exponent <= 22) ? result * c_powersOf10[exponent] : result * std::pow(10.0, exponent);
+        }
+
+        value = negative ? -result : result;
+        p = s;
+        return true;
+    }
+
+    inline bool ParseFloat(const char*& p, const char* end, float& value)
+    {
+        double number;
+        if (!ParseNumber(p, end, number))
+        {
+            return false;
+        }
+        value = static_cast<float>(number);
+        return true;
+    }
+
+    bool ParseInt(const char*& p, const char* end, int32_t& value)
+    {
+        const char* s = p;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+'))
+        {
+            negative = (*s == '-');
+            ++s;
+        }
+
+        if (s == end || *s < '0' || *s > '9')
+        {
+            return false;
+        }
+
+        int64_t result = 0;
+        for (; s < end && *s >= '0' && *s <= '9'; ++s)
+        {
+            result = std::min<int64_t>(result * 10 + (*s - '0'), INT32_MAX);
+        }
+
+        value = static_cast<int32_t>(negative ? -result : result);
+        p = s;
+        return true;
+    }
+
+    //
+    // Geometry helpers
+    //
+
+    void ComputeBounds(MeshData& mesh)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            mesh.boundsMin[c] = mesh.vertices.empty() ? 0.0f : FLT_MAX;
+            mesh.boundsMax[c] = mesh.vertices.empty() ? 0.0f : -FLT_MAX;
+        }
+
+        for (const auto& v : mesh.vertices)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                mesh.boundsMin[c] = std::min(mesh.boundsMin[c], v.position[c]);
+                mesh.boundsMax[c] = std::max(mesh.boundsMax[c], v.position[c]);
+            }
+        }
+    }
+
+    void Normalize3(float* v)
+    {
+        const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length > 0.0f)
+        {
+            v[0] /= length;
+            v[1] /= length;
+            v[2] /= length;
+        }
+    }
+
+    // Smooth normals weighted by the area of the adjacent triangles.
+    void GenerateNormals(MeshData& mesh)
+    {
+        for (auto& v : mesh.vertices)
+        {
+            v.normal[0] = v.normal[1] = v.normal[2] = 0.0f;
+        }
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            MeshVertex& v0 = mesh.vertices[mesh.indices[i]];
+            MeshVertex& v1 = mesh.vertices[mesh.indices[i + 1]];
+            MeshVertex& v2 = mesh.vertices[mesh.indices[i + 2]];
+
+            const float e1[3] = { v1.position[0] - v0.position[0], v1.position[1] - v0.position[1], v1.position[2] - v0.position[2] };
+            const float e2[3] = { v2.position[0] - v0.position[0], v2.position[1] - v0.position[1], v2.position[2] - v0.position[2] };
+
+            // Clockwise front faces in a left-handed system: n = e1 x e2.
+            const float n[3] =
+            {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0]
+            };
+
+            for (int c = 0; c < 3; ++c)
+            {
+                v0.normal[c] += n[c];
+                v1.normal[c] += n[c];
+                v2.normal[c] += n[c];
+            }
+        }
+
+        for (auto& v : mesh.vertices)
+        {
+            Normalize3(v.normal);
+        }
+    }
+
+    //
+    // OBJ
+    //
+
+    // An OBJ index as written in a face, resolved against the chunk that contains it.
+    // Negative (relative) indices depend on how many elements the previous chunks declared,
+    // which is only known after every chunk has been parsed.
+    struct ObjIndex
+    {
+        int32_t value;
+        bool relative;
+    };
+
+    struct ObjCorner
+    {
+        ObjIndex position;
+        ObjIndex normal;      // value == 0 and !relative when the corner has no normal.
+    };
+
+    struct ObjChunk
+    {
+        std::vector<float> positions;
+        std::vector<float> colors;
+        std::vector<float> normals;
+        std::vector<ObjCorner> corners;   // Already triangulated.
+        size_t colorCount = 0;
+    };
+
+    bool ParseObjIndex(const char*& p, const char* end, size_t localCount, ObjIndex& index)
+    {
+        int32_t value;
+        if (!ParseInt(p, end, value) || value == 0)
+        {
+            return false;
+        }
+
+        if (value < 0)
+        {
+            // Relative to the last element declared so far; local to this chunk until resolved.
+            index.value = static_cast<int32_t>(localCount) + value;
+            index.relative = true;
+        }
+        else
+        {
+            index.value = value - 1;
+            index.relative = false;
+        }
+        return true;
+    }
+
+    void ParseObjChunk(const char* begin, const char* end, ObjChunk& chunk)
+    {
+        std::vector<ObjCorner> face;
+
+        const char* p = begin;
+        while (p < end)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (!lineEnd)
+            {
+                lineEnd = end;
+            }
+
+            SkipSpaces(p, lineEnd);
+
+            if (p + 1 < lineEnd && p[0] == 'v' && IsSpace(p[1]))
+            {
+                // v x y z [r g b]
+                ++p;
+                float values[6];
+                int count = 0;
+                for (; count < 6; ++count)
+                {
+                    SkipSpaces(p, lineEnd);
+                    if (!ParseFloat(p, lineEnd, values[count]))
+                    {
+                        break;
+                    }
+                }
+
+                if (count < 3)
+                {
+                    throw std::runtime_error("MeshImporter: malformed OBJ vertex");
+                }
+
+                chunk.positions.insert(chunk.positions.end(), values, values + 3);
+                if (count == 6)
+                {
+                    chunk.colors.resize(chunk.positions.size() - 3, 1.0f);
+                    chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+                    chunk.colorCount++;
+                }
+            }
+            else if (p + 2 < lineEnd && p[0] == 'v' && p[1] == 'n' && IsSpace(p[2]))
+            {
+                // vn x y z
+                p += 2;
+                float values[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    SkipSpaces(p, lineEnd);
+                    if (!ParseFloat(p, lineEnd, values[c]))
+                    {
+                        throw std::runtime_error("MeshImporter: malformed OBJ normal");
+                    }
+                }
+                chunk.normals.insert(chunk.normals.end(), values, values + 3);
+            }
+            else if (p + 1 < lineEnd && p[0] == 'f' && IsSpace(p[1]))
+            {
+                // f v[/vt][/vn] ...
+                ++p;
+                face.clear();
+
+                const size_t positionCount = chunk.positions.size() / 3;
+                const size_t normalCount = chunk.normals.size() / 3;
+
+                for (;;)
+                {
+                    SkipSpaces(p, lineEnd);
+                    if (p >= lineEnd)
+                    {
+                        break;
+                    }
+
+                    ObjCorner corner = {};
+                    if (!ParseObjIndex(p, lineEnd, positionCount, corner.position))
+                    {
+                        throw std::runtime_error("MeshImporter: malformed OBJ face");
+                    }
+
+                    if (p < lineEnd && *p == '/')
+                    {
+                        ++p;
+                        int32_t ignoredTexCoord;
+                        ParseInt(p, lineEnd, ignoredTexCoord);
+
+                        if (p < lineEnd && *p == '/')
+                        {
+                            ++p;
+                            if (!ParseObjIndex(p, lineEnd, normalCount, corner.normal))
+                            {
+                                throw std::runtime_error("MeshImporter: malformed OBJ face");
+                            }
+                            // Store normals shifted by one so that zero means "no normal".
+                            corner.normal.value++;
+                        }
+                    }
+
+                    face.push_back(corner);
+                }
+
+                // Triangulate the polygon as a fan. The z mirror applied to the positions keeps
+                // the counter-clockwise order of OBJ on screen, so the last two corners are
+                // swapped to make the front faces clockwise.
+                for (size_t i = 2; i < face.size(); ++i)
+                {
+                    chunk.corners.push_back(face[0]);
+                    chunk.corners.push_back(face[i]);
+                    chunk.corners.push_back(face[i - 1]);
+                }
+            }
+
+            // Any other statement (vt, g, o, s, usemtl, comments...) is ignored.
+            p = lineEnd + 1;
+        }
+    }
+
+    //
+    // JSON (only what glTF needs)
+    //
+
+    struct JsonValue
+    {
+        enum Type { Null, Bool, Number, String, Array, Object };
+
+        Type type = Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> elements;
+        std::vector<std::pair<std::string, JsonValue>> members;
+
+        const JsonValue* Find(const char* key) const
+        {
+            for (const auto& member : members)
+            {
+                if (member.first == key)
+                {
+                    return &member.second;
+                }
+            }
+            return nullptr;
+        }
+
+        double GetNumber(const char* key, double defaultValue) const
+        {
+            const JsonValue* value = Find(key);
+            return (value && value->type == Number) ? value->number : defaultValue;
+        }
+
+        size_t GetIndex(const char* key, size_t defaultValue) const
+        {
+            const JsonValue* value = Find(key);
+            return (value && value->type == Number && value->number >= 0.0) ? static_cast<size_t>(value->number) : defaultValue;
+        }
+
+        const JsonValue& operator[](size_t i) const
+        {
+            if (type != Array || i >= elements.size())
+            {
+                throw std::runtime_error("MeshImporter: glTF index out of range");
+            }
+            return elements[i];
+        }
+    };
+
+    class JsonParser
+    {
+    public:
+        JsonParser(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+        void Parse(JsonValue& value)
+        {
+            ParseValue(value, 0);
+        }
+
+    private:
+        const char* m_p;
+        const char* m_end;
+
+        void Fail()
+        {
+            throw std::runtime_error("MeshImporter: malformed glTF JSON");
+        }
+
+        void SkipWhitespace()
+        {
+            while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n'))
+            {
+                ++m_p;
+            }
+        }
+
+        void Expect(char c)
+        {
+            SkipWhitespace();
+            if (m_p >= m_end || *m_p != c)
+            {
+                Fail();
+            }
+            ++m_p;
+        }
+
+        bool Match(const char* literal)
+        {
+            const size_t length = strlen(literal);
+            if (static_cast<size_t>(m_end - m_p) >= length && memcmp(m_p, literal, length) == 0)
+            {
+                m_p += length;
+                return true;
+            }
+            return false;
+        }
+
+        void ParseValue(JsonValue& value, int depth)
+        {
+            if (depth > 256)
+            {
+                Fail();
+            }
+
+            SkipWhitespace();
+            if (m_p >= m_end)
+            {
+                Fail();
+            }
+
+            switch (*m_p)
+            {
+            case '{':
+                value.type = JsonValue::Object;
+                ++m_p;
+                SkipWhitespace();
+                if (m_p < m_end && *m_p == '}')
+                {
+                    ++m_p;
+                    break;
+                }
+                for (;;)
+                {
+                    value.members.emplace_back();
+                    SkipWhitespace();
+                    ParseString(value.members.back().first);
+                    Expect(':');
+                    ParseValue(value.members.back().second, depth + 1);
+                    SkipWhitespace();
+                    if (m_p < m_end && *m_p == ',')
+                    {
+                        ++m_p;
+                        continue;
+                    }
+                    Expect('}');
+                    break;
+                }
+                break;
+
+            case '[':
+                value.type = JsonValue::Array;
+                ++m_p;
+                SkipWhitespace();
+                if (m_p < m_end && *m_p == ']')
+                {
+                    ++m_p;
+                    break;
+                }
+                for (;;)
+                {
+                    value.elements.emplace_back();
+                    ParseValue(value.elements.back(), depth + 1);
+                    SkipWhitespace();
+                    if (m_p < m_end && *m_p == ',')
+                    {
+                        ++m_p;
+                        continue;
+                    }
+                    Expect(']');
+                    break;
+                }
+                break;
+
+            case '"':
+                value.type = JsonValue::String;
+                ParseString(value.string);
+                break;
+
+            default:
+                if (Match("true"))
+                {
+                    value.type = JsonValue::Bool;
+                    value.boolean = true;
+                }
+                else if (Match("false"))
+                {
+                    value.type = JsonValue::Bool;
+                }
+                else if (Match("null"))
+                {
+                    value.type = JsonValue::Null;
+                }
+                else
+                {
+                    if (!ParseNumber(m_p, m_end, value.number))
+                    {
+                        Fail();
+                    }
+                    value.type = JsonValue::Number;
+                }
+                break;
+            }
+        }
+
+        void ParseString(std::string& s)
+        {
+            if (m_p >= m_end || *m_p != '"')
+            {
+                Fail();
+            }
+            ++m_p;
+
+            while (m_p < m_end && *m_p != '"')
+            {
+                if (*m_p == '\\')
+                {
+                    if (++m_p >= m_end)
+                    {
+                        Fail();
+                    }
+
+                    switch (*m_p)
+                    {
+                    case 'b': s += '\b'; break;
+                    case 'f': s += '\f'; break;
+                    case 'n': s += '\n'; break;
+                    case 'r': s += '\r'; break;
+                    case 't': s += '\t'; break;
+                    case 'u':
+                        // Keys and URIs used by the importer are ASCII; other code points are replaced.
+                        if (m_end - m_p < 5)
+                        {
+                            Fail();
+                        }
+                        m_p += 4;
+                        s += '?';
+                        break;
+                    default: s += *m_p; break;
+                    }
+                    ++m_p;
+                }
+                else
+                {
+                    s += *m_p++;
+                }
+            }
+
+            if (m_p >= m_end)
+            {
+                Fail();
+            }
+            ++m_p;
+        }
+    };
+
+    //
+    // glTF
+    //
+
+    std::vector<uint8_t> DecodeBase64(const char* p, const char* end)
+    {
+        static const auto decodeChar = [](char c) -> int
+        {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+' || c == '-') return 62;
+            if (c == '/' || c == '_') return 63;
+            return -1;
+        };
+
+        std::vector<uint8_t> out;
+        out.reserve((end - p) * 3 / 4);
+
+        uint32_t bits = 0;
+        int bitCount = 0;
+        for (; p < end && *p != '='; ++p)
+        {
+            const int v = decodeChar(*p);
+            if (v < 0)
+            {
+                throw std::runtime_error("MeshImporter: invalid base64 data in glTF buffer");
+            }
+
+            bits = (bits << 6) | static_cast<uint32_t>(v);
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                out.push_back(static_cast<uint8_t>(bits >> bitCount));
+            }
+        }
+
+        return out;
+    }
+
+    // Column-major 4x4 matrix, as stored by glTF.
+    struct Matrix4
+    {
+        float m[16];
+
+        static Matrix4 Identity()
+        {
+            Matrix4 r = {};
+            r.m[0] = r.m[5] = r.m[10] = r.m[15] = 1.0f;
+            return r;
+        }
+
+        Matrix4 operator*(const Matrix4& b) const
+        {
+            Matrix4 r;
+            for (int col = 0; col < 4; ++col)
+            {
+                for (int row = 0; row < 4; ++row)
+                {
+                    float sum = 0.0f;
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        sum += m[k * 4 + row] * b.m[col * 4 + k];
+                    }
+                    r.m[col * 4 + row] = sum;
+                }
+            }
+            return r;
+        }
+    };
+
+    Matrix4 GetNodeMatrix(const JsonValue& node)
+    {
+        const JsonValue* matrix = node.Find("matrix");
+        if (matrix && matrix->type == JsonValue::Array && matrix->elements.size() == 16)
+        {
+            Matrix4 r;
+            for (int i = 0; i < 16; ++i)
+            {
+                r.m[i] = static_cast<float>((*matrix)[i].number);
+            }
+            return r;
+        }
+
+        float t[3] = { 0.0f, 0.0f, 0.0f };
+        float q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        float s[3] = { 1.0f, 1.0f, 1.0f };
+
+        const JsonValue* translation = node.Find("translation");
+        const JsonValue* rotation = node.Find("rotation");
+        const JsonValue* scale = node.Find("scale");
+        for (int i = 0; i < 3 && translation && i < (int)translation->elements.size(); ++i) t[i] = static_cast<float>((*translation)[i].number);
+        for (int i = 0; i < 4 && rotation && i < (int)rotation->elements.size(); ++i) q[i] = static_cast<float>((*rotation)[i].number);
+        for (int i = 0; i < 3 && scale && i < (int)scale->elements.size(); ++i) s[i] = static_cast<float>((*scale)[i].number);
+
+        // T * R * S
+        const float x = q[0], y = q[1], z = q[2], w = q[3];
+        Matrix4 r = Matrix4::Identity();
+        r.m[0] = (1.0f - 2.0f * (y * y + z * z)) * s[0];
+        r.m[1] = (2.0f * (x * y + z * w)) * s[0];
+        r.m[2] = (2.0f * (x * z - y * w)) * s[0];
+        r.m[4] = (2.0f * (x * y - z * w)) * s[1];
+        r.m[5] = (1.0f - 2.0f * (x * x + z * z)) * s[1];
+        r.m[6] = (2.0f * (y * z + x * w)) * s[1];
+        r.m[8] = (2.0f * (x * z + y * w)) * s[2];
+        r.m[9] = (2.0f * (y * z - x * w)) * s[2];
+        r.m[10] = (1.0f - 2.0f * (x * x + y * y)) * s[2];
+        r.m[12] = t[0];
+        r.m[13] = t[1];
+        r.m[14] = t[2];
+        return r;
+    }
+
+    struct GltfDocument
+    {
+        JsonValue json;
+        std::vector<std::vector<uint8_t>> buffers;
+    };
+
+    size_t GetComponentCount(const std::string& type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT4") return 16;
+        throw std::runtime_error("MeshImporter: unsupported glTF accessor type");
+    }
+
+    size_t GetComponentSize(int componentType)
+    {
+        switch (componentType)
+        {
+        case 5120: case 5121: return 1;   // BYTE, UNSIGNED_BYTE
+        case 5122: case 5123: return 2;   // SHORT, UNSIGNED_SHORT
+        case 5125: case 5126: return 4;   // UNSIGNED_INT, FLOAT
+        }
+        throw std::runtime_error("MeshImporter: unsupported glTF component type");
+    }
+
+    // Resolves an accessor to a strided view of its buffer.
+    struct AccessorView
+    {
+        const uint8_t* data;        // nullptr if the accessor has no buffer view (all zeros).
+        size_t count;
+        size_t components;
+        size_t stride;
+        int componentType;
+        bool normalized;
+    };
+
+    AccessorView GetAccessorView(const GltfDocument& doc, size_t accessorIndex)
+    {
+        const JsonValue* accessors = doc.json.Find("accessors");
+        if (!accessors)
+        {
+            throw std::runtime_error("MeshImporter: glTF file has no accessors");
+        }
+
+        const JsonValue& accessor = (*accessors)[accessorIndex];
+        if (accessor.Find("sparse"))
+        {
+            throw std::runtime_error("MeshImporter: sparse glTF accessors are not supported");
+        }
+
+        const JsonValue* type = accessor.Find("type");
+        const JsonValue* normalized = accessor.Find("normalized");
+
+        AccessorView view = {};
+        view.count = accessor.GetIndex("count", 0);
+        view.components = GetComponentCount(type ? type->string : std::string());
+        view.componentType = static_cast<int>(accessor.GetNumber("componentType", 5126));
+        view.normalized = normalized && normalized->boolean;
+        view.stride = view.components * GetComponentSize(view.componentType);
+
+        const size_t bufferViewIndex = accessor.GetIndex("bufferView", SIZE_MAX);
+        if (bufferViewIndex == SIZE_MAX)
+        {
+            return view;
+        }
+
+        const JsonValue& bufferView = (*doc.json.Find("bufferViews"))[bufferViewIndex];
+        const size_t bufferIndex = bufferView.GetIndex("buffer", 0);
+        if (bufferIndex >= doc.buffers.size())
+        {
+            throw std::runtime_error("MeshImporter: glTF buffer index out of range");
+        }
+
+        const std::vector<uint8_t>& buffer = doc.buffers[bufferIndex];
+        const size_t offset = bufferView.GetIndex("byteOffset", 0) + accessor.GetIndex("byteOffset", 0);
+        const size_t byteStride = bufferView.GetIndex("byteStride", 0);
+        if (byteStride)
+        {
+            view.stride = byteStride;
+        }
+
+        const size_t elementSize = view.components * GetComponentSize(view.componentType);
+        if (view.count && offset + (view.count - 1) * view.stride + elementSize > buffer.size())
+        {
+            throw std::runtime_error("MeshImporter: glTF accessor exceeds its buffer");
+        }
+
+        view.data = buffer.data() + offset;
+        return view;
+    }
+
+    float ReadComponent(const uint8_t* p, int componentType, bool normalized)
+    {
+        switch (componentType)
+        {
+        case 5126: { float v; memcpy(&v, p, 4); return v; }
+        case 5121: return normalized ? *p / 255.0f : static_cast<float>(*p);
+        case 5120: { int8_t v = static_cast<int8_t>(*p); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+        case 5123: { uint16_t v; memcpy(&v, p, 2); return normalized ? v / 65535.0f : v; }
+        case 5122: { int16_t v; memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+        case 5125: { uint32_t v; memcpy(&v, p, 4); return static_cast<float>(v); }
+        }
+        return 0.0f;
+    }
+
+    uint32_t ReadIndex(const uint8_t* p, int componentType)
+    {
+        switch (componentType)
+        {
+        case 5121: return *p;
+        case 5123: { uint16_t v; memcpy(&v, p, 2); return v; }
+        case 5125: { uint32_t v; memcpy(&v, p, 4); return v; }
+        }
+        throw std::runtime_error("MeshImporter: unsupported glTF index type");
+    }
+
+    // A glTF primitive decoded to unique vertices, in the local space of its mesh.
+    struct DecodedPrimitive
+    {
+        std::vector<MeshVertex> vertices;
+        std::vector<uint32_t> indices;
+        size_t sourceVertices = 0;
+    };
+
+    struct MeshVertexHash
+    {
+        size_t operator()(const MeshVertex& v) const
+        {
+            // FNV-1a over the bytes of the vertex.
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&v);
+            uint64_t hash = 1469598103934665603ull;
+            for (size_t i = 0; i < sizeof(MeshVertex); ++i)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    struct MeshVertexEqual
+    {
+        bool operator()(const MeshVertex& a, const MeshVertex& b) const
+        {
+            return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+        }
+    };
+
+    void DecodePrimitive(const GltfDocument& doc, const JsonValue& primitive, DecodedPrimitive& out)
+    {
+        const JsonValue* attributes = primitive.Find("attributes");
+        const size_t positionIndex = attributes ? attributes->GetIndex("POSITION", SIZE_MAX) : SIZE_MAX;
+        if (positionIndex == SIZE_MAX)
+        {
+            return;
+        }
+
+        const AccessorView positions = GetAccessorView(doc, positionIndex);
+        const size_t normalIndex = attributes->GetIndex("NORMAL", SIZE_MAX);
+        const size_t colorIndex = attributes->GetIndex("COLOR_0", SIZE_MAX);
+
+        AccessorView normals = {};
+        AccessorView colors = {};
+        if (normalIndex != SIZE_MAX) normals = GetAccessorView(doc, normalIndex);
+        if (colorIndex != SIZE_MAX) colors = GetAccessorView(doc, colorIndex);
+
+        // Read the attributes of every element referenced by the primitive.
+        std::vector<MeshVertex> elements(positions.count);
+        for (size_t i = 0; i < positions.count; ++i)
+        {
+            MeshVertex& v = elements[i];
+            const size_t positionComponentSize = GetComponentSize(positions.componentType);
+            for (int c = 0; c < 3; ++c)
+            {
+                v.position[c] = positions.data ? ReadComponent(positions.data + i * positions.stride + c * positionComponentSize, positions.componentType, positions.normalized) : 0.0f;
+                v.normal[c] = 0.0f;
+            }
+
+            if (normals.data && i < normals.count)
+            {
+                const size_t size = GetComponentSize(normals.componentType);
+                for (int c = 0; c < 3; ++c)
+                {
+                    v.normal[c] = ReadComponent(normals.data + i * normals.stride + c * size, normals.componentType, normals.normalized);
+                }
+            }
+
+            v.color[0] = v.color[1] = v.color[2] = v.color[3] = 1.0f;
+            if (colors.data && i < colors.count)
+            {
+                const size_t size = GetComponentSize(colors.componentType);
+                for (size_t c = 0; c < std::min<size_t>(colors.components, 4); ++c)
+                {
+                    v.color[c] = ReadComponent(colors.data + i * colors.stride + c * size, colors.componentType, colors.normalized);
+                }
+            }
+        }
+
+        std::vector<uint32_t> sourceIndices;
+        const size_t indicesIndex = primitive.GetIndex("indices", SIZE_MAX);
+        if (indicesIndex != SIZE_MAX)
+        {
+            const AccessorView indices = GetAccessorView(doc, indicesIndex);
+            sourceIndices.resize(indices.count);
+            for (size_t i = 0; i < indices.count; ++i)
+            {
+                sourceIndices[i] = indices.data ? ReadIndex(indices.data + i * indices.stride, indices.componentType) : 0;
+                if (sourceIndices[i] >= elements.size())
+                {
+                    throw std::runtime_error("MeshImporter: glTF index out of range");
+                }
+            }
+        }
+        else
+        {
+            sourceIndices.resize(elements.size());
+            for (size_t i = 0; i < sourceIndices.size(); ++i)
+            {
+                sourceIndices[i] = static_cast<uint32_t>(i);
+            }
+        }
+        sourceIndices.resize(sourceIndices.size() - sourceIndices.size() % 3);
+
+        // Merge elements with identical attributes.
+        std::unordered_map<MeshVertex, uint32_t, MeshVertexHash, MeshVertexEqual> unique;
+        unique.reserve(elements.size());
+        std::vector<uint32_t> remap(elements.size(), UINT32_MAX);
+
+        out.indices.reserve(sourceIndices.size());
+        for (uint32_t sourceIndex : sourceIndices)
+        {
+            uint32_t& index = remap[sourceIndex];
+            if (index == UINT32_MAX)
+            {
+                auto result = unique.emplace(elements[sourceIndex], static_cast<uint32_t>(out.vertices.size()));
+                if (result.second)
+                {
+                    out.vertices.push_back(elements[sourceIndex]);
+                }
+                index = result.first->second;
+            }
+            out.indices.push_back(index);
+        }
+
+        out.sourceVertices = elements.size();
+
+        if (!normals.data)
+        {
+            MeshData temp;
+            temp.vertices.swap(out.vertices);
+            temp.indices.swap(out.indices);
+            GenerateNormals(temp);
+            temp.vertices.swap(out.vertices);
+            temp.indices.swap(out.indices);
+        }
+    }
+
+    struct GltfInstance
+    {
+        size_t mesh;
+        Matrix4 world;
+    };
+
+    void CollectInstances(const JsonValue& nodes, size_t nodeIndex, const Matrix4& parent, std::vector<GltfInstance>& instances, int depth)
+    {
+        if (depth > 64)
+        {
+            throw std::runtime_error("MeshImporter: glTF node hierarchy is too deep");
+        }
+
+        const JsonValue& node = nodes[nodeIndex];
+        const Matrix4 world = parent * GetNodeMatrix(node);
+
+        const size_t mesh = node.GetIndex("mesh", SIZE_MAX);
+        if (mesh != SIZE_MAX)
+        {
+            instances.push_back({ mesh, world });
+        }
+
+        const JsonValue* children = node.Find("children");
+        if (children && children->type == JsonValue::Array)
+        {
+            for (const auto& child : children->elements)
+            {
+                CollectInstances(nodes, static_cast<size_t>(child.number), world, instances, depth + 1);
+            }
+        }
+    }
+}
+
+MeshImporter::MeshImporter(unsigned int threadCount) :
+    m_threadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency())),
+    m_stats{}
+{
+}
+
+void MeshImporter::LoadFromFile(const std::string& path, MeshData& mesh)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data = ReadWholeFile(file);
+
+    const std::string ext = GetExtension(path);
+    if (ext == "obj")
+    {
+        LoadObj(reinterpret_cast<const char*>(data.data()), data.size(), mesh);
+    }
+    else if (ext == "gltf" || ext == "glb")
+    {
+        const std::string directory = GetDirectory(path);
+        LoadGltf(data.data(), data.size(), [&directory](const std::string& uri)
+        {
+            std::ifstream buffer(directory + uri, std::ios::binary);
+            return ReadWholeFile(buffer);
+        }, mesh);
+    }
+    else
+    {
+        throw std::runtime_error("MeshImporter: unsupported file extension");
+    }
+}
+
+#if defined(_WIN32)
+void MeshImporter::LoadFromFile(const std::wstring& path, MeshData& mesh)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data = ReadWholeFile(file);
+
+    const std::wstring ext = GetExtension(path);
+    if (ext == L"obj")
+    {
+        LoadObj(reinterpret_cast<const char*>(data.data()), data.size(), mesh);
+    }
+    else if (ext == L"gltf" || ext == L"glb")
+    {
+        const std::wstring directory = GetDirectory(path);
+        LoadGltf(data.data(), data.size(), [&directory](const std::string& uri)
+        {
+            // Buffer URIs are expected to be plain ASCII relative paths.
+            std::ifstream buffer(directory + std::wstring(uri.begin(), uri.end()), std::ios::binary);
+            return ReadWholeFile(buffer);
+        }, mesh);
+    }
+    else
+    {
+        throw std::runtime_error("MeshImporter: unsupported file extension");
+    }
+}
+#endif
+
+void MeshImporter::LoadObj(const char* data, size_t size, MeshData& mesh)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Split the file into chunks that end on a line boundary.
+    const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(m_threadCount, size / c_minObjChunkSize));
+    std::vector<const char*> bounds(chunkCount + 1);
+    bounds[0] = data;
+    bounds[chunkCount] = data + size;
+    for (size_t i = 1; i < chunkCount; ++i)
+    {
+        const char* p = std::max(bounds[i - 1], data + size * i / chunkCount);
+        const char* newline = static_cast<const char*>(memchr(p, '\n', data + size - p));
+        bounds[i] = newline ? newline + 1 : data + size;
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    ParallelFor(chunkCount, m_threadCount, [&](size_t i)
+    {
+        ParseObjChunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
+
+    // Global index of the first position and normal declared by each chunk.
+    std::vector<size_t> positionBase(chunkCount), normalBase(chunkCount);
+    size_t positionCount = 0, normalCount = 0, cornerCount = 0;
+    bool hasColors = false, hasNormals = false;
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        positionBase[i] = positionCount;
+        normalBase[i] = normalCount;
+        positionCount += chunks[i].positions.size() / 3;
+        normalCount += chunks[i].normals.size() / 3;
+        cornerCount += chunks[i].corners.size();
+        hasColors |= chunks[i].colorCount > 0;
+        hasNormals |= !chunks[i].normals.empty();
+    }
+
+    auto resolve = [](const ObjIndex& index, size_t base, size_t count) -> size_t
+    {
+        const int64_t value = index.relative ? static_cast<int64_t>(base) + index.value : index.value;
+        if (value < 0 || static_cast<size_t>(value) >= count)
+        {
+            throw std::runtime_error("MeshImporter: OBJ index out of range");
+        }
+        return static_cast<size_t>(value);
+    };
+
+    // Locate a position (or a normal) by its global index.
+    auto findChunk = [](const std::vector<size_t>& base, size_t index)
+    {
+        return static_cast<size_t>(std::upper_bound(base.begin(), base.end(), index) - base.begin()) - 1;
+    };
+
+    // Deduplicate the (position, normal) pairs referenced by the faces.
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.indices.reserve(cornerCount);
+
+    std::unordered_map<uint64_t, uint32_t> unique;
+    unique.reserve(std::min(cornerCount, positionCount * 2));
+
+    for (size_t c = 0; c < chunkCount; ++c)
+    {
+        for (const ObjCorner& corner : chunks[c].corners)
+        {
+            const size_t position = resolve(corner.position, positionBase[c], positionCount);
+
+            // Normals are stored shifted by one; zero means the corner has no normal.
+            size_t normal = 0;
+            if (corner.normal.value != 0 || corner.normal.relative)
+            {
+                const ObjIndex shifted = { corner.normal.value - 1, corner.normal.relative };
+                normal = resolve(shifted, normalBase[c], normalCount) + 1;
+            }
+
+            const uint64_t key = (static_cast<uint64_t>(position) << 32) | normal;
+            auto result = unique.emplace(key, static_cast<uint32_t>(mesh.vertices.size()));
+            if (result.second)
+            {
+                const size_t pc = findChunk(positionBase, position);
+                const size_t pi = position - positionBase[pc];
+                const std::vector<float>& positions = chunks[pc].positions;
+                const std::vector<float>& colors = chunks[pc].colors;
+
+                MeshVertex v;
+                // OBJ is right-handed: mirror z to match the left-handed samples.
+                v.position[0] = positions[pi * 3];
+                v.position[1] = positions[pi * 3 + 1];
+                v.position[2] = -positions[pi * 3 + 2];
+
+                v.normal[0] = v.normal[1] = v.normal[2] = 0.0f;
+                if (normal)
+                {
+                    const size_t nc = findChunk(normalBase, normal - 1);
+                    const size_t ni = normal - 1 - normalBase[nc];
+                    v.normal[0] = chunks[nc].normals[ni * 3];
+                    v.normal[1] = chunks[nc].normals[ni * 3 + 1];
+                    v.normal[2] = -chunks[nc].normals[ni * 3 + 2];
+                }
+
+                v.color[0] = v.color[1] = v.color[2] = v.color[3] = 1.0f;
+                if (hasColors && pi * 3 + 2 < colors.size())
+                {
+                    v.color[0] = colors[pi * 3];
+                    v.color[1] = colors[pi * 3 + 1];
+                    v.color[2] = colors[pi * 3 + 2];
+                }
+
+                mesh.vertices.push_back(v);
+            }
+            mesh.indices.push_back(result.first->second);
+        }
+    }
+
+    if (!hasNormals)
+    {
+        GenerateNormals(mesh);
+    }
+
+    ComputeBounds(mesh);
+
+    m_stats.bytesParsed = size;
+    m_stats.sourceVertices = cornerCount;
+    m_stats.threadCount = static_cast<unsigned int>(chunkCount);
+    m_stats.parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MeshImporter::LoadGltf(const uint8_t* data, size_t size, const BufferResolver& resolver, MeshData& mesh)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    GltfDocument doc;
+    const char* jsonBegin = reinterpret_cast<const char*>(data);
+    const char* jsonEnd = jsonBegin + size;
+    std::vector<uint8_t> binaryChunk;
+
+    // Binary glTF: 12-byte header followed by a JSON chunk and an optional BIN chunk.
+    if (size >= 12 && memcmp(data, "glTF", 4) == 0)
+    {
+        uint32_t header[3];
+        memcpy(header, data, sizeof(header));
+        if (header[1] != 2 || header[2] > size)
+        {
+            throw std::runtime_error("MeshImporter: unsupported GLB file");
+        }
+
+        size_t offset = 12;
+        while (offset + 8 <= header[2])
+        {
+            uint32_t chunk[2];
+            memcpy(chunk, data + offset, sizeof(chunk));
+            offset += 8;
+            if (offset + chunk[0] > header[2])
+            {
+                throw std::runtime_error("MeshImporter: truncated GLB chunk");
+            }
+
+            if (chunk[1] == 0x4E4F534A)         // JSON
+            {
+                jsonBegin = reinterpret_cast<const char*>(data + offset);
+                jsonEnd = jsonBegin + chunk[0];
+            }
+            else if (chunk[1] == 0x004E4942)    // BIN
+            {
+                binaryChunk.assign(data + offset, data + offset + chunk[0]);
+            }
+            offset += chunk[0];
+        }
+    }
+
+    JsonParser(jsonBegin, jsonEnd).Parse(doc.json);
+
+    // Load the buffers.
+    const JsonValue* buffers = doc.json.Find("buffers");
+    if (buffers && buffers->type == JsonValue::Array)
+    {
+        doc.buffers.resize(buffers->elements.size());
+        for (size_t i = 0; i < buffers->elements.size(); ++i)
+        {
+            const JsonValue* uri = buffers->elements[i].Find("uri");
+            if (!uri)
+            {
+                doc.buffers[i].swap(binaryChunk);
+            }
+            else if (uri->string.compare(0, 5, "data:") == 0)
+            {
+                const size_t comma = uri->string.find(";base64,");
+                if (comma == std::string::npos)
+                {
+                    throw std::runtime_error("MeshImporter: unsupported glTF data URI");
+                }
+                const char* p = uri->string.c_str() + comma + 8;
+                doc.buffers[i] = DecodeBase64(p, uri->string.c_str() + uri->string.size());
+            }
+            else if (resolver)
+            {
+                doc.buffers[i] = resolver(uri->string);
+            }
+            else
+            {
+                throw std::runtime_error("MeshImporter: glTF file references an external buffer");
+            }
+        }
+    }
+
+    const JsonValue* meshes = doc.json.Find("meshes");
+    if (!meshes || meshes->type != JsonValue::Array)
+    {
+        throw std::runtime_error("MeshImporter: glTF file has no meshes");
+    }
+
+    // Flatten the primitives so that each one is decoded by a separate task.
+    std::vector<size_t> firstPrimitive(meshes->elements.size() + 1, 0);
+    std::vector<const JsonValue*> primitives;
+    for (size_t m = 0; m < meshes->elements.size(); ++m)
+    {
+        firstPrimitive[m] = primitives.size();
+        const JsonValue* list = meshes->elements[m].Find("primitives");
+        if (list && list->type == JsonValue::Array)
+        {
+            for (const auto& primitive : list->elements)
+            {
+                // Only triangle lists are imported.
+                if (primitive.GetIndex("mode", 4) == 4)
+                {
+                    primitives.push_back(&primitive);
+                }
+            }
+        }
+    }
+    firstPrimitive.back() = primitives.size();
+
+    std::vector<DecodedPrimitive> decoded(primitives.size());
+    ParallelFor(primitives.size(), m_threadCount, [&](size_t i)
+    {
+        DecodePrimitive(doc, *primitives[i], decoded[i]);
+    });
+
+    // Instantiate the meshes referenced by the nodes of the default scene.
+    std::vector<GltfInstance> instances;
+    const JsonValue* nodes = doc.json.Find("nodes");
+    const JsonValue* scenes = doc.json.Find("scenes");
+    if (nodes && scenes && scenes->type == JsonValue::Array && !scenes->elements.empty())
+    {
+        const JsonValue& scene = (*scenes)[doc.json.GetIndex("scene", 0)];
+        const JsonValue* roots = scene.Find("nodes");
+        if (roots && roots->type == JsonValue::Array)
+        {
+            for (const auto& root : roots->elements)
+            {
+                CollectInstances(*nodes, static_cast<size_t>(root.number), Matrix4::Identity(), instances, 0);
+            }
+        }
+    }
+    else
+    {
+        for (size_t m = 0; m < meshes->elements.size(); ++m)
+        {
+            instances.push_back({ m, Matrix4::Identity() });
+        }
+    }
+
+    // Compute where each instanced primitive goes in the output, then transform them in parallel.
+    struct Placement
+    {
+        size_t instance;
+        size_t primitive;
+        size_t firstVertex;
+        size_t firstIndex;
+    };
+
+    std::vector<Placement> placements;
+    size_t vertexCount = 0, indexCount = 0, sourceVertices = 0;
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        if (instances[i].mesh >= meshes->elements.size())
+        {
+            throw std::runtime_error("MeshImporter: glTF mesh index out of range");
+        }
+
+        for (size_t p = firstPrimitive[instances[i].mesh]; p < firstPrimitive[instances[i].mesh + 1]; ++p)
+        {
+            placements.push_back({ i, p, vertexCount, indexCount });
+            vertexCount += decoded[p].vertices.size();
+            indexCount += decoded[p].indices.size();
+            sourceVertices += decoded[p].sourceVertices;
+        }
+    }
+
+    if (vertexCount > UINT32_MAX)
+    {
+        throw std::runtime_error("MeshImporter: glTF scene has too many vertices");
+    }
+
+    mesh.vertices.resize(vertexCount);
+    mesh.indices.resize(indexCount);
+
+    ParallelFor(placements.size(), m_threadCount, [&](size_t i)
+    {
+        const Placement& placement = placements[i];
+        const DecodedPrimitive& primitive = decoded[placement.primitive];
+        const float* m = instances[placement.instance].world.m;
+
+        // Normals use the cofactor matrix of the upper 3x3, which is the inverse transpose
+        // scaled by the determinant; a negative determinant also flips the winding.
+        // The z mirror keeps the counter-clockwise order of glTF on screen, so the winding
+        // is swapped to clockwise unless the node transform already mirrors it.
+        const float cof[9] =
+        {
+            m[5] * m[10] - m[6] * m[9],  m[2] * m[9] - m[1] * m[10], m[1] * m[6] - m[2] * m[5],
+            m[6] * m[8] - m[4] * m[10],  m[0] * m[10] - m[2] * m[8], m[2] * m[4] - m[0] * m[6],
+            m[4] * m[9] - m[5] * m[8],   m[1] * m[8] - m[0] * m[9],  m[0] * m[5] - m[1] * m[4]
+        };
+        const float det = m[0] * cof[0] + m[4] * cof[1] + m[8] * cof[2];
+        const float sign = det < 0.0f ? -1.0f : 1.0f;
+        const bool swapWinding = !(det < 0.0f);
+
+        for (size_t v = 0; v < primitive.vertices.size(); ++v)
+        {
+            const MeshVertex& src = primitive.vertices[v];
+            MeshVertex& dst = mesh.vertices[placement.firstVertex + v];
+            const float* p = src.position;
+            const float* n = src.normal;
+
+            // glTF is right-handed: mirror z to match the left-handed samples.
+            dst.position[0] = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+            dst.position[1] = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+            dst.position[2] = -(m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]);
+
+            dst.normal[0] = sign * (cof[0] * n[0] + cof[1] * n[1] + cof[2] * n[2]);
+            dst.normal[1] = sign * (cof[3] * n[0] + cof[4] * n[1] + cof[5] * n[2]);
+            dst.normal[2] = -sign * (cof[6] * n[0] + cof[7] * n[1] + cof[8] * n[2]);
+            Normalize3(dst.normal);
+
+            memcpy(dst.color, src.color, sizeof(dst.color));
+        }
+
+        for (size_t t = 0; t < primitive.indices.size(); t += 3)
+        {
+            uint32_t* dst = &mesh.indices[placement.firstIndex + t];
+            const uint32_t base = static_cast<uint32_t>(placement.firstVertex);
+            dst[0] = base + primitive.indices[t];
+            dst[1] = base + primitive.indices[t + (swapWinding ? 2 : 1)];
+            dst[2] = base + primitive.indices[t + (swapWinding ? 1 : 2)];
+        }
+    });
+
+    ComputeBounds(mesh);
+
+    m_stats.bytesParsed = size;
+    for (const auto& buffer : doc.buffers)
+    {
+        m_stats.bytesParsed += buffer.size();
+    }
+    m_stats.sourceVertices = sourceVertices;
+    m_stats.threadCount = m_threadCount;
+    m_stats.parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,124 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Vertex produced by the importer. It carries every attribute used by the
+// samples; ConvertVertices() copies only the ones a sample's Vertex declares.
+struct MeshVertex
+{
+    float position[3];
+    float normal[3];
+    float color[4];
+};
+
+// Indexed triangle list with unique vertices.
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+
+    // Axis-aligned bounds of the vertex positions.
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// Timing of the last import, used to report the parsing throughput.
+struct MeshImportStats
+{
+    size_t bytesParsed;
+    size_t sourceVertices;     // Face corners (OBJ) or accessor elements (glTF) before deduplication.
+    double parseSeconds;
+    unsigned int threadCount;
+
+    double GetMegabytesPerSecond() const
+    {
+        return parseSeconds > 0.0 ? (static_cast<double>(bytesParsed) / (1024.0 * 1024.0)) / parseSeconds : 0.0;
+    }
+};
+
+// Loads Wavefront OBJ and glTF 2.0 (.gltf with embedded or external buffers, and .glb)
+// files into a single MeshData. OBJ files are split into line-aligned chunks parsed by
+// separate threads; glTF primitives are decoded from their accessors in parallel.
+// Errors are reported by throwing std::runtime_error.
+class MeshImporter
+{
+public:
+    // A threadCount of zero uses std::thread::hardware_concurrency().
+    explicit MeshImporter(unsigned int threadCount = 0);
+
+    // The format is chosen from the file extension (.obj, .gltf or .glb).
+    void LoadFromFile(const std::string& path, MeshData& mesh);
+#if defined(_WIN32)
+    void LoadFromFile(const std::wstring& path, MeshData& mesh);
+#endif
+
+    // Loads a file from memory. The resolver is called to fetch the external buffers
+    // referenced by a .gltf file; it can be empty when all buffers are embedded.
+    typedef std::function<std::vector<uint8_t>(const std::string& uri)> BufferResolver;
+
+    void LoadObj(const char* data, size_t size, MeshData& mesh);
+    void LoadGltf(const uint8_t* data, size_t size, const BufferResolver& resolver, MeshData& mesh);
+
+    const MeshImportStats& GetStats() const { return m_stats; }
+
+private:
+    unsigned int m_threadCount;
+    MeshImportStats m_stats;
+};
+
+namespace MeshImport
+{
+    // Members are copied only if the destination vertex declares them, so the same
+    // MeshData can feed { position, normal } and { position, color } layouts.
+    template<typename V>
+    auto CopyNormal(V& v, const MeshVertex& m, int) -> decltype(v.normal, void())
+    {
+        v.normal = decltype(v.normal)(m.normal[0], m.normal[1], m.normal[2]);
+    }
+
+    template<typename V>
+    void CopyNormal(V&, const MeshVertex&, long) {}
+
+    template<typename V>
+    auto CopyColor(V& v, const MeshVertex& m, int) -> decltype(v.color, void())
+    {
+        v.color = decltype(v.color)(m.color[0], m.color[1], m.color[2], m.color[3]);
+    }
+
+    template<typename V>
+    void CopyColor(V&, const MeshVertex&, long) {}
+}
+
+// Converts the imported vertices to the vertex layout of a sample.
+template<typename Vertex>
+std::vector<Vertex> ConvertVertices(const MeshData& mesh)
+{
+    std::vector<Vertex> vertices(mesh.vertices.size());
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        const MeshVertex& src = mesh.vertices[i];
+        Vertex& dst = vertices[i];
+
+        dst.position = decltype(dst.position)(src.position[0], src.position[1], src.position[2]);
+        MeshImport::CopyNormal(dst, src, 0);
+        MeshImport::CopyColor(dst, src, 0);
+    }
+
+    return vertices;
+}
@@ -0,0 +1,200 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MeshImporter.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures the parsing throughput of the importer on generated scenes, with one thread
+// and with every hardware thread (at least four), and checks that both produce the same mesh.
+//
+//   MeshImporterBenchmark [megabytes]
+//
+// The OBJ file is about the given size (16 MB by default); the binary glTF file holds
+// a grid of about the same number of vertices, split into several primitives.
+namespace
+{
+    const int c_runCount = 3;
+
+    // Height field written like an exported terrain: positions, normals and quads with
+    // texture coordinates, with the faces of each row following its vertices.
+    std::string GenerateObj(size_t targetSize)
+    {
+        const uint32_t width = 1024;
+        std::string obj = "# Generated terrain\nvt 0 0\n";
+        obj.reserve(targetSize + 4096);
+
+        char line[192];
+        for (uint32_t r = 0; obj.size() < targetSize; ++r)
+        {
+            for (uint32_t j = 0; j < width; ++j)
+            {
+                const float height = static_cast<float>((r * 7 + j * 3) % 97) * 0.0625f;
+                snprintf(line, sizeof(line), "v %u.5 %.4f %u.25\nvn 0.%04u 0.9 0.%04u\n", j, height, r, (j * 37) % 4000, (r * 53) % 4000);
+                obj += line;
+            }
+            if (r == 0)
+            {
+                continue;
+            }
+            for (uint32_t j = 0; j + 1 < width; ++j)
+            {
+                const uint32_t a = (r - 1) * width + j + 1;
+                const uint32_t d = r * width + j + 1;
+                snprintf(line, sizeof(line), "f %u/1/%u %u/1/%u %u/1/%u %u/1/%u\n", a, a, a + 1, a + 1, d + 1, d + 1, d, d);
+                obj += line;
+            }
+        }
+        return obj;
+    }
+
+    void AppendBytes(std::vector<uint8_t>& buffer, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    // Binary glTF with one mesh per band of the grid, each with positions, normals and
+    // 32-bit indices, so that the primitives are decoded in parallel.
+    std::vector<uint8_t> GenerateGlb(size_t vertexCount)
+    {
+        const uint32_t width = 1024;
+        const uint32_t bandCount = 8;
+        const uint32_t bandHeight = (std::max)(2u, static_cast<uint32_t>(vertexCount / width / bandCount));
+        const uint32_t bandVertices = width * bandHeight;
+        const uint32_t bandIndices = (width - 1) * (bandHeight - 1) * 6;
+
+        std::vector<uint8_t> bin;
+        std::string meshes, views, accessors;
+        for (uint32_t b = 0; b < bandCount; ++b)
+        {
+            const size_t positionOffset = bin.size();
+            for (uint32_t r = 0; r < bandHeight; ++r)
+            {
+                for (uint32_t j = 0; j < width; ++j)
+                {
+                    const float p[3] = { static_cast<float>(j), static_cast<float>((r * 7 + j * 3) % 97) * 0.0625f, static_cast<float>(b * bandHeight + r) };
+                    AppendBytes(bin, p, sizeof(p));
+                }
+            }
+            const size_t normalOffset = bin.size();
+            for (uint32_t v = 0; v < bandVertices; ++v)
+            {
+                const float n[3] = { 0.0f, 1.0f, 0.0f };
+                AppendBytes(bin, n, sizeof(n));
+            }
+            const size_t indexOffset = bin.size();
+            for (uint32_t r = 1; r < bandHeight; ++r)
+            {
+                for (uint32_t j = 0; j + 1 < width; ++j)
+                {
+                    const uint32_t a = (r - 1) * width + j;
+                    const uint32_t d = r * width + j;
+                    const uint32_t quad[6] = { a, a + 1, d + 1, a, d + 1, d };
+                    AppendBytes(bin, quad, sizeof(quad));
+                }
+            }
+
+            const std::string view = std::to_string(b * 3);
+            meshes += std::string(b ? "," : "") + "{\"primitives\":[{\"attributes\":{\"POSITION\":" + view +
+                ",\"NORMAL\":" + std::to_string(b * 3 + 1) + "},\"indices\":" + std::to_string(b * 3 + 2) + "}]}";
+            views += std::string(b ? "," : "") +
+                "{\"buffer\":0,\"byteOffset\":" + std::to_string(positionOffset) + ",\"byteLength\":" + std::to_string(normalOffset - positionOffset) + "}," +
+                "{\"buffer\":0,\"byteOffset\":" + std::to_string(normalOffset) + ",\"byteLength\":" + std::to_string(indexOffset - normalOffset) + "}," +
+                "{\"buffer\":0,\"byteOffset\":" + std::to_string(indexOffset) + ",\"byteLength\":" + std::to_string(bin.size() - indexOffset) + "}";
+            accessors += std::string(b ? "," : "") +
+                "{\"bufferView\":" + view + ",\"componentType\":5126,\"count\":" + std::to_string(bandVertices) + ",\"type\":\"VEC3\"}," +
+                "{\"bufferView\":" + std::to_string(b * 3 + 1) + ",\"componentType\":5126,\"count\":" + std::to_string(bandVertices) + ",\"type\":\"VEC3\"}," +
+                "{\"bufferView\":" + std::to_string(b * 3 + 2) + ",\"componentType\":5125,\"count\":" + std::to_string(bandIndices) + ",\"type\":\"SCALAR\"}";
+        }
+
+        std::string json = "{\"asset\":{\"version\":\"2.0\"},\"meshes\":[" + meshes + "],"
+            "\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}],"
+            "\"bufferViews\":[" + views + "],\"accessors\":[" + accessors + "]}";
+        json.resize((json.size() + 3) & ~static_cast<size_t>(3), ' ');
+
+        const uint32_t header[3] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()) };
+        const uint32_t jsonChunk[2] = { static_cast<uint32_t>(json.size()), 0x4E4F534A };
+        const uint32_t binChunk[2] = { static_cast<uint32_t>(bin.size()), 0x004E4942 };
+
+        std::vector<uint8_t> glb;
+        AppendBytes(glb, header, sizeof(header));
+        AppendBytes(glb, jsonChunk, sizeof(jsonChunk));
+        AppendBytes(glb, json.data(), json.size());
+        AppendBytes(glb, binChunk, sizeof(binChunk));
+        AppendBytes(glb, bin.data(), bin.size());
+        return glb;
+    }
+
+    // Best throughput of several runs, printed with the mesh it produced.
+    template<typename Load>
+    void Measure(const char* format, unsigned int threadCount, const Load& load, MeshData& mesh)
+    {
+        MeshImporter importer(threadCount);
+        MeshImportStats best = {};
+        for (int run = 0; run < c_runCount; ++run)
+        {
+            load(importer, mesh);
+            if (run == 0 || importer.GetStats().parseSeconds < best.parseSeconds)
+            {
+                best = importer.GetStats();
+            }
+        }
+
+        std::printf("%-5s %8.1f MB  %2u thread(s)  %8.2f ms  %8.1f MB/s  %9zu source vertices  %9zu vertices\n",
+            format, best.bytesParsed / (1024.0 * 1024.0), best.threadCount, best.parseSeconds * 1000.0,
+            best.GetMegabytesPerSecond(), best.sourceVertices, mesh.vertices.size());
+    }
+
+    bool IsSameMesh(const MeshData& a, const MeshData& b)
+    {
+        return a.vertices.size() == b.vertices.size() && a.indices == b.indices &&
+            memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(MeshVertex)) == 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    CHECK(megabytes > 0);
+
+    // At least four threads, so that the chunked path is measured on small machines too.
+    const unsigned int threadCount = (std::max)(4u, std::thread::hardware_concurrency());
+
+    const std::string obj = GenerateObj(megabytes << 20);
+    MeshData objSingle, objParallel;
+    auto loadObj = [&obj](MeshImporter& importer, MeshData& mesh)
+    {
+        importer.LoadObj(obj.data(), obj.size(), mesh);
+    };
+    Measure("OBJ", 1, loadObj, objSingle);
+    Measure("OBJ", threadCount, loadObj, objParallel);
+    CHECK(IsSameMesh(objSingle, objParallel));
+
+    const std::vector<uint8_t> glb = GenerateGlb(objSingle.vertices.size());
+    MeshData glbSingle, glbParallel;
+    auto loadGlb = [&glb](MeshImporter& importer, MeshData& mesh)
+    {
+        importer.LoadGltf(glb.data(), glb.size(), MeshImporter::BufferResolver(), mesh);
+    };
+    Measure("glTF", 1, loadGlb, glbSingle);
+    Measure("glTF", threadCount, loadGlb, glbParallel);
+    CHECK(IsSameMesh(glbSingle, glbParallel));
+
+    return 0;
+}
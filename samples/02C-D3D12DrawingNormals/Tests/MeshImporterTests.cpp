@@ -0,0 +1,461 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MeshImporter.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A cube centered on the origin, with the counter-clockwise faces of a right-handed file.
+    const float c_cubePositions[8][3] =
+    {
+        { -1.0f, -1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f }, { -1.0f, 1.0f, -1.0f },
+        { -1.0f, -1.0f,  1.0f }, { 1.0f, -1.0f,  1.0f }, { 1.0f, 1.0f,  1.0f }, { -1.0f, 1.0f,  1.0f }
+    };
+
+    const uint32_t c_cubeFaces[6][4] =
+    {
+        { 4, 5, 6, 7 }, { 0, 3, 2, 1 }, { 1, 2, 6, 5 }, { 0, 4, 7, 3 }, { 3, 7, 6, 2 }, { 0, 1, 5, 4 }
+    };
+
+    const float c_cubeNormals[6][3] =
+    {
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+    };
+
+    // Colors of the faces of the cube in Tests/Data, stored as normalized bytes.
+    const uint8_t c_cubeColors[6][4] =
+    {
+        { 255, 0, 0, 255 }, { 0, 255, 0, 255 }, { 0, 0, 255, 255 }, { 255, 255, 0, 255 }, { 0, 255, 255, 255 }, { 255, 0, 255, 128 }
+    };
+
+    float Dot(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    bool IsNear(const float* v, float x, float y, float z)
+    {
+        return std::fabs(v[0] - x) < 1e-5f && std::fabs(v[1] - y) < 1e-5f && std::fabs(v[2] - z) < 1e-5f;
+    }
+
+    bool IsSameMesh(const MeshData& a, const MeshData& b)
+    {
+        return a.vertices.size() == b.vertices.size() && a.indices == b.indices &&
+            memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(MeshVertex)) == 0 &&
+            memcmp(a.boundsMin, b.boundsMin, sizeof(a.boundsMin)) == 0 &&
+            memcmp(a.boundsMax, b.boundsMax, sizeof(a.boundsMax)) == 0;
+    }
+
+    // The samples draw clockwise front faces in a left-handed system, so e1 x e2 of every
+    // triangle of a cube must point away from its center, and so must the normals.
+    void CheckOutwardCube(const MeshData& mesh, size_t firstIndex, const float* center)
+    {
+        CHECK(firstIndex + 36 <= mesh.indices.size());
+
+        for (size_t i = firstIndex; i < firstIndex + 36; i += 3)
+        {
+            const MeshVertex& v0 = mesh.vertices[mesh.indices[i]];
+            const MeshVertex& v1 = mesh.vertices[mesh.indices[i + 1]];
+            const MeshVertex& v2 = mesh.vertices[mesh.indices[i + 2]];
+
+            const float e1[3] = { v1.position[0] - v0.position[0], v1.position[1] - v0.position[1], v1.position[2] - v0.position[2] };
+            const float e2[3] = { v2.position[0] - v0.position[0], v2.position[1] - v0.position[1], v2.position[2] - v0.position[2] };
+            const float n[3] =
+            {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0]
+            };
+            const float centroid[3] =
+            {
+                v0.position[0] + v1.position[0] + v2.position[0] - 3.0f * center[0],
+                v0.position[1] + v1.position[1] + v2.position[1] - 3.0f * center[1],
+                v0.position[2] + v1.position[2] + v2.position[2] - 3.0f * center[2]
+            };
+            CHECK(Dot(n, centroid) > 0.0f);
+            CHECK(Dot(v0.normal, n) > 0.0f);
+
+            for (const MeshVertex* v : { &v0, &v1, &v2 })
+            {
+                const float offset[3] = { v->position[0] - center[0], v->position[1] - center[1], v->position[2] - center[2] };
+                CHECK(Dot(v->normal, offset) > 0.0f);
+            }
+        }
+    }
+
+    void CheckOutwardCube(const MeshData& mesh)
+    {
+        const float origin[3] = { 0.0f, 0.0f, 0.0f };
+        CHECK(mesh.indices.size() == 36);
+        CheckOutwardCube(mesh, 0, origin);
+    }
+
+    std::string CubeObj(bool withNormals)
+    {
+        std::string obj;
+        char line[128];
+        for (const auto& p : c_cubePositions)
+        {
+            snprintf(line, sizeof(line), "v %g %g %g\n", p[0], p[1], p[2]);
+            obj += line;
+        }
+        if (withNormals)
+        {
+            for (const auto& n : c_cubeNormals)
+            {
+                snprintf(line, sizeof(line), "vn %g %g %g\n", n[0], n[1], n[2]);
+                obj += line;
+            }
+        }
+        for (uint32_t f = 0; f < 6; ++f)
+        {
+            const uint32_t* q = c_cubeFaces[f];
+            if (withNormals)
+            {
+                snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u %u//%u\n", q[0] + 1, f + 1, q[1] + 1, f + 1, q[2] + 1, f + 1, q[3] + 1, f + 1);
+            }
+            else
+            {
+                snprintf(line, sizeof(line), "f %u %u %u %u\n", q[0] + 1, q[1] + 1, q[2] + 1, q[3] + 1);
+            }
+            obj += line;
+        }
+        return obj;
+    }
+
+    // A .gltf file whose only buffer is external, with the node placing the cube.
+    void LoadGltfCube(const std::string& node, MeshData& mesh)
+    {
+        std::vector<uint8_t> buffer(sizeof(c_cubePositions));
+        memcpy(buffer.data(), c_cubePositions, sizeof(c_cubePositions));
+        for (const auto& q : c_cubeFaces)
+        {
+            const uint32_t triangles[6] = { q[0], q[1], q[2], q[0], q[2], q[3] };
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(triangles);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(triangles));
+        }
+
+        const std::string json =
+            "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+            "\"nodes\":[" + node + "],"
+            "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1}]}],"
+            "\"buffers\":[{\"byteLength\":" + std::to_string(buffer.size()) + ",\"uri\":\"cube.bin\"}],"
+            "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":96},{\"buffer\":0,\"byteOffset\":96,\"byteLength\":144}],"
+            "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":8,\"type\":\"VEC3\"},"
+            "{\"bufferView\":1,\"componentType\":5125,\"count\":36,\"type\":\"SCALAR\"}]}";
+
+        MeshImporter importer(2);
+        importer.LoadGltf(reinterpret_cast<const uint8_t*>(json.data()), json.size(),
+            [&](const std::string& uri)
+            {
+                CHECK(uri == "cube.bin");
+                return buffer;
+            }, mesh);
+    }
+
+    // A height field of c_gridWidth x c_gridHeight vertices spanning several MB, so that
+    // the importer splits it into chunks. The faces of each row follow its vertices; even
+    // rows use relative indices and odd rows absolute ones with texture coordinates, so
+    // the chunk boundaries fall among both kinds and relative indices reach back into the
+    // previous chunk.
+    const uint32_t c_gridWidth = 400;
+    const uint32_t c_gridHeight = 250;
+
+    float GridHeight(uint32_t row, uint32_t column)
+    {
+        return static_cast<float>((row * 7 + column * 3) % 11) * 0.25f;
+    }
+
+    bool IsColoredRow(uint32_t row)
+    {
+        return row % 3 == 0;
+    }
+
+    float GridRed(uint32_t column)
+    {
+        return static_cast<float>(column % 5) * 0.25f;
+    }
+
+    // Every vertex has its own normal, (0.6, 0.8, 0) or (0, 0.8, 0.6) in the file.
+    bool HasSideNormal(uint32_t row, uint32_t column)
+    {
+        return (row + column) % 2 == 0;
+    }
+
+    std::string GridObj(bool withNormals)
+    {
+        std::string obj = "# Height field\nvt 0 0\n";
+        obj.reserve(static_cast<size_t>(c_gridWidth) * c_gridHeight * (withNormals ? 80 : 50));
+
+        char line[192];
+        for (uint32_t r = 0; r < c_gridHeight; ++r)
+        {
+            for (uint32_t j = 0; j < c_gridWidth; ++j)
+            {
+                if (IsColoredRow(r))
+                {
+                    snprintf(line, sizeof(line), "v %u %g %u %g 0.5 1\n", j, GridHeight(r, j), r, GridRed(j));
+                }
+                else
+                {
+                    snprintf(line, sizeof(line), "v %u %g %u\n", j, GridHeight(r, j), r);
+                }
+                obj += line;
+
+                if (withNormals)
+                {
+                    obj += HasSideNormal(r, j) ? "vn 0.6 0.8 0\n" : "vn 0 0.8 0.6\n";
+                }
+            }
+
+            if (r == 0)
+            {
+                continue;
+            }
+
+            obj += "g row\n";
+            const int64_t count = static_cast<int64_t>(r + 1) * c_gridWidth;
+            for (uint32_t j = 0; j + 1 < c_gridWidth; ++j)
+            {
+                const int64_t q[4] =
+                {
+                    static_cast<int64_t>(r - 1) * c_gridWidth + j, static_cast<int64_t>(r - 1) * c_gridWidth + j + 1,
+                    static_cast<int64_t>(r) * c_gridWidth + j + 1, static_cast<int64_t>(r) * c_gridWidth + j
+                };
+
+                std::string face = "f";
+                for (int64_t index : q)
+                {
+                    const long long value = r % 2 == 0 ? index - count : index + 1;
+                    if (withNormals)
+                    {
+                        snprintf(line, sizeof(line), r % 2 == 0 ? " %lld//%lld" : " %lld/1/%lld", value, value);
+                    }
+                    else
+                    {
+                        snprintf(line, sizeof(line), r % 2 == 0 ? " %lld" : " %lld/1", value);
+                    }
+                    face += line;
+                }
+                obj += face;
+                obj += '\n';
+            }
+        }
+        return obj;
+    }
+
+    // Checks every vertex against the grid point it comes from, and every triangle against
+    // the quad of the file it was cut from.
+    void CheckGrid(const MeshData& mesh, bool withNormals)
+    {
+        const size_t quadCount = static_cast<size_t>(c_gridWidth - 1) * (c_gridHeight - 1);
+        CHECK(mesh.vertices.size() == static_cast<size_t>(c_gridWidth) * c_gridHeight);
+        CHECK(mesh.indices.size() == quadCount * 6);
+
+        std::vector<uint32_t> gridIndex(mesh.vertices.size());
+        std::vector<bool> found(mesh.vertices.size(), false);
+        float upSign = 0.0f;
+        for (size_t i = 0; i < mesh.vertices.size(); ++i)
+        {
+            const MeshVertex& v = mesh.vertices[i];
+            const uint32_t j = static_cast<uint32_t>(v.position[0]);
+            const uint32_t r = static_cast<uint32_t>(-v.position[2]);
+            CHECK(j < c_gridWidth && r < c_gridHeight);
+            CHECK(v.position[0] == static_cast<float>(j) && v.position[2] == -static_cast<float>(r));
+            CHECK(v.position[1] == GridHeight(r, j));
+
+            gridIndex[i] = r * c_gridWidth + j;
+            CHECK(!found[gridIndex[i]]);
+            found[gridIndex[i]] = true;
+
+            if (IsColoredRow(r))
+            {
+                CHECK(v.color[0] == GridRed(j) && v.color[1] == 0.5f && v.color[2] == 1.0f && v.color[3] == 1.0f);
+            }
+            else
+            {
+                CHECK(v.color[0] == 1.0f && v.color[1] == 1.0f && v.color[2] == 1.0f && v.color[3] == 1.0f);
+            }
+
+            if (withNormals)
+            {
+                CHECK(HasSideNormal(r, j) ? IsNear(v.normal, 0.6f, 0.8f, 0.0f) : IsNear(v.normal, 0.0f, 0.8f, -0.6f));
+            }
+            else
+            {
+                // Generated normals are unit length and all face the same side of the field.
+                CHECK(std::fabs(Dot(v.normal, v.normal) - 1.0f) < 1e-4f);
+                CHECK(v.normal[1] != 0.0f);
+                if (upSign == 0.0f)
+                {
+                    upSign = v.normal[1] > 0.0f ? 1.0f : -1.0f;
+                }
+                CHECK(v.normal[1] * upSign > 0.0f);
+            }
+        }
+
+        // Faces are fans (a, c, b), (a, d, c) of the quads a b c d, in the order of the file.
+        size_t t = 0;
+        for (uint32_t r = 1; r < c_gridHeight; ++r)
+        {
+            for (uint32_t j = 0; j + 1 < c_gridWidth; ++j, t += 6)
+            {
+                const uint32_t a = (r - 1) * c_gridWidth + j;
+                const uint32_t b = a + 1;
+                const uint32_t c = r * c_gridWidth + j + 1;
+                const uint32_t d = c - 1;
+                const uint32_t expected[6] = { a, c, b, a, d, c };
+                for (int k = 0; k < 6; ++k)
+                {
+                    CHECK(gridIndex[mesh.indices[t + k]] == expected[k]);
+                }
+            }
+        }
+    }
+
+    void TestObjCube()
+    {
+        MeshImporter importer(2);
+
+        // Normals generated by the importer, then the normals of the file, which split
+        // each corner into one vertex per face.
+        for (bool withNormals : { false, true })
+        {
+            const std::string obj = CubeObj(withNormals);
+            MeshData mesh;
+            importer.LoadObj(obj.data(), obj.size(), mesh);
+            CheckOutwardCube(mesh);
+            CHECK(mesh.vertices.size() == (withNormals ? 24u : 8u));
+            CHECK(importer.GetStats().sourceVertices == 36);
+            CHECK(importer.GetStats().threadCount == 1);
+        }
+
+        // The mirror is along z: the +z face of the file is the -z face of the samples.
+        const std::string obj = CubeObj(true);
+        MeshData mesh;
+        importer.LoadObj(obj.data(), obj.size(), mesh);
+        CHECK(mesh.vertices[mesh.indices[0]].normal[2] < 0.0f);
+        CHECK(mesh.vertices[mesh.indices[0]].position[2] < 0.0f);
+    }
+
+    // The chunks parsed by separate threads must produce the same mesh as a single thread.
+    void TestObjChunks(bool withNormals)
+    {
+        const std::string obj = GridObj(withNormals);
+        CHECK(obj.size() > 4 * (1 << 20));
+
+        MeshData reference;
+        MeshImporter(1).LoadObj(obj.data(), obj.size(), reference);
+        CheckGrid(reference, withNormals);
+
+        for (unsigned int threads : { 2u, 3u, 4u, 8u })
+        {
+            MeshImporter importer(threads);
+            MeshData mesh;
+            importer.LoadObj(obj.data(), obj.size(), mesh);
+
+            const MeshImportStats& stats = importer.GetStats();
+            CHECK(stats.threadCount == (std::min)(static_cast<size_t>(threads), obj.size() >> 20));
+            CHECK(stats.threadCount > 1);
+            CHECK(stats.bytesParsed == obj.size());
+            CHECK(stats.sourceVertices == mesh.indices.size());
+            CHECK(IsSameMesh(mesh, reference));
+        }
+    }
+
+    void TestGltfNodes()
+    {
+        // glTF placed as is, and mirrored by its node, which flips the winding once more.
+        {
+            MeshData mesh;
+            LoadGltfCube("{\"mesh\":0}", mesh);
+            CheckOutwardCube(mesh);
+        }
+        {
+            MeshData mesh;
+            LoadGltfCube("{\"mesh\":0,\"scale\":[-1,1,1]}", mesh);
+            CheckOutwardCube(mesh);
+        }
+
+        // Column-major matrix translating by (1, 2, 3), then mirrored along z.
+        MeshData mesh;
+        LoadGltfCube("{\"mesh\":0,\"matrix\":[1,0,0,0,0,1,0,0,0,0,1,0,1,2,3,1]}", mesh);
+        const float center[3] = { 1.0f, 2.0f, -3.0f };
+        CheckOutwardCube(mesh, 0, center);
+        CHECK(IsNear(mesh.boundsMin, 0.0f, 1.0f, -4.0f));
+        CHECK(IsNear(mesh.boundsMax, 2.0f, 3.0f, -2.0f));
+    }
+
+    // Tests/Data holds the same scene as a .glb with a BIN chunk and as a .gltf with a
+    // base64 buffer: a colored cube with normals, instanced by
+    //   node 0: translation (10, 0, 0), with child node 1: scale 2
+    //   node 2: rotation of 90 degrees about y and translation (0, 5, 0), with child
+    //   node 3: matrix mirroring x.
+    void TestGltfFiles()
+    {
+        MeshImporter importer(2);
+
+        MeshData binary;
+        importer.LoadFromFile("Tests/Data/cube.glb", binary);
+        CHECK(importer.GetStats().sourceVertices == 3 * 24);
+
+        MeshData embedded;
+        importer.LoadFromFile("Tests/Data/cube.gltf", embedded);
+        CHECK(IsSameMesh(binary, embedded));
+
+        CHECK(binary.vertices.size() == 3 * 24);
+        CHECK(binary.indices.size() == 3 * 36);
+
+        // The instances follow the order of the nodes, children after their parent.
+        const float centers[3][3] = { { 10.0f, 0.0f, 0.0f }, { 0.0f, 5.0f, 0.0f }, { 0.0f, 5.0f, 0.0f } };
+        for (size_t i = 0; i < 3; ++i)
+        {
+            CheckOutwardCube(binary, i * 36, centers[i]);
+        }
+        CHECK(IsNear(binary.boundsMin, -1.0f, -2.0f, -2.0f));
+        CHECK(IsNear(binary.boundsMax, 12.0f, 6.0f, 2.0f));
+
+        // The first vertex of the file is (-1, -1, 1) on the +z face.
+        CHECK(IsNear(binary.vertices[0].position, 8.0f, -2.0f, -2.0f));
+        CHECK(IsNear(binary.vertices[0].normal, 0.0f, 0.0f, -1.0f));
+        CHECK(IsNear(binary.vertices[24].position, 1.0f, 4.0f, -1.0f));
+        CHECK(IsNear(binary.vertices[24].normal, 1.0f, 0.0f, 0.0f));
+        CHECK(IsNear(binary.vertices[48].position, 1.0f, 4.0f, 1.0f));
+        CHECK(IsNear(binary.vertices[48].normal, 1.0f, 0.0f, 0.0f));
+
+        for (size_t i = 0; i < binary.vertices.size(); ++i)
+        {
+            const uint8_t* expected = c_cubeColors[(i % 24) / 4];
+            for (int c = 0; c < 4; ++c)
+            {
+                CHECK(binary.vertices[i].color[c] == expected[c] / 255.0f);
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestObjCube();
+    TestObjChunks(true);
+    TestObjChunks(false);
+    TestGltfNodes();
+    TestGltfFiles();
+    return 0;
+}
@@ -0,0 +1,340 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Uploader.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    struct TestBuffer
+    {
+        std::vector<uint8_t> bytes;
+    };
+
+    struct TestTexture
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> texels;    // 4 bytes per texel.
+    };
+
+    // Copy queue whose batches execute later, in order, when the test lets the GPU run or
+    // when the CPU waits. The copies read the staging memory when they execute, so staging
+    // memory reused too early shows up in the destinations.
+    class TestCopyQueue : public CopyQueue
+    {
+    public:
+        explicit TestCopyQueue(uint64_t stagingSize) :
+            completedFenceValue(0),
+            submittedFenceValue(0),
+            waitCount(0),
+            m_staging(static_cast<size_t>(stagingSize), 0xEE)
+        {
+        }
+
+        uint8_t* GetStagingData() override          { return m_staging.data(); }
+        uint64_t GetStagingSize() const override    { return m_staging.size(); }
+
+        void CopyBuffer(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) override
+        {
+            CHECK(stagingOffset + size <= m_staging.size());
+            m_recording.push_back({ false, pDestination, destinationOffset, stagingOffset, size, StagingFootprint() });
+        }
+
+        void CopyTexture(void* pDestination, uint32_t subresource, uint64_t stagingOffset, const StagingFootprint& footprint) override
+        {
+            CHECK(subresource == 0);
+            CHECK(stagingOffset % Uploader::TexturePlacementAlignment == 0);
+            CHECK(footprint.rowPitch % Uploader::TextureRowPitchAlignment == 0);
+            m_recording.push_back({ true, pDestination, 0, stagingOffset, 0, footprint });
+        }
+
+        void Submit(uint64_t fenceValue) override
+        {
+            CHECK(!m_recording.empty() && fenceValue > submittedFenceValue);
+            m_batches.push_back({ fenceValue, m_recording });
+            m_recording.clear();
+            submittedFenceValue = fenceValue;
+        }
+
+        uint64_t GetCompletedFenceValue() override  { return completedFenceValue; }
+
+        void WaitForFence(uint64_t fenceValue) override
+        {
+            // Waiting for a batch that isn't submitted would never return.
+            CHECK(fenceValue <= submittedFenceValue);
+            ++waitCount;
+            RunUntil(fenceValue);
+        }
+
+        // Executes the oldest batch.
+        void RunOne()
+        {
+            if (m_batches.empty())
+            {
+                return;
+            }
+            for (const Copy& copy : m_batches.front().copies)
+            {
+                Execute(copy);
+            }
+            completedFenceValue = m_batches.front().fenceValue;
+            m_batches.pop_front();
+        }
+
+        void RunUntil(uint64_t fenceValue)
+        {
+            while (completedFenceValue < fenceValue && !m_batches.empty())
+            {
+                RunOne();
+            }
+        }
+
+        uint64_t completedFenceValue;
+        uint64_t submittedFenceValue;
+        uint32_t waitCount;
+
+    private:
+        struct Copy
+        {
+            bool isTexture;
+            void* pDestination;
+            uint64_t destinationOffset;
+            uint64_t stagingOffset;
+            uint64_t size;
+            StagingFootprint footprint;
+        };
+
+        struct Batch
+        {
+            uint64_t fenceValue;
+            std::vector<Copy> copies;
+        };
+
+        void Execute(const Copy& copy)
+        {
+            if (copy.isTexture)
+            {
+                TestTexture* pTexture = static_cast<TestTexture*>(copy.pDestination);
+                const size_t rowSize = pTexture->width * 4;
+                for (uint32_t y = 0; y < copy.footprint.height; ++y)
+                {
+                    std::memcpy(pTexture->texels.data() + y * rowSize, m_staging.data() + copy.stagingOffset + y * copy.footprint.rowPitch, rowSize);
+                }
+            }
+            else
+            {
+                TestBuffer* pBuffer = static_cast<TestBuffer*>(copy.pDestination);
+                CHECK(copy.destinationOffset + copy.size <= pBuffer->bytes.size());
+                std::memcpy(pBuffer->bytes.data() + copy.destinationOffset, m_staging.data() + copy.stagingOffset, static_cast<size_t>(copy.size));
+            }
+        }
+
+        std::vector<uint8_t> m_staging;
+        std::vector<Copy> m_recording;
+        std::deque<Batch> m_batches;
+    };
+
+    std::vector<uint8_t> GetRandomBytes(std::mt19937& random, size_t size)
+    {
+        std::vector<uint8_t> bytes(size);
+        for (auto& byte : bytes)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+        return bytes;
+    }
+
+    void TestStagingRing()
+    {
+        StagingRing ring(1024);
+        uint64_t offset = 0;
+        CHECK(ring.Allocate(100, 16, 1, &offset) && offset == 0);
+        CHECK(ring.Allocate(100, 16, 1, &offset) && offset == 112);
+        CHECK(ring.GetUsedBytes() == 212);
+        CHECK(ring.Allocate(700, 256, 2, &offset) && offset == 256);
+        CHECK(ring.GetUsedBytes() == 956);
+
+        // 68 bytes are left at the end, and the beginning is in use.
+        CHECK(!ring.Allocate(100, 16, 3, &offset));
+        ring.Retire(1);
+        CHECK(ring.GetUsedBytes() == 744);
+
+        // Wrapping around skips the 68 bytes at the end, until the allocation retires.
+        CHECK(ring.Allocate(200, 16, 3, &offset) && offset == 0);
+        CHECK(ring.GetUsedBytes() == 744 + 68 + 200);
+        CHECK(!ring.Allocate(13, 1, 3, &offset));
+        CHECK(ring.Allocate(12, 1, 3, &offset) && offset == 200);
+        CHECK(ring.GetUsedBytes() == 1024);
+        CHECK(!ring.Allocate(1, 1, 4, &offset));
+
+        ring.Retire(2);
+        CHECK(ring.GetOldestFenceValue() == 3 && ring.GetUsedBytes() == 68 + 212);
+        ring.Retire(3);
+        CHECK(ring.IsEmpty() && ring.GetUsedBytes() == 0);
+
+        // An empty ring starts over at its beginning.
+        CHECK(ring.Allocate(1024, 512, 5, &offset) && offset == 0);
+        CHECK_THROWS(ring.Allocate(1, 1, 4, &offset));
+        CHECK_THROWS(ring.Allocate(1, 3, 6, &offset));
+        CHECK(!ring.Allocate(2048, 1, 6, &offset));
+    }
+
+    // Buffers through a small ring, some larger than the ring, with the GPU behind: every
+    // byte lands, and the uploads wait for staging memory to retire.
+    void TestBuffers()
+    {
+        std::mt19937 random(42);
+        TestCopyQueue queue(64 * 1024);
+        Uploader uploader;
+        uploader.Initialize(&queue);
+
+        std::vector<TestBuffer> buffers(200);
+        std::vector<std::vector<uint8_t>> expected(buffers.size());
+        std::vector<UploadFuture> futures;
+        for (size_t i = 0; i < buffers.size(); ++i)
+        {
+            const size_t size = 1 + random() % (i % 10 == 0 ? 100000 : 6000);
+            expected[i] = GetRandomBytes(random, size);
+            buffers[i].bytes.assign(size, 0);
+            futures.push_back(uploader.UploadBuffer(&buffers[i], 0, expected[i].data(), size));
+            CHECK(futures.size() == 1 || futures.back().GetFenceValue() >= futures[futures.size() - 2].GetFenceValue());
+            if (random() % 4 == 0)
+            {
+                queue.RunOne();
+            }
+        }
+
+        CHECK(!futures.back().IsReady());
+        uploader.Flush();
+        CHECK(!futures.back().IsReady());
+        queue.RunUntil(futures[50].GetFenceValue());
+        CHECK(futures[50].IsReady());
+        futures.back().Wait();
+        for (size_t i = 0; i < buffers.size(); ++i)
+        {
+            CHECK(futures[i].IsReady());
+            CHECK(buffers[i].bytes == expected[i]);
+        }
+
+        uploader.Retire();
+        CHECK(uploader.GetStagingUsedBytes() == 0);
+        const UploaderStats& stats = uploader.GetStats();
+        CHECK(stats.stallCount > 0 && stats.batchCount == queue.submittedFenceValue);
+        CHECK(stats.copyCount > buffers.size());
+    }
+
+    // Waiting for an open batch submits it, and an empty upload is ready at once.
+    void TestWait()
+    {
+        TestCopyQueue queue(4096);
+        Uploader uploader;
+        uploader.Initialize(&queue);
+
+        TestBuffer buffer;
+        buffer.bytes.assign(64, 0);
+        const std::vector<uint8_t> data(64, 9);
+        const UploadFuture future = uploader.UploadBuffer(&buffer, 0, data.data(), 64);
+        CHECK(!future.IsReady() && queue.submittedFenceValue == 0);
+        future.Wait();
+        CHECK(future.IsReady() && buffer.bytes == data && queue.submittedFenceValue == 1);
+
+        CHECK(uploader.UploadBuffer(&buffer, 0, data.data(), 0).IsReady());
+        CHECK(UploadFuture().IsReady());
+        uploader.Flush();
+        CHECK(queue.submittedFenceValue == 1);
+
+        const std::vector<uint8_t> part(16, 3);
+        uploader.UploadBuffer(&buffer, 8, part.data(), 16).Wait();
+        CHECK(buffer.bytes[7] == 9 && buffer.bytes[8] == 3 && buffer.bytes[23] == 3 && buffer.bytes[24] == 9);
+    }
+
+    // Texture rows are copied at the row pitch of the copy queue, from any source pitch.
+    void TestTextures()
+    {
+        std::mt19937 random(7);
+        TestCopyQueue queue(256 * 1024);
+        Uploader uploader;
+        uploader.Initialize(&queue);
+
+        const uint32_t c_sizes[][2] = { { 1, 1 }, { 3, 5 }, { 64, 64 }, { 100, 37 }, { 200, 120 }, { 7, 300 } };
+        std::deque<TestTexture> textures;
+        std::vector<std::vector<uint8_t>> expected;
+        UploadFuture last;
+        for (int round = 0; round < 10; ++round)
+        {
+            for (const auto& size : c_sizes)
+            {
+                const uint32_t rowSize = size[0] * 4;
+                const uint32_t sourceRowPitch = rowSize + 12;
+                textures.push_back({ size[0], size[1], std::vector<uint8_t>(rowSize * size[1], 0) });
+
+                const std::vector<uint8_t> source = GetRandomBytes(random, sourceRowPitch * size[1]);
+                std::vector<uint8_t> rows;
+                for (uint32_t y = 0; y < size[1]; ++y)
+                {
+                    rows.insert(rows.end(), source.begin() + y * sourceRowPitch, source.begin() + y * sourceRowPitch + rowSize);
+                }
+                expected.push_back(rows);
+
+                last = uploader.UploadTexture(&textures.back(), 0, 28, size[0], size[1], source.data(), rowSize, size[1], sourceRowPitch);
+                if (random() % 3 == 0)
+                {
+                    queue.RunOne();
+                }
+            }
+        }
+        last.Wait();
+        for (size_t i = 0; i < textures.size(); ++i)
+        {
+            CHECK(textures[i].texels == expected[i]);
+        }
+
+        const std::vector<uint8_t> large(1024 * 1024);
+        CHECK_THROWS(uploader.UploadTexture(&textures[0], 0, 28, 1024, 256, large.data(), 4096, 256, 4096));
+        CHECK_THROWS(uploader.UploadTexture(&textures[0], 0, 28, 1, 1, large.data(), 4, 1, 2));
+    }
+
+    // The fence values carry on from a copy queue that was used before.
+    void TestUsedCopyQueue()
+    {
+        TestCopyQueue queue(4096);
+        queue.completedFenceValue = 41;
+        queue.submittedFenceValue = 41;
+        Uploader uploader;
+        uploader.Initialize(&queue);
+        CHECK(uploader.GetOpenFenceValue() == 42);
+
+        TestBuffer buffer;
+        buffer.bytes.assign(4, 0);
+        const uint32_t value = 0x01020304;
+        const UploadFuture future = uploader.UploadBuffer(&buffer, 0, &value, 4);
+        CHECK(future.GetFenceValue() == 42 && !future.IsReady());
+        future.Wait();
+        CHECK(future.IsReady());
+    }
+}
+
+int main()
+{
+    TestStagingRing();
+    TestBuffers();
+    TestWait();
+    TestTextures();
+    TestUsedCopyQueue();
+    return 0;
+}
@@ -0,0 +1,267 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Uploader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // Alignment of the buffer data in the staging ring.
+    const uint64_t c_bufferPlacementAlignment = 16;
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+StagingRing::StagingRing(uint64_t capacity) :
+    m_capacity(capacity),
+    m_tail(0),
+    m_usedBytes(0)
+{
+}
+
+bool StagingRing::Allocate(uint64_t size, uint64_t alignment, uint64_t fenceValue, uint64_t* pOffset)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::runtime_error("StagingRing: the alignment must be a power of two");
+    }
+    if (!m_spans.empty() && fenceValue < m_spans.back().fenceValue)
+    {
+        throw std::runtime_error("StagingRing: the fence values must not decrease");
+    }
+    if (size > m_capacity)
+    {
+        return false;
+    }
+
+    // Allocations that don't fit before the end of the ring start over at its beginning,
+    // and the space they skip stays in use until they retire.
+    uint64_t offset = AlignUp(m_tail, alignment);
+    if (offset + size > m_capacity)
+    {
+        offset = 0;
+    }
+    const uint64_t end = offset + size;
+    const uint64_t consumed = (offset >= m_tail ? end - m_tail : m_capacity - m_tail + end);
+    if (m_usedBytes + consumed > m_capacity)
+    {
+        return false;
+    }
+
+    if (!m_spans.empty() && m_spans.back().fenceValue == fenceValue)
+    {
+        m_spans.back().size += consumed;
+    }
+    else
+    {
+        m_spans.push_back(Span{ fenceValue, consumed });
+    }
+    m_usedBytes += consumed;
+    m_tail = end;
+    *pOffset = offset;
+    return true;
+}
+
+void StagingRing::Retire(uint64_t completedFenceValue)
+{
+    while (!m_spans.empty() && m_spans.front().fenceValue <= completedFenceValue)
+    {
+        m_usedBytes -= m_spans.front().size;
+        m_spans.pop_front();
+    }
+
+    // Once empty, start over so that the next allocations don't need to wrap around.
+    if (m_spans.empty())
+    {
+        m_tail = 0;
+    }
+}
+
+bool UploadFuture::IsReady() const
+{
+    return m_pUploader == nullptr || m_pUploader->IsComplete(m_fenceValue);
+}
+
+void UploadFuture::Wait() const
+{
+    if (m_pUploader != nullptr)
+    {
+        m_pUploader->Wait(m_fenceValue);
+    }
+}
+
+Uploader::Uploader() :
+    m_pCopyQueue(nullptr),
+    m_pStagingData(nullptr),
+    m_ring(0),
+    m_maxBatchSize(0),
+    m_openFenceValue(1),
+    m_openBatchSize(0),
+    m_openCopyCount(0),
+    m_completedFenceValue(0),
+    m_stats{}
+{
+}
+
+void Uploader::Initialize(CopyQueue* pCopyQueue, uint64_t maxBatchSize)
+{
+    m_pCopyQueue = pCopyQueue;
+    m_pStagingData = pCopyQueue->GetStagingData();
+    m_ring = StagingRing(pCopyQueue->GetStagingSize());
+
+    const uint64_t stagingSize = pCopyQueue->GetStagingSize();
+    m_maxBatchSize = (std::min)(maxBatchSize != 0 ? maxBatchSize : stagingSize / 4, stagingSize);
+    if (m_maxBatchSize == 0)
+    {
+        throw std::runtime_error("Uploader: the staging buffer is empty");
+    }
+
+    // The copy queue may have been used before: the next batch comes after its fence.
+    m_completedFenceValue = pCopyQueue->GetCompletedFenceValue();
+    m_openFenceValue = m_completedFenceValue + 1;
+}
+
+UploadFuture Uploader::UploadBuffer(void* pDestination, uint64_t destinationOffset, const void* pData, uint64_t size)
+{
+    const uint8_t* pSource = static_cast<const uint8_t*>(pData);
+    uint64_t fenceValue = 0;
+    for (uint64_t copied = 0; copied < size;)
+    {
+        const uint64_t chunkSize = (std::min)(size - copied, m_maxBatchSize);
+        const uint64_t stagingOffset = AllocateStaging(chunkSize, c_bufferPlacementAlignment);
+        memcpy(m_pStagingData + stagingOffset, pSource + copied, static_cast<size_t>(chunkSize));
+        m_pCopyQueue->CopyBuffer(pDestination, destinationOffset + copied, stagingOffset, chunkSize);
+
+        copied += chunkSize;
+        m_stats.bytesUploaded += chunkSize;
+        fenceValue = m_openFenceValue;
+        EndUpload();
+    }
+    return fenceValue != 0 ? UploadFuture(this, fenceValue) : UploadFuture();
+}
+
+UploadFuture Uploader::UploadTexture(void* pDestination, uint32_t subresource, uint32_t format, uint32_t width, uint32_t height,
+    const void* pData, uint32_t rowSize, uint32_t rowCount, uint64_t sourceRowPitch)
+{
+    if (rowSize == 0 || rowCount == 0 || sourceRowPitch < rowSize)
+    {
+        throw std::runtime_error("Uploader: invalid texture layout");
+    }
+
+    StagingFootprint footprint;
+    footprint.format = format;
+    footprint.width = width;
+    footprint.height = height;
+    footprint.rowPitch = static_cast<uint32_t>(AlignUp(rowSize, TextureRowPitchAlignment));
+
+    // The subresource is copied in one piece, so it must fit in the ring.
+    const uint64_t stagingSize = static_cast<uint64_t>(footprint.rowPitch) * (rowCount - 1) + rowSize;
+    if (stagingSize > m_ring.GetCapacity())
+    {
+        throw std::runtime_error("Uploader: the texture subresource doesn't fit in the staging buffer");
+    }
+
+    const uint64_t stagingOffset = AllocateStaging(stagingSize, TexturePlacementAlignment);
+    const uint8_t* pSource = static_cast<const uint8_t*>(pData);
+    for (uint32_t row = 0; row < rowCount; ++row)
+    {
+        memcpy(m_pStagingData + stagingOffset + static_cast<uint64_t>(row) * footprint.rowPitch, pSource + row * sourceRowPitch, rowSize);
+    }
+    m_pCopyQueue->CopyTexture(pDestination, subresource, stagingOffset, footprint);
+
+    m_stats.bytesUploaded += static_cast<uint64_t>(rowSize) * rowCount;
+    const uint64_t fenceValue = m_openFenceValue;
+    EndUpload();
+    return UploadFuture(this, fenceValue);
+}
+
+void Uploader::Flush()
+{
+    if (m_openCopyCount == 0)
+    {
+        return;
+    }
+
+    m_pCopyQueue->Submit(m_openFenceValue);
+    ++m_openFenceValue;
+    m_openBatchSize = 0;
+    m_openCopyCount = 0;
+    ++m_stats.batchCount;
+}
+
+void Uploader::Retire()
+{
+    m_completedFenceValue = m_pCopyQueue->GetCompletedFenceValue();
+    m_ring.Retire(m_completedFenceValue);
+}
+
+bool Uploader::IsComplete(uint64_t fenceValue)
+{
+    if (fenceValue >= m_openFenceValue)
+    {
+        return false;
+    }
+    if (fenceValue > m_completedFenceValue)
+    {
+        Retire();
+    }
+    return fenceValue <= m_completedFenceValue;
+}
+
+void Uploader::Wait(uint64_t fenceValue)
+{
+    if (fenceValue >= m_openFenceValue)
+    {
+        Flush();
+    }
+    if (!IsComplete(fenceValue))
+    {
+        m_pCopyQueue->WaitForFence(fenceValue);
+        Retire();
+    }
+}
+
+uint64_t Uploader::AllocateStaging(uint64_t size, uint64_t alignment)
+{
+    uint64_t offset = 0;
+    while (!m_ring.Allocate(size, alignment, m_openFenceValue, &offset))
+    {
+        // The ring is full: submit the open batch, so that it can retire too, and wait
+        // for the oldest one.
+        Flush();
+        if (m_ring.IsEmpty())
+        {
+            throw std::runtime_error("Uploader: the upload doesn't fit in the staging buffer");
+        }
+        ++m_stats.stallCount;
+        m_pCopyQueue->WaitForFence(m_ring.GetOldestFenceValue());
+        Retire();
+    }
+
+    m_openBatchSize += size;
+    ++m_openCopyCount;
+    ++m_stats.copyCount;
+    return offset;
+}
+
+void Uploader::EndUpload()
+{
+    if (m_openBatchSize >= m_maxBatchSize)
+    {
+        Flush();
+    }
+}
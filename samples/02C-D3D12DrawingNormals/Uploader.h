@@ -0,0 +1,176 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Layout of a texture subresource in the staging buffer, as the copy queue reads it.
+struct StagingFootprint
+{
+    uint32_t format;            // DXGI_FORMAT of the texture.
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowPitch;          // A multiple of Uploader::TextureRowPitchAlignment.
+};
+
+// What the Uploader needs from a copy queue: a mapped staging buffer, copies from it
+// into the destination resources, and a fence.
+// The copies recorded between two Submit() calls form a batch; Submit() executes them
+// and signals the fence with the value given, once they are done. The values grow
+// with each batch, so a fence value tells which batches are complete.
+class CopyQueue
+{
+public:
+    virtual ~CopyQueue() {}
+
+    virtual uint8_t* GetStagingData() = 0;
+    virtual uint64_t GetStagingSize() const = 0;
+
+    // The destinations are the caller's resources.
+    virtual void CopyBuffer(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) = 0;
+    virtual void CopyTexture(void* pDestination, uint32_t subresource, uint64_t stagingOffset, const StagingFootprint& footprint) = 0;
+
+    virtual void Submit(uint64_t fenceValue) = 0;
+    virtual uint64_t GetCompletedFenceValue() = 0;
+    virtual void WaitForFence(uint64_t fenceValue) = 0;
+};
+
+// Ring of staging memory: each allocation is tagged with the fence value of the batch
+// that copies from it, and is freed, in order, once that value is reached.
+class StagingRing
+{
+public:
+    explicit StagingRing(uint64_t capacity);
+
+    // Returns false, without allocating, when the ring is too full until older batches
+    // retire. The alignment must be a power of two.
+    bool Allocate(uint64_t size, uint64_t alignment, uint64_t fenceValue, uint64_t* pOffset);
+
+    // Frees the allocations of the batches up to completedFenceValue.
+    void Retire(uint64_t completedFenceValue);
+
+    uint64_t GetCapacity() const            { return m_capacity; }
+    uint64_t GetUsedBytes() const           { return m_usedBytes; }
+    bool IsEmpty() const                    { return m_spans.empty(); }
+
+    // Fence value of the oldest allocation still in use; only valid when not empty.
+    uint64_t GetOldestFenceValue() const    { return m_spans.front().fenceValue; }
+
+private:
+    // The allocations of a batch, with the space skipped to align them or to wrap around.
+    struct Span
+    {
+        uint64_t fenceValue;
+        uint64_t size;
+    };
+
+    uint64_t m_capacity;
+    uint64_t m_tail;            // Where the next allocation goes.
+    uint64_t m_usedBytes;
+    std::deque<Span> m_spans;
+};
+
+class Uploader;
+
+// Completion of an upload. A default-constructed future is always ready.
+class UploadFuture
+{
+public:
+    UploadFuture() : m_pUploader(nullptr), m_fenceValue(0) {}
+    UploadFuture(Uploader* pUploader, uint64_t fenceValue) : m_pUploader(pUploader), m_fenceValue(fenceValue) {}
+
+    // Never blocks.
+    bool IsReady() const;
+
+    // Submits the batch of the upload if it's still open, and blocks until it's done.
+    void Wait() const;
+
+    // The fence value the copy queue signals when the upload is done.
+    uint64_t GetFenceValue() const  { return m_fenceValue; }
+
+private:
+    Uploader* m_pUploader;
+    uint64_t m_fenceValue;
+};
+
+struct UploaderStats
+{
+    uint64_t bytesUploaded;
+    uint32_t copyCount;
+    uint32_t batchCount;
+    uint32_t stallCount;        // Times an upload waited for staging memory to retire.
+};
+
+// Uploads data into GPU resources through the staging ring of a copy queue.
+// Each upload is copied into the ring right away and recorded into the open batch,
+// which is submitted by Flush(), or once it holds enough data that the copy queue
+// should start on it. The caller keeps the destination resources alive, and doesn't
+// use them until the future of their upload is ready: a queue can wait on its fence
+// value instead of the CPU.
+// Only the thread that uploads calls it.
+class Uploader
+{
+public:
+    // Layout rules of the texture data in the staging buffer, as D3D12 defines them.
+    static const uint32_t TextureRowPitchAlignment = 256;
+    static const uint32_t TexturePlacementAlignment = 512;
+
+    Uploader();
+
+    // maxBatchSize is the amount of staging memory after which a batch is submitted;
+    // 0 means a quarter of the staging buffer.
+    void Initialize(CopyQueue* pCopyQueue, uint64_t maxBatchSize = 0);
+
+    // Larger buffers than a batch are split into several copies.
+    UploadFuture UploadBuffer(void* pDestination, uint64_t destinationOffset, const void* pData, uint64_t size);
+
+    // Uploads a subresource of rowCount rows of rowSize bytes, which are rows of blocks
+    // for the block-compressed formats. The rows of pData are sourceRowPitch bytes apart.
+    UploadFuture UploadTexture(void* pDestination, uint32_t subresource, uint32_t format, uint32_t width, uint32_t height,
+        const void* pData, uint32_t rowSize, uint32_t rowCount, uint64_t sourceRowPitch);
+
+    // Submits the open batch, if it has any copies.
+    void Flush();
+
+    // Frees the staging memory of the batches that are done.
+    void Retire();
+
+    // True when the copy queue is done with the batch of fenceValue. Never blocks.
+    bool IsComplete(uint64_t fenceValue);
+
+    // Submits the batch of fenceValue if it's still open, and blocks until it's done.
+    void Wait(uint64_t fenceValue);
+
+    // Fence value of the open batch, which the next uploads go into.
+    uint64_t GetOpenFenceValue() const      { return m_openFenceValue; }
+    uint64_t GetStagingUsedBytes() const    { return m_ring.GetUsedBytes(); }
+    const UploaderStats& GetStats() const   { return m_stats; }
+
+private:
+    // Allocates staging memory in the open batch, submitting it and waiting for older
+    // batches when the ring is full.
+    uint64_t AllocateStaging(uint64_t size, uint64_t alignment);
+
+    // Submits the open batch once it's large enough.
+    void EndUpload();
+
+    CopyQueue* m_pCopyQueue;
+    uint8_t* m_pStagingData;
+    StagingRing m_ring;
+    uint64_t m_maxBatchSize;
+    uint64_t m_openFenceValue;
+    uint64_t m_openBatchSize;       // Staging bytes of the open batch.
+    uint32_t m_openCopyCount;
+    uint64_t m_completedFenceValue; // Last value read from the copy queue.
+    UploaderStats m_stats;
+};
@@ -0,0 +1,229 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "D3D12MemoryAllocator.h"
+#include "DXSampleHelper.h"
+
+#include <memory>
+#include <stdexcept>
+
+void D3D12MemoryAllocator::HeapSource::Initialize(ID3D12Device* pDevice, D3D12_HEAP_TYPE heapType)
+{
+    m_device = pDevice;
+    m_heapType = heapType;
+}
+
+void* D3D12MemoryAllocator::HeapSource::CreateBlock(uint64_t size)
+{
+    const CD3DX12_HEAP_DESC heapDesc(size, m_heapType, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
+    ID3D12Heap* pHeap = nullptr;
+    const HRESULT hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeap));
+    if (hr == E_OUTOFMEMORY)
+    {
+        return nullptr;
+    }
+    ThrowIfFailed(hr);
+    return pHeap;
+}
+
+void D3D12MemoryAllocator::HeapSource::DestroyBlock(void* pBlock)
+{
+    static_cast<ID3D12Heap*>(pBlock)->Release();
+}
+
+void D3D12MemoryAllocator::PoolSource::Initialize(D3D12MemoryAllocator* pAllocator, D3D12_HEAP_TYPE heapType)
+{
+    m_pAllocator = pAllocator;
+    m_heapType = heapType;
+}
+
+void* D3D12MemoryAllocator::PoolSource::CreateBlock(uint64_t size)
+{
+    const D3D12_RESOURCE_STATES state = (m_heapType == D3D12_HEAP_TYPE_UPLOAD ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COPY_DEST);
+    std::unique_ptr<GpuBuffer> pBuffer(new GpuBuffer());
+    try
+    {
+        *pBuffer = m_pAllocator->CreateBuffer(m_heapType, size, state);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+
+    // The pool buffers stay mapped: the upload ones are only written by the CPU, and the
+    // readback ones only read once the GPU is done writing.
+    const HRESULT hr = pBuffer->resource->Map(0, nullptr, reinterpret_cast<void**>(&pBuffer->pMappedData));
+    if (FAILED(hr))
+    {
+        m_pAllocator->Free(*pBuffer);
+        ThrowIfFailed(hr);
+    }
+    return pBuffer.release();
+}
+
+void D3D12MemoryAllocator::PoolSource::DestroyBlock(void* pBlock)
+{
+    std::unique_ptr<GpuBuffer> pBuffer(static_cast<GpuBuffer*>(pBlock));
+    pBuffer->resource->Unmap(0, nullptr);
+    m_pAllocator->Free(*pBuffer);
+}
+
+D3D12MemoryAllocator::D3D12MemoryAllocator()
+{
+}
+
+D3D12MemoryAllocator::~D3D12MemoryAllocator()
+{
+    // The pool buffers are placed in the heaps, so they go first.
+    for (UINT index = 0; index < HeapTypeCount; ++index)
+    {
+        m_poolAllocators[index].Reset();
+    }
+    for (UINT index = 0; index < HeapTypeCount; ++index)
+    {
+        m_heapAllocators[index].Reset();
+    }
+}
+
+void D3D12MemoryAllocator::Initialize(ID3D12Device* pDevice, UINT64 heapSize, UINT64 poolBufferSize)
+{
+    m_device = pDevice;
+
+    // The heaps are made of the 64KB pages that the buffers are placed on.
+    const UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapSize = (heapSize + alignment - 1) & ~(alignment - 1);
+    poolBufferSize = (poolBufferSize + alignment - 1) & ~(alignment - 1);
+
+    for (UINT index = 0; index < HeapTypeCount; ++index)
+    {
+        const D3D12_HEAP_TYPE heapType = static_cast<D3D12_HEAP_TYPE>(D3D12_HEAP_TYPE_DEFAULT + index);
+        m_heapSources[index].Initialize(pDevice, heapType);
+        m_heapAllocators[index].Initialize(&m_heapSources[index], heapSize);
+        if (heapType != D3D12_HEAP_TYPE_DEFAULT)
+        {
+            m_poolSources[index].Initialize(this, heapType);
+            m_poolAllocators[index].Initialize(&m_poolSources[index], poolBufferSize);
+        }
+    }
+}
+
+GpuBuffer D3D12MemoryAllocator::CreateBuffer(D3D12_HEAP_TYPE heapType, UINT64 size, D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_FLAGS flags)
+{
+    BlockAllocator& heapAllocator = m_heapAllocators[GetHeapTypeIndex(heapType)];
+    const D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
+    const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &bufferDesc);
+
+    GpuBuffer buffer = {};
+    buffer.allocation = heapAllocator.Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+    const HRESULT hr = m_device->CreatePlacedResource(
+        static_cast<ID3D12Heap*>(buffer.allocation.pBlock),
+        buffer.allocation.offset,
+        &bufferDesc,
+        initialState,
+        nullptr,
+        IID_PPV_ARGS(&buffer.resource));
+    if (FAILED(hr))
+    {
+        heapAllocator.Free(buffer.allocation);
+        ThrowIfFailed(hr);
+    }
+
+    buffer.size = size;
+    buffer.gpuAddress = buffer.resource->GetGPUVirtualAddress();
+    buffer.heapType = heapType;
+    return buffer;
+}
+
+GpuBuffer D3D12MemoryAllocator::CreatePooledBuffer(D3D12_HEAP_TYPE heapType, UINT64 size, UINT64 alignment)
+{
+    if (heapType != D3D12_HEAP_TYPE_UPLOAD && heapType != D3D12_HEAP_TYPE_READBACK)
+    {
+        throw std::runtime_error("D3D12MemoryAllocator: only the upload and readback heaps have pool buffers");
+    }
+
+    GpuBuffer buffer = {};
+    buffer.allocation = m_poolAllocators[GetHeapTypeIndex(heapType)].Allocate(size, alignment);
+
+    const GpuBuffer& poolBuffer = *static_cast<const GpuBuffer*>(buffer.allocation.pBlock);
+    buffer.resource = poolBuffer.resource;
+    buffer.offset = buffer.allocation.offset;
+    buffer.size = size;
+    buffer.gpuAddress = poolBuffer.gpuAddress + buffer.allocation.offset;
+    buffer.pMappedData = poolBuffer.pMappedData + buffer.allocation.offset;
+    buffer.heapType = heapType;
+    buffer.isPooled = true;
+    return buffer;
+}
+
+void D3D12MemoryAllocator::Free(GpuBuffer& buffer)
+{
+    if (buffer.resource == nullptr)
+    {
+        return;
+    }
+
+    const UINT index = GetHeapTypeIndex(buffer.heapType);
+    buffer.resource.Reset();
+    if (buffer.isPooled)
+    {
+        m_poolAllocators[index].Free(buffer.allocation);
+    }
+    else
+    {
+        m_heapAllocators[index].Free(buffer.allocation);
+    }
+    buffer = GpuBuffer{};
+}
+
+MemoryStats D3D12MemoryAllocator::GetHeapStats(D3D12_HEAP_TYPE heapType) const
+{
+    return m_heapAllocators[GetHeapTypeIndex(heapType)].GetStats();
+}
+
+MemoryStats D3D12MemoryAllocator::GetPoolStats(D3D12_HEAP_TYPE heapType) const
+{
+    return m_poolAllocators[GetHeapTypeIndex(heapType)].GetStats();
+}
+
+std::string D3D12MemoryAllocator::FormatStats() const
+{
+    static const char* const c_heapTypeNames[HeapTypeCount] = { "default", "upload", "readback" };
+
+    char line[256];
+    std::string text = "GPU memory (blocks, reserved / allocated KB, allocations, free ranges, fragmentation):\n";
+    for (UINT index = 0; index < HeapTypeCount; ++index)
+    {
+        const MemoryStats stats[] = { m_heapAllocators[index].GetStats(), m_poolAllocators[index].GetStats() };
+        for (UINT pool = 0; pool < _countof(stats); ++pool)
+        {
+            if (stats[pool].blockCount == 0)
+            {
+                continue;
+            }
+            snprintf(line, sizeof(line), "  %-8s %-6s %4u, %10llu / %10llu, %6u, %6u, %5.2f\n",
+                c_heapTypeNames[index], pool ? "pools" : "heaps", stats[pool].blockCount,
+                stats[pool].reservedBytes / 1024, stats[pool].allocatedBytes / 1024,
+                stats[pool].allocationCount, stats[pool].freeRangeCount, GetFragmentation(stats[pool]));
+            text += line;
+        }
+    }
+    return text;
+}
+
+UINT D3D12MemoryAllocator::GetHeapTypeIndex(D3D12_HEAP_TYPE heapType)
+{
+    if (heapType < D3D12_HEAP_TYPE_DEFAULT || heapType > D3D12_HEAP_TYPE_READBACK)
+    {
+        throw std::runtime_error("D3D12MemoryAllocator: only the default, upload and readback heaps are supported");
+    }
+    return heapType - D3D12_HEAP_TYPE_DEFAULT;
+}
@@ -0,0 +1,115 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// A buffer of the D3D12MemoryAllocator: a resource placed in one of its heaps, or a
+// range of one of its pool buffers, which the small buffers of the upload and readback
+// heaps share.
+struct GpuBuffer
+{
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource;    // The pool buffer, for a pooled buffer.
+    UINT64 offset;                                      // Of the data in the resource; 0 unless pooled.
+    UINT64 size;
+    D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;               // Of the data.
+    UINT8* pMappedData;                                 // Of the data, for a pooled buffer; nullptr otherwise.
+    D3D12_HEAP_TYPE heapType;
+    bool isPooled;
+    BlockAllocation allocation;
+};
+
+// Reserves large heaps per heap type and places the buffers in them, instead of giving
+// each buffer a committed resource and its own heap. The heaps only hold buffers, so
+// that they don't depend on the resource heap tier.
+// Pool buffers are large, persistently mapped buffers of the upload and readback heaps,
+// which the small buffers of these heaps are suballocated from: they need no resource
+// of their own, and no more than their alignment in memory.
+// The caller keeps the buffers alive until the GPU is done with them, and frees them
+// before the allocator is destroyed.
+class D3D12MemoryAllocator
+{
+public:
+    // Heaps and pool buffers that are created for the allocations larger than themselves
+    // are destroyed as soon as these are freed.
+    static const UINT64 DefaultHeapSize = 16 * 1024 * 1024;
+    static const UINT64 DefaultPoolBufferSize = 1024 * 1024;
+
+    D3D12MemoryAllocator();
+    ~D3D12MemoryAllocator();
+
+    D3D12MemoryAllocator(const D3D12MemoryAllocator&) = delete;
+    D3D12MemoryAllocator& operator=(const D3D12MemoryAllocator&) = delete;
+
+    void Initialize(ID3D12Device* pDevice, UINT64 heapSize = DefaultHeapSize, UINT64 poolBufferSize = DefaultPoolBufferSize);
+
+    // A buffer with a resource of its own, placed in a heap of the given type.
+    GpuBuffer CreateBuffer(D3D12_HEAP_TYPE heapType, UINT64 size, D3D12_RESOURCE_STATES initialState,
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+
+    // A range of a pool buffer of the upload heap, which is in the GENERIC_READ state, or
+    // of the readback heap, which is in the COPY_DEST state. The pooled buffers can't
+    // change state, as their resource is shared.
+    GpuBuffer CreatePooledBuffer(D3D12_HEAP_TYPE heapType, UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    void Free(GpuBuffer& buffer);
+
+    MemoryStats GetHeapStats(D3D12_HEAP_TYPE heapType) const;
+    MemoryStats GetPoolStats(D3D12_HEAP_TYPE heapType) const;
+
+    // The heap and pool stats of the heap types in use, for the debugger output.
+    std::string FormatStats() const;
+
+private:
+    static const UINT HeapTypeCount = 3;    // DEFAULT, UPLOAD and READBACK.
+
+    // Creates the heaps of a heap type.
+    class HeapSource : public MemoryBlockSource
+    {
+    public:
+        HeapSource() : m_heapType(D3D12_HEAP_TYPE_DEFAULT) {}
+
+        void Initialize(ID3D12Device* pDevice, D3D12_HEAP_TYPE heapType);
+
+        virtual void* CreateBlock(uint64_t size);
+        virtual void DestroyBlock(void* pBlock);
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+        D3D12_HEAP_TYPE m_heapType;
+    };
+
+    // Creates the pool buffers of a heap type, placed in its heaps. The blocks are the
+    // GpuBuffer of the pool buffers, mapped.
+    class PoolSource : public MemoryBlockSource
+    {
+    public:
+        PoolSource() : m_pAllocator(nullptr), m_heapType(D3D12_HEAP_TYPE_UPLOAD) {}
+
+        void Initialize(D3D12MemoryAllocator* pAllocator, D3D12_HEAP_TYPE heapType);
+
+        virtual void* CreateBlock(uint64_t size);
+        virtual void DestroyBlock(void* pBlock);
+
+    private:
+        D3D12MemoryAllocator* m_pAllocator;
+        D3D12_HEAP_TYPE m_heapType;
+    };
+
+    static UINT GetHeapTypeIndex(D3D12_HEAP_TYPE heapType);
+
+    Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+    HeapSource m_heapSources[HeapTypeCount];
+    BlockAllocator m_heapAllocators[HeapTypeCount];
+    PoolSource m_poolSources[HeapTypeCount];
+    BlockAllocator m_poolAllocators[HeapTypeCount];     // Only for UPLOAD and READBACK.
+};
@@ -0,0 +1,91 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "D3D12ResourceStateTracker.h"
+
+// The tracker works on the values of D3D12_RESOURCE_STATES.
+static_assert(ResourceStates::VertexAndConstantBuffer == D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, "");
+static_assert(ResourceStates::RenderTarget == D3D12_RESOURCE_STATE_RENDER_TARGET, "");
+static_assert(ResourceStates::StreamOut == D3D12_RESOURCE_STATE_STREAM_OUT, "");
+static_assert(ResourceStates::CopyDest == D3D12_RESOURCE_STATE_COPY_DEST, "");
+static_assert(ResourceStates::CopySource == D3D12_RESOURCE_STATE_COPY_SOURCE, "");
+static_assert(ResourceStates::ResolveSource == D3D12_RESOURCE_STATE_RESOLVE_SOURCE, "");
+static_assert((ResourceStates::ReadOnly & D3D12_RESOURCE_STATE_GENERIC_READ) == D3D12_RESOURCE_STATE_GENERIC_READ, "");
+static_assert(ResourceStateTracker::AllSubresources == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, "");
+
+void D3D12ResourceStateTracker::AddResource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state)
+{
+    const D3D12_RESOURCE_DESC desc = pResource->GetDesc();
+    UINT subresourceCount = 1;
+    if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        const UINT arraySize = (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize);
+        subresourceCount = desc.MipLevels * arraySize;
+    }
+    m_tracker.AddResource(pResource, subresourceCount, state);
+}
+
+void D3D12ResourceStateTracker::RemoveResource(ID3D12Resource* pResource)
+{
+    m_tracker.RemoveResource(pResource);
+}
+
+void D3D12ResourceStateTracker::Transition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state, UINT subresource)
+{
+    m_tracker.Transition(pResource, state, subresource);
+}
+
+void D3D12ResourceStateTracker::BeginTransition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state, UINT subresource)
+{
+    m_tracker.BeginTransition(pResource, state, subresource);
+}
+
+void D3D12ResourceStateTracker::EndSplitTransitions()
+{
+    m_tracker.EndSplitTransitions();
+}
+
+void D3D12ResourceStateTracker::FlushBarriers(StatsCommandList& commandList)
+{
+    const std::vector<StateBarrier>& pendingBarriers = m_tracker.GetPendingBarriers();
+    if (pendingBarriers.empty())
+    {
+        return;
+    }
+
+    m_barriers.clear();
+    for (const StateBarrier& pending : pendingBarriers)
+    {
+        D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        if (pending.split == BarrierSplit::Begin)
+        {
+            flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+        }
+        else if (pending.split == BarrierSplit::End)
+        {
+            flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+        }
+
+        // The tracker only stores the resources that were given to it.
+        ID3D12Resource* pResource = static_cast<ID3D12Resource*>(const_cast<void*>(pending.pResource));
+        m_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource,
+            static_cast<D3D12_RESOURCE_STATES>(pending.stateBefore), static_cast<D3D12_RESOURCE_STATES>(pending.stateAfter),
+            pending.subresource, flags));
+    }
+    commandList->ResourceBarrier(static_cast<UINT>(m_barriers.size()), m_barriers.data());
+    m_tracker.ClearPendingBarriers();
+}
+
+D3D12_RESOURCE_STATES D3D12ResourceStateTracker::GetState(ID3D12Resource* pResource, UINT subresource) const
+{
+    return static_cast<D3D12_RESOURCE_STATES>(m_tracker.GetState(pResource, subresource));
+}
@@ -0,0 +1,40 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ResourceStateTracker.h"
+#include "StatsCommandList.h"
+
+// The ResourceStateTracker for D3D12 resources: the commands ask for the states they
+// need, even those the resources are already in, and FlushBarriers() records the
+// transitions that are left in one call, right before the commands. The resources must
+// not change state behind its back.
+class D3D12ResourceStateTracker
+{
+public:
+    void AddResource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state);
+    void RemoveResource(ID3D12Resource* pResource);
+
+    void Transition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+    void BeginTransition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+    // Call before closing the command list.
+    void EndSplitTransitions();
+
+    void FlushBarriers(StatsCommandList& commandList);
+
+    D3D12_RESOURCE_STATES GetState(ID3D12Resource* pResource, UINT subresource = 0) const;
+
+private:
+    ResourceStateTracker m_tracker;
+    std::vector<D3D12_RESOURCE_BARRIER> m_barriers;     // Kept to reuse its memory.
+};
@@ -12,18 +12,29 @@
 #include "stdafx.h"
 #include "D3D12SimpleRainEffect.h"
 
+#include <algorithm>
+#include <random>
+
 
 D3D12SimpleRainEffect::D3D12SimpleRainEffect(UINT width, UINT height, std::wstring name) :
     DXSample(width, height, name),
     m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
     m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+    m_commandList(m_renderStats),
+    m_computeCommandList(m_renderStats),
     m_constantDataGpuAddr(0),
     m_mappedConstantData(nullptr),
     m_rtvDescriptorSize(0),
     m_frameIndex(0),
     m_fenceValues{},
+    m_computeFenceValue(0),
+    m_computeFenceValues{},
     m_fenceEvent(nullptr),
     m_curRotationAngleRad(0.0f),
+    m_particleLayers(1),
+    m_particleBufferIndex(0),
+    m_particleStepPending(false),
+    m_fullParticleSteps(0),
     m_indexBufferView{},
     m_vertexBufferView{}
 {
@@ -42,14 +53,19 @@ D3D12SimpleRainEffect::D3D12SimpleRainEffect(UINT width, UINT height, std::wstri
     // Initialize the projection matrix
     m_projectionMatrix = XMMatrixPerspectiveFovLH(XM_PIDIV4, width / (FLOAT)height, 0.01f, 100.0f);
 
-    // Initialize the scene output color
-    m_outputColor = XMVectorSet(0, 0, 0, 0);
+    // Initialize the scene output color: the particles are drawn in a half-transparent white.
+    m_outputColor = XMVectorSet(1, 1, 1, 0.5);
 }
 
 void D3D12SimpleRainEffect::OnInit()
 {
+    // The scene starts with a layer of particles per unit of scene scale.
+    m_particleLayers = m_sceneScale;
+
     LoadPipeline();
     LoadAssets();
+
+    m_benchmark.SetRenderStats(&m_renderStats);
 }
 
 // Load the rendering pipeline dependencies.
@@ -105,6 +121,13 @@ void D3D12SimpleRainEffect::LoadPipeline()
 
     ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
 
+    // Describe and create the compute queue that the particles are simulated on.
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+    ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_computeQueue)));
+
+    // The buffers of the sample are placed in the heaps of the memory allocator.
+    m_memoryAllocator.Initialize(m_device.Get());
+
     // Describe and create the swap chain.
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
     swapChainDesc.BufferCount = FrameCount;
@@ -154,14 +177,16 @@ void D3D12SimpleRainEffect::LoadPipeline()
     {
         CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
 
-        // Create a RTV and a command allocator for each frame.
+        // Create a RTV and a command allocator for each frame, and one for its simulation steps.
         for (UINT n = 0; n < FrameCount; n++)
         {
             ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTargets[n])));
             m_device->CreateRenderTargetView(m_renderTargets[n].Get(), nullptr, rtvHandle);
+            m_stateTracker.AddResource(m_renderTargets[n].Get(), D3D12_RESOURCE_STATE_PRESENT);
             rtvHandle.Offset(1, m_rtvDescriptorSize);
 
             ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[n])));
+            ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(&m_computeAllocators[n])));
         }
     }
 
@@ -203,12 +228,11 @@ void D3D12SimpleRainEffect::LoadAssets()
         CD3DX12_ROOT_PARAMETER1 rp[1] = {};
         rp[0].InitAsConstantBufferView(0, 0);
 
-        // Allow input layout and stream output, and deny uneccessary access to certain pipeline stages.
+        // Allow input layout and deny uneccessary access to certain pipeline stages.
         D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
             D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
             D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_STREAM_OUTPUT;
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS;
 
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
         rootSignatureDesc.Init_1_1(_countof(rp), rp, 0, nullptr, rootSignatureFlags);
@@ -219,29 +243,36 @@ void D3D12SimpleRainEffect::LoadAssets()
         ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
     }
 
-    // Create the constant buffer memory and map the resource
+    // Create the root signature of the simulation: its constants, and the particle buffers
+    // it reads and writes, bound by their address.
     {
-        const D3D12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        size_t cbSize = c_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
+        CD3DX12_ROOT_PARAMETER1 rp[3] = {};
+        rp[0].InitAsConstants(2, 1, 0);
+        rp[1].InitAsShaderResourceView(0, 0);
+        rp[2].InitAsUnorderedAccessView(0, 0);
 
-        const D3D12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(cbSize);
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &uploadHeapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &constantBufferDesc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(m_perFrameConstants.ReleaseAndGetAddressOf())));
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
+        rootSignatureDesc.Init_1_1(_countof(rp), rp, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> error;
+        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, featureData.HighestVersion, &signature, &error));
+        ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_computeRootSignature)));
+    }
 
-        ThrowIfFailed(m_perFrameConstants->Map(0, nullptr, reinterpret_cast<void**>(&m_mappedConstantData)));
+    // Create the constant buffer memory, in an upload pool buffer, which is already mapped
+    {
+        size_t cbSize = c_numDrawCalls * FrameCount * sizeof(PaddedConstantBuffer);
+        m_perFrameConstants = m_memoryAllocator.CreatePooledBuffer(D3D12_HEAP_TYPE_UPLOAD, cbSize);
+        m_mappedConstantData = reinterpret_cast<PaddedConstantBuffer*>(m_perFrameConstants.pMappedData);
 
-        // GPU virtual address of the resource
-        m_constantDataGpuAddr = m_perFrameConstants->GetGPUVirtualAddress();
+        // GPU virtual address of the constants
+        m_constantDataGpuAddr = m_perFrameConstants.gpuAddress;
     }
 
     // Create the pipeline state objects, which includes compiling and loading shaders.
     {
-        ComPtr<ID3DBlob> vertexShader, geometryShader, streamGeometryShader, pixelShader;
+        ComPtr<ID3DBlob> drawVertexShader, geometryShader, pixelShader, simulationShader;
 
 #if defined(_DEBUG)
         // Enable better shader debugging with the graphics debugging tools.
@@ -250,10 +281,10 @@ void D3D12SimpleRainEffect::LoadAssets()
         UINT compileFlags = 0;
 #endif
 
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "MainVS", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "DrawVS", "vs_5_0", compileFlags, 0, &drawVertexShader, nullptr));
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "MainGS", "gs_5_0", compileFlags, 0, &geometryShader, nullptr));
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "MainGSSO", "gs_5_0", compileFlags, 0, &streamGeometryShader, nullptr));
         ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "MainPS", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
+        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "SimulateCS", "cs_5_0", compileFlags, 0, &simulationShader, nullptr));
 
 
         // Define the vertex input layout.
@@ -266,29 +297,6 @@ void D3D12SimpleRainEffect::LoadAssets()
 
         // Create the Pipeline State Objects
         {
-            D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-
-            //
-            // PSO for moving particles
-            //
-            D3D12_SO_DECLARATION_ENTRY SODeclarationEntries[] =
-            {
-                { 0, "POSITION", 0, 0, 3, 0 },
-                { 0, "SIZE", 0, 0, 2, 0 },
-                { 0, "SPEED", 0, 0, 1, 0 }
-            };
-
-            UINT vertexStride = sizeof(Vertex);
-            UINT SOBufferStrides[] = { vertexStride };
-
-            // Specify to write all the vertex attributes from the input buffer 0 to the stream output buffer 0
-            D3D12_STREAM_OUTPUT_DESC SODesc{};
-            SODesc.NumEntries = 3;
-            SODesc.pSODeclaration = SODeclarationEntries;
-            SODesc.NumStrides = 1;
-            SODesc.pBufferStrides = SOBufferStrides;
-            SODesc.RasterizedStream = D3D12_SO_NO_RASTERIZED_STREAM;
-
             // Enable blending and use alpha blending
             CD3DX12_BLEND_DESC blendDesc{ D3D12_DEFAULT };
             blendDesc.RenderTarget[0].BlendEnable = TRUE;
@@ -296,140 +304,54 @@ void D3D12SimpleRainEffect::LoadAssets()
             blendDesc.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
             blendDesc.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
 
-            // Create a PSO that uses the SO stage
+            //
+            // PSO for drawing normals with a solid color, faded with the density
+            //
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
             psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
             psoDesc.pRootSignature = m_rootSignature.Get();
-            psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
-            psoDesc.GS = CD3DX12_SHADER_BYTECODE(streamGeometryShader.Get());
-            psoDesc.StreamOutput = SODesc;
+            psoDesc.VS = CD3DX12_SHADER_BYTECODE(drawVertexShader.Get());
+            psoDesc.GS = CD3DX12_SHADER_BYTECODE(geometryShader.Get());
+            psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
             psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
             psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
             psoDesc.BlendState = blendDesc;
             psoDesc.SampleMask = UINT_MAX;
             psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
-            psoDesc.NumRenderTargets = 0;
-            psoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+            psoDesc.NumRenderTargets = 1;
+            psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
             psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
             psoDesc.SampleDesc.Count = 1;
-            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_streamPipelineState)));
+            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
 
 
             //
-            // PSO for drawing normals with a solid color
+            // PSO for moving particles, on the compute queue
             //
-            psoDesc.GS = CD3DX12_SHADER_BYTECODE(geometryShader.Get());
-            psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
-            psoDesc.StreamOutput = {};
-            psoDesc.NumRenderTargets = 1;
-            psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
+            D3D12_COMPUTE_PIPELINE_STATE_DESC computePsoDesc = {};
+            computePsoDesc.pRootSignature = m_computeRootSignature.Get();
+            computePsoDesc.CS = CD3DX12_SHADER_BYTECODE(simulationShader.Get());
+            ThrowIfFailed(m_device->CreateComputePipelineState(&computePsoDesc, IID_PPV_ARGS(&m_computePipelineState)));
         }
     }
 
     // Create the command list.
-    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
+
+    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, m_computeAllocators[m_frameIndex].Get(), nullptr, IID_PPV_ARGS(m_computeCommandList.ReleaseAndGetAddressOf())));
 
     // Command lists are created in the recording state, but there is nothing
-    // to record yet. The main loop expects it to be closed, so close it now.
+    // to record yet. The main loop expects them to be closed, so close them now.
     ThrowIfFailed(m_commandList->Close());
+    ThrowIfFailed(m_computeCommandList->Close());
 
-    // Create the vertex and index buffers.
-    {
-        // Define a grid of 9 * 9 particles lying in the XZ plane of the local space inside the square [-20, 20] x [-20, 20].
-        for (int i = 0; i < 81; ++i)
-        {
-            Vertex v;
-            v.position = XMFLOAT3{ i % 9 * 5.0f - 20.0f, 0.0f, i / 9 * 5.0f - 20.0f };
-            v.size = { 0.05f, 5.0f };
-            v.speed = static_cast<float>(100 + rand() % 200);
-            particleVertices.push_back(v);
-        }
-
-        // Note: using upload heaps to transfer static data like vert buffers is not 
-        // recommended. Every time the GPU needs it, the upload heap will be marshalled 
-        // over. Please read up on Default Heap usage. An upload heap is used here for 
-        // code simplicity and because there are very few verts to actually transfer.
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(particleVertices.size() * sizeof(Vertex)),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&m_vertexBuffer)));
-
-        // Copy the data to the vertex buffer.
-        UINT8* pVertexDataBegin = nullptr;
-        CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-        ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-        memcpy(pVertexDataBegin, particleVertices.data(), particleVertices.size() * sizeof(Vertex));
-        m_vertexBuffer->Unmap(0, nullptr);
-
-        // Initialize the vertex buffer view.
-        m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-        m_vertexBufferView.StrideInBytes = sizeof(Vertex);
-        m_vertexBufferView.SizeInBytes = (UINT)particleVertices.size() * sizeof(Vertex);
-    }
-
-    // Create the buffers required to use the stream output stage
-    {
-        // Stream output buffer
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(particleVertices.size() * sizeof(Vertex)),
-            D3D12_RESOURCE_STATE_STREAM_OUT,
-            nullptr,
-            IID_PPV_ARGS(&m_streamOutputBuffer)));
-
-        // Filled size buffer
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(sizeof(PUINT_PTR)),
-            D3D12_RESOURCE_STATE_STREAM_OUT,
-            nullptr,
-            IID_PPV_ARGS(&m_streamFilledSizeBuffer)));
-
-        // Upload buffer to clear the filled size buffer
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(sizeof(PUINT_PTR)),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&m_streamFilledSizeUploadBuffer)));
-
-        m_streamFilledSizeUploadBuffer->Map(0, NULL, reinterpret_cast<void**>(&m_pFilledSize));
-
-        // Stream output buffer view
-        m_streamOutputBufferView.BufferLocation = m_streamOutputBuffer->GetGPUVirtualAddress();
-        m_streamOutputBufferView.SizeInBytes = particleVertices.size() * sizeof(Vertex);
-        m_streamOutputBufferView.BufferFilledSizeLocation = m_streamFilledSizeBuffer->GetGPUVirtualAddress();
-
-        // Readback buffer to read (from the CPU) the size of the data written to the stream output buffer by the GPU,
-        // which writes that size in the filled size buffer.
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(sizeof(PUINT_PTR)),
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&m_streamFilledSizeReadBackBuffer)));
-
-        // Buffer used as vertex buffer in the rendering pass
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(particleVertices.size() * sizeof(Vertex)),
-            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
-            nullptr,
-            IID_PPV_ARGS(&m_updatedVertexBuffer)));
-    }
+    CreateParticleBuffers();
 
     // Create synchronization objects and wait until assets have been uploaded to the GPU.
     {
         ThrowIfFailed(m_device->CreateFence(m_fenceValues[m_frameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
         m_fenceValues[m_frameIndex]++;
+        ThrowIfFailed(m_device->CreateFence(m_computeFenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_computeFence)));
 
         // Create an event handle to use for frame synchronization.
         m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
@@ -448,13 +370,23 @@ void D3D12SimpleRainEffect::LoadAssets()
 // Update frame-based values.
 void D3D12SimpleRainEffect::OnUpdate()
 {
-    m_timer.Tick(NULL);
+    m_timer.Tick();
+
+    // The frame time picks the density of the next frames; the benchmark mode keeps the
+    // same load throughout.
+    if (!m_benchmark.IsEnabled())
+    {
+        m_particleDensity.Update(static_cast<float>(m_timer.GetElapsedSeconds() * 1000.0));
+    }
 
     if (m_frameCounter++ % 30 == 0)
     {
-        // Update window text with FPS value.
-        wchar_t fps[64];
-        swprintf_s(fps, L"%ufps", m_timer.GetFramesPerSecond());
+        // Update window text with FPS value, the frame time percentiles of the last second or so, and the density.
+        const FrameTimeStatistics stats = m_timer.GetFrameTimes().GetRecentStatistics(64);
+
+        wchar_t fps[160];
+        swprintf_s(fps, L"%ufps - frame time p50 %.2f ms, p99 %.2f ms, max %.2f ms - density %.0f%%",
+            m_timer.GetFramesPerSecond(), stats.p50Ms, stats.p99Ms, stats.maxMs, 100.0f * m_particleDensity.GetDensity());
         SetCustomWindowText(fps);
     }
 }
@@ -462,17 +394,149 @@ void D3D12SimpleRainEffect::OnUpdate()
 // Render the scene.
 void D3D12SimpleRainEffect::OnRender()
 {
+    // The simulation steps of a frame are recorded with its own allocator, which
+    // MoveToNextFrame() waited for.
+    ThrowIfFailed(m_computeAllocators[m_frameIndex]->Reset());
+
+    // New particle buffers have no step in flight for this frame: it simulates one first.
+    if (!m_particleStepPending)
+    {
+        BENCHMARK_PHASE(m_benchmark, "SubmitParticleSimulation");
+        SubmitParticleSimulation();
+    }
+
     // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList();
+    {
+        BENCHMARK_PHASE(m_benchmark, "PopulateCommandList");
+        PopulateCommandList();
+    }
+
+    // Execute the command list, once the simulation step of its particles is done. The
+    // direct queue waits for it on the GPU.
+    {
+        BENCHMARK_PHASE(m_benchmark, "ExecuteCommandLists");
+        ThrowIfFailed(m_commandQueue->Wait(m_computeFence.Get(), m_computeFenceValue));
+        ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+        m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    }
 
-    // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    // Simulate the particles of the next frame while this one renders.
+    {
+        BENCHMARK_PHASE(m_benchmark, "SubmitParticleSimulation");
+        SubmitParticleSimulation();
+    }
 
     // Present the frame.
-    ThrowIfFailed(m_swapChain->Present(1, 0));
+    {
+        BENCHMARK_PHASE(m_benchmark, "Present");
+        ThrowIfFailed(m_swapChain->Present(m_syncInterval, 0));
+    }
+
+    {
+        BENCHMARK_PHASE(m_benchmark, "MoveToNextFrame");
+        MoveToNextFrame();
+    }
+
+    // Close the counters of this frame and periodically print a summary.
+    if (m_renderStats.EndFrame() % c_renderStatsDumpInterval == 0)
+    {
+        OutputDebugStringA(m_renderStats.FormatSummary(c_renderStatsDumpInterval).c_str());
+    }
+}
+
+// Create the particles, and the buffers that hold them.
+void D3D12SimpleRainEffect::CreateParticleBuffers()
+{
+    // Create the vertex buffer.
+    {
+        // Define a grid of 9 * 9 particles lying in the XZ plane of the local space inside the square [-20, 20] x [-20, 20].
+        // Each layer adds a copy of the grid, shifted diagonally inside the cells.
+        particleVertices.clear();
+        for (UINT layer = 0; layer < m_particleLayers; ++layer)
+        {
+            const float offset = 5.0f * layer / m_particleLayers;
+            for (int i = 0; i < 81; ++i)
+            {
+                Vertex v;
+                v.position = XMFLOAT3{ i % 9 * 5.0f - 20.0f + offset, 0.0f, i / 9 * 5.0f - 20.0f + offset };
+                v.size = { 0.05f, 5.0f };
+                v.speed = static_cast<float>(100 + rand() % 200);
+                particleVertices.push_back(v);
+            }
+        }
+
+        // Any first particles are spread over the scene, for the density to cull the others.
+        std::shuffle(particleVertices.begin(), particleVertices.end(), std::mt19937(c_particleShuffleSeed));
+
+        // Note: using upload heaps to transfer static data like vert buffers is not 
+        // recommended. Every time the GPU needs it, the upload heap will be marshalled 
+        // over. Please read up on Default Heap usage. An upload heap is used here for 
+        // code simplicity and because there are very few verts to actually transfer.
+        m_vertexBuffer = m_memoryAllocator.CreatePooledBuffer(D3D12_HEAP_TYPE_UPLOAD, particleVertices.size() * sizeof(Vertex));
+
+        // Copy the data to the vertex buffer.
+        {
+            UploadWriter writer(m_vertexBuffer.pMappedData, particleVertices.size() * sizeof(Vertex));
+            writer.WriteArray(particleVertices.data(), particleVertices.size());
+        }
+
+        // Initialize the vertex buffer view.
+        m_vertexBufferView.BufferLocation = m_vertexBuffer.gpuAddress;
+        m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+        m_vertexBufferView.SizeInBytes = (UINT)particleVertices.size() * sizeof(Vertex);
+    }
+
+    // Create the particle buffers that the simulation steps write in turn. They are used
+    // on both queues, and stay in the COMMON state: a buffer is promoted to the state of
+    // each use, and decays back to COMMON once the command lists are executed, so neither
+    // queue records a barrier for them that the other would have to know about.
+    {
+        for (GpuBuffer& particleBuffer : m_particleBuffers)
+        {
+            particleBuffer = m_memoryAllocator.CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, particleVertices.size() * sizeof(Vertex), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        }
+        m_particleBufferIndex = 0;
+        m_particleStepPending = false;
+        m_fullParticleSteps = c_particleBufferCount;
+
+        OutputDebugStringA(m_memoryAllocator.FormatStats().c_str());
+    }
+}
+
+// The frames in flight may still use the particle buffers: they are freed once the
+// frame being recorded is done on the GPU, instead of waiting for it here. That frame
+// waits for a simulation step submitted after the last one that uses them, so they are
+// done on the compute queue too.
+void D3D12SimpleRainEffect::RetireParticleBuffers()
+{
+    GpuBuffer* const buffers[] = { &m_vertexBuffer, &m_particleBuffers[0], &m_particleBuffers[1] };
+    for (GpuBuffer* pBuffer : buffers)
+    {
+        const GpuBuffer buffer = *pBuffer;
+        m_deferredReleases.Retire(m_fenceValues[m_frameIndex], [this, buffer]() mutable { m_memoryAllocator.Free(buffer); });
+        *pBuffer = GpuBuffer{};
+    }
+}
+
+// Change the number of particles with the up and down arrows, without waiting for the GPU.
+void D3D12SimpleRainEffect::OnKeyDown(UINT8 key)
+{
+    UINT particleLayers = m_particleLayers;
+    if (key == VK_UP && m_particleLayers < c_maxParticleLayers)
+    {
+        particleLayers = m_particleLayers + 1;
+    }
+    else if (key == VK_DOWN && m_particleLayers > 1)
+    {
+        particleLayers = m_particleLayers - 1;
+    }
 
-    MoveToNextFrame();
+    if (particleLayers != m_particleLayers)
+    {
+        m_particleLayers = particleLayers;
+        RetireParticleBuffers();
+        CreateParticleBuffers();
+    }
 }
 
 void D3D12SimpleRainEffect::OnDestroy()
@@ -482,6 +546,60 @@ void D3D12SimpleRainEffect::OnDestroy()
     WaitForGpu();
 
     CloseHandle(m_fenceEvent);
+
+    // The GPU is idle, so the retired buffers can go too.
+    m_deferredReleases.ReleaseAll();
+
+    m_memoryAllocator.Free(m_vertexBuffer);
+    m_memoryAllocator.Free(m_perFrameConstants);
+    for (GpuBuffer& particleBuffer : m_particleBuffers)
+    {
+        m_memoryAllocator.Free(particleBuffer);
+    }
+}
+
+// Record and submit a simulation step on the compute queue. It moves the particles of the
+// frame being recorded, or the initial particles of new particle buffers, into the next
+// particle buffer. The step takes the time of the frame it's submitted in, since the
+// next one isn't known yet, and moves the particles that are active in that frame: the
+// ones that the density activates next have the place of an earlier step, and are
+// hardly visible yet.
+void D3D12SimpleRainEffect::SubmitParticleSimulation()
+{
+    D3D12_GPU_VIRTUAL_ADDRESS sourceAddress = m_vertexBuffer.gpuAddress;
+    if (m_particleStepPending)
+    {
+        sourceAddress = m_particleBuffers[m_particleBufferIndex].gpuAddress;
+        m_particleBufferIndex = (m_particleBufferIndex + 1) % c_particleBufferCount;
+    }
+
+    const UINT particleCount = static_cast<UINT>(particleVertices.size());
+    const UINT simulatedParticleCount = m_fullParticleSteps > 0 ? particleCount : m_particleDensity.GetActiveCount(particleCount);
+    if (m_fullParticleSteps > 0)
+    {
+        --m_fullParticleSteps;
+    }
+    const FLOAT deltaTime = static_cast<FLOAT>(m_timer.GetElapsedSeconds());
+
+    ThrowIfFailed(m_computeCommandList->Reset(m_computeAllocators[m_frameIndex].Get(), m_computePipelineState.Get()));
+    m_computeCommandList->SetComputeRootSignature(m_computeRootSignature.Get());
+    m_computeCommandList->SetComputeRoot32BitConstants(0, 1, &deltaTime, 0);
+    m_computeCommandList->SetComputeRoot32BitConstants(0, 1, &simulatedParticleCount, 1);
+    m_computeCommandList->SetComputeRootShaderResourceView(1, sourceAddress);
+    m_computeCommandList->SetComputeRootUnorderedAccessView(2, m_particleBuffers[m_particleBufferIndex].gpuAddress);
+    m_computeCommandList->Dispatch(GetParticleSimulationGroupCount(simulatedParticleCount), 1, 1);
+    ThrowIfFailed(m_computeCommandList->Close());
+
+    // The particle buffer written was last drawn by the frame before this one, at the
+    // latest, whose end is the last value that the direct queue signaled.
+    ThrowIfFailed(m_computeQueue->Wait(m_fence.Get(), m_fenceValues[m_frameIndex] - 1));
+    ID3D12CommandList* ppCommandLists[] = { m_computeCommandList.Get() };
+    m_computeQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+    ++m_computeFenceValue;
+    ThrowIfFailed(m_computeQueue->Signal(m_computeFence.Get(), m_computeFenceValue));
+    m_computeFenceValues[m_frameIndex] = m_computeFenceValue;
+    m_particleStepPending = true;
 }
 
 void D3D12SimpleRainEffect::PopulateCommandList()
@@ -493,8 +611,8 @@ void D3D12SimpleRainEffect::PopulateCommandList()
 
     // However, when ExecuteCommandList() is called on a particular command 
     // list, that command list can then be reset at any time and must be before re-recording.
-    // Set PSO for the streaming pass.
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_streamPipelineState.Get()));
+    // Set the PSO for drawing points with the help of the GS.
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
 
     // Set necessary state.
     m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
@@ -511,7 +629,8 @@ void D3D12SimpleRainEffect::PopulateCommandList()
     m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
 
     // Indicate that the back buffer will be used as a render target.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    m_stateTracker.Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_stateTracker.FlushBarriers(m_commandList);
 
     // Set render target and depth buffer in OM stage
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
@@ -523,6 +642,10 @@ void D3D12SimpleRainEffect::PopulateCommandList()
     m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
     m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
+    // The particles are drawn from the particle buffer that the last simulation step
+    // wrote, which the direct queue waits for before executing the command list.
+    m_vertexBufferView.BufferLocation = m_particleBuffers[m_particleBufferIndex].gpuAddress;
+
     // Set up the input assembler
     m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
     m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
@@ -539,70 +662,32 @@ void D3D12SimpleRainEffect::PopulateCommandList()
     XMStoreFloat3(&cbParameters.cameraWPos, m_cameraWPos);
     cbParameters.deltaTime = (FLOAT)m_timer.GetElapsedSeconds();
 
-    // Set the constants for the first draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
-
-    // Initialize the filled size buffer to zero
-    *m_pFilledSize = 0;
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_streamFilledSizeBuffer.Get(), D3D12_RESOURCE_STATE_STREAM_OUT, D3D12_RESOURCE_STATE_COPY_DEST));
-    m_commandList->CopyResource(m_streamFilledSizeBuffer.Get(), m_streamFilledSizeUploadBuffer.Get());
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_streamFilledSizeBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_STREAM_OUT));
-
-    // Set the stream output buffer view
-    D3D12_STREAM_OUTPUT_BUFFER_VIEW streamOutputBufferViews[]{ m_streamOutputBufferView };
-    m_commandList->SOSetTargets(0, _countof(streamOutputBufferViews), streamOutputBufferViews);
-    
-    // Streaming pass
-    // "Draw" the particles to modify their y-coordinate with the help of GS and SO stages
-    m_commandList->DrawInstanced((UINT)particleVertices.size(), 1, 0, 0);
-    baseGpuAddress += sizeof(PaddedConstantBuffer);
-    ++constantBufferIndex;
-
-    // Copy from the filled size buffer to the read-back buffer, which is CPU-visible.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_streamFilledSizeBuffer.Get(), D3D12_RESOURCE_STATE_STREAM_OUT, D3D12_RESOURCE_STATE_COPY_SOURCE));
-    m_commandList->CopyResource(m_streamFilledSizeReadBackBuffer.Get(), m_streamFilledSizeBuffer.Get());
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_streamFilledSizeBuffer.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_STREAM_OUT));
-
-    // Read from the read-back buffer how much data (in bytes) the SO written to the stream output buffer,
-    // and use this info to compute the number of vertices stored in the stream output buffer.
-    UINT64* pFilledSize = NULL;
-    m_streamFilledSizeReadBackBuffer->Map(0, NULL, reinterpret_cast<void**>(&pFilledSize));
-    UINT nVertices = UINT(*pFilledSize) / sizeof(Vertex);
-    m_streamFilledSizeReadBackBuffer->Unmap(0, NULL);
-
-    // Copy from the stream output buffer to the updated vertex buffer, which contains the particles with the new positions.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_updatedVertexBuffer.Get(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST));
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_streamOutputBuffer.Get(), D3D12_RESOURCE_STATE_STREAM_OUT, D3D12_RESOURCE_STATE_COPY_SOURCE));
-    m_commandList->CopyResource(m_updatedVertexBuffer.Get(), m_streamOutputBuffer.Get());
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_updatedVertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_streamOutputBuffer.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_STREAM_OUT));
-
-    // Set the PSO for drawing points with the help of the GS
-    m_commandList->SetPipelineState(m_pipelineState.Get());
-
-    // Set a half-transparent white color
-    m_outputColor = XMVectorSet(1, 1, 1, 0.5);
-    XMStoreFloat4(&cbParameters.outputColor, m_outputColor);
-
-    // Set the constants for the second draw call
-    memcpy(&m_mappedConstantData[constantBufferIndex], &cbParameters, sizeof(ConstantBuffer));
-
-    // Bind the constants to the shader
-    baseGpuAddress = m_constantDataGpuAddr + sizeof(PaddedConstantBuffer) * constantBufferIndex;
-    m_commandList->SetGraphicsRootConstantBufferView(0, baseGpuAddress);
+    // The drops fade with the density and their distance to the camera, as
+    // ParticleDensityController::GetDropAlpha() computes.
+    const ParticleDensityDesc& densityDesc = m_particleDensity.GetDesc();
+    cbParameters.density = m_particleDensity.GetDensity();
+    cbParameters.densityFadeWidth = densityDesc.fadeWidth;
+    cbParameters.dropCount = static_cast<FLOAT>(particleVertices.size());
+    cbParameters.farDensity = densityDesc.farDensity;
+    cbParameters.fadeStartDistance = densityDesc.fadeStartDistance;
+    cbParameters.fadeEndDistance = densityDesc.fadeEndDistance;
 
-    // Update the vertex buffer view with the address of the updated vertex buffer
-    m_vertexBufferView.BufferLocation = m_updatedVertexBuffer->GetGPUVirtualAddress();
-
-    // Unbind the stream output buffer from the SO
-    m_commandList->SOSetTargets(0, 1, NULL);
+    {
+        UploadWriter writer(&m_mappedConstantData[constantBufferIndex], c_numDrawCalls * sizeof(PaddedConstantBuffer));
+        writer.Write(cbParameters);
+        writer.Close();
+        m_renderStats.Add(RenderCounter::UploadBytes, writer.GetBytesWritten());
+    }
 
     // Rendering pass
     // "Draw" the particles with the help of the GS in order to amplify the geometry to a set of quads.
-    m_commandList->DrawInstanced(nVertices, 1, 0, 0);
+    // The particles past the active ones are invisible.
+    const UINT activeParticleCount = m_particleDensity.GetActiveCount(static_cast<UINT>(particleVertices.size()));
+    m_commandList->DrawInstanced(activeParticleCount, 1, 0, 0);
 
     // Indicate that the back buffer will now be used to present.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    m_stateTracker.Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT);
+    m_stateTracker.FlushBarriers(m_commandList);
 
     ThrowIfFailed(m_commandList->Close());
 }
@@ -615,7 +700,14 @@ void D3D12SimpleRainEffect::WaitForGpu()
 
     // Wait until the fence has been processed.
     ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-    WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
+
+    // The simulation may still run a step ahead of the rendering.
+    if (m_computeFence->GetCompletedValue() < m_computeFenceValue)
+    {
+        ThrowIfFailed(m_computeFence->SetEventOnCompletion(m_computeFenceValue, m_fenceEvent));
+        m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
+    }
 
     // Increment the fence value for the current frame.
     m_fenceValues[m_frameIndex]++;
@@ -635,9 +727,20 @@ void D3D12SimpleRainEffect::MoveToNextFrame()
     if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
     {
         ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
-        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+        m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
+    }
+
+    // The rendering of that frame only waited for the first simulation step recorded with
+    // its compute allocator, so wait for the last one too. It's usually long done.
+    if (m_computeFence->GetCompletedValue() < m_computeFenceValues[m_frameIndex])
+    {
+        ThrowIfFailed(m_computeFence->SetEventOnCompletion(m_computeFenceValues[m_frameIndex], m_fenceEvent));
+        m_renderStats.TimeFenceWait([this] { WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE); });
     }
 
     // Set the fence value for the next frame.
     m_fenceValues[m_frameIndex] = currentFenceValue + 1;
+
+    // Release the resources that the frames done on the GPU were the last to use.
+    m_deferredReleases.ReleaseCompleted(m_fence->GetCompletedValue());
 }
\ No newline at end of file
@@ -13,6 +13,13 @@
 
 #include "DXSample.h"
 #include "StepTimer.h"
+#include "StatsCommandList.h"
+#include "UploadWriter.h"
+#include "D3D12MemoryAllocator.h"
+#include "D3D12ResourceStateTracker.h"
+#include "DeferredReleaseQueue.h"
+#include "ParticleDensity.h"
+#include "ParticleSimulation.h"
 
 using namespace DirectX;
 
@@ -20,7 +27,8 @@ using namespace DirectX;
 // it has no understanding of the lifetime of resources on the GPU. Apps must account
 // for the GPU lifetime of resources to avoid destroying objects that may still be
 // referenced by the GPU.
-// An example of this can be found in the class method: OnDestroy().
+// An example of this can be found in the class method: OnDestroy(), and the buffers
+// that are replaced at runtime go through m_deferredReleases.
 using Microsoft::WRL::ComPtr;
 
 class D3D12SimpleRainEffect : public DXSample
@@ -32,6 +40,7 @@ public:
     virtual void OnUpdate();
     virtual void OnRender();
     virtual void OnDestroy();
+    virtual void OnKeyDown(UINT8 key);
 
 private:
     // In this sample we overload the meaning of FrameCount to mean both the maximum
@@ -44,7 +53,7 @@ private:
     // may result in noticeable latency in your app.
     static const UINT FrameCount = 2;
 
-    // Vertex attributes
+    // Vertex attributes, which SimulateCS reads and writes as particles.
     struct Vertex
     {
         XMFLOAT3 position;
@@ -52,6 +61,8 @@ private:
         FLOAT speed;
     };
 
+    static_assert(sizeof(Vertex) == sizeof(RainParticle), "The particle buffers hold the vertices.");
+
     // Constant buffer
     struct ConstantBuffer
     {
@@ -61,10 +72,17 @@ private:
         XMFLOAT4 outputColor;          // 16 bytes
         XMFLOAT3 cameraWPos;           // 12 bytes
         FLOAT deltaTime;               //  4 bytes
+        FLOAT density;                 //  4 bytes
+        FLOAT densityFadeWidth;        //  4 bytes
+        FLOAT dropCount;               //  4 bytes
+        FLOAT farDensity;              //  4 bytes
+        FLOAT fadeStartDistance;       //  4 bytes
+        FLOAT fadeEndDistance;         //  4 bytes
+        XMFLOAT2 padding;              //  8 bytes
     };
 
     // We'll allocate space for several of these and they will need to be padded for alignment.
-    static_assert(sizeof(ConstantBuffer) == 224, "Checking the size here.");
+    static_assert(sizeof(ConstantBuffer) == 256, "Checking the size here.");
 
     // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT < 272 < 2 * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
     // Create a union with the correct size and enough room for one ConstantBuffer
@@ -89,14 +107,29 @@ private:
     ComPtr<ID3D12RootSignature> m_rootSignature;
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
-    ComPtr<ID3D12PipelineState>  m_streamPipelineState;
     ComPtr<ID3D12PipelineState>  m_pipelineState;
-    ComPtr<ID3D12GraphicsCommandList> m_commandList;
-
-    // App resources.
-    ComPtr<ID3D12Resource> m_vertexBuffer;
+    RenderStats m_renderStats;
+    StatsCommandList m_commandList;     // Counts the recorded commands into m_renderStats.
+    D3D12ResourceStateTracker m_stateTracker;   // Records the barriers of the back buffers.
+
+    // The particles are simulated on a compute queue, a frame ahead of the rendering:
+    // the step that the next frame draws runs while the direct queue renders this one.
+    // Each step reads the particle buffer of the last one and writes the other, which the
+    // frame before the last one drew, so it waits on the direct queue for that frame;
+    // the rendering waits on the compute queue for its step.
+    ComPtr<ID3D12CommandQueue> m_computeQueue;
+    ComPtr<ID3D12CommandAllocator> m_computeAllocators[FrameCount];
+    ComPtr<ID3D12RootSignature> m_computeRootSignature;
+    ComPtr<ID3D12PipelineState> m_computePipelineState;
+    StatsCommandList m_computeCommandList;
+
+    // App resources. The buffers are placed in the heaps of m_memoryAllocator, which
+    // must outlive them.
+    D3D12MemoryAllocator m_memoryAllocator;
+    DeferredReleaseQueue m_deferredReleases;   // Frees the buffers it holds into m_memoryAllocator.
+    GpuBuffer m_vertexBuffer;           // The initial particles, which the first step reads.
     ComPtr<ID3D12Resource> m_indexBuffer;
-    ComPtr<ID3D12Resource> m_perFrameConstants;
+    GpuBuffer m_perFrameConstants;
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
     D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
     D3D12_GPU_VIRTUAL_ADDRESS m_constantDataGpuAddr;
@@ -110,14 +143,17 @@ private:
     UINT m_frameCounter;
     HANDLE m_fenceEvent;
     ComPtr<ID3D12Fence> m_fence;
-    UINT64 m_fenceValues[FrameCount];
+    UINT64 m_fenceValues[FrameCount];   // The direct queue last signaled m_fenceValues[m_frameIndex] - 1.
+    ComPtr<ID3D12Fence> m_computeFence;
+    UINT64 m_computeFenceValue;         // Signaled by the last simulation step.
+    UINT64 m_computeFenceValues[FrameCount];    // Signaled by the last step recorded with each allocator.
 
     // Scene constants, updated per-frame
     float m_curRotationAngleRad;
 
-    // In this simple sample, we know that there are three draw calls
+    // In this simple sample, we know that there is one draw call
     // and we will update the scene constants for each draw call.
-    static const unsigned int c_numDrawCalls = 2;
+    static const unsigned int c_numDrawCalls = 1;
 
     // These computed values will be loaded into a ConstantBuffer
     XMMATRIX m_worldMatrix;
@@ -126,21 +162,38 @@ private:
     XMVECTOR m_outputColor;
     XMVECTOR m_cameraWPos;
 
+    // Frames between two dumps of the render stats to the debugger output.
+    static const UINT c_renderStatsDumpInterval = 300;
+
     void LoadPipeline();
     void LoadAssets();
     void PopulateCommandList();
+    void CreateParticleBuffers();
+    void RetireParticleBuffers();
+    void SubmitParticleSimulation();
     void MoveToNextFrame();
     void WaitForGpu();
 
     // Particle collection
     std::vector<Vertex> particleVertices;
 
-    // Streaming resources
-    ComPtr<ID3D12Resource>			m_streamOutputBuffer;
-    D3D12_STREAM_OUTPUT_BUFFER_VIEW m_streamOutputBufferView;
-    ComPtr<ID3D12Resource>			m_streamFilledSizeBuffer;
-    ComPtr<ID3D12Resource>			m_streamFilledSizeUploadBuffer;
-    ComPtr<ID3D12Resource>			m_streamFilledSizeReadBackBuffer;
-    ComPtr<ID3D12Resource>			m_updatedVertexBuffer;
-    UINT* m_pFilledSize;
+    // Layers of 9 * 9 particles; the arrows change it up to c_maxParticleLayers.
+    UINT m_particleLayers;
+    static const UINT c_maxParticleLayers = 16;
+
+    // Fraction of the particles simulated and drawn, from the frame times, except in the
+    // benchmark mode, which always draws them all. The first ones of particleVertices are
+    // the active ones, so they are shuffled with a fixed seed to spread over the scene.
+    ParticleDensityController m_particleDensity;
+    static const UINT c_particleShuffleSeed = 12345;
+
+    // The particle buffers that the simulation steps write in turn, and the one that the
+    // frame being recorded draws. New particle buffers have no step in flight yet, and
+    // have all their particles simulated by the first step into each of them, so that the
+    // inactive ones are in both.
+    static const UINT c_particleBufferCount = 2;
+    GpuBuffer m_particleBuffers[c_particleBufferCount];
+    UINT m_particleBufferIndex;
+    bool m_particleStepPending;
+    UINT m_fullParticleSteps;
 };
\ No newline at end of file
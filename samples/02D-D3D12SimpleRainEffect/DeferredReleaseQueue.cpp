@@ -0,0 +1,80 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DeferredReleaseQueue.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+DeferredReleaseQueue::DeferredReleaseQueue() :
+    m_releasedCount(0)
+{
+}
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+    try
+    {
+        ReleaseAll();
+    }
+    catch (...)
+    {
+        // Too late to report it; the remaining objects are dropped with the queue.
+    }
+}
+
+void DeferredReleaseQueue::Retire(uint64_t fenceValue, ReleaseFunction release)
+{
+    if (!release)
+    {
+        throw std::runtime_error("DeferredReleaseQueue: empty release function");
+    }
+
+    // The fence values only grow with a single queue, so this is almost always an append.
+    PendingRelease pending = { fenceValue, std::move(release) };
+    if (m_pending.empty() || m_pending.back().fenceValue <= fenceValue)
+    {
+        m_pending.push_back(std::move(pending));
+    }
+    else
+    {
+        const auto position = std::upper_bound(m_pending.begin(), m_pending.end(), fenceValue,
+            [](uint64_t value, const PendingRelease& other) { return value < other.fenceValue; });
+        m_pending.insert(position, std::move(pending));
+    }
+}
+
+uint32_t DeferredReleaseQueue::ReleaseCompleted(uint64_t completedFenceValue)
+{
+    uint32_t releasedCount = 0;
+    while (!m_pending.empty() && m_pending.front().fenceValue <= completedFenceValue)
+    {
+        // Out of the queue first, so that the release function can retire objects and
+        // that an exception leaves the queue consistent.
+        ReleaseFunction release = std::move(m_pending.front().release);
+        m_pending.pop_front();
+        ++releasedCount;
+        ++m_releasedCount;
+        release();
+    }
+    return releasedCount;
+}
+
+uint32_t DeferredReleaseQueue::ReleaseAll()
+{
+    uint32_t releasedCount = 0;
+    while (!m_pending.empty())
+    {
+        releasedCount += ReleaseCompleted(m_pending.back().fenceValue);
+    }
+    return releasedCount;
+}
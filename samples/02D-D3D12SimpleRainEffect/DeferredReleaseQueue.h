@@ -0,0 +1,66 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Holds the objects that the GPU may still use until the fence value they were retired
+// with completes, so that they can be replaced at runtime without waiting for the GPU.
+// The fence value to retire an object with is the one that the queue signals after the
+// last command list that uses it. The objects are released in the order of their fence
+// values, and in the order they were retired for the same value.
+class DeferredReleaseQueue
+{
+public:
+    typedef std::function<void()> ReleaseFunction;
+
+    DeferredReleaseQueue();
+
+    // Releases what is left: the owner waits for the GPU before destroying the queue.
+    ~DeferredReleaseQueue();
+
+    DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+    DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+
+    // Calls release once fenceValue completes.
+    void Retire(uint64_t fenceValue, ReleaseFunction release);
+
+    // Keeps a reference to object, such as a ComPtr, until fenceValue completes.
+    template <typename T>
+    void RetireObject(uint64_t fenceValue, const T& object)
+    {
+        Retire(fenceValue, [object]() {});
+    }
+
+    // Releases the objects whose fence value is completed, and returns how many.
+    // A release function may retire other objects.
+    uint32_t ReleaseCompleted(uint64_t completedFenceValue);
+
+    // Releases all the objects, once the GPU is idle.
+    uint32_t ReleaseAll();
+
+    size_t GetPendingCount() const      { return m_pending.size(); }
+    uint64_t GetReleasedCount() const   { return m_releasedCount; }
+
+private:
+    struct PendingRelease
+    {
+        uint64_t fenceValue;
+        ReleaseFunction release;
+    };
+
+    std::deque<PendingRelease> m_pending;   // Sorted by fence value.
+    uint64_t m_releasedCount;
+};
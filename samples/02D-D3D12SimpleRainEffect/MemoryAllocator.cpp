@@ -0,0 +1,484 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+namespace
+{
+    uint32_t FloorLog2(uint64_t value)
+    {
+        uint32_t log2 = 0;
+        for (uint32_t shift = 32; shift > 0; shift /= 2)
+        {
+            if (value >> shift)
+            {
+                value >>= shift;
+                log2 += shift;
+            }
+        }
+        return log2;
+    }
+
+    // The value must not be 0.
+    uint32_t CountTrailingZeros(uint64_t value)
+    {
+        return FloorLog2(value & (0 - value));
+    }
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t size) :
+    m_size(size),
+    m_allocatedBytes(0),
+    m_allocationCount(0),
+    m_freeNodeCount(0),
+    m_firstLevelBitmap(0),
+    m_secondLevelBitmaps{}
+{
+    for (uint32_t firstLevel = 0; firstLevel < FirstLevelCount; ++firstLevel)
+    {
+        for (uint32_t secondLevel = 0; secondLevel < SecondLevelCount; ++secondLevel)
+        {
+            m_freeLists[firstLevel][secondLevel] = InvalidNode;
+        }
+    }
+    if (size > 0)
+    {
+        InsertFreeNode(CreateNode(0, size, InvalidNode, InvalidNode));
+    }
+}
+
+uint32_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t* pOffset)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::runtime_error("TlsfAllocator: the alignment must be a power of two");
+    }
+    size = (std::max)(size, static_cast<uint64_t>(1));
+    if (size > m_size)
+    {
+        return InvalidHandle;
+    }
+
+    // A free range of the size is usually aligned already, when all the allocations
+    // share the same alignment; otherwise, look for one with room for the padding.
+    uint32_t node = FindFreeNode(size);
+    if (node == InvalidNode || AlignUp(m_nodes[node].offset, alignment) + size > m_nodes[node].offset + m_nodes[node].size)
+    {
+        node = alignment - 1 <= m_size - size ? FindFreeNode(size + alignment - 1) : InvalidNode;
+        if (node == InvalidNode)
+        {
+            return InvalidHandle;
+        }
+    }
+    RemoveFreeNode(node);
+
+    // Free the padding in front, then what's left after the allocation. The neighbours
+    // of a free range are never free, so there is nothing to merge them with.
+    const uint64_t padding = AlignUp(m_nodes[node].offset, alignment) - m_nodes[node].offset;
+    if (padding > 0)
+    {
+        const uint32_t front = CreateNode(m_nodes[node].offset, padding, m_nodes[node].previousPhysical, node);
+        if (m_nodes[front].previousPhysical != InvalidNode)
+        {
+            m_nodes[m_nodes[front].previousPhysical].nextPhysical = front;
+        }
+        m_nodes[node].previousPhysical = front;
+        m_nodes[node].offset += padding;
+        m_nodes[node].size -= padding;
+        InsertFreeNode(front);
+    }
+    if (m_nodes[node].size > size)
+    {
+        const uint32_t back = CreateNode(m_nodes[node].offset + size, m_nodes[node].size - size, node, m_nodes[node].nextPhysical);
+        if (m_nodes[back].nextPhysical != InvalidNode)
+        {
+            m_nodes[m_nodes[back].nextPhysical].previousPhysical = back;
+        }
+        m_nodes[node].nextPhysical = back;
+        m_nodes[node].size = size;
+        InsertFreeNode(back);
+    }
+
+    m_allocatedBytes += size;
+    ++m_allocationCount;
+    *pOffset = m_nodes[node].offset;
+    return node;
+}
+
+void TlsfAllocator::Free(uint32_t handle)
+{
+    if (handle >= m_nodes.size() || !m_nodes[handle].isAllocated || m_nodes[handle].isFree)
+    {
+        throw std::runtime_error("TlsfAllocator: invalid handle, or freed twice");
+    }
+
+    uint32_t node = handle;
+    m_allocatedBytes -= m_nodes[node].size;
+    --m_allocationCount;
+
+    // Merge with the free neighbours.
+    const uint32_t previous = m_nodes[node].previousPhysical;
+    if (previous != InvalidNode && m_nodes[previous].isFree)
+    {
+        RemoveFreeNode(previous);
+        m_nodes[previous].size += m_nodes[node].size;
+        m_nodes[previous].nextPhysical = m_nodes[node].nextPhysical;
+        if (m_nodes[node].nextPhysical != InvalidNode)
+        {
+            m_nodes[m_nodes[node].nextPhysical].previousPhysical = previous;
+        }
+        DestroyNode(node);
+        node = previous;
+    }
+    const uint32_t next = m_nodes[node].nextPhysical;
+    if (next != InvalidNode && m_nodes[next].isFree)
+    {
+        RemoveFreeNode(next);
+        m_nodes[node].size += m_nodes[next].size;
+        m_nodes[node].nextPhysical = m_nodes[next].nextPhysical;
+        if (m_nodes[next].nextPhysical != InvalidNode)
+        {
+            m_nodes[m_nodes[next].nextPhysical].previousPhysical = node;
+        }
+        DestroyNode(next);
+    }
+    InsertFreeNode(node);
+}
+
+MemoryStats TlsfAllocator::GetStats() const
+{
+    MemoryStats stats = {};
+    stats.blockCount = 1;
+    stats.allocationCount = m_allocationCount;
+    stats.freeRangeCount = m_freeNodeCount;
+    stats.reservedBytes = m_size;
+    stats.allocatedBytes = m_allocatedBytes;
+
+    // The largest free range is in the highest non-empty list.
+    if (m_firstLevelBitmap != 0)
+    {
+        const uint32_t firstLevel = FloorLog2(m_firstLevelBitmap);
+        const uint32_t secondLevel = FloorLog2(m_secondLevelBitmaps[firstLevel]);
+        for (uint32_t node = m_freeLists[firstLevel][secondLevel]; node != InvalidNode; node = m_nodes[node].nextFree)
+        {
+            stats.largestFreeRange = (std::max)(stats.largestFreeRange, m_nodes[node].size);
+        }
+    }
+    return stats;
+}
+
+// The sizes below 16 have a list each; above, each power of two is split in 16 lists.
+void TlsfAllocator::GetListIndex(uint64_t size, uint32_t* pFirstLevel, uint32_t* pSecondLevel)
+{
+    if (size < SecondLevelCount)
+    {
+        *pFirstLevel = 0;
+        *pSecondLevel = static_cast<uint32_t>(size);
+    }
+    else
+    {
+        const uint32_t log2 = FloorLog2(size);
+        *pFirstLevel = log2 - (SecondLevelLog2 - 1);
+        *pSecondLevel = static_cast<uint32_t>(size >> (log2 - SecondLevelLog2)) - SecondLevelCount;
+    }
+}
+
+uint64_t TlsfAllocator::GetFitSize(uint64_t size)
+{
+    if (size < SecondLevelCount)
+    {
+        return size;
+    }
+
+    const uint64_t step = static_cast<uint64_t>(1) << (FloorLog2(size) - SecondLevelLog2);
+    if (size > ~static_cast<uint64_t>(0) - (step - 1))
+    {
+        return 0;
+    }
+    return (size + step - 1) & ~(step - 1);
+}
+
+// Returns a free node at least as large as size, from the first non-empty list whose
+// ranges are all large enough.
+uint32_t TlsfAllocator::FindFreeNode(uint64_t size) const
+{
+    // Round up to the next list, so that any range of the list found is large enough.
+    const uint64_t fitSize = GetFitSize(size);
+    if (fitSize == 0)
+    {
+        return InvalidNode;
+    }
+
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    GetListIndex(fitSize, &firstLevel, &secondLevel);
+
+    uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0)
+    {
+        const uint64_t firstLevelMap = firstLevel + 1 < 64 ? m_firstLevelBitmap & (~static_cast<uint64_t>(0) << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0)
+        {
+            return InvalidNode;
+        }
+        firstLevel = CountTrailingZeros(firstLevelMap);
+        secondLevelMap = m_secondLevelBitmaps[firstLevel];
+    }
+    secondLevel = CountTrailingZeros(secondLevelMap);
+    return m_freeLists[firstLevel][secondLevel];
+}
+
+void TlsfAllocator::InsertFreeNode(uint32_t node)
+{
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    GetListIndex(m_nodes[node].size, &firstLevel, &secondLevel);
+
+    const uint32_t head = m_freeLists[firstLevel][secondLevel];
+    m_nodes[node].isFree = true;
+    m_nodes[node].isAllocated = false;
+    m_nodes[node].previousFree = InvalidNode;
+    m_nodes[node].nextFree = head;
+    if (head != InvalidNode)
+    {
+        m_nodes[head].previousFree = node;
+    }
+    m_freeLists[firstLevel][secondLevel] = node;
+    m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    m_firstLevelBitmap |= static_cast<uint64_t>(1) << firstLevel;
+    ++m_freeNodeCount;
+}
+
+// The node leaves its list allocated.
+void TlsfAllocator::RemoveFreeNode(uint32_t node)
+{
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    GetListIndex(m_nodes[node].size, &firstLevel, &secondLevel);
+
+    const uint32_t previous = m_nodes[node].previousFree;
+    const uint32_t next = m_nodes[node].nextFree;
+    if (previous != InvalidNode)
+    {
+        m_nodes[previous].nextFree = next;
+    }
+    else
+    {
+        m_freeLists[firstLevel][secondLevel] = next;
+        if (next == InvalidNode)
+        {
+            m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (m_secondLevelBitmaps[firstLevel] == 0)
+            {
+                m_firstLevelBitmap &= ~(static_cast<uint64_t>(1) << firstLevel);
+            }
+        }
+    }
+    if (next != InvalidNode)
+    {
+        m_nodes[next].previousFree = previous;
+    }
+    m_nodes[node].isFree = false;
+    m_nodes[node].isAllocated = true;
+    --m_freeNodeCount;
+}
+
+uint32_t TlsfAllocator::CreateNode(uint64_t offset, uint64_t size, uint32_t previousPhysical, uint32_t nextPhysical)
+{
+    uint32_t node;
+    if (!m_unusedNodes.empty())
+    {
+        node = m_unusedNodes.back();
+        m_unusedNodes.pop_back();
+    }
+    else
+    {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(Node{});
+    }
+    m_nodes[node] = Node{ offset, size, previousPhysical, nextPhysical, InvalidNode, InvalidNode, false, false };
+    return node;
+}
+
+void TlsfAllocator::DestroyNode(uint32_t node)
+{
+    m_nodes[node].isFree = false;
+    m_nodes[node].isAllocated = false;
+    m_unusedNodes.push_back(node);
+}
+
+BlockAllocator::BlockAllocator() :
+    m_pSource(nullptr),
+    m_blockSize(0),
+    m_emptyBlockCount(0)
+{
+}
+
+BlockAllocator::~BlockAllocator()
+{
+    Reset();
+}
+
+void BlockAllocator::Initialize(MemoryBlockSource* pSource, uint64_t blockSize)
+{
+    if (blockSize == 0)
+    {
+        throw std::runtime_error("BlockAllocator: the blocks must not be empty");
+    }
+    Reset();
+    m_pSource = pSource;
+    m_blockSize = blockSize;
+}
+
+void BlockAllocator::Reset()
+{
+    for (uint32_t index = 0; index < m_blocks.size(); ++index)
+    {
+        if (m_blocks[index].pBlock != nullptr)
+        {
+            m_pSource->DestroyBlock(m_blocks[index].pBlock);
+        }
+    }
+    m_blocks.clear();
+    m_emptyBlockCount = 0;
+}
+
+BlockAllocation BlockAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    if (m_pSource == nullptr)
+    {
+        throw std::runtime_error("BlockAllocator: not initialized");
+    }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::runtime_error("BlockAllocator: the alignment must be a power of two");
+    }
+
+    BlockAllocation allocation = {};
+    allocation.size = (std::max)(size, static_cast<uint64_t>(1));
+
+    // The first block that has room, in the order they were created, which packs the
+    // allocations into the oldest blocks and lets the newer ones empty out.
+    for (uint32_t index = 0; index < m_blocks.size(); ++index)
+    {
+        Block& block = m_blocks[index];
+        if (block.pBlock == nullptr)
+        {
+            continue;
+        }
+        const bool wasEmpty = block.allocator.IsEmpty();
+        allocation.handle = block.allocator.Allocate(allocation.size, alignment, &allocation.offset);
+        if (allocation.handle != TlsfAllocator::InvalidHandle)
+        {
+            m_emptyBlockCount -= wasEmpty ? 1 : 0;
+            allocation.pBlock = block.pBlock;
+            allocation.blockIndex = index;
+            return allocation;
+        }
+    }
+
+    // A new block, in the first free slot. The free range of a new block is aligned, but
+    // the lists only find it for sizes up to the one it's listed under: a block of its
+    // own for a large allocation is sized so that it is found.
+    const uint64_t fitSize = TlsfAllocator::GetFitSize(allocation.size);
+    if (fitSize == 0 || fitSize > ~static_cast<uint64_t>(0) - (alignment - 1))
+    {
+        throw std::bad_alloc();
+    }
+    const uint64_t blockSize = (std::max)(m_blockSize, AlignUp(fitSize, alignment));
+    void* pBlock = m_pSource->CreateBlock(blockSize);
+    if (pBlock == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    uint32_t index = 0;
+    while (index < m_blocks.size() && m_blocks[index].pBlock != nullptr)
+    {
+        ++index;
+    }
+    if (index == m_blocks.size())
+    {
+        m_blocks.push_back(Block{ nullptr, TlsfAllocator(0) });
+    }
+    m_blocks[index].pBlock = pBlock;
+    m_blocks[index].allocator = TlsfAllocator(blockSize);
+
+    allocation.handle = m_blocks[index].allocator.Allocate(allocation.size, alignment, &allocation.offset);
+    if (allocation.handle == TlsfAllocator::InvalidHandle)
+    {
+        DestroyBlock(index);
+        throw std::runtime_error("BlockAllocator: a new block can't hold the allocation");
+    }
+    allocation.pBlock = pBlock;
+    allocation.blockIndex = index;
+    return allocation;
+}
+
+void BlockAllocator::Free(const BlockAllocation& allocation)
+{
+    if (allocation.blockIndex >= m_blocks.size() || m_blocks[allocation.blockIndex].pBlock != allocation.pBlock)
+    {
+        throw std::runtime_error("BlockAllocator: the allocation isn't from this allocator");
+    }
+
+    Block& block = m_blocks[allocation.blockIndex];
+    block.allocator.Free(allocation.handle);
+    if (block.allocator.IsEmpty())
+    {
+        // Keep one empty block of the regular size; the others, and the blocks of the
+        // large allocations, go back to the source.
+        if (m_emptyBlockCount == 0 && block.allocator.GetSize() == m_blockSize)
+        {
+            ++m_emptyBlockCount;
+        }
+        else
+        {
+            DestroyBlock(allocation.blockIndex);
+        }
+    }
+}
+
+MemoryStats BlockAllocator::GetStats() const
+{
+    MemoryStats stats = {};
+    for (const Block& block : m_blocks)
+    {
+        if (block.pBlock == nullptr)
+        {
+            continue;
+        }
+        const MemoryStats blockStats = block.allocator.GetStats();
+        ++stats.blockCount;
+        stats.allocationCount += blockStats.allocationCount;
+        stats.freeRangeCount += blockStats.freeRangeCount;
+        stats.reservedBytes += blockStats.reservedBytes;
+        stats.allocatedBytes += blockStats.allocatedBytes;
+        stats.largestFreeRange = (std::max)(stats.largestFreeRange, blockStats.largestFreeRange);
+    }
+    return stats;
+}
+
+void BlockAllocator::DestroyBlock(uint32_t index)
+{
+    m_pSource->DestroyBlock(m_blocks[index].pBlock);
+    m_blocks[index].pBlock = nullptr;
+    m_blocks[index].allocator = TlsfAllocator(0);
+}
@@ -0,0 +1,161 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Occupancy of a range of memory, or of all the blocks of a BlockAllocator.
+struct MemoryStats
+{
+    uint32_t blockCount;
+    uint32_t allocationCount;
+    uint32_t freeRangeCount;
+    uint64_t reservedBytes;         // Size of the blocks.
+    uint64_t allocatedBytes;        // Including the alignment padding of the allocations.
+    uint64_t largestFreeRange;
+};
+
+// 0 when the free memory is in one range, and close to 1 when it's scattered in ranges
+// too small for the allocations that would fit in the total.
+inline float GetFragmentation(const MemoryStats& stats)
+{
+    const uint64_t freeBytes = stats.reservedBytes - stats.allocatedBytes;
+    return freeBytes > 0 ? 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(freeBytes) : 0.0f;
+}
+
+// Two-level segregated fit allocator of the offsets of a range of memory, which it never
+// touches: the free ranges are kept in lists by size class, a power of two split in 16
+// linear steps, with a bitmap of the non-empty lists. Allocating and freeing take
+// constant time, the adjacent free ranges are merged on free, and an allocation wastes
+// at most 1/16th of the range it's taken from.
+class TlsfAllocator
+{
+public:
+    static const uint32_t InvalidHandle = 0xffffffff;
+
+    explicit TlsfAllocator(uint64_t size);
+
+    // Returns InvalidHandle, without allocating, when no free range can hold the
+    // allocation. The alignment must be a power of two.
+    uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t* pOffset);
+
+    void Free(uint32_t handle);
+
+    uint64_t GetSize() const            { return m_size; }
+    uint64_t GetAllocatedBytes() const  { return m_allocatedBytes; }
+    uint32_t GetAllocationCount() const { return m_allocationCount; }
+    bool IsEmpty() const                { return m_allocationCount == 0; }
+    MemoryStats GetStats() const;
+
+    // Size of the smallest free range that is always found for an allocation of size
+    // bytes: the size rounded up to the start of the next list, by at most 1/16th.
+    // Returns 0 when that doesn't fit in 64 bits.
+    static uint64_t GetFitSize(uint64_t size);
+
+private:
+    static const uint32_t SecondLevelLog2 = 4;
+    static const uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+    static const uint32_t FirstLevelCount = 64 - (SecondLevelLog2 - 1);
+    static const uint32_t InvalidNode = 0xffffffff;
+
+    // A range of the memory, free or allocated, linked to its neighbours in memory and,
+    // when free, to the other free ranges of its list.
+    struct Node
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t previousPhysical;
+        uint32_t nextPhysical;
+        uint32_t previousFree;
+        uint32_t nextFree;
+        bool isFree;
+        bool isAllocated;
+    };
+
+    static void GetListIndex(uint64_t size, uint32_t* pFirstLevel, uint32_t* pSecondLevel);
+    uint32_t FindFreeNode(uint64_t size) const;
+    void InsertFreeNode(uint32_t node);
+    void RemoveFreeNode(uint32_t node);
+    uint32_t CreateNode(uint64_t offset, uint64_t size, uint32_t previousPhysical, uint32_t nextPhysical);
+    void DestroyNode(uint32_t node);
+
+    uint64_t m_size;
+    uint64_t m_allocatedBytes;
+    uint32_t m_allocationCount;
+    uint32_t m_freeNodeCount;
+    uint64_t m_firstLevelBitmap;
+    uint32_t m_secondLevelBitmaps[FirstLevelCount];
+    uint32_t m_freeLists[FirstLevelCount][SecondLevelCount];
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_unusedNodes;
+};
+
+// Where the blocks of a BlockAllocator come from: D3D12 heaps, or buffers.
+class MemoryBlockSource
+{
+public:
+    virtual ~MemoryBlockSource() {}
+
+    // Returns nullptr when out of memory.
+    virtual void* CreateBlock(uint64_t size) = 0;
+    virtual void DestroyBlock(void* pBlock) = 0;
+};
+
+struct BlockAllocation
+{
+    void* pBlock;               // As returned by MemoryBlockSource::CreateBlock().
+    uint64_t offset;            // In the block.
+    uint64_t size;
+    uint32_t blockIndex;
+    uint32_t handle;
+};
+
+// Suballocates from blocks of a fixed size, created when the existing ones are full.
+// Allocations larger than a block get a block of their own. Blocks are destroyed once
+// empty, except for one that is kept to absorb allocation spikes.
+class BlockAllocator
+{
+public:
+    BlockAllocator();
+    ~BlockAllocator();
+
+    BlockAllocator(const BlockAllocator&) = delete;
+    BlockAllocator& operator=(const BlockAllocator&) = delete;
+
+    void Initialize(MemoryBlockSource* pSource, uint64_t blockSize);
+
+    // Destroys all the blocks, even if they still hold allocations.
+    void Reset();
+
+    // Throws std::bad_alloc when the source is out of memory. The alignment must be a
+    // power of two.
+    BlockAllocation Allocate(uint64_t size, uint64_t alignment);
+    void Free(const BlockAllocation& allocation);
+
+    uint64_t GetBlockSize() const       { return m_blockSize; }
+    MemoryStats GetStats() const;
+
+private:
+    struct Block
+    {
+        void* pBlock;           // nullptr for a slot of a destroyed block.
+        TlsfAllocator allocator;
+    };
+
+    void DestroyBlock(uint32_t index);
+
+    MemoryBlockSource* m_pSource;
+    uint64_t m_blockSize;
+    std::vector<Block> m_blocks;
+    uint32_t m_emptyBlockCount;
+};
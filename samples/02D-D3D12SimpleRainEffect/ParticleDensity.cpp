@@ -0,0 +1,172 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ParticleDensity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    float Saturate(float value)
+    {
+        return (std::min)((std::max)(value, 0.0f), 1.0f);
+    }
+}
+
+ParticleDensityController::ParticleDensityController(const ParticleDensityDesc& desc) :
+    m_desc(desc)
+{
+    if (!(desc.budgetMilliseconds > 0.0f) || !(desc.hysteresis >= 0.0f) || desc.hysteresis >= 1.0f ||
+        !(desc.smoothing > 0.0f) || desc.smoothing > 1.0f || desc.framesOverBudget == 0 || desc.framesUnderBudget == 0 ||
+        desc.maxGrowthBackoff == 0 || !(desc.maxDecrease > 0.0f) || desc.maxDecrease >= 1.0f || !(desc.increaseStep > 0.0f) ||
+        !(desc.minDensity > 0.0f) || desc.minDensity > 1.0f || !(desc.maxFadeStep > 0.0f) || !(desc.fadeWidth > 0.0f) ||
+        !(desc.fadeEndDistance > desc.fadeStartDistance) || !(desc.farDensity >= 0.0f) || desc.farDensity > 1.0f)
+    {
+        throw std::runtime_error("ParticleDensityController: invalid settings");
+    }
+    Reset();
+}
+
+float ParticleDensityController::Update(float frameMilliseconds)
+{
+    if (!(frameMilliseconds > 0.0f))
+    {
+        return m_density;
+    }
+
+    m_averageMilliseconds = (m_averageMilliseconds > 0.0f) ?
+        m_averageMilliseconds + m_desc.smoothing * (frameMilliseconds - m_averageMilliseconds) :
+        frameMilliseconds;
+
+    // No decision until the last one shows in the frame times.
+    if (m_framesToSettle > 0)
+    {
+        if (m_density == m_targetDensity)
+        {
+            --m_framesToSettle;
+        }
+    }
+    else if (m_averageMilliseconds > m_desc.budgetMilliseconds)
+    {
+        m_framesUnder = 0;
+        if (++m_framesOver >= m_desc.framesOverBudget && m_targetDensity > m_desc.minDensity)
+        {
+            // The particles are most of the frame: the density drops about as the time
+            // must, then settles from there.
+            const float ratio = (std::max)(m_desc.budgetMilliseconds / m_averageMilliseconds, m_desc.maxDecrease);
+            if (m_lastChangeWasGrowth)
+            {
+                m_framesBeforeGrowth = (std::min)(2 * m_framesBeforeGrowth, m_desc.framesUnderBudget * m_desc.maxGrowthBackoff);
+            }
+            m_failedDensity = m_targetDensity;
+            m_targetDensity = (std::max)(m_targetDensity * ratio, m_desc.minDensity);
+            m_lastChangeWasGrowth = false;
+            m_framesOver = 0;
+            m_framesToSettle = m_desc.settleFrames;
+            ++m_changeCount;
+        }
+    }
+    else if (m_averageMilliseconds < m_desc.budgetMilliseconds * (1.0f - m_desc.hysteresis))
+    {
+        m_framesOver = 0;
+        if (++m_framesUnder >= m_framesBeforeGrowth && m_targetDensity < 1.0f)
+        {
+            // The last growth went past the density that was over budget, and held: the
+            // load went down, and so can the back-off.
+            if (m_lastChangeWasGrowth && m_targetDensity > m_failedDensity)
+            {
+                m_framesBeforeGrowth = m_desc.framesUnderBudget;
+            }
+            m_targetDensity = (std::min)(m_targetDensity + m_desc.increaseStep, 1.0f);
+            m_lastChangeWasGrowth = true;
+            m_framesUnder = 0;
+            m_framesToSettle = m_desc.settleFrames;
+            ++m_changeCount;
+        }
+    }
+    else
+    {
+        m_framesOver = 0;
+        m_framesUnder = 0;
+    }
+
+    // The drawn density fades to the chosen one, and lands on it exactly.
+    const float difference = m_targetDensity - m_density;
+    if (std::fabs(difference) <= m_desc.maxFadeStep)
+    {
+        m_density = m_targetDensity;
+    }
+    else
+    {
+        m_density += (difference > 0.0f) ? m_desc.maxFadeStep : -m_desc.maxFadeStep;
+    }
+    return m_density;
+}
+
+void ParticleDensityController::Reset()
+{
+    m_density = 1.0f;
+    m_targetDensity = 1.0f;
+    m_averageMilliseconds = 0.0f;
+    m_framesOver = 0;
+    m_framesUnder = 0;
+    m_framesToSettle = m_desc.settleFrames;     // The first frames load the scene.
+    m_framesBeforeGrowth = m_desc.framesUnderBudget;
+    m_failedDensity = 1.0f;
+    m_lastChangeWasGrowth = false;
+    m_changeCount = 0;
+}
+
+uint32_t ParticleDensityController::GetActiveCount(uint32_t count) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // The drops of rank (i + 0.5) / count under the threshold nearest the camera, which is
+    // the largest; then fixed up by a drop, to agree with GetDropAlpha() whatever the
+    // rounding.
+    const float threshold = m_density * (1.0f + m_desc.fadeWidth);
+    const float activeCount = std::ceil(threshold * count - 0.5f);
+    uint32_t active = static_cast<uint32_t>((std::min)((std::max)(activeCount, 0.0f), static_cast<float>(count)));
+    while (active < count && GetDropAlpha(active, count, m_desc.fadeStartDistance) > 0.0f)
+    {
+        ++active;
+    }
+    while (active > 0 && GetDropAlpha(active - 1, count, m_desc.fadeStartDistance) == 0.0f)
+    {
+        --active;
+    }
+    return active;
+}
+
+float ParticleDensityController::GetDistanceDensity(float distance) const
+{
+    float t = Saturate((distance - m_desc.fadeStartDistance) / (m_desc.fadeEndDistance - m_desc.fadeStartDistance));
+    t = t * t * (3.0f - 2.0f * t);
+    return 1.0f + (m_desc.farDensity - 1.0f) * t;
+}
+
+float ParticleDensityController::GetDropAlpha(uint32_t index, uint32_t count, float distance) const
+{
+    // At the full density, the threshold is over all the ranks by the fade width, so that
+    // all the drops are opaque; at 0, they are all culled.
+    const float threshold = m_density * GetDistanceDensity(distance) * (1.0f + m_desc.fadeWidth);
+    return Saturate((threshold - GetDropRank(index, count)) / m_desc.fadeWidth);
+}
+
+float ParticleDensityController::GetDropRank(uint32_t index, uint32_t count)
+{
+    return (static_cast<float>(index) + 0.5f) / static_cast<float>(count);
+}
@@ -0,0 +1,111 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Settings of the adaptive density of the particles.
+struct ParticleDensityDesc
+{
+    // Frame time not to go over. Frames between the budget and the budget less the
+    // hysteresis fraction of it leave the density as it is. With vsync, the lower bound
+    // must be over the refresh interval, or the density never comes back.
+    float budgetMilliseconds = 25.0f;
+    float hysteresis = 0.25f;
+
+    // Weight of a frame in the average of the frame times.
+    float smoothing = 0.2f;
+
+    // Frames that the average must stay over the budget before the density drops, and
+    // under the lower bound before it grows; and frames without a change once the drawn
+    // density reaches the chosen one, for the frames in flight to show its effect.
+    uint32_t framesOverBudget = 3;
+    uint32_t framesUnderBudget = 30;
+    uint32_t settleFrames = 6;
+
+    // A drop right after a growth doubles the frames to wait under the lower bound before
+    // the next growth, up to this factor, so that a load on the edge of the band (such as
+    // frames that vsync rounds up to two refresh intervals) tries less and less often.
+    // The wait is back to framesUnderBudget once the density holds past the last drop.
+    uint32_t maxGrowthBackoff = 16;
+
+    // A drop scales the density by the ratio of the budget to the average, but by no less
+    // than maxDecrease; a growth adds increaseStep to it.
+    float maxDecrease = 0.5f;
+    float increaseStep = 0.05f;
+    float minDensity = 0.1f;
+
+    // The drawn density follows the chosen one by at most maxFadeStep a frame, and the
+    // drops fade over fadeWidth of their ranks, so that none of them pops in or out.
+    float maxFadeStep = 0.04f;
+    float fadeWidth = 0.2f;
+
+    // Past fadeStartDistance from the camera, the density goes smoothly down to
+    // farDensity of it at fadeEndDistance.
+    float fadeStartDistance = 40.0f;
+    float fadeEndDistance = 100.0f;
+    float farDensity = 0.25f;
+};
+
+// Picks the density of the particles, the fraction of them that are simulated and drawn,
+// from the frame times, and fades it out with the distance to the camera.
+// Each drop has a rank in [0, 1) from its index, and is drawn when its rank is under the
+// density at its distance, fading in over the ranks just under it: the particles are
+// shuffled, so the first ones of the buffer are spread over the scene, and the ones past
+// GetActiveCount() are invisible and can be skipped altogether.
+// The frame times only move the density when they leave the hysteresis band for several
+// frames in a row: it drops quickly when over budget, and grows slowly back.
+// The shaders compute GetDropAlpha() the same way.
+class ParticleDensityController
+{
+public:
+    explicit ParticleDensityController(const ParticleDensityDesc& desc = ParticleDensityDesc());
+
+    // Takes the time of a frame, and returns the density to draw the next frame with.
+    float Update(float frameMilliseconds);
+
+    // Back to the full density, with no history.
+    void Reset();
+
+    const ParticleDensityDesc& GetDesc() const  { return m_desc; }
+    float GetDensity() const                    { return m_density; }
+    float GetTargetDensity() const              { return m_targetDensity; }
+    float GetAverageMilliseconds() const        { return m_averageMilliseconds; }
+
+    // Number of density changes chosen since the start, to check for oscillations.
+    uint32_t GetChangeCount() const             { return m_changeCount; }
+
+    // First particles of count that can be visible at the density; the others are culled.
+    uint32_t GetActiveCount(uint32_t count) const;
+
+    // Density at a distance from the camera, as a fraction of the density near it.
+    float GetDistanceDensity(float distance) const;
+
+    // Opacity of the drop of index out of count at a distance from the camera, in [0, 1].
+    float GetDropAlpha(uint32_t index, uint32_t count, float distance) const;
+
+    // Rank of the drop of index out of count, in [0, 1).
+    static float GetDropRank(uint32_t index, uint32_t count);
+
+private:
+    ParticleDensityDesc m_desc;
+    float m_density;
+    float m_targetDensity;
+    float m_averageMilliseconds;    // 0 before the first frame.
+    uint32_t m_framesOver;
+    uint32_t m_framesUnder;
+    uint32_t m_framesToSettle;
+    uint32_t m_framesBeforeGrowth;  // Under the lower bound, with the back-off.
+    float m_failedDensity;          // Chosen density of the last drop, before it.
+    bool m_lastChangeWasGrowth;
+    uint32_t m_changeCount;
+};
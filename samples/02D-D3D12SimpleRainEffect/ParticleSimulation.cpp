@@ -0,0 +1,45 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ParticleSimulation.h"
+
+uint32_t GetParticleSimulationGroupCount(uint32_t count)
+{
+    return (count + c_particleSimulationGroupSize - 1) / c_particleSimulationGroupSize;
+}
+
+RainParticle SimulateParticle(const RainParticle& particle, float deltaTime)
+{
+    RainParticle result = particle;
+    result.position[1] -= particle.speed * deltaTime;
+    if (result.position[1] < c_particleBottomHeight)
+    {
+        result.position[1] = c_particleTopHeight;
+    }
+    return result;
+}
+
+void SimulateParticles(const RainParticle* pInput, RainParticle* pOutput, uint32_t count, float deltaTime)
+{
+    // The threads past the last particle of the last group do nothing, as in the shader.
+    const uint32_t groupCount = GetParticleSimulationGroupCount(count);
+    for (uint32_t group = 0; group < groupCount; ++group)
+    {
+        for (uint32_t thread = 0; thread < c_particleSimulationGroupSize; ++thread)
+        {
+            const uint32_t index = group * c_particleSimulationGroupSize + thread;
+            if (index < count)
+            {
+                pOutput[index] = SimulateParticle(pInput[index], deltaTime);
+            }
+        }
+    }
+}
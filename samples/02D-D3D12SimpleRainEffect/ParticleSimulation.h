@@ -0,0 +1,39 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// A rain drop, laid out as the Vertex of the sample and the Particle of SimulateCS.
+struct RainParticle
+{
+    float position[3];
+    float size[2];
+    float speed;
+};
+
+// The drops fall at their speed, and go back to the top once under the bottom.
+static const float c_particleBottomHeight = -50.0f;
+static const float c_particleTopHeight = 50.0f;
+
+// Threads of a thread group of SimulateCS, as its numthreads attribute declares.
+static const uint32_t c_particleSimulationGroupSize = 64;
+
+// Thread groups that SimulateCS is dispatched with to move count particles.
+uint32_t GetParticleSimulationGroupCount(uint32_t count);
+
+// A particle moved by deltaTime seconds.
+RainParticle SimulateParticle(const RainParticle& particle, float deltaTime);
+
+// CPU reference of SimulateCS: moves the first count particles of pInput into pOutput,
+// thread group by thread group, and leaves the others of pOutput as they are.
+void SimulateParticles(const RainParticle* pInput, RainParticle* pOutput, uint32_t count, float deltaTime);
@@ -0,0 +1,262 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ResourceStateTracker.h"
+
+#include <stdexcept>
+
+namespace
+{
+    // True when a resource in state doesn't need a transition to be used in requiredState.
+    bool IsStateIncluded(uint32_t state, uint32_t requiredState)
+    {
+        if (state == requiredState)
+        {
+            return true;
+        }
+        const bool bothReadOnly = (state & ~ResourceStates::ReadOnly) == 0 && (requiredState & ~ResourceStates::ReadOnly) == 0;
+        return bothReadOnly && requiredState != ResourceStates::Common && (state & requiredState) == requiredState;
+    }
+}
+
+void ResourceStateTracker::AddResource(const void* pResource, uint32_t subresourceCount, uint32_t state)
+{
+    for (const TrackedResource& resource : m_resources)
+    {
+        if (resource.pResource == pResource)
+        {
+            throw std::runtime_error("ResourceStateTracker: the resource is already tracked");
+        }
+    }
+    if (subresourceCount == 0)
+    {
+        throw std::runtime_error("ResourceStateTracker: a resource has at least one subresource");
+    }
+
+    TrackedResource resource;
+    resource.pResource = pResource;
+    resource.subresources.assign(subresourceCount, SubresourceState{ state, NoSplit });
+    m_resources.push_back(resource);
+}
+
+void ResourceStateTracker::RemoveResource(const void* pResource)
+{
+    for (size_t i = 0; i < m_resources.size(); ++i)
+    {
+        if (m_resources[i].pResource == pResource)
+        {
+            m_resources.erase(m_resources.begin() + i);
+            return;
+        }
+    }
+}
+
+void ResourceStateTracker::Transition(const void* pResource, uint32_t state, uint32_t subresource)
+{
+    TrackedResource& resource = FindResource(pResource);
+    if (subresource == AllSubresources && !IsUniform(resource))
+    {
+        for (uint32_t i = 0; i < resource.subresources.size(); ++i)
+        {
+            CheckSplitUse(resource, i, state);
+        }
+        for (uint32_t i = 0; i < resource.subresources.size(); ++i)
+        {
+            TransitionSubresource(resource, i, state, BarrierSplit::None);
+        }
+    }
+    else
+    {
+        CheckSplitUse(resource, subresource, state);
+        TransitionSubresource(resource, subresource, state, BarrierSplit::None);
+    }
+}
+
+void ResourceStateTracker::BeginTransition(const void* pResource, uint32_t state, uint32_t subresource)
+{
+    TrackedResource& resource = FindResource(pResource);
+    if (subresource == AllSubresources && !IsUniform(resource))
+    {
+        for (uint32_t i = 0; i < resource.subresources.size(); ++i)
+        {
+            TransitionSubresource(resource, i, state, BarrierSplit::Begin);
+        }
+    }
+    else
+    {
+        TransitionSubresource(resource, subresource, state, BarrierSplit::Begin);
+    }
+}
+
+void ResourceStateTracker::EndSplitTransitions()
+{
+    for (TrackedResource& resource : m_resources)
+    {
+        if (IsUniform(resource))
+        {
+            if (resource.subresources[0].splitState != NoSplit)
+            {
+                TransitionSubresource(resource, AllSubresources, resource.subresources[0].splitState, BarrierSplit::None);
+            }
+            continue;
+        }
+        for (uint32_t i = 0; i < resource.subresources.size(); ++i)
+        {
+            if (resource.subresources[i].splitState != NoSplit)
+            {
+                TransitionSubresource(resource, i, resource.subresources[i].splitState, BarrierSplit::None);
+            }
+        }
+    }
+}
+
+uint32_t ResourceStateTracker::GetState(const void* pResource, uint32_t subresource) const
+{
+    for (const TrackedResource& resource : m_resources)
+    {
+        if (resource.pResource == pResource)
+        {
+            return resource.subresources.at(subresource).state;
+        }
+    }
+    throw std::runtime_error("ResourceStateTracker: the resource isn't tracked");
+}
+
+ResourceStateTracker::TrackedResource& ResourceStateTracker::FindResource(const void* pResource)
+{
+    for (TrackedResource& resource : m_resources)
+    {
+        if (resource.pResource == pResource)
+        {
+            return resource;
+        }
+    }
+    throw std::runtime_error("ResourceStateTracker: the resource isn't tracked");
+}
+
+bool ResourceStateTracker::IsUniform(const TrackedResource& resource) const
+{
+    const SubresourceState& first = resource.subresources[0];
+    for (const SubresourceState& subresource : resource.subresources)
+    {
+        if (subresource.state != first.state || subresource.splitState != first.splitState)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ResourceStateTracker::CheckSplitUse(const TrackedResource& resource, uint32_t subresource, uint32_t state) const
+{
+    if (subresource != AllSubresources && subresource >= resource.subresources.size())
+    {
+        throw std::runtime_error("ResourceStateTracker: invalid subresource");
+    }
+
+    const SubresourceState& current = resource.subresources[subresource == AllSubresources ? 0 : subresource];
+    if (current.splitState == NoSplit || IsStateIncluded(current.splitState, state) || !IsStateIncluded(current.state, state))
+    {
+        return;
+    }
+
+    // A split that began in the same batch of barriers has no commands in between yet.
+    const int pending = FindPendingBarrier(resource.pResource, subresource);
+    if (pending >= 0 && m_pendingBarriers[pending].split == BarrierSplit::Begin)
+    {
+        return;
+    }
+    throw std::runtime_error("ResourceStateTracker: the resource is used in the state that its split transition leaves");
+}
+
+void ResourceStateTracker::TransitionSubresource(TrackedResource& resource, uint32_t subresource, uint32_t state, BarrierSplit split)
+{
+    if (subresource != AllSubresources && subresource >= resource.subresources.size())
+    {
+        throw std::runtime_error("ResourceStateTracker: invalid subresource");
+    }
+
+    // For all the subresources, the first stands for the others, which are updated at the end.
+    SubresourceState& current = resource.subresources[subresource == AllSubresources ? 0 : subresource];
+
+    // Finish the split transition in progress. When it began in the same batch of barriers,
+    // it's dropped, as if it never happened.
+    if (current.splitState != NoSplit)
+    {
+        const int pending = FindPendingBarrier(resource.pResource, subresource);
+        if (pending >= 0 && m_pendingBarriers[pending].split == BarrierSplit::Begin && m_pendingBarriers[pending].subresource == subresource)
+        {
+            m_pendingBarriers.erase(m_pendingBarriers.begin() + pending);
+        }
+        else if (split == BarrierSplit::Begin && current.splitState == state)
+        {
+            return;
+        }
+        else
+        {
+            m_pendingBarriers.push_back(StateBarrier{ resource.pResource, subresource, current.state, current.splitState, BarrierSplit::End });
+            current.state = current.splitState;
+        }
+        current.splitState = NoSplit;
+    }
+
+    if (!IsStateIncluded(current.state, state))
+    {
+        // A transition in the same batch is redirected, or cancelled when it comes back.
+        const int pending = FindPendingBarrier(resource.pResource, subresource);
+        if (pending >= 0 && m_pendingBarriers[pending].split == BarrierSplit::None && m_pendingBarriers[pending].subresource == subresource)
+        {
+            StateBarrier& barrier = m_pendingBarriers[pending];
+            if (IsStateIncluded(barrier.stateBefore, state))
+            {
+                current.state = barrier.stateBefore;
+                m_pendingBarriers.erase(m_pendingBarriers.begin() + pending);
+            }
+            else
+            {
+                barrier.stateAfter = state;
+                current.state = state;
+            }
+        }
+        else if (split == BarrierSplit::Begin)
+        {
+            m_pendingBarriers.push_back(StateBarrier{ resource.pResource, subresource, current.state, state, BarrierSplit::Begin });
+            current.splitState = state;
+        }
+        else
+        {
+            m_pendingBarriers.push_back(StateBarrier{ resource.pResource, subresource, current.state, state, BarrierSplit::None });
+            current.state = state;
+        }
+    }
+
+    if (subresource == AllSubresources)
+    {
+        for (SubresourceState& other : resource.subresources)
+        {
+            other = current;
+        }
+    }
+}
+
+int ResourceStateTracker::FindPendingBarrier(const void* pResource, uint32_t subresource) const
+{
+    for (int i = static_cast<int>(m_pendingBarriers.size()) - 1; i >= 0; --i)
+    {
+        const StateBarrier& barrier = m_pendingBarriers[i];
+        if (barrier.pResource == pResource &&
+            (barrier.subresource == subresource || barrier.subresource == AllSubresources || subresource == AllSubresources))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,123 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// The resource states, with the values of D3D12_RESOURCE_STATES.
+namespace ResourceStates
+{
+    const uint32_t Common = 0;
+    const uint32_t Present = 0;
+    const uint32_t VertexAndConstantBuffer = 0x1;
+    const uint32_t IndexBuffer = 0x2;
+    const uint32_t RenderTarget = 0x4;
+    const uint32_t UnorderedAccess = 0x8;
+    const uint32_t DepthWrite = 0x10;
+    const uint32_t DepthRead = 0x20;
+    const uint32_t NonPixelShaderResource = 0x40;
+    const uint32_t PixelShaderResource = 0x80;
+    const uint32_t StreamOut = 0x100;
+    const uint32_t IndirectArgument = 0x200;
+    const uint32_t CopyDest = 0x400;
+    const uint32_t CopySource = 0x800;
+    const uint32_t ResolveDest = 0x1000;
+    const uint32_t ResolveSource = 0x2000;
+
+    // The states that only read, which a resource can be in several of at once.
+    const uint32_t ReadOnly = VertexAndConstantBuffer | IndexBuffer | DepthRead | NonPixelShaderResource |
+        PixelShaderResource | IndirectArgument | CopySource | ResolveSource;
+}
+
+enum class BarrierSplit
+{
+    None,
+    Begin,      // The transition may happen while the commands that follow execute...
+    End         // ...and must be done before those that follow this one.
+};
+
+struct StateBarrier
+{
+    const void* pResource;
+    uint32_t subresource;       // ResourceStateTracker::AllSubresources for all of them.
+    uint32_t stateBefore;
+    uint32_t stateAfter;
+    BarrierSplit split;
+};
+
+// Tracks the state of each subresource of the resources it's given, and turns the
+// states that the commands need into transitions.
+// The transitions are queued, and the caller records the pending barriers in one call
+// before the next command that needs them: the transitions that are undone before then
+// cancel out, those that follow each other merge, and a resource in a read state isn't
+// transitioned to a read state it already includes.
+// When the caller knows the next state of a resource early, BeginTransition() starts a
+// split transition, which is ended by the transition to that state. If there are no
+// commands in between, the split collapses into one barrier. The split must begin after
+// the last command that uses the state it leaves: once its barrier is recorded, a
+// transition to that state throws.
+class ResourceStateTracker
+{
+public:
+    static const uint32_t AllSubresources = 0xffffffff;
+
+    void AddResource(const void* pResource, uint32_t subresourceCount, uint32_t state);
+    void RemoveResource(const void* pResource);
+
+    // The state that the next commands need, even when the resource is already in it.
+    void Transition(const void* pResource, uint32_t state, uint32_t subresource = AllSubresources);
+
+    // The state that the resource will be used in next, after other commands.
+    void BeginTransition(const void* pResource, uint32_t state, uint32_t subresource = AllSubresources);
+
+    // Ends the split transitions in progress, as they can't span command lists.
+    void EndSplitTransitions();
+
+    // The caller records the pending barriers, then clears them.
+    const std::vector<StateBarrier>& GetPendingBarriers() const     { return m_pendingBarriers; }
+    void ClearPendingBarriers()                                     { m_pendingBarriers.clear(); }
+
+    // The state once the pending barriers are recorded; the state before a split
+    // transition in progress.
+    uint32_t GetState(const void* pResource, uint32_t subresource = 0) const;
+
+private:
+    static const uint32_t NoSplit = 0xffffffff;
+
+    struct SubresourceState
+    {
+        uint32_t state;
+        uint32_t splitState;    // Where the split transition in progress goes, or NoSplit.
+    };
+
+    struct TrackedResource
+    {
+        const void* pResource;
+        std::vector<SubresourceState> subresources;
+    };
+
+    TrackedResource& FindResource(const void* pResource);
+    bool IsUniform(const TrackedResource& resource) const;
+
+    // Throws when state is one that a recorded split transition of the subresource leaves.
+    void CheckSplitUse(const TrackedResource& resource, uint32_t subresource, uint32_t state) const;
+
+    // Operates on subresource, or on all of them when they are in the same state.
+    void TransitionSubresource(TrackedResource& resource, uint32_t subresource, uint32_t state, BarrierSplit split);
+
+    // The last pending barrier of the resource that applies to the subresource, or -1.
+    int FindPendingBarrier(const void* pResource, uint32_t subresource) const;
+
+    std::vector<TrackedResource> m_resources;
+    std::vector<StateBarrier> m_pendingBarriers;
+};
@@ -0,0 +1,202 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "RenderStats.h"
+
+// Graphics command list that counts draws, state changes and barriers into a RenderStats.
+// It stands in for a ComPtr<ID3D12GraphicsCommandList>: operator-> returns the wrapper
+// itself, so m_commandList->DrawInstanced(...) goes through the counting forwarders below.
+// Only the methods used by the samples are forwarded; use Get() for the rest.
+class StatsCommandList
+{
+public:
+    explicit StatsCommandList(RenderStats& stats) :
+        m_stats(stats),
+        m_pPipelineState(nullptr)
+    {
+    }
+
+    ID3D12GraphicsCommandList* Get() const                      { return m_commandList.Get(); }
+    ID3D12GraphicsCommandList** ReleaseAndGetAddressOf()        { return m_commandList.ReleaseAndGetAddressOf(); }
+    StatsCommandList* operator->()                              { return this; }
+
+    HRESULT Reset(ID3D12CommandAllocator* pAllocator, ID3D12PipelineState* pInitialState)
+    {
+        // The pipeline state isn't inherited from the previous recording.
+        m_pPipelineState = nullptr;
+        if (pInitialState != nullptr)
+        {
+            CountPipelineState(pInitialState);
+        }
+        return m_commandList->Reset(pAllocator, pInitialState);
+    }
+
+    HRESULT Close()
+    {
+        return m_commandList->Close();
+    }
+
+    void SetPipelineState(ID3D12PipelineState* pPipelineState)
+    {
+        CountPipelineState(pPipelineState);
+        m_commandList->SetPipelineState(pPipelineState);
+    }
+
+    void SetGraphicsRootSignature(ID3D12RootSignature* pRootSignature)
+    {
+        m_commandList->SetGraphicsRootSignature(pRootSignature);
+    }
+
+    void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+    {
+        m_stats.Add(RenderCounter::RootConstantBufferBinds);
+        m_commandList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+    }
+
+    void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+    {
+        m_commandList->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+    }
+
+    void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+    {
+        m_commandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+    }
+
+    void SetGraphicsRoot32BitConstant(UINT rootParameterIndex, UINT srcData, UINT destOffsetIn32BitValues)
+    {
+        m_commandList->SetGraphicsRoot32BitConstant(rootParameterIndex, srcData, destOffsetIn32BitValues);
+    }
+
+    void SetComputeRootSignature(ID3D12RootSignature* pRootSignature)
+    {
+        m_commandList->SetComputeRootSignature(pRootSignature);
+    }
+
+    void SetComputeRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* pSrcData, UINT destOffsetIn32BitValues)
+    {
+        m_commandList->SetComputeRoot32BitConstants(rootParameterIndex, num32BitValuesToSet, pSrcData, destOffsetIn32BitValues);
+    }
+
+    void SetComputeRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+    {
+        m_commandList->SetComputeRootShaderResourceView(rootParameterIndex, bufferLocation);
+    }
+
+    void SetComputeRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+    {
+        m_commandList->SetComputeRootUnorderedAccessView(rootParameterIndex, bufferLocation);
+    }
+
+    void SetDescriptorHeaps(UINT numDescriptorHeaps, ID3D12DescriptorHeap* const* ppDescriptorHeaps)
+    {
+        m_commandList->SetDescriptorHeaps(numDescriptorHeaps, ppDescriptorHeaps);
+    }
+
+    void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* pBarriers)
+    {
+        m_stats.Add(RenderCounter::ResourceBarriers, numBarriers);
+        m_commandList->ResourceBarrier(numBarriers, pBarriers);
+    }
+
+    void DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation)
+    {
+        m_stats.Add(RenderCounter::DrawCalls);
+        m_stats.Add(RenderCounter::Instances, instanceCount);
+        m_commandList->DrawInstanced(vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation);
+    }
+
+    void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+    {
+        m_stats.Add(RenderCounter::DrawCalls);
+        m_stats.Add(RenderCounter::Instances, instanceCount);
+        m_commandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+    }
+
+    void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ)
+    {
+        m_commandList->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+    }
+
+    void CopyResource(ID3D12Resource* pDstResource, ID3D12Resource* pSrcResource)
+    {
+        m_commandList->CopyResource(pDstResource, pSrcResource);
+    }
+
+    void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* pDst, UINT dstX, UINT dstY, UINT dstZ, const D3D12_TEXTURE_COPY_LOCATION* pSrc, const D3D12_BOX* pSrcBox)
+    {
+        m_commandList->CopyTextureRegion(pDst, dstX, dstY, dstZ, pSrc, pSrcBox);
+    }
+
+    void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* pViewports)
+    {
+        m_commandList->RSSetViewports(numViewports, pViewports);
+    }
+
+    void RSSetScissorRects(UINT numRects, const D3D12_RECT* pRects)
+    {
+        m_commandList->RSSetScissorRects(numRects, pRects);
+    }
+
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology)
+    {
+        m_commandList->IASetPrimitiveTopology(primitiveTopology);
+    }
+
+    void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* pViews)
+    {
+        m_commandList->IASetVertexBuffers(startSlot, numViews, pViews);
+    }
+
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* pView)
+    {
+        m_commandList->IASetIndexBuffer(pView);
+    }
+
+    void SOSetTargets(UINT startSlot, UINT numViews, const D3D12_STREAM_OUTPUT_BUFFER_VIEW* pViews)
+    {
+        m_commandList->SOSetTargets(startSlot, numViews, pViews);
+    }
+
+    void OMSetRenderTargets(UINT numRenderTargetDescriptors, const D3D12_CPU_DESCRIPTOR_HANDLE* pRenderTargetDescriptors,
+        BOOL rtsSingleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilDescriptor)
+    {
+        m_commandList->OMSetRenderTargets(numRenderTargetDescriptors, pRenderTargetDescriptors, rtsSingleHandleToDescriptorRange, pDepthStencilDescriptor);
+    }
+
+    void OMSetStencilRef(UINT stencilRef)
+    {
+        m_commandList->OMSetStencilRef(stencilRef);
+    }
+
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT colorRGBA[4], UINT numRects, const D3D12_RECT* pRects)
+    {
+        m_commandList->ClearRenderTargetView(renderTargetView, colorRGBA, numRects, pRects);
+    }
+
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS clearFlags, FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* pRects)
+    {
+        m_commandList->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil, numRects, pRects);
+    }
+
+private:
+    void CountPipelineState(ID3D12PipelineState* pPipelineState)
+    {
+        m_stats.Add(pPipelineState == m_pPipelineState ? RenderCounter::RedundantPipelineStates : RenderCounter::PipelineStateChanges);
+        m_pPipelineState = pPipelineState;
+    }
+
+    RenderStats& m_stats;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    ID3D12PipelineState* m_pPipelineState;
+};
@@ -0,0 +1,177 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DeferredReleaseQueue.h"
+#include "TestCheck.h"
+
+#include <deque>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    // A fence whose signaled values complete some frames later, in order.
+    class TestFence
+    {
+    public:
+        TestFence() :
+            m_completedValue(0)
+        {
+        }
+
+        void Signal(uint64_t value)             { m_inFlight.push_back(value); }
+        uint64_t GetCompletedValue() const      { return m_completedValue; }
+
+        // Completes the signaled values, but for the last inFlightCount of them.
+        void Advance(size_t inFlightCount)
+        {
+            while (m_inFlight.size() > inFlightCount)
+            {
+                m_completedValue = m_inFlight.front();
+                m_inFlight.pop_front();
+            }
+        }
+
+    private:
+        uint64_t m_completedValue;
+        std::deque<uint64_t> m_inFlight;
+    };
+
+    // Stands for a buffer that the GPU uses until the fence reaches lastUseFenceValue.
+    struct TestResource
+    {
+        TestResource(const TestFence* pFence, uint64_t lastUseFenceValue, bool* pReleased) :
+            pFence(pFence),
+            lastUseFenceValue(lastUseFenceValue),
+            pReleased(pReleased)
+        {
+        }
+
+        ~TestResource()
+        {
+            CHECK(pFence->GetCompletedValue() >= lastUseFenceValue);
+            *pReleased = true;
+        }
+
+        const TestFence* pFence;
+        uint64_t lastUseFenceValue;
+        bool* pReleased;
+    };
+
+    // The frame loop of 02D, with two frames in flight: the buffers replaced during a
+    // frame are retired with the fence value signaled after it, and released once the
+    // GPU is done with them, never before.
+    void TestFrameLoop()
+    {
+        const uint32_t frameCount = 2;
+        TestFence fence;
+        DeferredReleaseQueue queue;
+        uint64_t fenceValues[frameCount] = { 1, 1 };
+        uint32_t frameIndex = 0;
+
+        std::mt19937 random(1);
+        std::vector<std::unique_ptr<bool>> released;
+        std::vector<uint64_t> retiredFenceValues;
+        for (uint32_t frame = 0; frame < 10000; ++frame)
+        {
+            const uint32_t retiredCount = (random() % 4 == 0) ? random() % 3 + 1 : 0;
+            for (uint32_t i = 0; i < retiredCount; ++i)
+            {
+                released.emplace_back(new bool(false));
+                retiredFenceValues.push_back(fenceValues[frameIndex]);
+                const std::shared_ptr<TestResource> resource = std::make_shared<TestResource>(&fence, fenceValues[frameIndex], released.back().get());
+                queue.RetireObject(fenceValues[frameIndex], resource);
+            }
+
+            // MoveToNextFrame(): the GPU is up to a frame behind.
+            const uint64_t currentFenceValue = fenceValues[frameIndex];
+            fence.Signal(currentFenceValue);
+            frameIndex = (frameIndex + 1) % frameCount;
+            fence.Advance(random() % frameCount);
+            if (fence.GetCompletedValue() < fenceValues[frameIndex])
+            {
+                fence.Advance(0);
+            }
+            fenceValues[frameIndex] = currentFenceValue + 1;
+            queue.ReleaseCompleted(fence.GetCompletedValue());
+
+            for (size_t i = 0; i < released.size(); ++i)
+            {
+                CHECK(*released[i] == (retiredFenceValues[i] <= fence.GetCompletedValue()));
+            }
+        }
+
+        // OnDestroy(): the GPU is idle.
+        fence.Advance(0);
+        queue.ReleaseAll();
+        for (const auto& isReleased : released)
+        {
+            CHECK(*isReleased);
+        }
+        CHECK(queue.GetPendingCount() == 0 && queue.GetReleasedCount() == released.size());
+    }
+
+    void TestReleaseOrder()
+    {
+        DeferredReleaseQueue queue;
+        std::vector<int> order;
+        queue.Retire(5, [&] { order.push_back(50); });
+        queue.Retire(5, [&] { order.push_back(51); });
+        queue.Retire(3, [&] { order.push_back(30); });
+        queue.Retire(7, [&]
+        {
+            order.push_back(70);
+            queue.Retire(7, [&] { order.push_back(71); });
+        });
+
+        CHECK(queue.ReleaseCompleted(2) == 0);
+        CHECK(queue.ReleaseCompleted(5) == 3);
+        CHECK((order == std::vector<int>{ 30, 50, 51 }));
+        CHECK(queue.ReleaseCompleted(7) == 2);
+        CHECK((order == std::vector<int>{ 30, 50, 51, 70, 71 }));
+        CHECK(queue.GetPendingCount() == 0 && queue.GetReleasedCount() == 5);
+    }
+
+    // A release function that throws is out of the queue, and the others stay in it.
+    void TestErrors()
+    {
+        DeferredReleaseQueue queue;
+        CHECK_THROWS(queue.Retire(1, DeferredReleaseQueue::ReleaseFunction()));
+
+        bool released = false;
+        queue.Retire(1, [] { throw std::runtime_error("release"); });
+        queue.Retire(2, [&] { released = true; });
+        CHECK_THROWS(queue.ReleaseCompleted(2));
+        CHECK(queue.GetPendingCount() == 1 && !released);
+        CHECK(queue.ReleaseAll() == 1 && released);
+    }
+
+    void TestDestructor()
+    {
+        bool released = false;
+        {
+            DeferredReleaseQueue queue;
+            queue.Retire(100, [&] { released = true; });
+        }
+        CHECK(released);
+    }
+}
+
+int main()
+{
+    TestFrameLoop();
+    TestReleaseOrder();
+    TestErrors();
+    TestDestructor();
+    return 0;
+}
@@ -0,0 +1,329 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MemoryAllocator.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Range
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // Blocks of no memory, whose sizes are kept to check the allocations against.
+    class TestBlockSource : public MemoryBlockSource
+    {
+    public:
+        TestBlockSource() :
+            m_limit(~static_cast<uint64_t>(0)),
+            m_usedBytes(0),
+            m_createdCount(0)
+        {
+        }
+
+        void* CreateBlock(uint64_t size) override
+        {
+            if (m_usedBytes + size > m_limit)
+            {
+                return nullptr;
+            }
+
+            void* pBlock = malloc(1);
+            m_blockSizes[pBlock] = size;
+            m_usedBytes += size;
+            ++m_createdCount;
+            return pBlock;
+        }
+
+        void DestroyBlock(void* pBlock) override
+        {
+            auto it = m_blockSizes.find(pBlock);
+            CHECK(it != m_blockSizes.end());
+            m_usedBytes -= it->second;
+            m_blockSizes.erase(it);
+            free(pBlock);
+        }
+
+        std::map<void*, uint64_t> m_blockSizes;
+        uint64_t m_limit;
+        uint64_t m_usedBytes;
+        uint32_t m_createdCount;
+    };
+
+    bool Overlap(const Range& a, const Range& b)
+    {
+        return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+    }
+
+    void TestTlsfBasics()
+    {
+        uint64_t offset;
+        TlsfAllocator allocator(65536);
+        uint32_t handle = allocator.Allocate(65536, 65536, &offset);
+        CHECK(handle != TlsfAllocator::InvalidHandle && offset == 0);
+        CHECK(allocator.Allocate(1, 1, &offset) == TlsfAllocator::InvalidHandle);
+        allocator.Free(handle);
+
+        // Freed ranges are found again, and merged with their free neighbors.
+        const uint32_t first = allocator.Allocate(100, 4, &offset);
+        const uint32_t second = allocator.Allocate(300, 256, &offset);
+        CHECK(offset == 256);
+        allocator.Free(first);
+        CHECK(allocator.GetStats().freeRangeCount == 2);
+        const uint32_t third = allocator.Allocate(256, 256, &offset);
+        CHECK(offset == 0);
+        allocator.Free(third);
+        allocator.Free(second);
+        CHECK(allocator.IsEmpty() && allocator.GetStats().freeRangeCount == 1);
+
+        CHECK_THROWS(allocator.Allocate(1, 3, &offset));
+        CHECK_THROWS(allocator.Free(first));
+
+        TlsfAllocator large(static_cast<uint64_t>(1) << 62);
+        handle = large.Allocate((static_cast<uint64_t>(1) << 61) + 12345, 1 << 20, &offset);
+        CHECK(handle != TlsfAllocator::InvalidHandle && offset == 0);
+        CHECK(large.Allocate(static_cast<uint64_t>(1) << 61, 1, &offset) == TlsfAllocator::InvalidHandle);
+        CHECK(large.Allocate(~static_cast<uint64_t>(0), 1, &offset) == TlsfAllocator::InvalidHandle);
+    }
+
+    // A free range of the fit size is always found, and the fit size is at most 1/16th
+    // larger than the size.
+    void TestFitSize()
+    {
+        std::mt19937_64 random(3);
+        for (uint32_t i = 0; i < 2000; ++i)
+        {
+            const uint64_t size = (i < 100 ? i : random() % (static_cast<uint64_t>(1) << (random() % 40))) + 1;
+            const uint64_t fitSize = TlsfAllocator::GetFitSize(size);
+            CHECK(fitSize >= size && fitSize - size <= size / 16);
+            CHECK(TlsfAllocator::GetFitSize(fitSize) == fitSize);
+
+            uint64_t offset;
+            TlsfAllocator allocator(fitSize);
+            CHECK(allocator.Allocate(size, 1, &offset) != TlsfAllocator::InvalidHandle);
+        }
+        CHECK(TlsfAllocator::GetFitSize(~static_cast<uint64_t>(0)) == 0);
+    }
+
+    // Random allocations and frees, checked against the live ranges after each call.
+    void TestTlsfFuzz(uint64_t size, uint32_t seed)
+    {
+        std::mt19937_64 random(seed);
+        TlsfAllocator allocator(size);
+        std::map<uint32_t, Range> live;
+        for (uint32_t i = 0; i < 5000; ++i)
+        {
+            if (live.empty() || random() % 100 < 55)
+            {
+                const uint64_t allocationSize = (random() % 8 == 0 ? random() % (size / 4 + 1) : random() % 4096);
+                const uint64_t alignment = static_cast<uint64_t>(1) << (random() % 17);
+                uint64_t offset;
+                const uint32_t handle = allocator.Allocate(allocationSize, alignment, &offset);
+                if (handle == TlsfAllocator::InvalidHandle)
+                {
+                    continue;
+                }
+
+                const Range range = { offset, (std::max)(allocationSize, static_cast<uint64_t>(1)) };
+                CHECK(offset % alignment == 0 && offset + range.size <= size);
+                CHECK(live.find(handle) == live.end());
+                for (const auto& other : live)
+                {
+                    CHECK(!Overlap(range, other.second));
+                }
+                live[handle] = range;
+            }
+            else
+            {
+                auto it = live.begin();
+                std::advance(it, random() % live.size());
+                allocator.Free(it->first);
+                live.erase(it);
+            }
+
+            // The free ranges are the gaps between the allocations.
+            std::map<uint64_t, uint64_t> sorted;
+            uint64_t allocatedBytes = 0;
+            for (const auto& allocation : live)
+            {
+                sorted[allocation.second.offset] = allocation.second.size;
+                allocatedBytes += allocation.second.size;
+            }
+            uint32_t gapCount = 0;
+            uint64_t largestGap = 0;
+            uint64_t cursor = 0;
+            for (const auto& range : sorted)
+            {
+                if (range.first > cursor)
+                {
+                    ++gapCount;
+                    largestGap = (std::max)(largestGap, range.first - cursor);
+                }
+                cursor = range.first + range.second;
+            }
+            if (cursor < size)
+            {
+                ++gapCount;
+                largestGap = (std::max)(largestGap, size - cursor);
+            }
+
+            const MemoryStats stats = allocator.GetStats();
+            CHECK(allocator.GetAllocatedBytes() == allocatedBytes && allocator.GetAllocationCount() == live.size());
+            CHECK(stats.freeRangeCount == gapCount && stats.largestFreeRange == largestGap);
+        }
+
+        for (const auto& allocation : live)
+        {
+            allocator.Free(allocation.first);
+        }
+        const MemoryStats stats = allocator.GetStats();
+        CHECK(allocator.IsEmpty() && stats.freeRangeCount == 1 && stats.largestFreeRange == size);
+        CHECK(GetFragmentation(stats) == 0.0f);
+    }
+
+    void TestBlockAllocator()
+    {
+        TestBlockSource source;
+        {
+            BlockAllocator allocator;
+            CHECK_THROWS(allocator.Allocate(1, 1));
+            allocator.Initialize(&source, 1 << 20);
+            CHECK_THROWS(allocator.Allocate(1, 3));
+
+            // 16 per block.
+            std::vector<BlockAllocation> allocations;
+            for (uint32_t i = 0; i < 100; ++i)
+            {
+                allocations.push_back(allocator.Allocate(64 * 1024, 65536));
+            }
+            CHECK(source.m_blockSizes.size() == 7);
+            CHECK(allocator.GetStats().blockCount == 7 && allocator.GetStats().allocationCount == 100);
+
+            const BlockAllocation large = allocator.Allocate(5 << 20, 65536);
+            CHECK(source.m_blockSizes.size() == 8 && large.offset == 0);
+            allocator.Free(large);
+            CHECK(source.m_blockSizes.size() == 7);
+
+            // One empty block is kept.
+            for (const auto& allocation : allocations)
+            {
+                allocator.Free(allocation);
+            }
+            CHECK(source.m_blockSizes.size() == 1 && allocator.GetStats().allocationCount == 0);
+            allocator.Free(allocator.Allocate(10, 256));
+            CHECK(source.m_createdCount == 8);
+
+            const BlockAllocation first = allocator.Allocate(1 << 20, 1);
+            const BlockAllocation second = allocator.Allocate(1 << 20, 1);
+            CHECK(source.m_blockSizes.size() == 2);
+            allocator.Free(first);
+            allocator.Free(second);
+            CHECK(source.m_blockSizes.size() == 1);
+            CHECK_THROWS(allocator.Free(first));
+
+            source.m_limit = source.m_usedBytes;
+            allocator.Allocate(1 << 20, 1);
+            CHECK_THROWS(allocator.Allocate(1, 1));
+        }
+        CHECK(source.m_blockSizes.empty());
+    }
+
+    // Allocations larger than a block whose size isn't the start of a size list: their
+    // block must still be found by its own lists.
+    void TestDedicatedBlocks()
+    {
+        TestBlockSource source;
+        BlockAllocator allocator;
+        allocator.Initialize(&source, 64 * 1024);
+
+        const BlockAllocation allocation = allocator.Allocate(5000000, 65536);
+        CHECK(allocation.pBlock != nullptr && allocation.offset == 0 && allocation.size == 5000000);
+        CHECK(source.m_blockSizes[allocation.pBlock] >= 5000000);
+        allocator.Free(allocation);
+        CHECK(allocator.GetStats().allocationCount == 0);
+
+        std::mt19937_64 random(11);
+        for (uint32_t i = 0; i < 2000; ++i)
+        {
+            const uint64_t size = 64 * 1024 + random() % (64 << 20);
+            const uint64_t alignment = static_cast<uint64_t>(1) << (random() % 17);
+            const BlockAllocation dedicated = allocator.Allocate(size, alignment);
+            CHECK(dedicated.offset % alignment == 0);
+            CHECK(dedicated.offset + size <= source.m_blockSizes[dedicated.pBlock]);
+            allocator.Free(dedicated);
+        }
+        CHECK(source.m_blockSizes.size() <= 1);
+    }
+
+    // Random allocations of up to a few blocks, checked for overlaps in their blocks.
+    void TestBlockAllocatorFuzz()
+    {
+        TestBlockSource source;
+        BlockAllocator allocator;
+        allocator.Initialize(&source, 1 << 16);
+
+        std::mt19937 random(7);
+        std::vector<BlockAllocation> live;
+        for (uint32_t i = 0; i < 20000; ++i)
+        {
+            if (live.empty() || random() % 2 == 0)
+            {
+                const uint64_t size = (random() % 16 == 0 ? random() % (1 << 18) : random() % 20000) + 1;
+                const uint64_t alignment = static_cast<uint64_t>(1) << (random() % 17);
+                const BlockAllocation allocation = allocator.Allocate(size, alignment);
+                CHECK(allocation.size == size && allocation.offset % alignment == 0);
+                CHECK(allocation.offset + size <= source.m_blockSizes[allocation.pBlock]);
+                for (const auto& other : live)
+                {
+                    CHECK(other.pBlock != allocation.pBlock || !Overlap({ allocation.offset, size }, { other.offset, other.size }));
+                }
+                live.push_back(allocation);
+            }
+            else
+            {
+                const size_t index = random() % live.size();
+                allocator.Free(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            }
+        }
+
+        for (const auto& allocation : live)
+        {
+            allocator.Free(allocation);
+        }
+        CHECK(source.m_blockSizes.size() == 1);
+    }
+}
+
+int main()
+{
+    TestTlsfBasics();
+    TestFitSize();
+    for (uint32_t seed = 1; seed <= 4; ++seed)
+    {
+        TestTlsfFuzz(seed % 2 != 0 ? 1 << 20 : 12345, seed);
+    }
+    TestBlockAllocator();
+    TestDedicatedBlocks();
+    TestBlockAllocatorFuzz();
+    return 0;
+}
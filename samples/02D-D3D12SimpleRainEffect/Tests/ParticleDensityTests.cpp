@@ -0,0 +1,341 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ParticleDensity.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const uint32_t c_dropCount = 16 * 81;
+    const float c_distances[] = { 0.0f, 30.0f, 45.0f, 60.0f, 75.0f, 90.0f, 120.0f };
+
+    // Time of the frames: a fixed part and a part per active drop, with a relative noise,
+    // optionally rounded up to the vsync intervals. The times come back two frames late.
+    class FrameTimeSource
+    {
+    public:
+        FrameTimeSource(float fixedMilliseconds, float allDropsMilliseconds, float noise = 0.0f, bool vsync = false, uint32_t seed = 1) :
+            m_fixedMilliseconds(fixedMilliseconds),
+            m_allDropsMilliseconds(allDropsMilliseconds),
+            m_noise(noise),
+            m_vsync(vsync),
+            m_random(seed)
+        {
+        }
+
+        void SetAllDropsMilliseconds(float milliseconds)   { m_allDropsMilliseconds = milliseconds; }
+
+        // Returns the time measured at the end of the frame.
+        float Frame(uint32_t activeCount)
+        {
+            std::uniform_real_distribution<float> noise(-m_noise, m_noise);
+            float milliseconds = (m_fixedMilliseconds + m_allDropsMilliseconds * activeCount / c_dropCount) * (1.0f + noise(m_random));
+            if (m_vsync)
+            {
+                const float interval = 1000.0f / 60.0f;
+                milliseconds = std::ceil(milliseconds / interval - 1e-4f) * interval;
+            }
+
+            m_inFlight.push_back(milliseconds);
+            const float measured = m_inFlight.front();
+            if (m_inFlight.size() > 2)
+            {
+                m_inFlight.pop_front();
+            }
+            return measured;
+        }
+
+    private:
+        float m_fixedMilliseconds;
+        float m_allDropsMilliseconds;
+        float m_noise;
+        bool m_vsync;
+        std::mt19937 m_random;
+        std::deque<float> m_inFlight;
+    };
+
+    struct RunResults
+    {
+        std::vector<float> densities;
+        std::vector<float> milliseconds;
+        std::vector<uint32_t> changeCounts;
+        float largestAlphaStep;     // Of a drop at a distance, from a frame to the next.
+        bool cullingExact;          // The drops past GetActiveCount() are all invisible, and the last active one isn't.
+    };
+
+    RunResults Run(ParticleDensityController& controller, FrameTimeSource& source, uint32_t frameCount, bool checkDrops = true)
+    {
+        RunResults results;
+        results.largestAlphaStep = 0.0f;
+        results.cullingExact = true;
+
+        std::vector<float> previousAlphas;
+        std::vector<float> alphas;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            const float milliseconds = source.Frame(controller.GetActiveCount(c_dropCount));
+            controller.Update(milliseconds);
+            results.densities.push_back(controller.GetDensity());
+            results.milliseconds.push_back(milliseconds);
+            results.changeCounts.push_back(controller.GetChangeCount());
+            if (!checkDrops)
+            {
+                continue;
+            }
+
+            // The opacity decreases with the rank and the distance, so the drops nearest
+            // the camera on either side of the active count are enough to check the culling.
+            const uint32_t activeCount = controller.GetActiveCount(c_dropCount);
+            results.cullingExact = results.cullingExact &&
+                (activeCount == c_dropCount || controller.GetDropAlpha(activeCount, c_dropCount, 0.0f) == 0.0f) &&
+                (activeCount == 0 || controller.GetDropAlpha(activeCount - 1, c_dropCount, 0.0f) > 0.0f);
+
+            alphas.clear();
+            for (uint32_t i = 0; i < c_dropCount; i += 3)
+            {
+                for (float distance : c_distances)
+                {
+                    alphas.push_back(controller.GetDropAlpha(i, c_dropCount, distance));
+                }
+            }
+            for (size_t k = 0; k < previousAlphas.size(); ++k)
+            {
+                results.largestAlphaStep = (std::max)(results.largestAlphaStep, std::fabs(alphas[k] - previousAlphas[k]));
+            }
+            previousAlphas.swap(alphas);
+        }
+        return results;
+    }
+
+    float Mean(const std::vector<float>& values, size_t first, size_t last)
+    {
+        double sum = 0.0;
+        for (size_t i = first; i < last; ++i)
+        {
+            sum += values[i];
+        }
+        return static_cast<float>(sum / (last - first));
+    }
+
+    // Largest change of a drop's opacity from a frame to the next, when the density moves
+    // by maxFadeStep.
+    float GetFadeBound(const ParticleDensityDesc& desc)
+    {
+        return desc.maxFadeStep * (1.0f + desc.fadeWidth) / desc.fadeWidth + 1e-4f;
+    }
+
+    // Light loads, and loads within the hysteresis band even when noisy, leave the
+    // density full.
+    void TestStableLoads()
+    {
+        ParticleDensityController light;
+        FrameTimeSource lightSource(4.0f, 8.0f);
+        Run(light, lightSource, 600, false);
+        CHECK(light.GetDensity() == 1.0f && light.GetChangeCount() == 0);
+
+        ParticleDensityController inBand;
+        FrameTimeSource inBandSource(5.0f, 17.0f, 0.05f);
+        Run(inBand, inBandSource, 3000, false);
+        CHECK(inBand.GetDensity() == 1.0f && inBand.GetChangeCount() == 0);
+    }
+
+    // An overload goes under the budget within a second, then holds, and no drop pops.
+    void TestOverload()
+    {
+        const ParticleDensityDesc desc;
+        ParticleDensityController controller;
+        FrameTimeSource source(5.0f, 35.0f);
+        const RunResults results = Run(controller, source, 3000);
+
+        size_t lastFrameOverBudget = 0;
+        for (size_t i = 0; i < results.milliseconds.size(); ++i)
+        {
+            lastFrameOverBudget = (results.milliseconds[i] > desc.budgetMilliseconds) ? i + 1 : lastFrameOverBudget;
+        }
+        CHECK(lastFrameOverBudget < 90);
+        CHECK(results.changeCounts.back() == results.changeCounts[600]);
+        CHECK(results.densities.back() >= 0.39f && results.densities.back() <= 0.572f);
+        CHECK(results.largestAlphaStep <= GetFadeBound(desc));
+        CHECK(results.cullingExact);
+    }
+
+    void TestNoisyOverload()
+    {
+        const ParticleDensityDesc desc;
+        ParticleDensityController controller;
+        FrameTimeSource source(5.0f, 35.0f, 0.15f, false, 7);
+        const RunResults results = Run(controller, source, 6000);
+        CHECK(Mean(results.milliseconds, 1000, 6000) <= desc.budgetMilliseconds);
+        CHECK(results.changeCounts.back() - results.changeCounts[1000] <= 10);
+        CHECK(results.largestAlphaStep <= GetFadeBound(desc));
+        CHECK(results.cullingExact);
+    }
+
+    // The load goes up, then back down: the density drops, then comes back to full.
+    void TestLoadStep()
+    {
+        const ParticleDensityDesc desc;
+        ParticleDensityController controller;
+        FrameTimeSource source(5.0f, 10.0f);
+        const RunResults before = Run(controller, source, 300);
+        source.SetAllDropsMilliseconds(60.0f);
+        const RunResults during = Run(controller, source, 600);
+        const float lowDensity = controller.GetDensity();
+        source.SetAllDropsMilliseconds(10.0f);
+        const RunResults after = Run(controller, source, 2000);
+
+        CHECK(before.densities.back() == 1.0f);
+        CHECK(lowDensity < 0.35f);
+        CHECK(*std::max_element(during.milliseconds.begin() + 300, during.milliseconds.end()) <= desc.budgetMilliseconds);
+        const auto recovered = std::find(after.densities.begin(), after.densities.end(), 1.0f);
+        CHECK(recovered != after.densities.end() && after.densities.back() == 1.0f);
+        CHECK((std::max)(during.largestAlphaStep, after.largestAlphaStep) <= GetFadeBound(desc));
+        CHECK(during.cullingExact && after.cullingExact);
+    }
+
+    // Vsync rounds the frames up to 16.7 or 33.3 ms: on the edge of the band, the growths
+    // are tried less and less often.
+    void TestVsyncBackoff()
+    {
+        const ParticleDensityDesc desc;
+        ParticleDensityController controller;
+        FrameTimeSource source(5.0f, 15.0f, 0.0f, true);
+        const RunResults results = Run(controller, source, 12000, false);
+
+        const uint32_t earlyChanges = results.changeCounts[2000];
+        const uint32_t lateChanges = results.changeCounts[11999] - results.changeCounts[9999];
+        const size_t framesOverBudget = std::count_if(results.milliseconds.begin(), results.milliseconds.end(),
+            [&](float milliseconds) { return milliseconds > desc.budgetMilliseconds; });
+        CHECK(lateChanges * 2 <= earlyChanges);
+        CHECK(framesOverBudget < results.milliseconds.size() / 50);
+    }
+
+    // Full near the camera, farDensity far away, smooth and decreasing in between.
+    void TestDistanceFade()
+    {
+        const ParticleDensityDesc desc;
+        ParticleDensityController full;
+        CHECK(full.GetDistanceDensity(0.0f) == 1.0f && full.GetDistanceDensity(desc.fadeStartDistance) == 1.0f);
+        CHECK(std::fabs(full.GetDistanceDensity(desc.fadeEndDistance) - desc.farDensity) < 1e-6f);
+        CHECK(std::fabs(full.GetDistanceDensity(500.0f) - desc.farDensity) < 1e-6f);
+
+        float previous = 1.0f;
+        float largestSlope = 0.0f;
+        for (uint32_t i = 0; i <= 15000; ++i)
+        {
+            const float density = full.GetDistanceDensity(i * 0.01f);
+            CHECK(density <= previous + 1e-6f);
+            largestSlope = (std::max)(largestSlope, (previous - density) / 0.01f);
+            previous = density;
+        }
+        // A smoothstep peaks at 1.5 times its mean slope.
+        CHECK(largestSlope <= 1.5f * (1.0f - desc.farDensity) / (desc.fadeEndDistance - desc.fadeStartDistance) * 1.01f);
+
+        // The visible fraction of the drops follows the density at each distance.
+        ParticleDensityController reduced;
+        FrameTimeSource source(5.0f, 60.0f);
+        Run(reduced, source, 400, false);
+        CHECK(reduced.GetDensity() < 1.0f);
+        for (const ParticleDensityController* pController : { &full, &reduced })
+        {
+            for (float distance : c_distances)
+            {
+                double sum = 0.0;
+                for (uint32_t i = 0; i < c_dropCount; ++i)
+                {
+                    sum += pController->GetDropAlpha(i, c_dropCount, distance);
+                }
+                const float visible = static_cast<float>(sum / c_dropCount);
+                const float threshold = pController->GetDensity() * pController->GetDistanceDensity(distance) * (1.0f + desc.fadeWidth);
+                CHECK(visible <= threshold + 1e-3f);
+                CHECK(visible >= threshold - 0.5f * desc.fadeWidth - 1e-3f || visible >= 0.999f);
+            }
+        }
+
+        // A falling drop moves less than a unit a frame, and fades smoothly.
+        float largestStep = 0.0f;
+        for (uint32_t i = 0; i < c_dropCount; i += 7)
+        {
+            for (float distance = 0.0f; distance < 150.0f; distance += 0.9f)
+            {
+                largestStep = (std::max)(largestStep, std::fabs(reduced.GetDropAlpha(i, c_dropCount, distance + 0.9f) - reduced.GetDropAlpha(i, c_dropCount, distance)));
+            }
+        }
+        CHECK(largestStep < 0.15f);
+    }
+
+    void TestCounts()
+    {
+        ParticleDensityController controller;
+        CHECK(controller.GetActiveCount(c_dropCount) == c_dropCount);
+        CHECK(controller.GetActiveCount(0) == 0 && controller.GetActiveCount(1) == 1);
+        for (uint32_t i = 0; i < c_dropCount; ++i)
+        {
+            CHECK(controller.GetDropAlpha(i, c_dropCount, 0.0f) == 1.0f);
+        }
+        CHECK(ParticleDensityController::GetDropRank(0, 4) == 0.125f && ParticleDensityController::GetDropRank(3, 4) == 0.875f);
+    }
+
+    // The same frame times give the same densities, and frames without a time keep it.
+    void TestDeterminism()
+    {
+        ParticleDensityController first;
+        ParticleDensityController second;
+        FrameTimeSource firstSource(5.0f, 35.0f, 0.15f, false, 3);
+        FrameTimeSource secondSource(5.0f, 35.0f, 0.15f, false, 3);
+        CHECK(Run(first, firstSource, 1000, false).densities == Run(second, secondSource, 1000, false).densities);
+
+        const float density = first.GetDensity();
+        CHECK(first.Update(0.0f) == density && first.Update(-1.0f) == density);
+        first.Reset();
+        CHECK(first.GetDensity() == 1.0f && first.GetChangeCount() == 0);
+    }
+
+    void TestSettings()
+    {
+        float ParticleDensityDesc::* const fields[] =
+        {
+            &ParticleDensityDesc::budgetMilliseconds, &ParticleDensityDesc::smoothing, &ParticleDensityDesc::maxDecrease,
+            &ParticleDensityDesc::increaseStep, &ParticleDensityDesc::minDensity, &ParticleDensityDesc::maxFadeStep,
+            &ParticleDensityDesc::fadeWidth
+        };
+        for (auto field : fields)
+        {
+            ParticleDensityDesc desc;
+            desc.*field = 0.0f;
+            CHECK_THROWS(ParticleDensityController controller(desc));
+        }
+
+        ParticleDensityDesc desc;
+        desc.fadeEndDistance = desc.fadeStartDistance;
+        CHECK_THROWS(ParticleDensityController controller(desc));
+    }
+}
+
+int main()
+{
+    TestStableLoads();
+    TestOverload();
+    TestNoisyOverload();
+    TestLoadStep();
+    TestVsyncBackoff();
+    TestDistanceFade();
+    TestCounts();
+    TestDeterminism();
+    TestSettings();
+    return 0;
+}
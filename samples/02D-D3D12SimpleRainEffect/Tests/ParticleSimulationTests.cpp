@@ -0,0 +1,152 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ParticleSimulation.h"
+#include "TestCheck.h"
+
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    bool IsSame(const RainParticle& a, const RainParticle& b)
+    {
+        return memcmp(&a, &b, sizeof(RainParticle)) == 0;
+    }
+
+    // Particles marking the entries of an output buffer that a step must not write.
+    RainParticle GetUnwrittenParticle()
+    {
+        return RainParticle{ { -1.0f, -2.0f, -3.0f }, { -4.0f, -5.0f }, -6.0f };
+    }
+
+    // The drops of the sample: layers of 9 * 9 at the middle height, with random speeds.
+    std::vector<RainParticle> CreateParticles(uint32_t layerCount)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> speed(100.0f, 300.0f);
+        std::vector<RainParticle> particles;
+        for (uint32_t layer = 0; layer < layerCount; ++layer)
+        {
+            for (uint32_t i = 0; i < 81; ++i)
+            {
+                particles.push_back(RainParticle{ { i % 9 * 5.0f - 20.0f, 0.0f, i / 9 * 5.0f - 20.0f }, { 0.05f, 5.0f }, speed(random) });
+            }
+        }
+        return particles;
+    }
+
+    void TestLayout()
+    {
+        // The stride of the vertex buffer and of the structured buffers of SimulateCS.
+        CHECK(sizeof(RainParticle) == 6 * sizeof(float));
+        CHECK(offsetof(RainParticle, size) == 3 * sizeof(float));
+        CHECK(offsetof(RainParticle, speed) == 5 * sizeof(float));
+    }
+
+    void TestGroupCount()
+    {
+        CHECK(GetParticleSimulationGroupCount(0) == 0);
+        CHECK(GetParticleSimulationGroupCount(1) == 1);
+        CHECK(GetParticleSimulationGroupCount(c_particleSimulationGroupSize) == 1);
+        CHECK(GetParticleSimulationGroupCount(c_particleSimulationGroupSize + 1) == 2);
+        CHECK(GetParticleSimulationGroupCount(16 * 81) == 21);
+    }
+
+    void TestFallAndReset()
+    {
+        const RainParticle particle = { { 1.0f, 10.0f, 2.0f }, { 0.05f, 5.0f }, 100.0f };
+        const RainParticle moved = SimulateParticle(particle, 0.01f);
+        CHECK(moved.position[1] == 9.0f);
+        CHECK(moved.position[0] == 1.0f && moved.position[2] == 2.0f);
+        CHECK(moved.size[0] == 0.05f && moved.size[1] == 5.0f && moved.speed == 100.0f);
+
+        // The drops go back to the top only once strictly under the bottom.
+        RainParticle low = particle;
+        low.position[1] = c_particleBottomHeight + 1.0f;
+        CHECK(SimulateParticle(low, 0.01f).position[1] == c_particleBottomHeight);
+        low.position[1] = c_particleBottomHeight;
+        CHECK(SimulateParticle(low, 0.01f).position[1] == c_particleTopHeight);
+        CHECK(SimulateParticle(low, 0.0f).position[1] == c_particleBottomHeight);
+    }
+
+    // Only the first count particles are written, including in a partial last group.
+    void TestSimulateParticles()
+    {
+        const std::vector<RainParticle> input = CreateParticles(3);
+        const uint32_t c_counts[] = { 0, 1, 63, 64, 65, 129, static_cast<uint32_t>(input.size()) };
+        for (uint32_t count : c_counts)
+        {
+            std::vector<RainParticle> output(input.size(), GetUnwrittenParticle());
+            SimulateParticles(input.data(), output.data(), count, 0.02f);
+            for (uint32_t i = 0; i < output.size(); ++i)
+            {
+                CHECK(IsSame(output[i], i < count ? SimulateParticle(input[i], 0.02f) : GetUnwrittenParticle()));
+            }
+        }
+    }
+
+    // The steps of the sample: from the vertex buffer into the first particle buffer, and
+    // then from each particle buffer into the other one. The first two steps move all the
+    // particles, so that the inactive ones of the later steps are in both buffers, where
+    // the step leaves them as they were.
+    void TestSteps()
+    {
+        const std::vector<RainParticle> initial = CreateParticles(16);
+        const uint32_t particleCount = static_cast<uint32_t>(initial.size());
+
+        std::vector<RainParticle> buffers[2] =
+        {
+            std::vector<RainParticle>(particleCount, GetUnwrittenParticle()),
+            std::vector<RainParticle>(particleCount, GetUnwrittenParticle()),
+        };
+        std::vector<RainParticle> expected(particleCount);
+        std::mt19937 random(2);
+        std::uniform_real_distribution<float> deltaTime(0.001f, 0.05f);
+        std::uniform_int_distribution<uint32_t> activeCount(0, particleCount);
+
+        const RainParticle* pSource = initial.data();
+        uint32_t bufferIndex = 0;
+        for (uint32_t step = 0; step < 200; ++step)
+        {
+            const uint32_t count = step < 2 ? particleCount : activeCount(random);
+            const float dt = deltaTime(random);
+            const std::vector<RainParticle> previous = buffers[bufferIndex];
+            SimulateParticles(pSource, buffers[bufferIndex].data(), count, dt);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                expected[i] = SimulateParticle(pSource[i], dt);
+            }
+
+            for (uint32_t i = 0; i < particleCount; ++i)
+            {
+                CHECK(IsSame(buffers[bufferIndex][i], i < count ? expected[i] : previous[i]));
+                CHECK(buffers[bufferIndex][i].position[1] >= c_particleBottomHeight);
+                CHECK(buffers[bufferIndex][i].position[1] <= c_particleTopHeight);
+            }
+
+            pSource = buffers[bufferIndex].data();
+            bufferIndex = (bufferIndex + 1) % 2;
+        }
+    }
+}
+
+int main()
+{
+    TestLayout();
+    TestGroupCount();
+    TestFallAndReset();
+    TestSimulateParticles();
+    TestSteps();
+    return 0;
+}
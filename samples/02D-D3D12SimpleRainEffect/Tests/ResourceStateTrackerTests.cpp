@@ -0,0 +1,316 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ResourceStateTracker.h"
+#include "TestCheck.h"
+
+#include <random>
+#include <vector>
+
+using namespace ResourceStates;
+
+namespace
+{
+    const uint32_t All = ResourceStateTracker::AllSubresources;
+
+    StateBarrier Barrier(const void* pResource, uint32_t stateBefore, uint32_t stateAfter, BarrierSplit split = BarrierSplit::None, uint32_t subresource = All)
+    {
+        return StateBarrier{ pResource, subresource, stateBefore, stateAfter, split };
+    }
+
+    // Takes the pending barriers, as FlushBarriers() records them, and compares them
+    // with the expected ones.
+    bool Flush(ResourceStateTracker& tracker, const std::vector<StateBarrier>& expected)
+    {
+        const std::vector<StateBarrier> barriers = tracker.GetPendingBarriers();
+        tracker.ClearPendingBarriers();
+        if (barriers.size() != expected.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < barriers.size(); ++i)
+        {
+            const StateBarrier& a = barriers[i];
+            const StateBarrier& b = expected[i];
+            if (a.pResource != b.pResource || a.subresource != b.subresource || a.stateBefore != b.stateBefore ||
+                a.stateAfter != b.stateAfter || a.split != b.split)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The 02D frame, as PopulateCommandList() records it: the back buffer of the frame
+    // goes to RENDER_TARGET for the rendering pass, and back to PRESENT.
+    void TestFrameReplay()
+    {
+        int backBuffers[2] = {};
+        ResourceStateTracker tracker;
+        tracker.AddResource(&backBuffers[0], 1, Present);
+        tracker.AddResource(&backBuffers[1], 1, Present);
+
+        for (uint32_t frame = 0; frame < 4; ++frame)
+        {
+            const void* pBackBuffer = &backBuffers[frame % 2];
+            tracker.Transition(pBackBuffer, RenderTarget);
+            CHECK(Flush(tracker, { Barrier(pBackBuffer, Present, RenderTarget) }));
+
+            tracker.Transition(pBackBuffer, Present);
+            tracker.EndSplitTransitions();
+            CHECK(Flush(tracker, { Barrier(pBackBuffer, RenderTarget, Present) }));
+        }
+        CHECK(tracker.GetState(&backBuffers[0]) == Present && tracker.GetState(&backBuffers[1]) == Present);
+    }
+
+    // A vertex buffer read by a draw, then copied to after another pass. The split to
+    // COPY_DEST begins once the draw that reads it is recorded, and ends at the copy.
+    void TestSplitAfterLastUse()
+    {
+        int vertexBuffer = 0;
+        int target = 0;
+        ResourceStateTracker tracker;
+        tracker.AddResource(&vertexBuffer, 1, VertexAndConstantBuffer);
+        tracker.AddResource(&target, 1, Common);
+
+        // Draw, then begin the transition over the next pass.
+        tracker.Transition(&vertexBuffer, VertexAndConstantBuffer);
+        CHECK(Flush(tracker, {}));
+        tracker.BeginTransition(&vertexBuffer, CopyDest);
+        tracker.Transition(&target, RenderTarget);
+        CHECK(Flush(tracker, { Barrier(&vertexBuffer, VertexAndConstantBuffer, CopyDest, BarrierSplit::Begin), Barrier(&target, Common, RenderTarget) }));
+        CHECK(tracker.GetState(&vertexBuffer) == VertexAndConstantBuffer);
+
+        // The copy.
+        tracker.Transition(&vertexBuffer, CopyDest);
+        CHECK(Flush(tracker, { Barrier(&vertexBuffer, VertexAndConstantBuffer, CopyDest, BarrierSplit::End) }));
+        CHECK(tracker.GetState(&vertexBuffer) == CopyDest);
+
+        // Begun before the draw: the draw still needs the state that the split leaves.
+        tracker.Transition(&vertexBuffer, VertexAndConstantBuffer);
+        CHECK(Flush(tracker, { Barrier(&vertexBuffer, CopyDest, VertexAndConstantBuffer) }));
+        tracker.BeginTransition(&vertexBuffer, CopyDest);
+        CHECK(Flush(tracker, { Barrier(&vertexBuffer, VertexAndConstantBuffer, CopyDest, BarrierSplit::Begin) }));
+        CHECK_THROWS(tracker.Transition(&vertexBuffer, VertexAndConstantBuffer));
+        CHECK(Flush(tracker, {}));
+
+        // Any other state ends the split first.
+        tracker.Transition(&vertexBuffer, CopySource);
+        CHECK(Flush(tracker, { Barrier(&vertexBuffer, VertexAndConstantBuffer, CopyDest, BarrierSplit::End), Barrier(&vertexBuffer, CopyDest, CopySource) }));
+
+        // Begun in the same batch, with no commands in between: the split is dropped.
+        tracker.BeginTransition(&vertexBuffer, CopyDest);
+        tracker.Transition(&vertexBuffer, CopySource);
+        CHECK(Flush(tracker, {}));
+    }
+
+    void TestBatches()
+    {
+        int resource = 0;
+        ResourceStateTracker tracker;
+        tracker.AddResource(&resource, 1, CopyDest);
+        CHECK_THROWS(tracker.AddResource(&resource, 1, Common));
+        CHECK_THROWS(tracker.AddResource(&tracker, 0, Common));
+
+        // Undone transitions cancel out, and those that follow each other merge.
+        tracker.Transition(&resource, PixelShaderResource);
+        tracker.Transition(&resource, CopyDest);
+        CHECK(Flush(tracker, {}));
+        tracker.Transition(&resource, PixelShaderResource);
+        tracker.Transition(&resource, RenderTarget);
+        CHECK(Flush(tracker, { Barrier(&resource, CopyDest, RenderTarget) }));
+
+        // Read states that the resource is already in.
+        tracker.Transition(&resource, PixelShaderResource | NonPixelShaderResource);
+        CHECK(Flush(tracker, { Barrier(&resource, RenderTarget, PixelShaderResource | NonPixelShaderResource) }));
+        tracker.Transition(&resource, PixelShaderResource);
+        CHECK(Flush(tracker, {}));
+        tracker.Transition(&resource, CopySource);
+        CHECK(Flush(tracker, { Barrier(&resource, PixelShaderResource | NonPixelShaderResource, CopySource) }));
+        tracker.Transition(&resource, Common);
+        CHECK(Flush(tracker, { Barrier(&resource, CopySource, Common) }));
+
+        // A split that begins and ends in the same batch collapses, and one that goes
+        // somewhere else ends before the next transition.
+        tracker.BeginTransition(&resource, RenderTarget);
+        tracker.Transition(&resource, RenderTarget);
+        CHECK(Flush(tracker, { Barrier(&resource, Common, RenderTarget) }));
+        tracker.BeginTransition(&resource, CopyDest);
+        CHECK(Flush(tracker, { Barrier(&resource, RenderTarget, CopyDest, BarrierSplit::Begin) }));
+        tracker.Transition(&resource, CopySource);
+        CHECK(Flush(tracker, { Barrier(&resource, RenderTarget, CopyDest, BarrierSplit::End), Barrier(&resource, CopyDest, CopySource) }));
+        CHECK(tracker.GetState(&resource) == CopySource);
+
+        tracker.RemoveResource(&resource);
+        CHECK_THROWS(tracker.Transition(&resource, Common));
+        CHECK_THROWS(tracker.GetState(&resource));
+    }
+
+    void TestSubresources()
+    {
+        int texture = 0;
+        ResourceStateTracker tracker;
+        tracker.AddResource(&texture, 4, PixelShaderResource);
+        CHECK_THROWS(tracker.Transition(&texture, RenderTarget, 4));
+
+        tracker.Transition(&texture, RenderTarget, 2);
+        CHECK(Flush(tracker, { Barrier(&texture, PixelShaderResource, RenderTarget, BarrierSplit::None, 2) }));
+        tracker.Transition(&texture, PixelShaderResource);
+        CHECK(Flush(tracker, { Barrier(&texture, RenderTarget, PixelShaderResource, BarrierSplit::None, 2) }));
+        tracker.Transition(&texture, CopyDest);
+        CHECK(Flush(tracker, { Barrier(&texture, PixelShaderResource, CopyDest) }));
+
+        tracker.Transition(&texture, CopySource, 1);
+        tracker.Transition(&texture, CopySource, 3);
+        tracker.Transition(&texture, PixelShaderResource);
+        CHECK(Flush(tracker,
+        {
+            Barrier(&texture, CopyDest, PixelShaderResource, BarrierSplit::None, 1),
+            Barrier(&texture, CopyDest, PixelShaderResource, BarrierSplit::None, 3),
+            Barrier(&texture, CopyDest, PixelShaderResource, BarrierSplit::None, 0),
+            Barrier(&texture, CopyDest, PixelShaderResource, BarrierSplit::None, 2)
+        }));
+
+        // The split of one subresource ends on its own, and the others at the end of the
+        // command list.
+        tracker.BeginTransition(&texture, RenderTarget);
+        CHECK(Flush(tracker, { Barrier(&texture, PixelShaderResource, RenderTarget, BarrierSplit::Begin) }));
+        tracker.Transition(&texture, RenderTarget, 0);
+        CHECK(Flush(tracker, { Barrier(&texture, PixelShaderResource, RenderTarget, BarrierSplit::End, 0) }));
+        CHECK_THROWS(tracker.Transition(&texture, PixelShaderResource));
+        tracker.EndSplitTransitions();
+        CHECK(Flush(tracker,
+        {
+            Barrier(&texture, PixelShaderResource, RenderTarget, BarrierSplit::End, 1),
+            Barrier(&texture, PixelShaderResource, RenderTarget, BarrierSplit::End, 2),
+            Barrier(&texture, PixelShaderResource, RenderTarget, BarrierSplit::End, 3)
+        }));
+    }
+
+    // Random transitions: the barriers, replayed over the states of the subresources
+    // on the GPU, always start from the state the GPU has, and leave it in the state
+    // the tracker has.
+    void TestFuzz()
+    {
+        const uint32_t noSplit = 0xffffffff;
+        const uint32_t states[] = { Common, VertexAndConstantBuffer, RenderTarget, CopyDest, CopySource, PixelShaderResource,
+            PixelShaderResource | NonPixelShaderResource, StreamOut };
+        const uint32_t subresourceCounts[] = { 1, 3, 6 };
+        int resources[3] = {};
+
+        std::mt19937 random(5);
+        for (uint32_t round = 0; round < 200; ++round)
+        {
+            ResourceStateTracker tracker;
+            std::vector<uint32_t> gpuStates[3];
+            std::vector<uint32_t> gpuSplitStates[3];
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                tracker.AddResource(&resources[i], subresourceCounts[i], Common);
+                gpuStates[i].assign(subresourceCounts[i], Common);
+                gpuSplitStates[i].assign(subresourceCounts[i], noSplit);
+            }
+
+            for (uint32_t step = 0; step < 300; ++step)
+            {
+                const uint32_t i = random() % 3;
+                const uint32_t state = states[random() % 8];
+                const uint32_t subresource = (random() % 2 != 0) ? All : random() % subresourceCounts[i];
+                if (random() % 4 == 0)
+                {
+                    tracker.BeginTransition(&resources[i], state, subresource);
+                }
+                else
+                {
+                    try
+                    {
+                        tracker.Transition(&resources[i], state, subresource);
+                    }
+                    catch (const std::exception&)
+                    {
+                        // Only a recorded split can refuse a transition.
+                        bool splitRecorded = false;
+                        for (uint32_t j = 0; j < subresourceCounts[i]; ++j)
+                        {
+                            splitRecorded |= (subresource == All || subresource == j) && gpuSplitStates[i][j] != noSplit;
+                        }
+                        CHECK(splitRecorded);
+                    }
+                }
+
+                if (random() % 3 != 0 && step != 299)
+                {
+                    continue;
+                }
+                if (step == 299)
+                {
+                    tracker.EndSplitTransitions();
+                }
+                for (const StateBarrier& barrier : tracker.GetPendingBarriers())
+                {
+                    const uint32_t k = static_cast<uint32_t>(static_cast<const int*>(barrier.pResource) - resources);
+                    for (uint32_t j = 0; j < subresourceCounts[k]; ++j)
+                    {
+                        if (barrier.subresource != All && barrier.subresource != j)
+                        {
+                            continue;
+                        }
+                        if (barrier.split == BarrierSplit::End)
+                        {
+                            CHECK(gpuSplitStates[k][j] == barrier.stateAfter);
+                            gpuSplitStates[k][j] = noSplit;
+                        }
+                        else
+                        {
+                            CHECK(gpuSplitStates[k][j] == noSplit);
+                        }
+                        CHECK(gpuStates[k][j] == barrier.stateBefore && barrier.stateBefore != barrier.stateAfter);
+                        if (barrier.split == BarrierSplit::Begin)
+                        {
+                            gpuSplitStates[k][j] = barrier.stateAfter;
+                        }
+                        else
+                        {
+                            gpuStates[k][j] = barrier.stateAfter;
+                        }
+                    }
+                }
+                tracker.ClearPendingBarriers();
+
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    for (uint32_t j = 0; j < subresourceCounts[k]; ++j)
+                    {
+                        CHECK(tracker.GetState(&resources[k], j) == gpuStates[k][j]);
+                    }
+                }
+            }
+
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                for (uint32_t j = 0; j < subresourceCounts[k]; ++j)
+                {
+                    CHECK(gpuSplitStates[k][j] == noSplit);
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestFrameReplay();
+    TestSplitAfterLastUse();
+    TestBatches();
+    TestSubresources();
+    TestFuzz();
+    return 0;
+}
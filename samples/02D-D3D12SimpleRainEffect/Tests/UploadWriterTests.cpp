@@ -0,0 +1,142 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "UploadWriter.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const uint8_t c_untouched = 0xCD;
+
+    // Random writes and alignments, at every 16-byte offset in a cache line and for
+    // destinations of any multiple of 4 bytes, give the bytes of a plain copy; the
+    // writer zeroes the end of the last 16 bytes and nothing past the destination.
+    void TestRandomWrites()
+    {
+        std::mt19937 random(7);
+        for (int test = 0; test < 2000; ++test)
+        {
+            const size_t size = 4 * (1 + random() % 300);
+            const size_t shift = 16 * (random() % 4);
+            std::vector<uint8_t> memory(size + 128, c_untouched);
+            uint8_t* pDestination = memory.data() + (64 - reinterpret_cast<uintptr_t>(memory.data()) % 64) % 64 + shift;
+            std::vector<uint8_t> expected(size, c_untouched);
+
+            size_t offset = 0;
+            {
+                UploadWriter writer(pDestination, size);
+                for (;;)
+                {
+                    if (random() % 4 == 0)
+                    {
+                        const size_t alignment = size_t(1) << (random() % 9);
+                        const size_t padding = (alignment - offset % alignment) % alignment;
+                        if (offset + padding > size)
+                        {
+                            break;
+                        }
+                        writer.Align(alignment);
+                        std::fill(expected.begin() + offset, expected.begin() + offset + padding, 0);
+                        offset += padding;
+                        CHECK(writer.GetOffset() == offset);
+                        continue;
+                    }
+
+                    const size_t count = random() % 100;
+                    if (offset + count > size)
+                    {
+                        break;
+                    }
+                    std::vector<uint8_t> bytes(count);
+                    for (auto& byte : bytes)
+                    {
+                        byte = static_cast<uint8_t>(random());
+                    }
+                    CHECK(writer.WriteArray(bytes.data(), count) == offset);
+                    std::copy(bytes.begin(), bytes.end(), expected.begin() + offset);
+                    offset += count;
+                }
+                writer.Close();
+
+                const size_t end = (std::min)((offset + 15) / 16 * 16, size);
+                std::fill(expected.begin() + offset, expected.begin() + end, 0);
+                CHECK(writer.GetBytesWritten() == end);
+            }
+
+            CHECK(std::memcmp(pDestination, expected.data(), size) == 0);
+            CHECK(pDestination[-1] == c_untouched || shift == 0);
+            CHECK(pDestination + size == memory.data() + memory.size() || pDestination[size] == c_untouched);
+        }
+    }
+
+    // Constant buffer slots, as 02D writes them: each value is aligned to 256 bytes.
+    void TestConstantBufferSlots()
+    {
+        struct Constants
+        {
+            float matrices[3][16];
+            float color[4];
+            float camera[3];
+            float deltaTime;
+        };
+
+        const size_t slotCount = 16;
+        alignas(64) uint8_t memory[slotCount * 256];
+        std::memset(memory, c_untouched, sizeof(memory));
+
+        Constants constants = {};
+        {
+            UploadWriter writer(memory, sizeof(memory));
+            for (size_t i = 0; i < slotCount; ++i)
+            {
+                constants.deltaTime = static_cast<float>(i);
+                CHECK(writer.Write(constants) == 256 * i);
+                writer.Align(256);
+            }
+            CHECK(writer.GetOffset() == sizeof(memory));
+        }
+
+        for (size_t i = 0; i < slotCount; ++i)
+        {
+            constants.deltaTime = static_cast<float>(i);
+            CHECK(std::memcmp(memory + 256 * i, &constants, sizeof(constants)) == 0);
+            CHECK(std::all_of(memory + 256 * i + sizeof(constants), memory + 256 * (i + 1), [](uint8_t byte) { return byte == 0; }));
+        }
+    }
+
+    void TestErrors()
+    {
+        alignas(16) uint8_t buffer[64] = {};
+        CHECK_THROWS(UploadWriter(buffer + 4, 16));
+        CHECK_THROWS(UploadWriter(buffer, 30));
+        CHECK_THROWS(UploadWriter(nullptr, 16));
+
+        UploadWriter writer(buffer, 32);
+        CHECK_THROWS(writer.WriteArray(buffer, 33));
+        CHECK_THROWS(writer.Align(3));
+        writer.WriteBytes(buffer, 8);
+        writer.Close();
+        CHECK_THROWS(writer.WriteBytes(buffer, 4));
+    }
+}
+
+int main()
+{
+    TestRandomWrites();
+    TestConstantBufferSlots();
+    TestErrors();
+    return 0;
+}
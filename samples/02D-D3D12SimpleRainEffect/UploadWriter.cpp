@@ -0,0 +1,167 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "UploadWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UPLOAD_WRITER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const uint8_t c_zeros[UploadWriter::LineSize] = {};
+}
+
+UploadWriter::UploadWriter(void* pDestination, size_t size) :
+    m_pDestination(static_cast<uint8_t*>(pDestination)),
+    m_size(size),
+    m_offset(0),
+    m_lineBegin(0),
+    m_lineShift(reinterpret_cast<uintptr_t>(pDestination) % LineSize),
+    m_bytesWritten(0),
+    m_isClosed(false),
+    m_line{}
+{
+    if (pDestination == nullptr || reinterpret_cast<uintptr_t>(pDestination) % 16 != 0 || size % 4 != 0)
+    {
+        throw std::runtime_error("UploadWriter: the destination must be 16-byte aligned, and its size a multiple of 4 bytes");
+    }
+}
+
+UploadWriter::~UploadWriter()
+{
+    Close();
+}
+
+size_t UploadWriter::WriteBytes(const void* pSource, size_t size)
+{
+    if (m_isClosed)
+    {
+        throw std::runtime_error("UploadWriter: the writer is closed");
+    }
+    if (size > m_size - m_offset)
+    {
+        throw std::runtime_error("UploadWriter: the destination is full");
+    }
+
+    const size_t offset = m_offset;
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pSource);
+    while (size > 0)
+    {
+        const size_t lineOffset = (m_lineShift + m_offset) % LineSize;
+
+#if defined(UPLOAD_WRITER_SSE)
+        // Whole lines go straight from the source to the destination.
+        if (lineOffset == 0 && size >= LineSize)
+        {
+            __m128i* pLine = reinterpret_cast<__m128i*>(m_pDestination + m_offset);
+            const __m128i* pSourceLine = reinterpret_cast<const __m128i*>(pBytes);
+            _mm_stream_si128(pLine + 0, _mm_loadu_si128(pSourceLine + 0));
+            _mm_stream_si128(pLine + 1, _mm_loadu_si128(pSourceLine + 1));
+            _mm_stream_si128(pLine + 2, _mm_loadu_si128(pSourceLine + 2));
+            _mm_stream_si128(pLine + 3, _mm_loadu_si128(pSourceLine + 3));
+            pBytes += LineSize;
+            size -= LineSize;
+            m_offset += LineSize;
+            m_lineBegin = m_offset;
+            m_bytesWritten += LineSize;
+            continue;
+        }
+#endif
+
+        const size_t count = (std::min)(size, LineSize - lineOffset);
+        memcpy(m_line + lineOffset, pBytes, count);
+        pBytes += count;
+        size -= count;
+        m_offset += count;
+
+        if (lineOffset + count == LineSize)
+        {
+            FlushLine();
+        }
+    }
+    return offset;
+}
+
+void UploadWriter::Align(size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::runtime_error("UploadWriter: the alignment must be a power of two");
+    }
+
+    size_t padding = (alignment - m_offset % alignment) % alignment;
+    while (padding > 0)
+    {
+        const size_t count = (std::min)(padding, sizeof(c_zeros));
+        WriteBytes(c_zeros, count);
+        padding -= count;
+    }
+}
+
+void UploadWriter::Close()
+{
+    if (m_isClosed)
+    {
+        return;
+    }
+
+    // Complete the last 16 bytes with zeros, as far as the destination goes.
+    const size_t end = (std::min)((m_offset + 15) / 16 * 16, m_size);
+    if (end > m_offset)
+    {
+        memset(m_line + (m_lineShift + m_offset) % LineSize, 0, end - m_offset);
+        m_offset = end;
+    }
+    FlushLine();
+
+#if defined(UPLOAD_WRITER_SSE)
+    // Non-temporal stores aren't ordered with the other stores: make them visible
+    // before the command lists that read them are submitted.
+    _mm_sfence();
+#endif
+    m_isClosed = true;
+}
+
+void UploadWriter::FlushLine()
+{
+    size_t offset = m_lineBegin;
+    for (; offset + 16 <= m_offset; offset += 16)
+    {
+        const uint8_t* pSource = m_line + (m_lineShift + offset) % LineSize;
+#if defined(UPLOAD_WRITER_SSE)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(m_pDestination + offset), _mm_load_si128(reinterpret_cast<const __m128i*>(pSource)));
+#else
+        memcpy(m_pDestination + offset, pSource, 16);
+#endif
+    }
+
+    // The end of a destination that isn't a multiple of 16 bytes.
+    for (; offset < m_offset; offset += 4)
+    {
+        const uint8_t* pSource = m_line + (m_lineShift + offset) % LineSize;
+#if defined(UPLOAD_WRITER_SSE)
+        int value;
+        memcpy(&value, pSource, sizeof(value));
+        _mm_stream_si32(reinterpret_cast<int*>(m_pDestination + offset), value);
+#else
+        memcpy(m_pDestination + offset, pSource, 4);
+#endif
+    }
+
+    m_bytesWritten += m_offset - m_lineBegin;
+    m_lineBegin = m_offset;
+}
@@ -0,0 +1,79 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Sequential writer for mapped upload heap memory.
+// Upload heaps are mapped write-combined on most GPUs: the CPU merges the stores to a
+// cache line in a write-combining buffer and sends the line over the bus when it's
+// full. Reads are uncached, and scattered or partial writes send partial lines.
+// The writer collects the bytes of a line on the stack and writes it with non-temporal
+// 16-byte stores, in address order, once it's complete. It never reads the destination,
+// and the padding between values (Align()) is written as zeros rather than skipped.
+// Close() writes the last partial line and fences the stores, so it must be called
+// before the GPU reads the memory; the destructor calls it.
+class UploadWriter
+{
+public:
+    static const size_t LineSize = 64;
+
+    // pDestination must be 16-byte aligned, and size a multiple of 4 bytes.
+    UploadWriter(void* pDestination, size_t size);
+    ~UploadWriter();
+
+    // Each returns the offset of the value from pDestination.
+    template <typename T>
+    size_t Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written to upload memory.");
+        return WriteBytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    size_t WriteArray(const T* pValues, size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written to upload memory.");
+        return WriteBytes(pValues, sizeof(T) * count);
+    }
+
+    size_t WriteBytes(const void* pSource, size_t size);
+
+    // Writes zeros up to the next multiple of alignment (a power of two) from pDestination.
+    void Align(size_t alignment);
+
+    void Close();
+
+    size_t GetOffset() const        { return m_offset; }
+
+    // Bytes sent to the destination so far, padding included.
+    size_t GetBytesWritten() const  { return m_bytesWritten; }
+
+private:
+    UploadWriter(const UploadWriter&) = delete;
+    UploadWriter& operator=(const UploadWriter&) = delete;
+
+    // Writes the buffered bytes from m_lineBegin to m_offset, which is on a 16-byte
+    // boundary or at the end of the destination.
+    void FlushLine();
+
+    uint8_t* m_pDestination;
+    size_t m_size;
+    size_t m_offset;
+    size_t m_lineBegin;             // Offset of the first byte of the current line not written yet.
+    size_t m_lineShift;             // Offset of pDestination in its cache line.
+    size_t m_bytesWritten;
+    bool m_isClosed;
+    alignas(16) uint8_t m_line[LineSize];
+};
@@ -15,6 +15,12 @@ cbuffer Constants : register(b0)
 	float4 outputColor;
 	float3 cameraWPos;
 	float deltaTime;
+	float density;
+	float densityFadeWidth;
+	float dropCount;
+	float farDensity;
+	float fadeStartDistance;
+	float fadeEndDistance;
 };
 
  
@@ -26,33 +32,85 @@ struct VS_INPUT
 	float Speed : SPEED;
 };
 
+struct DRAW_GS_INPUT
+{
+	float3 Pos : POSITION;
+	float2 Size : SIZE;
+	float Rank : RANK;
+};
+
 struct GS_OUTPUT
 {
 	float4 Pos : SV_POSITION;
+	float Fade : FADE;
 };
 
 
 //--------------------------------------------------------------------------------------
-// Name: MainVS
-// Desc: Pass-through Vertex shader
+// Name: DrawVS
+// Desc: Vertex shader giving the particles their rank, from their place in the buffer
+//--------------------------------------------------------------------------------------
+DRAW_GS_INPUT DrawVS(VS_INPUT In, uint vertexId : SV_VertexID)
+{
+	DRAW_GS_INPUT Out;
+	Out.Pos = In.Pos;
+	Out.Size = In.Size;
+	Out.Rank = (vertexId + 0.5f) / dropCount;
+	return Out;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Name: DropAlpha
+// Desc: Opacity of a drop from its rank and its distance to the camera, as
+//       ParticleDensityController::GetDropAlpha() computes it
 //--------------------------------------------------------------------------------------
-VS_INPUT MainVS(VS_INPUT In)
+float DropAlpha(float rank, float distance)
 {
-	return In;
+	float t = smoothstep(fadeStartDistance, fadeEndDistance, distance);
+	float threshold = density * lerp(1.0f, farDensity, t) * (1.0f + densityFadeWidth);
+	return saturate((threshold - rank) / densityFadeWidth);
 }
 
 
 //--------------------------------------------------------------------------------------
-// Name: MainGSSO
-// Desc: Geometry shader for moving particles
+// Simulation, on the compute queue
 //--------------------------------------------------------------------------------------
-[maxvertexcount(1)]
-void MainGSSO(point VS_INPUT input[1], inout PointStream<VS_INPUT> output)
+cbuffer SimulationConstants : register(b1)
+{
+	float simulationDeltaTime;
+	uint particleCount;
+};
+
+// Laid out as VS_INPUT, which the rendering pass reads the particles as.
+struct Particle
 {
-	VS_INPUT particle = input[0];
+	float3 Pos;
+	float2 Size;
+	float Speed;
+};
+
+StructuredBuffer<Particle> inputParticles : register(t0);
+RWStructuredBuffer<Particle> outputParticles : register(u0);
+
+
+//--------------------------------------------------------------------------------------
+// Name: SimulateCS
+// Desc: Compute shader moving the particles, as SimulateParticles() does on the CPU
+//--------------------------------------------------------------------------------------
+[numthreads(64, 1, 1)]
+void SimulateCS(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	uint index = dispatchThreadId.x;
+	if (index >= particleCount)
+	{
+		return;
+	}
+
+	Particle particle = inputParticles[index];
     
     // Decrease the height of the point\particle over time based on its speed
-	particle.Pos.y -= particle.Speed * deltaTime;
+	particle.Pos.y -= particle.Speed * simulationDeltaTime;
     
     // Reset the height of the point\particle
 	if (particle.Pos.y < -50.0f)
@@ -60,8 +118,7 @@ void MainGSSO(point VS_INPUT input[1], inout PointStream<VS_INPUT> output)
 		particle.Pos.y = 50.0f;
 	}
 	
-	// Emit the point\particle with the updated position
-	output.Append(particle);
+	outputParticles[index] = particle;
 }
 
 
@@ -70,10 +127,17 @@ void MainGSSO(point VS_INPUT input[1], inout PointStream<VS_INPUT> output)
 // Desc: Geometry shader for drawing quads from points\particles
 //--------------------------------------------------------------------------------------
 [maxvertexcount(4)]
-void MainGS(point VS_INPUT input[1], inout TriangleStream<GS_OUTPUT> outputStream)
+void MainGS(point DRAW_GS_INPUT input[1], inout TriangleStream<GS_OUTPUT> outputStream)
 {
     // World coordinates of the input point\particle
 	float3 positionW = mul(float4(input[0].Pos, 1.0f), mWorld).xyz;
+
+	// The drops out of the density at their distance are culled, and those on its edge fade.
+	float fade = DropAlpha(input[0].Rank, length(cameraWPos - positionW));
+	if (fade <= 0.0f)
+	{
+		return;
+	}
     
 	// We need the up direction of the world space, and left direction with respect to the quad.
 	// We can use the projection of the front vector onto the xz-plane to calculate the left direction.
@@ -99,6 +163,7 @@ void MainGS(point VS_INPUT input[1], inout TriangleStream<GS_OUTPUT> outputStrea
 	// Transform the four vertices of the quad from world to clip space, and
 	// emit them as a triangle strip.
 	GS_OUTPUT output = (GS_OUTPUT)0;
+	output.Fade = fade;
     [unroll]
 	for (int i = 0; i < 4; ++i)
 	{
@@ -111,9 +176,9 @@ void MainGS(point VS_INPUT input[1], inout TriangleStream<GS_OUTPUT> outputStrea
 
 //--------------------------------------------------------------------------------------
 // Name: SolidColorPS
-// Desc: Pixel shader applying solid color
+// Desc: Pixel shader applying solid color, faded with the density
 //--------------------------------------------------------------------------------------
 float4 MainPS(GS_OUTPUT input) : SV_Target
 {
-	return outputColor;
+	return float4(outputColor.rgb, outputColor.a * input.Fade);
 }
\ No newline at end of file
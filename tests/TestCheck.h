@@ -0,0 +1,47 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+// Checks of the tests of the portable modules. A failed check prints its location and
+// ends the test with a non-zero exit code, which is what CTest looks at.
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(EXIT_FAILURE); \
+        } \
+    } while (false)
+
+#define CHECK_THROWS(statement) \
+    do \
+    { \
+        bool thrown = false; \
+        try \
+        { \
+            statement; \
+        } \
+        catch (const std::exception&) \
+        { \
+            thrown = true; \
+        } \
+        if (!thrown) \
+        { \
+            std::fprintf(stderr, "%s(%d): no exception thrown by: %s\n", __FILE__, __LINE__, #statement); \
+            std::exit(EXIT_FAILURE); \
+        } \
+    } while (false)
@@ -0,0 +1,311 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Strict JSON reader for the tests of the modules that export JSON. ParseTestJson()
+// returns false on anything that isn't a single, complete JSON value.
+struct TestJsonValue
+{
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<TestJsonValue> elements;
+    std::vector<std::pair<std::string, TestJsonValue>> members;
+
+    const TestJsonValue* Find(const char* key) const
+    {
+        for (const auto& member : members)
+        {
+            if (member.first == key)
+            {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class TestJsonParser
+{
+public:
+    explicit TestJsonParser(const std::string& text) : m_p(text.c_str()), m_end(text.c_str() + text.size()) {}
+
+    bool Parse(TestJsonValue& value)
+    {
+        if (!ParseValue(value, 0))
+        {
+            return false;
+        }
+        SkipSpace();
+        return m_p == m_end;
+    }
+
+private:
+    void SkipSpace()
+    {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+        {
+            ++m_p;
+        }
+    }
+
+    bool Consume(const char* literal)
+    {
+        const char* p = m_p;
+        for (; *literal != '\0'; ++literal, ++p)
+        {
+            if (p == m_end || *p != *literal)
+            {
+                return false;
+            }
+        }
+        m_p = p;
+        return true;
+    }
+
+    static int HexDigit(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Escapes of code points over 0x7f are kept as UTF-8.
+    bool ParseString(std::string& text)
+    {
+        if (m_p == m_end || *m_p != '"')
+        {
+            return false;
+        }
+        for (++m_p; m_p < m_end && *m_p != '"'; ++m_p)
+        {
+            const unsigned char c = static_cast<unsigned char>(*m_p);
+            if (c < 0x20)
+            {
+                return false;
+            }
+            if (c != '\\')
+            {
+                text += *m_p;
+                continue;
+            }
+            if (++m_p == m_end)
+            {
+                return false;
+            }
+            switch (*m_p)
+            {
+            case '"': text += '"'; break;
+            case '\\': text += '\\'; break;
+            case '/': text += '/'; break;
+            case 'b': text += '\b'; break;
+            case 'f': text += '\f'; break;
+            case 'n': text += '\n'; break;
+            case 'r': text += '\r'; break;
+            case 't': text += '\t'; break;
+            case 'u':
+            {
+                unsigned int codePoint = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    if (++m_p == m_end || HexDigit(*m_p) < 0)
+                    {
+                        return false;
+                    }
+                    codePoint = codePoint * 16 + HexDigit(*m_p);
+                }
+                if (codePoint < 0x80)
+                {
+                    text += static_cast<char>(codePoint);
+                }
+                else if (codePoint < 0x800)
+                {
+                    text += static_cast<char>(0xc0 | (codePoint >> 6));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3f));
+                }
+                else
+                {
+                    text += static_cast<char>(0xe0 | (codePoint >> 12));
+                    text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3f));
+                }
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        if (m_p == m_end)
+        {
+            return false;
+        }
+        ++m_p;
+        return true;
+    }
+
+    bool ParseNumber(double& number)
+    {
+        const char* begin = m_p;
+        if (m_p < m_end && *m_p == '-')
+        {
+            ++m_p;
+        }
+        const char* digits = m_p;
+        while (m_p < m_end && *m_p >= '0' && *m_p <= '9')
+        {
+            ++m_p;
+        }
+        if (m_p == digits || (*digits == '0' && m_p - digits > 1))
+        {
+            return false;
+        }
+        if (m_p < m_end && *m_p == '.')
+        {
+            const char* fraction = ++m_p;
+            while (m_p < m_end && *m_p >= '0' && *m_p <= '9')
+            {
+                ++m_p;
+            }
+            if (m_p == fraction)
+            {
+                return false;
+            }
+        }
+        if (m_p < m_end && (*m_p == 'e' || *m_p == 'E'))
+        {
+            ++m_p;
+            if (m_p < m_end && (*m_p == '+' || *m_p == '-'))
+            {
+                ++m_p;
+            }
+            const char* exponent = m_p;
+            while (m_p < m_end && *m_p >= '0' && *m_p <= '9')
+            {
+                ++m_p;
+            }
+            if (m_p == exponent)
+            {
+                return false;
+            }
+        }
+        number = std::strtod(std::string(begin, m_p).c_str(), nullptr);
+        return true;
+    }
+
+    bool ParseValue(TestJsonValue& value, int depth)
+    {
+        SkipSpace();
+        if (m_p == m_end || depth > 64)
+        {
+            return false;
+        }
+
+        if (*m_p == '{' || *m_p == '[')
+        {
+            const bool isObject = *m_p == '{';
+            const char close = isObject ? '}' : ']';
+            value.type = isObject ? TestJsonValue::Object : TestJsonValue::Array;
+            ++m_p;
+            SkipSpace();
+            if (m_p < m_end && *m_p == close)
+            {
+                ++m_p;
+                return true;
+            }
+            for (;;)
+            {
+                if (isObject)
+                {
+                    std::string key;
+                    SkipSpace();
+                    if (!ParseString(key))
+                    {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (!Consume(":"))
+                    {
+                        return false;
+                    }
+                    value.members.emplace_back(std::move(key), TestJsonValue());
+                    if (!ParseValue(value.members.back().second, depth + 1))
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    value.elements.emplace_back();
+                    if (!ParseValue(value.elements.back(), depth + 1))
+                    {
+                        return false;
+                    }
+                }
+                SkipSpace();
+                if (m_p == m_end)
+                {
+                    return false;
+                }
+                if (*m_p == close)
+                {
+                    ++m_p;
+                    return true;
+                }
+                if (*m_p++ != ',')
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (*m_p == '"')
+        {
+            value.type = TestJsonValue::String;
+            return ParseString(value.string);
+        }
+        if (Consume("true"))
+        {
+            value.type = TestJsonValue::Bool;
+            value.boolean = true;
+            return true;
+        }
+        if (Consume("false"))
+        {
+            value.type = TestJsonValue::Bool;
+            return true;
+        }
+        if (Consume("null"))
+        {
+            value.type = TestJsonValue::Null;
+            return true;
+        }
+        value.type = TestJsonValue::Number;
+        return ParseNumber(value.number);
+    }
+
+    const char* m_p;
+    const char* m_end;
+};
+
+inline bool ParseTestJson(const std::string& text, TestJsonValue& value)
+{
+    return TestJsonParser(text).Parse(value);
+}